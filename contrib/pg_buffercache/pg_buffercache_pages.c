@@ -115,7 +115,7 @@ pg_buffercache_pages(PG_FUNCTION_ARGS)
 		 * for concurrency.  Must grab locks in increasing order to avoid
 		 * possible deadlocks.
 		 */
-		for (i = 0; i < NUM_BUFFER_PARTITIONS; i++)
+		for (i = 0; i < NumBufferPartitions; i++)
 			LWLockAcquire(FirstBufMappingLock + i, LW_SHARED);
 
 		/*
@@ -156,7 +156,7 @@ pg_buffercache_pages(PG_FUNCTION_ARGS)
 		 * other process until it can get all the locks it needs. (2) This
 		 * avoids O(N^2) behavior inside LWLockRelease.
 		 */
-		for (i = NUM_BUFFER_PARTITIONS; --i >= 0;)
+		for (i = NumBufferPartitions; --i >= 0;)
 			LWLockRelease(FirstBufMappingLock + i);
 	}
 
@@ -11,6 +11,11 @@
 
 #include "pg_upgrade.h"
 
+#include "access/visibilitymap.h"
+#include "storage/bufpage.h"
+#include "storage/checksum.h"
+#include "storage/checksum_impl.h"
+
 #include <fcntl.h>
 
 
@@ -123,6 +128,173 @@ linkAndUpdateFile(pageCnvCtx *pageConverter,
 }
 
 
+/*
+ * rewriteVisibilityMap()
+ *
+ * In versions of PostgreSQL prior to catversion VISIBILITY_MAP_FROZEN_BIT_CAT_VER,
+ * visibility map included one bit per heap page; it now includes two.
+ * When upgrading a cluster from before that time to a current PostgreSQL
+ * version, we could refuse to copy visibility maps from the old cluster
+ * to the new cluster; the next VACUUM would recreate them, but at the
+ * price of scanning the entire table.  So, instead, we rewrite the old
+ * visibility maps in the new format.  That way, the all-visible bits
+ * remain set for the pages for which they were set previously.  The
+ * all-frozen bits are never set by this conversion; we leave that to VACUUM.
+ *
+ * Each old-format page turns into two new-format pages, each of which
+ * keeps the old page's header.  If the second half of the last old page
+ * is empty it is not written, so that the visibility maps of small tables
+ * don't needlessly double in size.
+ */
+const char *
+rewriteVisibilityMap(const char *fromfile, const char *tofile)
+{
+	int			src_fd;
+	int			dst_fd;
+	char	   *buffer;
+	char	   *new_vmbuf;
+	const char *msg = NULL;
+	ssize_t		bytesRead;
+	off_t		totalBytesRead = 0;
+	off_t		src_filesize;
+	int			rewriteVmBytesPerPage;
+	BlockNumber new_blkno = 0;
+	struct stat statbuf;
+
+	/* Compute number of old-format bytes per new page */
+	rewriteVmBytesPerPage = (BLCKSZ - SizeOfPageHeaderData) / 2;
+
+	if ((src_fd = open(fromfile, O_RDONLY, 0)) < 0)
+		return getErrorText(errno);
+
+	if (fstat(src_fd, &statbuf) != 0)
+	{
+		msg = getErrorText(errno);
+		close(src_fd);
+		return msg;
+	}
+
+	if ((dst_fd = open(tofile, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR)) < 0)
+	{
+		msg = getErrorText(errno);
+		close(src_fd);
+		return msg;
+	}
+
+	/* Save old file size */
+	src_filesize = statbuf.st_size;
+
+	/*
+	 * Malloc the work buffers, rather than making them local arrays, to
+	 * ensure adequate alignment.
+	 */
+	buffer = (char *) pg_malloc(BLCKSZ);
+	new_vmbuf = (char *) pg_malloc(BLCKSZ);
+
+	/* Turn each visibility map page into 2 pages one by one */
+	while ((bytesRead = read(src_fd, buffer, BLCKSZ)) == BLCKSZ)
+	{
+		char	   *old_cur;
+		char	   *old_break;
+		char	   *old_blkend;
+		PageHeaderData pageheader;
+		bool		old_lastblk;
+
+		totalBytesRead += BLCKSZ;
+		old_lastblk = (totalBytesRead == src_filesize);
+
+		/* Save the page header data */
+		memcpy(&pageheader, buffer, SizeOfPageHeaderData);
+
+		/*
+		 * These old_* variables point to old visibility map page. old_cur
+		 * points to current position on old page. old_blkend points to end
+		 * of old block.  old_break is the end+1 position on the old page for
+		 * the data that will be transferred to the current new page.
+		 */
+		old_cur = buffer + SizeOfPageHeaderData;
+		old_blkend = buffer + bytesRead;
+		old_break = old_cur + rewriteVmBytesPerPage;
+
+		while (old_break <= old_blkend)
+		{
+			char	   *new_cur;
+			bool		empty = true;
+			bool		old_lastpart;
+
+			/* First, copy old page header to new page */
+			memcpy(new_vmbuf, &pageheader, SizeOfPageHeaderData);
+
+			/* Rewriting the last part of the last old page? */
+			old_lastpart = old_lastblk && (old_break == old_blkend);
+
+			new_cur = new_vmbuf + SizeOfPageHeaderData;
+
+			/* Process old page bytes one by one, and turn it into new page. */
+			while (old_cur < old_break)
+			{
+				uint8		byte = *(uint8 *) old_cur;
+				uint16		new_vmbits = 0;
+				int			i;
+
+				/* Generate new format bits while keeping old information */
+				for (i = 0; i < BITS_PER_BYTE; i++)
+				{
+					if (byte & (1 << i))
+					{
+						empty = false;
+						new_vmbits |=
+							VISIBILITYMAP_ALL_VISIBLE << (BITS_PER_HEAPBLOCK * i);
+					}
+				}
+
+				/* Copy new visibility map bytes to new-format page */
+				new_cur[0] = (char) (new_vmbits & 0xFF);
+				new_cur[1] = (char) (new_vmbits >> 8);
+
+				old_cur++;
+				new_cur += BITS_PER_HEAPBLOCK;
+			}
+
+			/* If the last part of the last page is empty, skip writing it */
+			if (old_lastpart && empty)
+				break;
+
+			/* Set new checksum for visibility map page, if enabled */
+			if (new_cluster.controldata.data_checksum_version != 0)
+				((PageHeader) new_vmbuf)->pd_checksum =
+					pg_checksum_page(new_vmbuf, new_blkno);
+
+			errno = 0;
+			if (write(dst_fd, new_vmbuf, BLCKSZ) != BLCKSZ)
+			{
+				/* if write didn't set errno, assume problem is no disk space */
+				if (errno == 0)
+					errno = ENOSPC;
+				msg = getErrorText(errno);
+				goto err;
+			}
+
+			old_break += rewriteVmBytesPerPage;
+			new_blkno++;
+		}
+	}
+
+	if (bytesRead < 0)
+		msg = getErrorText(errno);
+	else if (bytesRead != 0)
+		msg = "found partial page in source file";
+
+err:
+	pg_free(buffer);
+	pg_free(new_vmbuf);
+	close(dst_fd);
+	close(src_fd);
+
+	return msg;
+}
+
+
 #ifndef WIN32
 static int
 copy_file(const char *srcfile, const char *dstfile, bool force)
@@ -116,6 +116,13 @@ extern char *output_files[];
  */
 #define MULTIXACT_FORMATCHANGE_CAT_VER 201301231
 
+/*
+ * The visibility map got a second, all-frozen bit per heap page with this
+ * catalog version.  Visibility maps of older clusters have to be rewritten
+ * into the new format.
+ */
+#define VISIBILITY_MAP_FROZEN_BIT_CAT_VER 201306124
+
 /*
  * Each relation is represented by a relinfo structure.
  */
@@ -384,6 +391,7 @@ const char *copyAndUpdateFile(pageCnvCtx *pageConverter, const char *src,
 				  const char *dst, bool force);
 const char *linkAndUpdateFile(pageCnvCtx *pageConverter, const char *src,
 				  const char *dst);
+const char *rewriteVisibilityMap(const char *fromfile, const char *tofile);
 
 void		check_hard_link(void);
 FILE	   *fopen_priv(const char *path, const char *mode);
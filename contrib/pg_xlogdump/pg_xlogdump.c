@@ -365,13 +365,15 @@ XLogDumpDisplayRecord(XLogDumpConfig *config, XLogRecPtr ReadRecPtr, XLogRecord
 
 			memcpy(&bkpb, blk, sizeof(BkpBlock));
 			blk += sizeof(BkpBlock);
-			blk += BLCKSZ - bkpb.hole_length;
+			blk += bkpb.length;
 
-			printf("\tbackup bkp #%u; rel %u/%u/%u; fork: %s; block: %u; hole: offset: %u, length: %u\n",
+			printf("\tbackup bkp #%u; rel %u/%u/%u; fork: %s; block: %u; hole: offset: %u, length: %u; image length: %u%s\n",
 				   bkpnum,
 				   bkpb.node.spcNode, bkpb.node.dbNode, bkpb.node.relNode,
 				   forkNames[bkpb.fork],
-				   bkpb.block, bkpb.hole_offset, bkpb.hole_length);
+				   bkpb.block, bkpb.hole_offset, bkpb.hole_length,
+				   bkpb.length,
+				   (bkpb.bkp_info & BKPBLOCK_COMPRESSED) ? " (compressed)" : "");
 		}
 	}
 }
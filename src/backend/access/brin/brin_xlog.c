@@ -0,0 +1,326 @@
+/*
+ * brin_xlog.c
+ *		XLog replay routines for BRIN indexes
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/brin/brin_xlog.c
+ */
+#include "postgres.h"
+
+#include "access/brin_page.h"
+#include "access/brin_pageops.h"
+#include "access/brin_xlog.h"
+#include "access/xlogutils.h"
+
+
+/*
+ * xlog replay routines
+ */
+static void
+brin_xlog_createidx(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_brin_createidx *xlrec = (xl_brin_createidx *) XLogRecGetData(record);
+	Buffer		buf;
+	Page		page;
+
+	/* Backup blocks are not used in create_index records */
+	Assert(!(record->xl_info & XLR_BKP_BLOCK_MASK));
+
+	/* create the index' metapage */
+	buf = XLogReadBuffer(xlrec->node, BRIN_METAPAGE_BLKNO, true);
+	Assert(BufferIsValid(buf));
+	page = (Page) BufferGetPage(buf);
+	brin_metapage_init(page, xlrec->pagesPerRange, xlrec->version);
+	PageSetLSN(page, lsn);
+	MarkBufferDirty(buf);
+	UnlockReleaseBuffer(buf);
+}
+
+/*
+ * Common part of an insert or update. Inserts the new tuple and updates the
+ * revmap.
+ *
+ * Returns the index of the next backup block in the record, which is the old
+ * page in the case of an update.
+ */
+static int
+brin_xlog_insert_update(XLogRecPtr lsn, XLogRecord *record,
+						xl_brin_insert *xlrec, BrinTuple *tuple, Size tuplen)
+{
+	BlockNumber blkno;
+	Buffer		buffer;
+	Page		page;
+	int			bkpidx = 0;
+
+	blkno = ItemPointerGetBlockNumber(&xlrec->tid);
+
+	/*
+	 * If we inserted the first and only tuple on the page, re-initialize the
+	 * page from scratch.  Such a page is never backed up.
+	 */
+	if (record->xl_info & XLOG_BRIN_INIT_PAGE)
+	{
+		buffer = XLogReadBuffer(xlrec->node, blkno, true);
+		Assert(BufferIsValid(buffer));
+		page = (Page) BufferGetPage(buffer);
+		brin_page_init(page, BRIN_PAGETYPE_REGULAR);
+	}
+	else if (record->xl_info & XLR_BKP_BLOCK(bkpidx++))
+	{
+		(void) RestoreBackupBlock(lsn, record, 0, false, false);
+		buffer = InvalidBuffer;
+		page = NULL;
+	}
+	else
+	{
+		buffer = XLogReadBuffer(xlrec->node, blkno, false);
+		page = BufferIsValid(buffer) ? (Page) BufferGetPage(buffer) : NULL;
+		if (page && lsn <= PageGetLSN(page))
+		{
+			UnlockReleaseBuffer(buffer);
+			buffer = InvalidBuffer;
+		}
+	}
+
+	/* insert the index item into the page */
+	if (BufferIsValid(buffer))
+	{
+		OffsetNumber offnum;
+
+		Assert(tuple->bt_blkno == xlrec->heapBlk);
+
+		offnum = ItemPointerGetOffsetNumber(&(xlrec->tid));
+		if (PageGetMaxOffsetNumber(page) + 1 < offnum)
+			elog(PANIC, "brin_xlog_insert_update: invalid max offset number");
+
+		offnum = PageAddItem(page, (Item) tuple, tuplen, offnum, true, false);
+		if (offnum == InvalidOffsetNumber)
+			elog(PANIC, "brin_xlog_insert_update: failed to add tuple");
+
+		PageSetLSN(page, lsn);
+		MarkBufferDirty(buffer);
+		UnlockReleaseBuffer(buffer);
+	}
+
+	/* update the revmap */
+	if (record->xl_info & XLR_BKP_BLOCK(bkpidx))
+		(void) RestoreBackupBlock(lsn, record, bkpidx, false, false);
+	else
+	{
+		buffer = XLogReadBuffer(xlrec->node, xlrec->revmapBlk, false);
+		if (BufferIsValid(buffer))
+		{
+			page = (Page) BufferGetPage(buffer);
+
+			if (lsn > PageGetLSN(page))
+			{
+				brinSetHeapBlockItemptr(buffer, xlrec->pagesPerRange,
+										xlrec->heapBlk, xlrec->tid);
+				PageSetLSN(page, lsn);
+				MarkBufferDirty(buffer);
+			}
+			UnlockReleaseBuffer(buffer);
+		}
+	}
+
+	/* XXX no FSM updates here ... */
+
+	return bkpidx + 1;
+}
+
+/*
+ * replay a BRIN index insertion
+ */
+static void
+brin_xlog_insert(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_brin_insert *xlrec = (xl_brin_insert *) XLogRecGetData(record);
+	BrinTuple  *newtup;
+	Size		tuplen;
+
+	newtup = (BrinTuple *) ((char *) xlrec + SizeOfBrinInsert);
+	tuplen = record->xl_len - SizeOfBrinInsert;
+
+	(void) brin_xlog_insert_update(lsn, record, xlrec, newtup, tuplen);
+}
+
+/*
+ * replay a BRIN index update
+ */
+static void
+brin_xlog_update(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_brin_update *xlrec = (xl_brin_update *) XLogRecGetData(record);
+	BlockNumber blkno;
+	Buffer		buffer;
+	BrinTuple  *newtup;
+	Size		tuplen;
+	int			bkpidx;
+
+	tuplen = record->xl_len - SizeOfBrinUpdate;
+	newtup = (BrinTuple *) ((char *) xlrec + SizeOfBrinUpdate);
+
+	/* First insert the new tuple and update revmap, like in an insertion. */
+	bkpidx = brin_xlog_insert_update(lsn, record, &xlrec->insert,
+									 newtup, tuplen);
+
+	/* Then remove the old tuple */
+	if (record->xl_info & XLR_BKP_BLOCK(bkpidx))
+	{
+		(void) RestoreBackupBlock(lsn, record, bkpidx, false, false);
+		return;
+	}
+
+	blkno = ItemPointerGetBlockNumber(&(xlrec->oldtid));
+	buffer = XLogReadBuffer(xlrec->insert.node, blkno, false);
+	if (BufferIsValid(buffer))
+	{
+		Page		page = (Page) BufferGetPage(buffer);
+
+		if (lsn > PageGetLSN(page))
+		{
+			OffsetNumber offnum;
+
+			offnum = ItemPointerGetOffsetNumber(&(xlrec->oldtid));
+			if (PageGetMaxOffsetNumber(page) < offnum)
+				elog(PANIC, "brin_xlog_update: invalid max offset number");
+
+			brin_page_delete_item(page, offnum);
+
+			PageSetLSN(page, lsn);
+			MarkBufferDirty(buffer);
+		}
+		UnlockReleaseBuffer(buffer);
+	}
+}
+
+/*
+ * Update a tuple on a single page.
+ */
+static void
+brin_xlog_samepage_update(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_brin_samepage_update *xlrec;
+	BlockNumber blkno;
+	Buffer		buffer;
+
+	xlrec = (xl_brin_samepage_update *) XLogRecGetData(record);
+
+	if (record->xl_info & XLR_BKP_BLOCK(0))
+	{
+		(void) RestoreBackupBlock(lsn, record, 0, false, false);
+		return;
+	}
+
+	blkno = ItemPointerGetBlockNumber(&(xlrec->tid));
+	buffer = XLogReadBuffer(xlrec->node, blkno, false);
+	if (BufferIsValid(buffer))
+	{
+		Page		page = (Page) BufferGetPage(buffer);
+
+		if (lsn > PageGetLSN(page))
+		{
+			BrinTuple  *mmtuple;
+			Size		tuplen;
+			OffsetNumber offnum;
+
+			mmtuple = (BrinTuple *) ((char *) xlrec + SizeOfBrinSamepageUpdate);
+			tuplen = record->xl_len - SizeOfBrinSamepageUpdate;
+
+			offnum = ItemPointerGetOffsetNumber(&(xlrec->tid));
+			if (PageGetMaxOffsetNumber(page) < offnum)
+				elog(PANIC, "brin_xlog_samepage_update: invalid max offset number");
+
+			brin_page_replace_item(page, offnum, mmtuple, tuplen);
+
+			PageSetLSN(page, lsn);
+			MarkBufferDirty(buffer);
+		}
+		UnlockReleaseBuffer(buffer);
+	}
+
+	/* XXX no FSM updates here ... */
+}
+
+/*
+ * Replay a revmap page extension
+ */
+static void
+brin_xlog_revmap_extend(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_brin_revmap_extend *xlrec;
+	Buffer		metabuf;
+	Buffer		buf;
+	Page		page;
+
+	xlrec = (xl_brin_revmap_extend *) XLogRecGetData(record);
+
+	/* Update the metapage */
+	if (record->xl_info & XLR_BKP_BLOCK(0))
+		(void) RestoreBackupBlock(lsn, record, 0, false, false);
+	else
+	{
+		metabuf = XLogReadBuffer(xlrec->node, BRIN_METAPAGE_BLKNO, false);
+		if (BufferIsValid(metabuf))
+		{
+			Page		metapg = BufferGetPage(metabuf);
+
+			if (lsn > PageGetLSN(metapg))
+			{
+				BrinMetaPageData *metadata;
+
+				metadata = (BrinMetaPageData *) PageGetContents(metapg);
+
+				Assert(metadata->lastRevmapPage == xlrec->targetBlk - 1);
+				metadata->lastRevmapPage = xlrec->targetBlk;
+
+				PageSetLSN(metapg, lsn);
+				MarkBufferDirty(metabuf);
+			}
+			UnlockReleaseBuffer(metabuf);
+		}
+	}
+
+	/*
+	 * Re-init the target block as a revmap page.  There's never a full-page
+	 * image here.
+	 */
+	buf = XLogReadBuffer(xlrec->node, xlrec->targetBlk, true);
+	Assert(BufferIsValid(buf));
+	page = (Page) BufferGetPage(buf);
+	brin_page_init(page, BRIN_PAGETYPE_REVMAP);
+
+	PageSetLSN(page, lsn);
+	MarkBufferDirty(buf);
+	UnlockReleaseBuffer(buf);
+}
+
+void
+brin_redo(XLogRecPtr lsn, XLogRecord *record)
+{
+	uint8		info = record->xl_info & ~XLR_INFO_MASK;
+
+	switch (info & XLOG_BRIN_OPMASK)
+	{
+		case XLOG_BRIN_CREATE_INDEX:
+			brin_xlog_createidx(lsn, record);
+			break;
+		case XLOG_BRIN_INSERT:
+			brin_xlog_insert(lsn, record);
+			break;
+		case XLOG_BRIN_UPDATE:
+			brin_xlog_update(lsn, record);
+			break;
+		case XLOG_BRIN_SAMEPAGE_UPDATE:
+			brin_xlog_samepage_update(lsn, record);
+			break;
+		case XLOG_BRIN_REVMAP_EXTEND:
+			brin_xlog_revmap_extend(lsn, record);
+			break;
+		default:
+			elog(PANIC, "brin_redo: unknown op code %u", info);
+	}
+}
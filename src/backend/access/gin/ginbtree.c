@@ -394,7 +394,8 @@ ginInsertValue(GinBtree btree, GinBtreeStack *stack, GinStatsData *buildStats)
 
 				START_CRIT_SECTION();
 
-				GinInitBuffer(stack->buffer, GinPageGetOpaque(newlpage)->flags & ~GIN_LEAF);
+				GinInitBuffer(stack->buffer,
+				  GinPageGetOpaque(newlpage)->flags & ~(GIN_LEAF | GIN_COMPRESSED));
 				PageRestoreTempPage(newlpage, lpage);
 				btree->fillRoot(btree, stack->buffer, lbuffer, rbuffer);
 
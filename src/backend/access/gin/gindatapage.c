@@ -162,14 +162,21 @@ dataLocateItem(GinBtree btree, GinBtreeStack *stack)
  * Searches correct position for value on leaf page.
  * Page should be correctly chosen.
  * Returns true if value found on page.
+ *
+ * Items on a compressed leaf page are not addressable by offset, so stack->off
+ * is only meaningful as the insert position in the uncompressed array; the
+ * insertion code doesn't need it, it merges the new items into the page.
  */
 static bool
 dataLocateLeafItem(GinBtree btree, GinBtreeStack *stack)
 {
 	Page		page = BufferGetPage(stack->buffer);
-	OffsetNumber low,
+	ItemPointer items;
+	int			nitems;
+	int			low,
 				high;
 	int			result;
+	bool		found = false;
 
 	Assert(GinPageIsLeaf(page));
 	Assert(GinPageIsData(page));
@@ -180,27 +187,22 @@ dataLocateLeafItem(GinBtree btree, GinBtreeStack *stack)
 		return TRUE;
 	}
 
-	low = FirstOffsetNumber;
-	high = GinPageGetOpaque(page)->maxoff;
+	items = GinDataLeafPageGetItems(page, &nitems);
 
-	if (high < low)
-	{
-		stack->off = FirstOffsetNumber;
-		return false;
-	}
-
-	high++;
+	low = 0;
+	high = nitems;
 
 	while (high > low)
 	{
-		OffsetNumber mid = low + ((high - low) / 2);
+		int			mid = low + ((high - low) / 2);
 
-		result = ginCompareItemPointers(btree->items + btree->curitem, (ItemPointer) GinDataPageGetItem(page, mid));
+		result = ginCompareItemPointers(btree->items + btree->curitem, items + mid);
 
 		if (result == 0)
 		{
-			stack->off = mid;
-			return true;
+			low = mid;
+			found = true;
+			break;
 		}
 		else if (result > 0)
 			low = mid + 1;
@@ -208,8 +210,10 @@ dataLocateLeafItem(GinBtree btree, GinBtreeStack *stack)
 			high = mid;
 	}
 
-	stack->off = high;
-	return false;
+	stack->off = low + FirstOffsetNumber;
+	pfree(items);
+
+	return found;
 }
 
 /*
@@ -319,9 +323,239 @@ GinPageDeletePostingItem(Page page, OffsetNumber offset)
 	GinPageGetOpaque(page)->maxoff--;
 }
 
+/*
+ * Returns all item pointers on a leaf data page, as a palloc'd array.
+ * The number of items is returned in *nitems.
+ *
+ * Pages written before posting list compression was introduced hold a plain
+ * array of ItemPointerData; both formats are handled here.
+ */
+ItemPointer
+GinDataLeafPageGetItems(Page page, int *nitems)
+{
+	ItemPointer result;
+
+	Assert(GinPageIsData(page) && GinPageIsLeaf(page));
+
+	if (GinPageIsCompressed(page))
+	{
+		Size		len = GinDataLeafPageGetPostingListSize(page);
+
+		if (len > 0)
+			result = ginPostingListDecodeAllSegments(GinDataLeafPageGetPostingList(page),
+													 len, nitems);
+		else
+		{
+			result = palloc(sizeof(ItemPointerData));
+			*nitems = 0;
+		}
+	}
+	else
+	{
+		OffsetNumber maxoff = GinPageGetOpaque(page)->maxoff;
+
+		result = palloc((maxoff + 1) * sizeof(ItemPointerData));
+		memcpy(result, GinDataPageGetItem(page, FirstOffsetNumber),
+			   maxoff * sizeof(ItemPointerData));
+		*nitems = maxoff;
+	}
+
+	return result;
+}
+
+/*
+ * Encodes a sorted array of items as a sequence of posting list segments at
+ * 'dst', using at most 'maxsize' bytes.  Returns the number of items that
+ * fit, and the number of bytes used in *size.
+ */
+static uint32
+dataEncodeSegments(ItemPointerData *items, uint32 nitems,
+				   char *dst, Size maxsize, Size *size)
+{
+	char	   *ptr = dst;
+	uint32		nencoded = 0;
+
+	while (nencoded < nitems)
+	{
+		Size		room = SHORTALIGN_DOWN(maxsize - (ptr - dst));
+		GinPostingList *segment;
+		int			npacked;
+		Size		segsize;
+
+		if (room <= offsetof(GinPostingList, bytes))
+			break;
+
+		segment = ginCompressPostingList(items + nencoded, nitems - nencoded,
+									Min(room, GinPostingListSegmentMaxSize),
+										 &npacked);
+		segsize = SizeOfGinPostingList(segment);
+		memcpy(ptr, segment, segsize);
+		pfree(segment);
+
+		ptr += segsize;
+		nencoded += npacked;
+	}
+
+	*size = ptr - dst;
+	return nencoded;
+}
+
+/*
+ * Computes the new content of a leaf data page after merging 'newitems'
+ * into it, and stores it at 'dst'.  Returns false if the result doesn't fit
+ * on the page.
+ *
+ * Segments that lie entirely before the first new item are copied verbatim;
+ * everything from the segment the first new item falls into onwards is
+ * decoded, merged with the new items and re-encoded.  An uncompressed page
+ * is converted as a whole.  The result depends only on the old page content
+ * and the new items, so WAL replay reaches the same page image by calling
+ * this again.
+ */
+static bool
+dataLeafMergeItems(Page page, ItemPointerData *newitems, uint32 nnew,
+				   char *dst, Size *size)
+{
+	ItemPointer olditems;
+	int			nolditems;
+	ItemPointer merged;
+	uint32		nmerged;
+	Size		copied = 0;
+	Size		encoded;
+	bool		result;
+
+	if (GinPageIsCompressed(page))
+	{
+		GinPostingList *first = GinDataLeafPageGetPostingList(page);
+		GinPostingList *seg = first;
+		char	   *endseg = ((char *) first) + GinDataLeafPageGetPostingListSize(page);
+
+		/* skip over the segments the new items don't affect */
+		while ((char *) seg < endseg)
+		{
+			GinPostingList *next = GinNextPostingListSegment(seg);
+
+			if ((char *) next >= endseg ||
+				ginCompareItemPointers(&next->first, newitems) > 0)
+				break;
+			seg = next;
+		}
+
+		copied = ((char *) seg) - ((char *) first);
+		memcpy(dst, first, copied);
+
+		if ((char *) seg < endseg)
+			olditems = ginPostingListDecodeAllSegments(seg, endseg - (char *) seg,
+													   &nolditems);
+		else
+		{
+			olditems = NULL;
+			nolditems = 0;
+		}
+	}
+	else
+	{
+		olditems = (ItemPointer) GinDataPageGetItem(page, FirstOffsetNumber);
+		nolditems = GinPageGetOpaque(page)->maxoff;
+	}
+
+	merged = palloc((nolditems + nnew) * sizeof(ItemPointerData));
+	nmerged = ginMergeItemPointers(merged, olditems, nolditems, newitems, nnew);
+
+	result = (dataEncodeSegments(merged, nmerged, dst + copied,
+								 GinDataLeafMaxContentSize - copied,
+								 &encoded) == nmerged);
+	*size = copied + encoded;
+
+	pfree(merged);
+	if (olditems && GinPageIsCompressed(page))
+		pfree(olditems);
+
+	return result;
+}
+
+/*
+ * Returns the number of items, starting at btree->curitem, that belong on
+ * the given leaf page, ie. don't exceed its right bound.
+ */
+static uint32
+dataLeafCountNewItems(GinBtree btree, Page page)
+{
+	uint32		nnew = btree->nitem - btree->curitem;
+
+	/* more than this can't possibly fit, don't waste effort on them */
+	if (nnew > GinDataLeafMaxContentSize)
+		nnew = GinDataLeafMaxContentSize;
+
+	if (!GinPageRightMost(page))
+	{
+		ItemPointer bound = GinDataPageGetRightBound(page);
+		uint32		i;
+
+		for (i = 0; i < nnew; i++)
+		{
+			if (ginCompareItemPointers(btree->items + btree->curitem + i, bound) > 0)
+				break;
+		}
+		nnew = i;
+	}
+
+	Assert(nnew > 0);
+	return nnew;
+}
+
+/*
+ * Merges items into a leaf data page, compressing it if it was in the old
+ * format.  Returns false, leaving the page untouched, if they don't fit.
+ * Used by WAL replay.
+ */
+bool
+ginDataLeafPageAddItems(Page page, ItemPointerData *items, uint32 nitems)
+{
+	char		buf[BLCKSZ];
+	Size		size;
+
+	if (!dataLeafMergeItems(page, items, nitems, buf, &size))
+		return false;
+
+	memcpy(GinDataLeafPageGetPostingList(page), buf, size);
+	GinPageSetCompressed(page);
+	GinDataLeafPageSetPostingListSize(page, size);
+	GinPageGetOpaque(page)->maxoff = InvalidOffsetNumber;
+
+	return true;
+}
+
+/*
+ * Replaces the content of a leaf data page with the given sorted items,
+ * compressed.  Returns the number of items that fit on the page; the caller
+ * must deal with the rest.
+ */
+uint32
+ginDataLeafPageEncode(Page page, ItemPointerData *items, uint32 nitems)
+{
+	char		buf[BLCKSZ];
+	Size		size;
+	uint32		nencoded;
+
+	nencoded = dataEncodeSegments(items, nitems, buf,
+								  GinDataLeafMaxContentSize, &size);
+
+	memcpy(GinDataLeafPageGetPostingList(page), buf, size);
+	GinPageSetCompressed(page);
+	GinDataLeafPageSetPostingListSize(page, size);
+	GinPageGetOpaque(page)->maxoff = InvalidOffsetNumber;
+
+	return nencoded;
+}
+
 /*
  * checks space to install new value,
  * item pointer never deletes!
+ *
+ * On a leaf page, the new page content is computed here and remembered in
+ * btree->leafData, so that placeToPage can install it without redoing the
+ * work inside the critical section.
  */
 static bool
 dataIsEnoughSpace(GinBtree btree, Buffer buf, OffsetNumber off)
@@ -333,12 +567,14 @@ dataIsEnoughSpace(GinBtree btree, Buffer buf, OffsetNumber off)
 
 	if (GinPageIsLeaf(page))
 	{
-		if (GinPageRightMost(page) && off > GinPageGetOpaque(page)->maxoff)
-		{
-			if ((btree->nitem - btree->curitem) * sizeof(ItemPointerData) <= GinDataPageGetFreeSpace(page))
-				return true;
-		}
-		else if (sizeof(ItemPointerData) <= GinDataPageGetFreeSpace(page))
+		if (btree->leafData == NULL)
+			btree->leafData = palloc(BLCKSZ);
+
+		btree->leafNewItems = dataLeafCountNewItems(btree, page);
+
+		if (dataLeafMergeItems(page, btree->items + btree->curitem,
+							   btree->leafNewItems,
+							   btree->leafData, &btree->leafDataSize))
 			return true;
 	}
 	else if (sizeof(PostingItem) <= GinDataPageGetFreeSpace(page))
@@ -373,8 +609,8 @@ dataPrepareData(GinBtree btree, Page page, OffsetNumber off)
 }
 
 /*
- * Places keys to page and fills WAL record. In case leaf page and
- * build mode puts all ItemPointers to page.
+ * Places keys to page and fills WAL record. On a leaf page, installs the
+ * content prepared by dataIsEnoughSpace.
  */
 static void
 dataPlaceToPage(GinBtree btree, Buffer buf, OffsetNumber off, XLogRecData **prdata)
@@ -405,7 +641,7 @@ dataPlaceToPage(GinBtree btree, Buffer buf, OffsetNumber off, XLogRecData **prda
 	 * the buffer reference in a separate XLogRecData entry.
 	 */
 	rdata[0].buffer = buf;
-	rdata[0].buffer_std = FALSE;
+	rdata[0].buffer_std = GinPageIsLeaf(page) ? TRUE : FALSE;
 	rdata[0].data = NULL;
 	rdata[0].len = 0;
 	rdata[0].next = &rdata[1];
@@ -422,38 +658,171 @@ dataPlaceToPage(GinBtree btree, Buffer buf, OffsetNumber off, XLogRecData **prda
 
 	if (GinPageIsLeaf(page))
 	{
-		if (GinPageRightMost(page) && off > GinPageGetOpaque(page)->maxoff)
-		{
-			/* usually, create index... */
-			uint32		savedPos = btree->curitem;
+		/*
+		 * Only the new items are logged; replay merges them into the page
+		 * the same way.  A compressed page has a valid pd_lower, so a full
+		 * page image can leave out the unused space.
+		 */
+		memcpy(GinDataLeafPageGetPostingList(page), btree->leafData,
+			   btree->leafDataSize);
+		GinPageSetCompressed(page);
+		GinDataLeafPageSetPostingListSize(page, btree->leafDataSize);
+		GinPageGetOpaque(page)->maxoff = InvalidOffsetNumber;
+
+		data.nitem = btree->leafNewItems;
+		rdata[2].len = sizeof(ItemPointerData) * data.nitem;
+		btree->curitem += btree->leafNewItems;
+	}
+	else
+		GinDataPageAddItem(page, &(btree->pitem), off);
+}
+
+/*
+ * Splits a leaf data page.  All items of the page plus the new ones are
+ * re-encoded and divided between the two halves at a segment boundary.
+ * Normally each page gets about half of the data; when appending to the
+ * rightmost page, which is what happens during index build, the left page
+ * is filled up instead, as later insertions will go to the right page.
+ */
+static Page
+dataSplitPageLeaf(GinBtree btree, Buffer lbuf, Buffer rbuf, XLogRecData **prdata)
+{
+	Page		oldpage = BufferGetPage(lbuf);
+	Page		lpage;
+	Page		rpage = BufferGetPage(rbuf);
+	ItemPointerData oldbound = *GinDataPageGetRightBound(oldpage);
+	uint32		flags = GinPageGetOpaque(oldpage)->flags | GIN_COMPRESSED;
+	ItemPointer olditems;
+	int			nolditems;
+	ItemPointer newitems = btree->items + btree->curitem;
+	uint32		nnew;
+	ItemPointer allitems;
+	uint32		nall;
+	Size		totalsize;
+	Size		lsize;
+	GinPostingList *lastleft;
+	ItemPointer leftitems;
+	int			nleftitems;
+
+	/* these must be static so they can be returned to caller */
+	static ginxlogSplit data;
+	static XLogRecData rdata[2];
+	static char vector[2 * BLCKSZ];
+
+	*prdata = rdata;
+
+	olditems = GinDataLeafPageGetItems(oldpage, &nolditems);
+	nnew = dataLeafCountNewItems(btree, oldpage);
+	allitems = palloc((nolditems + nnew) * sizeof(ItemPointerData));
 
-			while (btree->curitem < btree->nitem)
+	/*
+	 * Try to split with all the new items; if they don't fit on two pages,
+	 * retry with fewer. The rest will be inserted by our caller later.
+	 */
+	for (;;)
+	{
+		bool		fillLeft;
+		char	   *endseg;
+		GinPostingList *seg;
+
+		fillLeft = GinPageRightMost(oldpage) &&
+			(btree->isBuild || nolditems == 0 ||
+			 ginCompareItemPointers(newitems, olditems + nolditems - 1) > 0);
+
+		nall = ginMergeItemPointers(allitems, olditems, nolditems, newitems, nnew);
+
+		if (dataEncodeSegments(allitems, nall, vector,
+							   2 * GinDataLeafMaxContentSize,
+							   &totalsize) == nall)
+		{
+			/* choose the split point */
+			endseg = vector + totalsize;
+			seg = (GinPostingList *) vector;
+			lastleft = NULL;
+			lsize = 0;
+			while ((char *) seg < endseg)
 			{
-				GinDataPageAddItem(page, btree->items + btree->curitem, off);
-				off++;
-				btree->curitem++;
+				Size		segsize = SizeOfGinPostingList(seg);
+
+				if (lsize > 0 &&
+					(lsize + segsize > GinDataLeafMaxContentSize ||
+					 (!fillLeft && lsize >= totalsize / 2) ||
+					 lsize + segsize == totalsize))
+					break;
+				lsize += segsize;
+				lastleft = seg;
+				seg = GinNextPostingListSegment(seg);
 			}
-			data.nitem = btree->curitem - savedPos;
-			rdata[2].len = sizeofitem * data.nitem;
-		}
-		else
-		{
-			GinDataPageAddItem(page, btree->items + btree->curitem, off);
-			btree->curitem++;
+
+			if (lsize < totalsize &&
+				totalsize - lsize <= GinDataLeafMaxContentSize)
+				break;
 		}
+
+		if (nnew == 1)
+			elog(ERROR, "could not split GIN leaf data page");
+		nnew /= 2;
 	}
-	else
-		GinDataPageAddItem(page, &(btree->pitem), off);
+
+	btree->curitem += nnew;
+
+	lpage = PageGetTempPage(oldpage);
+	GinInitPage(lpage, flags, BufferGetPageSize(lbuf));
+	GinInitPage(rpage, flags, BufferGetPageSize(rbuf));
+
+	memcpy(GinDataLeafPageGetPostingList(lpage), vector, lsize);
+	GinDataLeafPageSetPostingListSize(lpage, lsize);
+	memcpy(GinDataLeafPageGetPostingList(rpage), vector + lsize, totalsize - lsize);
+	GinDataLeafPageSetPostingListSize(rpage, totalsize - lsize);
+
+	/* the last item on the left page becomes its right bound */
+	leftitems = ginPostingListDecode(lastleft, &nleftitems);
+	btree->pitem.key = leftitems[nleftitems - 1];
+	pfree(leftitems);
+
+	PostingItemSetBlockNumber(&(btree->pitem), BufferGetBlockNumber(lbuf));
+	btree->rightblkno = BufferGetBlockNumber(rbuf);
+
+	*GinDataPageGetRightBound(lpage) = btree->pitem.key;
+	*GinDataPageGetRightBound(rpage) = oldbound;
+
+	pfree(olditems);
+	pfree(allitems);
+
+	data.node = btree->index->rd_node;
+	data.rootBlkno = InvalidBlockNumber;
+	data.lblkno = BufferGetBlockNumber(lbuf);
+	data.rblkno = BufferGetBlockNumber(rbuf);
+	data.separator = 0;
+	data.nitem = 0;
+	data.isData = TRUE;
+	data.isLeaf = TRUE;
+	data.isRootSplit = FALSE;
+	data.leftChildBlkno = InvalidBlockNumber;
+	data.updateBlkno = InvalidBlockNumber;
+	data.rightbound = oldbound;
+	data.lsize = lsize;
+	data.rsize = totalsize - lsize;
+
+	rdata[0].buffer = InvalidBuffer;
+	rdata[0].data = (char *) &data;
+	rdata[0].len = sizeof(ginxlogSplit);
+	rdata[0].next = &rdata[1];
+
+	rdata[1].buffer = InvalidBuffer;
+	rdata[1].data = vector;
+	rdata[1].len = totalsize;
+	rdata[1].next = NULL;
+
+	return lpage;
 }
 
 /*
- * split page and fills WAL record. original buffer(lbuf) leaves untouched,
- * returns shadow page of lbuf filled new data. In leaf page and build mode puts all
- * ItemPointers to pages. Also, in build mode splits data by way to full fulled
- * left page
+ * Splits an internal data page. In build mode splits data by way to full
+ * fulled left page
  */
 static Page
-dataSplitPage(GinBtree btree, Buffer lbuf, Buffer rbuf, OffsetNumber off, XLogRecData **prdata)
+dataSplitPageInternal(GinBtree btree, Buffer lbuf, Buffer rbuf, OffsetNumber off, XLogRecData **prdata)
 {
 	char	   *ptr;
 	OffsetNumber separator;
@@ -465,7 +834,6 @@ dataSplitPage(GinBtree btree, Buffer lbuf, Buffer rbuf, OffsetNumber off, XLogRe
 	Page		rpage = BufferGetPage(rbuf);
 	Size		pageSize = PageGetPageSize(lpage);
 	Size		freeSpace;
-	uint32		nCopied = 1;
 
 	/* these must be static so they can be returned to caller */
 	static ginxlogSplit data;
@@ -476,42 +844,18 @@ dataSplitPage(GinBtree btree, Buffer lbuf, Buffer rbuf, OffsetNumber off, XLogRe
 	freeSpace = GinDataPageGetFreeSpace(rpage);
 
 	*prdata = rdata;
-	data.leftChildBlkno = (GinPageIsLeaf(lpage)) ?
-		InvalidOffsetNumber : PostingItemGetBlockNumber(&(btree->pitem));
+	data.leftChildBlkno = PostingItemGetBlockNumber(&(btree->pitem));
 	data.updateBlkno = dataPrepareData(btree, lpage, off);
 
 	memcpy(vector, GinDataPageGetItem(lpage, FirstOffsetNumber),
 		   maxoff * sizeofitem);
 
-	if (GinPageIsLeaf(lpage) && GinPageRightMost(lpage) && off > GinPageGetOpaque(lpage)->maxoff)
-	{
-		nCopied = 0;
-		while (btree->curitem < btree->nitem &&
-			   maxoff * sizeof(ItemPointerData) < 2 * (freeSpace - sizeof(ItemPointerData)))
-		{
-			memcpy(vector + maxoff * sizeof(ItemPointerData),
-				   btree->items + btree->curitem,
-				   sizeof(ItemPointerData));
-			maxoff++;
-			nCopied++;
-			btree->curitem++;
-		}
-	}
-	else
-	{
-		ptr = vector + (off - 1) * sizeofitem;
-		if (maxoff + 1 - off != 0)
-			memmove(ptr + sizeofitem, ptr, (maxoff - off + 1) * sizeofitem);
-		if (GinPageIsLeaf(lpage))
-		{
-			memcpy(ptr, btree->items + btree->curitem, sizeofitem);
-			btree->curitem++;
-		}
-		else
-			memcpy(ptr, &(btree->pitem), sizeofitem);
+	ptr = vector + (off - 1) * sizeofitem;
+	if (maxoff + 1 - off != 0)
+		memmove(ptr + sizeofitem, ptr, (maxoff - off + 1) * sizeofitem);
+	memcpy(ptr, &(btree->pitem), sizeofitem);
 
-		maxoff++;
-	}
+	maxoff++;
 
 	/*
 	 * we suppose that during index creation table scaned from begin to end,
@@ -532,11 +876,7 @@ dataSplitPage(GinBtree btree, Buffer lbuf, Buffer rbuf, OffsetNumber off, XLogRe
 	GinPageGetOpaque(rpage)->maxoff = maxoff - separator;
 
 	PostingItemSetBlockNumber(&(btree->pitem), BufferGetBlockNumber(lbuf));
-	if (GinPageIsLeaf(lpage))
-		btree->pitem.key = *(ItemPointerData *) GinDataPageGetItem(lpage,
-											GinPageGetOpaque(lpage)->maxoff);
-	else
-		btree->pitem.key = ((PostingItem *) GinDataPageGetItem(lpage,
+	btree->pitem.key = ((PostingItem *) GinDataPageGetItem(lpage,
 									  GinPageGetOpaque(lpage)->maxoff))->key;
 	btree->rightblkno = BufferGetBlockNumber(rbuf);
 
@@ -555,9 +895,11 @@ dataSplitPage(GinBtree btree, Buffer lbuf, Buffer rbuf, OffsetNumber off, XLogRe
 	data.separator = separator;
 	data.nitem = maxoff;
 	data.isData = TRUE;
-	data.isLeaf = GinPageIsLeaf(lpage) ? TRUE : FALSE;
+	data.isLeaf = FALSE;
 	data.isRootSplit = FALSE;
 	data.rightbound = oldbound;
+	data.lsize = 0;
+	data.rsize = 0;
 
 	rdata[0].buffer = InvalidBuffer;
 	rdata[0].data = (char *) &data;
@@ -572,6 +914,19 @@ dataSplitPage(GinBtree btree, Buffer lbuf, Buffer rbuf, OffsetNumber off, XLogRe
 	return lpage;
 }
 
+/*
+ * split page and fills WAL record. original buffer(lbuf) leaves untouched,
+ * returns shadow page of lbuf filled new data.
+ */
+static Page
+dataSplitPage(GinBtree btree, Buffer lbuf, Buffer rbuf, OffsetNumber off, XLogRecData **prdata)
+{
+	if (GinPageIsLeaf(BufferGetPage(lbuf)))
+		return dataSplitPageLeaf(btree, lbuf, rbuf, prdata);
+	else
+		return dataSplitPageInternal(btree, lbuf, rbuf, off, prdata);
+}
+
 /*
  * Fills new root by right bound values from child.
  * Also called from ginxlog, should not use btree
@@ -654,20 +1009,20 @@ ginInsertItemPointers(GinPostingTreeScan *gdi,
 
 		gdi->stack = ginFindLeafPage(&gdi->btree, gdi->stack);
 
-		if (gdi->btree.findItem(&(gdi->btree), gdi->stack))
-		{
-			/*
-			 * gdi->btree.items[gdi->btree.curitem] already exists in index
-			 */
-			gdi->btree.curitem++;
-			LockBuffer(gdi->stack->buffer, GIN_UNLOCK);
-			freeGinBtreeStack(gdi->stack);
-		}
-		else
-			ginInsertValue(&(gdi->btree), gdi->stack, buildStats);
+		/*
+		 * No need to check for items that already exist in the index, they
+		 * are eliminated when merging the new items into the leaf page.
+		 */
+		ginInsertValue(&(gdi->btree), gdi->stack, buildStats);
 
 		gdi->stack = NULL;
 	}
+
+	if (gdi->btree.leafData)
+	{
+		pfree(gdi->btree.leafData);
+		gdi->btree.leafData = NULL;
+	}
 }
 
 Buffer
@@ -66,30 +66,33 @@ callConsistentFn(GinState *ginstate, GinScanKey key)
 }
 
 /*
- * Tries to refind previously taken ItemPointer on a posting page.
+ * Tries to refind previously taken ItemPointer in the items of a posting
+ * page.  *off is set to the 1-based position of the first item equal to or
+ * greater than the given one.
  */
 static bool
-findItemInPostingPage(Page page, ItemPointer item, OffsetNumber *off)
+findItemInPostingList(ItemPointer items, uint32 nitems, ItemPointer item,
+					  OffsetNumber *off)
 {
-	OffsetNumber maxoff = GinPageGetOpaque(page)->maxoff;
-	int			res;
-
-	if (GinPageGetOpaque(page)->flags & GIN_DELETED)
-		/* page was deleted by concurrent vacuum */
-		return false;
+	uint32		low = 0,
+				high = nitems;
 
 	/*
-	 * scan page to find equal or first greater value
+	 * binary search for equal or first greater value
 	 */
-	for (*off = FirstOffsetNumber; *off <= maxoff; (*off)++)
+	while (high > low)
 	{
-		res = ginCompareItemPointers(item, (ItemPointer) GinDataPageGetItem(page, *off));
+		uint32		mid = low + ((high - low) / 2);
 
-		if (res <= 0)
-			return true;
+		if (ginCompareItemPointers(item, items + mid) > 0)
+			low = mid + 1;
+		else
+			high = mid;
 	}
 
-	return false;
+	*off = low + FirstOffsetNumber;
+
+	return low < nitems;
 }
 
 /*
@@ -145,12 +148,15 @@ scanPostingTree(Relation index, GinScanEntry scanEntry,
 		page = BufferGetPage(buffer);
 
 		if ((GinPageGetOpaque(page)->flags & GIN_DELETED) == 0 &&
-			GinPageGetOpaque(page)->maxoff >= FirstOffsetNumber)
+			!GinDataLeafPageIsEmpty(page))
 		{
-			tbm_add_tuples(scanEntry->matchBitmap,
-				   (ItemPointer) GinDataPageGetItem(page, FirstOffsetNumber),
-						   GinPageGetOpaque(page)->maxoff, false);
-			scanEntry->predictNumberResult += GinPageGetOpaque(page)->maxoff;
+			ItemPointer items;
+			int			nitems;
+
+			items = GinDataLeafPageGetItems(page, &nitems);
+			tbm_add_tuples(scanEntry->matchBitmap, items, nitems, false);
+			scanEntry->predictNumberResult += nitems;
+			pfree(items);
 		}
 
 		if (GinPageRightMost(page))
@@ -335,9 +341,14 @@ collectMatchBitmap(GinBtreeData *btree, GinBtreeStack *stack,
 		}
 		else
 		{
-			tbm_add_tuples(scanEntry->matchBitmap,
-						   GinGetPosting(itup), GinGetNPosting(itup), false);
-			scanEntry->predictNumberResult += GinGetNPosting(itup);
+			ItemPointer items;
+			int			nitems;
+
+			items = ginReadTuple(btree->ginstate, scanEntry->attnum, itup,
+								 &nitems);
+			tbm_add_tuples(scanEntry->matchBitmap, items, nitems, false);
+			scanEntry->predictNumberResult += nitems;
+			pfree(items);
 		}
 
 		/*
@@ -357,6 +368,7 @@ startScanEntry(GinState *ginstate, GinScanEntry entry)
 	GinBtreeStack *stackEntry;
 	Page		page;
 	bool		needUnlock;
+	int			nlist;
 
 restartScanEntry:
 	entry->buffer = InvalidBuffer;
@@ -451,15 +463,13 @@ restartScanEntry:
 			IncrBufferRefCount(entry->buffer);
 
 			page = BufferGetPage(entry->buffer);
-			entry->predictNumberResult = gdi->stack->predictNumber * GinPageGetOpaque(page)->maxoff;
 
 			/*
 			 * Keep page content in memory to prevent durable page locking
 			 */
-			entry->list = (ItemPointerData *) palloc(BLCKSZ);
-			entry->nlist = GinPageGetOpaque(page)->maxoff;
-			memcpy(entry->list, GinDataPageGetItem(page, FirstOffsetNumber),
-				   GinPageGetOpaque(page)->maxoff * sizeof(ItemPointerData));
+			entry->list = GinDataLeafPageGetItems(page, &nlist);
+			entry->nlist = nlist;
+			entry->predictNumberResult = gdi->stack->predictNumber * entry->nlist;
 
 			LockBuffer(entry->buffer, GIN_UNLOCK);
 			freeGinBtreeStack(gdi->stack);
@@ -468,9 +478,8 @@ restartScanEntry:
 		}
 		else if (GinGetNPosting(itup) > 0)
 		{
-			entry->nlist = GinGetNPosting(itup);
-			entry->list = (ItemPointerData *) palloc(sizeof(ItemPointerData) * entry->nlist);
-			memcpy(entry->list, GinGetPosting(itup), sizeof(ItemPointerData) * entry->nlist);
+			entry->list = ginReadTuple(ginstate, entry->attnum, itup, &nlist);
+			entry->nlist = nlist;
 			entry->isFinished = FALSE;
 		}
 	}
@@ -533,6 +542,7 @@ static void
 entryGetNextItem(GinState *ginstate, GinScanEntry entry)
 {
 	Page		page;
+	int			nlist;
 
 	for (;;)
 	{
@@ -565,16 +575,23 @@ entryGetNextItem(GinState *ginstate, GinScanEntry entry)
 			page = BufferGetPage(entry->buffer);
 
 			entry->offset = InvalidOffsetNumber;
+			entry->nlist = 0;
+
+			if (GinPageGetOpaque(page)->flags & GIN_DELETED)
+				continue;		/* page was deleted by concurrent vacuum */
+
+			if (entry->list)
+				pfree(entry->list);
+			entry->list = GinDataLeafPageGetItems(page, &nlist);
+			entry->nlist = nlist;
+
 			if (!ItemPointerIsValid(&entry->curItem) ||
-				findItemInPostingPage(page, &entry->curItem, &entry->offset))
+				findItemInPostingList(entry->list, entry->nlist,
+									  &entry->curItem, &entry->offset))
 			{
 				/*
 				 * Found position equal to or greater than stored
 				 */
-				entry->nlist = GinPageGetOpaque(page)->maxoff;
-				memcpy(entry->list, GinDataPageGetItem(page, FirstOffsetNumber),
-				   GinPageGetOpaque(page)->maxoff * sizeof(ItemPointerData));
-
 				LockBuffer(entry->buffer, GIN_UNLOCK);
 
 				if (!ItemPointerIsValid(&entry->curItem) ||
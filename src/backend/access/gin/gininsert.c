@@ -36,30 +36,39 @@ typedef struct
 } GinBuildState;
 
 /*
- * Creates new posting tree with one page, containing the given TIDs.
- * Returns the page number (which will be the root of this posting tree).
+ * Creates new posting tree containing the given TIDs. Returns the page
+ * number of the root of the new posting tree.
+ *
+ * The root page is filled with as many TIDs as fit on it, compressed, and
+ * the rest are inserted into the tree normally.
  *
  * items[] must be in sorted order with no duplicates.
  */
 static BlockNumber
-createPostingTree(Relation index, ItemPointerData *items, uint32 nitems)
+createPostingTree(Relation index, ItemPointerData *items, uint32 nitems,
+				  GinStatsData *buildStats)
 {
 	BlockNumber blkno;
-	Buffer		buffer = GinNewBuffer(index);
+	Buffer		buffer;
+	Page		tmppage;
 	Page		page;
+	uint32		nrootitems;
+	Size		rootsize;
 
-	/* Assert that the items[] array will fit on one page */
-	Assert(nitems <= GinMaxLeafDataItems);
-
-	START_CRIT_SECTION();
+	/* Construct the new root page in memory first. */
+	tmppage = (Page) palloc(BLCKSZ);
+	GinInitPage(tmppage, GIN_DATA | GIN_LEAF | GIN_COMPRESSED, BLCKSZ);
+	nrootitems = ginDataLeafPageEncode(tmppage, items, nitems);
+	rootsize = GinDataLeafPageGetPostingListSize(tmppage);
 
-	GinInitBuffer(buffer, GIN_DATA | GIN_LEAF);
+	/* Now allocate a buffer and copy the page into it */
+	buffer = GinNewBuffer(index);
 	page = BufferGetPage(buffer);
 	blkno = BufferGetBlockNumber(buffer);
 
-	memcpy(GinDataPageGetData(page), items, sizeof(ItemPointerData) * nitems);
-	GinPageGetOpaque(page)->maxoff = nitems;
+	START_CRIT_SECTION();
 
+	PageRestoreTempPage(tmppage, page);
 	MarkBufferDirty(buffer);
 
 	if (RelationNeedsWAL(index))
@@ -70,7 +79,7 @@ createPostingTree(Relation index, ItemPointerData *items, uint32 nitems)
 
 		data.node = index->rd_node;
 		data.blkno = blkno;
-		data.nitem = nitems;
+		data.size = rootsize;
 
 		rdata[0].buffer = InvalidBuffer;
 		rdata[0].data = (char *) &data;
@@ -78,8 +87,8 @@ createPostingTree(Relation index, ItemPointerData *items, uint32 nitems)
 		rdata[0].next = &rdata[1];
 
 		rdata[1].buffer = InvalidBuffer;
-		rdata[1].data = (char *) items;
-		rdata[1].len = sizeof(ItemPointerData) * nitems;
+		rdata[1].data = (char *) GinDataLeafPageGetPostingList(page);
+		rdata[1].len = rootsize;
 		rdata[1].next = NULL;
 
 		recptr = XLogInsert(RM_GIN_ID, XLOG_GIN_CREATE_PTREE, rdata);
@@ -90,6 +99,26 @@ createPostingTree(Relation index, ItemPointerData *items, uint32 nitems)
 
 	END_CRIT_SECTION();
 
+	/* During index build, count the newly-added data page */
+	if (buildStats)
+		buildStats->nDataPages++;
+
+	/* Add any remaining TIDs to the newly-created posting tree. */
+	if (nitems > nrootitems)
+	{
+		GinPostingTreeScan *gdi;
+
+		gdi = ginPrepareScanPostingTree(index, blkno, FALSE);
+		gdi->btree.isBuild = (buildStats != NULL);
+
+		ginInsertItemPointers(gdi,
+							  items + nrootitems,
+							  nitems - nrootitems,
+							  buildStats);
+
+		pfree(gdi);
+	}
+
 	return blkno;
 }
 
@@ -111,31 +140,40 @@ addItemPointersToLeafTuple(GinState *ginstate,
 	Datum		key;
 	GinNullCategory category;
 	IndexTuple	res;
+	ItemPointerData *newItems,
+			   *oldItems;
+	int			oldNPosting,
+				newNPosting,
+				nwritten;
+	GinPostingList *compressedList;
 
 	Assert(!GinIsPostingTree(old));
 
 	attnum = gintuple_get_attrnum(ginstate, old);
 	key = gintuple_get_key(ginstate, old, &category);
 
-	/* try to build tuple with room for all the items */
-	res = GinFormTuple(ginstate, attnum, key, category,
-					   NULL, nitem + GinGetNPosting(old),
-					   false);
+	/* merge the old and new posting lists */
+	oldItems = ginReadTuple(ginstate, attnum, old, &oldNPosting);
 
-	if (res)
+	newItems = (ItemPointerData *) palloc((oldNPosting + nitem) * sizeof(ItemPointerData));
+	newNPosting = ginMergeItemPointers(newItems, oldItems, oldNPosting,
+									   items, nitem);
+
+	/* Compress the posting list, and try to build a tuple with room for it */
+	res = NULL;
+	compressedList = ginCompressPostingList(newItems, newNPosting, GinMaxItemSize,
+											&nwritten);
+	pfree(newItems);
+	if (nwritten == newNPosting)
 	{
-		/* good, small enough */
-		uint32		newnitem;
-
-		/* fill in the posting list with union of old and new TIDs */
-		newnitem = ginMergeItemPointers(GinGetPosting(res),
-										GinGetPosting(old),
-										GinGetNPosting(old),
-										items, nitem);
-		/* merge might have eliminated some duplicate items */
-		GinShortenTuple(res, newnitem);
+		res = GinFormTuple(ginstate, attnum, key, category,
+						   (char *) compressedList,
+						   SizeOfGinPostingList(compressedList),
+						   newNPosting,
+						   false);
 	}
-	else
+	pfree(compressedList);
+	if (!res)
 	{
 		/* posting list would be too big, convert to posting tree */
 		BlockNumber postingRoot;
@@ -147,12 +185,9 @@ addItemPointersToLeafTuple(GinState *ginstate,
 		 * already be in order with no duplicates.
 		 */
 		postingRoot = createPostingTree(ginstate->index,
-										GinGetPosting(old),
-										GinGetNPosting(old));
-
-		/* During index build, count the newly-added data page */
-		if (buildStats)
-			buildStats->nDataPages++;
+										oldItems,
+										oldNPosting,
+										buildStats);
 
 		/* Now insert the TIDs-to-be-added into the posting tree */
 		gdi = ginPrepareScanPostingTree(ginstate->index, postingRoot, FALSE);
@@ -163,9 +198,10 @@ addItemPointersToLeafTuple(GinState *ginstate,
 		pfree(gdi);
 
 		/* And build a new posting-tree-only result tuple */
-		res = GinFormTuple(ginstate, attnum, key, category, NULL, 0, true);
+		res = GinFormTuple(ginstate, attnum, key, category, NULL, 0, 0, true);
 		GinSetPostingTree(res, postingRoot);
 	}
+	pfree(oldItems);
 
 	return res;
 }
@@ -184,12 +220,19 @@ buildFreshLeafTuple(GinState *ginstate,
 					ItemPointerData *items, uint32 nitem,
 					GinStatsData *buildStats)
 {
-	IndexTuple	res;
-
-	/* try to build tuple with room for all the items */
-	res = GinFormTuple(ginstate, attnum, key, category,
-					   items, nitem, false);
-
+	IndexTuple	res = NULL;
+	GinPostingList *compressedList;
+	int			nwritten;
+
+	/* try to build a posting list tuple with all the items */
+	compressedList = ginCompressPostingList(items, nitem, GinMaxItemSize,
+											&nwritten);
+	if (nwritten == nitem)
+		res = GinFormTuple(ginstate, attnum, key, category,
+						   (char *) compressedList,
+						   SizeOfGinPostingList(compressedList),
+						   nitem, false);
+	pfree(compressedList);
 	if (!res)
 	{
 		/* posting list would be too big, build posting tree */
@@ -199,35 +242,13 @@ buildFreshLeafTuple(GinState *ginstate,
 		 * Build posting-tree-only result tuple.  We do this first so as to
 		 * fail quickly if the key is too big.
 		 */
-		res = GinFormTuple(ginstate, attnum, key, category, NULL, 0, true);
+		res = GinFormTuple(ginstate, attnum, key, category, NULL, 0, 0, true);
 
 		/*
-		 * Initialize posting tree with as many TIDs as will fit on the first
-		 * page.
+		 * Initialize a new posting tree with the TIDs.
 		 */
-		postingRoot = createPostingTree(ginstate->index,
-										items,
-										Min(nitem, GinMaxLeafDataItems));
-
-		/* During index build, count the newly-added data page */
-		if (buildStats)
-			buildStats->nDataPages++;
-
-		/* Add any remaining TIDs to the posting tree */
-		if (nitem > GinMaxLeafDataItems)
-		{
-			GinPostingTreeScan *gdi;
-
-			gdi = ginPrepareScanPostingTree(ginstate->index, postingRoot, FALSE);
-			gdi->btree.isBuild = (buildStats != NULL);
-
-			ginInsertItemPointers(gdi,
-								  items + GinMaxLeafDataItems,
-								  nitem - GinMaxLeafDataItems,
-								  buildStats);
-
-			pfree(gdi);
-		}
+		postingRoot = createPostingTree(ginstate->index, items, nitem,
+										buildStats);
 
 		/* And save the root link in the result tuple */
 		GinSetPostingTree(res, postingRoot);
@@ -244,6 +244,10 @@ GinInitPage(Page page, uint32 f, Size pageSize)
 	memset(opaque, 0, sizeof(GinPageOpaqueData));
 	opaque->flags = f;
 	opaque->rightlink = InvalidBlockNumber;
+
+	/* compressed leaf data pages track their content size in pd_lower */
+	if (f & GIN_COMPRESSED)
+		GinDataLeafPageSetPostingListSize(page, 0);
 }
 
 void
@@ -98,10 +98,20 @@ xlogVacuumPage(Relation index, Buffer buffer)
 
 	if (GinPageIsData(page))
 	{
-		backup = GinDataPageGetData(page);
-		data.nitem = GinPageGetOpaque(page)->maxoff;
-		if (data.nitem)
-			len = MAXALIGN(sizeof(ItemPointerData) * data.nitem);
+		if (GinPageIsCompressed(page))
+		{
+			/* nitem = 0 tells replay that compressed data follows */
+			backup = (char *) GinDataLeafPageGetPostingList(page);
+			data.nitem = 0;
+			len = GinDataLeafPageGetPostingListSize(page);
+		}
+		else
+		{
+			backup = GinDataPageGetData(page);
+			data.nitem = GinPageGetOpaque(page)->maxoff;
+			if (data.nitem)
+				len = MAXALIGN(sizeof(ItemPointerData) * data.nitem);
+		}
 	}
 	else
 	{
@@ -122,7 +132,7 @@ xlogVacuumPage(Relation index, Buffer buffer)
 	}
 
 	rdata[0].buffer = buffer;
-	rdata[0].buffer_std = (GinPageIsData(page)) ? FALSE : TRUE;
+	rdata[0].buffer_std = (GinPageIsData(page) && !GinPageIsCompressed(page)) ? FALSE : TRUE;
 	rdata[0].len = 0;
 	rdata[0].data = NULL;
 	rdata[0].next = rdata + 1;
@@ -176,22 +186,38 @@ ginVacuumPostingTreeLeaves(GinVacuumState *gvs, BlockNumber blkno, bool isRoot,
 
 	if (GinPageIsLeaf(page))
 	{
-		OffsetNumber newMaxOff,
-					oldMaxOff = GinPageGetOpaque(page)->maxoff;
+		ItemPointer items;
+		int			nitems;
+		uint32		ncleaned;
 		ItemPointerData *cleaned = NULL;
 
-		newMaxOff = ginVacuumPostingList(gvs,
-				(ItemPointer) GinDataPageGetData(page), oldMaxOff, &cleaned);
+		items = GinDataLeafPageGetItems(page, &nitems);
+		ncleaned = ginVacuumPostingList(gvs, items, nitems, &cleaned);
 
 		/* saves changes about deleted tuple ... */
-		if (oldMaxOff != newMaxOff)
+		if (ncleaned != nitems)
 		{
-			START_CRIT_SECTION();
+			Page		tmppage = PageGetTempPageCopy(page);
 
-			if (newMaxOff > 0)
-				memcpy(GinDataPageGetData(page), cleaned, sizeof(ItemPointerData) * newMaxOff);
+			/*
+			 * Removing items never makes a compressed posting list longer,
+			 * so this always fits if the page was compressed already.  A
+			 * page in the old format is compressed too, unless that would
+			 * make it overflow; then it's left uncompressed.
+			 */
+			if (ginDataLeafPageEncode(tmppage, cleaned, ncleaned) != ncleaned)
+			{
+				Assert(!GinPageIsCompressed(page));
+				memcpy(tmppage, page, BLCKSZ);
+				memcpy(GinDataPageGetData(tmppage), cleaned,
+					   sizeof(ItemPointerData) * ncleaned);
+				GinPageGetOpaque(tmppage)->maxoff = ncleaned;
+			}
 			pfree(cleaned);
-			GinPageGetOpaque(page)->maxoff = newMaxOff;
+
+			START_CRIT_SECTION();
+
+			PageRestoreTempPage(tmppage, page);
 
 			MarkBufferDirty(buffer);
 			xlogVacuumPage(gvs->index, buffer);
@@ -199,9 +225,10 @@ ginVacuumPostingTreeLeaves(GinVacuumState *gvs, BlockNumber blkno, bool isRoot,
 			END_CRIT_SECTION();
 
 			/* if root is a leaf page, we don't desire further processing */
-			if (!isRoot && GinPageGetOpaque(page)->maxoff < FirstOffsetNumber)
+			if (!isRoot && GinDataLeafPageIsEmpty(page))
 				hasVoidPage = TRUE;
 		}
+		pfree(items);
 	}
 	else
 	{
@@ -425,7 +452,8 @@ ginScanToDelete(GinVacuumState *gvs, BlockNumber blkno, bool isRoot, DataPageDel
 		}
 	}
 
-	if (GinPageGetOpaque(page)->maxoff < FirstOffsetNumber)
+	if (GinPageIsLeaf(page) ? GinDataLeafPageIsEmpty(page) :
+		GinPageGetOpaque(page)->maxoff < FirstOffsetNumber)
 	{
 		/* we never delete the left- or rightmost branch */
 		if (me->leftBlkno != InvalidBlockNumber && !GinPageRightMost(page))
@@ -509,23 +537,40 @@ ginVacuumEntryPage(GinVacuumState *gvs, Buffer buffer, BlockNumber *roots, uint3
 		}
 		else if (GinGetNPosting(itup) > 0)
 		{
-			/*
-			 * if we already create temporary page, we will make changes in
-			 * place
-			 */
-			ItemPointerData *cleaned = (tmppage == origpage) ? NULL : GinGetPosting(itup);
-			uint32		newN = ginVacuumPostingList(gvs, GinGetPosting(itup), GinGetNPosting(itup), &cleaned);
+			ItemPointer items;
+			int			nitems;
+			ItemPointerData *cleaned = NULL;
+			uint32		newN;
+
+			items = ginReadTuple(&gvs->ginstate,
+								 gintuple_get_attrnum(&gvs->ginstate, itup),
+								 itup, &nitems);
+			newN = ginVacuumPostingList(gvs, items, nitems, &cleaned);
 
-			if (GinGetNPosting(itup) != newN)
+			if (nitems != newN)
 			{
 				OffsetNumber attnum;
 				Datum		key;
 				GinNullCategory category;
+				GinPostingList *plist = NULL;
+				Size		plistsize = 0;
 
 				/*
 				 * Some ItemPointers was deleted, so we should remake our
 				 * tuple
 				 */
+				if (newN > 0)
+				{
+					int			nwritten;
+
+					plist = ginCompressPostingList(cleaned, newN,
+												   GinMaxItemSize, &nwritten);
+					if (nwritten != newN)
+						elog(ERROR, "could not compress posting list of GIN index \"%s\"",
+							 RelationGetRelationName(gvs->index));
+					plistsize = SizeOfGinPostingList(plist);
+				}
+				pfree(cleaned);
 
 				if (tmppage == origpage)
 				{
@@ -535,15 +580,6 @@ ginVacuumEntryPage(GinVacuumState *gvs, Buffer buffer, BlockNumber *roots, uint3
 					 */
 					tmppage = PageGetTempPageCopy(origpage);
 
-					if (newN > 0)
-					{
-						Size		pos = ((char *) GinGetPosting(itup)) - ((char *) origpage);
-
-						memcpy(tmppage + pos, cleaned, sizeof(ItemPointerData) * newN);
-					}
-
-					pfree(cleaned);
-
 					/* set itup pointer to new page */
 					itup = (IndexTuple) PageGetItem(tmppage, PageGetItemId(tmppage, i));
 				}
@@ -551,7 +587,9 @@ ginVacuumEntryPage(GinVacuumState *gvs, Buffer buffer, BlockNumber *roots, uint3
 				attnum = gintuple_get_attrnum(&gvs->ginstate, itup);
 				key = gintuple_get_key(&gvs->ginstate, itup, &category);
 				itup = GinFormTuple(&gvs->ginstate, attnum, key, category,
-									GinGetPosting(itup), newN, true);
+									(char *) plist, plistsize, newN, true);
+				if (plist)
+					pfree(plist);
 				PageIndexTupleDelete(tmppage, i);
 
 				if (PageAddItem(tmppage, (Item) itup, IndexTupleSize(itup), i, false, false) != i)
@@ -560,6 +598,7 @@ ginVacuumEntryPage(GinVacuumState *gvs, Buffer buffer, BlockNumber *roots, uint3
 
 				pfree(itup);
 			}
+			pfree(items);
 		}
 	}
 
@@ -106,7 +106,7 @@ static void
 ginRedoCreatePTree(XLogRecPtr lsn, XLogRecord *record)
 {
 	ginxlogCreatePostingTree *data = (ginxlogCreatePostingTree *) XLogRecGetData(record);
-	ItemPointerData *items = (ItemPointerData *) (XLogRecGetData(record) + sizeof(ginxlogCreatePostingTree));
+	char	   *ptr = XLogRecGetData(record) + sizeof(ginxlogCreatePostingTree);
 	Buffer		buffer;
 	Page		page;
 
@@ -117,9 +117,9 @@ ginRedoCreatePTree(XLogRecPtr lsn, XLogRecord *record)
 	Assert(BufferIsValid(buffer));
 	page = (Page) BufferGetPage(buffer);
 
-	GinInitBuffer(buffer, GIN_DATA | GIN_LEAF);
-	memcpy(GinDataPageGetData(page), items, sizeof(ItemPointerData) * data->nitem);
-	GinPageGetOpaque(page)->maxoff = data->nitem;
+	GinInitBuffer(buffer, GIN_DATA | GIN_LEAF | GIN_COMPRESSED);
+	memcpy(GinDataLeafPageGetPostingList(page), ptr, data->size);
+	GinDataLeafPageSetPostingListSize(page, data->size);
 
 	PageSetLSN(page, lsn);
 
@@ -182,14 +182,15 @@ ginRedoInsert(XLogRecPtr lsn, XLogRecord *record)
 
 			if (data->isLeaf)
 			{
-				OffsetNumber i;
 				ItemPointerData *items = (ItemPointerData *) (XLogRecGetData(record) + sizeof(ginxlogInsert));
 
 				Assert(GinPageIsLeaf(page));
 				Assert(data->updateBlkno == InvalidBlockNumber);
 
-				for (i = 0; i < data->nitem; i++)
-					GinDataPageAddItem(page, items + i, data->offset + i);
+				/* merging the new items reproduces the original page */
+				if (!ginDataLeafPageAddItems(page, items, data->nitem))
+					elog(ERROR, "failed to add items to GIN data page in %u/%u/%u",
+				  data->node.spcNode, data->node.dbNode, data->node.relNode);
 			}
 			else
 			{
@@ -260,6 +261,8 @@ ginRedoSplit(XLogRecPtr lsn, XLogRecord *record)
 		flags |= GIN_LEAF;
 	if (data->isData)
 		flags |= GIN_DATA;
+	if (data->isLeaf && data->isData)
+		flags |= GIN_COMPRESSED;
 
 	/* Backup blocks are not used in split records */
 	Assert(!(record->xl_info & XLR_BKP_BLOCK_MASK));
@@ -277,7 +280,25 @@ ginRedoSplit(XLogRecPtr lsn, XLogRecord *record)
 	GinPageGetOpaque(lpage)->rightlink = BufferGetBlockNumber(rbuffer);
 	GinPageGetOpaque(rpage)->rightlink = data->rrlink;
 
-	if (data->isData)
+	if (data->isData && data->isLeaf)
+	{
+		char	   *ptr = XLogRecGetData(record) + sizeof(ginxlogSplit);
+		ItemPointer items;
+		int			nitems;
+
+		memcpy(GinDataLeafPageGetPostingList(lpage), ptr, data->lsize);
+		GinDataLeafPageSetPostingListSize(lpage, data->lsize);
+		memcpy(GinDataLeafPageGetPostingList(rpage), ptr + data->lsize, data->rsize);
+		GinDataLeafPageSetPostingListSize(rpage, data->rsize);
+
+		/* set up right keys */
+		items = GinDataLeafPageGetItems(lpage, &nitems);
+		*GinDataPageGetRightBound(lpage) = items[nitems - 1];
+		pfree(items);
+
+		*GinDataPageGetRightBound(rpage) = data->rightbound;
+	}
+	else if (data->isData)
 	{
 		char	   *ptr = XLogRecGetData(record) + sizeof(ginxlogSplit);
 		Size		sizeofitem = GinSizeOfDataPageItem(lpage);
@@ -298,10 +319,7 @@ ginRedoSplit(XLogRecPtr lsn, XLogRecord *record)
 
 		/* set up right key */
 		bound = GinDataPageGetRightBound(lpage);
-		if (data->isLeaf)
-			*bound = *(ItemPointerData *) GinDataPageGetItem(lpage, GinPageGetOpaque(lpage)->maxoff);
-		else
-			*bound = ((PostingItem *) GinDataPageGetItem(lpage, GinPageGetOpaque(lpage)->maxoff))->key;
+		*bound = ((PostingItem *) GinDataPageGetItem(lpage, GinPageGetOpaque(lpage)->maxoff))->key;
 
 		bound = GinDataPageGetRightBound(rpage);
 		*bound = data->rightbound;
@@ -342,7 +360,7 @@ ginRedoSplit(XLogRecPtr lsn, XLogRecord *record)
 		Buffer		rootBuf = XLogReadBuffer(data->node, data->rootBlkno, true);
 		Page		rootPage = BufferGetPage(rootBuf);
 
-		GinInitBuffer(rootBuf, flags & ~GIN_LEAF);
+		GinInitBuffer(rootBuf, flags & ~(GIN_LEAF | GIN_COMPRESSED));
 
 		if (data->isData)
 		{
@@ -388,7 +406,19 @@ ginRedoVacuumPage(XLogRecPtr lsn, XLogRecord *record)
 
 	if (lsn > PageGetLSN(page))
 	{
-		if (GinPageIsData(page))
+		if (GinPageIsData(page) && data->nitem == 0)
+		{
+			/* compressed posting lists fill the rest of the record */
+			Size		size = record->xl_len - sizeof(ginxlogVacuumPage);
+
+			memcpy(GinDataLeafPageGetPostingList(page),
+				   XLogRecGetData(record) + sizeof(ginxlogVacuumPage),
+				   size);
+			GinPageSetCompressed(page);
+			GinDataLeafPageSetPostingListSize(page, size);
+			GinPageGetOpaque(page)->maxoff = InvalidOffsetNumber;
+		}
+		else if (GinPageIsData(page))
 		{
 			memcpy(GinDataPageGetData(page),
 				   XLogRecGetData(record) + sizeof(ginxlogVacuumPage),
@@ -802,8 +832,10 @@ ginContinueSplit(ginIncompleteSplit *split)
 
 		PostingItemSetBlockNumber(&(btree.pitem), split->leftBlkno);
 		if (GinPageIsLeaf(page))
-			btree.pitem.key = *(ItemPointerData *) GinDataPageGetItem(page,
-											 GinPageGetOpaque(page)->maxoff);
+		{
+			/* the split set the right bound to the last item on the page */
+			btree.pitem.key = *GinDataPageGetRightBound(page);
+		}
 		else
 			btree.pitem.key = ((PostingItem *) GinDataPageGetItem(page,
 									   GinPageGetOpaque(page)->maxoff))->key;
@@ -19,9 +19,11 @@
 #include "postgres.h"
 
 #include "access/hash.h"
+#include "access/hash_xlog.h"
 #include "access/relscan.h"
 #include "catalog/index.h"
 #include "commands/vacuum.h"
+#include "miscadmin.h"
 #include "optimizer/cost.h"
 #include "optimizer/plancat.h"
 #include "storage/bufmgr.h"
@@ -392,6 +394,11 @@ hashbeginscan(PG_FUNCTION_ARGS)
 	so = (HashScanOpaque) palloc(sizeof(HashScanOpaqueData));
 	so->hashso_bucket_valid = false;
 	so->hashso_bucket_blkno = 0;
+	so->hashso_bucket_buf = InvalidBuffer;
+	so->hashso_split_bucket_blkno = 0;
+	so->hashso_split_bucket_buf = InvalidBuffer;
+	so->hashso_buc_populated = false;
+	so->hashso_buc_split = false;
 	so->hashso_curbuf = InvalidBuffer;
 	/* set position invalid (this will cause _hash_first call) */
 	ItemPointerSetInvalid(&(so->hashso_curpos));
@@ -418,15 +425,8 @@ hashrescan(PG_FUNCTION_ARGS)
 	HashScanOpaque so = (HashScanOpaque) scan->opaque;
 	Relation	rel = scan->indexRelation;
 
-	/* release any pin we still hold */
-	if (BufferIsValid(so->hashso_curbuf))
-		_hash_dropbuf(rel, so->hashso_curbuf);
-	so->hashso_curbuf = InvalidBuffer;
-
-	/* release lock on bucket, too */
-	if (so->hashso_bucket_blkno)
-		_hash_droplock(rel, so->hashso_bucket_blkno, HASH_SHARE);
-	so->hashso_bucket_blkno = 0;
+	/* release any pins and bucket locks we still hold */
+	_hash_dropscanbuf(rel, so);
 
 	/* set position invalid (this will cause _hash_first call) */
 	ItemPointerSetInvalid(&(so->hashso_curpos));
@@ -457,15 +457,8 @@ hashendscan(PG_FUNCTION_ARGS)
 	/* don't need scan registered anymore */
 	_hash_dropscan(scan);
 
-	/* release any pin we still hold */
-	if (BufferIsValid(so->hashso_curbuf))
-		_hash_dropbuf(rel, so->hashso_curbuf);
-	so->hashso_curbuf = InvalidBuffer;
-
-	/* release lock on bucket, too */
-	if (so->hashso_bucket_blkno)
-		_hash_droplock(rel, so->hashso_bucket_blkno, HASH_SHARE);
-	so->hashso_bucket_blkno = 0;
+	/* release any pins and bucket locks we still hold */
+	_hash_dropscanbuf(rel, so);
 
 	pfree(so);
 	scan->opaque = NULL;
@@ -546,6 +539,7 @@ loop_top:
 		BlockNumber bucket_blkno;
 		BlockNumber blkno;
 		bool		bucket_dirty = false;
+		bool		split_in_progress = false;
 
 		/* Get address of bucket's start page */
 		bucket_blkno = BUCKET_TO_BLKNO(&local_metapage, cur_bucket);
@@ -578,6 +572,12 @@ loop_top:
 			opaque = (HashPageOpaque) PageGetSpecialPointer(page);
 			Assert(opaque->hasho_bucket == cur_bucket);
 
+			/* the primary page tells whether the bucket is in a split */
+			if (blkno == bucket_blkno &&
+				(opaque->hasho_flag & (LH_BUCKET_BEING_SPLIT |
+									   LH_BUCKET_BEING_POPULATED)) != 0)
+				split_in_progress = true;
+
 			/* Scan each tuple in page */
 			maxoffno = PageGetMaxOffsetNumber(page);
 			for (offno = FirstOffsetNumber;
@@ -607,16 +607,60 @@ loop_top:
 
 			if (ndeletable > 0)
 			{
+				/* No ereport(ERROR) until changes are logged */
+				START_CRIT_SECTION();
+
 				PageIndexMultiDelete(page, deletable, ndeletable);
-				_hash_wrtbuf(rel, buf);
+				MarkBufferDirty(buf);
+
+				/* XLOG stuff */
+				if (RelationNeedsWAL(rel))
+				{
+					xl_hash_delete xlrec;
+					XLogRecPtr	recptr;
+					XLogRecData rdata[2];
+
+					xlrec.node = rel->rd_node;
+					xlrec.bucket_blkno = bucket_blkno;
+					xlrec.blkno = BufferGetBlockNumber(buf);
+
+					rdata[0].data = (char *) &xlrec;
+					rdata[0].len = SizeOfHashDelete;
+					rdata[0].buffer = InvalidBuffer;
+					rdata[0].next = &(rdata[1]);
+
+					/*
+					 * The target-offsets array is not in the buffer, but
+					 * pretend that it is.  When XLogInsert stores the whole
+					 * buffer, the offsets array need not be stored too.
+					 */
+					rdata[1].data = (char *) deletable;
+					rdata[1].len = ndeletable * sizeof(OffsetNumber);
+					rdata[1].buffer = buf;
+					rdata[1].buffer_std = true;
+					rdata[1].next = NULL;
+
+					recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_DELETE, rdata);
+
+					PageSetLSN(page, recptr);
+				}
+
+				END_CRIT_SECTION();
+
+				_hash_relbuf(rel, buf);
 				bucket_dirty = true;
 			}
 			else
 				_hash_relbuf(rel, buf);
 		}
 
-		/* If we deleted anything, try to compact free space */
-		if (bucket_dirty)
+		/*
+		 * If we deleted anything, try to compact free space.  Not while the
+		 * bucket is taking part in a split, though: the split relies on the
+		 * pages of the old bucket staying put until it's done, and the
+		 * split squeezes the old bucket at the end anyway.
+		 */
+		if (bucket_dirty && !split_in_progress)
 			_hash_squeezebucket(rel, cur_bucket, bucket_blkno,
 								info->strategy);
 
@@ -641,6 +685,7 @@ loop_top:
 	}
 
 	/* Okay, we're really done.  Update tuple count in metapage. */
+	START_CRIT_SECTION();
 
 	if (orig_maxbucket == metap->hashm_maxbucket &&
 		orig_ntuples == metap->hashm_ntuples)
@@ -666,7 +711,37 @@ loop_top:
 		num_index_tuples = metap->hashm_ntuples;
 	}
 
-	_hash_wrtbuf(rel, metabuf);
+	MarkBufferDirty(metabuf);
+
+	/* XLOG stuff */
+	if (RelationNeedsWAL(rel))
+	{
+		xl_hash_update_meta_page xlrec;
+		XLogRecPtr	recptr;
+		XLogRecData rdata[2];
+
+		xlrec.node = rel->rd_node;
+		xlrec.ntuples = metap->hashm_ntuples;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = SizeOfHashUpdateMetaPage;
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &(rdata[1]);
+
+		rdata[1].data = NULL;
+		rdata[1].len = 0;
+		rdata[1].buffer = metabuf;
+		rdata[1].buffer_std = false;
+		rdata[1].next = NULL;
+
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_UPDATE_META_PAGE, rdata);
+
+		PageSetLSN(BufferGetPage(metabuf), recptr);
+	}
+
+	END_CRIT_SECTION();
+
+	_hash_relbuf(rel, metabuf);
 
 	/* return statistics */
 	if (stats == NULL)
@@ -704,9 +779,3 @@ hashvacuumcleanup(PG_FUNCTION_ARGS)
 	PG_RETURN_POINTER(stats);
 }
 
-
-void
-hash_redo(XLogRecPtr lsn, XLogRecord *record)
-{
-	elog(PANIC, "hash_redo: unimplemented");
-}
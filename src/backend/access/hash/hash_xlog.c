@@ -0,0 +1,595 @@
+/*-------------------------------------------------------------------------
+ *
+ * hash_xlog.c
+ *	  WAL replay logic for hash index.
+ *
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/hash/hash_xlog.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/hash.h"
+#include "access/hash_xlog.h"
+#include "access/xlogutils.h"
+
+
+/*
+ * Lock the primary page of a bucket whose tuples are about to be moved or
+ * removed.  We take a cleanup lock, which waits out any hot standby scan of
+ * the bucket: those hold a pin on the primary page (see README).
+ *
+ * If the primary page is itself one of the record's backup blocks, 'bkpidx'
+ * gives its index, and we restore it here; *restored tells the caller that
+ * there's nothing more to do to that page.  Pass -1 if it's not a backup
+ * block of the record.
+ *
+ * Returns InvalidBuffer if the page doesn't exist anymore.
+ */
+static Buffer
+hash_xlog_lock_bucket(XLogRecPtr lsn, XLogRecord *record, RelFileNode node,
+					  BlockNumber blkno, int bkpidx, bool *restored)
+{
+	Buffer		buf;
+
+	if (bkpidx >= 0 && (record->xl_info & XLR_BKP_BLOCK(bkpidx)))
+	{
+		*restored = true;
+		return RestoreBackupBlock(lsn, record, bkpidx, true, true);
+	}
+
+	*restored = false;
+	buf = XLogReadBufferExtended(node, MAIN_FORKNUM, blkno, RBM_NORMAL);
+	if (BufferIsValid(buf))
+		LockBufferForCleanup(buf);
+
+	return buf;
+}
+
+/*
+ * Get a page the record changes, if the change still needs to be applied.
+ *
+ * If the page is backup block 'bkpidx' of the record, it is restored, and
+ * there's nothing left to do.  Otherwise, the page is read and locked, and
+ * returned if its LSN shows that it predates the record.
+ */
+static Buffer
+hash_xlog_getpage(XLogRecPtr lsn, XLogRecord *record, int bkpidx,
+				  RelFileNode node, BlockNumber blkno)
+{
+	Buffer		buf;
+
+	if (record->xl_info & XLR_BKP_BLOCK(bkpidx))
+	{
+		(void) RestoreBackupBlock(lsn, record, bkpidx, false, false);
+		return InvalidBuffer;
+	}
+
+	buf = XLogReadBuffer(node, blkno, false);
+	if (BufferIsValid(buf) && lsn <= PageGetLSN(BufferGetPage(buf)))
+	{
+		UnlockReleaseBuffer(buf);
+		buf = InvalidBuffer;
+	}
+
+	return buf;
+}
+
+/*
+ * Like hash_xlog_getpage, but for a page that might be the bucket's primary
+ * page, which the caller has already locked with hash_xlog_lock_bucket.
+ */
+static Buffer
+hash_xlog_getbucketpage(XLogRecPtr lsn, XLogRecord *record, int bkpidx,
+						RelFileNode node, BlockNumber blkno,
+						Buffer bucketbuf, BlockNumber bucket_blkno,
+						bool bucket_restored)
+{
+	if (blkno != bucket_blkno)
+		return hash_xlog_getpage(lsn, record, bkpidx, node, blkno);
+
+	if (bucket_restored || !BufferIsValid(bucketbuf) ||
+		lsn <= PageGetLSN(BufferGetPage(bucketbuf)))
+		return InvalidBuffer;
+
+	return bucketbuf;
+}
+
+/*
+ * Finish up a page changed by replay: set its LSN and mark it dirty, and
+ * release it unless it's a bucket's primary page, which the caller releases
+ * at the end.
+ */
+static void
+hash_xlog_donepage(XLogRecPtr lsn, Buffer buf, Buffer bucketbuf)
+{
+	PageSetLSN(BufferGetPage(buf), lsn);
+	MarkBufferDirty(buf);
+	if (buf != bucketbuf)
+		UnlockReleaseBuffer(buf);
+}
+
+/*
+ * Read a page that the record initializes from scratch, and zero it.
+ */
+static Buffer
+hash_xlog_initpage(RelFileNode node, BlockNumber blkno)
+{
+	Buffer		buf;
+	Page		page;
+
+	buf = XLogReadBuffer(node, blkno, true);
+	Assert(BufferIsValid(buf));
+	page = BufferGetPage(buf);
+
+	/* a cached copy of the page isn't zeroed by XLogReadBuffer */
+	MemSet(page, 0, BufferGetPageSize(buf));
+
+	return buf;
+}
+
+static void
+hash_xlog_insert(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_insert *xlrec = (xl_hash_insert *) XLogRecGetData(record);
+	Buffer		buf;
+
+	buf = hash_xlog_getpage(lsn, record, 0, xlrec->node, xlrec->blkno);
+	if (BufferIsValid(buf))
+	{
+		Page		page = BufferGetPage(buf);
+		char	   *datapos = (char *) xlrec + SizeOfHashInsert;
+		IndexTupleData itupdata;
+		Size		itemsz;
+
+		/* the tuple isn't aligned in the record, so copy its header */
+		memcpy(&itupdata, datapos, sizeof(IndexTupleData));
+		itemsz = IndexTupleDSize(itupdata);
+
+		if (PageAddItem(page, (Item) datapos, itemsz, xlrec->offnum,
+						false, false) == InvalidOffsetNumber)
+			elog(PANIC, "hash_xlog_insert: failed to add item");
+
+		hash_xlog_donepage(lsn, buf, InvalidBuffer);
+	}
+
+	/* bump the tuple count in the metapage */
+	buf = hash_xlog_getpage(lsn, record, 1, xlrec->node, HASH_METAPAGE);
+	if (BufferIsValid(buf))
+	{
+		HashMetaPage metap = HashPageGetMeta(BufferGetPage(buf));
+
+		metap->hashm_ntuples += 1;
+
+		hash_xlog_donepage(lsn, buf, InvalidBuffer);
+	}
+}
+
+static void
+hash_xlog_add_ovfl_page(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_add_ovfl_page *xlrec = (xl_hash_add_ovfl_page *) XLogRecGetData(record);
+	Buffer		buf;
+	Page		page;
+	HashPageOpaque opaque;
+	int			bkpidx = 0;
+
+	/* the new overflow page is initialized from scratch */
+	buf = hash_xlog_initpage(xlrec->node, xlrec->ovflblkno);
+	page = BufferGetPage(buf);
+	_hash_pageinit(page, BufferGetPageSize(buf));
+	opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+	opaque->hasho_prevblkno = xlrec->prevblkno;
+	opaque->hasho_nextblkno = InvalidBlockNumber;
+	opaque->hasho_bucket = xlrec->bucket;
+	opaque->hasho_flag = LH_OVERFLOW_PAGE;
+	opaque->hasho_page_id = HASHO_PAGE_ID;
+	hash_xlog_donepage(lsn, buf, InvalidBuffer);
+
+	/* link it to the previous tail of the bucket chain */
+	buf = hash_xlog_getpage(lsn, record, bkpidx++, xlrec->node,
+							xlrec->prevblkno);
+	if (BufferIsValid(buf))
+	{
+		opaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(buf));
+		opaque->hasho_nextblkno = xlrec->ovflblkno;
+		hash_xlog_donepage(lsn, buf, InvalidBuffer);
+	}
+
+	/* mark a recycled page in use in its bitmap page */
+	if (BlockNumberIsValid(xlrec->mapblkno))
+	{
+		buf = hash_xlog_getpage(lsn, record, bkpidx++, xlrec->node,
+								xlrec->mapblkno);
+		if (BufferIsValid(buf))
+		{
+			uint32	   *freep = HashPageGetBitmap(BufferGetPage(buf));
+
+			SETBIT(freep, xlrec->bitmapbit);
+			hash_xlog_donepage(lsn, buf, InvalidBuffer);
+		}
+	}
+
+	/* a new bitmap page is initialized from scratch, too */
+	if (BlockNumberIsValid(xlrec->newmapblkno))
+	{
+		buf = hash_xlog_initpage(xlrec->node, xlrec->newmapblkno);
+		_hash_initbitmapbuffer(buf, xlrec->bmsize, true);
+		hash_xlog_donepage(lsn, buf, InvalidBuffer);
+	}
+
+	buf = hash_xlog_getpage(lsn, record, bkpidx, xlrec->node, HASH_METAPAGE);
+	if (BufferIsValid(buf))
+	{
+		HashMetaPage metap = HashPageGetMeta(BufferGetPage(buf));
+
+		if (BlockNumberIsValid(xlrec->newmapblkno))
+		{
+			metap->hashm_mapp[metap->hashm_nmaps] = xlrec->newmapblkno;
+			metap->hashm_nmaps++;
+		}
+		metap->hashm_spares[metap->hashm_ovflpoint] = xlrec->spares;
+		metap->hashm_firstfree = xlrec->firstfree;
+
+		hash_xlog_donepage(lsn, buf, InvalidBuffer);
+	}
+}
+
+static void
+hash_xlog_split_allocate_page(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_split_allocate_page *xlrec = (xl_hash_split_allocate_page *) XLogRecGetData(record);
+	Buffer		buf;
+	Page		page;
+	HashPageOpaque opaque;
+
+	/* mark the old bucket as being split */
+	buf = hash_xlog_getpage(lsn, record, 0, xlrec->node,
+							xlrec->old_bucket_blkno);
+	if (BufferIsValid(buf))
+	{
+		opaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(buf));
+		opaque->hasho_flag |= LH_BUCKET_BEING_SPLIT;
+		hash_xlog_donepage(lsn, buf, InvalidBuffer);
+	}
+
+	/* initialize the new bucket's primary page */
+	buf = hash_xlog_initpage(xlrec->node, xlrec->new_bucket_blkno);
+	page = BufferGetPage(buf);
+	_hash_pageinit(page, BufferGetPageSize(buf));
+	opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+	opaque->hasho_prevblkno = InvalidBlockNumber;
+	opaque->hasho_nextblkno = InvalidBlockNumber;
+	opaque->hasho_bucket = xlrec->new_bucket;
+	opaque->hasho_flag = LH_BUCKET_PAGE | LH_BUCKET_BEING_POPULATED;
+	opaque->hasho_page_id = HASHO_PAGE_ID;
+	hash_xlog_donepage(lsn, buf, InvalidBuffer);
+
+	/* and make the new bucket known in the metapage */
+	buf = hash_xlog_getpage(lsn, record, 1, xlrec->node, HASH_METAPAGE);
+	if (BufferIsValid(buf))
+	{
+		HashMetaPage metap = HashPageGetMeta(BufferGetPage(buf));
+
+		metap->hashm_maxbucket = xlrec->new_bucket;
+		metap->hashm_lowmask = xlrec->lowmask;
+		metap->hashm_highmask = xlrec->highmask;
+		metap->hashm_ovflpoint = xlrec->ovflpoint;
+		metap->hashm_spares[xlrec->ovflpoint] = xlrec->spares;
+
+		hash_xlog_donepage(lsn, buf, InvalidBuffer);
+	}
+}
+
+static void
+hash_xlog_split_complete(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_split_complete *xlrec = (xl_hash_split_complete *) XLogRecGetData(record);
+	Buffer		buf;
+	HashPageOpaque opaque;
+
+	buf = hash_xlog_getpage(lsn, record, 0, xlrec->node,
+							xlrec->old_bucket_blkno);
+	if (BufferIsValid(buf))
+	{
+		opaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(buf));
+		opaque->hasho_flag &= ~LH_BUCKET_BEING_SPLIT;
+		hash_xlog_donepage(lsn, buf, InvalidBuffer);
+	}
+
+	buf = hash_xlog_getpage(lsn, record, 1, xlrec->node,
+							xlrec->new_bucket_blkno);
+	if (BufferIsValid(buf))
+	{
+		opaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(buf));
+		opaque->hasho_flag &= ~LH_BUCKET_BEING_POPULATED;
+		hash_xlog_donepage(lsn, buf, InvalidBuffer);
+	}
+}
+
+static void
+hash_xlog_move_page_contents(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_move_page_contents *xlrec = (xl_hash_move_page_contents *) XLogRecGetData(record);
+	char	   *datapos = (char *) xlrec + SizeOfHashMovePageContents;
+	OffsetNumber *itup_offsets = NULL;
+	char	   *tupdata = NULL;
+	Buffer		wbucketbuf;
+	Buffer		rbucketbuf = InvalidBuffer;
+	bool		wbucket_restored;
+	bool		rbucket_restored = false;
+	Buffer		buf;
+	uint16		i;
+
+	/*
+	 * Lock out hot standby scans of both buckets, write bucket first like
+	 * the split does; when squeezing, it's the same bucket.
+	 */
+	wbucketbuf = hash_xlog_lock_bucket(lsn, record, xlrec->node,
+									   xlrec->wbucket_blkno,
+									   (xlrec->wblkno == xlrec->wbucket_blkno) ?
+									   0 : -1,
+									   &wbucket_restored);
+	if (xlrec->rbucket_blkno != xlrec->wbucket_blkno)
+		rbucketbuf = hash_xlog_lock_bucket(lsn, record, xlrec->node,
+										   xlrec->rbucket_blkno,
+									   (xlrec->rblkno == xlrec->rbucket_blkno) ?
+										   1 : -1,
+										   &rbucket_restored);
+	else
+	{
+		/* the read page is never the primary page when squeezing */
+		Assert(xlrec->rblkno != xlrec->rbucket_blkno);
+		rbucketbuf = wbucketbuf;
+	}
+
+	/* offsets and tuples are included unless the write page was backed up */
+	if (!(record->xl_info & XLR_BKP_BLOCK(0)))
+	{
+		itup_offsets = (OffsetNumber *) datapos;
+		datapos += xlrec->ntups * sizeof(OffsetNumber);
+		tupdata = datapos;
+		for (i = 0; i < xlrec->ntups; i++)
+		{
+			IndexTupleData itupdata;
+
+			memcpy(&itupdata, datapos, sizeof(IndexTupleData));
+			datapos += MAXALIGN(IndexTupleDSize(itupdata));
+		}
+	}
+
+	/* add the tuples to the write page */
+	buf = hash_xlog_getbucketpage(lsn, record, 0, xlrec->node, xlrec->wblkno,
+								  wbucketbuf, xlrec->wbucket_blkno,
+								  wbucket_restored);
+	if (BufferIsValid(buf))
+	{
+		Page		page = BufferGetPage(buf);
+		char	   *ptr = tupdata;
+
+		for (i = 0; i < xlrec->ntups; i++)
+		{
+			IndexTupleData itupdata;
+			Size		itemsz;
+
+			memcpy(&itupdata, ptr, sizeof(IndexTupleData));
+			itemsz = MAXALIGN(IndexTupleDSize(itupdata));
+
+			if (PageAddItem(page, (Item) ptr, itemsz, itup_offsets[i],
+							false, false) == InvalidOffsetNumber)
+				elog(PANIC, "hash_xlog_move_page_contents: failed to add item");
+
+			ptr += itemsz;
+		}
+
+		hash_xlog_donepage(lsn, buf, wbucketbuf);
+	}
+
+	/* and remove them from the read page */
+	buf = hash_xlog_getbucketpage(lsn, record, 1, xlrec->node, xlrec->rblkno,
+								  rbucketbuf, xlrec->rbucket_blkno,
+								  rbucket_restored);
+	if (BufferIsValid(buf))
+	{
+		OffsetNumber deletable[MaxIndexTuplesPerPage];
+
+		/* the offsets aren't aligned in the record */
+		memcpy(deletable, datapos, xlrec->ntups * sizeof(OffsetNumber));
+		PageIndexMultiDelete(BufferGetPage(buf), deletable, xlrec->ntups);
+
+		hash_xlog_donepage(lsn, buf, rbucketbuf);
+	}
+
+	if (BufferIsValid(rbucketbuf) && rbucketbuf != wbucketbuf)
+		UnlockReleaseBuffer(rbucketbuf);
+	if (BufferIsValid(wbucketbuf))
+		UnlockReleaseBuffer(wbucketbuf);
+}
+
+static void
+hash_xlog_free_ovfl_page(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_free_ovfl_page *xlrec = (xl_hash_free_ovfl_page *) XLogRecGetData(record);
+	Buffer		bucketbuf;
+	bool		bucket_restored;
+	Buffer		buf;
+	Page		page;
+	HashPageOpaque opaque;
+	int			bkpidx = 0;
+	int			prev_bkpidx = -1;
+	int			next_bkpidx = -1;
+
+	if (BlockNumberIsValid(xlrec->prevblkno))
+		prev_bkpidx = bkpidx++;
+	if (BlockNumberIsValid(xlrec->nextblkno))
+		next_bkpidx = bkpidx++;
+
+	/*
+	 * Lock out hot standby scans of the bucket.  Its primary page can only
+	 * be the previous page of the one being freed.
+	 */
+	bucketbuf = hash_xlog_lock_bucket(lsn, record, xlrec->node,
+									  xlrec->bucket_blkno,
+									  (xlrec->prevblkno == xlrec->bucket_blkno) ?
+									  prev_bkpidx : -1,
+									  &bucket_restored);
+
+	/* the freed page is reinitialized as an unused page */
+	buf = hash_xlog_initpage(xlrec->node, xlrec->ovflblkno);
+	page = BufferGetPage(buf);
+	_hash_pageinit(page, BufferGetPageSize(buf));
+	opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+	opaque->hasho_prevblkno = InvalidBlockNumber;
+	opaque->hasho_nextblkno = InvalidBlockNumber;
+	opaque->hasho_bucket = -1;
+	opaque->hasho_flag = LH_UNUSED_PAGE;
+	opaque->hasho_page_id = HASHO_PAGE_ID;
+	hash_xlog_donepage(lsn, buf, InvalidBuffer);
+
+	/* unlink it from the bucket chain */
+	if (prev_bkpidx >= 0)
+	{
+		buf = hash_xlog_getbucketpage(lsn, record, prev_bkpidx, xlrec->node,
+									  xlrec->prevblkno, bucketbuf,
+									  xlrec->bucket_blkno, bucket_restored);
+		if (BufferIsValid(buf))
+		{
+			opaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(buf));
+			opaque->hasho_nextblkno = xlrec->nextblkno;
+			hash_xlog_donepage(lsn, buf, bucketbuf);
+		}
+	}
+
+	if (next_bkpidx >= 0)
+	{
+		buf = hash_xlog_getpage(lsn, record, next_bkpidx, xlrec->node,
+								xlrec->nextblkno);
+		if (BufferIsValid(buf))
+		{
+			opaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(buf));
+			opaque->hasho_prevblkno = xlrec->prevblkno;
+			hash_xlog_donepage(lsn, buf, InvalidBuffer);
+		}
+	}
+
+	/* mark it free in the bitmap */
+	buf = hash_xlog_getpage(lsn, record, bkpidx++, xlrec->node,
+							xlrec->mapblkno);
+	if (BufferIsValid(buf))
+	{
+		uint32	   *freep = HashPageGetBitmap(BufferGetPage(buf));
+
+		CLRBIT(freep, xlrec->bitmapbit);
+		hash_xlog_donepage(lsn, buf, InvalidBuffer);
+	}
+
+	if (xlrec->update_firstfree)
+	{
+		buf = hash_xlog_getpage(lsn, record, bkpidx, xlrec->node,
+								HASH_METAPAGE);
+		if (BufferIsValid(buf))
+		{
+			HashMetaPage metap = HashPageGetMeta(BufferGetPage(buf));
+
+			metap->hashm_firstfree = xlrec->firstfree;
+			hash_xlog_donepage(lsn, buf, InvalidBuffer);
+		}
+	}
+
+	if (BufferIsValid(bucketbuf))
+		UnlockReleaseBuffer(bucketbuf);
+}
+
+static void
+hash_xlog_delete(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_delete *xlrec = (xl_hash_delete *) XLogRecGetData(record);
+	Buffer		bucketbuf;
+	bool		bucket_restored;
+	Buffer		buf;
+
+	/* lock out hot standby scans of the bucket */
+	bucketbuf = hash_xlog_lock_bucket(lsn, record, xlrec->node,
+									  xlrec->bucket_blkno,
+									  (xlrec->blkno == xlrec->bucket_blkno) ?
+									  0 : -1,
+									  &bucket_restored);
+
+	buf = hash_xlog_getbucketpage(lsn, record, 0, xlrec->node, xlrec->blkno,
+								  bucketbuf, xlrec->bucket_blkno,
+								  bucket_restored);
+	if (BufferIsValid(buf))
+	{
+		char	   *datapos = (char *) xlrec + SizeOfHashDelete;
+		int			ndeletable;
+		OffsetNumber deletable[MaxIndexTuplesPerPage];
+
+		ndeletable = (record->xl_len - SizeOfHashDelete) / sizeof(OffsetNumber);
+
+		/* the offsets aren't aligned in the record */
+		memcpy(deletable, datapos, ndeletable * sizeof(OffsetNumber));
+		PageIndexMultiDelete(BufferGetPage(buf), deletable, ndeletable);
+
+		hash_xlog_donepage(lsn, buf, bucketbuf);
+	}
+
+	if (BufferIsValid(bucketbuf))
+		UnlockReleaseBuffer(bucketbuf);
+}
+
+static void
+hash_xlog_update_meta_page(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_update_meta_page *xlrec = (xl_hash_update_meta_page *) XLogRecGetData(record);
+	Buffer		buf;
+
+	buf = hash_xlog_getpage(lsn, record, 0, xlrec->node, HASH_METAPAGE);
+	if (BufferIsValid(buf))
+	{
+		HashMetaPage metap = HashPageGetMeta(BufferGetPage(buf));
+
+		metap->hashm_ntuples = xlrec->ntuples;
+		hash_xlog_donepage(lsn, buf, InvalidBuffer);
+	}
+}
+
+void
+hash_redo(XLogRecPtr lsn, XLogRecord *record)
+{
+	uint8		info = record->xl_info & ~XLR_INFO_MASK;
+
+	switch (info)
+	{
+		case XLOG_HASH_INSERT:
+			hash_xlog_insert(lsn, record);
+			break;
+		case XLOG_HASH_ADD_OVFL_PAGE:
+			hash_xlog_add_ovfl_page(lsn, record);
+			break;
+		case XLOG_HASH_SPLIT_ALLOCATE_PAGE:
+			hash_xlog_split_allocate_page(lsn, record);
+			break;
+		case XLOG_HASH_SPLIT_COMPLETE:
+			hash_xlog_split_complete(lsn, record);
+			break;
+		case XLOG_HASH_MOVE_PAGE_CONTENTS:
+			hash_xlog_move_page_contents(lsn, record);
+			break;
+		case XLOG_HASH_FREE_OVFL_PAGE:
+			hash_xlog_free_ovfl_page(lsn, record);
+			break;
+		case XLOG_HASH_DELETE:
+			hash_xlog_delete(lsn, record);
+			break;
+		case XLOG_HASH_UPDATE_META_PAGE:
+			hash_xlog_update_meta_page(lsn, record);
+			break;
+		default:
+			elog(PANIC, "hash_redo: unknown op code %u", info);
+	}
+}
@@ -16,6 +16,8 @@
 #include "postgres.h"
 
 #include "access/hash.h"
+#include "access/hash_xlog.h"
+#include "miscadmin.h"
 #include "utils/rel.h"
 
 
@@ -38,8 +40,10 @@ _hash_doinsert(Relation rel, IndexTuple itup)
 	HashPageOpaque pageopaque;
 	Size		itemsz;
 	bool		do_expand;
+	bool		split_in_progress;
 	uint32		hashkey;
 	Bucket		bucket;
+	OffsetNumber itup_off;
 
 	/*
 	 * Get the hash key for the item (it's stored in the index tuple itself).
@@ -116,6 +120,13 @@ _hash_doinsert(Relation rel, IndexTuple itup)
 	pageopaque = (HashPageOpaque) PageGetSpecialPointer(page);
 	Assert(pageopaque->hasho_bucket == bucket);
 
+	/*
+	 * If a split of this bucket was interrupted, remember to try to finish
+	 * it once we're done with the insertion.
+	 */
+	split_in_progress = H_BUCKET_BEING_SPLIT(pageopaque) ||
+		H_BUCKET_BEING_POPULATED(pageopaque);
+
 	/* Do the insertion */
 	while (PageGetFreeSpace(page) < itemsz)
 	{
@@ -141,10 +152,7 @@ _hash_doinsert(Relation rel, IndexTuple itup)
 			 * page with enough room.  allocate a new overflow page.
 			 */
 
-			/* release our write lock without modifying buffer */
-			_hash_chgbufaccess(rel, buf, HASH_READ, HASH_NOLOCK);
-
-			/* chain to a new overflow page */
+			/* chain to a new overflow page (this releases buf) */
 			buf = _hash_addovflpage(rel, metabuf, buf);
 			page = BufferGetPage(buf);
 
@@ -156,29 +164,78 @@ _hash_doinsert(Relation rel, IndexTuple itup)
 		Assert(pageopaque->hasho_bucket == bucket);
 	}
 
-	/* found page with enough space, so add the item here */
-	(void) _hash_pgaddtup(rel, buf, itemsz, itup);
-
-	/* write and release the modified page */
-	_hash_wrtbuf(rel, buf);
-
-	/* We can drop the bucket lock now */
-	_hash_droplock(rel, blkno, HASH_SHARE);
-
 	/*
-	 * Write-lock the metapage so we can increment the tuple count. After
-	 * incrementing it, check to see if it's time for a split.
+	 * Write-lock the metapage so we can increment the tuple count in the
+	 * same atomic action as the insertion itself.
 	 */
 	_hash_chgbufaccess(rel, metabuf, HASH_NOLOCK, HASH_WRITE);
 
+	/* Do the update.  No ereport(ERROR) until changes are logged */
+	START_CRIT_SECTION();
+
+	/* found page with enough space, so add the item here */
+	itup_off = _hash_pgaddtup(rel, buf, itemsz, itup);
+	MarkBufferDirty(buf);
+
 	metap->hashm_ntuples += 1;
+	MarkBufferDirty(metabuf);
+
+	/* XLOG stuff */
+	if (RelationNeedsWAL(rel))
+	{
+		xl_hash_insert xlrec;
+		XLogRecPtr	recptr;
+		XLogRecData rdata[3];
+
+		xlrec.node = rel->rd_node;
+		xlrec.blkno = BufferGetBlockNumber(buf);
+		xlrec.offnum = itup_off;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = SizeOfHashInsert;
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &(rdata[1]);
+
+		rdata[1].data = (char *) itup;
+		rdata[1].len = IndexTupleDSize(*itup);
+		rdata[1].buffer = buf;
+		rdata[1].buffer_std = true;
+		rdata[1].next = &(rdata[2]);
+
+		/* the metapage keeps its data in the "hole", so it's not standard */
+		rdata[2].data = NULL;
+		rdata[2].len = 0;
+		rdata[2].buffer = metabuf;
+		rdata[2].buffer_std = false;
+		rdata[2].next = NULL;
+
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_INSERT, rdata);
+
+		PageSetLSN(page, recptr);
+		PageSetLSN(BufferGetPage(metabuf), recptr);
+	}
+
+	END_CRIT_SECTION();
 
 	/* Make sure this stays in sync with _hash_expandtable() */
 	do_expand = metap->hashm_ntuples >
 		(double) metap->hashm_ffactor * (metap->hashm_maxbucket + 1);
 
-	/* Write out the metapage and drop lock, but keep pin */
-	_hash_chgbufaccess(rel, metabuf, HASH_WRITE, HASH_NOLOCK);
+	/* drop lock on metapage (already marked dirty), but keep pin */
+	_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
+
+	/* release the modified page */
+	_hash_relbuf(rel, buf);
+
+	/* We can drop the bucket lock now */
+	_hash_droplock(rel, blkno, HASH_SHARE);
+
+	/*
+	 * Help a split of our bucket that was interrupted to completion, so that
+	 * scans of the buckets involved don't have to keep visiting both.
+	 */
+	if (split_in_progress)
+		_hash_finish_split(rel, metabuf, bucket);
 
 	/* Attempt to split if a split is needed */
 	if (do_expand)
@@ -220,3 +277,114 @@ _hash_pgaddtup(Relation rel, Buffer buf, Size itemsize, IndexTuple itup)
 
 	return itup_off;
 }
+
+/*
+ *	_hash_movetuples() -- move a batch of tuples from one page to another.
+ *
+ * The tuples in itups[], which are located at the offsets deletable[] on the
+ * page in 'rbuf', are added to the page in 'wbuf' and removed from 'rbuf',
+ * as one atomic, WAL-logged action.  Both buffers must be pinned and
+ * write-locked, and the caller must have checked that the tuples fit; the
+ * buffers are left in the same state.  deletable[] must be in ascending
+ * order.
+ *
+ * wbucket_blkno and rbucket_blkno are the primary pages of the buckets the
+ * two pages belong to.  They are the same bucket when squeezing a bucket,
+ * and the new and the old bucket when splitting one.
+ */
+void
+_hash_movetuples(Relation rel, Buffer wbuf, Buffer rbuf,
+				 BlockNumber wbucket_blkno, BlockNumber rbucket_blkno,
+				 IndexTuple *itups, OffsetNumber *deletable, uint16 nitups)
+{
+	OffsetNumber itup_offsets[MaxIndexTuplesPerPage];
+	char	   *tupdata = NULL;
+	Size		tupdatalen = 0;
+	bool		needwal = RelationNeedsWAL(rel);
+	uint16		i;
+
+	Assert(nitups > 0 && nitups <= MaxIndexTuplesPerPage);
+
+	/*
+	 * The tuples live on the page we're about to remove them from, so copy
+	 * them for the WAL record first.
+	 */
+	if (needwal)
+	{
+		char	   *ptr;
+
+		for (i = 0; i < nitups; i++)
+			tupdatalen += MAXALIGN(IndexTupleDSize(*itups[i]));
+
+		ptr = tupdata = palloc0(tupdatalen);
+		for (i = 0; i < nitups; i++)
+		{
+			Size		itemsz = IndexTupleDSize(*itups[i]);
+
+			memcpy(ptr, itups[i], itemsz);
+			ptr += MAXALIGN(itemsz);
+		}
+	}
+
+	/* No ereport(ERROR) until changes are logged */
+	START_CRIT_SECTION();
+
+	for (i = 0; i < nitups; i++)
+	{
+		Size		itemsz = MAXALIGN(IndexTupleDSize(*itups[i]));
+
+		itup_offsets[i] = _hash_pgaddtup(rel, wbuf, itemsz, itups[i]);
+	}
+	PageIndexMultiDelete(BufferGetPage(rbuf), deletable, nitups);
+
+	MarkBufferDirty(wbuf);
+	MarkBufferDirty(rbuf);
+
+	/* XLOG stuff */
+	if (needwal)
+	{
+		xl_hash_move_page_contents xlrec;
+		XLogRecPtr	recptr;
+		XLogRecData rdata[4];
+
+		xlrec.node = rel->rd_node;
+		xlrec.wbucket_blkno = wbucket_blkno;
+		xlrec.rbucket_blkno = rbucket_blkno;
+		xlrec.wblkno = BufferGetBlockNumber(wbuf);
+		xlrec.rblkno = BufferGetBlockNumber(rbuf);
+		xlrec.ntups = nitups;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = SizeOfHashMovePageContents;
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &(rdata[1]);
+
+		rdata[1].data = (char *) itup_offsets;
+		rdata[1].len = nitups * sizeof(OffsetNumber);
+		rdata[1].buffer = wbuf;
+		rdata[1].buffer_std = true;
+		rdata[1].next = &(rdata[2]);
+
+		rdata[2].data = tupdata;
+		rdata[2].len = tupdatalen;
+		rdata[2].buffer = wbuf;
+		rdata[2].buffer_std = true;
+		rdata[2].next = &(rdata[3]);
+
+		rdata[3].data = (char *) deletable;
+		rdata[3].len = nitups * sizeof(OffsetNumber);
+		rdata[3].buffer = rbuf;
+		rdata[3].buffer_std = true;
+		rdata[3].next = NULL;
+
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_MOVE_PAGE_CONTENTS, rdata);
+
+		PageSetLSN(BufferGetPage(wbuf), recptr);
+		PageSetLSN(BufferGetPage(rbuf), recptr);
+	}
+
+	END_CRIT_SECTION();
+
+	if (tupdata)
+		pfree(tupdata);
+}
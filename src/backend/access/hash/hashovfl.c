@@ -18,10 +18,12 @@
 #include "postgres.h"
 
 #include "access/hash.h"
+#include "access/hash_xlog.h"
+#include "access/heapam_xlog.h"
+#include "miscadmin.h"
 #include "utils/rel.h"
 
 
-static Buffer _hash_getovflpage(Relation rel, Buffer metabuf);
 static uint32 _hash_firstfreebit(uint32 map);
 
 
@@ -80,10 +82,10 @@ blkno_to_bitno(HashMetaPage metap, BlockNumber ovflblkno)
  *
  *	Add an overflow page to the bucket whose last page is pointed to by 'buf'.
  *
- *	On entry, the caller must hold a pin but no lock on 'buf'.	The pin is
- *	dropped before exiting (we assume the caller is not interested in 'buf'
- *	anymore).  The returned overflow page will be pinned and write-locked;
- *	it is guaranteed to be empty.
+ *	On entry, the caller must hold a pin and write lock on 'buf'.  The lock
+ *	and pin are released before exiting (we assume the caller is not
+ *	interested in 'buf' anymore).  The returned overflow page will be pinned
+ *	and write-locked; it is guaranteed to be empty.
  *
  *	The caller must hold a pin, but no lock, on the metapage buffer.
  *	That buffer is returned in the same state.
@@ -92,28 +94,37 @@ blkno_to_bitno(HashMetaPage metap, BlockNumber ovflblkno)
  *	no one else tries to compact the bucket meanwhile.	This guarantees that
  *	'buf' won't stop being part of the bucket while it's unlocked.
  *
- * NB: since this could be executed concurrently by multiple processes,
- * one should not assume that the returned overflow page will be the
- * immediate successor of the originally passed 'buf'.	Additional overflow
- * pages might have been added to the bucket chain in between.
+ * Finding a free overflow page (or extending the index), marking it in use,
+ * initializing it, and linking it to the end of the bucket chain are done
+ * and WAL-logged as one atomic action, so that a crash cannot leak the page
+ * or leave it half-linked.  To that end we hold the lock on the tail page
+ * throughout, and lock bitmap pages before the metapage, like
+ * _hash_freeovflpage does.
  */
 Buffer
 _hash_addovflpage(Relation rel, Buffer metabuf, Buffer buf)
 {
 	Buffer		ovflbuf;
+	Buffer		mapbuf = InvalidBuffer;
+	Buffer		newmapbuf = InvalidBuffer;
 	Page		page;
 	Page		ovflpage;
 	HashPageOpaque pageopaque;
 	HashPageOpaque ovflopaque;
-
-	/* allocate and lock an empty overflow page */
-	ovflbuf = _hash_getovflpage(rel, metabuf);
-
-	/*
-	 * Write-lock the tail page.  It is okay to hold two buffer locks here
-	 * since there cannot be anyone else contending for access to ovflbuf.
-	 */
-	_hash_chgbufaccess(rel, buf, HASH_NOLOCK, HASH_WRITE);
+	HashMetaPage metap;
+	BlockNumber blkno;
+	uint32		orig_firstfree;
+	uint32		splitnum;
+	uint32	   *freep = NULL;
+	uint32		max_ovflpg;
+	uint32		bit;
+	uint32		bitmap_page_bit = 0;
+	uint32		first_page;
+	uint32		last_bit;
+	uint32		last_page;
+	uint32		i,
+				j;
+	bool		page_found = false;
 
 	/* probably redundant... */
 	_hash_checkpage(rel, buf, LH_BUCKET_PAGE | LH_OVERFLOW_PAGE);
@@ -136,52 +147,6 @@ _hash_addovflpage(Relation rel, Buffer metabuf, Buffer buf)
 		buf = _hash_getbuf(rel, nextblkno, HASH_WRITE, LH_OVERFLOW_PAGE);
 	}
 
-	/* now that we have correct backlink, initialize new overflow page */
-	ovflpage = BufferGetPage(ovflbuf);
-	ovflopaque = (HashPageOpaque) PageGetSpecialPointer(ovflpage);
-	ovflopaque->hasho_prevblkno = BufferGetBlockNumber(buf);
-	ovflopaque->hasho_nextblkno = InvalidBlockNumber;
-	ovflopaque->hasho_bucket = pageopaque->hasho_bucket;
-	ovflopaque->hasho_flag = LH_OVERFLOW_PAGE;
-	ovflopaque->hasho_page_id = HASHO_PAGE_ID;
-
-	MarkBufferDirty(ovflbuf);
-
-	/* logically chain overflow page to previous page */
-	pageopaque->hasho_nextblkno = BufferGetBlockNumber(ovflbuf);
-	_hash_wrtbuf(rel, buf);
-
-	return ovflbuf;
-}
-
-/*
- *	_hash_getovflpage()
- *
- *	Find an available overflow page and return it.	The returned buffer
- *	is pinned and write-locked, and has had _hash_pageinit() applied,
- *	but it is caller's responsibility to fill the special space.
- *
- * The caller must hold a pin, but no lock, on the metapage buffer.
- * That buffer is left in the same state at exit.
- */
-static Buffer
-_hash_getovflpage(Relation rel, Buffer metabuf)
-{
-	HashMetaPage metap;
-	Buffer		mapbuf = 0;
-	Buffer		newbuf;
-	BlockNumber blkno;
-	uint32		orig_firstfree;
-	uint32		splitnum;
-	uint32	   *freep = NULL;
-	uint32		max_ovflpg;
-	uint32		bit;
-	uint32		first_page;
-	uint32		last_bit;
-	uint32		last_page;
-	uint32		i,
-				j;
-
 	/* Get exclusive lock on the meta page */
 	_hash_chgbufaccess(rel, metabuf, HASH_NOLOCK, HASH_WRITE);
 
@@ -230,107 +195,224 @@ _hash_getovflpage(Relation rel, Buffer metabuf)
 		for (; bit <= last_inpage; j++, bit += BITS_PER_MAP)
 		{
 			if (freep[j] != ALL_SET)
-				goto found;
+			{
+				page_found = true;
+				break;
+			}
 		}
 
-		/* No free space here, try to advance to next map page */
-		_hash_relbuf(rel, mapbuf);
-		i++;
-		j = 0;					/* scan from start of next map page */
-		bit = 0;
+		/*
+		 * Reacquire exclusive lock on the meta page.  If we found a free bit,
+		 * we keep the bitmap page locked, so that no one else can grab it.
+		 */
+		if (!page_found)
+		{
+			/* No free space here, try to advance to next map page */
+			_hash_relbuf(rel, mapbuf);
+			mapbuf = InvalidBuffer;
+			i++;
+			j = 0;				/* scan from start of next map page */
+			bit = 0;
+		}
 
-		/* Reacquire exclusive lock on the meta page */
 		_hash_chgbufaccess(rel, metabuf, HASH_NOLOCK, HASH_WRITE);
+
+		if (page_found)
+			break;
 	}
 
-	/*
-	 * No free pages --- have to extend the relation to add an overflow page.
-	 * First, check to see if we have to add a new bitmap page too.
-	 */
-	if (last_bit == (uint32) (BMPGSZ_BIT(metap) - 1))
+	if (page_found)
 	{
-		/*
-		 * We create the new bitmap page with all pages marked "in use".
-		 * Actually two pages in the new bitmap's range will exist
-		 * immediately: the bitmap page itself, and the following page which
-		 * is the one we return to the caller.	Both of these are correctly
-		 * marked "in use".  Subsequent pages do not exist yet, but it is
-		 * convenient to pre-mark them as "in use" too.
-		 */
-		bit = metap->hashm_spares[splitnum];
-		_hash_initbitmap(rel, metap, bitno_to_blkno(metap, bit), MAIN_FORKNUM);
-		metap->hashm_spares[splitnum]++;
+		/* convert bit to bit number within page */
+		bit += _hash_firstfreebit(freep[j]);
+		bitmap_page_bit = bit;
+
+		/* convert bit to absolute bit number */
+		bit += (i << BMPG_SHIFT(metap));
+
+		/* Calculate address of the recycled overflow page */
+		blkno = bitno_to_blkno(metap, bit);
+
+		/* Fetch and init the recycled page */
+		ovflbuf = _hash_getinitbuf(rel, blkno);
 	}
 	else
 	{
 		/*
-		 * Nothing to do here; since the page will be past the last used page,
-		 * we know its bitmap bit was preinitialized to "in use".
+		 * No free pages --- have to extend the relation to add an overflow
+		 * page.  First, check to see if we have to add a new bitmap page too.
+		 */
+		if (last_bit == (uint32) (BMPGSZ_BIT(metap) - 1))
+		{
+			/*
+			 * We create the new bitmap page with all pages marked "in use".
+			 * Actually two pages in the new bitmap's range will exist
+			 * immediately: the bitmap page itself, and the following page
+			 * which is the one we return to the caller.  Both of these are
+			 * correctly marked "in use".  Subsequent pages do not exist yet,
+			 * but it is convenient to pre-mark them as "in use" too.
+			 */
+			bit = metap->hashm_spares[splitnum];
+
+			/* metapage already has a write lock */
+			if (metap->hashm_nmaps >= HASH_MAX_BITMAPS)
+				ereport(ERROR,
+						(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+						 errmsg("out of overflow pages in hash index \"%s\"",
+								RelationGetRelationName(rel))));
+
+			newmapbuf = _hash_getnewbuf(rel, bitno_to_blkno(metap, bit),
+										MAIN_FORKNUM);
+		}
+		else
+		{
+			/*
+			 * Nothing to do here; since the page will be past the last used
+			 * page, we know its bitmap bit was preinitialized to "in use".
+			 */
+		}
+
+		/* Calculate address of the new overflow page */
+		bit = metap->hashm_spares[splitnum];
+		if (BufferIsValid(newmapbuf))
+			bit++;
+		blkno = bitno_to_blkno(metap, bit);
+
+		/*
+		 * Fetch the page with _hash_getnewbuf to ensure smgr's idea of the
+		 * relation length stays in sync with ours.  XXX It's annoying to do
+		 * this with metapage write lock held; would be better to use a lock
+		 * that doesn't block incoming searches.
 		 */
+		ovflbuf = _hash_getnewbuf(rel, blkno, MAIN_FORKNUM);
 	}
 
-	/* Calculate address of the new overflow page */
-	bit = metap->hashm_spares[splitnum];
-	blkno = bitno_to_blkno(metap, bit);
+	/* No ereport(ERROR) until changes are logged */
+	START_CRIT_SECTION();
 
-	/*
-	 * Fetch the page with _hash_getnewbuf to ensure smgr's idea of the
-	 * relation length stays in sync with ours.  XXX It's annoying to do this
-	 * with metapage write lock held; would be better to use a lock that
-	 * doesn't block incoming searches.
-	 */
-	newbuf = _hash_getnewbuf(rel, blkno, MAIN_FORKNUM);
+	if (page_found)
+	{
+		/* mark page "in use" in the bitmap */
+		SETBIT(freep, bitmap_page_bit);
+		MarkBufferDirty(mapbuf);
+	}
+	else
+	{
+		if (BufferIsValid(newmapbuf))
+		{
+			_hash_initbitmapbuffer(newmapbuf, metap->hashm_bmsize, false);
+			MarkBufferDirty(newmapbuf);
+
+			/* add the new bitmap page to the metapage's list of bitmaps */
+			metap->hashm_mapp[metap->hashm_nmaps] =
+				BufferGetBlockNumber(newmapbuf);
+			metap->hashm_nmaps++;
+			metap->hashm_spares[splitnum]++;
+		}
 
-	metap->hashm_spares[splitnum]++;
+		metap->hashm_spares[splitnum]++;
+	}
 
 	/*
-	 * Adjust hashm_firstfree to avoid redundant searches.	But don't risk
+	 * Adjust hashm_firstfree to avoid redundant searches.  But don't risk
 	 * changing it if someone moved it while we were searching bitmap pages.
 	 */
 	if (metap->hashm_firstfree == orig_firstfree)
 		metap->hashm_firstfree = bit + 1;
 
-	/* Write updated metapage and release lock, but not pin */
-	_hash_chgbufaccess(rel, metabuf, HASH_WRITE, HASH_NOLOCK);
-
-	return newbuf;
+	MarkBufferDirty(metabuf);
 
-found:
-	/* convert bit to bit number within page */
-	bit += _hash_firstfreebit(freep[j]);
-
-	/* mark page "in use" in the bitmap */
-	SETBIT(freep, bit);
-	_hash_wrtbuf(rel, mapbuf);
+	/* now that we have correct backlink, initialize new overflow page */
+	ovflpage = BufferGetPage(ovflbuf);
+	ovflopaque = (HashPageOpaque) PageGetSpecialPointer(ovflpage);
+	ovflopaque->hasho_prevblkno = BufferGetBlockNumber(buf);
+	ovflopaque->hasho_nextblkno = InvalidBlockNumber;
+	ovflopaque->hasho_bucket = pageopaque->hasho_bucket;
+	ovflopaque->hasho_flag = LH_OVERFLOW_PAGE;
+	ovflopaque->hasho_page_id = HASHO_PAGE_ID;
 
-	/* Reacquire exclusive lock on the meta page */
-	_hash_chgbufaccess(rel, metabuf, HASH_NOLOCK, HASH_WRITE);
+	MarkBufferDirty(ovflbuf);
 
-	/* convert bit to absolute bit number */
-	bit += (i << BMPG_SHIFT(metap));
+	/* logically chain overflow page to previous page */
+	pageopaque->hasho_nextblkno = BufferGetBlockNumber(ovflbuf);
 
-	/* Calculate address of the recycled overflow page */
-	blkno = bitno_to_blkno(metap, bit);
+	MarkBufferDirty(buf);
 
-	/*
-	 * Adjust hashm_firstfree to avoid redundant searches.	But don't risk
-	 * changing it if someone moved it while we were searching bitmap pages.
-	 */
-	if (metap->hashm_firstfree == orig_firstfree)
+	/* XLOG stuff */
+	if (RelationNeedsWAL(rel))
 	{
-		metap->hashm_firstfree = bit + 1;
+		xl_hash_add_ovfl_page xlrec;
+		XLogRecPtr	recptr;
+		XLogRecData rdata[4];
+		XLogRecData *lastrdata;
+
+		xlrec.node = rel->rd_node;
+		xlrec.bucket = pageopaque->hasho_bucket;
+		xlrec.ovflblkno = BufferGetBlockNumber(ovflbuf);
+		xlrec.prevblkno = BufferGetBlockNumber(buf);
+		xlrec.mapblkno = page_found ?
+			BufferGetBlockNumber(mapbuf) : InvalidBlockNumber;
+		xlrec.bitmapbit = bitmap_page_bit;
+		xlrec.newmapblkno = BufferIsValid(newmapbuf) ?
+			BufferGetBlockNumber(newmapbuf) : InvalidBlockNumber;
+		xlrec.firstfree = metap->hashm_firstfree;
+		xlrec.spares = metap->hashm_spares[metap->hashm_ovflpoint];
+		xlrec.bmsize = metap->hashm_bmsize;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = SizeOfHashAddOvflPage;
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &(rdata[1]);
+
+		rdata[1].data = NULL;
+		rdata[1].len = 0;
+		rdata[1].buffer = buf;
+		rdata[1].buffer_std = true;
+		lastrdata = &(rdata[1]);
+
+		/* bitmap and metapages keep their data in the "hole" */
+		if (page_found)
+		{
+			lastrdata->next = &(rdata[2]);
+			lastrdata = &(rdata[2]);
+			lastrdata->data = NULL;
+			lastrdata->len = 0;
+			lastrdata->buffer = mapbuf;
+			lastrdata->buffer_std = false;
+		}
 
-		/* Write updated metapage and release lock, but not pin */
-		_hash_chgbufaccess(rel, metabuf, HASH_WRITE, HASH_NOLOCK);
-	}
-	else
-	{
-		/* We didn't change the metapage, so no need to write */
-		_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
+		lastrdata->next = &(rdata[3]);
+		lastrdata = &(rdata[3]);
+		lastrdata->data = NULL;
+		lastrdata->len = 0;
+		lastrdata->buffer = metabuf;
+		lastrdata->buffer_std = false;
+		lastrdata->next = NULL;
+
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_ADD_OVFL_PAGE, rdata);
+
+		PageSetLSN(ovflpage, recptr);
+		PageSetLSN(page, recptr);
+		if (BufferIsValid(mapbuf))
+			PageSetLSN(BufferGetPage(mapbuf), recptr);
+		if (BufferIsValid(newmapbuf))
+			PageSetLSN(BufferGetPage(newmapbuf), recptr);
+		PageSetLSN(BufferGetPage(metabuf), recptr);
 	}
 
-	/* Fetch, init, and return the recycled page */
-	return _hash_getinitbuf(rel, blkno);
+	END_CRIT_SECTION();
+
+	if (BufferIsValid(mapbuf))
+		_hash_relbuf(rel, mapbuf);
+	if (BufferIsValid(newmapbuf))
+		_hash_relbuf(rel, newmapbuf);
+
+	/* Release the metapage lock (buffer already marked dirty), keep pin */
+	_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
+
+	_hash_relbuf(rel, buf);
+
+	return ovflbuf;
 }
 
 /*
@@ -363,6 +445,9 @@ _hash_firstfreebit(uint32 map)
  *	Remove this overflow page from its bucket's chain, and mark the page as
  *	free.  On entry, ovflbuf is write-locked; it is released before exiting.
  *
+ *	'bucket_blkno' is the primary page of the bucket; it's recorded in the
+ *	WAL record, so that replay can lock out hot standby scans of the bucket.
+ *
  *	Since this function is invoked in VACUUM, we provide an access strategy
  *	parameter that controls fetches of the bucket pages.
  *
@@ -374,12 +459,14 @@ _hash_firstfreebit(uint32 map)
  *	on the bucket, too.
  */
 BlockNumber
-_hash_freeovflpage(Relation rel, Buffer ovflbuf,
+_hash_freeovflpage(Relation rel, BlockNumber bucket_blkno, Buffer ovflbuf,
 				   BufferAccessStrategy bstrategy)
 {
 	HashMetaPage metap;
 	Buffer		metabuf;
 	Buffer		mapbuf;
+	Buffer		prevbuf = InvalidBuffer;
+	Buffer		nextbuf = InvalidBuffer;
 	BlockNumber ovflblkno;
 	BlockNumber prevblkno;
 	BlockNumber blkno;
@@ -391,6 +478,7 @@ _hash_freeovflpage(Relation rel, Buffer ovflbuf,
 	uint32		ovflbitno;
 	int32		bitmappage,
 				bitmapbit;
+	bool		update_firstfree = false;
 	Bucket bucket PG_USED_FOR_ASSERTS_ONLY;
 
 	/* Get information from the doomed page */
@@ -402,51 +490,6 @@ _hash_freeovflpage(Relation rel, Buffer ovflbuf,
 	prevblkno = ovflopaque->hasho_prevblkno;
 	bucket = ovflopaque->hasho_bucket;
 
-	/*
-	 * Zero the page for debugging's sake; then write and release it. (Note:
-	 * if we failed to zero the page here, we'd have problems with the Assert
-	 * in _hash_pageinit() when the page is reused.)
-	 */
-	MemSet(ovflpage, 0, BufferGetPageSize(ovflbuf));
-	_hash_wrtbuf(rel, ovflbuf);
-
-	/*
-	 * Fix up the bucket chain.  this is a doubly-linked list, so we must fix
-	 * up the bucket chain members behind and ahead of the overflow page being
-	 * deleted.  No concurrency issues since we hold exclusive lock on the
-	 * entire bucket.
-	 */
-	if (BlockNumberIsValid(prevblkno))
-	{
-		Buffer		prevbuf = _hash_getbuf_with_strategy(rel,
-														 prevblkno,
-														 HASH_WRITE,
-										   LH_BUCKET_PAGE | LH_OVERFLOW_PAGE,
-														 bstrategy);
-		Page		prevpage = BufferGetPage(prevbuf);
-		HashPageOpaque prevopaque = (HashPageOpaque) PageGetSpecialPointer(prevpage);
-
-		Assert(prevopaque->hasho_bucket == bucket);
-		prevopaque->hasho_nextblkno = nextblkno;
-		_hash_wrtbuf(rel, prevbuf);
-	}
-	if (BlockNumberIsValid(nextblkno))
-	{
-		Buffer		nextbuf = _hash_getbuf_with_strategy(rel,
-														 nextblkno,
-														 HASH_WRITE,
-														 LH_OVERFLOW_PAGE,
-														 bstrategy);
-		Page		nextpage = BufferGetPage(nextbuf);
-		HashPageOpaque nextopaque = (HashPageOpaque) PageGetSpecialPointer(nextpage);
-
-		Assert(nextopaque->hasho_bucket == bucket);
-		nextopaque->hasho_prevblkno = prevblkno;
-		_hash_wrtbuf(rel, nextbuf);
-	}
-
-	/* Note: bstrategy is intentionally not used for metapage and bitmap */
-
 	/* Read the metapage so we can determine which bitmap page to use */
 	metabuf = _hash_getbuf(rel, HASH_METAPAGE, HASH_READ, LH_META_PAGE);
 	metap = HashPageGetMeta(BufferGetPage(metabuf));
@@ -461,32 +504,175 @@ _hash_freeovflpage(Relation rel, Buffer ovflbuf,
 		elog(ERROR, "invalid overflow bit number %u", ovflbitno);
 	blkno = metap->hashm_mapp[bitmappage];
 
-	/* Release metapage lock while we access the bitmap page */
+	/* Release metapage lock while we access the other pages */
 	_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
 
-	/* Clear the bitmap bit to indicate that this overflow page is free */
+	/*
+	 * Lock the bucket chain members behind and ahead of the overflow page
+	 * being deleted, so we can fix up the chain.  No concurrency issues since
+	 * we hold exclusive lock on the entire bucket.
+	 */
+	if (BlockNumberIsValid(prevblkno))
+	{
+		prevbuf = _hash_getbuf_with_strategy(rel,
+											 prevblkno,
+											 HASH_WRITE,
+										   LH_BUCKET_PAGE | LH_OVERFLOW_PAGE,
+											 bstrategy);
+		Assert(((HashPageOpaque) PageGetSpecialPointer(BufferGetPage(prevbuf)))->hasho_bucket == bucket);
+	}
+	if (BlockNumberIsValid(nextblkno))
+	{
+		nextbuf = _hash_getbuf_with_strategy(rel,
+											 nextblkno,
+											 HASH_WRITE,
+											 LH_OVERFLOW_PAGE,
+											 bstrategy);
+		Assert(((HashPageOpaque) PageGetSpecialPointer(BufferGetPage(nextbuf)))->hasho_bucket == bucket);
+	}
+
+	/* Note: bstrategy is intentionally not used for metapage and bitmap */
+
 	mapbuf = _hash_getbuf(rel, blkno, HASH_WRITE, LH_BITMAP_PAGE);
 	mappage = BufferGetPage(mapbuf);
 	freep = HashPageGetBitmap(mappage);
 	Assert(ISSET(freep, bitmapbit));
-	CLRBIT(freep, bitmapbit);
-	_hash_wrtbuf(rel, mapbuf);
 
 	/* Get write-lock on metapage to update firstfree */
 	_hash_chgbufaccess(rel, metabuf, HASH_NOLOCK, HASH_WRITE);
 
+	/* No ereport(ERROR) until changes are logged */
+	START_CRIT_SECTION();
+
+	/*
+	 * Reinitialize the freed page as an empty page of no particular type.  We
+	 * used to just zero it, but it needs a valid page header now, to carry
+	 * the LSN of the WAL record.
+	 */
+	MemSet(ovflpage, 0, BufferGetPageSize(ovflbuf));
+	_hash_pageinit(ovflpage, BufferGetPageSize(ovflbuf));
+	ovflopaque = (HashPageOpaque) PageGetSpecialPointer(ovflpage);
+	ovflopaque->hasho_prevblkno = InvalidBlockNumber;
+	ovflopaque->hasho_nextblkno = InvalidBlockNumber;
+	ovflopaque->hasho_bucket = -1;
+	ovflopaque->hasho_flag = LH_UNUSED_PAGE;
+	ovflopaque->hasho_page_id = HASHO_PAGE_ID;
+	MarkBufferDirty(ovflbuf);
+
+	/* Fix up the bucket chain; it's a doubly-linked list */
+	if (BufferIsValid(prevbuf))
+	{
+		HashPageOpaque prevopaque;
+
+		prevopaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(prevbuf));
+		prevopaque->hasho_nextblkno = nextblkno;
+		MarkBufferDirty(prevbuf);
+	}
+	if (BufferIsValid(nextbuf))
+	{
+		HashPageOpaque nextopaque;
+
+		nextopaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(nextbuf));
+		nextopaque->hasho_prevblkno = prevblkno;
+		MarkBufferDirty(nextbuf);
+	}
+
+	/* Clear the bitmap bit to indicate that this overflow page is free */
+	CLRBIT(freep, bitmapbit);
+	MarkBufferDirty(mapbuf);
+
 	/* if this is now the first free page, update hashm_firstfree */
 	if (ovflbitno < metap->hashm_firstfree)
 	{
 		metap->hashm_firstfree = ovflbitno;
-		_hash_wrtbuf(rel, metabuf);
+		update_firstfree = true;
+		MarkBufferDirty(metabuf);
 	}
-	else
+
+	/* XLOG stuff */
+	if (RelationNeedsWAL(rel))
 	{
-		/* no need to change metapage */
-		_hash_relbuf(rel, metabuf);
+		xl_hash_free_ovfl_page xlrec;
+		XLogRecPtr	recptr;
+		XLogRecData rdata[5];
+		XLogRecData *lastrdata;
+
+		xlrec.node = rel->rd_node;
+		xlrec.bucket_blkno = bucket_blkno;
+		xlrec.ovflblkno = ovflblkno;
+		xlrec.prevblkno = prevblkno;
+		xlrec.nextblkno = nextblkno;
+		xlrec.mapblkno = blkno;
+		xlrec.bitmapbit = bitmapbit;
+		xlrec.firstfree = ovflbitno;
+		xlrec.update_firstfree = update_firstfree;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = SizeOfHashFreeOvflPage;
+		rdata[0].buffer = InvalidBuffer;
+		lastrdata = &(rdata[0]);
+
+		if (BufferIsValid(prevbuf))
+		{
+			lastrdata->next = &(rdata[1]);
+			lastrdata = &(rdata[1]);
+			lastrdata->data = NULL;
+			lastrdata->len = 0;
+			lastrdata->buffer = prevbuf;
+			lastrdata->buffer_std = true;
+		}
+
+		if (BufferIsValid(nextbuf))
+		{
+			lastrdata->next = &(rdata[2]);
+			lastrdata = &(rdata[2]);
+			lastrdata->data = NULL;
+			lastrdata->len = 0;
+			lastrdata->buffer = nextbuf;
+			lastrdata->buffer_std = true;
+		}
+
+		/* bitmap and metapages keep their data in the "hole" */
+		lastrdata->next = &(rdata[3]);
+		lastrdata = &(rdata[3]);
+		lastrdata->data = NULL;
+		lastrdata->len = 0;
+		lastrdata->buffer = mapbuf;
+		lastrdata->buffer_std = false;
+
+		if (update_firstfree)
+		{
+			lastrdata->next = &(rdata[4]);
+			lastrdata = &(rdata[4]);
+			lastrdata->data = NULL;
+			lastrdata->len = 0;
+			lastrdata->buffer = metabuf;
+			lastrdata->buffer_std = false;
+		}
+		lastrdata->next = NULL;
+
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_FREE_OVFL_PAGE, rdata);
+
+		PageSetLSN(ovflpage, recptr);
+		if (BufferIsValid(prevbuf))
+			PageSetLSN(BufferGetPage(prevbuf), recptr);
+		if (BufferIsValid(nextbuf))
+			PageSetLSN(BufferGetPage(nextbuf), recptr);
+		PageSetLSN(mappage, recptr);
+		if (update_firstfree)
+			PageSetLSN(BufferGetPage(metabuf), recptr);
 	}
 
+	END_CRIT_SECTION();
+
+	_hash_relbuf(rel, ovflbuf);
+	if (BufferIsValid(prevbuf))
+		_hash_relbuf(rel, prevbuf);
+	if (BufferIsValid(nextbuf))
+		_hash_relbuf(rel, nextbuf);
+	_hash_relbuf(rel, mapbuf);
+	_hash_relbuf(rel, metabuf);
+
 	return nextblkno;
 }
 
@@ -499,44 +685,37 @@ _hash_freeovflpage(Relation rel, Buffer ovflbuf,
  *
  * 'blkno' is the block number of the new bitmap page.
  *
- * All bits in the new bitmap page are set to "1", indicating "in use".
+ * This is only used while building the index; bitmap pages added later are
+ * set up by _hash_addovflpage.
  */
 void
 _hash_initbitmap(Relation rel, HashMetaPage metap, BlockNumber blkno,
 				 ForkNumber forkNum)
 {
 	Buffer		buf;
-	Page		pg;
-	HashPageOpaque op;
-	uint32	   *freep;
 
 	/*
 	 * It is okay to write-lock the new bitmap page while holding metapage
 	 * write lock, because no one else could be contending for the new page.
 	 * Also, the metapage lock makes it safe to extend the index using
 	 * _hash_getnewbuf.
-	 *
-	 * There is some loss of concurrency in possibly doing I/O for the new
-	 * page while holding the metapage lock, but this path is taken so seldom
-	 * that it's not worth worrying about.
 	 */
 	buf = _hash_getnewbuf(rel, blkno, forkNum);
-	pg = BufferGetPage(buf);
 
-	/* initialize the page's special space */
-	op = (HashPageOpaque) PageGetSpecialPointer(pg);
-	op->hasho_prevblkno = InvalidBlockNumber;
-	op->hasho_nextblkno = InvalidBlockNumber;
-	op->hasho_bucket = -1;
-	op->hasho_flag = LH_BITMAP_PAGE;
-	op->hasho_page_id = HASHO_PAGE_ID;
+	_hash_initbitmapbuffer(buf, metap->hashm_bmsize, false);
 
-	/* set all of the bits to 1 */
-	freep = HashPageGetBitmap(pg);
-	MemSet(freep, 0xFF, BMPGSZ_BYTE(metap));
+	/* log the new page, unless the index doesn't need WAL */
+	if (RelationNeedsWAL(rel) || forkNum == INIT_FORKNUM)
+	{
+		START_CRIT_SECTION();
+		MarkBufferDirty(buf);
+		log_newpage_buffer(buf);
+		END_CRIT_SECTION();
+	}
+	else
+		MarkBufferDirty(buf);
 
-	/* write out the new bitmap page (releasing write lock and pin) */
-	_hash_wrtbuf(rel, buf);
+	_hash_relbuf(rel, buf);
 
 	/* add the new bitmap page to the metapage's list of bitmaps */
 	/* metapage already has a write lock */
@@ -551,6 +730,41 @@ _hash_initbitmap(Relation rel, HashMetaPage metap, BlockNumber blkno,
 	metap->hashm_nmaps++;
 }
 
+/*
+ *	_hash_initbitmapbuffer()
+ *
+ *	 Initialize the contents of a new bitmap page, with all bits set to "1",
+ *	 indicating "in use".  If 'initpage' is true, the page header is
+ *	 initialized first; the page must be all-zero then.
+ *
+ *	 The caller must hold a write lock on the buffer; it is responsible for
+ *	 marking it dirty and WAL-logging the change.
+ */
+void
+_hash_initbitmapbuffer(Buffer buf, uint16 bmsize, bool initpage)
+{
+	Page		pg;
+	HashPageOpaque op;
+	uint32	   *freep;
+
+	pg = BufferGetPage(buf);
+
+	if (initpage)
+		_hash_pageinit(pg, BufferGetPageSize(buf));
+
+	/* initialize the page's special space */
+	op = (HashPageOpaque) PageGetSpecialPointer(pg);
+	op->hasho_prevblkno = InvalidBlockNumber;
+	op->hasho_nextblkno = InvalidBlockNumber;
+	op->hasho_bucket = -1;
+	op->hasho_flag = LH_BITMAP_PAGE;
+	op->hasho_page_id = HASHO_PAGE_ID;
+
+	/* set all of the bits to 1 */
+	freep = HashPageGetBitmap(pg);
+	MemSet(freep, 0xFF, bmsize);
+}
+
 
 /*
  *	_hash_squeezebucket(rel, bucket)
@@ -570,6 +784,9 @@ _hash_initbitmap(Relation rel, HashMetaPage metap, BlockNumber blkno,
  *	required that to be true on entry as well, but it's a lot easier for
  *	callers to leave empty overflow pages and let this guy clean it up.
  *
+ *	Tuples are moved in batches, as many as fit on the write page at a time,
+ *	each batch being one atomic WAL-logged action (see _hash_movetuples).
+ *
  *	Caller must hold exclusive lock on the target bucket.  This allows
  *	us to safely lock multiple pages in the bucket.
  *
@@ -590,7 +807,6 @@ _hash_squeezebucket(Relation rel,
 	Page		rpage;
 	HashPageOpaque wopaque;
 	HashPageOpaque ropaque;
-	bool		wbuf_dirty;
 
 	/*
 	 * start squeezing into the base bucket page.
@@ -639,15 +855,20 @@ _hash_squeezebucket(Relation rel,
 	/*
 	 * squeeze the tuples.
 	 */
-	wbuf_dirty = false;
 	for (;;)
 	{
 		OffsetNumber roffnum;
 		OffsetNumber maxroffnum;
-		OffsetNumber deletable[MaxOffsetNumber];
-		int			ndeletable = 0;
+		OffsetNumber deletable[MaxIndexTuplesPerPage];
+		IndexTuple	itups[MaxIndexTuplesPerPage];
+		uint16		ndeletable = 0;
+		Size		freespace;
 
-		/* Scan each tuple in "read" page */
+		/*
+		 * Collect the tuples from the "read" page that fit on the "write"
+		 * page, in order.
+		 */
+		freespace = PageGetFreeSpace(wpage);
 		maxroffnum = PageGetMaxOffsetNumber(rpage);
 		for (roffnum = FirstOffsetNumber;
 			 roffnum <= maxroffnum;
@@ -661,58 +882,54 @@ _hash_squeezebucket(Relation rel,
 			itemsz = IndexTupleDSize(*itup);
 			itemsz = MAXALIGN(itemsz);
 
+			if (itemsz > freespace)
+				break;
+
+			itups[ndeletable] = itup;
+			deletable[ndeletable++] = roffnum;
+
+			/* PageGetFreeSpace has already deducted one line pointer */
+			if (freespace > itemsz + sizeof(ItemIdData))
+				freespace -= itemsz + sizeof(ItemIdData);
+			else
+				freespace = 0;
+		}
+
+		/* move them over */
+		if (ndeletable > 0)
+			_hash_movetuples(rel, wbuf, rbuf, bucket_blkno, bucket_blkno,
+							 itups, deletable, ndeletable);
+
+		if (roffnum <= maxroffnum)
+		{
 			/*
-			 * Walk up the bucket chain, looking for a page big enough for
-			 * this item.  Exit if we reach the read page.
+			 * The write page is full, so advance to the next one, and then
+			 * look at the remaining tuples of the read page again.  Exit if
+			 * we reach the read page.
 			 */
-			while (PageGetFreeSpace(wpage) < itemsz)
+			Assert(!PageIsEmpty(wpage));
+
+			wblkno = wopaque->hasho_nextblkno;
+			Assert(BlockNumberIsValid(wblkno));
+
+			_hash_relbuf(rel, wbuf);
+
+			/* nothing more to do if we reached the read page */
+			if (rblkno == wblkno)
 			{
-				Assert(!PageIsEmpty(wpage));
-
-				wblkno = wopaque->hasho_nextblkno;
-				Assert(BlockNumberIsValid(wblkno));
-
-				if (wbuf_dirty)
-					_hash_wrtbuf(rel, wbuf);
-				else
-					_hash_relbuf(rel, wbuf);
-
-				/* nothing more to do if we reached the read page */
-				if (rblkno == wblkno)
-				{
-					if (ndeletable > 0)
-					{
-						/* Delete tuples we already moved off read page */
-						PageIndexMultiDelete(rpage, deletable, ndeletable);
-						_hash_wrtbuf(rel, rbuf);
-					}
-					else
-						_hash_relbuf(rel, rbuf);
-					return;
-				}
-
-				wbuf = _hash_getbuf_with_strategy(rel,
-												  wblkno,
-												  HASH_WRITE,
-												  LH_OVERFLOW_PAGE,
-												  bstrategy);
-				wpage = BufferGetPage(wbuf);
-				wopaque = (HashPageOpaque) PageGetSpecialPointer(wpage);
-				Assert(wopaque->hasho_bucket == bucket);
-				wbuf_dirty = false;
+				_hash_relbuf(rel, rbuf);
+				return;
 			}
 
-			/*
-			 * we have found room so insert on the "write" page, being careful
-			 * to preserve hashkey ordering.  (If we insert many tuples into
-			 * the same "write" page it would be worth qsort'ing instead of
-			 * doing repeated _hash_pgaddtup.)
-			 */
-			(void) _hash_pgaddtup(rel, wbuf, itemsz, itup);
-			wbuf_dirty = true;
-
-			/* remember tuple for deletion from "read" page */
-			deletable[ndeletable++] = roffnum;
+			wbuf = _hash_getbuf_with_strategy(rel,
+											  wblkno,
+											  HASH_WRITE,
+											  LH_OVERFLOW_PAGE,
+											  bstrategy);
+			wpage = BufferGetPage(wbuf);
+			wopaque = (HashPageOpaque) PageGetSpecialPointer(wpage);
+			Assert(wopaque->hasho_bucket == bucket);
+			continue;
 		}
 
 		/*
@@ -734,18 +951,15 @@ _hash_squeezebucket(Relation rel,
 		if (rblkno == wblkno)
 		{
 			/* yes, so release wbuf lock first */
-			if (wbuf_dirty)
-				_hash_wrtbuf(rel, wbuf);
-			else
-				_hash_relbuf(rel, wbuf);
+			_hash_relbuf(rel, wbuf);
 			/* free this overflow page (releases rbuf) */
-			_hash_freeovflpage(rel, rbuf, bstrategy);
+			_hash_freeovflpage(rel, bucket_blkno, rbuf, bstrategy);
 			/* done */
 			return;
 		}
 
 		/* free this overflow page, then get the previous one */
-		_hash_freeovflpage(rel, rbuf, bstrategy);
+		_hash_freeovflpage(rel, bucket_blkno, rbuf, bstrategy);
 
 		rbuf = _hash_getbuf_with_strategy(rel,
 										  rblkno,
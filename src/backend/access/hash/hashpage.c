@@ -29,6 +29,8 @@
 #include "postgres.h"
 
 #include "access/hash.h"
+#include "access/hash_xlog.h"
+#include "access/heapam_xlog.h"
 #include "miscadmin.h"
 #include "storage/lmgr.h"
 #include "storage/smgr.h"
@@ -38,8 +40,7 @@ static bool _hash_alloc_buckets(Relation rel, BlockNumber firstblock,
 					uint32 nblocks);
 static void _hash_splitbucket(Relation rel, Buffer metabuf,
 				  Bucket obucket, Bucket nbucket,
-				  BlockNumber start_oblkno,
-				  BlockNumber start_nblkno,
+				  Buffer obuf, Buffer nbuf,
 				  uint32 maxbucket,
 				  uint32 highmask, uint32 lowmask);
 
@@ -161,6 +162,12 @@ _hash_getinitbuf(Relation rel, BlockNumber blkno)
 
 	/* ref count and lock type are correct */
 
+	/*
+	 * RBM_ZERO doesn't zero the page if it's already in the buffer cache,
+	 * which is likely for a recently freed overflow page; so do it here.
+	 */
+	MemSet(BufferGetPage(buf), 0, BufferGetPageSize(buf));
+
 	/* initialize the page */
 	_hash_pageinit(BufferGetPage(buf), BufferGetPageSize(buf));
 
@@ -263,22 +270,39 @@ _hash_dropbuf(Relation rel, Buffer buf)
 }
 
 /*
- *	_hash_wrtbuf() -- write a hash page to disk.
- *
- *		This routine releases the lock held on the buffer and our refcount
- *		for it.  It is an error to call _hash_wrtbuf() without a write lock
- *		and a pin on the buffer.
+ *	_hash_dropscanbuf() -- release buffers and locks held by a scan.
  *
- * NOTE: this routine should go away when/if hash indexes are WAL-ified.
- * The correct sequence of operations is to mark the buffer dirty, then
- * write the WAL record, then release the lock and pin; so marking dirty
- * can't be combined with releasing.
+ * This drops the pins on the current page and on the primary bucket page(s)
+ * of the scan, and the share locks on the bucket(s).
  */
 void
-_hash_wrtbuf(Relation rel, Buffer buf)
+_hash_dropscanbuf(Relation rel, HashScanOpaque so)
 {
-	MarkBufferDirty(buf);
-	UnlockReleaseBuffer(buf);
+	/* release any pin we still hold */
+	if (BufferIsValid(so->hashso_curbuf))
+		_hash_dropbuf(rel, so->hashso_curbuf);
+	so->hashso_curbuf = InvalidBuffer;
+
+	/* release pins on the primary bucket pages, too */
+	if (BufferIsValid(so->hashso_bucket_buf))
+		_hash_dropbuf(rel, so->hashso_bucket_buf);
+	so->hashso_bucket_buf = InvalidBuffer;
+
+	if (BufferIsValid(so->hashso_split_bucket_buf))
+		_hash_dropbuf(rel, so->hashso_split_bucket_buf);
+	so->hashso_split_bucket_buf = InvalidBuffer;
+
+	/* release locks on the buckets */
+	if (so->hashso_bucket_blkno)
+		_hash_droplock(rel, so->hashso_bucket_blkno, HASH_SHARE);
+	so->hashso_bucket_blkno = 0;
+
+	if (so->hashso_split_bucket_blkno)
+		_hash_droplock(rel, so->hashso_split_bucket_blkno, HASH_SHARE);
+	so->hashso_split_bucket_blkno = 0;
+
+	so->hashso_buc_populated = false;
+	so->hashso_buc_split = false;
 }
 
 /*
@@ -319,6 +343,9 @@ _hash_chgbufaccess(Relation rel,
  * We are fairly cavalier about locking here, since we know that no one else
  * could be accessing this index.  In particular the rule about not holding
  * multiple buffer locks is ignored.
+ *
+ * Each page is WAL-logged as a full-page image once it's complete, if the
+ * index needs WAL.  The init fork of an unlogged index is always logged.
  */
 uint32
 _hash_metapinit(Relation rel, double num_tuples, ForkNumber forkNum)
@@ -335,6 +362,7 @@ _hash_metapinit(Relation rel, double num_tuples, ForkNumber forkNum)
 	uint32		num_buckets;
 	uint32		log2_num_buckets;
 	uint32		i;
+	bool		use_wal;
 
 	/* safety check */
 	if (RelationGetNumberOfBlocksInFork(rel, forkNum) != 0)
@@ -374,6 +402,8 @@ _hash_metapinit(Relation rel, double num_tuples, ForkNumber forkNum)
 	Assert(num_buckets == (((uint32) 1) << log2_num_buckets));
 	Assert(log2_num_buckets < HASH_MAX_SPLITPOINTS);
 
+	use_wal = RelationNeedsWAL(rel) || forkNum == INIT_FORKNUM;
+
 	/*
 	 * We initialize the metapage, the first N bucket pages, and the first
 	 * bitmap page in sequence, using _hash_getnewbuf to cause smgrextend()
@@ -456,7 +486,18 @@ _hash_metapinit(Relation rel, double num_tuples, ForkNumber forkNum)
 		pageopaque->hasho_bucket = i;
 		pageopaque->hasho_flag = LH_BUCKET_PAGE;
 		pageopaque->hasho_page_id = HASHO_PAGE_ID;
-		_hash_wrtbuf(rel, buf);
+
+		if (use_wal)
+		{
+			START_CRIT_SECTION();
+			MarkBufferDirty(buf);
+			log_newpage_buffer(buf);
+			END_CRIT_SECTION();
+		}
+		else
+			MarkBufferDirty(buf);
+
+		_hash_relbuf(rel, buf);
 	}
 
 	/* Now reacquire buffer lock on metapage */
@@ -467,8 +508,18 @@ _hash_metapinit(Relation rel, double num_tuples, ForkNumber forkNum)
 	 */
 	_hash_initbitmap(rel, metap, num_buckets + 1, forkNum);
 
-	/* all done */
-	_hash_wrtbuf(rel, metabuf);
+	/* all done; log the metapage, now that it's complete */
+	if (use_wal)
+	{
+		START_CRIT_SECTION();
+		MarkBufferDirty(metabuf);
+		log_newpage_buffer(metabuf);
+		END_CRIT_SECTION();
+	}
+	else
+		MarkBufferDirty(metabuf);
+
+	_hash_relbuf(rel, metabuf);
 
 	return num_buckets;
 }
@@ -502,6 +553,12 @@ _hash_expandtable(Relation rel, Buffer metabuf)
 	uint32		spare_ndx;
 	BlockNumber start_oblkno;
 	BlockNumber start_nblkno;
+	Buffer		obuf;
+	Buffer		nbuf;
+	Page		opage;
+	Page		npage;
+	HashPageOpaque oopaque;
+	HashPageOpaque nopaque;
 	uint32		maxbucket;
 	uint32		highmask;
 	uint32		lowmask;
@@ -562,6 +619,33 @@ _hash_expandtable(Relation rel, Buffer metabuf)
 	if (!_hash_try_getlock(rel, start_oblkno, HASH_EXCLUSIVE))
 		goto fail;
 
+	/*
+	 * We hold the old bucket's lock, so no one else can be holding a buffer
+	 * lock on its primary page; it's safe to lock that while holding the
+	 * metapage lock.
+	 */
+	obuf = _hash_getbuf(rel, start_oblkno, HASH_WRITE, LH_BUCKET_PAGE);
+	opage = BufferGetPage(obuf);
+	oopaque = (HashPageOpaque) PageGetSpecialPointer(opage);
+
+	/*
+	 * If an earlier split of the old bucket was interrupted, finish that one
+	 * instead of starting another; a bucket is never part of two splits at
+	 * once.  (The old bucket cannot still be being populated by a split of
+	 * its own: that split's old bucket has a lower number, so it was due
+	 * for its next split, and got finished, before this one.)
+	 */
+	Assert(!H_BUCKET_BEING_POPULATED(oopaque));
+	if (H_BUCKET_BEING_SPLIT(oopaque))
+	{
+		_hash_relbuf(rel, obuf);
+		_hash_droplock(rel, start_oblkno, HASH_EXCLUSIVE);
+		_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
+
+		_hash_finish_split(rel, metabuf, old_bucket);
+		return;
+	}
+
 	/*
 	 * Likewise lock the new bucket (should never fail).
 	 *
@@ -596,6 +680,7 @@ _hash_expandtable(Relation rel, Buffer metabuf)
 		if (!_hash_alloc_buckets(rel, start_nblkno, new_bucket))
 		{
 			/* can't split due to BlockNumber overflow */
+			_hash_relbuf(rel, obuf);
 			_hash_droplock(rel, start_oblkno, HASH_EXCLUSIVE);
 			_hash_droplock(rel, start_nblkno, HASH_EXCLUSIVE);
 			goto fail;
@@ -603,13 +688,17 @@ _hash_expandtable(Relation rel, Buffer metabuf)
 	}
 
 	/*
-	 * Okay to proceed with split.	Update the metapage bucket mapping info.
-	 *
-	 * Since we are scribbling on the metapage data right in the shared
-	 * buffer, any failure in this next little bit leaves us with a big
-	 * problem: the metapage is effectively corrupt but could get written back
-	 * to disk.  We don't really expect any failure, but just to be sure,
-	 * establish a critical section.
+	 * Get the new bucket's primary page.  The metapage lock makes it safe to
+	 * extend the index using _hash_getnewbuf.
+	 */
+	nbuf = _hash_getnewbuf(rel, start_nblkno, MAIN_FORKNUM);
+	npage = BufferGetPage(nbuf);
+
+	/*
+	 * Okay to proceed with split.  Update the metapage bucket mapping info,
+	 * initialize the new bucket's primary page, and mark both buckets as
+	 * taking part in a split.  This is all one atomic action; no
+	 * ereport(ERROR) until it's logged.
 	 */
 	START_CRIT_SECTION();
 
@@ -634,7 +723,63 @@ _hash_expandtable(Relation rel, Buffer metabuf)
 		metap->hashm_ovflpoint = spare_ndx;
 	}
 
-	/* Done mucking with metapage */
+	MarkBufferDirty(metabuf);
+
+	oopaque->hasho_flag |= LH_BUCKET_BEING_SPLIT;
+
+	MarkBufferDirty(obuf);
+
+	/* initialize the new bucket's primary page */
+	nopaque = (HashPageOpaque) PageGetSpecialPointer(npage);
+	nopaque->hasho_prevblkno = InvalidBlockNumber;
+	nopaque->hasho_nextblkno = InvalidBlockNumber;
+	nopaque->hasho_bucket = new_bucket;
+	nopaque->hasho_flag = LH_BUCKET_PAGE | LH_BUCKET_BEING_POPULATED;
+	nopaque->hasho_page_id = HASHO_PAGE_ID;
+
+	MarkBufferDirty(nbuf);
+
+	/* XLOG stuff */
+	if (RelationNeedsWAL(rel))
+	{
+		xl_hash_split_allocate_page xlrec;
+		XLogRecPtr	recptr;
+		XLogRecData rdata[3];
+
+		xlrec.node = rel->rd_node;
+		xlrec.new_bucket = new_bucket;
+		xlrec.old_bucket_blkno = start_oblkno;
+		xlrec.new_bucket_blkno = start_nblkno;
+		xlrec.lowmask = metap->hashm_lowmask;
+		xlrec.highmask = metap->hashm_highmask;
+		xlrec.ovflpoint = metap->hashm_ovflpoint;
+		xlrec.spares = metap->hashm_spares[metap->hashm_ovflpoint];
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = SizeOfHashSplitAllocatePage;
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &(rdata[1]);
+
+		rdata[1].data = NULL;
+		rdata[1].len = 0;
+		rdata[1].buffer = obuf;
+		rdata[1].buffer_std = true;
+		rdata[1].next = &(rdata[2]);
+
+		/* the metapage keeps its data in the "hole", so it's not standard */
+		rdata[2].data = NULL;
+		rdata[2].len = 0;
+		rdata[2].buffer = metabuf;
+		rdata[2].buffer_std = false;
+		rdata[2].next = NULL;
+
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_SPLIT_ALLOCATE_PAGE, rdata);
+
+		PageSetLSN(opage, recptr);
+		PageSetLSN(npage, recptr);
+		PageSetLSN(BufferGetPage(metabuf), recptr);
+	}
+
 	END_CRIT_SECTION();
 
 	/*
@@ -648,18 +793,13 @@ _hash_expandtable(Relation rel, Buffer metabuf)
 	highmask = metap->hashm_highmask;
 	lowmask = metap->hashm_lowmask;
 
-	/* Write out the metapage and drop lock, but keep pin */
-	_hash_chgbufaccess(rel, metabuf, HASH_WRITE, HASH_NOLOCK);
+	/* Drop the metapage lock (buffer already marked dirty), but keep pin */
+	_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
 
-	/* Relocate records to the new bucket */
-	_hash_splitbucket(rel, metabuf, old_bucket, new_bucket,
-					  start_oblkno, start_nblkno,
+	/* Relocate records to the new bucket; this releases the bucket locks */
+	_hash_splitbucket(rel, metabuf, old_bucket, new_bucket, obuf, nbuf,
 					  maxbucket, highmask, lowmask);
 
-	/* Release bucket locks, allowing others to access them */
-	_hash_droplock(rel, start_oblkno, HASH_EXCLUSIVE);
-	_hash_droplock(rel, start_nblkno, HASH_EXCLUSIVE);
-
 	return;
 
 	/* Here if decide not to split or fail to acquire old bucket lock */
@@ -685,9 +825,12 @@ fail:
  * than if we forced it all to be allocated now; but since we don't scan
  * hash indexes sequentially anyway, that probably doesn't matter.
  *
+ * The zero page is WAL-logged too, so that the index has the same length
+ * after crash recovery and on a standby.
+ *
  * XXX It's annoying that this code is executed with the metapage lock held.
- * We need to interlock against _hash_getovflpage() adding a new overflow page
- * concurrently, but it'd likely be better to use LockRelationForExtension
+ * We need to interlock against _hash_addovflpage() adding a new overflow
+ * page concurrently, but it'd likely be better to use LockRelationForExtension
  * for the purpose.  OTOH, adding a splitpoint is a very infrequent operation,
  * so it may not be worth worrying about.
  *
@@ -711,6 +854,9 @@ _hash_alloc_buckets(Relation rel, BlockNumber firstblock, uint32 nblocks)
 
 	MemSet(zerobuf, 0, sizeof(zerobuf));
 
+	if (RelationNeedsWAL(rel))
+		log_newpage(&rel->rd_node, MAIN_FORKNUM, lastblock, zerobuf);
+
 	RelationOpenSmgr(rel);
 	smgrextend(rel->rd_smgr, MAIN_FORKNUM, lastblock, zerobuf, false);
 
@@ -727,7 +873,19 @@ _hash_alloc_buckets(Relation rel, BlockNumber firstblock, uint32 nblocks)
  * bucket.
  *
  * The caller must hold exclusive locks on both buckets to ensure that
- * no one else is trying to access them (see README).
+ * no one else is trying to access them (see README), and pins and write
+ * locks on both primary bucket pages, 'obuf' and 'nbuf'; the primary pages
+ * must carry the split-in-progress flags.  All of these are released before
+ * we return.
+ *
+ * The split is done incrementally.  The tuples of each old page that belong
+ * to the new bucket are moved in batches, each of which is an atomic action
+ * (see _hash_movetuples), so the split can be interrupted at any point,
+ * whether by a crash or on purpose: between old pages we let go of the
+ * bucket locks, and only go on if we can get them back without waiting.
+ * Otherwise we leave the split to be finished later, by _hash_finish_split.
+ * Only once all the tuples are moved are the split-in-progress flags
+ * cleared and the old bucket squeezed.
  *
  * The caller must hold a pin, but no lock, on the metapage buffer.
  * The buffer is returned in the same state.  (The metapage is only
@@ -738,57 +896,50 @@ _hash_splitbucket(Relation rel,
 				  Buffer metabuf,
 				  Bucket obucket,
 				  Bucket nbucket,
-				  BlockNumber start_oblkno,
-				  BlockNumber start_nblkno,
+				  Buffer obuf,
+				  Buffer nbuf,
 				  uint32 maxbucket,
 				  uint32 highmask,
 				  uint32 lowmask)
 {
+	BlockNumber start_oblkno = BufferGetBlockNumber(obuf);
+	BlockNumber start_nblkno = BufferGetBlockNumber(nbuf);
 	BlockNumber oblkno;
 	BlockNumber nblkno;
-	Buffer		obuf;
-	Buffer		nbuf;
 	Page		opage;
 	Page		npage;
 	HashPageOpaque oopaque;
 	HashPageOpaque nopaque;
 
-	/*
-	 * It should be okay to simultaneously write-lock pages from each bucket,
-	 * since no one else can be trying to acquire buffer lock on pages of
-	 * either bucket.
-	 */
-	oblkno = start_oblkno;
-	obuf = _hash_getbuf(rel, oblkno, HASH_WRITE, LH_BUCKET_PAGE);
 	opage = BufferGetPage(obuf);
 	oopaque = (HashPageOpaque) PageGetSpecialPointer(opage);
-
-	nblkno = start_nblkno;
-	nbuf = _hash_getnewbuf(rel, nblkno, MAIN_FORKNUM);
 	npage = BufferGetPage(nbuf);
-
-	/* initialize the new bucket's primary page */
 	nopaque = (HashPageOpaque) PageGetSpecialPointer(npage);
-	nopaque->hasho_prevblkno = InvalidBlockNumber;
-	nopaque->hasho_nextblkno = InvalidBlockNumber;
-	nopaque->hasho_bucket = nbucket;
-	nopaque->hasho_flag = LH_BUCKET_PAGE;
-	nopaque->hasho_page_id = HASHO_PAGE_ID;
+
+	Assert(H_BUCKET_BEING_SPLIT(oopaque));
+	Assert(H_BUCKET_BEING_POPULATED(nopaque));
 
 	/*
 	 * Partition the tuples in the old bucket between the old bucket and the
 	 * new bucket, advancing along the old bucket's overflow bucket chain and
-	 * adding overflow pages to the new bucket as needed.  Outer loop iterates
-	 * once per page in old bucket.
+	 * along, or adding overflow pages to, the new bucket's chain as needed.
+	 * Outer loop iterates once per page in old bucket.
+	 *
+	 * It should be okay to simultaneously write-lock pages from each bucket,
+	 * since no one else can be trying to acquire buffer lock on pages of
+	 * either bucket.
 	 */
 	for (;;)
 	{
 		OffsetNumber ooffnum;
 		OffsetNumber omaxoffnum;
-		OffsetNumber deletable[MaxOffsetNumber];
-		int			ndeletable = 0;
+		OffsetNumber deletable[MaxIndexTuplesPerPage];
+		IndexTuple	itups[MaxIndexTuplesPerPage];
+		uint16		ndeletable = 0;
+		Size		freespace;
 
 		/* Scan each tuple in old page */
+		freespace = PageGetFreeSpace(npage);
 		omaxoffnum = PageGetMaxOffsetNumber(opage);
 		for (ooffnum = FirstOffsetNumber;
 			 ooffnum <= omaxoffnum;
@@ -807,80 +958,331 @@ _hash_splitbucket(Relation rel,
 			bucket = _hash_hashkey2bucket(_hash_get_indextuple_hashkey(itup),
 										  maxbucket, highmask, lowmask);
 
-			if (bucket == nbucket)
+			if (bucket != nbucket)
+			{
+				/*
+				 * the tuple stays on this page, so nothing to do.
+				 */
+				Assert(bucket == obucket);
+				continue;
+			}
+
+			itemsz = IndexTupleDSize(*itup);
+			itemsz = MAXALIGN(itemsz);
+
+			if (itemsz > freespace)
 			{
 				/*
-				 * insert the tuple into the new bucket.  if it doesn't fit on
-				 * the current page in the new bucket, we must allocate a new
-				 * overflow page and place the tuple on that page instead.
+				 * The current page of the new bucket is full.  Move the
+				 * tuples collected so far, and go on with the next page of
+				 * the new bucket, adding an overflow page if there is none.
+				 * Moving tuples changes the offsets on the old page, so we
+				 * then have to start over at the beginning of it.
 				 */
-				itemsz = IndexTupleDSize(*itup);
-				itemsz = MAXALIGN(itemsz);
+				if (ndeletable > 0)
+				{
+					_hash_movetuples(rel, nbuf, obuf,
+									 start_nblkno, start_oblkno,
+									 itups, deletable, ndeletable);
+					ndeletable = 0;
+				}
 
-				if (PageGetFreeSpace(npage) < itemsz)
+				nblkno = nopaque->hasho_nextblkno;
+				if (BlockNumberIsValid(nblkno))
+				{
+					_hash_relbuf(rel, nbuf);
+					nbuf = _hash_getbuf(rel, nblkno, HASH_WRITE,
+										LH_OVERFLOW_PAGE);
+				}
+				else
 				{
-					/* write out nbuf and drop lock, but keep pin */
-					_hash_chgbufaccess(rel, nbuf, HASH_WRITE, HASH_NOLOCK);
-					/* chain to a new overflow page */
+					/* chain to a new overflow page (this releases nbuf) */
 					nbuf = _hash_addovflpage(rel, metabuf, nbuf);
-					npage = BufferGetPage(nbuf);
-					/* we don't need nblkno or nopaque within the loop */
 				}
+				npage = BufferGetPage(nbuf);
+				nopaque = (HashPageOpaque) PageGetSpecialPointer(npage);
 
-				/*
-				 * Insert tuple on new page, using _hash_pgaddtup to ensure
-				 * correct ordering by hashkey.  This is a tad inefficient
-				 * since we may have to shuffle itempointers repeatedly.
-				 * Possible future improvement: accumulate all the items for
-				 * the new page and qsort them before insertion.
-				 */
-				(void) _hash_pgaddtup(rel, nbuf, itemsz, itup);
-
-				/*
-				 * Mark tuple for deletion from old page.
-				 */
-				deletable[ndeletable++] = ooffnum;
+				freespace = PageGetFreeSpace(npage);
+				omaxoffnum = PageGetMaxOffsetNumber(opage);
+				ooffnum = InvalidOffsetNumber;	/* restart at first item */
+				continue;
 			}
+
+			/* remember the tuple for moving to the new bucket */
+			itups[ndeletable] = itup;
+			deletable[ndeletable++] = ooffnum;
+
+			/* PageGetFreeSpace has already deducted one line pointer */
+			if (freespace > itemsz + sizeof(ItemIdData))
+				freespace -= itemsz + sizeof(ItemIdData);
 			else
-			{
-				/*
-				 * the tuple stays on this page, so nothing to do.
-				 */
-				Assert(bucket == obucket);
-			}
+				freespace = 0;
 		}
 
+		/* Done scanning this old page; move the remaining tuples */
+		if (ndeletable > 0)
+			_hash_movetuples(rel, nbuf, obuf, start_nblkno, start_oblkno,
+							 itups, deletable, ndeletable);
+
 		oblkno = oopaque->hasho_nextblkno;
+		nblkno = BufferGetBlockNumber(nbuf);
 
 		/*
-		 * Done scanning this old page.  If we moved any tuples, delete them
-		 * from the old page.
+		 * Release our buffer locks, and the bucket locks too, to let anyone
+		 * waiting for them get in before we go on with the next old page.
 		 */
-		if (ndeletable > 0)
-		{
-			PageIndexMultiDelete(opage, deletable, ndeletable);
-			_hash_wrtbuf(rel, obuf);
-		}
-		else
-			_hash_relbuf(rel, obuf);
+		_hash_relbuf(rel, obuf);
+		_hash_relbuf(rel, nbuf);
+		_hash_droplock(rel, start_oblkno, HASH_EXCLUSIVE);
+		_hash_droplock(rel, start_nblkno, HASH_EXCLUSIVE);
 
 		/* Exit loop if no more overflow pages in old bucket */
 		if (!BlockNumberIsValid(oblkno))
 			break;
 
+		CHECK_FOR_INTERRUPTS();
+
+		/*
+		 * If anyone took the locks in the meantime, leave the rest of the
+		 * split to be finished later.  Once we have the locks again, make
+		 * sure no one finished the split meanwhile; as long as it's not
+		 * finished, the old bucket isn't squeezed and its pages stay put.
+		 */
+		if (!_hash_try_getlock(rel, start_oblkno, HASH_EXCLUSIVE))
+			return;
+		if (!_hash_try_getlock(rel, start_nblkno, HASH_EXCLUSIVE))
+		{
+			_hash_droplock(rel, start_oblkno, HASH_EXCLUSIVE);
+			return;
+		}
+
+		nbuf = _hash_getbuf(rel, start_nblkno, HASH_READ, LH_BUCKET_PAGE);
+		nopaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(nbuf));
+		if (!H_BUCKET_BEING_POPULATED(nopaque))
+		{
+			_hash_relbuf(rel, nbuf);
+			_hash_droplock(rel, start_oblkno, HASH_EXCLUSIVE);
+			_hash_droplock(rel, start_nblkno, HASH_EXCLUSIVE);
+			return;
+		}
+		_hash_relbuf(rel, nbuf);
+
 		/* Else, advance to next old page */
 		obuf = _hash_getbuf(rel, oblkno, HASH_WRITE, LH_OVERFLOW_PAGE);
 		opage = BufferGetPage(obuf);
 		oopaque = (HashPageOpaque) PageGetSpecialPointer(opage);
+
+		nbuf = _hash_getbuf(rel, nblkno, HASH_WRITE,
+							LH_BUCKET_PAGE | LH_OVERFLOW_PAGE);
+		npage = BufferGetPage(nbuf);
+		nopaque = (HashPageOpaque) PageGetSpecialPointer(npage);
 	}
 
 	/*
 	 * We're at the end of the old bucket chain, so we're done partitioning
-	 * the tuples.	Before quitting, call _hash_squeezebucket to ensure the
-	 * tuples remaining in the old bucket (including the overflow pages) are
-	 * packed as tightly as possible.  The new bucket is already tight.
+	 * the tuples.  We let go of the bucket locks above, so get them back.
 	 */
-	_hash_wrtbuf(rel, nbuf);
+	if (!_hash_try_getlock(rel, start_oblkno, HASH_EXCLUSIVE))
+		return;
+	if (!_hash_try_getlock(rel, start_nblkno, HASH_EXCLUSIVE))
+	{
+		_hash_droplock(rel, start_oblkno, HASH_EXCLUSIVE);
+		return;
+	}
 
+	obuf = _hash_getbuf(rel, start_oblkno, HASH_WRITE, LH_BUCKET_PAGE);
+	opage = BufferGetPage(obuf);
+	oopaque = (HashPageOpaque) PageGetSpecialPointer(opage);
+	nbuf = _hash_getbuf(rel, start_nblkno, HASH_WRITE, LH_BUCKET_PAGE);
+	npage = BufferGetPage(nbuf);
+	nopaque = (HashPageOpaque) PageGetSpecialPointer(npage);
+
+	/* Someone else might have finished the split meanwhile */
+	if (!H_BUCKET_BEING_POPULATED(nopaque))
+	{
+		_hash_relbuf(rel, obuf);
+		_hash_relbuf(rel, nbuf);
+		_hash_droplock(rel, start_oblkno, HASH_EXCLUSIVE);
+		_hash_droplock(rel, start_nblkno, HASH_EXCLUSIVE);
+		return;
+	}
+
+	/* Mark the split as complete, on both primary bucket pages */
+	START_CRIT_SECTION();
+
+	oopaque->hasho_flag &= ~LH_BUCKET_BEING_SPLIT;
+	nopaque->hasho_flag &= ~LH_BUCKET_BEING_POPULATED;
+
+	MarkBufferDirty(obuf);
+	MarkBufferDirty(nbuf);
+
+	/* XLOG stuff */
+	if (RelationNeedsWAL(rel))
+	{
+		xl_hash_split_complete xlrec;
+		XLogRecPtr	recptr;
+		XLogRecData rdata[3];
+
+		xlrec.node = rel->rd_node;
+		xlrec.old_bucket_blkno = start_oblkno;
+		xlrec.new_bucket_blkno = start_nblkno;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = SizeOfHashSplitComplete;
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &(rdata[1]);
+
+		rdata[1].data = NULL;
+		rdata[1].len = 0;
+		rdata[1].buffer = obuf;
+		rdata[1].buffer_std = true;
+		rdata[1].next = &(rdata[2]);
+
+		rdata[2].data = NULL;
+		rdata[2].len = 0;
+		rdata[2].buffer = nbuf;
+		rdata[2].buffer_std = true;
+		rdata[2].next = NULL;
+
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_SPLIT_COMPLETE, rdata);
+
+		PageSetLSN(opage, recptr);
+		PageSetLSN(npage, recptr);
+	}
+
+	END_CRIT_SECTION();
+
+	_hash_relbuf(rel, obuf);
+	_hash_relbuf(rel, nbuf);
+
+	/* The new bucket is ready for business */
+	_hash_droplock(rel, start_nblkno, HASH_EXCLUSIVE);
+
+	/*
+	 * Before quitting, call _hash_squeezebucket to ensure the tuples
+	 * remaining in the old bucket (including the overflow pages) are packed
+	 * as tightly as possible.  The new bucket is already tight.
+	 */
 	_hash_squeezebucket(rel, obucket, start_oblkno, NULL);
+
+	_hash_droplock(rel, start_oblkno, HASH_EXCLUSIVE);
+}
+
+
+/*
+ * _hash_finish_split -- finish an interrupted split of a bucket
+ *
+ * 'bucket' is either the old bucket of the split, or the new bucket it is
+ * populating; we can tell which from the flags of its primary page.  The
+ * rest of the tuples that belong in the new bucket are moved there, as by
+ * _hash_splitbucket (which may be interrupted again).
+ *
+ * This will silently do nothing if it cannot get the needed locks without
+ * waiting, or if the split has been finished meanwhile.
+ *
+ * The caller should hold no locks on the hash index, and must hold a pin,
+ * but no lock, on the metapage buffer.  The buffer is returned in the same
+ * state.
+ */
+void
+_hash_finish_split(Relation rel, Buffer metabuf, Bucket bucket)
+{
+	HashMetaPage metap;
+	Bucket		obucket;
+	Bucket		nbucket;
+	BlockNumber blkno;
+	BlockNumber start_oblkno;
+	BlockNumber start_nblkno;
+	Buffer		buf;
+	Buffer		obuf;
+	Buffer		nbuf;
+	HashPageOpaque opaque;
+	uint16		flags;
+	uint32		maxbucket;
+	uint32		highmask;
+	uint32		lowmask;
+
+	metap = HashPageGetMeta(BufferGetPage(metabuf));
+
+	/* Find out which side of the split the bucket is on */
+	_hash_chgbufaccess(rel, metabuf, HASH_NOLOCK, HASH_READ);
+	blkno = BUCKET_TO_BLKNO(metap, bucket);
+	_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
+
+	buf = _hash_getbuf(rel, blkno, HASH_READ, LH_BUCKET_PAGE);
+	opaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(buf));
+	flags = opaque->hasho_flag;
+	_hash_relbuf(rel, buf);
+
+	/*
+	 * Now look up the other bucket.  Re-read the masks while at it, which
+	 * is fine for telling which of the two buckets a tuple belongs in; the
+	 * old bucket can't have been split again before this split is finished.
+	 */
+	_hash_chgbufaccess(rel, metabuf, HASH_NOLOCK, HASH_READ);
+
+	if (flags & LH_BUCKET_BEING_POPULATED)
+	{
+		nbucket = bucket;
+		obucket = _hash_get_oldbucket(bucket);
+	}
+	else if (flags & LH_BUCKET_BEING_SPLIT)
+	{
+		obucket = bucket;
+		nbucket = _hash_get_newbucket(bucket, metap->hashm_lowmask,
+									  metap->hashm_maxbucket);
+	}
+	else
+	{
+		/* nothing to do */
+		_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
+		return;
+	}
+
+	start_oblkno = BUCKET_TO_BLKNO(metap, obucket);
+	start_nblkno = BUCKET_TO_BLKNO(metap, nbucket);
+	maxbucket = metap->hashm_maxbucket;
+	highmask = metap->hashm_highmask;
+	lowmask = metap->hashm_lowmask;
+
+	_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
+
+	/*
+	 * Lock both buckets, the old one first like _hash_expandtable does.  The
+	 * locks protect us against other backends, but not against our own
+	 * backend, so check for active scans separately.
+	 */
+	if (_hash_has_active_scan(rel, obucket) ||
+		_hash_has_active_scan(rel, nbucket))
+		return;
+
+	if (!_hash_try_getlock(rel, start_oblkno, HASH_EXCLUSIVE))
+		return;
+	if (!_hash_try_getlock(rel, start_nblkno, HASH_EXCLUSIVE))
+	{
+		_hash_droplock(rel, start_oblkno, HASH_EXCLUSIVE);
+		return;
+	}
+
+	/* Make sure the split is still in progress, now that we hold the locks */
+	obuf = _hash_getbuf(rel, start_oblkno, HASH_WRITE, LH_BUCKET_PAGE);
+	nbuf = _hash_getbuf(rel, start_nblkno, HASH_WRITE, LH_BUCKET_PAGE);
+
+	opaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(obuf));
+	if (H_BUCKET_BEING_SPLIT(opaque))
+	{
+		opaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(nbuf));
+		if (H_BUCKET_BEING_POPULATED(opaque))
+		{
+			/* this releases the buffers and the bucket locks */
+			_hash_splitbucket(rel, metabuf, obucket, nbucket, obuf, nbuf,
+							  maxbucket, highmask, lowmask);
+			return;
+		}
+	}
+
+	_hash_relbuf(rel, obuf);
+	_hash_relbuf(rel, nbuf);
+	_hash_droplock(rel, start_oblkno, HASH_EXCLUSIVE);
+	_hash_droplock(rel, start_nblkno, HASH_EXCLUSIVE);
 }
@@ -146,6 +146,11 @@ _hash_has_active_scan(Relation rel, Bucket bucket)
 			if (so->hashso_bucket_valid &&
 				so->hashso_bucket == bucket)
 				return true;
+
+			/* a scan of a bucket being populated reads the old one too */
+			if (so->hashso_buc_populated &&
+				so->hashso_split_bucket == bucket)
+				return true;
 		}
 	}
 
@@ -64,11 +64,17 @@ _hash_next(IndexScanDesc scan, ScanDirection dir)
 
 /*
  * Advance to next page in a bucket, if any.
+ *
+ * If the bucket is being populated by a split, the tuples that haven't been
+ * moved yet are still in the bucket being split, so continue with that
+ * bucket after the end of this one.
  */
 static void
-_hash_readnext(Relation rel,
+_hash_readnext(IndexScanDesc scan,
 			   Buffer *bufp, Page *pagep, HashPageOpaque *opaquep)
 {
+	Relation	rel = scan->indexRelation;
+	HashScanOpaque so = (HashScanOpaque) scan->opaque;
 	BlockNumber blkno;
 
 	blkno = (*opaquep)->hasho_nextblkno;
@@ -82,15 +88,30 @@ _hash_readnext(Relation rel,
 		*pagep = BufferGetPage(*bufp);
 		*opaquep = (HashPageOpaque) PageGetSpecialPointer(*pagep);
 	}
+	else if (so->hashso_buc_populated && !so->hashso_buc_split)
+	{
+		/* end of the new bucket, go on with the bucket being split */
+		*bufp = _hash_getbuf(rel, so->hashso_split_bucket_blkno, HASH_READ,
+							 LH_BUCKET_PAGE);
+		*pagep = BufferGetPage(*bufp);
+		*opaquep = (HashPageOpaque) PageGetSpecialPointer(*pagep);
+		so->hashso_buc_split = true;
+	}
 }
 
 /*
  * Advance to previous page in a bucket, if any.
+ *
+ * This is the mirror image of _hash_readnext: a backward scan of a bucket
+ * being populated starts at the end of the bucket being split, and goes on
+ * with the end of the new bucket after reaching the start.
  */
 static void
-_hash_readprev(Relation rel,
+_hash_readprev(IndexScanDesc scan,
 			   Buffer *bufp, Page *pagep, HashPageOpaque *opaquep)
 {
+	Relation	rel = scan->indexRelation;
+	HashScanOpaque so = (HashScanOpaque) scan->opaque;
 	BlockNumber blkno;
 
 	blkno = (*opaquep)->hasho_prevblkno;
@@ -105,6 +126,24 @@ _hash_readprev(Relation rel,
 		*pagep = BufferGetPage(*bufp);
 		*opaquep = (HashPageOpaque) PageGetSpecialPointer(*pagep);
 	}
+	else if (so->hashso_buc_populated && so->hashso_buc_split)
+	{
+		/* start of the bucket being split, go to the end of the new one */
+		*bufp = _hash_getbuf(rel, so->hashso_bucket_blkno, HASH_READ,
+							 LH_BUCKET_PAGE);
+		*pagep = BufferGetPage(*bufp);
+		*opaquep = (HashPageOpaque) PageGetSpecialPointer(*pagep);
+		so->hashso_buc_split = false;
+
+		while (BlockNumberIsValid((*opaquep)->hasho_nextblkno))
+		{
+			blkno = (*opaquep)->hasho_nextblkno;
+			_hash_relbuf(rel, *bufp);
+			*bufp = _hash_getbuf(rel, blkno, HASH_READ, LH_OVERFLOW_PAGE);
+			*pagep = BufferGetPage(*bufp);
+			*opaquep = (HashPageOpaque) PageGetSpecialPointer(*pagep);
+		}
+	}
 }
 
 /*
@@ -230,25 +269,81 @@ _hash_first(IndexScanDesc scan, ScanDirection dir)
 		retry = true;
 	}
 
-	/* done with the metapage */
-	_hash_dropbuf(rel, metabuf);
-
 	/* Update scan opaque state to show we have lock on the bucket */
 	so->hashso_bucket = bucket;
 	so->hashso_bucket_valid = true;
 	so->hashso_bucket_blkno = blkno;
 
-	/* Fetch the primary bucket page for the bucket */
+	/*
+	 * Fetch the primary bucket page for the bucket.  We keep a separate pin
+	 * on it for the whole scan; in hot standby, that's what keeps the replay
+	 * of tuple moves and removals out of the bucket (see README).
+	 */
 	buf = _hash_getbuf(rel, blkno, HASH_READ, LH_BUCKET_PAGE);
 	page = BufferGetPage(buf);
 	opaque = (HashPageOpaque) PageGetSpecialPointer(page);
 	Assert(opaque->hasho_bucket == bucket);
 
-	/* If a backwards scan is requested, move to the end of the chain */
+	so->hashso_bucket_buf = buf;
+	IncrBufferRefCount(buf);
+
+	/*
+	 * If the bucket is being populated by a split, the tuples we're looking
+	 * for might not have been moved out of the bucket being split yet, so
+	 * we have to scan that bucket too.  Lock it as well, which keeps the
+	 * split from moving any tuples (and from completing) during our scan.
+	 * Don't hold the buffer lock while waiting for the bucket lock.
+	 */
+	if (H_BUCKET_BEING_POPULATED(opaque))
+	{
+		BlockNumber old_blkno;
+		Buffer		old_buf;
+
+		_hash_chgbufaccess(rel, buf, HASH_READ, HASH_NOLOCK);
+
+		so->hashso_split_bucket = _hash_get_oldbucket(bucket);
+
+		_hash_chgbufaccess(rel, metabuf, HASH_NOLOCK, HASH_READ);
+		old_blkno = BUCKET_TO_BLKNO(metap, so->hashso_split_bucket);
+		_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
+
+		_hash_getlock(rel, old_blkno, HASH_SHARE);
+		so->hashso_split_bucket_blkno = old_blkno;
+
+		/* keep a pin on its primary page, as for the bucket itself */
+		old_buf = _hash_getbuf(rel, old_blkno, HASH_READ, LH_BUCKET_PAGE);
+		opaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(old_buf));
+		Assert(H_BUCKET_BEING_SPLIT(opaque));
+		_hash_chgbufaccess(rel, old_buf, HASH_READ, HASH_NOLOCK);
+		so->hashso_split_bucket_buf = old_buf;
+
+		so->hashso_buc_populated = true;
+
+		_hash_chgbufaccess(rel, buf, HASH_NOLOCK, HASH_READ);
+		opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+	}
+
+	/* done with the metapage */
+	_hash_dropbuf(rel, metabuf);
+
+	/*
+	 * If a backwards scan is requested, move to the end of the chain; with
+	 * a split in progress, that's the end of the bucket being split.
+	 */
 	if (ScanDirectionIsBackward(dir))
 	{
+		if (so->hashso_buc_populated)
+		{
+			_hash_relbuf(rel, buf);
+			buf = _hash_getbuf(rel, so->hashso_split_bucket_blkno, HASH_READ,
+							   LH_BUCKET_PAGE);
+			page = BufferGetPage(buf);
+			opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+			so->hashso_buc_split = true;
+		}
+
 		while (BlockNumberIsValid(opaque->hasho_nextblkno))
-			_hash_readnext(rel, &buf, &page, &opaque);
+			_hash_readnext(scan, &buf, &page, &opaque);
 	}
 
 	/* Now find the first tuple satisfying the qualification */
@@ -344,7 +439,7 @@ _hash_step(IndexScanDesc scan, Buffer *bufP, ScanDirection dir)
 					/*
 					 * ran off the end of this page, try the next
 					 */
-					_hash_readnext(rel, &buf, &page, &opaque);
+					_hash_readnext(scan, &buf, &page, &opaque);
 					if (BufferIsValid(buf))
 					{
 						maxoff = PageGetMaxOffsetNumber(page);
@@ -385,7 +480,7 @@ _hash_step(IndexScanDesc scan, Buffer *bufP, ScanDirection dir)
 					/*
 					 * ran off the end of this page, try the next
 					 */
-					_hash_readprev(rel, &buf, &page, &opaque);
+					_hash_readprev(scan, &buf, &page, &opaque);
 					if (BufferIsValid(buf))
 					{
 						maxoff = PageGetMaxOffsetNumber(page);
@@ -350,3 +350,45 @@ _hash_binsearch_last(Page page, uint32 hash_value)
 
 	return lower;
 }
+
+/*
+ * _hash_get_oldbucket -- get the bucket that was split to create new_bucket
+ *
+ * A new bucket is created by splitting the bucket whose number is the new
+ * bucket's number with its most significant bit cleared.
+ */
+Bucket
+_hash_get_oldbucket(Bucket new_bucket)
+{
+	uint32		mask;
+
+	Assert(new_bucket > 0);
+
+	mask = (((uint32) 1) << (_hash_log2(new_bucket + 1) - 1)) - 1;
+
+	return new_bucket & mask;
+}
+
+/*
+ * _hash_get_newbucket -- get the bucket that a split of old_bucket created
+ *
+ * The caller must know that old_bucket has been split already, and pass the
+ * current hashm_lowmask and hashm_maxbucket.  The new bucket was created by
+ * the split of old_bucket in the current doubling if that has happened yet,
+ * else by its split in the previous doubling.  A bucket that is still being
+ * split cannot be split again (see _hash_expandtable), so there is no need
+ * to look any further back.
+ */
+Bucket
+_hash_get_newbucket(Bucket old_bucket, uint32 lowmask, uint32 maxbucket)
+{
+	Bucket		new_bucket;
+
+	new_bucket = old_bucket | (lowmask + 1);
+	if (new_bucket > maxbucket)
+		new_bucket = old_bucket | ((lowmask >> 1) + 1);
+
+	Assert(new_bucket <= maxbucket);
+
+	return new_bucket;
+}
@@ -0,0 +1,99 @@
+/*-------------------------------------------------------------------------
+ *
+ * brindesc.c
+ *	  rmgr descriptor routines for BRIN indexes
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/rmgrdesc/brindesc.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/brin_xlog.h"
+
+static void
+out_target(StringInfo buf, RelFileNode node)
+{
+	appendStringInfo(buf, "rel %u/%u/%u ",
+					 node.spcNode, node.dbNode, node.relNode);
+}
+
+void
+brin_desc(StringInfo buf, uint8 xl_info, char *rec)
+{
+	uint8		info = xl_info & ~XLR_INFO_MASK;
+
+	info &= XLOG_BRIN_OPMASK;
+	switch (info)
+	{
+		case XLOG_BRIN_CREATE_INDEX:
+			{
+				xl_brin_createidx *xlrec = (xl_brin_createidx *) rec;
+
+				appendStringInfo(buf, "create_index: ");
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "v%d pagesPerRange %u",
+								 xlrec->version, xlrec->pagesPerRange);
+			}
+			break;
+		case XLOG_BRIN_INSERT:
+			{
+				xl_brin_insert *xlrec = (xl_brin_insert *) rec;
+
+				appendStringInfo(buf, "insert%s: ",
+								 (xl_info & XLOG_BRIN_INIT_PAGE) ? "(init)" : "");
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "heapBlk %u revmapBlk %u pagesPerRange %u TID (%u,%u)",
+								 xlrec->heapBlk, xlrec->revmapBlk,
+								 xlrec->pagesPerRange,
+								 ItemPointerGetBlockNumber(&xlrec->tid),
+								 ItemPointerGetOffsetNumber(&xlrec->tid));
+			}
+			break;
+		case XLOG_BRIN_UPDATE:
+			{
+				xl_brin_update *xlrec = (xl_brin_update *) rec;
+
+				appendStringInfo(buf, "update%s: ",
+								 (xl_info & XLOG_BRIN_INIT_PAGE) ? "(init)" : "");
+				out_target(buf, xlrec->insert.node);
+				appendStringInfo(buf, "heapBlk %u revmapBlk %u pagesPerRange %u old TID (%u,%u) TID (%u,%u)",
+								 xlrec->insert.heapBlk,
+								 xlrec->insert.revmapBlk,
+								 xlrec->insert.pagesPerRange,
+								 ItemPointerGetBlockNumber(&xlrec->oldtid),
+								 ItemPointerGetOffsetNumber(&xlrec->oldtid),
+								 ItemPointerGetBlockNumber(&xlrec->insert.tid),
+								 ItemPointerGetOffsetNumber(&xlrec->insert.tid));
+			}
+			break;
+		case XLOG_BRIN_SAMEPAGE_UPDATE:
+			{
+				xl_brin_samepage_update *xlrec = (xl_brin_samepage_update *) rec;
+
+				appendStringInfo(buf, "samepage_update: ");
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "TID (%u,%u)",
+								 ItemPointerGetBlockNumber(&xlrec->tid),
+								 ItemPointerGetOffsetNumber(&xlrec->tid));
+			}
+			break;
+		case XLOG_BRIN_REVMAP_EXTEND:
+			{
+				xl_brin_revmap_extend *xlrec = (xl_brin_revmap_extend *) rec;
+
+				appendStringInfo(buf, "revmap_extend: ");
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "targetBlk %u", xlrec->targetBlk);
+			}
+			break;
+		default:
+			appendStringInfo(buf, "unknown brin op code %u", info);
+			break;
+	}
+}
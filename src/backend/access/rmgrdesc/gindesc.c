@@ -39,6 +39,8 @@ gin_desc(StringInfo buf, uint8 xl_info, char *rec)
 		case XLOG_GIN_CREATE_PTREE:
 			appendStringInfo(buf, "Create posting tree, ");
 			desc_node(buf, ((ginxlogCreatePostingTree *) rec)->node, ((ginxlogCreatePostingTree *) rec)->blkno);
+			appendStringInfo(buf, " size: %u",
+							 ((ginxlogCreatePostingTree *) rec)->size);
 			break;
 		case XLOG_GIN_INSERT:
 			appendStringInfo(buf, "Insert item, ");
@@ -55,6 +57,10 @@ gin_desc(StringInfo buf, uint8 xl_info, char *rec)
 			appendStringInfo(buf, "Page split, ");
 			desc_node(buf, ((ginxlogSplit *) rec)->node, ((ginxlogSplit *) rec)->lblkno);
 			appendStringInfo(buf, " isrootsplit: %c", (((ginxlogSplit *) rec)->isRootSplit) ? 'T' : 'F');
+			if (((ginxlogSplit *) rec)->isData && ((ginxlogSplit *) rec)->isLeaf)
+				appendStringInfo(buf, " lsize: %u rsize: %u",
+								 ((ginxlogSplit *) rec)->lsize,
+								 ((ginxlogSplit *) rec)->rsize);
 			break;
 		case XLOG_GIN_VACUUM_PAGE:
 			appendStringInfo(buf, "Vacuum page, ");
@@ -14,9 +14,120 @@
  */
 #include "postgres.h"
 
-#include "access/hash.h"
+#include "access/hash_xlog.h"
+
+static void
+out_target(StringInfo buf, RelFileNode node)
+{
+	appendStringInfo(buf, "rel %u/%u/%u ",
+					 node.spcNode, node.dbNode, node.relNode);
+}
 
 void
 hash_desc(StringInfo buf, uint8 xl_info, char *rec)
 {
+	uint8		info = xl_info & ~XLR_INFO_MASK;
+
+	switch (info)
+	{
+		case XLOG_HASH_INSERT:
+			{
+				xl_hash_insert *xlrec = (xl_hash_insert *) rec;
+
+				appendStringInfo(buf, "insert: ");
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "blk %u off %u",
+								 xlrec->blkno, xlrec->offnum);
+			}
+			break;
+		case XLOG_HASH_ADD_OVFL_PAGE:
+			{
+				xl_hash_add_ovfl_page *xlrec = (xl_hash_add_ovfl_page *) rec;
+
+				appendStringInfo(buf, "add_ovfl_page: ");
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "bucket %u ovflblk %u prevblk %u",
+								 xlrec->bucket, xlrec->ovflblkno,
+								 xlrec->prevblkno);
+				if (BlockNumberIsValid(xlrec->mapblkno))
+					appendStringInfo(buf, " mapblk %u bit %u",
+									 xlrec->mapblkno, xlrec->bitmapbit);
+				if (BlockNumberIsValid(xlrec->newmapblkno))
+					appendStringInfo(buf, " newmapblk %u",
+									 xlrec->newmapblkno);
+			}
+			break;
+		case XLOG_HASH_SPLIT_ALLOCATE_PAGE:
+			{
+				xl_hash_split_allocate_page *xlrec = (xl_hash_split_allocate_page *) rec;
+
+				appendStringInfo(buf, "split_allocate_page: ");
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "new_bucket %u oldblk %u newblk %u lowmask 0x%x highmask 0x%x",
+								 xlrec->new_bucket,
+								 xlrec->old_bucket_blkno,
+								 xlrec->new_bucket_blkno,
+								 xlrec->lowmask, xlrec->highmask);
+			}
+			break;
+		case XLOG_HASH_SPLIT_COMPLETE:
+			{
+				xl_hash_split_complete *xlrec = (xl_hash_split_complete *) rec;
+
+				appendStringInfo(buf, "split_complete: ");
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "oldblk %u newblk %u",
+								 xlrec->old_bucket_blkno,
+								 xlrec->new_bucket_blkno);
+			}
+			break;
+		case XLOG_HASH_MOVE_PAGE_CONTENTS:
+			{
+				xl_hash_move_page_contents *xlrec = (xl_hash_move_page_contents *) rec;
+
+				appendStringInfo(buf, "move_page_contents: ");
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "ntups %u from blk %u (bucket blk %u) to blk %u (bucket blk %u)",
+								 xlrec->ntups,
+								 xlrec->rblkno, xlrec->rbucket_blkno,
+								 xlrec->wblkno, xlrec->wbucket_blkno);
+			}
+			break;
+		case XLOG_HASH_FREE_OVFL_PAGE:
+			{
+				xl_hash_free_ovfl_page *xlrec = (xl_hash_free_ovfl_page *) rec;
+
+				appendStringInfo(buf, "free_ovfl_page: ");
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "ovflblk %u prevblk %u nextblk %u mapblk %u bit %u",
+								 xlrec->ovflblkno,
+								 xlrec->prevblkno, xlrec->nextblkno,
+								 xlrec->mapblkno, xlrec->bitmapbit);
+				if (xlrec->update_firstfree)
+					appendStringInfo(buf, " firstfree %u", xlrec->firstfree);
+			}
+			break;
+		case XLOG_HASH_DELETE:
+			{
+				xl_hash_delete *xlrec = (xl_hash_delete *) rec;
+
+				appendStringInfo(buf, "delete: ");
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "blk %u (bucket blk %u)",
+								 xlrec->blkno, xlrec->bucket_blkno);
+			}
+			break;
+		case XLOG_HASH_UPDATE_META_PAGE:
+			{
+				xl_hash_update_meta_page *xlrec = (xl_hash_update_meta_page *) rec;
+
+				appendStringInfo(buf, "update_meta_page: ");
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "ntuples %g", xlrec->ntuples);
+			}
+			break;
+		default:
+			appendStringInfo(buf, "UNKNOWN");
+			break;
+	}
 }
@@ -84,11 +84,14 @@ xlog_desc(StringInfo buf, uint8 xl_info, char *rec)
 	}
 	else if (info == XLOG_FPI)
 	{
-		BkpBlock   *bkp = (BkpBlock *) rec;
+		BkpBlock	bkp;
 
+		memcpy(&bkp, rec, sizeof(BkpBlock));
 		appendStringInfo(buf, "full-page image: %s block %u",
-						 relpathperm(bkp->node, bkp->fork),
-						 bkp->block);
+						 relpathperm(bkp.node, bkp.fork),
+						 bkp.block);
+		if (bkp.bkp_info & BKPBLOCK_COMPRESSED)
+			appendStringInfo(buf, ", compressed to %u bytes", bkp.length);
 	}
 	else if (info == XLOG_BACKUP_END)
 	{
@@ -69,6 +69,9 @@
 	((xid) % (TransactionId) CLOG_XACTS_PER_PAGE) / CLOG_XACTS_PER_LSN_GROUP)
 
 
+/* GUC variable */
+int			clog_buffers = 0;
+
 /*
  * Link to shared-memory data structures for CLOG control
  */
@@ -252,6 +255,7 @@ TransactionIdSetPageStatus(TransactionId xid, int nsubxids,
 						   TransactionId *subxids, XidStatus status,
 						   XLogRecPtr lsn, int pageno)
 {
+	LWLockId	banklock = SimpleLruGetBankLock(ClogCtl, pageno);
 	int			slotno;
 	int			i;
 
@@ -259,7 +263,7 @@ TransactionIdSetPageStatus(TransactionId xid, int nsubxids,
 		   status == TRANSACTION_STATUS_ABORTED ||
 		   (status == TRANSACTION_STATUS_SUB_COMMITTED && !TransactionIdIsValid(xid)));
 
-	LWLockAcquire(CLogControlLock, LW_EXCLUSIVE);
+	LWLockAcquire(banklock, LW_EXCLUSIVE);
 
 	/*
 	 * If we're doing an async commit (ie, lsn is valid), then we must wait
@@ -308,13 +312,13 @@ TransactionIdSetPageStatus(TransactionId xid, int nsubxids,
 
 	ClogCtl->shared->page_dirty[slotno] = true;
 
-	LWLockRelease(CLogControlLock);
+	LWLockRelease(banklock);
 }
 
 /*
  * Sets the commit status of a single transaction.
  *
- * Must be called with CLogControlLock held
+ * Must be called with the bank lock for the xid's page held
  */
 static void
 TransactionIdSetStatusBit(TransactionId xid, XidStatus status, XLogRecPtr lsn, int slotno)
@@ -406,7 +410,7 @@ TransactionIdGetStatus(TransactionId xid, XLogRecPtr *lsn)
 	lsnindex = GetLSNIndex(slotno, xid);
 	*lsn = ClogCtl->shared->group_lsn[lsnindex];
 
-	LWLockRelease(CLogControlLock);
+	LWLockRelease(SimpleLruGetBankLock(ClogCtl, pageno));
 
 	return status;
 }
@@ -414,30 +418,19 @@ TransactionIdGetStatus(TransactionId xid, XLogRecPtr *lsn)
 /*
  * Number of shared CLOG buffers.
  *
- * Testing during the PostgreSQL 9.2 development cycle revealed that on a
- * large multi-processor system, it was possible to have more CLOG page
- * requests in flight at one time than the numebr of CLOG buffers which existed
- * at that time, which was hardcoded to 8.	Further testing revealed that
- * performance dropped off with more than 32 CLOG buffers, possibly because
- * the linear buffer search algorithm doesn't scale well.
- *
- * Unconditionally increasing the number of CLOG buffers to 32 did not seem
- * like a good idea, because it would increase the minimum amount of shared
- * memory required to start, which could be a problem for people running very
- * small configurations.  The following formula seems to represent a reasonable
- * compromise: people with very low values for shared_buffers will get fewer
- * CLOG buffers as well, and everyone else will get 32.
- *
- * It is likely that some further work will be needed here in future releases;
- * for example, on a 64-core server, the maximum number of CLOG requests that
- * can be simultaneously in flight will be even larger.  But that will
- * apparently require more than just changing the formula, so for now we take
- * the easy way out.
+ * This is clog_buffers if set.  Otherwise we size CLOG by shared_buffers:
+ * people with very low values for shared_buffers get a single bank of
+ * buffers, and larger configurations get up to 1024.  Lookups only search
+ * the page's bank, so the number of buffers no longer limits how fast CLOG
+ * pages can be found, but the result must be a whole number of banks.
  */
 Size
 CLOGShmemBuffers(void)
 {
-	return Min(32, Max(4, NBuffers / 512));
+	if (clog_buffers > 0)
+		return clog_buffers;
+	return Min(1024, Max(SLRU_BANK_SIZE, NBuffers / 512)) &
+		~(SLRU_BANK_SIZE - 1);
 }
 
 /*
@@ -453,8 +446,8 @@ void
 CLOGShmemInit(void)
 {
 	ClogCtl->PagePrecedes = CLOGPagePrecedes;
-	SimpleLruInit(ClogCtl, "CLOG Ctl", CLOGShmemBuffers(), CLOG_LSNS_PER_PAGE,
-				  CLogControlLock, "pg_clog");
+	SimpleLruInitBanked(ClogCtl, "CLOG Ctl", CLOGShmemBuffers(),
+						CLOG_LSNS_PER_PAGE, "pg_clog");
 }
 
 /*
@@ -466,9 +459,10 @@ CLOGShmemInit(void)
 void
 BootStrapCLOG(void)
 {
+	LWLockId	banklock = SimpleLruGetBankLock(ClogCtl, 0);
 	int			slotno;
 
-	LWLockAcquire(CLogControlLock, LW_EXCLUSIVE);
+	LWLockAcquire(banklock, LW_EXCLUSIVE);
 
 	/* Create and zero the first page of the commit log */
 	slotno = ZeroCLOGPage(0, false);
@@ -477,7 +471,7 @@ BootStrapCLOG(void)
 	SimpleLruWritePage(ClogCtl, slotno);
 	Assert(!ClogCtl->shared->page_dirty[slotno]);
 
-	LWLockRelease(CLogControlLock);
+	LWLockRelease(banklock);
 }
 
 /*
@@ -487,7 +481,7 @@ BootStrapCLOG(void)
  * The page is not actually written, just set up in shared memory.
  * The slot number of the new page is returned.
  *
- * Control lock must be held at entry, and will be held at exit.
+ * The bank lock for pageno must be held at entry, and will be held at exit.
  */
 static int
 ZeroCLOGPage(int pageno, bool writeXlog)
@@ -511,15 +505,16 @@ StartupCLOG(void)
 {
 	TransactionId xid = ShmemVariableCache->nextXid;
 	int			pageno = TransactionIdToPage(xid);
+	LWLockId	banklock = SimpleLruGetBankLock(ClogCtl, pageno);
 
-	LWLockAcquire(CLogControlLock, LW_EXCLUSIVE);
+	LWLockAcquire(banklock, LW_EXCLUSIVE);
 
 	/*
 	 * Initialize our idea of the latest page number.
 	 */
 	ClogCtl->shared->latest_page_number = pageno;
 
-	LWLockRelease(CLogControlLock);
+	LWLockRelease(banklock);
 }
 
 /*
@@ -530,8 +525,9 @@ TrimCLOG(void)
 {
 	TransactionId xid = ShmemVariableCache->nextXid;
 	int			pageno = TransactionIdToPage(xid);
+	LWLockId	banklock = SimpleLruGetBankLock(ClogCtl, pageno);
 
-	LWLockAcquire(CLogControlLock, LW_EXCLUSIVE);
+	LWLockAcquire(banklock, LW_EXCLUSIVE);
 
 	/*
 	 * Re-Initialize our idea of the latest page number.
@@ -568,7 +564,7 @@ TrimCLOG(void)
 		ClogCtl->shared->page_dirty[slotno] = true;
 	}
 
-	LWLockRelease(CLogControlLock);
+	LWLockRelease(banklock);
 }
 
 /*
@@ -608,6 +604,7 @@ void
 ExtendCLOG(TransactionId newestXact)
 {
 	int			pageno;
+	LWLockId	banklock;
 
 	/*
 	 * No work except at first XID of a page.  But beware: just after
@@ -618,13 +615,14 @@ ExtendCLOG(TransactionId newestXact)
 		return;
 
 	pageno = TransactionIdToPage(newestXact);
+	banklock = SimpleLruGetBankLock(ClogCtl, pageno);
 
-	LWLockAcquire(CLogControlLock, LW_EXCLUSIVE);
+	LWLockAcquire(banklock, LW_EXCLUSIVE);
 
 	/* Zero the page and make an XLOG entry about it */
 	ZeroCLOGPage(pageno, true);
 
-	LWLockRelease(CLogControlLock);
+	LWLockRelease(banklock);
 }
 
 
@@ -740,16 +738,18 @@ clog_redo(XLogRecPtr lsn, XLogRecord *record)
 	{
 		int			pageno;
 		int			slotno;
+		LWLockId	banklock;
 
 		memcpy(&pageno, XLogRecGetData(record), sizeof(int));
+		banklock = SimpleLruGetBankLock(ClogCtl, pageno);
 
-		LWLockAcquire(CLogControlLock, LW_EXCLUSIVE);
+		LWLockAcquire(banklock, LW_EXCLUSIVE);
 
 		slotno = ZeroCLOGPage(pageno, false);
 		SimpleLruWritePage(ClogCtl, slotno);
 		Assert(!ClogCtl->shared->page_dirty[slotno]);
 
-		LWLockRelease(CLogControlLock);
+		LWLockRelease(banklock);
 	}
 	else if (info == CLOG_TRUNCATE)
 	{
@@ -0,0 +1,840 @@
+/*-------------------------------------------------------------------------
+ *
+ * parallel.c
+ *	  Infrastructure for launching parallel workers
+ *
+ * A backend that wants to run part of a query in parallel creates a
+ * ParallelContext, which claims one of a fixed number of slots in shared
+ * memory along with one tuple queue per requested worker, and then launches
+ * dynamic background workers.  Each worker connects to the same database as
+ * the leader, adopts the leader's snapshot, claims one of the queues, and
+ * runs its share of the work, sending the resulting tuples back to the
+ * leader.  Currently the only kind of work supported is a sequential scan
+ * of a single relation, with a qualification that can be evaluated without
+ * any of the leader's session state.
+ *
+ * Because each slot's data area and queues are of fixed size, the pool is
+ * sized according to max_worker_processes, and CreateParallelContext simply
+ * returns NULL if there is no room; the caller must then do all of the work
+ * itself.  The same is true if no workers can be launched, or if they are
+ * slow to start: the leader participates in the scan, and once it runs out
+ * of work it stops accepting new workers.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/transam/parallel.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <signal.h>
+
+#include "access/heapam.h"
+#include "access/parallel.h"
+#include "access/xact.h"
+#include "executor/execParallel.h"
+#include "miscadmin.h"
+#include "nodes/nodes.h"
+#include "storage/ipc.h"
+#include "storage/lmgr.h"
+#include "storage/proc.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/memutils.h"
+#include "utils/snapmgr.h"
+#include "utils/tqual.h"
+
+/* Size of the per-slot area holding the snapshot and the qual. */
+#define PARALLEL_DATA_SIZE		(64 * 1024)
+
+/* Size of each tuple queue. */
+#define PARALLEL_QUEUE_SIZE		(64 * 1024)
+
+/* Space reserved for an error message reported by a worker. */
+#define PARALLEL_ERROR_SIZE		1024
+
+/*
+ * A queue assigned to a parallel context.  The worker that claims it sets
+ * done just before detaching if it completed its share of the scan; a queue
+ * that is detached without that is a sign that the worker failed.
+ */
+typedef struct ParallelQueueEntry
+{
+	int			queueno;		/* index into the shared queue pool */
+	bool		done;			/* worker finished cleanly? */
+} ParallelQueueEntry;
+
+/*
+ * Shared state for one parallel operation.
+ *
+ * in_use, closed, generation, refcount and nattached are protected by
+ * ParallelQueryLock.  The leader fills in the remaining fields before any
+ * worker is launched, and they don't change after that, except for the
+ * error fields, which are protected by mutex.  Workers claim queues in
+ * order, so queue[i] for i >= nattached has not been claimed by anybody.
+ */
+typedef struct ParallelQuerySlot
+{
+	bool		in_use;
+	bool		closed;			/* no more workers may attach */
+	uint32		generation;		/* identifies this use of the slot */
+	int			refcount;		/* leader plus attached workers */
+	int			nqueues;		/* number of entries in queue[] */
+	int			nattached;		/* number of queues claimed */
+
+	Oid			database_id;
+	Oid			user_id;
+	Oid			relid;
+	Size		qual_offset;	/* offset of qual string within data */
+	char	   *data;			/* serialized snapshot, then qual */
+	ParallelHeapScanDescData pscan;
+
+	slock_t		mutex;
+	bool		has_error;
+	int			sqlerrcode;
+	char		errmsg[PARALLEL_ERROR_SIZE];
+
+	ParallelQueueEntry queue[FLEXIBLE_ARRAY_MEMBER];
+} ParallelQuerySlot;
+
+/*
+ * Control structure for the whole pool, protected by ParallelQueryLock.
+ */
+typedef struct ParallelControl
+{
+	uint32		next_generation;
+	Size		slot_size;
+	char	   *slots;
+	char	   *queues;
+	bool	   *queue_in_use;
+} ParallelControl;
+
+/* Snapshot in the form in which it's passed to workers. */
+typedef struct SerializedSnapshotData
+{
+	TransactionId xmin;
+	TransactionId xmax;
+	uint32		xcnt;
+	int32		subxcnt;
+	bool		suboverflowed;
+	bool		takenDuringRecovery;
+	CommandId	curcid;
+} SerializedSnapshotData;
+
+static ParallelControl *ParallelCtl = NULL;
+
+/* List of live parallel contexts created by this backend. */
+static dlist_head pcxt_list = DLIST_STATIC_INIT(pcxt_list);
+
+/* Worker-side state, for cleanup at exit. */
+static ParallelQuerySlot *MyParallelSlot = NULL;
+static int	MyParallelQueue = -1;
+
+#define ParallelSlotAddress(i) \
+	((ParallelQuerySlot *) (ParallelCtl->slots + (Size) (i) * ParallelCtl->slot_size))
+#define ParallelQueueAddress(queueno) \
+	((shm_mq *) (ParallelCtl->queues + (Size) (queueno) * PARALLEL_QUEUE_SIZE))
+
+static Size ParallelSlotSize(void);
+static Size EstimateSnapshotSpace(Snapshot snapshot);
+static void SerializeSnapshot(Snapshot snapshot, char *start_address);
+static Snapshot RestoreSnapshot(char *start_address);
+static void ParallelSlotRelease(ParallelQuerySlot *slot);
+static void ParallelCheckWorkerExit(ParallelContext *pcxt, int i);
+static void ParallelWorkerShutdown(int code, Datum arg);
+static void ParallelWorkerReportError(void);
+
+
+/*
+ * Size of one ParallelQuerySlot, including its queue array.
+ */
+static Size
+ParallelSlotSize(void)
+{
+	return MAXALIGN(add_size(offsetof(ParallelQuerySlot, queue),
+							 mul_size(max_worker_processes,
+									  sizeof(ParallelQueueEntry))));
+}
+
+/*
+ * Report shared-memory space needed by ParallelShmemInit
+ */
+Size
+ParallelShmemSize(void)
+{
+	Size		size;
+
+	size = MAXALIGN(sizeof(ParallelControl));
+	size = add_size(size, MAXALIGN(mul_size(max_worker_processes,
+											sizeof(bool))));
+	size = add_size(size, mul_size(max_worker_processes, ParallelSlotSize()));
+	size = add_size(size, mul_size(max_worker_processes, PARALLEL_DATA_SIZE));
+	size = add_size(size, mul_size(max_worker_processes, PARALLEL_QUEUE_SIZE));
+
+	return size;
+}
+
+/*
+ * Allocate and initialize parallel query related shared memory
+ */
+void
+ParallelShmemInit(void)
+{
+	bool		found;
+
+	ParallelCtl = (ParallelControl *)
+		ShmemInitStruct("Parallel Query Data", ParallelShmemSize(), &found);
+
+	if (!found)
+	{
+		char	   *ptr = (char *) ParallelCtl;
+		char	   *data;
+		int			i;
+
+		ptr += MAXALIGN(sizeof(ParallelControl));
+		ParallelCtl->queue_in_use = (bool *) ptr;
+		ptr += MAXALIGN(mul_size(max_worker_processes, sizeof(bool)));
+		ParallelCtl->slots = ptr;
+		ParallelCtl->slot_size = ParallelSlotSize();
+		ptr += mul_size(max_worker_processes, ParallelCtl->slot_size);
+		data = ptr;
+		ptr += mul_size(max_worker_processes, PARALLEL_DATA_SIZE);
+		ParallelCtl->queues = ptr;
+		ParallelCtl->next_generation = 0;
+
+		for (i = 0; i < max_worker_processes; i++)
+		{
+			ParallelQuerySlot *slot = ParallelSlotAddress(i);
+
+			ParallelCtl->queue_in_use[i] = false;
+			slot->in_use = false;
+			slot->generation = 0;
+			slot->refcount = 0;
+			slot->data = data + (Size) i * PARALLEL_DATA_SIZE;
+			SpinLockInit(&slot->mutex);
+		}
+	}
+}
+
+/*
+ * Create a parallel context for a sequential scan of rel, using the given
+ * snapshot, in which workers return the tuples satisfying qual.
+ *
+ * Returns NULL if the required shared resources are not available, in which
+ * case the caller must do the scan by itself.  Otherwise, the result has
+ * between 1 and nworkers queues, and pcxt->pscan must be used by the
+ * caller's own share of the scan as well.
+ */
+ParallelContext *
+CreateParallelContext(int nworkers, Relation rel, Snapshot snapshot,
+					  List *qual)
+{
+	ParallelContext *pcxt;
+	ParallelQuerySlot *slot = NULL;
+	MemoryContext oldcontext;
+	char	   *qualstr;
+	Size		snapsize;
+	Size		qualsize;
+	int			nqueues = 0;
+	int			i;
+
+	Assert(nworkers > 0);
+
+	/* Standalone backends can't launch workers. */
+	if (!IsUnderPostmaster || !IsMVCCSnapshot(snapshot))
+		return NULL;
+
+	snapsize = EstimateSnapshotSpace(snapshot);
+	qualstr = nodeToString(qual);
+	qualsize = strlen(qualstr) + 1;
+	if (add_size(snapsize, qualsize) > PARALLEL_DATA_SIZE)
+		return NULL;
+	nworkers = Min(nworkers, max_worker_processes);
+
+	/* Allocate local state first, so that errors can't leak a slot. */
+	oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+	pcxt = palloc0(sizeof(ParallelContext));
+	pcxt->subid = GetCurrentSubTransactionId();
+	pcxt->queues = palloc0(sizeof(shm_mq_handle *) * nworkers);
+	pcxt->queue_active = palloc0(sizeof(bool) * nworkers);
+	MemoryContextSwitchTo(oldcontext);
+
+	LWLockAcquire(ParallelQueryLock, LW_EXCLUSIVE);
+	for (i = 0; i < max_worker_processes; i++)
+	{
+		if (!ParallelSlotAddress(i)->in_use)
+		{
+			slot = ParallelSlotAddress(i);
+			break;
+		}
+	}
+	if (slot != NULL)
+	{
+		for (i = 0; i < max_worker_processes && nqueues < nworkers; i++)
+		{
+			if (ParallelCtl->queue_in_use[i])
+				continue;
+			ParallelCtl->queue_in_use[i] = true;
+			slot->queue[nqueues].queueno = i;
+			slot->queue[nqueues].done = false;
+			nqueues++;
+		}
+	}
+	if (nqueues == 0)
+	{
+		LWLockRelease(ParallelQueryLock);
+		pfree(pcxt->queues);
+		pfree(pcxt->queue_active);
+		pfree(pcxt);
+		return NULL;
+	}
+	slot->in_use = true;
+	slot->closed = false;
+	if (++ParallelCtl->next_generation == 0)
+		++ParallelCtl->next_generation;
+	slot->generation = ParallelCtl->next_generation;
+	slot->refcount = 1;
+	slot->nqueues = nqueues;
+	slot->nattached = 0;
+	LWLockRelease(ParallelQueryLock);
+
+	pcxt->slot = slot;
+	pcxt->nworkers = nqueues;
+	pcxt->pscan = &slot->pscan;
+	dlist_push_head(&pcxt_list, &pcxt->node);
+
+	/* Nobody else can look at the slot yet, so no locking is needed. */
+	slot->database_id = MyDatabaseId;
+	slot->user_id = GetUserId();
+	slot->relid = RelationGetRelid(rel);
+	slot->has_error = false;
+	SerializeSnapshot(snapshot, slot->data);
+	slot->qual_offset = snapsize;
+	memcpy(slot->data + snapsize, qualstr, qualsize);
+
+	oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+	for (i = 0; i < nqueues; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(ParallelQueueAddress(slot->queue[i].queueno),
+						   PARALLEL_QUEUE_SIZE);
+		shm_mq_set_receiver(mq, MyProc);
+		pcxt->queues[i] = shm_mq_attach(mq, NULL);
+		pcxt->queue_active[i] = true;
+	}
+	pcxt->nreaders = nqueues;
+	MemoryContextSwitchTo(oldcontext);
+
+	heap_parallelscan_initialize(pcxt->pscan, rel);
+
+	pfree(qualstr);
+
+	return pcxt;
+}
+
+/*
+ * Launch one worker per queue.  It's not an error if some or all of them
+ * can't be registered; those queues will simply never be claimed.
+ */
+void
+LaunchParallelWorkers(ParallelContext *pcxt)
+{
+	BackgroundWorker worker;
+	int			i;
+
+	memset(&worker, 0, sizeof(worker));
+	snprintf(worker.bgw_name, BGW_MAXLEN, "parallel worker for PID %d",
+			 MyProcPid);
+	worker.bgw_flags =
+		BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
+	worker.bgw_start_time = BgWorkerStart_ConsistentState;
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	worker.bgw_main = ParallelQueryWorkerMain;
+	worker.bgw_main_arg = UInt32GetDatum(pcxt->slot->generation);
+	worker.bgw_notify_pid = 0;
+
+	for (i = 0; i < pcxt->nworkers; i++)
+	{
+		if (!RegisterDynamicBackgroundWorker(&worker, NULL))
+			break;
+		pcxt->nworkers_launched++;
+	}
+
+	/* If we couldn't launch anybody, don't wait for them. */
+	if (pcxt->nworkers_launched == 0)
+		CloseParallelContext(pcxt);
+}
+
+/*
+ * Stop accepting new workers.  Queues that nobody has claimed yet are
+ * marked detached, so that reading from them doesn't wait.
+ *
+ * The leader calls this once it has run out of work of its own, so that a
+ * worker which is slow to start won't delay completion of the query.
+ */
+void
+CloseParallelContext(ParallelContext *pcxt)
+{
+	ParallelQuerySlot *slot = pcxt->slot;
+	int			nattached;
+	int			i;
+
+	LWLockAcquire(ParallelQueryLock, LW_EXCLUSIVE);
+	slot->closed = true;
+	nattached = slot->nattached;
+	LWLockRelease(ParallelQueryLock);
+
+	for (i = nattached; i < pcxt->nworkers; i++)
+		shm_mq_detach(ParallelQueueAddress(slot->queue[i].queueno));
+}
+
+/*
+ * Read the next tuple sent by any worker.
+ *
+ * If nowait is true and no tuple is immediately available, returns NULL
+ * with *done set to false.  Once all queues have been drained and detached,
+ * returns NULL with *done set to true.  If a worker failed, its error is
+ * rethrown here.
+ *
+ * The tuple is valid only until the next call.
+ */
+MinimalTuple
+ParallelContextReadTuple(ParallelContext *pcxt, bool nowait, bool *done)
+{
+	for (;;)
+	{
+		int			nvisited;
+
+		for (nvisited = 0;
+			 nvisited < pcxt->nworkers && pcxt->nreaders > 0;
+			 nvisited++)
+		{
+			int			i = pcxt->nextreader;
+			shm_mq_result res;
+			Size		nbytes;
+			void	   *data;
+
+			pcxt->nextreader = (i + 1) % pcxt->nworkers;
+			if (!pcxt->queue_active[i])
+				continue;
+
+			res = shm_mq_receive(pcxt->queues[i], &nbytes, &data, true);
+			if (res == SHM_MQ_SUCCESS)
+			{
+				*done = false;
+				return (MinimalTuple) data;
+			}
+			if (res == SHM_MQ_DETACHED)
+			{
+				ParallelCheckWorkerExit(pcxt, i);
+				pcxt->queue_active[i] = false;
+				pcxt->nreaders--;
+			}
+		}
+
+		if (pcxt->nreaders == 0)
+		{
+			*done = true;
+			return NULL;
+		}
+
+		*done = false;
+		if (nowait)
+			return NULL;
+
+		WaitLatch(&MyProc->procLatch, WL_LATCH_SET, 0);
+		ResetLatch(&MyProc->procLatch);
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+/*
+ * A queue has been detached.  Make sure it was for a good reason.
+ */
+static void
+ParallelCheckWorkerExit(ParallelContext *pcxt, int i)
+{
+	volatile ParallelQuerySlot *slot = pcxt->slot;
+	int			nattached;
+
+	if (slot->queue[i].done)
+		return;
+
+	/* Unclaimed queues are detached by CloseParallelContext. */
+	LWLockAcquire(ParallelQueryLock, LW_SHARED);
+	nattached = slot->nattached;
+	LWLockRelease(ParallelQueryLock);
+	if (i >= nattached)
+		return;
+
+	SpinLockAcquire(&slot->mutex);
+	if (slot->has_error)
+	{
+		char		errmsg[PARALLEL_ERROR_SIZE];
+		int			sqlerrcode = slot->sqlerrcode;
+
+		strlcpy(errmsg, (char *) slot->errmsg, PARALLEL_ERROR_SIZE);
+		SpinLockRelease(&slot->mutex);
+		ereport(ERROR,
+				(errcode(sqlerrcode),
+				 errmsg_internal("%s", errmsg),
+				 errcontext("parallel worker")));
+	}
+	SpinLockRelease(&slot->mutex);
+
+	ereport(ERROR,
+			(errmsg("parallel worker exited unexpectedly")));
+}
+
+/*
+ * Shut down a parallel context.
+ *
+ * Any workers still running are told there is nothing more to do, by
+ * exhausting the shared block allocator and detaching from their queues;
+ * we don't wait for them to exit.  The shared slot is freed by whichever
+ * process detaches last.
+ */
+void
+DestroyParallelContext(ParallelContext *pcxt)
+{
+	ParallelQuerySlot *slot = pcxt->slot;
+	int			i;
+
+	CloseParallelContext(pcxt);
+
+	if (pcxt->nreaders > 0)
+	{
+		volatile ParallelHeapScanDescData *pscan = pcxt->pscan;
+
+		SpinLockAcquire(&pscan->phs_mutex);
+		pscan->phs_cblock = pscan->phs_nblocks;
+		SpinLockRelease(&pscan->phs_mutex);
+
+		for (i = 0; i < pcxt->nworkers; i++)
+			if (pcxt->queue_active[i])
+				shm_mq_detach(ParallelQueueAddress(slot->queue[i].queueno));
+	}
+
+	ParallelSlotRelease(slot);
+
+	dlist_delete(&pcxt->node);
+	for (i = 0; i < pcxt->nworkers; i++)
+		pfree(pcxt->queues[i]);
+	pfree(pcxt->queues);
+	pfree(pcxt->queue_active);
+	pfree(pcxt);
+}
+
+/*
+ * Drop one reference to a slot, freeing it and its queues if it was the
+ * last one.
+ */
+static void
+ParallelSlotRelease(ParallelQuerySlot *slot)
+{
+	LWLockAcquire(ParallelQueryLock, LW_EXCLUSIVE);
+	Assert(slot->refcount > 0);
+	if (--slot->refcount == 0)
+	{
+		int			i;
+
+		for (i = 0; i < slot->nqueues; i++)
+			ParallelCtl->queue_in_use[slot->queue[i].queueno] = false;
+		slot->in_use = false;
+	}
+	LWLockRelease(ParallelQueryLock);
+}
+
+/*
+ * End-of-transaction cleanup: shut down any parallel contexts that are
+ * still around.  At commit, the executor should already have done so.
+ */
+void
+AtEOXact_Parallel(bool isCommit)
+{
+	while (!dlist_is_empty(&pcxt_list))
+	{
+		ParallelContext *pcxt;
+
+		pcxt = dlist_head_element(ParallelContext, node, &pcxt_list);
+		if (isCommit)
+			elog(WARNING, "leaked parallel context");
+		DestroyParallelContext(pcxt);
+	}
+}
+
+/*
+ * End-of-subtransaction cleanup.  On commit, contexts created in the
+ * subtransaction may still be in use (for example, by an open cursor), so
+ * they are passed up to the parent.
+ */
+void
+AtEOSubXact_Parallel(bool isCommit, SubTransactionId mySubId,
+					 SubTransactionId parentSubId)
+{
+	dlist_mutable_iter iter;
+
+	dlist_foreach_modify(iter, &pcxt_list)
+	{
+		ParallelContext *pcxt;
+
+		pcxt = dlist_container(ParallelContext, node, iter.cur);
+		if (pcxt->subid != mySubId)
+			continue;
+		if (isCommit)
+			pcxt->subid = parentSubId;
+		else
+			DestroyParallelContext(pcxt);
+	}
+}
+
+/*
+ * Main entry point for parallel worker processes.
+ *
+ * main_arg is the generation number of the slot we are to work on; if the
+ * slot has been reused or closed by the time we get here, there's nothing
+ * to do.
+ */
+void
+ParallelQueryWorkerMain(Datum main_arg)
+{
+	uint32		generation = DatumGetUInt32(main_arg);
+	ParallelQuerySlot *slot = NULL;
+	Oid			database_id = InvalidOid;
+	Oid			user_id = InvalidOid;
+	Oid			relid = InvalidOid;
+	Relation	rel;
+	Snapshot	snapshot;
+	List	   *qual;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+	int			i;
+
+	/* Let SIGTERM interrupt us at the next CHECK_FOR_INTERRUPTS. */
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	/* Find our slot. */
+	LWLockAcquire(ParallelQueryLock, LW_SHARED);
+	for (i = 0; i < max_worker_processes; i++)
+	{
+		ParallelQuerySlot *s = ParallelSlotAddress(i);
+
+		if (s->in_use && s->generation == generation && !s->closed)
+		{
+			slot = s;
+			database_id = s->database_id;
+			user_id = s->user_id;
+			relid = s->relid;
+			break;
+		}
+	}
+	LWLockRelease(ParallelQueryLock);
+	if (slot == NULL)
+		proc_exit(0);
+
+	BackgroundWorkerInitializeConnectionByOid(database_id, user_id);
+
+	/*
+	 * We use the leader's snapshot, not one of our own, so the isolation
+	 * level only matters to the extent that serializable would make us take
+	 * predicate locks.  Don't.
+	 */
+	DefaultXactIsoLevel = XACT_READ_COMMITTED;
+	StartTransactionCommand();
+	(void) GetTransactionSnapshot();
+
+	/*
+	 * The leader holds a lock on the relation, but if somebody is waiting
+	 * for a conflicting lock, waiting behind them would deadlock with the
+	 * leader in a way the deadlock detector can't see.  Just give up and
+	 * leave the work to the leader in that case.
+	 */
+	if (!ConditionalLockRelationOid(relid, AccessShareLock))
+	{
+		CommitTransactionCommand();
+		proc_exit(0);
+	}
+
+	/* Claim a queue, unless the leader has already finished. */
+	LWLockAcquire(ParallelQueryLock, LW_EXCLUSIVE);
+	if (!slot->in_use || slot->generation != generation || slot->closed ||
+		slot->nattached >= slot->nqueues)
+	{
+		LWLockRelease(ParallelQueryLock);
+		CommitTransactionCommand();
+		proc_exit(0);
+	}
+	MyParallelQueue = slot->nattached++;
+	slot->refcount++;
+	LWLockRelease(ParallelQueryLock);
+
+	MyParallelSlot = slot;
+	on_shmem_exit(ParallelWorkerShutdown, (Datum) 0);
+
+	mq = ParallelQueueAddress(slot->queue[MyParallelQueue].queueno);
+	shm_mq_set_sender(mq, MyProc);
+	mqh = shm_mq_attach(mq, NULL);
+
+	/*
+	 * Adopt the leader's snapshot.  Advertising its xmin is safe because the
+	 * leader's own xmin is at least as old and it's still running.
+	 */
+	snapshot = RestoreSnapshot(slot->data);
+	LWLockAcquire(ProcArrayLock, LW_SHARED);
+	MyPgXact->xmin = snapshot->xmin;
+	LWLockRelease(ProcArrayLock);
+	TransactionXmin = snapshot->xmin;
+	PushActiveSnapshot(snapshot);
+
+	rel = heap_open(relid, NoLock);
+	qual = (List *) stringToNode(slot->data + slot->qual_offset);
+
+	PG_TRY();
+	{
+		ExecParallelScan(rel, snapshot, &slot->pscan, qual, mqh);
+	}
+	PG_CATCH();
+	{
+		ParallelWorkerReportError();
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	heap_close(rel, NoLock);
+	PopActiveSnapshot();
+	CommitTransactionCommand();
+
+	slot->queue[MyParallelQueue].done = true;
+
+	proc_exit(0);
+}
+
+/*
+ * Copy the current error into the shared slot, where the leader will find
+ * it once it notices that we've detached.
+ */
+static void
+ParallelWorkerReportError(void)
+{
+	volatile ParallelQuerySlot *slot = MyParallelSlot;
+	ErrorData  *edata;
+
+	MemoryContextSwitchTo(TopMemoryContext);
+	edata = CopyErrorData();
+
+	SpinLockAcquire(&slot->mutex);
+	if (!slot->has_error)
+	{
+		slot->has_error = true;
+		slot->sqlerrcode = edata->sqlerrcode;
+		strlcpy((char *) slot->errmsg, edata->message, PARALLEL_ERROR_SIZE);
+	}
+	SpinLockRelease(&slot->mutex);
+}
+
+/*
+ * on_shmem_exit callback for workers: detach from our queue and drop our
+ * reference to the slot.
+ */
+static void
+ParallelWorkerShutdown(int code, Datum arg)
+{
+	shm_mq_detach(ParallelQueueAddress(MyParallelSlot->queue[MyParallelQueue].queueno));
+	ParallelSlotRelease(MyParallelSlot);
+	MyParallelSlot = NULL;
+}
+
+/*
+ * Space needed to serialize a snapshot.
+ */
+static Size
+EstimateSnapshotSpace(Snapshot snapshot)
+{
+	Size		size;
+
+	size = MAXALIGN(sizeof(SerializedSnapshotData));
+	size = add_size(size, mul_size(snapshot->xcnt, sizeof(TransactionId)));
+	if (snapshot->subxcnt > 0)
+		size = add_size(size, mul_size(snapshot->subxcnt,
+									   sizeof(TransactionId)));
+
+	return size;
+}
+
+/*
+ * Dump a snapshot into memory, in a form RestoreSnapshot can read back.
+ */
+static void
+SerializeSnapshot(Snapshot snapshot, char *start_address)
+{
+	SerializedSnapshotData *serialized;
+	TransactionId *xids;
+
+	serialized = (SerializedSnapshotData *) start_address;
+	serialized->xmin = snapshot->xmin;
+	serialized->xmax = snapshot->xmax;
+	serialized->xcnt = snapshot->xcnt;
+	serialized->subxcnt = snapshot->subxcnt;
+	serialized->suboverflowed = snapshot->suboverflowed;
+	serialized->takenDuringRecovery = snapshot->takenDuringRecovery;
+	serialized->curcid = snapshot->curcid;
+
+	xids = (TransactionId *) (start_address +
+							  MAXALIGN(sizeof(SerializedSnapshotData)));
+	if (snapshot->xcnt > 0)
+		memcpy(xids, snapshot->xip, snapshot->xcnt * sizeof(TransactionId));
+	if (snapshot->subxcnt > 0)
+		memcpy(xids + snapshot->xcnt, snapshot->subxip,
+			   snapshot->subxcnt * sizeof(TransactionId));
+}
+
+/*
+ * Rebuild a snapshot written by SerializeSnapshot.  The result is allocated
+ * in TopTransactionContext, as a single chunk like CopySnapshot's.
+ */
+static Snapshot
+RestoreSnapshot(char *start_address)
+{
+	SerializedSnapshotData *serialized;
+	TransactionId *xids;
+	Snapshot	snapshot;
+	Size		size;
+
+	serialized = (SerializedSnapshotData *) start_address;
+	xids = (TransactionId *) (start_address +
+							  MAXALIGN(sizeof(SerializedSnapshotData)));
+
+	size = sizeof(SnapshotData) +
+		serialized->xcnt * sizeof(TransactionId) +
+		Max(serialized->subxcnt, 0) * sizeof(TransactionId);
+	snapshot = (Snapshot) MemoryContextAlloc(TopTransactionContext, size);
+
+	snapshot->satisfies = HeapTupleSatisfiesMVCC;
+	snapshot->xmin = serialized->xmin;
+	snapshot->xmax = serialized->xmax;
+	snapshot->xcnt = serialized->xcnt;
+	snapshot->subxcnt = serialized->subxcnt;
+	snapshot->suboverflowed = serialized->suboverflowed;
+	snapshot->takenDuringRecovery = serialized->takenDuringRecovery;
+	snapshot->curcid = serialized->curcid;
+	snapshot->copied = true;
+	snapshot->active_count = 0;
+	snapshot->regd_count = 0;
+
+	snapshot->xip = (TransactionId *) (snapshot + 1);
+	if (snapshot->xcnt > 0)
+		memcpy(snapshot->xip, xids, snapshot->xcnt * sizeof(TransactionId));
+
+	snapshot->subxip = snapshot->xip + snapshot->xcnt;
+	if (snapshot->subxcnt > 0)
+		memcpy(snapshot->subxip, xids + snapshot->xcnt,
+			   snapshot->subxcnt * sizeof(TransactionId));
+
+	return snapshot;
+}
@@ -7,19 +7,28 @@
  * buffers.  Under ordinary circumstances we expect that write
  * traffic will occur mostly to the latest page (and to the just-prior
  * page, soon after a page transition).  Read traffic will probably touch
- * a larger span of pages, but in any case a fairly small number of page
- * buffers should be sufficient.  So, we just search the buffers using plain
- * linear search; there's no need for a hashtable or anything fancy.
- * The management algorithm is straight LRU except that we will never swap
- * out the latest page (since we know it's going to be hit again eventually).
+ * a larger span of pages, and workloads with long-running transactions or
+ * many subtransactions may need a lot of buffers to avoid thrashing.
  *
- * We use a control LWLock to protect the shared data structures, plus
- * per-buffer LWLocks that synchronize I/O for each buffer.  The control lock
- * must be held to examine or modify any shared state.	A process that is
- * reading in or writing out a page buffer does not hold the control lock,
- * only the per-buffer lock for the buffer it is working on.
+ * So that lookups stay cheap with large buffer pools, the buffers are
+ * divided into banks of SLRU_BANK_SIZE slots, and each page number maps to
+ * exactly one bank (pageno modulo the number of banks).  A page is looked
+ * up by plain linear search of its bank, and a victim buffer is chosen from
+ * that bank only.  The management algorithm is straight LRU within a bank,
+ * except that we will never swap out the latest page (since we know it's
+ * going to be hit again eventually).
  *
- * "Holding the control lock" means exclusive lock in all cases except for
+ * Each bank's slots are protected by a bank lock, plus per-buffer LWLocks
+ * that synchronize I/O for each buffer.  The bank lock must be held to
+ * examine or modify any shared state of the bank's slots.  A process that
+ * is reading in or writing out a page buffer does not hold the bank lock,
+ * only the per-buffer lock for the buffer it is working on.  SLRUs set up
+ * with SimpleLruInitBanked() get a separate lock for each bank, so that
+ * accesses to pages in different banks don't contend; those set up with
+ * SimpleLruInit() use the caller's control lock for all banks.  Below,
+ * "the bank lock" means whichever lock protects the bank in question.
+ *
+ * "Holding the bank lock" means exclusive lock in all cases except for
  * SimpleLruReadPage_ReadOnly(); see comments for SlruRecentlyUsed() for
  * the implications of that.
  *
@@ -54,14 +63,21 @@
 #include "access/slru.h"
 #include "access/transam.h"
 #include "access/xlog.h"
+#include "pgstat.h"
 #include "storage/fd.h"
 #include "storage/shmem.h"
 #include "miscadmin.h"
+#include "utils/guc.h"
 
 
 #define SlruFileName(ctl, path, seg) \
 	snprintf(path, MAXPGPATH, "%s/%04X", (ctl)->Dir, seg)
 
+/* Bank holding a given slot, and the lock protecting it */
+#define SlruSlotBank(shared, slotno)	((slotno) / (shared)->bank_size)
+#define SlruSlotLock(shared, slotno) \
+	((shared)->bank_locks[SlruSlotBank(shared, slotno)])
+
 /*
  * During SimpleLruFlush(), we will usually not need to write/fsync more
  * than one or two physical files, but we may need to write several pages
@@ -86,13 +102,14 @@ typedef struct SlruFlushData *SlruFlush;
  *
  * The reason for the if-test is that there are often many consecutive
  * accesses to the same page (particularly the latest page).  By suppressing
- * useless increments of cur_lru_count, we reduce the probability that old
- * pages' counts will "wrap around" and make them appear recently used.
+ * useless increments of the bank's LRU counter, we reduce the probability
+ * that old pages' counts will "wrap around" and make them appear recently
+ * used.
  *
  * We allow this code to be executed concurrently by multiple processes within
  * SimpleLruReadPage_ReadOnly().  As long as int reads and writes are atomic,
  * this should not cause any completely-bogus values to enter the computation.
- * However, it is possible for either cur_lru_count or individual
+ * However, it is possible for either the bank's LRU counter or individual
  * page_lru_count entries to be "reset" to lower values than they should have,
  * in case a process is delayed while it executes this macro.  With care in
  * SlruSelectLRUPage(), this does little harm, and in any case the absolute
@@ -101,9 +118,11 @@ typedef struct SlruFlushData *SlruFlush;
  */
 #define SlruRecentlyUsed(shared, slotno)	\
 	do { \
-		int		new_lru_count = (shared)->cur_lru_count; \
+		int	   *bank_lru_count = \
+			&(shared)->bank_cur_lru_count[SlruSlotBank(shared, slotno)]; \
+		int		new_lru_count = *bank_lru_count; \
 		if (new_lru_count != (shared)->page_lru_count[slotno]) { \
-			(shared)->cur_lru_count = ++new_lru_count; \
+			*bank_lru_count = ++new_lru_count; \
 			(shared)->page_lru_count[slotno] = new_lru_count; \
 		} \
 	} while (0)
@@ -131,6 +150,9 @@ static bool SlruPhysicalWritePage(SlruCtl ctl, int pageno, int slotno,
 					  SlruFlush fdata);
 static void SlruReportIOError(SlruCtl ctl, int pageno, TransactionId xid);
 static int	SlruSelectLRUPage(SlruCtl ctl, int pageno);
+static void SimpleLruInitInternal(SlruCtl ctl, const char *name, int nslots,
+					  int nlsns, LWLockId ctllock, bool banked,
+					  const char *subdir);
 
 static bool SlruScanDirCbDeleteCutoff(SlruCtl ctl, char *filename,
 						  int segpage, void *data);
@@ -143,6 +165,7 @@ Size
 SimpleLruShmemSize(int nslots, int nlsns)
 {
 	Size		sz;
+	int			nbanks = SimpleLruNumBanks(nslots);
 
 	/* we assume nslots isn't so large as to risk overflow */
 	sz = MAXALIGN(sizeof(SlruSharedData));
@@ -152,6 +175,8 @@ SimpleLruShmemSize(int nslots, int nlsns)
 	sz += MAXALIGN(nslots * sizeof(int));		/* page_number[] */
 	sz += MAXALIGN(nslots * sizeof(int));		/* page_lru_count[] */
 	sz += MAXALIGN(nslots * sizeof(LWLockId));	/* buffer_locks[] */
+	sz += MAXALIGN(nbanks * sizeof(LWLockId));	/* bank_locks[] */
+	sz += MAXALIGN(nbanks * sizeof(int));		/* bank_cur_lru_count[] */
 
 	if (nlsns > 0)
 		sz += MAXALIGN(nslots * nlsns * sizeof(XLogRecPtr));	/* group_lsn[] */
@@ -159,12 +184,50 @@ SimpleLruShmemSize(int nslots, int nlsns)
 	return BUFFERALIGN(sz) + BLCKSZ * nslots;
 }
 
+/*
+ * Number of banks the given number of buffer slots is divided into.  This is
+ * also the number of extra LWLocks SimpleLruInitBanked() needs.
+ */
+int
+SimpleLruNumBanks(int nslots)
+{
+	if (nslots <= SLRU_BANK_SIZE)
+		return 1;
+	Assert(nslots % SLRU_BANK_SIZE == 0);
+	return nslots / SLRU_BANK_SIZE;
+}
+
+/*
+ * Initialize an SLRU whose buffers are all protected by the given control
+ * lock.  The caller is free to hold that lock while working on several
+ * pages at once.
+ */
 void
 SimpleLruInit(SlruCtl ctl, const char *name, int nslots, int nlsns,
 			  LWLockId ctllock, const char *subdir)
+{
+	SimpleLruInitInternal(ctl, name, nslots, nlsns, ctllock, false, subdir);
+}
+
+/*
+ * Initialize an SLRU with a separate lock for each bank of buffers.  Callers
+ * must hold SimpleLruGetBankLock(ctl, pageno) while working on page pageno,
+ * and must not hold more than one bank lock at a time.
+ */
+void
+SimpleLruInitBanked(SlruCtl ctl, const char *name, int nslots, int nlsns,
+					const char *subdir)
+{
+	SimpleLruInitInternal(ctl, name, nslots, nlsns, 0, true, subdir);
+}
+
+static void
+SimpleLruInitInternal(SlruCtl ctl, const char *name, int nslots, int nlsns,
+					  LWLockId ctllock, bool banked, const char *subdir)
 {
 	SlruShared	shared;
 	bool		found;
+	int			nbanks = SimpleLruNumBanks(nslots);
 
 	shared = (SlruShared) ShmemInitStruct(name,
 										  SimpleLruShmemSize(nslots, nlsns),
@@ -176,20 +239,21 @@ SimpleLruInit(SlruCtl ctl, const char *name, int nslots, int nlsns,
 		char	   *ptr;
 		Size		offset;
 		int			slotno;
+		int			bankno;
 
 		Assert(!found);
 
 		memset(shared, 0, sizeof(SlruSharedData));
 
-		shared->ControlLock = ctllock;
-
 		shared->num_slots = nslots;
+		shared->num_banks = nbanks;
+		shared->bank_size = nslots / nbanks;
 		shared->lsn_groups_per_page = nlsns;
 
-		shared->cur_lru_count = 0;
-
 		/* shared->latest_page_number will be set later */
 
+		shared->slru_stats_idx = pgstat_slru_index(name);
+
 		ptr = (char *) shared;
 		offset = MAXALIGN(sizeof(SlruSharedData));
 		shared->page_buffer = (char **) (ptr + offset);
@@ -204,6 +268,10 @@ SimpleLruInit(SlruCtl ctl, const char *name, int nslots, int nlsns,
 		offset += MAXALIGN(nslots * sizeof(int));
 		shared->buffer_locks = (LWLockId *) (ptr + offset);
 		offset += MAXALIGN(nslots * sizeof(LWLockId));
+		shared->bank_locks = (LWLockId *) (ptr + offset);
+		offset += MAXALIGN(nbanks * sizeof(LWLockId));
+		shared->bank_cur_lru_count = (int *) (ptr + offset);
+		offset += MAXALIGN(nbanks * sizeof(int));
 
 		if (nlsns > 0)
 		{
@@ -221,6 +289,12 @@ SimpleLruInit(SlruCtl ctl, const char *name, int nslots, int nlsns,
 			shared->buffer_locks[slotno] = LWLockAssign();
 			ptr += BLCKSZ;
 		}
+
+		for (bankno = 0; bankno < nbanks; bankno++)
+		{
+			shared->bank_locks[bankno] = banked ? LWLockAssign() : ctllock;
+			shared->bank_cur_lru_count[bankno] = 0;
+		}
 	}
 	else
 		Assert(found);
@@ -234,13 +308,28 @@ SimpleLruInit(SlruCtl ctl, const char *name, int nslots, int nlsns,
 	StrNCpy(ctl->Dir, subdir, sizeof(ctl->Dir));
 }
 
+/*
+ * GUC check_hook for the settings controlling the number of SLRU buffers
+ */
+bool
+check_slru_buffers(int *newval, void **extra, GucSource source)
+{
+	/* Valid values are multiples of SLRU_BANK_SIZE (0 meaning "auto") */
+	if (*newval % SLRU_BANK_SIZE == 0)
+		return true;
+
+	GUC_check_errdetail("The number of SLRU buffers must be a multiple of %d.",
+						SLRU_BANK_SIZE);
+	return false;
+}
+
 /*
  * Initialize (or reinitialize) a page to zeroes.
  *
  * The page is not actually written, just set up in shared memory.
  * The slot number of the new page is returned.
  *
- * Control lock must be held at entry, and will be held at exit.
+ * The bank lock for pageno must be held at entry, and will be held at exit.
  */
 int
 SimpleLruZeroPage(SlruCtl ctl, int pageno)
@@ -270,6 +359,8 @@ SimpleLruZeroPage(SlruCtl ctl, int pageno)
 	/* Assume this page is now the latest active page */
 	shared->latest_page_number = pageno;
 
+	pgstat_count_slru_page_zeroed(shared->slru_stats_idx);
+
 	return slotno;
 }
 
@@ -298,18 +389,19 @@ SimpleLruZeroLSNs(SlruCtl ctl, int slotno)
  * guarantee that new I/O hasn't been started before we return, though.
  * In fact the slot might not even contain the same page anymore.)
  *
- * Control lock must be held at entry, and will be held at exit.
+ * The slot's bank lock must be held at entry, and will be held at exit.
  */
 static void
 SimpleLruWaitIO(SlruCtl ctl, int slotno)
 {
 	SlruShared	shared = ctl->shared;
+	LWLockId	banklock = SlruSlotLock(shared, slotno);
 
 	/* See notes at top of file */
-	LWLockRelease(shared->ControlLock);
+	LWLockRelease(banklock);
 	LWLockAcquire(shared->buffer_locks[slotno], LW_SHARED);
 	LWLockRelease(shared->buffer_locks[slotno]);
-	LWLockAcquire(shared->ControlLock, LW_EXCLUSIVE);
+	LWLockAcquire(banklock, LW_EXCLUSIVE);
 
 	/*
 	 * If the slot is still in an io-in-progress state, then either someone
@@ -352,13 +444,14 @@ SimpleLruWaitIO(SlruCtl ctl, int slotno)
  * Return value is the shared-buffer slot number now holding the page.
  * The buffer's LRU access info is updated.
  *
- * Control lock must be held at entry, and will be held at exit.
+ * The bank lock for pageno must be held at entry, and will be held at exit.
  */
 int
 SimpleLruReadPage(SlruCtl ctl, int pageno, bool write_ok,
 				  TransactionId xid)
 {
 	SlruShared	shared = ctl->shared;
+	LWLockId	banklock = SimpleLruGetBankLock(ctl, pageno);
 
 	/* Outer loop handles restart if we must wait for someone else's I/O */
 	for (;;)
@@ -387,6 +480,7 @@ SimpleLruReadPage(SlruCtl ctl, int pageno, bool write_ok,
 			}
 			/* Otherwise, it's ready to use */
 			SlruRecentlyUsed(shared, slotno);
+			pgstat_count_slru_page_hit(shared->slru_stats_idx);
 			return slotno;
 		}
 
@@ -403,8 +497,8 @@ SimpleLruReadPage(SlruCtl ctl, int pageno, bool write_ok,
 		/* Acquire per-buffer lock (cannot deadlock, see notes at top) */
 		LWLockAcquire(shared->buffer_locks[slotno], LW_EXCLUSIVE);
 
-		/* Release control lock while doing I/O */
-		LWLockRelease(shared->ControlLock);
+		/* Release bank lock while doing I/O */
+		LWLockRelease(banklock);
 
 		/* Do the read */
 		ok = SlruPhysicalReadPage(ctl, pageno, slotno);
@@ -412,8 +506,8 @@ SimpleLruReadPage(SlruCtl ctl, int pageno, bool write_ok,
 		/* Set the LSNs for this newly read-in page to zero */
 		SimpleLruZeroLSNs(ctl, slotno);
 
-		/* Re-acquire control lock and update page state */
-		LWLockAcquire(shared->ControlLock, LW_EXCLUSIVE);
+		/* Re-acquire bank lock and update page state */
+		LWLockAcquire(banklock, LW_EXCLUSIVE);
 
 		Assert(shared->page_number[slotno] == pageno &&
 			   shared->page_status[slotno] == SLRU_PAGE_READ_IN_PROGRESS &&
@@ -428,6 +522,7 @@ SimpleLruReadPage(SlruCtl ctl, int pageno, bool write_ok,
 			SlruReportIOError(ctl, pageno, xid);
 
 		SlruRecentlyUsed(shared, slotno);
+		pgstat_count_slru_page_read(shared->slru_stats_idx);
 		return slotno;
 	}
 }
@@ -443,20 +538,23 @@ SimpleLruReadPage(SlruCtl ctl, int pageno, bool write_ok,
  * Return value is the shared-buffer slot number now holding the page.
  * The buffer's LRU access info is updated.
  *
- * Control lock must NOT be held at entry, but will be held at exit.
- * It is unspecified whether the lock will be shared or exclusive.
+ * The bank lock for pageno must NOT be held at entry, but will be held at
+ * exit.  It is unspecified whether the lock will be shared or exclusive.
  */
 int
 SimpleLruReadPage_ReadOnly(SlruCtl ctl, int pageno, TransactionId xid)
 {
 	SlruShared	shared = ctl->shared;
+	LWLockId	banklock = SimpleLruGetBankLock(ctl, pageno);
+	int			bankstart = SlruPageBank(shared, pageno) * shared->bank_size;
+	int			bankend = bankstart + shared->bank_size;
 	int			slotno;
 
 	/* Try to find the page while holding only shared lock */
-	LWLockAcquire(shared->ControlLock, LW_SHARED);
+	LWLockAcquire(banklock, LW_SHARED);
 
 	/* See if page is already in a buffer */
-	for (slotno = 0; slotno < shared->num_slots; slotno++)
+	for (slotno = bankstart; slotno < bankend; slotno++)
 	{
 		if (shared->page_number[slotno] == pageno &&
 			shared->page_status[slotno] != SLRU_PAGE_EMPTY &&
@@ -464,13 +562,14 @@ SimpleLruReadPage_ReadOnly(SlruCtl ctl, int pageno, TransactionId xid)
 		{
 			/* See comments for SlruRecentlyUsed macro */
 			SlruRecentlyUsed(shared, slotno);
+			pgstat_count_slru_page_hit(shared->slru_stats_idx);
 			return slotno;
 		}
 	}
 
 	/* No luck, so switch to normal exclusive lock and do regular read */
-	LWLockRelease(shared->ControlLock);
-	LWLockAcquire(shared->ControlLock, LW_EXCLUSIVE);
+	LWLockRelease(banklock);
+	LWLockAcquire(banklock, LW_EXCLUSIVE);
 
 	return SimpleLruReadPage(ctl, pageno, true, xid);
 }
@@ -484,12 +583,13 @@ SimpleLruReadPage_ReadOnly(SlruCtl ctl, int pageno, TransactionId xid)
  * the write).	However, we *do* attempt a fresh write even if the page
  * is already being written; this is for checkpoints.
  *
- * Control lock must be held at entry, and will be held at exit.
+ * The slot's bank lock must be held at entry, and will be held at exit.
  */
 static void
 SlruInternalWritePage(SlruCtl ctl, int slotno, SlruFlush fdata)
 {
 	SlruShared	shared = ctl->shared;
+	LWLockId	banklock = SlruSlotLock(shared, slotno);
 	int			pageno = shared->page_number[slotno];
 	bool		ok;
 
@@ -519,8 +619,8 @@ SlruInternalWritePage(SlruCtl ctl, int slotno, SlruFlush fdata)
 	/* Acquire per-buffer lock (cannot deadlock, see notes at top) */
 	LWLockAcquire(shared->buffer_locks[slotno], LW_EXCLUSIVE);
 
-	/* Release control lock while doing I/O */
-	LWLockRelease(shared->ControlLock);
+	/* Release bank lock while doing I/O */
+	LWLockRelease(banklock);
 
 	/* Do the write */
 	ok = SlruPhysicalWritePage(ctl, pageno, slotno, fdata);
@@ -534,8 +634,8 @@ SlruInternalWritePage(SlruCtl ctl, int slotno, SlruFlush fdata)
 			CloseTransientFile(fdata->fd[i]);
 	}
 
-	/* Re-acquire control lock and update page state */
-	LWLockAcquire(shared->ControlLock, LW_EXCLUSIVE);
+	/* Re-acquire bank lock and update page state */
+	LWLockAcquire(banklock, LW_EXCLUSIVE);
 
 	Assert(shared->page_number[slotno] == pageno &&
 		   shared->page_status[slotno] == SLRU_PAGE_WRITE_IN_PROGRESS);
@@ -605,6 +705,9 @@ SimpleLruDoesPhysicalPageExist(SlruCtl ctl, int pageno)
 	result = endpos >= (off_t) (offset + BLCKSZ);
 
 	CloseTransientFile(fd);
+
+	pgstat_count_slru_page_exists(ctl->shared->slru_stats_idx);
+
 	return result;
 }
 
@@ -834,6 +937,8 @@ SlruPhysicalWritePage(SlruCtl ctl, int pageno, int slotno, SlruFlush fdata)
 		return false;
 	}
 
+	pgstat_count_slru_page_written(shared->slru_stats_idx);
+
 	/*
 	 * If not part of Flush, need to fsync now.  We assume this happens
 	 * infrequently enough that it's not a performance issue.
@@ -933,20 +1038,24 @@ SlruReportIOError(SlruCtl ctl, int pageno, TransactionId xid)
  * any slot already holds the target page, and return that slot if so.
  * Thus, the returned slot is *either* a slot already holding the pageno
  * (could be any state except EMPTY), *or* a freeable slot (state EMPTY
- * or CLEAN).
+ * or CLEAN).  Only the slots of pageno's bank are considered.
  *
- * Control lock must be held at entry, and will be held at exit.
+ * The bank lock for pageno must be held at entry, and will be held at exit.
  */
 static int
 SlruSelectLRUPage(SlruCtl ctl, int pageno)
 {
 	SlruShared	shared = ctl->shared;
+	int			bankno = SlruPageBank(shared, pageno);
+	int			bankstart = bankno * shared->bank_size;
+	int			bankend = bankstart + shared->bank_size;
 
 	/* Outer loop handles restart after I/O */
 	for (;;)
 	{
 		int			slotno;
 		int			cur_count;
+		int			latest_page_number;
 		int			bestvalidslot = 0;	/* keep compiler quiet */
 		int			best_valid_delta = -1;
 		int			best_valid_page_number = 0; /* keep compiler quiet */
@@ -955,7 +1064,7 @@ SlruSelectLRUPage(SlruCtl ctl, int pageno)
 		int			best_invalid_page_number = 0;		/* keep compiler quiet */
 
 		/* See if page already has a buffer assigned */
-		for (slotno = 0; slotno < shared->num_slots; slotno++)
+		for (slotno = bankstart; slotno < bankend; slotno++)
 		{
 			if (shared->page_number[slotno] == pageno &&
 				shared->page_status[slotno] != SLRU_PAGE_EMPTY)
@@ -981,16 +1090,20 @@ SlruSelectLRUPage(SlruCtl ctl, int pageno)
 		 * acquire the same lru_count values.  In that case we break ties by
 		 * choosing the furthest-back page.
 		 *
-		 * Notice that this next line forcibly advances cur_lru_count to a
-		 * value that is certainly beyond any value that will be in the
-		 * page_lru_count array after the loop finishes.  This ensures that
-		 * the next execution of SlruRecentlyUsed will mark the page newly
-		 * used, even if it's for a page that has the current counter value.
-		 * That gets us back on the path to having good data when there are
-		 * multiple pages with the same lru_count.
+		 * Notice that this next line forcibly advances the bank's
+		 * cur_lru_count to a value that is certainly beyond any value that
+		 * will be in the bank's page_lru_count entries after the loop
+		 * finishes.  This ensures that the next execution of SlruRecentlyUsed
+		 * will mark the page newly used, even if it's for a page that has the
+		 * current counter value.  That gets us back on the path to having
+		 * good data when there are multiple pages with the same lru_count.
+		 *
+		 * latest_page_number is updated under whichever bank lock covers the
+		 * new page, so it can change under us; fetch it just once.
 		 */
-		cur_count = (shared->cur_lru_count)++;
-		for (slotno = 0; slotno < shared->num_slots; slotno++)
+		cur_count = (shared->bank_cur_lru_count[bankno])++;
+		latest_page_number = shared->latest_page_number;
+		for (slotno = bankstart; slotno < bankend; slotno++)
 		{
 			int			this_delta;
 			int			this_page_number;
@@ -1011,7 +1124,7 @@ SlruSelectLRUPage(SlruCtl ctl, int pageno)
 				this_delta = 0;
 			}
 			this_page_number = shared->page_number[slotno];
-			if (this_page_number == shared->latest_page_number)
+			if (this_page_number == latest_page_number)
 				continue;
 			if (shared->page_status[slotno] == SLRU_PAGE_VALID)
 			{
@@ -1083,16 +1196,30 @@ SimpleLruFlush(SlruCtl ctl, bool checkpoint)
 	int			pageno = 0;
 	int			i;
 	bool		ok;
+	LWLockId	curlock = shared->bank_locks[0];
+	bool		locked = false;
+
+	pgstat_count_slru_flush(shared->slru_stats_idx);
 
 	/*
-	 * Find and write dirty pages
+	 * Find and write dirty pages.  Unbanked SLRUs have the same lock for all
+	 * banks, so only switch locks when moving to a bank with a different one.
 	 */
 	fdata.num_files = 0;
 
-	LWLockAcquire(shared->ControlLock, LW_EXCLUSIVE);
-
 	for (slotno = 0; slotno < shared->num_slots; slotno++)
 	{
+		LWLockId	banklock = SlruSlotLock(shared, slotno);
+
+		if (!locked || banklock != curlock)
+		{
+			if (locked)
+				LWLockRelease(curlock);
+			LWLockAcquire(banklock, LW_EXCLUSIVE);
+			curlock = banklock;
+			locked = true;
+		}
+
 		SlruInternalWritePage(ctl, slotno, &fdata);
 
 		/*
@@ -1106,7 +1233,8 @@ SimpleLruFlush(SlruCtl ctl, bool checkpoint)
 				!shared->page_dirty[slotno]));
 	}
 
-	LWLockRelease(shared->ControlLock);
+	if (locked)
+		LWLockRelease(curlock);
 
 	/*
 	 * Now fsync and close any files that were open
@@ -1141,6 +1269,7 @@ void
 SimpleLruTruncate(SlruCtl ctl, int cutoffPage)
 {
 	SlruShared	shared = ctl->shared;
+	int			bankno;
 	int			slotno;
 
 	/*
@@ -1148,64 +1277,72 @@ SimpleLruTruncate(SlruCtl ctl, int cutoffPage)
 	 */
 	cutoffPage -= cutoffPage % SLRU_PAGES_PER_SEGMENT;
 
-	/*
-	 * Scan shared memory and remove any pages preceding the cutoff page, to
-	 * ensure we won't rewrite them later.  (Since this is normally called in
-	 * or just after a checkpoint, any dirty pages should have been flushed
-	 * already ... we're just being extra careful here.)
-	 */
-	LWLockAcquire(shared->ControlLock, LW_EXCLUSIVE);
-
-restart:;
+	pgstat_count_slru_truncate(shared->slru_stats_idx);
 
 	/*
-	 * While we are holding the lock, make an important safety check: the
-	 * planned cutoff point must be <= the current endpoint page. Otherwise we
-	 * have already wrapped around, and proceeding with the truncation would
-	 * risk removing the current segment.
+	 * Make an important safety check: the planned cutoff point must be <= the
+	 * current endpoint page.  Otherwise we have already wrapped around, and
+	 * proceeding with the truncation would risk removing the current
+	 * segment.
 	 */
 	if (ctl->PagePrecedes(shared->latest_page_number, cutoffPage))
 	{
-		LWLockRelease(shared->ControlLock);
 		ereport(LOG,
 		  (errmsg("could not truncate directory \"%s\": apparent wraparound",
 				  ctl->Dir)));
 		return;
 	}
 
-	for (slotno = 0; slotno < shared->num_slots; slotno++)
+	/*
+	 * Scan shared memory and remove any pages preceding the cutoff page, to
+	 * ensure we won't rewrite them later.  (Since this is normally called in
+	 * or just after a checkpoint, any dirty pages should have been flushed
+	 * already ... we're just being extra careful here.)  Each bank is
+	 * scanned under its own lock.
+	 */
+	for (bankno = 0; bankno < shared->num_banks; bankno++)
 	{
-		if (shared->page_status[slotno] == SLRU_PAGE_EMPTY)
-			continue;
-		if (!ctl->PagePrecedes(shared->page_number[slotno], cutoffPage))
-			continue;
+		int			bankstart = bankno * shared->bank_size;
+		int			bankend = bankstart + shared->bank_size;
+		LWLockId	banklock = shared->bank_locks[bankno];
 
-		/*
-		 * If page is clean, just change state to EMPTY (expected case).
-		 */
-		if (shared->page_status[slotno] == SLRU_PAGE_VALID &&
-			!shared->page_dirty[slotno])
+		LWLockAcquire(banklock, LW_EXCLUSIVE);
+
+restart:
+		for (slotno = bankstart; slotno < bankend; slotno++)
 		{
-			shared->page_status[slotno] = SLRU_PAGE_EMPTY;
-			continue;
+			if (shared->page_status[slotno] == SLRU_PAGE_EMPTY)
+				continue;
+			if (!ctl->PagePrecedes(shared->page_number[slotno], cutoffPage))
+				continue;
+
+			/*
+			 * If page is clean, just change state to EMPTY (expected case).
+			 */
+			if (shared->page_status[slotno] == SLRU_PAGE_VALID &&
+				!shared->page_dirty[slotno])
+			{
+				shared->page_status[slotno] = SLRU_PAGE_EMPTY;
+				continue;
+			}
+
+			/*
+			 * Hmm, we have (or may have) I/O operations acting on the page,
+			 * so we've got to wait for them to finish and then start again.
+			 * This is the same logic as in SlruSelectLRUPage.  (XXX if page
+			 * is dirty, wouldn't it be OK to just discard it without writing
+			 * it?  For now, keep the logic the same as it was.)
+			 */
+			if (shared->page_status[slotno] == SLRU_PAGE_VALID)
+				SlruInternalWritePage(ctl, slotno, NULL);
+			else
+				SimpleLruWaitIO(ctl, slotno);
+			goto restart;
 		}
 
-		/*
-		 * Hmm, we have (or may have) I/O operations acting on the page, so
-		 * we've got to wait for them to finish and then start again. This is
-		 * the same logic as in SlruSelectLRUPage.	(XXX if page is dirty,
-		 * wouldn't it be OK to just discard it without writing it?  For now,
-		 * keep the logic the same as it was.)
-		 */
-		if (shared->page_status[slotno] == SLRU_PAGE_VALID)
-			SlruInternalWritePage(ctl, slotno, NULL);
-		else
-			SimpleLruWaitIO(ctl, slotno);
-		goto restart;
+		LWLockRelease(banklock);
 	}
 
-	LWLockRelease(shared->ControlLock);
-
 	/* Now we can remove the old segment(s) */
 	(void) SlruScanDirectory(ctl, SlruScanDirCbDeleteCutoff, &cutoffPage);
 }
@@ -31,6 +31,7 @@
 #include "access/slru.h"
 #include "access/subtrans.h"
 #include "access/transam.h"
+#include "miscadmin.h"
 #include "pg_trace.h"
 #include "utils/snapmgr.h"
 
@@ -54,6 +55,9 @@
 #define TransactionIdToEntry(xid) ((xid) % (TransactionId) SUBTRANS_XACTS_PER_PAGE)
 
 
+/* GUC variable */
+int			subtrans_buffers = 0;
+
 /*
  * Link to shared-memory data structures for SUBTRANS control
  */
@@ -76,12 +80,13 @@ SubTransSetParent(TransactionId xid, TransactionId parent, bool overwriteOK)
 {
 	int			pageno = TransactionIdToPage(xid);
 	int			entryno = TransactionIdToEntry(xid);
+	LWLockId	banklock = SimpleLruGetBankLock(SubTransCtl, pageno);
 	int			slotno;
 	TransactionId *ptr;
 
 	Assert(TransactionIdIsValid(parent));
 
-	LWLockAcquire(SubtransControlLock, LW_EXCLUSIVE);
+	LWLockAcquire(banklock, LW_EXCLUSIVE);
 
 	slotno = SimpleLruReadPage(SubTransCtl, pageno, true, xid);
 	ptr = (TransactionId *) SubTransCtl->shared->page_buffer[slotno];
@@ -95,7 +100,7 @@ SubTransSetParent(TransactionId xid, TransactionId parent, bool overwriteOK)
 
 	SubTransCtl->shared->page_dirty[slotno] = true;
 
-	LWLockRelease(SubtransControlLock);
+	LWLockRelease(banklock);
 }
 
 /*
@@ -125,7 +130,7 @@ SubTransGetParent(TransactionId xid)
 
 	parent = *ptr;
 
-	LWLockRelease(SubtransControlLock);
+	LWLockRelease(SimpleLruGetBankLock(SubTransCtl, pageno));
 
 	return parent;
 }
@@ -165,21 +170,36 @@ SubTransGetTopmostTransaction(TransactionId xid)
 }
 
 
+/*
+ * Number of shared SUBTRANS buffers.
+ *
+ * This is subtrans_buffers if set, otherwise sized by shared_buffers the
+ * same way as CLOG (see CLOGShmemBuffers).
+ */
+Size
+SUBTRANSShmemBuffers(void)
+{
+	if (subtrans_buffers > 0)
+		return subtrans_buffers;
+	return Min(1024, Max(SLRU_BANK_SIZE, NBuffers / 512)) &
+		~(SLRU_BANK_SIZE - 1);
+}
+
 /*
  * Initialization of shared memory for SUBTRANS
  */
 Size
 SUBTRANSShmemSize(void)
 {
-	return SimpleLruShmemSize(NUM_SUBTRANS_BUFFERS, 0);
+	return SimpleLruShmemSize(SUBTRANSShmemBuffers(), 0);
 }
 
 void
 SUBTRANSShmemInit(void)
 {
 	SubTransCtl->PagePrecedes = SubTransPagePrecedes;
-	SimpleLruInit(SubTransCtl, "SUBTRANS Ctl", NUM_SUBTRANS_BUFFERS, 0,
-				  SubtransControlLock, "pg_subtrans");
+	SimpleLruInitBanked(SubTransCtl, "SUBTRANS Ctl", SUBTRANSShmemBuffers(), 0,
+						"pg_subtrans");
 	/* Override default assumption that writes should be fsync'd */
 	SubTransCtl->do_fsync = false;
 }
@@ -197,9 +217,10 @@ SUBTRANSShmemInit(void)
 void
 BootStrapSUBTRANS(void)
 {
+	LWLockId	banklock = SimpleLruGetBankLock(SubTransCtl, 0);
 	int			slotno;
 
-	LWLockAcquire(SubtransControlLock, LW_EXCLUSIVE);
+	LWLockAcquire(banklock, LW_EXCLUSIVE);
 
 	/* Create and zero the first page of the subtrans log */
 	slotno = ZeroSUBTRANSPage(0);
@@ -208,7 +229,7 @@ BootStrapSUBTRANS(void)
 	SimpleLruWritePage(SubTransCtl, slotno);
 	Assert(!SubTransCtl->shared->page_dirty[slotno]);
 
-	LWLockRelease(SubtransControlLock);
+	LWLockRelease(banklock);
 }
 
 /*
@@ -217,7 +238,7 @@ BootStrapSUBTRANS(void)
  * The page is not actually written, just set up in shared memory.
  * The slot number of the new page is returned.
  *
- * Control lock must be held at entry, and will be held at exit.
+ * The bank lock for pageno must be held at entry, and will be held at exit.
  */
 static int
 ZeroSUBTRANSPage(int pageno)
@@ -237,6 +258,7 @@ StartupSUBTRANS(TransactionId oldestActiveXID)
 {
 	int			startPage;
 	int			endPage;
+	LWLockId	banklock;
 
 	/*
 	 * Since we don't expect pg_subtrans to be valid across crashes, we
@@ -244,19 +266,20 @@ StartupSUBTRANS(TransactionId oldestActiveXID)
 	 * Whenever we advance into a new page, ExtendSUBTRANS will likewise zero
 	 * the new page without regard to whatever was previously on disk.
 	 */
-	LWLockAcquire(SubtransControlLock, LW_EXCLUSIVE);
-
 	startPage = TransactionIdToPage(oldestActiveXID);
 	endPage = TransactionIdToPage(ShmemVariableCache->nextXid);
 
-	while (startPage != endPage)
+	for (;;)
 	{
+		banklock = SimpleLruGetBankLock(SubTransCtl, startPage);
+		LWLockAcquire(banklock, LW_EXCLUSIVE);
 		(void) ZeroSUBTRANSPage(startPage);
+		LWLockRelease(banklock);
+
+		if (startPage == endPage)
+			break;
 		startPage++;
 	}
-	(void) ZeroSUBTRANSPage(startPage);
-
-	LWLockRelease(SubtransControlLock);
 }
 
 /*
@@ -307,6 +330,7 @@ void
 ExtendSUBTRANS(TransactionId newestXact)
 {
 	int			pageno;
+	LWLockId	banklock;
 
 	/*
 	 * No work except at first XID of a page.  But beware: just after
@@ -317,13 +341,14 @@ ExtendSUBTRANS(TransactionId newestXact)
 		return;
 
 	pageno = TransactionIdToPage(newestXact);
+	banklock = SimpleLruGetBankLock(SubTransCtl, pageno);
 
-	LWLockAcquire(SubtransControlLock, LW_EXCLUSIVE);
+	LWLockAcquire(banklock, LW_EXCLUSIVE);
 
 	/* Zero the page */
 	ZeroSUBTRANSPage(pageno);
 
-	LWLockRelease(SubtransControlLock);
+	LWLockRelease(banklock);
 }
 
 
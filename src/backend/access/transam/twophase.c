@@ -245,6 +245,8 @@ MarkAsPreparing(TransactionId xid, const char *gid,
 	GlobalTransaction gxact;
 	PGPROC	   *proc;
 	PGXACT	   *pgxact;
+	uint64	   *fpLockBits;
+	Oid		   *fpRelId;
 	int			i;
 
 	if (strlen(gid) >= GIDSIZE)
@@ -309,8 +311,16 @@ MarkAsPreparing(TransactionId xid, const char *gid,
 	proc = &ProcGlobal->allProcs[gxact->pgprocno];
 	pgxact = &ProcGlobal->allPgXact[gxact->pgprocno];
 
-	/* Initialize the PGPROC entry */
+	/*
+	 * Initialize the PGPROC entry.  The fast-path lock arrays were set up by
+	 * InitProcGlobal and must survive; they are never used by a prepared
+	 * transaction, so they are already empty.
+	 */
+	fpLockBits = proc->fpLockBits;
+	fpRelId = proc->fpRelId;
 	MemSet(proc, 0, sizeof(PGPROC));
+	proc->fpLockBits = fpLockBits;
+	proc->fpRelId = fpRelId;
 	proc->pgprocno = gxact->pgprocno;
 	SHMQueueElemInit(&(proc->links));
 	proc->waitStatus = STATUS_OK;
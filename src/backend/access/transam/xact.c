@@ -21,6 +21,7 @@
 #include <unistd.h>
 
 #include "access/multixact.h"
+#include "access/parallel.h"
 #include "access/subtrans.h"
 #include "access/transam.h"
 #include "access/twophase.h"
@@ -1866,6 +1867,9 @@ CommitTransaction(void)
 	 */
 	PreCommit_on_commit_actions();
 
+	/* shut down any parallel workers still attached to us */
+	AtEOXact_Parallel(true);
+
 	/* close large objects before lower-level cleanup */
 	AtEOXact_LargeObject(true);
 
@@ -2071,6 +2075,9 @@ PrepareTransaction(void)
 	 */
 	PreCommit_on_commit_actions();
 
+	/* shut down any parallel workers still attached to us */
+	AtEOXact_Parallel(true);
+
 	/* close large objects before lower-level cleanup */
 	AtEOXact_LargeObject(true);
 
@@ -2343,6 +2350,7 @@ AbortTransaction(void)
 	 */
 	AfterTriggerEndXact(false); /* 'false' means it's abort */
 	AtAbort_Portals();
+	AtEOXact_Parallel(false);
 	AtEOXact_LargeObject(false);
 	AtAbort_Notify();
 	AtEOXact_RelationMap(false);
@@ -4125,6 +4133,8 @@ CommitSubTransaction(void)
 	AtSubCommit_Portals(s->subTransactionId,
 						s->parent->subTransactionId,
 						s->parent->curTransactionOwner);
+	AtEOSubXact_Parallel(true, s->subTransactionId,
+						 s->parent->subTransactionId);
 	AtEOSubXact_LargeObject(true, s->subTransactionId,
 							s->parent->subTransactionId);
 	AtSubCommit_Notify();
@@ -4266,6 +4276,8 @@ AbortSubTransaction(void)
 		AtSubAbort_Portals(s->subTransactionId,
 						   s->parent->subTransactionId,
 						   s->parent->curTransactionOwner);
+		AtEOSubXact_Parallel(false, s->subTransactionId,
+							 s->parent->subTransactionId);
 		AtEOSubXact_LargeObject(false, s->subTransactionId,
 								s->parent->subTransactionId);
 		AtSubAbort_Notify();
@@ -0,0 +1,872 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogparallel.c
+ *		Parallel WAL redo.
+ *
+ * Normally the startup process applies every WAL record itself, one at a
+ * time, which on a busy primary can leave a standby unable to keep up.  If
+ * parallel_redo_workers is set, the startup process instead hands records
+ * that modify a single data block over to a set of redo worker processes,
+ * which apply them concurrently.  Records are assigned to workers by
+ * hashing the block they modify, so all the changes to one block are
+ * applied by the same worker, in WAL order.  That is all the ordering a
+ * data page needs; records that touch blocks in different workers, or that
+ * affect more than one block's worth of state -- transaction commits,
+ * checkpoints, relation creation and dropping, and everything we don't
+ * know to be safe -- act as barriers: the startup process waits for the
+ * workers to finish all the records dispatched before, and then applies the
+ * record itself, just as in serial replay.  Since the effects of commits
+ * become visible to hot standby queries only when the commit record is
+ * replayed, such queries can't see any difference.
+ *
+ * The records that can be dispatched are the most common ones: heap
+ * insertions, updates, deletions and row locks, and insertions into btree
+ * leaf pages.  The redo routines for these only look at the record and the
+ * blocks it names (plus the visibility map and FSM, which use buffer locks
+ * and cope with concurrent redo of different heap pages), so they can run
+ * in any process.
+ *
+ * A btree leaf insertion is the one dispatched record that depends on
+ * another block: the heap tuple its index tuple points to was inserted by
+ * an earlier record, which may have gone to a different worker.  A hot
+ * standby index scan that found the index tuple before that record was
+ * applied could try to read a heap block that doesn't exist yet, which
+ * serial replay never allows.  So before dispatching a leaf insertion, the
+ * startup process waits for the workers to apply everything dispatched
+ * earlier; the insertion itself still runs concurrently with the records
+ * that follow it.
+ *
+ * lastReplayedEndRecPtr, which determines for example what the standby
+ * reports as replayed to the primary, may only advance past a record once
+ * it and all records before it have been applied.  Each worker tracks the
+ * end of the last record it applied, and the replay position is the
+ * smallest of those positions among workers that still have work queued,
+ * or the end of the last record dispatched if none have.
+ *
+ * Workers are only used once the standby has reached a consistent state,
+ * so that they never have to deal with references to pages that don't
+ * exist yet, which crash recovery tolerates only until then.  They are
+ * started as dynamic background workers, so they count against
+ * max_worker_processes; if they can't be started, replay continues
+ * serially.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *		src/backend/access/transam/xlogparallel.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <signal.h>
+
+#include "access/heapam_xlog.h"
+#include "access/nbtree.h"
+#include "access/rmgr.h"
+#include "access/xact.h"
+#include "access/xlog_internal.h"
+#include "access/xlogparallel.h"
+#include "lib/stringinfo.h"
+#include "miscadmin.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/startup.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/proc.h"
+#include "storage/shm_mq.h"
+#include "storage/shmem.h"
+#include "storage/smgr.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+
+/* Size of each worker's record queue. */
+#define PARALLEL_REDO_QUEUE_SIZE	(256 * 1024)
+
+/* Space reserved for an error message reported by a worker. */
+#define PARALLEL_REDO_ERROR_SIZE	1024
+
+/* GUC variable */
+int			parallel_redo_workers = 0;
+
+/*
+ * Per-worker state.  The startup process increments ndispatched before
+ * sending a record, and the worker increments napplied after applying it,
+ * so the worker has work queued whenever napplied < ndispatched.
+ * appliedUpTo is the end of the last record the worker applied, or, while
+ * it has work queued, at least not beyond the start of the first record it
+ * hasn't applied yet.  All fields are protected by mutex.
+ */
+typedef struct ParallelRedoWorkerSlot
+{
+	slock_t		mutex;
+	uint64		ndispatched;
+	uint64		napplied;
+	XLogRecPtr	appliedUpTo;
+	bool		exited;
+	bool		has_error;
+	int			sqlerrcode;
+	char		errmsg[PARALLEL_REDO_ERROR_SIZE];
+} ParallelRedoWorkerSlot;
+
+/*
+ * Shared control structure.  dispatchedUpTo is the end of the last record
+ * the startup process either dispatched or applied itself; it's protected
+ * by mutex, along with startupWaiting.
+ */
+typedef struct ParallelRedoControl
+{
+	slock_t		mutex;
+	XLogRecPtr	dispatchedUpTo;
+	TimeLineID	tli;
+	bool		startupWaiting;
+	PGPROC	   *startupProc;
+	int			nworkers;
+	char	   *queues;
+	ParallelRedoWorkerSlot slots[FLEXIBLE_ARRAY_MEMBER];
+} ParallelRedoControl;
+
+/*
+ * Header of each message sent to a worker, followed by the record itself.
+ * generation is advanced whenever a record that may drop or truncate
+ * relation files is replayed, telling workers to close their files.
+ */
+typedef struct ParallelRedoMessage
+{
+	XLogRecPtr	lsn;			/* end of the record */
+	uint32		generation;
+} ParallelRedoMessage;
+
+#define PARALLEL_REDO_HEADER_SIZE	MAXALIGN(sizeof(ParallelRedoMessage))
+
+static ParallelRedoControl *ParallelRedoCtl = NULL;
+
+#define ParallelRedoQueueAddress(i) \
+	((shm_mq *) (ParallelRedoCtl->queues + (Size) (i) * PARALLEL_REDO_QUEUE_SIZE))
+
+/* Startup process state */
+static bool redo_workers_tried = false;
+static int	redo_nworkers = 0;
+static BackgroundWorkerHandle **redo_handles = NULL;
+static shm_mq_handle **redo_queues = NULL;
+static uint32 redo_generation = 0;
+static XLogRecPtr lastEndRecPtr = InvalidXLogRecPtr;
+static char *dispatch_buf = NULL;
+static Size dispatch_buflen = 0;
+
+/* Worker process state */
+static int	MyRedoWorker = -1;
+
+static bool ParallelRedoStartWorkers(void);
+static void ParallelRedoWaitForWorkers(void);
+static void ParallelRedoCheckWorker(int i, bool detached);
+static void ParallelRedoStartupShutdown(int code, Datum arg);
+static int	ParallelRedoWorkerFor(XLogRecord *record);
+static int	ParallelRedoBlockWorker(RelFileNode rnode, BlockNumber blkno);
+static XLogRecPtr ParallelRedoComputeReplayed(void);
+static void ParallelRedoWorkerShutdown(int code, Datum arg);
+static void ParallelRedoWorkerReportError(void);
+static void parallel_redo_error_callback(void *arg);
+
+
+/*
+ * Report shared-memory space needed by ParallelRedoShmemInit
+ */
+Size
+ParallelRedoShmemSize(void)
+{
+	Size		size;
+
+	size = offsetof(ParallelRedoControl, slots);
+	size = add_size(size, mul_size(parallel_redo_workers,
+								   sizeof(ParallelRedoWorkerSlot)));
+	size = MAXALIGN(size);
+	size = add_size(size, mul_size(parallel_redo_workers,
+								   PARALLEL_REDO_QUEUE_SIZE));
+
+	return size;
+}
+
+/*
+ * Allocate and initialize parallel redo related shared memory
+ */
+void
+ParallelRedoShmemInit(void)
+{
+	bool		found;
+
+	ParallelRedoCtl = (ParallelRedoControl *)
+		ShmemInitStruct("Parallel Redo Data", ParallelRedoShmemSize(), &found);
+
+	if (!found)
+	{
+		int			i;
+
+		SpinLockInit(&ParallelRedoCtl->mutex);
+		ParallelRedoCtl->dispatchedUpTo = InvalidXLogRecPtr;
+		ParallelRedoCtl->tli = 0;
+		ParallelRedoCtl->startupWaiting = false;
+		ParallelRedoCtl->startupProc = NULL;
+		ParallelRedoCtl->nworkers = 0;
+		ParallelRedoCtl->queues = (char *) ParallelRedoCtl +
+			MAXALIGN(offsetof(ParallelRedoControl, slots) +
+					 parallel_redo_workers * sizeof(ParallelRedoWorkerSlot));
+
+		for (i = 0; i < parallel_redo_workers; i++)
+		{
+			ParallelRedoWorkerSlot *slot = &ParallelRedoCtl->slots[i];
+
+			SpinLockInit(&slot->mutex);
+			slot->ndispatched = 0;
+			slot->napplied = 0;
+			slot->appliedUpTo = InvalidXLogRecPtr;
+			slot->exited = false;
+			slot->has_error = false;
+		}
+	}
+}
+
+/*
+ * Called by the startup process for each record, before replaying it.
+ *
+ * If the record was handed over to a redo worker, returns true; the caller
+ * must not replay it.  Otherwise all records dispatched earlier have been
+ * applied by the time we return false, and the caller must replay the
+ * record itself.
+ */
+bool
+ParallelRedoDispatch(XLogRecPtr EndRecPtr, TimeLineID tli, XLogRecord *record)
+{
+	volatile ParallelRedoWorkerSlot *slot;
+	ParallelRedoMessage *msg;
+	XLogRecPtr	prevEndRecPtr = lastEndRecPtr;
+	Size		len;
+	int			i;
+
+	lastEndRecPtr = EndRecPtr;
+
+	if (redo_nworkers == 0)
+	{
+		if (redo_workers_tried || parallel_redo_workers <= 0 ||
+			!reachedConsistency)
+			return false;
+		redo_workers_tried = true;
+		if (!ParallelRedoStartWorkers())
+			return false;
+	}
+
+	i = ParallelRedoWorkerFor(record);
+	if (i < 0)
+	{
+		uint8		info = record->xl_info & ~XLR_INFO_MASK;
+
+		ParallelRedoWaitForWorkers();
+
+		/* The record might switch timelines; workers are idle now */
+		SpinLockAcquire(&ParallelRedoCtl->mutex);
+		ParallelRedoCtl->tli = tli;
+		SpinLockRelease(&ParallelRedoCtl->mutex);
+
+		/* Make workers forget about files that this record might remove */
+		if (record->xl_rmid == RM_SMGR_ID ||
+			record->xl_rmid == RM_DBASE_ID ||
+			record->xl_rmid == RM_TBLSPC_ID ||
+			(record->xl_rmid == RM_XACT_ID &&
+			 info != XLOG_XACT_COMMIT_COMPACT &&
+			 info != XLOG_XACT_ASSIGNMENT))
+			redo_generation++;
+
+		return false;
+	}
+
+	/* The heap tuple a btree leaf insertion points to must be in place */
+	if (record->xl_rmid == RM_BTREE_ID)
+		ParallelRedoWaitForWorkers();
+
+	/* Build the message: header, then the whole record */
+	len = PARALLEL_REDO_HEADER_SIZE + record->xl_tot_len;
+	if (len > dispatch_buflen)
+	{
+		Size		newlen = Max(dispatch_buflen, BLCKSZ);
+
+		while (newlen < len)
+			newlen *= 2;
+		if (dispatch_buf != NULL)
+			pfree(dispatch_buf);
+		dispatch_buf = MemoryContextAlloc(TopMemoryContext, newlen);
+		dispatch_buflen = newlen;
+	}
+	msg = (ParallelRedoMessage *) dispatch_buf;
+	msg->lsn = EndRecPtr;
+	msg->generation = redo_generation;
+	memcpy(dispatch_buf + PARALLEL_REDO_HEADER_SIZE, record,
+		   record->xl_tot_len);
+
+	slot = &ParallelRedoCtl->slots[i];
+	SpinLockAcquire(&slot->mutex);
+	if (slot->napplied == slot->ndispatched)
+		slot->appliedUpTo = prevEndRecPtr;
+	slot->ndispatched++;
+	SpinLockRelease(&slot->mutex);
+
+	if (shm_mq_send(redo_queues[i], len, dispatch_buf) != SHM_MQ_SUCCESS)
+		ParallelRedoCheckWorker(i, true);
+
+	return true;
+}
+
+/*
+ * Called by the startup process after each record has been dispatched or
+ * replayed.  Returns the position up to which all WAL has been applied.
+ */
+XLogRecPtr
+ParallelRedoReplayedUpTo(XLogRecPtr EndRecPtr)
+{
+	volatile ParallelRedoControl *ctl = ParallelRedoCtl;
+
+	if (redo_nworkers == 0)
+		return EndRecPtr;
+
+	SpinLockAcquire(&ctl->mutex);
+	ctl->dispatchedUpTo = EndRecPtr;
+	SpinLockRelease(&ctl->mutex);
+
+	return ParallelRedoComputeReplayed();
+}
+
+/*
+ * Called by the startup process at the end of redo: wait for the workers
+ * to apply everything dispatched to them, and tell them to exit.
+ */
+void
+ParallelRedoFinish(void)
+{
+	if (redo_nworkers == 0)
+		return;
+
+	ParallelRedoWaitForWorkers();
+	ParallelRedoStartupShutdown(0, (Datum) 0);
+
+	XLogAdvanceReplayedUpTo(lastEndRecPtr, ThisTimeLineID);
+}
+
+/*
+ * Launch the redo workers, and wait for them to attach to their queues.
+ *
+ * Returns false if any of them couldn't be started, in which case replay
+ * proceeds serially.
+ */
+static bool
+ParallelRedoStartWorkers(void)
+{
+	volatile ParallelRedoControl *ctl = ParallelRedoCtl;
+	BackgroundWorker worker;
+	MemoryContext oldcontext;
+	int			nstarted = 0;
+	int			i;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	redo_handles = palloc0(sizeof(BackgroundWorkerHandle *) *
+						   parallel_redo_workers);
+	redo_queues = palloc0(sizeof(shm_mq_handle *) * parallel_redo_workers);
+
+	SpinLockAcquire(&ctl->mutex);
+	ctl->dispatchedUpTo = lastEndRecPtr;
+	ctl->tli = ThisTimeLineID;
+	ctl->startupWaiting = false;
+	ctl->startupProc = MyProc;
+	SpinLockRelease(&ctl->mutex);
+
+	memset(&worker, 0, sizeof(worker));
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS;
+	worker.bgw_start_time = BgWorkerStart_PostmasterStart;
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	worker.bgw_main = ParallelRedoWorkerMain;
+	worker.bgw_notify_pid = 0;
+
+	for (i = 0; i < parallel_redo_workers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(ParallelRedoQueueAddress(i),
+						   PARALLEL_REDO_QUEUE_SIZE);
+		shm_mq_set_sender(mq, MyProc);
+
+		snprintf(worker.bgw_name, BGW_MAXLEN, "redo worker %d", i);
+		worker.bgw_main_arg = Int32GetDatum(i);
+		if (!RegisterDynamicBackgroundWorker(&worker, &redo_handles[i]))
+			break;
+		redo_queues[i] = shm_mq_attach(mq, redo_handles[i]);
+		nstarted++;
+	}
+	MemoryContextSwitchTo(oldcontext);
+
+	redo_nworkers = nstarted;
+	SpinLockAcquire(&ctl->mutex);
+	ctl->nworkers = nstarted;
+	SpinLockRelease(&ctl->mutex);
+	on_shmem_exit(ParallelRedoStartupShutdown, (Datum) 0);
+
+	/*
+	 * Wait until every worker has attached, so that we don't block sending
+	 * to a queue that nobody will ever read.
+	 */
+	for (i = 0; i < nstarted; i++)
+	{
+		for (;;)
+		{
+			BgwHandleStatus status;
+			pid_t		pid;
+
+			if (shm_mq_get_receiver(ParallelRedoQueueAddress(i)) != NULL)
+				break;
+			status = GetBackgroundWorkerPid(redo_handles[i], &pid);
+			if (status == BGWH_STOPPED || status == BGWH_POSTMASTER_DIED)
+			{
+				nstarted = 0;
+				break;
+			}
+
+			WaitLatch(&MyProc->procLatch,
+					  WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+					  100L);
+			ResetLatch(&MyProc->procLatch);
+			HandleStartupProcInterrupts();
+		}
+		if (nstarted == 0)
+			break;
+	}
+
+	if (nstarted < parallel_redo_workers)
+	{
+		ParallelRedoStartupShutdown(0, (Datum) 0);
+		ereport(LOG,
+				(errmsg("could not start parallel redo workers, continuing serial replay"),
+				 errhint("You might need to increase max_worker_processes.")));
+		return false;
+	}
+
+	ereport(LOG,
+			(errmsg("parallel redo started with %d workers", redo_nworkers)));
+
+	return true;
+}
+
+/*
+ * Wait until the workers have applied all records dispatched to them.
+ */
+static void
+ParallelRedoWaitForWorkers(void)
+{
+	volatile ParallelRedoControl *ctl = ParallelRedoCtl;
+
+	for (;;)
+	{
+		bool		busy = false;
+		int			i;
+
+		SpinLockAcquire(&ctl->mutex);
+		ctl->startupWaiting = true;
+		SpinLockRelease(&ctl->mutex);
+
+		for (i = 0; i < redo_nworkers; i++)
+		{
+			volatile ParallelRedoWorkerSlot *slot = &ctl->slots[i];
+			bool		idle;
+
+			SpinLockAcquire(&slot->mutex);
+			idle = (slot->napplied == slot->ndispatched);
+			SpinLockRelease(&slot->mutex);
+
+			if (!idle)
+			{
+				ParallelRedoCheckWorker(i, false);
+				busy = true;
+			}
+		}
+
+		if (!busy)
+			break;
+
+		WaitLatch(&MyProc->procLatch,
+				  WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+				  1000L);
+		ResetLatch(&MyProc->procLatch);
+		HandleStartupProcInterrupts();
+	}
+
+	SpinLockAcquire(&ctl->mutex);
+	ctl->startupWaiting = false;
+	SpinLockRelease(&ctl->mutex);
+}
+
+/*
+ * Throw an error if a worker has exited before applying everything
+ * dispatched to it.  detached means we already know that it has.
+ */
+static void
+ParallelRedoCheckWorker(int i, bool detached)
+{
+	volatile ParallelRedoWorkerSlot *slot = &ParallelRedoCtl->slots[i];
+	pid_t		pid;
+	bool		exited;
+
+	SpinLockAcquire(&slot->mutex);
+	exited = slot->exited;
+	if (slot->has_error)
+	{
+		char		errmsg[PARALLEL_REDO_ERROR_SIZE];
+		int			sqlerrcode = slot->sqlerrcode;
+
+		strlcpy(errmsg, (char *) slot->errmsg, PARALLEL_REDO_ERROR_SIZE);
+		SpinLockRelease(&slot->mutex);
+		ereport(ERROR,
+				(errcode(sqlerrcode),
+				 errmsg_internal("%s", errmsg),
+				 errcontext("redo worker %d", i)));
+	}
+	SpinLockRelease(&slot->mutex);
+
+	if (detached || exited ||
+		GetBackgroundWorkerPid(redo_handles[i], &pid) == BGWH_STOPPED)
+		ereport(ERROR,
+				(errmsg("redo worker %d exited unexpectedly", i)));
+}
+
+/*
+ * on_shmem_exit callback for the startup process: detach from the queues,
+ * so that the workers exit.
+ */
+static void
+ParallelRedoStartupShutdown(int code, Datum arg)
+{
+	volatile ParallelRedoControl *ctl = ParallelRedoCtl;
+	int			i;
+
+	for (i = 0; i < redo_nworkers; i++)
+		shm_mq_detach(ParallelRedoQueueAddress(i));
+	redo_nworkers = 0;
+
+	SpinLockAcquire(&ctl->mutex);
+	ctl->nworkers = 0;
+	SpinLockRelease(&ctl->mutex);
+}
+
+/*
+ * Choose the worker that should apply a record, or return -1 if the record
+ * must be applied by the startup process.
+ */
+static int
+ParallelRedoWorkerFor(XLogRecord *record)
+{
+	uint8		info = record->xl_info & ~XLR_INFO_MASK;
+	char	   *data = XLogRecGetData(record);
+
+	switch (record->xl_rmid)
+	{
+		case RM_HEAP_ID:
+			switch (info & XLOG_HEAP_OPMASK)
+			{
+				case XLOG_HEAP_INSERT:
+				case XLOG_HEAP_DELETE:
+				case XLOG_HEAP_LOCK:
+					{
+						/* these all start with an xl_heaptid */
+						xl_heaptid *target = (xl_heaptid *) data;
+
+						return ParallelRedoBlockWorker(target->node,
+									   ItemPointerGetBlockNumber(&target->tid));
+					}
+				case XLOG_HEAP_UPDATE:
+				case XLOG_HEAP_HOT_UPDATE:
+					{
+						xl_heap_update *xlrec = (xl_heap_update *) data;
+						int			oldworker;
+						int			newworker;
+
+						oldworker = ParallelRedoBlockWorker(xlrec->target.node,
+								ItemPointerGetBlockNumber(&xlrec->target.tid));
+						newworker = ParallelRedoBlockWorker(xlrec->target.node,
+									  ItemPointerGetBlockNumber(&xlrec->newtid));
+						if (oldworker == newworker)
+							return oldworker;
+						return -1;
+					}
+			}
+			return -1;
+		case RM_HEAP2_ID:
+			switch (info & XLOG_HEAP_OPMASK)
+			{
+				case XLOG_HEAP2_MULTI_INSERT:
+					{
+						xl_heap_multi_insert *xlrec = (xl_heap_multi_insert *) data;
+
+						return ParallelRedoBlockWorker(xlrec->node,
+													   xlrec->blkno);
+					}
+				case XLOG_HEAP2_LOCK_UPDATED:
+					{
+						xl_heap_lock_updated *xlrec = (xl_heap_lock_updated *) data;
+
+						return ParallelRedoBlockWorker(xlrec->target.node,
+								ItemPointerGetBlockNumber(&xlrec->target.tid));
+					}
+			}
+			return -1;
+		case RM_BTREE_ID:
+
+			/*
+			 * Only insertions into leaf pages; everything else interacts
+			 * with the tracking of incomplete splits, or with hot standby
+			 * conflict resolution.
+			 */
+			if (info == XLOG_BTREE_INSERT_LEAF)
+			{
+				xl_btree_insert *xlrec = (xl_btree_insert *) data;
+
+				return ParallelRedoBlockWorker(xlrec->target.node,
+								ItemPointerGetBlockNumber(&xlrec->target.tid));
+			}
+			return -1;
+	}
+
+	return -1;
+}
+
+/*
+ * Map a block to the worker responsible for it.
+ */
+static int
+ParallelRedoBlockWorker(RelFileNode rnode, BlockNumber blkno)
+{
+	struct
+	{
+		RelFileNode rnode;
+		BlockNumber blkno;
+	}			key;
+
+	/* zero any padding, so that it doesn't affect the hash */
+	memset(&key, 0, sizeof(key));
+	key.rnode = rnode;
+	key.blkno = blkno;
+
+	return tag_hash(&key, sizeof(key)) % redo_nworkers;
+}
+
+/*
+ * Compute the position up to which all WAL has been applied: the end of
+ * the last record dispatched, unless some worker hasn't caught up with it.
+ *
+ * We must read dispatchedUpTo before looking at the workers; a record that
+ * was dispatched after that shows up as queued work, which only makes the
+ * result smaller, so the result is never ahead of what's been applied.
+ */
+static XLogRecPtr
+ParallelRedoComputeReplayed(void)
+{
+	volatile ParallelRedoControl *ctl = ParallelRedoCtl;
+	XLogRecPtr	result;
+	int			nworkers;
+	int			i;
+
+	SpinLockAcquire(&ctl->mutex);
+	result = ctl->dispatchedUpTo;
+	nworkers = ctl->nworkers;
+	SpinLockRelease(&ctl->mutex);
+
+	for (i = 0; i < nworkers; i++)
+	{
+		volatile ParallelRedoWorkerSlot *slot = &ctl->slots[i];
+
+		SpinLockAcquire(&slot->mutex);
+		if (slot->napplied < slot->ndispatched && slot->appliedUpTo < result)
+			result = slot->appliedUpTo;
+		SpinLockRelease(&slot->mutex);
+	}
+
+	return result;
+}
+
+/*
+ * Main entry point for redo worker processes.
+ */
+void
+ParallelRedoWorkerMain(Datum main_arg)
+{
+	volatile ParallelRedoControl *ctl = ParallelRedoCtl;
+	volatile ParallelRedoWorkerSlot *slot;
+	MemoryContext redo_context;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+	uint32		generation = 0;
+
+	MyRedoWorker = DatumGetInt32(main_arg);
+	slot = &ctl->slots[MyRedoWorker];
+
+	/* Let SIGTERM interrupt us at the next CHECK_FOR_INTERRUPTS. */
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	/* Redo routines behave differently outside recovery. */
+	InRecovery = true;
+	reachedConsistency = true;
+
+	SpinLockAcquire(&slot->mutex);
+	slot->exited = false;
+	SpinLockRelease(&slot->mutex);
+	on_shmem_exit(ParallelRedoWorkerShutdown, (Datum) 0);
+
+	mq = ParallelRedoQueueAddress(MyRedoWorker);
+	shm_mq_set_receiver(mq, MyProc);
+	mqh = shm_mq_attach(mq, NULL);
+
+	redo_context = AllocSetContextCreate(TopMemoryContext,
+										 "Redo worker",
+										 ALLOCSET_DEFAULT_MINSIZE,
+										 ALLOCSET_DEFAULT_INITSIZE,
+										 ALLOCSET_DEFAULT_MAXSIZE);
+
+	for (;;)
+	{
+		ParallelRedoMessage *msg;
+		XLogRecord *record;
+		ErrorContextCallback errcallback;
+		MemoryContext oldcontext;
+		XLogRecPtr	replayed = InvalidXLogRecPtr;
+		TimeLineID	tli = 0;
+		bool		idle;
+		bool		wake_startup = false;
+		Size		nbytes;
+		void	   *data;
+
+		if (shm_mq_receive(mqh, &nbytes, &data, false) != SHM_MQ_SUCCESS)
+			break;
+
+		msg = (ParallelRedoMessage *) data;
+		record = (XLogRecord *) ((char *) data + PARALLEL_REDO_HEADER_SIZE);
+
+		/* Files might have been dropped or truncated since the last record */
+		if (msg->generation != generation)
+		{
+			smgrcloseall();
+			generation = msg->generation;
+		}
+
+		errcallback.callback = parallel_redo_error_callback;
+		errcallback.arg = (void *) record;
+		errcallback.previous = error_context_stack;
+		error_context_stack = &errcallback;
+
+		oldcontext = MemoryContextSwitchTo(redo_context);
+		PG_TRY();
+		{
+			RmgrTable[record->xl_rmid].rm_redo(msg->lsn, record);
+		}
+		PG_CATCH();
+		{
+			ParallelRedoWorkerReportError();
+			PG_RE_THROW();
+		}
+		PG_END_TRY();
+		MemoryContextSwitchTo(oldcontext);
+		MemoryContextReset(redo_context);
+
+		error_context_stack = errcallback.previous;
+
+		SpinLockAcquire(&slot->mutex);
+		slot->napplied++;
+		slot->appliedUpTo = msg->lsn;
+		idle = (slot->napplied == slot->ndispatched);
+		SpinLockRelease(&slot->mutex);
+
+		/*
+		 * Once we've caught up, the replay position may be able to move
+		 * forward, and the startup process may be waiting for us.
+		 */
+		if (idle)
+		{
+			replayed = ParallelRedoComputeReplayed();
+
+			SpinLockAcquire(&ctl->mutex);
+			tli = ctl->tli;
+			wake_startup = ctl->startupWaiting;
+			SpinLockRelease(&ctl->mutex);
+
+			XLogAdvanceReplayedUpTo(replayed, tli);
+			if (wake_startup)
+				SetLatch(&ctl->startupProc->procLatch);
+		}
+	}
+
+	proc_exit(0);
+}
+
+/*
+ * Copy the current error into our slot, where the startup process will
+ * find it.
+ */
+static void
+ParallelRedoWorkerReportError(void)
+{
+	volatile ParallelRedoWorkerSlot *slot = &ParallelRedoCtl->slots[MyRedoWorker];
+	ErrorData  *edata;
+
+	MemoryContextSwitchTo(TopMemoryContext);
+	edata = CopyErrorData();
+
+	SpinLockAcquire(&slot->mutex);
+	if (!slot->has_error)
+	{
+		slot->has_error = true;
+		slot->sqlerrcode = edata->sqlerrcode;
+		strlcpy((char *) slot->errmsg, edata->message,
+				PARALLEL_REDO_ERROR_SIZE);
+	}
+	SpinLockRelease(&slot->mutex);
+}
+
+/*
+ * on_shmem_exit callback for workers: mark ourselves as gone, and detach
+ * from our queue.
+ */
+static void
+ParallelRedoWorkerShutdown(int code, Datum arg)
+{
+	volatile ParallelRedoWorkerSlot *slot = &ParallelRedoCtl->slots[MyRedoWorker];
+	PGPROC	   *startupProc;
+
+	SpinLockAcquire(&slot->mutex);
+	slot->exited = true;
+	SpinLockRelease(&slot->mutex);
+
+	shm_mq_detach(ParallelRedoQueueAddress(MyRedoWorker));
+
+	/* The startup process might be waiting for us, not for the queue */
+	startupProc = ParallelRedoCtl->startupProc;
+	if (startupProc != NULL)
+		SetLatch(&startupProc->procLatch);
+}
+
+/*
+ * Error context callback for errors occurring during redo in a worker.
+ */
+static void
+parallel_redo_error_callback(void *arg)
+{
+	XLogRecord *record = (XLogRecord *) arg;
+	StringInfoData buf;
+
+	initStringInfo(&buf);
+	RmgrTable[record->xl_rmid].rm_desc(&buf,
+									   record->xl_info,
+									   XLogRecGetData(record));
+
+	/* don't bother emitting empty description */
+	if (buf.len > 0)
+		errcontext("xlog redo %s", buf.data);
+
+	pfree(buf.data);
+}
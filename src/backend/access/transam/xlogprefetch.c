@@ -0,0 +1,721 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogprefetch.c
+ *		Prefetching support for recovery.
+ *
+ * During recovery, the startup process replays WAL records one at a time,
+ * reading each data block that a record touches into shared buffers just
+ * before applying the change.  On a system whose working set doesn't fit in
+ * memory, that means replay waits for one random read after another.  To
+ * avoid that, we decode the WAL a little ahead of the record being replayed
+ * with a separate XLogReader, and issue prefetch hints for the blocks that
+ * the upcoming records will need, so that the kernel can read them in
+ * while replay is busy with earlier records.
+ *
+ * Not every referenced block needs to be prefetched.  Blocks whose full
+ * page image is included in the record are restored from the WAL without
+ * being read, and so are pages that the record initializes from scratch.
+ * Blocks that are in shared buffers already don't need any I/O, and a block
+ * that we issued a hint for just a moment ago was probably caught by that
+ * hint.  We keep counters of how often each of those cases occurs, shown in
+ * the pg_stat_recovery_prefetch view.
+ *
+ * The prefetcher only looks at WAL that is already on disk in pg_xlog (and,
+ * when streaming, that the WAL receiver has written), it never waits for
+ * more to arrive and it never restores anything from the archive.  If it
+ * can't read ahead, replay just proceeds without prefetching, as it would
+ * without this module.  Since the records are decoded independently of
+ * replay, they're only used as hints: all the information here is
+ * re-checked by the redo routines when they really read the blocks.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *		src/backend/access/transam/xlogprefetch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "access/heapam_xlog.h"
+#include "access/nbtree.h"
+#include "access/rmgr.h"
+#include "access/xlog_internal.h"
+#include "access/xlogprefetch.h"
+#include "access/xlogreader.h"
+#include "replication/walreceiver.h"
+#include "storage/bufmgr.h"
+#include "storage/fd.h"
+#include "storage/shmem.h"
+#include "storage/smgr.h"
+#include "storage/spin.h"
+#include "utils/timestamp.h"
+
+/*
+ * Number of recently prefetched blocks that we remember, to avoid issuing
+ * repeated hints for the same block.
+ */
+#define XLOGPREFETCHER_RECENT_BLOCKS	64
+
+/* GUC variable */
+#ifdef USE_PREFETCH
+int			recovery_prefetch_distance = 512;
+#else
+int			recovery_prefetch_distance = 0;
+#endif
+
+/* Identity of a block referenced by a WAL record */
+typedef struct XLogPrefetchBlock
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+	BlockNumber blkno;
+} XLogPrefetchBlock;
+
+struct XLogPrefetcher
+{
+	/* Reader used to decode the WAL ahead of replay */
+	XLogReaderState *reader;
+
+	/* WAL segment file currently open for reading ahead, or -1 */
+	int			readFile;
+	XLogSegNo	readSegNo;
+	TimeLineID	readTLI;
+
+	/* Timeline to read from, and how far it's safe to read */
+	TimeLineID	tli;
+	XLogRecPtr	readLimit;
+
+	/* Has the reader been positioned relative to replay? */
+	bool		started;
+
+	/*
+	 * If we failed to read ahead, the position we got stuck at and the read
+	 * limit at the time.  We don't try again until either has moved on.
+	 * missingUpTo is the end of the last segment that wasn't in pg_xlog;
+	 * during archive recovery, replay might be reading it from the archive,
+	 * and there's no point in looking for it again until replay has
+	 * finished with it.
+	 */
+	bool		blocked;
+	XLogRecPtr	blockedAt;
+	XLogRecPtr	blockedLimit;
+	XLogRecPtr	missingUpTo;
+
+	/* Ring of recently prefetched blocks */
+	XLogPrefetchBlock recent[XLOGPREFETCHER_RECENT_BLOCKS];
+	int			next_recent;
+
+	/* Counters not yet added to the shared statistics */
+	int64		prefetch;
+	int64		hit;
+	int64		skip_init;
+	int64		skip_fpw;
+	int64		skip_rep;
+};
+
+/* Statistics in shared memory, protected by the spinlock */
+typedef struct XLogPrefetchShared
+{
+	slock_t		mutex;
+	XLogPrefetchStats stats;
+} XLogPrefetchShared;
+
+static XLogPrefetchShared *PrefetchShared = NULL;
+
+static int XLogPrefetcherReadPage(XLogReaderState *state,
+					   XLogRecPtr targetPagePtr, int reqLen,
+					   XLogRecPtr targetRecPtr, char *readBuf,
+					   TimeLineID *pageTLI);
+static void XLogPrefetcherScanRecord(XLogPrefetcher *prefetcher,
+						 XLogRecord *record);
+static void XLogPrefetcherBlock(XLogPrefetcher *prefetcher,
+					XLogPrefetchBlock *fpw, int nfpw,
+					RelFileNode rnode, ForkNumber forknum,
+					BlockNumber blkno, bool init);
+static void XLogPrefetcherPublishStats(XLogPrefetcher *prefetcher,
+						   int wal_distance);
+
+
+/*
+ * Report shared memory space needed by XLogPrefetchShmemInit.
+ */
+Size
+XLogPrefetchShmemSize(void)
+{
+	return sizeof(XLogPrefetchShared);
+}
+
+/*
+ * Allocate and initialize the shared statistics.
+ */
+void
+XLogPrefetchShmemInit(void)
+{
+	bool		found;
+
+	PrefetchShared = (XLogPrefetchShared *)
+		ShmemInitStruct("XLogPrefetchShared", sizeof(XLogPrefetchShared),
+						&found);
+	if (!found)
+	{
+		SpinLockInit(&PrefetchShared->mutex);
+		memset(&PrefetchShared->stats, 0, sizeof(XLogPrefetchStats));
+		PrefetchShared->stats.stat_reset_timestamp = GetCurrentTimestamp();
+	}
+}
+
+/*
+ * Return a copy of the current statistics.
+ */
+void
+XLogPrefetchGetStats(XLogPrefetchStats *stats)
+{
+	/* use volatile pointer to prevent code rearrangement */
+	volatile XLogPrefetchShared *shared = PrefetchShared;
+
+	SpinLockAcquire(&shared->mutex);
+	*stats = shared->stats;
+	SpinLockRelease(&shared->mutex);
+}
+
+/*
+ * Zero the statistics counters.
+ *
+ * The startup process keeps adding to the shared counters after this, so
+ * the counters start over from zero but wal_distance remains valid.
+ */
+void
+XLogPrefetchResetStats(void)
+{
+	/* use volatile pointer to prevent code rearrangement */
+	volatile XLogPrefetchShared *shared = PrefetchShared;
+	TimestampTz now = GetCurrentTimestamp();
+
+	SpinLockAcquire(&shared->mutex);
+	shared->stats.stat_reset_timestamp = now;
+	shared->stats.prefetch = 0;
+	shared->stats.hit = 0;
+	shared->stats.skip_init = 0;
+	shared->stats.skip_fpw = 0;
+	shared->stats.skip_rep = 0;
+	SpinLockRelease(&shared->mutex);
+}
+
+/*
+ * Create a prefetcher, to be used by the startup process during redo.
+ */
+XLogPrefetcher *
+XLogPrefetcherAllocate(void)
+{
+	XLogPrefetcher *prefetcher;
+
+	prefetcher = (XLogPrefetcher *) palloc0(sizeof(XLogPrefetcher));
+	prefetcher->reader = XLogReaderAllocate(&XLogPrefetcherReadPage,
+											(void *) prefetcher);
+	if (prefetcher->reader == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+			errdetail("Failed while allocating an XLog reading processor.")));
+	prefetcher->readFile = -1;
+
+	/* The statistics describe the current recovery only */
+	XLogPrefetchResetStats();
+
+	return prefetcher;
+}
+
+/*
+ * Release a prefetcher and its resources.
+ */
+void
+XLogPrefetcherFree(XLogPrefetcher *prefetcher)
+{
+	XLogPrefetcherPublishStats(prefetcher, 0);
+
+	if (prefetcher->readFile >= 0)
+		close(prefetcher->readFile);
+	XLogReaderFree(prefetcher->reader);
+	pfree(prefetcher);
+}
+
+/*
+ * Read ahead of the record about to be replayed, and issue prefetch hints
+ * for the blocks referenced by the upcoming records.
+ *
+ * replayRecPtr and replayEndRecPtr are the start and end of the record that
+ * replay is about to apply, replayTLI the timeline it belongs to.  This is
+ * meant to be called once for every replayed record, so it's cheap when
+ * there's nothing to do.
+ */
+void
+XLogPrefetch(XLogPrefetcher *prefetcher, XLogRecPtr replayRecPtr,
+			 XLogRecPtr replayEndRecPtr, TimeLineID replayTLI)
+{
+	XLogReaderState *reader = prefetcher->reader;
+	XLogRecPtr	readLimit;
+	XLogRecPtr	targetRecPtr;
+	XLogRecord *record;
+	char	   *errormsg;
+	int			wal_distance;
+
+	if (recovery_prefetch_distance <= 0)
+	{
+		prefetcher->started = false;
+		return;
+	}
+
+	/*
+	 * While streaming, don't read past what the WAL receiver has written;
+	 * the rest of the segment file is garbage, or not there at all.  Other
+	 * than that, read as far as we find valid WAL in pg_xlog.
+	 */
+	readLimit = UINT64CONST(0xFFFFFFFFFFFFFFFF);
+	if (WalRcvStreaming())
+	{
+		TimeLineID	receiveTLI;
+		XLogRecPtr	receivePtr;
+
+		receivePtr = GetWalRcvWriteRecPtr(NULL, &receiveTLI);
+		if (receiveTLI == replayTLI)
+			readLimit = receivePtr;
+	}
+
+	/* Start over from the replay position if we have fallen behind */
+	if (!prefetcher->started || prefetcher->tli != replayTLI ||
+		reader->EndRecPtr < replayEndRecPtr)
+	{
+		prefetcher->started = false;
+		prefetcher->tli = replayTLI;
+	}
+
+	/* If we got stuck last time, wait until there's a chance to get further */
+	if (prefetcher->blocked)
+	{
+		if (readLimit == prefetcher->blockedLimit &&
+			replayEndRecPtr <= prefetcher->blockedAt)
+			goto done;
+		prefetcher->blocked = false;
+	}
+
+	prefetcher->readLimit = readLimit;
+
+	/*
+	 * Decode records until we're far enough ahead.  When starting over,
+	 * reread the record being replayed to get the reader in sync with replay,
+	 * but don't bother with its blocks; replay is going to read them right
+	 * away.
+	 */
+	while (!prefetcher->started ||
+		   reader->EndRecPtr - replayEndRecPtr <
+		   (XLogRecPtr) recovery_prefetch_distance * 1024)
+	{
+		targetRecPtr = prefetcher->started ? InvalidXLogRecPtr : replayRecPtr;
+
+		record = XLogReadRecord(reader, targetRecPtr, &errormsg);
+		if (record == NULL)
+		{
+			/*
+			 * No more WAL available for now.  There's no need to complain:
+			 * replay's own reader will handle any real problems.
+			 */
+			prefetcher->blocked = true;
+			prefetcher->blockedAt = Max(reader->EndRecPtr, replayEndRecPtr);
+			prefetcher->blockedAt = Max(prefetcher->blockedAt,
+										prefetcher->missingUpTo);
+			prefetcher->blockedLimit = readLimit;
+			break;
+		}
+
+		if (prefetcher->started)
+			XLogPrefetcherScanRecord(prefetcher, record);
+		prefetcher->started = true;
+	}
+
+done:
+	if (prefetcher->started && reader->EndRecPtr > replayEndRecPtr)
+		wal_distance = (int) Min(reader->EndRecPtr - replayEndRecPtr,
+								 (XLogRecPtr) INT_MAX);
+	else
+		wal_distance = 0;
+	XLogPrefetcherPublishStats(prefetcher, wal_distance);
+}
+
+/*
+ * Add our counters to the shared statistics.
+ */
+static void
+XLogPrefetcherPublishStats(XLogPrefetcher *prefetcher, int wal_distance)
+{
+	/* use volatile pointer to prevent code rearrangement */
+	volatile XLogPrefetchShared *shared = PrefetchShared;
+
+	SpinLockAcquire(&shared->mutex);
+	shared->stats.prefetch += prefetcher->prefetch;
+	shared->stats.hit += prefetcher->hit;
+	shared->stats.skip_init += prefetcher->skip_init;
+	shared->stats.skip_fpw += prefetcher->skip_fpw;
+	shared->stats.skip_rep += prefetcher->skip_rep;
+	shared->stats.wal_distance = wal_distance;
+	SpinLockRelease(&shared->mutex);
+
+	prefetcher->prefetch = 0;
+	prefetcher->hit = 0;
+	prefetcher->skip_init = 0;
+	prefetcher->skip_fpw = 0;
+	prefetcher->skip_rep = 0;
+}
+
+/*
+ * Issue prefetch hints for the blocks referenced by a WAL record.
+ *
+ * WAL records don't carry their block references in any generic form, so
+ * we have to know the layout of each record type.  We cover the heap and
+ * btree records, which account for most of the random reads during replay
+ * on a typical system; records of other resource managers are ignored.
+ */
+static void
+XLogPrefetcherScanRecord(XLogPrefetcher *prefetcher, XLogRecord *record)
+{
+	XLogPrefetchBlock fpw[XLR_MAX_BKP_BLOCKS];
+	int			nfpw = 0;
+	uint8		info = record->xl_info & ~XLR_INFO_MASK;
+	char	   *data = XLogRecGetData(record);
+	char	   *blk;
+	int			i;
+
+	/*
+	 * Collect the blocks whose full page images are included in the record.
+	 * Replay restores those without reading the old contents.
+	 */
+	blk = data + record->xl_len;
+	for (i = 0; i < XLR_MAX_BKP_BLOCKS; i++)
+	{
+		BkpBlock	bkpb;
+
+		if (!(record->xl_info & XLR_BKP_BLOCK(i)))
+			continue;
+
+		memcpy(&bkpb, blk, sizeof(BkpBlock));
+		blk += sizeof(BkpBlock) + bkpb.length;
+
+		fpw[nfpw].rnode = bkpb.node;
+		fpw[nfpw].forknum = bkpb.fork;
+		fpw[nfpw].blkno = bkpb.block;
+		nfpw++;
+		prefetcher->skip_fpw++;
+	}
+
+	switch (record->xl_rmid)
+	{
+		case RM_HEAP_ID:
+			{
+				bool		init = (info & XLOG_HEAP_INIT_PAGE) != 0;
+
+				switch (info & XLOG_HEAP_OPMASK)
+				{
+					case XLOG_HEAP_INSERT:
+						{
+							xl_heap_insert *xlrec = (xl_heap_insert *) data;
+
+							XLogPrefetcherBlock(prefetcher, fpw, nfpw,
+												xlrec->target.node,
+												MAIN_FORKNUM,
+								ItemPointerGetBlockNumber(&xlrec->target.tid),
+												init);
+							break;
+						}
+					case XLOG_HEAP_UPDATE:
+					case XLOG_HEAP_HOT_UPDATE:
+						{
+							xl_heap_update *xlrec = (xl_heap_update *) data;
+							BlockNumber oldblk;
+							BlockNumber newblk;
+
+							oldblk = ItemPointerGetBlockNumber(&xlrec->target.tid);
+							newblk = ItemPointerGetBlockNumber(&xlrec->newtid);
+							XLogPrefetcherBlock(prefetcher, fpw, nfpw,
+												xlrec->target.node,
+												MAIN_FORKNUM, oldblk, false);
+							if (newblk != oldblk)
+								XLogPrefetcherBlock(prefetcher, fpw, nfpw,
+													xlrec->target.node,
+													MAIN_FORKNUM, newblk,
+													init);
+							break;
+						}
+					case XLOG_HEAP_DELETE:
+					case XLOG_HEAP_LOCK:
+					case XLOG_HEAP_INPLACE:
+						{
+							/* these all start with an xl_heaptid */
+							xl_heaptid *target = (xl_heaptid *) data;
+
+							XLogPrefetcherBlock(prefetcher, fpw, nfpw,
+												target->node, MAIN_FORKNUM,
+									   ItemPointerGetBlockNumber(&target->tid),
+												false);
+							break;
+						}
+					case XLOG_HEAP_NEWPAGE:
+						{
+							xl_heap_newpage *xlrec = (xl_heap_newpage *) data;
+
+							XLogPrefetcherBlock(prefetcher, fpw, nfpw,
+												xlrec->node, xlrec->forknum,
+												xlrec->blkno, true);
+							break;
+						}
+				}
+				break;
+			}
+
+		case RM_HEAP2_ID:
+			switch (info & XLOG_HEAP_OPMASK)
+			{
+				case XLOG_HEAP2_FREEZE:
+					{
+						xl_heap_freeze *xlrec = (xl_heap_freeze *) data;
+
+						XLogPrefetcherBlock(prefetcher, fpw, nfpw,
+											xlrec->node, MAIN_FORKNUM,
+											xlrec->block, false);
+						break;
+					}
+				case XLOG_HEAP2_CLEAN:
+					{
+						xl_heap_clean *xlrec = (xl_heap_clean *) data;
+
+						XLogPrefetcherBlock(prefetcher, fpw, nfpw,
+											xlrec->node, MAIN_FORKNUM,
+											xlrec->block, false);
+						break;
+					}
+				case XLOG_HEAP2_FREEZE_PAGE:
+					{
+						xl_heap_freeze_page *xlrec = (xl_heap_freeze_page *) data;
+
+						XLogPrefetcherBlock(prefetcher, fpw, nfpw,
+											xlrec->node, MAIN_FORKNUM,
+											xlrec->block, false);
+						break;
+					}
+				case XLOG_HEAP2_VISIBLE:
+					{
+						xl_heap_visible *xlrec = (xl_heap_visible *) data;
+
+						XLogPrefetcherBlock(prefetcher, fpw, nfpw,
+											xlrec->node, MAIN_FORKNUM,
+											xlrec->block, false);
+						break;
+					}
+				case XLOG_HEAP2_MULTI_INSERT:
+					{
+						xl_heap_multi_insert *xlrec = (xl_heap_multi_insert *) data;
+
+						XLogPrefetcherBlock(prefetcher, fpw, nfpw,
+											xlrec->node, MAIN_FORKNUM,
+											xlrec->blkno,
+											(info & XLOG_HEAP_INIT_PAGE) != 0);
+						break;
+					}
+				case XLOG_HEAP2_LOCK_UPDATED:
+					{
+						xl_heap_lock_updated *xlrec = (xl_heap_lock_updated *) data;
+
+						XLogPrefetcherBlock(prefetcher, fpw, nfpw,
+											xlrec->target.node, MAIN_FORKNUM,
+								ItemPointerGetBlockNumber(&xlrec->target.tid),
+											false);
+						break;
+					}
+			}
+			break;
+
+		case RM_BTREE_ID:
+			switch (info)
+			{
+				case XLOG_BTREE_INSERT_LEAF:
+				case XLOG_BTREE_INSERT_UPPER:
+				case XLOG_BTREE_INSERT_META:
+					{
+						xl_btree_insert *xlrec = (xl_btree_insert *) data;
+
+						XLogPrefetcherBlock(prefetcher, fpw, nfpw,
+											xlrec->target.node, MAIN_FORKNUM,
+								ItemPointerGetBlockNumber(&xlrec->target.tid),
+											false);
+						break;
+					}
+				case XLOG_BTREE_SPLIT_L:
+				case XLOG_BTREE_SPLIT_R:
+				case XLOG_BTREE_SPLIT_L_ROOT:
+				case XLOG_BTREE_SPLIT_R_ROOT:
+					{
+						xl_btree_split *xlrec = (xl_btree_split *) data;
+
+						XLogPrefetcherBlock(prefetcher, fpw, nfpw,
+											xlrec->node, MAIN_FORKNUM,
+											xlrec->leftsib, false);
+						/* the new right sibling is initialized from scratch */
+						XLogPrefetcherBlock(prefetcher, fpw, nfpw,
+											xlrec->node, MAIN_FORKNUM,
+											xlrec->rightsib, true);
+						if (xlrec->rnext != P_NONE)
+							XLogPrefetcherBlock(prefetcher, fpw, nfpw,
+												xlrec->node, MAIN_FORKNUM,
+												xlrec->rnext, false);
+						break;
+					}
+				case XLOG_BTREE_DELETE:
+					{
+						xl_btree_delete *xlrec = (xl_btree_delete *) data;
+
+						XLogPrefetcherBlock(prefetcher, fpw, nfpw,
+											xlrec->node, MAIN_FORKNUM,
+											xlrec->block, false);
+						break;
+					}
+				case XLOG_BTREE_VACUUM:
+					{
+						xl_btree_vacuum *xlrec = (xl_btree_vacuum *) data;
+
+						XLogPrefetcherBlock(prefetcher, fpw, nfpw,
+											xlrec->node, MAIN_FORKNUM,
+											xlrec->block, false);
+						break;
+					}
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+/*
+ * Issue a prefetch hint for one block referenced by a WAL record, unless
+ * replay isn't going to read it, or we can tell that it's not needed.
+ *
+ * fpw/nfpw are the blocks with full page images in the record, and init
+ * is true if replay initializes the page without reading it.
+ */
+static void
+XLogPrefetcherBlock(XLogPrefetcher *prefetcher,
+					XLogPrefetchBlock *fpw, int nfpw,
+					RelFileNode rnode, ForkNumber forknum,
+					BlockNumber blkno, bool init)
+{
+	SMgrRelation smgr;
+	XLogPrefetchBlock *entry;
+	int			i;
+
+	/* Restored from a full page image?  Already counted, then. */
+	for (i = 0; i < nfpw; i++)
+	{
+		if (RelFileNodeEquals(fpw[i].rnode, rnode) &&
+			fpw[i].forknum == forknum &&
+			fpw[i].blkno == blkno)
+			return;
+	}
+
+	if (init)
+	{
+		prefetcher->skip_init++;
+		return;
+	}
+
+	/* Did we issue a hint for it a moment ago? */
+	for (i = 0; i < XLOGPREFETCHER_RECENT_BLOCKS; i++)
+	{
+		entry = &prefetcher->recent[i];
+		if (entry->blkno == blkno &&
+			entry->forknum == forknum &&
+			RelFileNodeEquals(entry->rnode, rnode))
+		{
+			prefetcher->skip_rep++;
+			return;
+		}
+	}
+
+	/*
+	 * The relation might not exist anymore, or not yet.  mdprefetch copes
+	 * with that during recovery, and opening it at the smgr level is
+	 * harmless: replay doesn't care whether it's open already.
+	 */
+	smgr = smgropen(rnode, InvalidBackendId);
+	if (PrefetchSharedBuffer(smgr, forknum, blkno))
+		prefetcher->prefetch++;
+	else
+		prefetcher->hit++;
+
+	entry = &prefetcher->recent[prefetcher->next_recent];
+	entry->rnode = rnode;
+	entry->forknum = forknum;
+	entry->blkno = blkno;
+	prefetcher->next_recent =
+		(prefetcher->next_recent + 1) % XLOGPREFETCHER_RECENT_BLOCKS;
+}
+
+/*
+ * XLogReader callback to read a page of WAL ahead of replay.
+ *
+ * This reads straight from the segment files in pg_xlog, and never waits:
+ * if the WAL isn't there yet, we just report failure, and XLogPrefetch will
+ * try again later.
+ */
+static int
+XLogPrefetcherReadPage(XLogReaderState *state, XLogRecPtr targetPagePtr,
+					   int reqLen, XLogRecPtr targetRecPtr, char *readBuf,
+					   TimeLineID *pageTLI)
+{
+	XLogPrefetcher *prefetcher = (XLogPrefetcher *) state->private_data;
+	XLogSegNo	segno;
+	uint32		readOff;
+	int			readLen;
+
+	if (prefetcher->readLimit < targetPagePtr + reqLen)
+		return -1;
+	if (prefetcher->readLimit - targetPagePtr < XLOG_BLCKSZ)
+		readLen = (int) (prefetcher->readLimit - targetPagePtr);
+	else
+		readLen = XLOG_BLCKSZ;
+
+	XLByteToSeg(targetPagePtr, segno);
+
+	if (prefetcher->readFile >= 0 &&
+		(prefetcher->readSegNo != segno || prefetcher->readTLI != prefetcher->tli))
+	{
+		close(prefetcher->readFile);
+		prefetcher->readFile = -1;
+	}
+
+	if (prefetcher->readFile < 0)
+	{
+		char		path[MAXPGPATH];
+
+		XLogFilePath(path, prefetcher->tli, segno);
+		prefetcher->readFile = BasicOpenFile(path, O_RDONLY | PG_BINARY, 0);
+		if (prefetcher->readFile < 0)
+		{
+			XLogSegNoOffsetToRecPtr(segno + 1, 0, prefetcher->missingUpTo);
+			return -1;
+		}
+		prefetcher->readSegNo = segno;
+		prefetcher->readTLI = prefetcher->tli;
+	}
+
+	readOff = targetPagePtr % XLogSegSize;
+	if (lseek(prefetcher->readFile, (off_t) readOff, SEEK_SET) < 0)
+		return -1;
+	if (read(prefetcher->readFile, readBuf, readLen) != readLen)
+		return -1;
+
+	*pageTLI = prefetcher->tli;
+	return readLen;
+}
@@ -712,7 +712,17 @@ ValidXLogRecord(XLogReaderState *state, XLogRecord *record, XLogRecPtr recptr)
 								  (uint32) (recptr >> 32), (uint32) recptr);
 			return false;
 		}
-		blen = sizeof(BkpBlock) + BLCKSZ - bkpb.hole_length;
+		/* Compressed data must be smaller than the image it replaces */
+		if ((bkpb.bkp_info & BKPBLOCK_COMPRESSED) ?
+			bkpb.length >= BLCKSZ - bkpb.hole_length :
+			bkpb.length != BLCKSZ - bkpb.hole_length)
+		{
+			report_invalid_record(state,
+							  "invalid backup block size in record at %X/%X",
+								  (uint32) (recptr >> 32), (uint32) recptr);
+			return false;
+		}
+		blen = sizeof(BkpBlock) + bkpb.length;
 
 		if (remaining < blen)
 		{
@@ -21,6 +21,7 @@
 #include "access/xlogutils.h"
 #include "catalog/catalog.h"
 #include "common/relpath.h"
+#include "storage/lock.h"
 #include "storage/smgr.h"
 #include "utils/guc.h"
 #include "utils/hsearch.h"
@@ -300,6 +301,7 @@ XLogReadBufferExtended(RelFileNode rnode, ForkNumber forknum,
 	BlockNumber lastblock;
 	Buffer		buffer;
 	SMgrRelation smgr;
+	LOCKTAG		tag;
 
 	Assert(blkno != P_NEW);
 
@@ -335,24 +337,41 @@ XLogReadBufferExtended(RelFileNode rnode, ForkNumber forknum,
 		if (mode == RBM_NORMAL_NO_LOG)
 			return InvalidBuffer;
 		/* OK to extend the file */
-		/* we do this in recovery only - no rel-extension lock needed */
 		Assert(InRecovery);
-		buffer = InvalidBuffer;
-		do
-		{
-			if (buffer != InvalidBuffer)
-				ReleaseBuffer(buffer);
-			buffer = ReadBufferWithoutRelcache(rnode, forknum,
-											   P_NEW, mode, NULL);
-		}
-		while (BufferGetBlockNumber(buffer) < blkno);
-		/* Handle the corner case that P_NEW returns non-consecutive pages */
-		if (BufferGetBlockNumber(buffer) != blkno)
-		{
-			ReleaseBuffer(buffer);
+
+		/*
+		 * No regular backend can be extending the relation in recovery, but
+		 * parallel redo workers (see xlogparallel.c) might, so we need the
+		 * rel-extension lock, and have to check again once we have it.
+		 */
+		SET_LOCKTAG_RELATION_EXTEND(tag, rnode.dbNode, rnode.relNode);
+		(void) LockAcquire(&tag, ExclusiveLock, false, false);
+
+		lastblock = smgrnblocks(smgr, forknum);
+		if (blkno < lastblock)
 			buffer = ReadBufferWithoutRelcache(rnode, forknum, blkno,
 											   mode, NULL);
+		else
+		{
+			buffer = InvalidBuffer;
+			do
+			{
+				if (buffer != InvalidBuffer)
+					ReleaseBuffer(buffer);
+				buffer = ReadBufferWithoutRelcache(rnode, forknum,
+												   P_NEW, mode, NULL);
+			}
+			while (BufferGetBlockNumber(buffer) < blkno);
+			/* Handle the corner case that P_NEW returns non-consecutive pages */
+			if (BufferGetBlockNumber(buffer) != blkno)
+			{
+				ReleaseBuffer(buffer);
+				buffer = ReadBufferWithoutRelcache(rnode, forknum, blkno,
+												   mode, NULL);
+			}
 		}
+
+		LockRelease(&tag, ExclusiveLock, false);
 	}
 
 	if (mode == RBM_NORMAL)
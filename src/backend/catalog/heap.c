@@ -39,6 +39,7 @@
 #include "catalog/heap.h"
 #include "catalog/index.h"
 #include "catalog/objectaccess.h"
+#include "catalog/partition.h"
 #include "catalog/pg_attrdef.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_constraint.h"
@@ -60,6 +61,7 @@
 #include "parser/parse_collate.h"
 #include "parser/parse_expr.h"
 #include "parser/parse_relation.h"
+#include "storage/lmgr.h"
 #include "storage/predicate.h"
 #include "storage/smgr.h"
 #include "utils/acl.h"
@@ -1734,6 +1736,16 @@ void
 heap_drop_with_catalog(Oid relid)
 {
 	Relation	rel;
+	Oid			parentId;
+
+	/*
+	 * If the relation is a partition, lock its parent too: dropping a
+	 * partition changes the parent's partition descriptor, which anyone
+	 * holding any lock on the parent is entitled to rely on.
+	 */
+	parentId = get_partition_parent(relid);
+	if (OidIsValid(parentId))
+		LockRelationOid(parentId, AccessExclusiveLock);
 
 	/*
 	 * Open and lock the relation.
@@ -1811,6 +1823,17 @@ heap_drop_with_catalog(Oid relid)
 	 */
 	RelationRemoveInheritance(relid);
 
+	/*
+	 * remove partitioning information, and make the parent rebuild its
+	 * partition descriptor
+	 */
+	RemovePartitionKeyByRelId(relid);
+	if (OidIsValid(parentId))
+	{
+		RemovePartitionBoundByRelId(relid);
+		CacheInvalidateRelcacheByRelid(parentId);
+	}
+
 	/*
 	 * delete statistics
 	 */
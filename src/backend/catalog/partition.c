@@ -0,0 +1,1510 @@
+/*-------------------------------------------------------------------------
+ *
+ * partition.c
+ *	  Partitioning related data structures and functions.
+ *
+ * A partitioned table is an ordinary table with a row in
+ * pg_partitioned_table describing its partition key.  Its partitions are
+ * inheritance children that additionally have a row in pg_partition, giving
+ * the bound of the key values they accept.  The functions here build the
+ * in-memory form of that information for the relcache, maintain the catalog
+ * rows, and use the bounds for tuple routing, partition constraint checking
+ * and partition pruning.
+ *
+ * Partition bounds are stored as PartitionBoundSpec node trees whose datums
+ * are Consts of the key columns' types.  List partitioning supports a single
+ * key column; range partitioning supports several, compared
+ * lexicographically, with each partition accepting keys from its lower
+ * bound (inclusive) to its upper bound (exclusive).
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *		  src/backend/catalog/partition.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/heapam.h"
+#include "access/htup_details.h"
+#include "access/nbtree.h"
+#include "catalog/dependency.h"
+#include "catalog/indexing.h"
+#include "catalog/partition.h"
+#include "catalog/pg_collation.h"
+#include "catalog/pg_opclass.h"
+#include "catalog/pg_partition.h"
+#include "catalog/pg_partitioned_table.h"
+#include "executor/tuptable.h"
+#include "nodes/makefuncs.h"
+#include "utils/builtins.h"
+#include "utils/datum.h"
+#include "utils/fmgroids.h"
+#include "utils/inval.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/syscache.h"
+#include "utils/tqual.h"
+
+
+/*
+ * One bound of a range partition.  kind[] says, for each key column, whether
+ * the bound has a value or is MINVALUE/MAXVALUE; datums[] holds the values.
+ */
+typedef struct PartitionRangeBound
+{
+	Datum	   *datums;
+	PartitionRangeDatumKind *kind;
+} PartitionRangeBound;
+
+/*
+ * Bounds of all the partitions of a table.
+ *
+ * For list partitioning, datums[] holds all the values accepted by any
+ * partition in ascending order, and indexes[] the partition accepting each.
+ * null_index is the partition accepting NULLs, or -1.
+ *
+ * For range partitioning, the partitions are sorted by their lower bounds,
+ * and since they cannot overlap, by their upper bounds too.  lower[i] and
+ * upper[i] are the bounds of partition i.
+ */
+typedef struct PartitionBoundInfoData
+{
+	char		strategy;
+
+	/* list partitioning */
+	int			ndatums;
+	Datum	   *datums;
+	int		   *indexes;
+	int			null_index;
+
+	/* range partitioning */
+	PartitionRangeBound *lower;
+	PartitionRangeBound *upper;
+} PartitionBoundInfoData;
+
+/*
+ * Checking a tuple against a partition's bound requires the key of the
+ * partition's parent and the bound itself, which we represent as the
+ * PartitionDesc of a table having just that one partition.  For partitions
+ * of partitions, the bounds at all levels are checked, outermost first.
+ */
+typedef struct PartitionCheckData
+{
+	PartitionKey key;			/* the parent's partition key */
+	PartitionDesc pdesc;		/* the partition's bound, as partition 0 */
+	AttrNumber *attnos;			/* key columns in the checked relation */
+	struct PartitionCheckData *next;	/* check for the next level down */
+} PartitionCheckData;
+
+/* Used when sorting list values and range bounds */
+typedef struct PartitionListValue
+{
+	int			index;
+	Datum		value;
+} PartitionListValue;
+
+typedef struct PartitionRangeEntry
+{
+	int			index;			/* position in the caller's bound list */
+	PartitionRangeBound lower;
+	PartitionRangeBound upper;
+} PartitionRangeEntry;
+
+static PartitionKey build_partition_key(Relation rel, HeapTuple tuple,
+					MemoryContext cxt);
+static PartitionDesc build_partition_desc(PartitionKey key, List *oids,
+					 List *bounds, MemoryContext cxt);
+static PartitionBoundSpec *get_partition_bound(Oid relid, Oid *parentId);
+static void make_range_bound(PartitionKey key, List *datums,
+				 PartitionRangeBound *bound);
+static int32 partition_rbound_cmp(PartitionKey key, PartitionRangeBound *b1,
+					 Datum *datums2, PartitionRangeDatumKind *kind2);
+static int	partition_oid_cmp(const void *a, const void *b);
+static int	partition_list_value_cmp(const void *a, const void *b, void *arg);
+static int	partition_range_entry_cmp(const void *a, const void *b, void *arg);
+static int	partition_list_bsearch(PartitionKey key, PartitionBoundInfo boundinfo,
+					   Datum value);
+static PartitionKey copy_partition_key(PartitionKey fromkey);
+static int partition_list_boundary(FmgrInfo *cmpfn, Oid collation,
+						PartitionBoundInfo boundinfo, Datum value,
+						bool strict);
+static bool range_lower_matches(PartitionKey key, FmgrInfo *cmpfn,
+					Oid collation, PartitionRangeBound *lower,
+					StrategyNumber strategy, Datum value);
+static bool range_upper_matches(PartitionKey key, FmgrInfo *cmpfn,
+					Oid collation, PartitionRangeBound *upper,
+					StrategyNumber strategy, Datum value);
+
+
+/*
+ * RelationBuildPartitionInfo
+ *		Load the partition key and partitions of a relation into its
+ *		relcache entry.
+ *
+ * If the relation is not partitioned, rd_partkey and rd_partdesc are set to
+ * NULL.  Either way rd_partparent and rd_partvalid are set.
+ */
+void
+RelationBuildPartitionInfo(Relation rel)
+{
+	HeapTuple	tuple;
+	MemoryContext cxt;
+	PartitionKey key;
+	PartitionDesc pdesc;
+	Relation	partrel;
+	SysScanDesc scan;
+	ScanKeyData skey;
+	List	   *oids = NIL;
+	List	   *bounds = NIL;
+
+	rel->rd_partparent = get_partition_parent(RelationGetRelid(rel));
+
+	tuple = SearchSysCache1(PARTRELID,
+							ObjectIdGetDatum(RelationGetRelid(rel)));
+	if (!HeapTupleIsValid(tuple))
+	{
+		rel->rd_partkey = NULL;
+		rel->rd_partdesc = NULL;
+		rel->rd_partvalid = true;
+		return;
+	}
+
+	/*
+	 * Build everything in a context of its own, which becomes a child of
+	 * CacheMemoryContext only once we're done, so that nothing is leaked if
+	 * we fail partway.
+	 */
+	cxt = AllocSetContextCreate(CurrentMemoryContext,
+								RelationGetRelationName(rel),
+								ALLOCSET_SMALL_MINSIZE,
+								ALLOCSET_SMALL_INITSIZE,
+								ALLOCSET_SMALL_MAXSIZE);
+
+	key = build_partition_key(rel, tuple, cxt);
+	ReleaseSysCache(tuple);
+
+	/* Collect the bounds of all the partitions */
+	ScanKeyInit(&skey,
+				Anum_pg_partition_partparent,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(RelationGetRelid(rel)));
+	partrel = heap_open(PartitionRelationId, AccessShareLock);
+	scan = systable_beginscan(partrel, PartitionParentIndexId, true,
+							  SnapshotNow, 1, &skey);
+	while (HeapTupleIsValid(tuple = systable_getnext(scan)))
+	{
+		Form_pg_partition form = (Form_pg_partition) GETSTRUCT(tuple);
+		Datum		datum;
+		bool		isnull;
+
+		datum = heap_getattr(tuple, Anum_pg_partition_partbound,
+							 RelationGetDescr(partrel), &isnull);
+		if (isnull)
+			elog(ERROR, "null partbound for partition %u", form->partrelid);
+
+		oids = lappend_oid(oids, form->partrelid);
+		bounds = lappend(bounds, stringToNode(TextDatumGetCString(datum)));
+	}
+	systable_endscan(scan);
+	heap_close(partrel, AccessShareLock);
+
+	pdesc = build_partition_desc(key, oids, bounds, cxt);
+
+	MemoryContextSetParent(cxt, CacheMemoryContext);
+	rel->rd_partcxt = cxt;
+	rel->rd_partkey = key;
+	rel->rd_partdesc = pdesc;
+	rel->rd_partvalid = true;
+}
+
+/*
+ * RelationGetPartitionKey
+ *		Return the partition key of a relation, or NULL if it isn't
+ *		partitioned.
+ *
+ * The result points into the relcache entry; it remains valid while the
+ * relation is open, unless the key is changed in the meantime.
+ */
+PartitionKey
+RelationGetPartitionKey(Relation rel)
+{
+	if (!rel->rd_partvalid)
+		RelationBuildPartitionInfo(rel);
+	return rel->rd_partkey;
+}
+
+/*
+ * RelationIsPartition
+ *		Is the relation a partition of some partitioned table?
+ */
+bool
+RelationIsPartition(Relation rel)
+{
+	if (!rel->rd_partvalid)
+		RelationBuildPartitionInfo(rel);
+	return OidIsValid(rel->rd_partparent);
+}
+
+/*
+ * RelationGetPartitionDesc
+ *		Return the partitions of a relation, or NULL if it isn't
+ *		partitioned.
+ *
+ * Adding or removing a partition requires AccessExclusiveLock on the parent,
+ * so the result is stable for as long as the caller holds any lock on it.
+ */
+PartitionDesc
+RelationGetPartitionDesc(Relation rel)
+{
+	if (!rel->rd_partvalid)
+		RelationBuildPartitionInfo(rel);
+	return rel->rd_partdesc;
+}
+
+/*
+ * build_partition_key
+ *		Build a PartitionKey in cxt from a pg_partitioned_table tuple.
+ */
+static PartitionKey
+build_partition_key(Relation rel, HeapTuple tuple, MemoryContext cxt)
+{
+	Form_pg_partitioned_table form;
+	PartitionKey key;
+	oidvector  *opclass;
+	oidvector  *collation;
+	Datum		datum;
+	bool		isnull;
+	int			natts;
+	int			i;
+
+	form = (Form_pg_partitioned_table) GETSTRUCT(tuple);
+	natts = form->partnatts;
+
+	datum = SysCacheGetAttr(PARTRELID, tuple,
+							Anum_pg_partitioned_table_partclass, &isnull);
+	Assert(!isnull);
+	opclass = (oidvector *) DatumGetPointer(datum);
+	datum = SysCacheGetAttr(PARTRELID, tuple,
+							Anum_pg_partitioned_table_partcollation, &isnull);
+	Assert(!isnull);
+	collation = (oidvector *) DatumGetPointer(datum);
+
+	key = (PartitionKey) MemoryContextAllocZero(cxt, sizeof(PartitionKeyData));
+	key->strategy = form->partstrat;
+	key->partnatts = natts;
+	key->partattrs = (AttrNumber *)
+		MemoryContextAlloc(cxt, natts * sizeof(AttrNumber));
+	key->partopfamily = (Oid *) MemoryContextAlloc(cxt, natts * sizeof(Oid));
+	key->partopcintype = (Oid *) MemoryContextAlloc(cxt, natts * sizeof(Oid));
+	key->partsupfunc = (FmgrInfo *)
+		MemoryContextAlloc(cxt, natts * sizeof(FmgrInfo));
+	key->partcollation = (Oid *) MemoryContextAlloc(cxt, natts * sizeof(Oid));
+	key->parttypid = (Oid *) MemoryContextAlloc(cxt, natts * sizeof(Oid));
+	key->parttypmod = (int32 *) MemoryContextAlloc(cxt, natts * sizeof(int32));
+	key->parttyplen = (int16 *) MemoryContextAlloc(cxt, natts * sizeof(int16));
+	key->parttypbyval = (bool *) MemoryContextAlloc(cxt, natts * sizeof(bool));
+
+	for (i = 0; i < natts; i++)
+	{
+		AttrNumber	attno = form->partattrs.values[i];
+		Form_pg_attribute att = rel->rd_att->attrs[attno - 1];
+		HeapTuple	opclasstup;
+		Form_pg_opclass opclassform;
+		Oid			funcid;
+
+		opclasstup = SearchSysCache1(CLAOID,
+									 ObjectIdGetDatum(opclass->values[i]));
+		if (!HeapTupleIsValid(opclasstup))
+			elog(ERROR, "cache lookup failed for opclass %u",
+				 opclass->values[i]);
+		opclassform = (Form_pg_opclass) GETSTRUCT(opclasstup);
+
+		key->partattrs[i] = attno;
+		key->partopfamily[i] = opclassform->opcfamily;
+		key->partopcintype[i] = opclassform->opcintype;
+
+		funcid = get_opfamily_proc(opclassform->opcfamily,
+								   opclassform->opcintype,
+								   opclassform->opcintype,
+								   BTORDER_PROC);
+		if (!OidIsValid(funcid))
+			elog(ERROR, "missing support function %d(%u,%u) in opfamily %u",
+				 BTORDER_PROC, opclassform->opcintype,
+				 opclassform->opcintype, opclassform->opcfamily);
+		fmgr_info_cxt(funcid, &key->partsupfunc[i], cxt);
+
+		ReleaseSysCache(opclasstup);
+
+		key->partcollation[i] = collation->values[i];
+		key->parttypid[i] = att->atttypid;
+		key->parttypmod[i] = att->atttypmod;
+		key->parttyplen[i] = att->attlen;
+		key->parttypbyval[i] = att->attbyval;
+	}
+
+	return key;
+}
+
+/*
+ * build_partition_desc
+ *		Build a PartitionDesc in cxt for the given partitions and bounds.
+ *
+ * oids and bounds are parallel lists.  The order of the partitions in the
+ * result is determined by the bounds (range) or the OIDs (list), so that
+ * equal sets of partitions always give equal descriptors.
+ */
+static PartitionDesc
+build_partition_desc(PartitionKey key, List *oids, List *bounds,
+					 MemoryContext cxt)
+{
+	PartitionDesc pdesc;
+	PartitionBoundInfo boundinfo;
+	int			nparts = list_length(oids);
+	Oid		   *inoids;
+	ListCell   *lc;
+	int			i;
+
+	pdesc = (PartitionDesc) MemoryContextAllocZero(cxt,
+												   sizeof(PartitionDescData));
+	boundinfo = (PartitionBoundInfo)
+		MemoryContextAllocZero(cxt, sizeof(PartitionBoundInfoData));
+	pdesc->nparts = nparts;
+	pdesc->oids = (Oid *) MemoryContextAlloc(cxt, Max(nparts, 1) * sizeof(Oid));
+	pdesc->boundinfo = boundinfo;
+	boundinfo->strategy = key->strategy;
+	boundinfo->null_index = -1;
+
+	inoids = (Oid *) palloc(Max(nparts, 1) * sizeof(Oid));
+	i = 0;
+	foreach(lc, oids)
+		inoids[i++] = lfirst_oid(lc);
+
+	if (key->strategy == PARTITION_STRATEGY_LIST)
+	{
+		PartitionListValue *values;
+		int		   *mapping;
+		int			ndatums = 0;
+		int			nvalues = 0;
+
+		/* Partitions are numbered in OID order */
+		memcpy(pdesc->oids, inoids, nparts * sizeof(Oid));
+		qsort(pdesc->oids, nparts, sizeof(Oid), partition_oid_cmp);
+		mapping = (int *) palloc(Max(nparts, 1) * sizeof(int));
+		for (i = 0; i < nparts; i++)
+		{
+			Oid		   *found;
+
+			found = (Oid *) bsearch(&inoids[i], pdesc->oids, nparts,
+									sizeof(Oid), partition_oid_cmp);
+			mapping[i] = found - pdesc->oids;
+		}
+
+		foreach(lc, bounds)
+			ndatums += list_length(((PartitionBoundSpec *) lfirst(lc))->listdatums);
+		values = (PartitionListValue *)
+			palloc(Max(ndatums, 1) * sizeof(PartitionListValue));
+
+		i = 0;
+		foreach(lc, bounds)
+		{
+			PartitionBoundSpec *spec = (PartitionBoundSpec *) lfirst(lc);
+			ListCell   *cell;
+
+			Assert(spec->strategy == PARTITION_STRATEGY_LIST);
+			foreach(cell, spec->listdatums)
+			{
+				Const	   *val = (Const *) lfirst(cell);
+
+				if (val->constisnull)
+					boundinfo->null_index = mapping[i];
+				else
+				{
+					values[nvalues].index = mapping[i];
+					values[nvalues].value = val->constvalue;
+					nvalues++;
+				}
+			}
+			i++;
+		}
+
+		qsort_arg(values, nvalues, sizeof(PartitionListValue),
+				  partition_list_value_cmp, key);
+
+		boundinfo->ndatums = nvalues;
+		boundinfo->datums = (Datum *)
+			MemoryContextAlloc(cxt, Max(nvalues, 1) * sizeof(Datum));
+		boundinfo->indexes = (int *)
+			MemoryContextAlloc(cxt, Max(nvalues, 1) * sizeof(int));
+		for (i = 0; i < nvalues; i++)
+		{
+			MemoryContext oldcxt = MemoryContextSwitchTo(cxt);
+
+			boundinfo->datums[i] = datumCopy(values[i].value,
+											 key->parttypbyval[0],
+											 key->parttyplen[0]);
+			boundinfo->indexes[i] = values[i].index;
+			MemoryContextSwitchTo(oldcxt);
+		}
+	}
+	else if (key->strategy == PARTITION_STRATEGY_RANGE)
+	{
+		PartitionRangeEntry *entries;
+		int			natts = key->partnatts;
+
+		entries = (PartitionRangeEntry *)
+			palloc(Max(nparts, 1) * sizeof(PartitionRangeEntry));
+		i = 0;
+		foreach(lc, bounds)
+		{
+			PartitionBoundSpec *spec = (PartitionBoundSpec *) lfirst(lc);
+
+			Assert(spec->strategy == PARTITION_STRATEGY_RANGE);
+			entries[i].index = i;
+			make_range_bound(key, spec->lowerdatums, &entries[i].lower);
+			make_range_bound(key, spec->upperdatums, &entries[i].upper);
+			i++;
+		}
+
+		qsort_arg(entries, nparts, sizeof(PartitionRangeEntry),
+				  partition_range_entry_cmp, key);
+
+		boundinfo->lower = (PartitionRangeBound *)
+			MemoryContextAlloc(cxt, Max(nparts, 1) * sizeof(PartitionRangeBound));
+		boundinfo->upper = (PartitionRangeBound *)
+			MemoryContextAlloc(cxt, Max(nparts, 1) * sizeof(PartitionRangeBound));
+		for (i = 0; i < nparts; i++)
+		{
+			PartitionRangeBound *src[2];
+			PartitionRangeBound *dst[2];
+			int			j;
+			int			k;
+
+			pdesc->oids[i] = inoids[entries[i].index];
+
+			src[0] = &entries[i].lower;
+			src[1] = &entries[i].upper;
+			dst[0] = &boundinfo->lower[i];
+			dst[1] = &boundinfo->upper[i];
+			for (j = 0; j < 2; j++)
+			{
+				MemoryContext oldcxt = MemoryContextSwitchTo(cxt);
+
+				dst[j]->datums = (Datum *) palloc(natts * sizeof(Datum));
+				dst[j]->kind = (PartitionRangeDatumKind *)
+					palloc(natts * sizeof(PartitionRangeDatumKind));
+				for (k = 0; k < natts; k++)
+				{
+					dst[j]->kind[k] = src[j]->kind[k];
+					if (src[j]->kind[k] == PARTITION_RANGE_DATUM_VALUE)
+						dst[j]->datums[k] = datumCopy(src[j]->datums[k],
+													  key->parttypbyval[k],
+													  key->parttyplen[k]);
+					else
+						dst[j]->datums[k] = (Datum) 0;
+				}
+				MemoryContextSwitchTo(oldcxt);
+			}
+		}
+	}
+	else
+		elog(ERROR, "unexpected partition strategy: %d", (int) key->strategy);
+
+	return pdesc;
+}
+
+/*
+ * make_range_bound
+ *		Convert a list of PartitionRangeDatums into a PartitionRangeBound.
+ *
+ * The datums are not copied.
+ */
+static void
+make_range_bound(PartitionKey key, List *datums, PartitionRangeBound *bound)
+{
+	ListCell   *lc;
+	int			i;
+
+	Assert(list_length(datums) == key->partnatts);
+
+	bound->datums = (Datum *) palloc(key->partnatts * sizeof(Datum));
+	bound->kind = (PartitionRangeDatumKind *)
+		palloc(key->partnatts * sizeof(PartitionRangeDatumKind));
+
+	i = 0;
+	foreach(lc, datums)
+	{
+		PartitionRangeDatum *datum = (PartitionRangeDatum *) lfirst(lc);
+
+		bound->kind[i] = datum->kind;
+		if (datum->kind == PARTITION_RANGE_DATUM_VALUE)
+			bound->datums[i] = ((Const *) datum->value)->constvalue;
+		else
+			bound->datums[i] = (Datum) 0;
+		i++;
+	}
+}
+
+/*
+ * partition_rbound_cmp
+ *		Compare a range bound with another bound, or with a key value if
+ *		kind2 is NULL.
+ *
+ * Since MINVALUE and MAXVALUE can only be followed by more of the same, two
+ * bounds having the same one of them in a column are equal.
+ */
+static int32
+partition_rbound_cmp(PartitionKey key, PartitionRangeBound *b1,
+					 Datum *datums2, PartitionRangeDatumKind *kind2)
+{
+	int			i;
+
+	for (i = 0; i < key->partnatts; i++)
+	{
+		PartitionRangeDatumKind k2;
+		int32		cmp;
+
+		k2 = kind2 ? kind2[i] : PARTITION_RANGE_DATUM_VALUE;
+		if (b1->kind[i] != PARTITION_RANGE_DATUM_VALUE ||
+			k2 != PARTITION_RANGE_DATUM_VALUE)
+		{
+			if (b1->kind[i] == k2)
+				return 0;
+			return (b1->kind[i] < k2) ? -1 : 1;
+		}
+
+		cmp = DatumGetInt32(FunctionCall2Coll(&key->partsupfunc[i],
+											  key->partcollation[i],
+											  b1->datums[i],
+											  datums2[i]));
+		if (cmp != 0)
+			return cmp;
+	}
+
+	return 0;
+}
+
+/* qsort/bsearch comparator for Oids */
+static int
+partition_oid_cmp(const void *a, const void *b)
+{
+	Oid			o1 = *(const Oid *) a;
+	Oid			o2 = *(const Oid *) b;
+
+	if (o1 < o2)
+		return -1;
+	if (o1 > o2)
+		return 1;
+	return 0;
+}
+
+/* qsort comparator for PartitionListValues */
+static int
+partition_list_value_cmp(const void *a, const void *b, void *arg)
+{
+	PartitionKey key = (PartitionKey) arg;
+	const PartitionListValue *v1 = (const PartitionListValue *) a;
+	const PartitionListValue *v2 = (const PartitionListValue *) b;
+
+	return DatumGetInt32(FunctionCall2Coll(&key->partsupfunc[0],
+										   key->partcollation[0],
+										   v1->value, v2->value));
+}
+
+/* qsort comparator for PartitionRangeEntrys, by lower bound */
+static int
+partition_range_entry_cmp(const void *a, const void *b, void *arg)
+{
+	PartitionKey key = (PartitionKey) arg;
+	PartitionRangeEntry *e1 = (PartitionRangeEntry *) a;
+	PartitionRangeEntry *e2 = (PartitionRangeEntry *) b;
+
+	return partition_rbound_cmp(key, &e1->lower,
+								e2->lower.datums, e2->lower.kind);
+}
+
+/*
+ * partition_list_bsearch
+ *		Return the index in boundinfo->datums of value, or -1
+ */
+static int
+partition_list_bsearch(PartitionKey key, PartitionBoundInfo boundinfo,
+					   Datum value)
+{
+	int			lo = 0;
+	int			hi = boundinfo->ndatums - 1;
+
+	while (lo <= hi)
+	{
+		int			mid = (lo + hi) / 2;
+		int32		cmp;
+
+		cmp = DatumGetInt32(FunctionCall2Coll(&key->partsupfunc[0],
+											  key->partcollation[0],
+											  boundinfo->datums[mid],
+											  value));
+		if (cmp == 0)
+			return mid;
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+
+	return -1;
+}
+
+/*
+ * equalPartitionInfo
+ *		Do two relcache entries have the same partitioning info?
+ *
+ * Both entries must have rd_partvalid set.
+ */
+bool
+equalPartitionInfo(Relation rel1, Relation rel2)
+{
+	PartitionKey key1 = rel1->rd_partkey;
+	PartitionKey key2 = rel2->rd_partkey;
+	PartitionDesc pdesc1 = rel1->rd_partdesc;
+	PartitionDesc pdesc2 = rel2->rd_partdesc;
+	PartitionBoundInfo b1;
+	PartitionBoundInfo b2;
+	int			natts;
+	int			i;
+	int			j;
+
+	Assert(rel1->rd_partvalid && rel2->rd_partvalid);
+
+	if (key1 == NULL || key2 == NULL)
+		return key1 == key2;
+
+	natts = key1->partnatts;
+	if (key1->strategy != key2->strategy ||
+		natts != key2->partnatts ||
+		memcmp(key1->partattrs, key2->partattrs,
+			   natts * sizeof(AttrNumber)) != 0 ||
+		memcmp(key1->partopfamily, key2->partopfamily,
+			   natts * sizeof(Oid)) != 0 ||
+		memcmp(key1->partopcintype, key2->partopcintype,
+			   natts * sizeof(Oid)) != 0 ||
+		memcmp(key1->partcollation, key2->partcollation,
+			   natts * sizeof(Oid)) != 0 ||
+		memcmp(key1->parttypid, key2->parttypid,
+			   natts * sizeof(Oid)) != 0 ||
+		memcmp(key1->parttypmod, key2->parttypmod,
+			   natts * sizeof(int32)) != 0)
+		return false;
+
+	if (pdesc1->nparts != pdesc2->nparts ||
+		memcmp(pdesc1->oids, pdesc2->oids,
+			   pdesc1->nparts * sizeof(Oid)) != 0)
+		return false;
+
+	b1 = pdesc1->boundinfo;
+	b2 = pdesc2->boundinfo;
+	if (key1->strategy == PARTITION_STRATEGY_LIST)
+	{
+		if (b1->ndatums != b2->ndatums || b1->null_index != b2->null_index)
+			return false;
+		for (i = 0; i < b1->ndatums; i++)
+		{
+			if (b1->indexes[i] != b2->indexes[i] ||
+				!datumIsEqual(b1->datums[i], b2->datums[i],
+							  key1->parttypbyval[0], key1->parttyplen[0]))
+				return false;
+		}
+	}
+	else
+	{
+		for (i = 0; i < pdesc1->nparts; i++)
+		{
+			PartitionRangeBound *r1[2];
+			PartitionRangeBound *r2[2];
+			int			k;
+
+			r1[0] = &b1->lower[i];
+			r1[1] = &b1->upper[i];
+			r2[0] = &b2->lower[i];
+			r2[1] = &b2->upper[i];
+			for (k = 0; k < 2; k++)
+			{
+				for (j = 0; j < natts; j++)
+				{
+					if (r1[k]->kind[j] != r2[k]->kind[j])
+						return false;
+					if (r1[k]->kind[j] == PARTITION_RANGE_DATUM_VALUE &&
+						!datumIsEqual(r1[k]->datums[j], r2[k]->datums[j],
+									  key1->parttypbyval[j],
+									  key1->parttyplen[j]))
+						return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+/*
+ * StorePartitionKey
+ *		Store the partition key of a relation in pg_partitioned_table.
+ */
+void
+StorePartitionKey(Relation rel, char strategy, int16 partnatts,
+				  AttrNumber *partattrs, Oid *partopclass,
+				  Oid *partcollation)
+{
+	Relation	pg_partitioned_table;
+	HeapTuple	tuple;
+	Datum		values[Natts_pg_partitioned_table];
+	bool		nulls[Natts_pg_partitioned_table];
+	int2vector *attrs_vec;
+	oidvector  *opclass_vec;
+	oidvector  *collation_vec;
+	ObjectAddress myself;
+	ObjectAddress referenced;
+	int			i;
+
+	attrs_vec = buildint2vector(partattrs, partnatts);
+	opclass_vec = buildoidvector(partopclass, partnatts);
+	collation_vec = buildoidvector(partcollation, partnatts);
+
+	MemSet(nulls, false, sizeof(nulls));
+	values[Anum_pg_partitioned_table_partrelid - 1] =
+		ObjectIdGetDatum(RelationGetRelid(rel));
+	values[Anum_pg_partitioned_table_partstrat - 1] = CharGetDatum(strategy);
+	values[Anum_pg_partitioned_table_partnatts - 1] = Int16GetDatum(partnatts);
+	values[Anum_pg_partitioned_table_partattrs - 1] = PointerGetDatum(attrs_vec);
+	values[Anum_pg_partitioned_table_partclass - 1] =
+		PointerGetDatum(opclass_vec);
+	values[Anum_pg_partitioned_table_partcollation - 1] =
+		PointerGetDatum(collation_vec);
+
+	pg_partitioned_table = heap_open(PartitionedRelationId, RowExclusiveLock);
+	tuple = heap_form_tuple(RelationGetDescr(pg_partitioned_table),
+							values, nulls);
+	simple_heap_insert(pg_partitioned_table, tuple);
+	CatalogUpdateIndexes(pg_partitioned_table, tuple);
+	heap_freetuple(tuple);
+	heap_close(pg_partitioned_table, RowExclusiveLock);
+
+	/* The key depends on its operator classes and collations */
+	myself.classId = RelationRelationId;
+	myself.objectId = RelationGetRelid(rel);
+	myself.objectSubId = 0;
+
+	for (i = 0; i < partnatts; i++)
+	{
+		referenced.classId = OperatorClassRelationId;
+		referenced.objectId = partopclass[i];
+		referenced.objectSubId = 0;
+		recordDependencyOn(&myself, &referenced, DEPENDENCY_NORMAL);
+
+		if (OidIsValid(partcollation[i]) &&
+			partcollation[i] != DEFAULT_COLLATION_OID)
+		{
+			referenced.classId = CollationRelationId;
+			referenced.objectId = partcollation[i];
+			referenced.objectSubId = 0;
+			recordDependencyOn(&myself, &referenced, DEPENDENCY_NORMAL);
+		}
+	}
+
+	CacheInvalidateRelcache(rel);
+}
+
+/*
+ * RemovePartitionKeyByRelId
+ *		Remove the pg_partitioned_table entry of a relation, if any.
+ */
+void
+RemovePartitionKeyByRelId(Oid relid)
+{
+	Relation	pg_partitioned_table;
+	HeapTuple	tuple;
+
+	tuple = SearchSysCache1(PARTRELID, ObjectIdGetDatum(relid));
+	if (!HeapTupleIsValid(tuple))
+		return;
+
+	pg_partitioned_table = heap_open(PartitionedRelationId, RowExclusiveLock);
+	simple_heap_delete(pg_partitioned_table, &tuple->t_self);
+	ReleaseSysCache(tuple);
+	heap_close(pg_partitioned_table, RowExclusiveLock);
+}
+
+/*
+ * StorePartitionBound
+ *		Record relid as a partition of parentId with the given bound.
+ *
+ * The bound must have been through transformPartitionBound.  The parent's
+ * relcache entry is invalidated, so that its partition descriptor gets
+ * rebuilt.
+ */
+void
+StorePartitionBound(Oid relid, Oid parentId, PartitionBoundSpec *bound)
+{
+	Relation	pg_partition;
+	HeapTuple	tuple;
+	Datum		values[Natts_pg_partition];
+	bool		nulls[Natts_pg_partition];
+
+	MemSet(nulls, false, sizeof(nulls));
+	values[Anum_pg_partition_partrelid - 1] = ObjectIdGetDatum(relid);
+	values[Anum_pg_partition_partparent - 1] = ObjectIdGetDatum(parentId);
+	values[Anum_pg_partition_partbound - 1] =
+		CStringGetTextDatum(nodeToString(bound));
+
+	pg_partition = heap_open(PartitionRelationId, RowExclusiveLock);
+	tuple = heap_form_tuple(RelationGetDescr(pg_partition), values, nulls);
+	simple_heap_insert(pg_partition, tuple);
+	CatalogUpdateIndexes(pg_partition, tuple);
+	heap_freetuple(tuple);
+	heap_close(pg_partition, RowExclusiveLock);
+
+	CacheInvalidateRelcacheByRelid(parentId);
+}
+
+/*
+ * RemovePartitionBoundByRelId
+ *		Remove the pg_partition entry of a relation, if any.
+ */
+void
+RemovePartitionBoundByRelId(Oid relid)
+{
+	Relation	pg_partition;
+	SysScanDesc scan;
+	ScanKeyData skey;
+	HeapTuple	tuple;
+
+	ScanKeyInit(&skey,
+				Anum_pg_partition_partrelid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(relid));
+
+	pg_partition = heap_open(PartitionRelationId, RowExclusiveLock);
+	scan = systable_beginscan(pg_partition, PartitionRelidIndexId, true,
+							  SnapshotNow, 1, &skey);
+	while (HeapTupleIsValid(tuple = systable_getnext(scan)))
+		simple_heap_delete(pg_partition, &tuple->t_self);
+	systable_endscan(scan);
+	heap_close(pg_partition, RowExclusiveLock);
+}
+
+/*
+ * get_partition_bound
+ *		Fetch the bound and parent of a partition.
+ *
+ * Returns NULL, and sets *parentId to InvalidOid, if relid is not a
+ * partition.
+ */
+static PartitionBoundSpec *
+get_partition_bound(Oid relid, Oid *parentId)
+{
+	Relation	pg_partition;
+	SysScanDesc scan;
+	ScanKeyData skey;
+	HeapTuple	tuple;
+	PartitionBoundSpec *bound = NULL;
+
+	*parentId = InvalidOid;
+
+	ScanKeyInit(&skey,
+				Anum_pg_partition_partrelid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(relid));
+
+	pg_partition = heap_open(PartitionRelationId, AccessShareLock);
+	scan = systable_beginscan(pg_partition, PartitionRelidIndexId, true,
+							  SnapshotNow, 1, &skey);
+	tuple = systable_getnext(scan);
+	if (HeapTupleIsValid(tuple))
+	{
+		Datum		datum;
+		bool		isnull;
+
+		*parentId = ((Form_pg_partition) GETSTRUCT(tuple))->partparent;
+		datum = heap_getattr(tuple, Anum_pg_partition_partbound,
+							 RelationGetDescr(pg_partition), &isnull);
+		if (isnull)
+			elog(ERROR, "null partbound for partition %u", relid);
+		bound = (PartitionBoundSpec *)
+			stringToNode(TextDatumGetCString(datum));
+	}
+	systable_endscan(scan);
+	heap_close(pg_partition, AccessShareLock);
+
+	return bound;
+}
+
+/*
+ * get_partition_parent
+ *		Return the OID of the partitioned table relid is a partition of,
+ *		or InvalidOid if it isn't a partition.
+ */
+Oid
+get_partition_parent(Oid relid)
+{
+	Relation	pg_partition;
+	SysScanDesc scan;
+	ScanKeyData skey;
+	HeapTuple	tuple;
+	Oid			result = InvalidOid;
+
+	ScanKeyInit(&skey,
+				Anum_pg_partition_partrelid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(relid));
+
+	pg_partition = heap_open(PartitionRelationId, AccessShareLock);
+	scan = systable_beginscan(pg_partition, PartitionRelidIndexId, true,
+							  SnapshotNow, 1, &skey);
+	tuple = systable_getnext(scan);
+	if (HeapTupleIsValid(tuple))
+		result = ((Form_pg_partition) GETSTRUCT(tuple))->partparent;
+	systable_endscan(scan);
+	heap_close(pg_partition, AccessShareLock);
+
+	return result;
+}
+
+/*
+ * is_partition_key_column
+ *		Is attnum one of the partition key columns of rel?
+ */
+bool
+is_partition_key_column(Relation rel, AttrNumber attnum)
+{
+	PartitionKey key = RelationGetPartitionKey(rel);
+	int			i;
+
+	if (key == NULL)
+		return false;
+	for (i = 0; i < key->partnatts; i++)
+	{
+		if (key->partattrs[i] == attnum)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * check_new_partition_bound
+ *		Check that a new partition's bound doesn't overlap any existing
+ *		partition of parent.
+ *
+ * The bound must have been through transformPartitionBound.
+ */
+void
+check_new_partition_bound(char *relname, Relation parent,
+						  PartitionBoundSpec *bound)
+{
+	PartitionKey key = RelationGetPartitionKey(parent);
+	PartitionDesc pdesc = RelationGetPartitionDesc(parent);
+	PartitionBoundInfo boundinfo = pdesc->boundinfo;
+	int			with = -1;
+
+	if (key->strategy == PARTITION_STRATEGY_LIST)
+	{
+		ListCell   *lc;
+
+		foreach(lc, bound->listdatums)
+		{
+			Const	   *val = (Const *) lfirst(lc);
+
+			if (val->constisnull)
+				with = boundinfo->null_index;
+			else
+			{
+				int			idx = partition_list_bsearch(key, boundinfo,
+														 val->constvalue);
+
+				if (idx >= 0)
+					with = boundinfo->indexes[idx];
+			}
+			if (with >= 0)
+				break;
+		}
+	}
+	else
+	{
+		PartitionRangeBound lower;
+		PartitionRangeBound upper;
+		int			i;
+
+		make_range_bound(key, bound->lowerdatums, &lower);
+		make_range_bound(key, bound->upperdatums, &upper);
+
+		if (partition_rbound_cmp(key, &lower, upper.datums, upper.kind) >= 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_OBJECT_DEFINITION),
+					 errmsg("empty range bound specified for partition \"%s\"",
+							relname)));
+
+		/* [l1, u1) and [l2, u2) overlap iff l1 < u2 and l2 < u1 */
+		for (i = 0; i < pdesc->nparts; i++)
+		{
+			if (partition_rbound_cmp(key, &lower, boundinfo->upper[i].datums,
+									 boundinfo->upper[i].kind) < 0 &&
+				partition_rbound_cmp(key, &boundinfo->lower[i], upper.datums,
+									 upper.kind) < 0)
+			{
+				with = i;
+				break;
+			}
+		}
+	}
+
+	if (with >= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_OBJECT_DEFINITION),
+				 errmsg("partition \"%s\" would overlap partition \"%s\"",
+						relname, get_rel_name(pdesc->oids[with]))));
+}
+
+/*
+ * get_partition_for_tuple
+ *		Find the partition that accepts the given partition key values.
+ *
+ * Returns the partition's index in pdesc, or -1 if there is none.
+ */
+int
+get_partition_for_tuple(PartitionKey key, PartitionDesc pdesc,
+						Datum *values, bool *isnull)
+{
+	PartitionBoundInfo boundinfo = pdesc->boundinfo;
+
+	if (key->strategy == PARTITION_STRATEGY_LIST)
+	{
+		int			idx;
+
+		if (isnull[0])
+			return boundinfo->null_index;
+		idx = partition_list_bsearch(key, boundinfo, values[0]);
+		return (idx >= 0) ? boundinfo->indexes[idx] : -1;
+	}
+	else
+	{
+		int			lo = 0;
+		int			hi = pdesc->nparts - 1;
+		int			result = -1;
+		int			i;
+
+		/* Range partitions never accept NULLs */
+		for (i = 0; i < key->partnatts; i++)
+		{
+			if (isnull[i])
+				return -1;
+		}
+
+		/* Find the last partition whose lower bound is <= the key */
+		while (lo <= hi)
+		{
+			int			mid = (lo + hi) / 2;
+
+			if (partition_rbound_cmp(key, &boundinfo->lower[mid],
+									 values, NULL) <= 0)
+			{
+				result = mid;
+				lo = mid + 1;
+			}
+			else
+				hi = mid - 1;
+		}
+
+		/* ... and check the key is below its upper bound */
+		if (result >= 0 &&
+			partition_rbound_cmp(key, &boundinfo->upper[result],
+								 values, NULL) > 0)
+			return result;
+		return -1;
+	}
+}
+
+/*
+ * copy_partition_key
+ *		Copy a PartitionKey into CurrentMemoryContext
+ */
+static PartitionKey
+copy_partition_key(PartitionKey fromkey)
+{
+	PartitionKey key;
+	int			natts = fromkey->partnatts;
+	int			i;
+
+	key = (PartitionKey) palloc(sizeof(PartitionKeyData));
+	key->strategy = fromkey->strategy;
+	key->partnatts = natts;
+
+#define COPY_KEY_ARRAY(fld, type) \
+	do { \
+		key->fld = (type *) palloc(natts * sizeof(type)); \
+		memcpy(key->fld, fromkey->fld, natts * sizeof(type)); \
+	} while (0)
+
+	COPY_KEY_ARRAY(partattrs, AttrNumber);
+	COPY_KEY_ARRAY(partopfamily, Oid);
+	COPY_KEY_ARRAY(partopcintype, Oid);
+	COPY_KEY_ARRAY(partcollation, Oid);
+	COPY_KEY_ARRAY(parttypid, Oid);
+	COPY_KEY_ARRAY(parttypmod, int32);
+	COPY_KEY_ARRAY(parttyplen, int16);
+	COPY_KEY_ARRAY(parttypbyval, bool);
+
+#undef COPY_KEY_ARRAY
+
+	key->partsupfunc = (FmgrInfo *) palloc(natts * sizeof(FmgrInfo));
+	for (i = 0; i < natts; i++)
+		fmgr_info_copy(&key->partsupfunc[i], &fromkey->partsupfunc[i],
+					   CurrentMemoryContext);
+
+	return key;
+}
+
+/*
+ * map_partition_key_attnos
+ *		Find the partition key columns of partitioned table keyrel among the
+ *		columns of rel, which is keyrel itself or one of its ancestors or
+ *		descendants in a partition tree.
+ *
+ * Columns are matched by name, since attribute numbers can differ between
+ * a partition and its parent.  Returns a palloc'd array of attribute
+ * numbers of rel, one per key column.
+ */
+AttrNumber *
+map_partition_key_attnos(Relation keyrel, Relation rel)
+{
+	PartitionKey key = RelationGetPartitionKey(keyrel);
+	AttrNumber *attnos;
+	int			i;
+
+	Assert(key != NULL);
+
+	attnos = (AttrNumber *) palloc(key->partnatts * sizeof(AttrNumber));
+	for (i = 0; i < key->partnatts; i++)
+	{
+		Form_pg_attribute att;
+
+		if (keyrel == rel)
+		{
+			attnos[i] = key->partattrs[i];
+			continue;
+		}
+
+		att = keyrel->rd_att->attrs[key->partattrs[i] - 1];
+		attnos[i] = get_attnum(RelationGetRelid(rel), NameStr(att->attname));
+		if (attnos[i] == InvalidAttrNumber)
+			elog(ERROR, "partition key column \"%s\" not found in relation \"%s\"",
+				 NameStr(att->attname), RelationGetRelationName(rel));
+	}
+
+	return attnos;
+}
+
+/*
+ * get_partition_check
+ *		Build the state needed to check that tuples belong in a partition.
+ *
+ * Returns NULL if rel is not a partition.  The result is allocated in
+ * CurrentMemoryContext.  The ancestors of rel are locked with
+ * AccessShareLock.
+ */
+PartitionCheck
+get_partition_check(Relation rel)
+{
+	PartitionCheck result = NULL;
+	Oid			relid = RelationGetRelid(rel);
+	Oid			parentId;
+	PartitionBoundSpec *bound;
+
+	bound = get_partition_bound(relid, &parentId);
+	while (bound != NULL)
+	{
+		Relation	parent = heap_open(parentId, AccessShareLock);
+		PartitionKey key = RelationGetPartitionKey(parent);
+		PartitionCheck check;
+
+		if (key == NULL)
+			elog(ERROR, "relation %u is not partitioned", parentId);
+
+		check = (PartitionCheck) palloc(sizeof(PartitionCheckData));
+		check->key = copy_partition_key(key);
+		check->pdesc = build_partition_desc(check->key,
+											list_make1_oid(relid),
+											list_make1(bound),
+											CurrentMemoryContext);
+
+		check->attnos = map_partition_key_attnos(parent, rel);
+
+		check->next = result;
+		result = check;
+
+		heap_close(parent, NoLock);
+
+		relid = parentId;
+		bound = get_partition_bound(relid, &parentId);
+	}
+
+	return result;
+}
+
+/*
+ * partition_check_tuple
+ *		Does the tuple in slot satisfy the partition's bounds?
+ */
+bool
+partition_check_tuple(PartitionCheck check, TupleTableSlot *slot)
+{
+	Datum		values[PARTITION_MAX_KEYS];
+	bool		isnull[PARTITION_MAX_KEYS];
+
+	for (; check != NULL; check = check->next)
+	{
+		int			i;
+
+		for (i = 0; i < check->key->partnatts; i++)
+			values[i] = slot_getattr(slot, check->attnos[i], &isnull[i]);
+
+		if (get_partition_for_tuple(check->key, check->pdesc,
+									values, isnull) != 0)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * get_partitions_for_strategy
+ *		Find the partitions that may contain rows for which
+ *		"keycol <op> value" holds, where op is the btree operator with the
+ *		given strategy in the key column's operator family.
+ *
+ * cmpproc is the btree comparison function of the family for the column's
+ * opclass input type on the left and the value's type on the right.  The
+ * result is a set of partition indexes, which may include partitions that
+ * turn out not to contain any matching rows.
+ *
+ * The bounds are kept sorted, so the matching list values, or the matching
+ * range partitions, are always a contiguous run that we find by binary
+ * search.
+ */
+Bitmapset *
+get_partitions_for_strategy(PartitionKey key, PartitionDesc pdesc, int keycol,
+							StrategyNumber strategy, Oid cmpproc, Datum value)
+{
+	PartitionBoundInfo boundinfo = pdesc->boundinfo;
+	Oid			collation = key->partcollation[keycol];
+	Bitmapset  *result = NULL;
+	FmgrInfo	cmpfn;
+	int			start;
+	int			end;
+	int			i;
+
+	if (strategy < BTLessStrategyNumber || strategy > BTGreaterStrategyNumber)
+		elog(ERROR, "unrecognized StrategyNumber: %d", (int) strategy);
+
+	/*
+	 * Only the first key column of a range partitioned table is ordered
+	 * across partitions; a restriction on any other column can't be used to
+	 * exclude any.
+	 */
+	if (key->strategy == PARTITION_STRATEGY_RANGE && keycol > 0)
+	{
+		for (i = 0; i < pdesc->nparts; i++)
+			result = bms_add_member(result, i);
+		return result;
+	}
+
+	fmgr_info(cmpproc, &cmpfn);
+
+	if (key->strategy == PARTITION_STRATEGY_LIST)
+	{
+		Assert(keycol == 0);
+
+		/* The values matching are datums[start .. end - 1] */
+		start = 0;
+		end = boundinfo->ndatums;
+		if (strategy == BTLessStrategyNumber ||
+			strategy == BTEqualStrategyNumber)
+			end = partition_list_boundary(&cmpfn, collation, boundinfo,
+										  value, false);
+		else if (strategy == BTLessEqualStrategyNumber)
+			end = partition_list_boundary(&cmpfn, collation, boundinfo,
+										  value, true);
+		if (strategy == BTGreaterEqualStrategyNumber)
+			start = partition_list_boundary(&cmpfn, collation, boundinfo,
+											value, false);
+		else if (strategy == BTGreaterStrategyNumber)
+			start = partition_list_boundary(&cmpfn, collation, boundinfo,
+											value, true);
+		if (strategy == BTEqualStrategyNumber)
+		{
+			start = end;
+			end = partition_list_boundary(&cmpfn, collation, boundinfo,
+										  value, true);
+		}
+
+		for (i = start; i < end; i++)
+			result = bms_add_member(result, boundinfo->indexes[i]);
+		return result;
+	}
+
+	/*
+	 * Range partitioning.  Since the partitions are sorted by their lower
+	 * bounds and don't overlap, both the lower and the upper bounds ascend,
+	 * and the partitions matching are partitions[start .. end - 1].  Those
+	 * before start lie entirely below the value, those from end on entirely
+	 * above it.
+	 */
+	start = 0;
+	end = pdesc->nparts;
+
+	if (strategy != BTGreaterStrategyNumber &&
+		strategy != BTGreaterEqualStrategyNumber)
+	{
+		int			lo = 0;
+		int			hi = pdesc->nparts;
+
+		while (lo < hi)
+		{
+			int			mid = (lo + hi) / 2;
+
+			if (range_lower_matches(key, &cmpfn, collation,
+									&boundinfo->lower[mid], strategy, value))
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		end = lo;
+	}
+
+	if (strategy != BTLessStrategyNumber &&
+		strategy != BTLessEqualStrategyNumber)
+	{
+		int			lo = 0;
+		int			hi = pdesc->nparts;
+
+		while (lo < hi)
+		{
+			int			mid = (lo + hi) / 2;
+
+			if (range_upper_matches(key, &cmpfn, collation,
+									&boundinfo->upper[mid], strategy, value))
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+		start = lo;
+	}
+
+	for (i = start; i < end; i++)
+		result = bms_add_member(result, i);
+
+	return result;
+}
+
+/*
+ * partition_list_boundary
+ *		Return the index of the first of the sorted list values that is
+ *		greater than value, or, if !strict, greater than or equal to it.
+ */
+static int
+partition_list_boundary(FmgrInfo *cmpfn, Oid collation,
+						PartitionBoundInfo boundinfo, Datum value,
+						bool strict)
+{
+	int			lo = 0;
+	int			hi = boundinfo->ndatums;
+
+	while (lo < hi)
+	{
+		int			mid = (lo + hi) / 2;
+		int32		cmp;
+
+		cmp = DatumGetInt32(FunctionCall2Coll(cmpfn, collation,
+											  boundinfo->datums[mid],
+											  value));
+		if (cmp > 0 || (!strict && cmp == 0))
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return lo;
+}
+
+/*
+ * range_lower_matches
+ *		Can the range partition with the given lower bound hold first-column
+ *		values below value (or equal to it, unless strategy is "<")?
+ */
+static bool
+range_lower_matches(PartitionKey key, FmgrInfo *cmpfn, Oid collation,
+					PartitionRangeBound *lower, StrategyNumber strategy,
+					Datum value)
+{
+	int32		cmp;
+
+	if (lower->kind[0] != PARTITION_RANGE_DATUM_VALUE)
+		cmp = (int32) lower->kind[0];
+	else
+		cmp = DatumGetInt32(FunctionCall2Coll(cmpfn, collation,
+											  lower->datums[0], value));
+
+	if (strategy == BTLessStrategyNumber)
+		return cmp < 0;
+	return cmp <= 0;
+}
+
+/*
+ * range_upper_matches
+ *		Can the range partition with the given upper bound hold first-column
+ *		values above value (or equal to it, unless strategy is ">")?
+ *
+ * The upper bound is exclusive, but when it has further columns that leave
+ * room above it, the partition can hold rows whose first column equals the
+ * bound's.
+ */
+static bool
+range_upper_matches(PartitionKey key, FmgrInfo *cmpfn, Oid collation,
+					PartitionRangeBound *upper, StrategyNumber strategy,
+					Datum value)
+{
+	int32		cmp;
+	bool		inclusive;
+
+	if (upper->kind[0] != PARTITION_RANGE_DATUM_VALUE)
+		cmp = (int32) upper->kind[0];
+	else
+		cmp = DatumGetInt32(FunctionCall2Coll(cmpfn, collation,
+											  upper->datums[0], value));
+
+	if (cmp > 0)
+		return true;
+	if (cmp < 0 || strategy == BTGreaterStrategyNumber)
+		return false;
+
+	inclusive = (key->partnatts > 1 &&
+				 upper->kind[0] == PARTITION_RANGE_DATUM_VALUE &&
+				 upper->kind[1] != PARTITION_RANGE_DATUM_MINVALUE);
+	return inclusive;
+}
+
+/*
+ * get_partitions_for_null
+ *		Find the partitions that may contain rows whose keycol is NULL.
+ */
+Bitmapset *
+get_partitions_for_null(PartitionKey key, PartitionDesc pdesc, int keycol)
+{
+	if (key->strategy == PARTITION_STRATEGY_LIST &&
+		pdesc->boundinfo->null_index >= 0)
+		return bms_make_singleton(pdesc->boundinfo->null_index);
+
+	/* range partitions never accept NULLs */
+	return NULL;
+}
@@ -42,6 +42,7 @@
 #include "storage/lmgr.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
+#include "storage/readstream.h"
 #include "utils/acl.h"
 #include "utils/attoptcache.h"
 #include "utils/datum.h"
@@ -91,6 +92,9 @@ static void BlockSampler_Init(BlockSampler bs, BlockNumber nblocks,
 				  int samplesize);
 static bool BlockSampler_HasMore(BlockSampler bs);
 static BlockNumber BlockSampler_Next(BlockSampler bs);
+static BlockNumber block_sampling_stream_next(ReadStream *stream,
+						   void *callback_private_data,
+						   void *per_buffer_data);
 static void compute_index_stats(Relation onerel, double totalrows,
 					AnlIndexData *indexdata, int nindexes,
 					HeapTuple *rows, int numrows,
@@ -577,13 +581,19 @@ do_analyze_rel(Relation onerel, VacuumStmt *vacstmt,
 	 * inherited stats.
 	 */
 	if (!inh)
+	{
+		BlockNumber relallvisible;
+
+		visibilitymap_count(onerel, &relallvisible, NULL);
+
 		vac_update_relstats(onerel,
 							relpages,
 							totalrows,
-							visibilitymap_count(onerel),
+							relallvisible,
 							hasindex,
 							InvalidTransactionId,
 							InvalidMultiXactId);
+	}
 
 	/*
 	 * Same for indexes. Vacuum always scans all indexes, so if we're part of
@@ -1028,6 +1038,20 @@ BlockSampler_Next(BlockSampler bs)
 	return bs->t++;
 }
 
+/*
+ * block_sampling_stream_next -- read stream callback returning the blocks
+ * chosen by a BlockSampler
+ */
+static BlockNumber
+block_sampling_stream_next(ReadStream *stream,
+						   void *callback_private_data,
+						   void *per_buffer_data)
+{
+	BlockSampler bs = (BlockSampler) callback_private_data;
+
+	return BlockSampler_HasMore(bs) ? BlockSampler_Next(bs) : InvalidBlockNumber;
+}
+
 /*
  * acquire_sample_rows -- acquire a random sample of rows from the table
  *
@@ -1075,6 +1099,8 @@ acquire_sample_rows(Relation onerel, int elevel,
 	TransactionId OldestXmin;
 	BlockSamplerData bs;
 	double		rstate;
+	ReadStream *stream;
+	Buffer		targbuffer;
 
 	Assert(targrows > 0);
 
@@ -1088,28 +1114,33 @@ acquire_sample_rows(Relation onerel, int elevel,
 	/* Prepare for sampling rows */
 	rstate = anl_init_selection_state(targrows);
 
-	/* Outer loop over blocks to sample */
-	while (BlockSampler_HasMore(&bs))
+	/*
+	 * The sampled blocks are read through a read stream, which prefetches
+	 * the blocks the sampler will pick next.
+	 */
+	stream = BeginReadStream(onerel, MAIN_FORKNUM, vac_strategy,
+							 block_sampling_stream_next, &bs, 0);
+
+	/*
+	 * Outer loop over blocks to sample
+	 *
+	 * We must maintain a pin on the target page's buffer to ensure that the
+	 * maxoffset value stays good (else concurrent VACUUM might delete tuples
+	 * out from under us).  Hence, pin the page until we are done looking at
+	 * it.  We also choose to hold sharelock on the buffer throughout --- we
+	 * could release and re-acquire sharelock for each tuple, but since we
+	 * aren't doing much work per tuple, the extra lock traffic is probably
+	 * better avoided.
+	 */
+	while (BufferIsValid(targbuffer = ReadStreamNextBuffer(stream, NULL)))
 	{
-		BlockNumber targblock = BlockSampler_Next(&bs);
-		Buffer		targbuffer;
+		BlockNumber targblock = BufferGetBlockNumber(targbuffer);
 		Page		targpage;
 		OffsetNumber targoffset,
 					maxoffset;
 
 		vacuum_delay_point();
 
-		/*
-		 * We must maintain a pin on the target page's buffer to ensure that
-		 * the maxoffset value stays good (else concurrent VACUUM might delete
-		 * tuples out from under us).  Hence, pin the page until we are done
-		 * looking at it.  We also choose to hold sharelock on the buffer
-		 * throughout --- we could release and re-acquire sharelock for each
-		 * tuple, but since we aren't doing much work per tuple, the extra
-		 * lock traffic is probably better avoided.
-		 */
-		targbuffer = ReadBufferExtended(onerel, MAIN_FORKNUM, targblock,
-										RBM_NORMAL, vac_strategy);
 		LockBuffer(targbuffer, BUFFER_LOCK_SHARE);
 		targpage = BufferGetPage(targbuffer);
 		maxoffset = PageGetMaxOffsetNumber(targpage);
@@ -1260,6 +1291,8 @@ acquire_sample_rows(Relation onerel, int elevel,
 		UnlockReleaseBuffer(targbuffer);
 	}
 
+	EndReadStream(stream);
+
 	/*
 	 * If we didn't find as many tuples as we wanted then we're done. No sort
 	 * is needed, since they're already in order.
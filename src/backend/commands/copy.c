@@ -29,6 +29,7 @@
 #include "commands/copy.h"
 #include "commands/defrem.h"
 #include "commands/trigger.h"
+#include "executor/execPartition.h"
 #include "executor/executor.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
@@ -2000,6 +2001,9 @@ CopyFrom(CopyState cstate)
 	Datum	   *values;
 	bool	   *nulls;
 	ResultRelInfo *resultRelInfo;
+	ResultRelInfo *rootRelInfo;
+	PartitionTupleRouting *proute = NULL;
+	bool		partitioned;
 	EState	   *estate = CreateExecutorState(); /* for ExecConstraints() */
 	ExprContext *econtext;
 	TupleTableSlot *myslot;
@@ -2050,6 +2054,7 @@ CopyFrom(CopyState cstate)
 	}
 
 	tupDesc = RelationGetDescr(cstate->rel);
+	partitioned = (RelationGetPartitionKey(cstate->rel) != NULL);
 
 	/*----------
 	 * Check to see if we can avoid writing WAL
@@ -2084,11 +2089,15 @@ CopyFrom(CopyState cstate)
 	 * go into pages containing tuples from any other transactions --- but this
 	 * must be the case if we have a new table or new relfilenode, so we need
 	 * no additional work to enforce that.
+	 *
+	 * None of this applies to a partitioned table, whose rows are stored in
+	 * its partitions rather than in the table itself.
 	 *----------
 	 */
 	/* createSubid is creation check, newRelfilenodeSubid is truncation check */
-	if (cstate->rel->rd_createSubid != InvalidSubTransactionId ||
-		cstate->rel->rd_newRelfilenodeSubid != InvalidSubTransactionId)
+	if (!partitioned &&
+		(cstate->rel->rd_createSubid != InvalidSubTransactionId ||
+		 cstate->rel->rd_newRelfilenodeSubid != InvalidSubTransactionId))
 	{
 		hi_options |= HEAP_INSERT_SKIP_FSM;
 		if (!XLogIsNeeded())
@@ -2105,6 +2114,11 @@ CopyFrom(CopyState cstate)
 	 */
 	if (cstate->freeze)
 	{
+		if (partitioned)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("cannot perform FREEZE on a partitioned table")));
+
 		if (!ThereAreNoPriorRegisteredSnapshots() || !ThereAreNoReadyPortals())
 			ereport(ERROR,
 					(ERRCODE_INVALID_TRANSACTION_STATE,
@@ -2135,6 +2149,14 @@ CopyFrom(CopyState cstate)
 	estate->es_result_relations = resultRelInfo;
 	estate->es_num_result_relations = 1;
 	estate->es_result_relation_info = resultRelInfo;
+	rootRelInfo = resultRelInfo;
+
+	/*
+	 * If the table is partitioned, each tuple is stored in one of its leaf
+	 * partitions, which then becomes the current result relation.
+	 */
+	if (partitioned)
+		proute = ExecSetupPartitionTupleRouting(rootRelInfo, estate);
 
 	/* Set up a tuple slot too */
 	myslot = ExecInitExtraTupleSlot(estate);
@@ -2149,12 +2171,14 @@ CopyFrom(CopyState cstate)
 	 * BEFORE/INSTEAD OF triggers, or we need to evaluate volatile default
 	 * expressions. Such triggers or expressions might query the table we're
 	 * inserting to, and act differently if the tuples that have already been
-	 * processed and prepared for insertion are not there.
+	 * processed and prepared for insertion are not there.  Nor do we buffer
+	 * tuples routed to partitions, since consecutive tuples may well go to
+	 * different partitions.
 	 */
 	if ((resultRelInfo->ri_TrigDesc != NULL &&
 		 (resultRelInfo->ri_TrigDesc->trig_insert_before_row ||
 		  resultRelInfo->ri_TrigDesc->trig_insert_instead_row)) ||
-		cstate->volatile_defexprs)
+		cstate->volatile_defexprs || partitioned)
 	{
 		useHeapMultiInsert = false;
 	}
@@ -2178,7 +2202,11 @@ CopyFrom(CopyState cstate)
 	values = (Datum *) palloc(tupDesc->natts * sizeof(Datum));
 	nulls = (bool *) palloc(tupDesc->natts * sizeof(bool));
 
-	bistate = GetBulkInsertState();
+	/*
+	 * A BulkInsertState remembers a buffer of a single relation, so it can't
+	 * be used while routing tuples to several partitions.
+	 */
+	bistate = partitioned ? NULL : GetBulkInsertState();
 	econtext = GetPerTupleExprContext(estate);
 
 	/* Set up callback to identify error line number */
@@ -2224,6 +2252,19 @@ CopyFrom(CopyState cstate)
 		slot = myslot;
 		ExecStoreTuple(tuple, slot, InvalidBuffer, false);
 
+		/* Route the tuple to its partition, if the table is partitioned */
+		if (proute)
+		{
+			int			leaf;
+
+			leaf = ExecFindPartition(rootRelInfo, proute, slot, estate);
+			resultRelInfo = &proute->partitions[leaf];
+			estate->es_result_relation_info = resultRelInfo;
+
+			slot = ExecConvertToPartition(proute, leaf, slot);
+			tuple = ExecMaterializeSlot(slot);
+		}
+
 		skip_tuple = false;
 
 		/* BEFORE ROW INSERT Triggers */
@@ -2241,8 +2282,10 @@ CopyFrom(CopyState cstate)
 		if (!skip_tuple)
 		{
 			/* Check the constraints of the tuple */
-			if (cstate->rel->rd_att->constr)
+			if (resultRelInfo->ri_RelationDesc->rd_att->constr)
 				ExecConstraints(resultRelInfo, slot, estate);
+			if (resultRelInfo->ri_CheckPartition)
+				ExecPartitionCheck(resultRelInfo, slot, estate);
 
 			if (useHeapMultiInsert)
 			{
@@ -2274,7 +2317,8 @@ CopyFrom(CopyState cstate)
 				List	   *recheckIndexes = NIL;
 
 				/* OK, store the tuple and create index entries for it */
-				heap_insert(cstate->rel, tuple, mycid, hi_options, bistate);
+				heap_insert(resultRelInfo->ri_RelationDesc, tuple, mycid,
+							hi_options, bistate);
 
 				if (resultRelInfo->ri_NumIndices > 0)
 					recheckIndexes = ExecInsertIndexTuples(slot, &(tuple->t_self),
@@ -2306,12 +2350,15 @@ CopyFrom(CopyState cstate)
 	/* Done, clean up */
 	error_context_stack = errcallback.previous;
 
-	FreeBulkInsertState(bistate);
+	if (bistate)
+		FreeBulkInsertState(bistate);
 
 	MemoryContextSwitchTo(oldcontext);
 
+	estate->es_result_relation_info = rootRelInfo;
+
 	/* Execute AFTER STATEMENT insertion triggers */
-	ExecASInsertTriggers(estate, resultRelInfo);
+	ExecASInsertTriggers(estate, rootRelInfo);
 
 	/* Handle queued AFTER triggers */
 	AfterTriggerEndQuery(estate);
@@ -2321,7 +2368,10 @@ CopyFrom(CopyState cstate)
 
 	ExecResetTupleTable(estate->es_tupleTable, false);
 
-	ExecCloseIndices(resultRelInfo);
+	if (proute)
+		ExecCleanupTupleRouting(proute);
+
+	ExecCloseIndices(rootRelInfo);
 
 	FreeExecutorState(estate);
 
@@ -74,13 +74,18 @@ static void show_upper_qual(List *qual, const char *qlabel,
 				ExplainState *es);
 static void show_sort_keys(SortState *sortstate, List *ancestors,
 			   ExplainState *es);
+static void show_incremental_sort_keys(IncrementalSortState *incrsortstate,
+						   List *ancestors, ExplainState *es);
 static void show_merge_append_keys(MergeAppendState *mstate, List *ancestors,
 					   ExplainState *es);
-static void show_sort_keys_common(PlanState *planstate,
+static void show_sort_keys_common(PlanState *planstate, const char *qlabel,
 					  int nkeys, AttrNumber *keycols,
 					  List *ancestors, ExplainState *es);
 static void show_sort_info(SortState *sortstate, ExplainState *es);
+static void show_incremental_sort_info(IncrementalSortState *incrsortstate,
+						   ExplainState *es);
 static void show_hash_info(HashState *hashstate, ExplainState *es);
+static void show_hashagg_info(AggState *aggstate, ExplainState *es);
 static void show_instrumentation_count(const char *qlabel, int which,
 						   PlanState *planstate, ExplainState *es);
 static void show_foreignscan_info(ForeignScanState *fsstate, ExplainState *es);
@@ -862,7 +867,10 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			sname = "Hash Join";
 			break;
 		case T_SeqScan:
-			pname = sname = "Seq Scan";
+			if (plan->parallel_aware)
+				pname = sname = "Parallel Seq Scan";
+			else
+				pname = sname = "Seq Scan";
 			break;
 		case T_IndexScan:
 			pname = sname = "Index Scan";
@@ -903,6 +911,9 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_Sort:
 			pname = sname = "Sort";
 			break;
+		case T_IncrementalSort:
+			pname = sname = "Incremental Sort";
+			break;
 		case T_Group:
 			pname = sname = "Group";
 			break;
@@ -958,6 +969,9 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_Limit:
 			pname = sname = "Limit";
 			break;
+		case T_Gather:
+			pname = sname = "Gather";
+			break;
 		case T_Hash:
 			pname = sname = "Hash";
 			break;
@@ -1329,6 +1343,12 @@ ExplainNode(PlanState *planstate, List *ancestors,
 										   planstate, es);
 			break;
 		case T_Agg:
+			show_upper_qual(plan->qual, "Filter", planstate, ancestors, es);
+			if (plan->qual)
+				show_instrumentation_count("Rows Removed by Filter", 1,
+										   planstate, es);
+			show_hashagg_info((AggState *) planstate, es);
+			break;
 		case T_Group:
 			show_upper_qual(plan->qual, "Filter", planstate, ancestors, es);
 			if (plan->qual)
@@ -1339,6 +1359,12 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			show_sort_keys((SortState *) planstate, ancestors, es);
 			show_sort_info((SortState *) planstate, es);
 			break;
+		case T_IncrementalSort:
+			show_incremental_sort_keys((IncrementalSortState *) planstate,
+									   ancestors, es);
+			show_incremental_sort_info((IncrementalSortState *) planstate,
+									   es);
+			break;
 		case T_MergeAppend:
 			show_merge_append_keys((MergeAppendState *) planstate,
 								   ancestors, es);
@@ -1357,6 +1383,10 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_Hash:
 			show_hash_info((HashState *) planstate, es);
 			break;
+		case T_Gather:
+			ExplainPropertyInteger("Number of Workers",
+								   ((Gather *) plan)->num_workers, es);
+			break;
 		default:
 			break;
 	}
@@ -1681,11 +1711,29 @@ show_sort_keys(SortState *sortstate, List *ancestors, ExplainState *es)
 {
 	Sort	   *plan = (Sort *) sortstate->ss.ps.plan;
 
-	show_sort_keys_common((PlanState *) sortstate,
+	show_sort_keys_common((PlanState *) sortstate, "Sort Key",
 						  plan->numCols, plan->sortColIdx,
 						  ancestors, es);
 }
 
+/*
+ * Likewise, for an IncrementalSort node; we also show which of the keys
+ * the input is already sorted by.
+ */
+static void
+show_incremental_sort_keys(IncrementalSortState *incrsortstate,
+						   List *ancestors, ExplainState *es)
+{
+	IncrementalSort *plan = (IncrementalSort *) incrsortstate->ss.ps.plan;
+
+	show_sort_keys_common((PlanState *) incrsortstate, "Sort Key",
+						  plan->sort.numCols, plan->sort.sortColIdx,
+						  ancestors, es);
+	show_sort_keys_common((PlanState *) incrsortstate, "Presorted Key",
+						  plan->presortedCols, plan->sort.sortColIdx,
+						  ancestors, es);
+}
+
 /*
  * Likewise, for a MergeAppend node.
  */
@@ -1695,13 +1743,14 @@ show_merge_append_keys(MergeAppendState *mstate, List *ancestors,
 {
 	MergeAppend *plan = (MergeAppend *) mstate->ps.plan;
 
-	show_sort_keys_common((PlanState *) mstate,
+	show_sort_keys_common((PlanState *) mstate, "Sort Key",
 						  plan->numCols, plan->sortColIdx,
 						  ancestors, es);
 }
 
 static void
-show_sort_keys_common(PlanState *planstate, int nkeys, AttrNumber *keycols,
+show_sort_keys_common(PlanState *planstate, const char *qlabel,
+					  int nkeys, AttrNumber *keycols,
 					  List *ancestors, ExplainState *es)
 {
 	Plan	   *plan = planstate->plan;
@@ -1736,7 +1785,7 @@ show_sort_keys_common(PlanState *planstate, int nkeys, AttrNumber *keycols,
 		result = lappend(result, exprstr);
 	}
 
-	ExplainPropertyList("Sort Key", result, es);
+	ExplainPropertyList(qlabel, result, es);
 }
 
 /*
@@ -1771,6 +1820,19 @@ show_sort_info(SortState *sortstate, ExplainState *es)
 	}
 }
 
+/*
+ * If it's EXPLAIN ANALYZE, show the number of batches an incremental sort
+ * divided its input into
+ */
+static void
+show_incremental_sort_info(IncrementalSortState *incrsortstate,
+						   ExplainState *es)
+{
+	Assert(IsA(incrsortstate, IncrementalSortState));
+	if (es->analyze)
+		ExplainPropertyLong("Sort Batches", incrsortstate->nbatches, es);
+}
+
 /*
  * Show information on hash buckets/batches.
  */
@@ -1813,6 +1875,34 @@ show_hash_info(HashState *hashstate, ExplainState *es)
 	}
 }
 
+/*
+ * Show information on hash aggregate batches and memory usage.
+ */
+static void
+show_hashagg_info(AggState *aggstate, ExplainState *es)
+{
+	Agg		   *agg = (Agg *) aggstate->ss.ps.plan;
+	long		spacePeakKb = (aggstate->hash_mem_peak + 1023) / 1024;
+
+	Assert(IsA(aggstate, AggState));
+
+	if (agg->aggstrategy != AGG_HASHED || aggstate->hash_batches_used == 0)
+		return;
+
+	if (es->format != EXPLAIN_FORMAT_TEXT)
+	{
+		ExplainPropertyLong("Hash Batches", aggstate->hash_batches_used, es);
+		ExplainPropertyLong("Peak Memory Usage", spacePeakKb, es);
+	}
+	else
+	{
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str,
+						 "Batches: %d  Memory Usage: %ldkB\n",
+						 aggstate->hash_batches_used, spacePeakKb);
+	}
+}
+
 /*
  * If it's EXPLAIN ANALYZE, show instrumentation information for a plan node
  *
@@ -29,6 +29,8 @@
 #include "catalog/indexing.h"
 #include "catalog/namespace.h"
 #include "catalog/objectaccess.h"
+#include "catalog/partition.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_constraint.h"
 #include "catalog/pg_depend.h"
@@ -262,11 +264,15 @@ struct DropRelationCallbackState
 
 static void truncate_check_rel(Relation rel);
 static List *MergeAttributes(List *schema, List *supers, char relpersistence,
-				List **supOids, List **supconstr, int *supOidCount);
+				bool is_partition, List **supOids, List **supconstr,
+				int *supOidCount);
 static bool MergeCheckConstraint(List *constraints, char *name, Node *expr);
 static void MergeAttributesIntoExisting(Relation child_rel, Relation parent_rel);
 static void MergeConstraintsIntoExisting(Relation child_rel, Relation parent_rel);
 static void StoreCatalogInheritance(Oid relationId, List *supers);
+static int ComputePartitionAttrs(Relation rel, PartitionSpec *spec,
+					  char *strategy, AttrNumber *partattrs,
+					  Oid *partopclass, Oid *partcollation);
 static void StoreCatalogInheritance1(Oid relationId, Oid parentOid,
 						 int16 seqNumber, Relation inhRelation);
 static int	findAttrByName(const char *attributeName, List *schema);
@@ -448,6 +454,8 @@ DefineRelation(CreateStmt *stmt, char relkind, Oid ownerId)
 	AttrNumber	attnum;
 	static char *validnsps[] = HEAP_RELOPT_NAMESPACES;
 	Oid			ofTypeId;
+	Oid			parentId = InvalidOid;
+	PartitionBoundSpec *bound = NULL;
 
 	/*
 	 * Truncate relname to appropriate length (probably a waste of time, as
@@ -545,14 +553,39 @@ DefineRelation(CreateStmt *stmt, char relkind, Oid ownerId)
 	else
 		ofTypeId = InvalidOid;
 
+	/*
+	 * Adding a partition changes the parent's partition descriptor, so lock
+	 * out everyone else who might be using it.  Do this before
+	 * MergeAttributes takes a weaker lock.
+	 */
+	if (stmt->partbound)
+		parentId = RangeVarGetRelid((RangeVar *) linitial(stmt->inhRelations),
+									AccessExclusiveLock, false);
+
 	/*
 	 * Look up inheritance ancestors and generate relation schema, including
 	 * inherited attributes.
 	 */
 	schema = MergeAttributes(schema, stmt->inhRelations,
 							 stmt->relation->relpersistence,
+							 stmt->partbound != NULL,
 							 &inheritOids, &old_constraints, &parentOidCount);
 
+	/*
+	 * Check the partition bound against the parent's key and its existing
+	 * partitions.
+	 */
+	if (stmt->partbound)
+	{
+		Relation	parent = heap_open(parentId, NoLock);
+		ParseState *pstate = make_parsestate(NULL);
+
+		bound = transformPartitionBound(pstate, parent, stmt->partbound);
+		check_new_partition_bound(relname, parent, bound);
+		free_parsestate(pstate);
+		heap_close(parent, NoLock);
+	}
+
 	/*
 	 * Create a tuple descriptor from the relation schema.	Note that this
 	 * deals with column names, types, and NOT NULL constraints, but not
@@ -647,6 +680,10 @@ DefineRelation(CreateStmt *stmt, char relkind, Oid ownerId)
 	/* Store inheritance information for new rel. */
 	StoreCatalogInheritance(relationId, inheritOids);
 
+	/* ... and the partition bound, if it's a partition */
+	if (bound)
+		StorePartitionBound(relationId, parentId, bound);
+
 	/*
 	 * We must bump the command counter to make the newly-created relation
 	 * tuple visible for opening.
@@ -674,6 +711,27 @@ DefineRelation(CreateStmt *stmt, char relkind, Oid ownerId)
 		AddRelationNewConstraints(rel, rawDefaults, stmt->constraints,
 								  true, true, false);
 
+	/* Store the partition key, if the new relation is partitioned */
+	if (stmt->partspec)
+	{
+		char		strategy;
+		int			partnatts;
+		AttrNumber	partattrs[PARTITION_MAX_KEYS];
+		Oid			partopclass[PARTITION_MAX_KEYS];
+		Oid			partcollation[PARTITION_MAX_KEYS];
+
+		if (relkind != RELKIND_RELATION)
+			ereport(ERROR,
+					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+					 errmsg("only tables can be partitioned")));
+
+		partnatts = ComputePartitionAttrs(rel, stmt->partspec, &strategy,
+										  partattrs, partopclass,
+										  partcollation);
+		StorePartitionKey(rel, strategy, partnatts, partattrs, partopclass,
+						  partcollation);
+	}
+
 	/*
 	 * Clean up.  We keep lock on new relation (although it shouldn't be
 	 * visible to anyone else anyway, until commit).
@@ -683,6 +741,121 @@ DefineRelation(CreateStmt *stmt, char relkind, Oid ownerId)
 	return relationId;
 }
 
+/*
+ * ComputePartitionAttrs
+ *		Look up the columns, operator classes and collations of the
+ *		partition key given by a PARTITION BY clause.
+ *
+ * Returns the number of key columns; the strategy and per-column details are
+ * returned in the output arguments, which must have room for
+ * PARTITION_MAX_KEYS entries.
+ */
+static int
+ComputePartitionAttrs(Relation rel, PartitionSpec *spec, char *strategy,
+					  AttrNumber *partattrs, Oid *partopclass,
+					  Oid *partcollation)
+{
+	int			natts = 0;
+	ListCell   *lc;
+
+	if (pg_strcasecmp(spec->strategy, "list") == 0)
+		*strategy = PARTITION_STRATEGY_LIST;
+	else if (pg_strcasecmp(spec->strategy, "range") == 0)
+		*strategy = PARTITION_STRATEGY_RANGE;
+	else
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("unrecognized partitioning strategy \"%s\"",
+						spec->strategy)));
+
+	if (*strategy == PARTITION_STRATEGY_LIST &&
+		list_length(spec->partParams) != 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+				 errmsg("cannot use \"list\" partition strategy with more than one column")));
+
+	if (list_length(spec->partParams) > PARTITION_MAX_KEYS)
+		ereport(ERROR,
+				(errcode(ERRCODE_TOO_MANY_COLUMNS),
+				 errmsg("cannot partition using more than %d columns",
+						PARTITION_MAX_KEYS)));
+
+	foreach(lc, spec->partParams)
+	{
+		PartitionElem *pelem = (PartitionElem *) lfirst(lc);
+		HeapTuple	atttuple;
+		Form_pg_attribute attform;
+		Oid			atttype;
+		Oid			attcollation;
+		int			i;
+
+		atttuple = SearchSysCacheAttName(RelationGetRelid(rel), pelem->name);
+		if (!HeapTupleIsValid(atttuple))
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_COLUMN),
+					 errmsg("column \"%s\" named in partition key does not exist",
+							pelem->name)));
+		attform = (Form_pg_attribute) GETSTRUCT(atttuple);
+
+		if (attform->attnum <= 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+					 errmsg("cannot use system column \"%s\" in partition key",
+							pelem->name)));
+
+		partattrs[natts] = attform->attnum;
+		atttype = attform->atttypid;
+		attcollation = attform->attcollation;
+		ReleaseSysCache(atttuple);
+
+		for (i = 0; i < natts; i++)
+		{
+			if (partattrs[i] == partattrs[natts])
+				ereport(ERROR,
+						(errcode(ERRCODE_DUPLICATE_COLUMN),
+						 errmsg("column \"%s\" appears more than once in partition key",
+								pelem->name)));
+		}
+
+		if (pelem->collation)
+			partcollation[natts] = get_collation_oid(pelem->collation, false);
+		else
+			partcollation[natts] = attcollation;
+		if (OidIsValid(partcollation[natts]) && !type_is_collatable(atttype))
+			ereport(ERROR,
+					(errcode(ERRCODE_DATATYPE_MISMATCH),
+					 errmsg("collations are not supported by type %s",
+							format_type_be(atttype))));
+
+		if (pelem->opclass == NIL)
+		{
+			partopclass[natts] = GetDefaultOpClass(atttype, BTREE_AM_OID);
+			if (!OidIsValid(partopclass[natts]))
+				ereport(ERROR,
+						(errcode(ERRCODE_UNDEFINED_OBJECT),
+						 errmsg("data type %s has no default btree operator class",
+								format_type_be(atttype)),
+						 errhint("You must specify a btree operator class or define a default btree operator class for the data type.")));
+		}
+		else
+		{
+			partopclass[natts] = get_opclass_oid(BTREE_AM_OID,
+												 pelem->opclass, false);
+			if (!IsBinaryCoercible(atttype,
+								   get_opclass_input_type(partopclass[natts])))
+				ereport(ERROR,
+						(errcode(ERRCODE_DATATYPE_MISMATCH),
+						 errmsg("operator class \"%s\" of access method %s does not accept data type %s",
+								NameListToString(pelem->opclass), "btree",
+								format_type_be(atttype))));
+		}
+
+		natts++;
+	}
+
+	return natts;
+}
+
 /*
  * Emit the right error or warning message for a "DROP" command issued on a
  * non-existent relation
@@ -1350,7 +1523,8 @@ storage_name(char c)
  */
 static List *
 MergeAttributes(List *schema, List *supers, char relpersistence,
-				List **supOids, List **supconstr, int *supOidCount)
+				bool is_partition, List **supOids, List **supconstr,
+				int *supOidCount)
 {
 	ListCell   *entry;
 	List	   *inhSchema = NIL;
@@ -1481,6 +1655,31 @@ MergeAttributes(List *schema, List *supers, char relpersistence,
 					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
 					 errmsg("cannot inherit from temporary relation of another session")));
 
+		/*
+		 * A partitioned table can only be inherited from by its partitions;
+		 * and since any session may route rows to a partition, a temporary
+		 * one is only allowed for a temporary parent.
+		 */
+		if (is_partition)
+		{
+			if (RelationGetPartitionKey(relation) == NULL)
+				ereport(ERROR,
+						(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+						 errmsg("\"%s\" is not partitioned",
+								parent->relname)));
+			if (relpersistence == RELPERSISTENCE_TEMP &&
+				relation->rd_rel->relpersistence != RELPERSISTENCE_TEMP)
+				ereport(ERROR,
+						(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+						 errmsg("cannot create a temporary relation as partition of permanent relation \"%s\"",
+								parent->relname)));
+		}
+		else if (RelationGetPartitionKey(relation) != NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+					 errmsg("cannot inherit from partitioned table \"%s\"",
+							parent->relname)));
+
 		/*
 		 * We should have an UNDER permission flag for this, but for now,
 		 * demand that creator of a child table own the parent.
@@ -5319,6 +5518,12 @@ ATExecDropColumn(List **wqueue, Relation rel, const char *colName,
 				 errmsg("cannot drop inherited column \"%s\"",
 						colName)));
 
+	/* Don't drop columns used in the partition key */
+	if (is_partition_key_column(rel, attnum))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+				 errmsg("cannot drop column named in partition key")));
+
 	ReleaseSysCache(tuple);
 
 	/*
@@ -7254,6 +7459,12 @@ ATPrepAlterColumnType(List **wqueue,
 				 errmsg("cannot alter inherited column \"%s\"",
 						colName)));
 
+	/* Don't alter columns used in the partition key */
+	if (is_partition_key_column(rel, attnum))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+				 errmsg("cannot alter type of column named in partition key")));
+
 	/* Look up the target type */
 	typenameTypeIdAndMod(NULL, typeName, &targettype, &targettypmod);
 
@@ -9069,6 +9280,17 @@ ATExecAddInherit(Relation child_rel, RangeVar *parent, LOCKMODE lockmode)
 				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
 		 errmsg("cannot inherit to temporary relation of another session")));
 
+	/* Partitions are only created by CREATE TABLE ... PARTITION OF */
+	if (RelationGetPartitionKey(parent_rel) != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("cannot inherit from partitioned table \"%s\"",
+						RelationGetRelationName(parent_rel))));
+	if (OidIsValid(get_partition_parent(RelationGetRelid(child_rel))))
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("cannot change inheritance of a partition")));
+
 	/*
 	 * Check for duplicates in the list of parents, and determine the highest
 	 * inhseqno already present; we'll use the next one for the new parent.
@@ -9441,6 +9663,12 @@ ATExecDropInherit(Relation rel, RangeVar *parent, LOCKMODE lockmode)
 	 */
 	parent_rel = heap_openrv(parent, AccessShareLock);
 
+	/* A partition stays attached to its parent until it is dropped */
+	if (OidIsValid(get_partition_parent(RelationGetRelid(rel))))
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("cannot change inheritance of a partition")));
+
 	/*
 	 * We don't bother to check ownership of the parent table --- ownership of
 	 * the child is presumed enough rights.
@@ -54,6 +54,7 @@
 #include "storage/bufmgr.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
+#include "storage/readstream.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/pg_rusage.h"
@@ -103,6 +104,7 @@ typedef struct LVRelStats
 	BlockNumber old_rel_pages;	/* previous value of pg_class.relpages */
 	BlockNumber rel_pages;		/* total number of pages */
 	BlockNumber scanned_pages;	/* number of pages we examined */
+	BlockNumber frozenskipped_pages;	/* # of frozen pages we skipped */
 	double		scanned_tuples; /* counts only tuples on scanned pages */
 	double		old_rel_tuples; /* previous value of pg_class.reltuples */
 	double		new_rel_tuples; /* new estimated total # of tuples */
@@ -119,6 +121,22 @@ typedef struct LVRelStats
 	bool		lock_waiter_detected;
 } LVRelStats;
 
+/*
+ * State of lazy_scan_heap's choice of pages to read, which is made by the
+ * read stream callback lazy_scan_next_block.
+ */
+typedef struct LVScanState
+{
+	Relation	onerel;
+	LVRelStats *vacrelstats;
+	bool		scan_all;
+	BlockNumber nblocks;
+	BlockNumber next_block;		/* next block to consider */
+	BlockNumber next_unskippable_block;
+	bool		skipping_blocks;
+	Buffer		vmbuffer;		/* VM page pin used for the decisions */
+} LVScanState;
+
 
 /* A few variables that don't seem worth passing around as parameters */
 static int	elevel = -1;
@@ -133,6 +151,11 @@ static BufferAccessStrategy vac_strategy;
 /* non-export function prototypes */
 static void lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			   Relation *Irel, int nindexes, bool scan_all);
+static void lazy_find_unskippable_block(LVScanState *scanstate,
+							BlockNumber start);
+static BlockNumber lazy_scan_next_block(ReadStream *stream,
+					 void *callback_private_data,
+					 void *per_buffer_data);
 static void lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats);
 static bool lazy_check_needs_freeze(Buffer buf);
 static void lazy_vacuum_index(Relation indrel,
@@ -152,7 +175,8 @@ static void lazy_record_dead_tuple(LVRelStats *vacrelstats,
 static bool lazy_tid_reaped(ItemPointer itemptr, void *state);
 static int	vac_cmp_itemptr(const void *left, const void *right);
 static bool heap_page_is_all_visible(Buffer buf,
-						 TransactionId *visibility_cutoff_xid);
+						 TransactionId *visibility_cutoff_xid,
+						 bool *all_frozen);
 
 
 /*
@@ -244,8 +268,12 @@ lazy_vacuum_rel(Relation onerel, VacuumStmt *vacstmt,
 	 *
 	 * NB: We need to check this before truncating the relation, because that
 	 * will change ->rel_pages.
+	 *
+	 * Pages skipped because they were all-frozen contain no XIDs that could
+	 * hold back relfrozenxid or relminmxid, so they count as scanned here.
 	 */
-	if (vacrelstats->scanned_pages < vacrelstats->rel_pages)
+	if ((vacrelstats->scanned_pages + vacrelstats->frozenskipped_pages)
+		< vacrelstats->rel_pages)
 	{
 		Assert(!scan_all);
 		scanned_all = false;
@@ -282,8 +310,9 @@ lazy_vacuum_rel(Relation onerel, VacuumStmt *vacstmt,
 	 * is all-visible we'd definitely like to know that.  But clamp the value
 	 * to be not more than what we're setting relpages to.
 	 *
-	 * Also, don't change relfrozenxid/relminmxid if we skipped any pages,
-	 * since then we don't know for certain that all tuples have a newer xmin.
+	 * Also, don't change relfrozenxid/relminmxid if we skipped any pages
+	 * other than all-frozen ones, since then we don't know for certain that
+	 * all tuples have a newer xmin.
 	 */
 	new_rel_pages = vacrelstats->rel_pages;
 	new_rel_tuples = vacrelstats->new_rel_tuples;
@@ -293,7 +322,7 @@ lazy_vacuum_rel(Relation onerel, VacuumStmt *vacstmt,
 		new_rel_tuples = vacrelstats->old_rel_tuples;
 	}
 
-	new_rel_allvisible = visibilitymap_count(onerel);
+	visibilitymap_count(onerel, &new_rel_allvisible, NULL);
 	if (new_rel_allvisible > new_rel_pages)
 		new_rel_allvisible = new_rel_pages;
 
@@ -335,7 +364,7 @@ lazy_vacuum_rel(Relation onerel, VacuumStmt *vacstmt,
 			}
 			ereport(LOG,
 					(errmsg("automatic vacuum of table \"%s.%s.%s\": index scans: %d\n"
-							"pages: %d removed, %d remain\n"
+							"pages: %d removed, %d remain, %d skipped frozen\n"
 							"tuples: %.0f removed, %.0f remain\n"
 							"buffer usage: %d hits, %d misses, %d dirtied\n"
 					  "avg read rate: %.3f MB/s, avg write rate: %.3f MB/s\n"
@@ -346,6 +375,7 @@ lazy_vacuum_rel(Relation onerel, VacuumStmt *vacstmt,
 							vacrelstats->num_index_scans,
 							vacrelstats->pages_removed,
 							vacrelstats->rel_pages,
+							vacrelstats->frozenskipped_pages,
 							vacrelstats->tuples_deleted,
 							vacrelstats->new_rel_tuples,
 							VacuumPageHit,
@@ -424,8 +454,10 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 	int			i;
 	PGRUsage	ru0;
 	Buffer		vmbuffer = InvalidBuffer;
-	BlockNumber next_not_all_visible_block;
-	bool		skipping_all_visible_blocks;
+	Buffer		buf;
+	LVScanState scanstate;
+	ReadStream *stream;
+	void	   *per_buffer_data;
 	xl_heap_freeze_tuple *frozen;
 
 	pg_rusage_init(&ru0);
@@ -445,6 +477,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 	nblocks = RelationGetNumberOfBlocks(onerel);
 	vacrelstats->rel_pages = nblocks;
 	vacrelstats->scanned_pages = 0;
+	vacrelstats->frozenskipped_pages = 0;
 	vacrelstats->nonempty_pages = 0;
 	vacrelstats->latestRemovedXid = InvalidTransactionId;
 
@@ -461,43 +494,57 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 	 * relfrozenxid, so we only want to do it if we can skip a goodly number
 	 * of pages.
 	 *
-	 * Before entering the main loop, establish the invariant that
-	 * next_not_all_visible_block is the next block number >= blkno that's not
-	 * all-visible according to the visibility map, or nblocks if there's no
-	 * such block.	Also, we set up the skipping_all_visible_blocks flag,
-	 * which is needed because we need hysteresis in the decision: once we've
-	 * started skipping blocks, we may as well skip everything up to the next
-	 * not-all-visible block.
+	 * When scan_all is set, we can't skip pages just because they're
+	 * all-visible, but we can still skip pages that are all-frozen, since
+	 * such pages do not need freezing and do not affect the value that we can
+	 * safely set for relfrozenxid or relminmxid.
+	 *
+	 * The pages we don't skip are read through a read stream, which reads
+	 * ahead of us and combines the reads of consecutive pages.  The decision
+	 * which pages to skip is made by its callback, lazy_scan_next_block, and
+	 * handed back to us along with each page: for each page, we get whether
+	 * it was all-visible according to the visibility map.
 	 *
-	 * Note: if scan_all is true, we won't actually skip any pages; but we
-	 * maintain next_not_all_visible_block anyway, so as to set up the
-	 * all_visible_according_to_vm flag correctly for each page.
+	 * Before starting the scan, establish the invariant that
+	 * next_unskippable_block is the next block number >= next_block that we
+	 * can't skip based on the visibility map, either all-visible for a
+	 * regular scan or all-frozen for a scan_all one, or nblocks if there's no
+	 * such block.  Also, we set up the skipping_blocks flag, which is needed
+	 * because we need hysteresis in the decision: once we've started skipping
+	 * blocks, we may as well skip everything up to the next not-all-visible
+	 * block.
 	 *
-	 * Note: The value returned by visibilitymap_test could be slightly
+	 * Note: The value returned by visibilitymap_get_status could be slightly
 	 * out-of-date, since we make this test before reading the corresponding
 	 * heap page or locking the buffer.  This is OK.  If we mistakenly think
-	 * that the page is all-visible when in fact the flag's just been cleared,
-	 * we might fail to vacuum the page.  But it's OK to skip pages when
-	 * scan_all is not set, so no great harm done; the next vacuum will find
-	 * them.  If we make the reverse mistake and vacuum a page unnecessarily,
-	 * it'll just be a no-op.
+	 * that the page is all-visible or all-frozen when in fact the flag's just
+	 * been cleared, we might fail to vacuum the page.  It's easy to see that
+	 * skipping a page when scan_all is not set is not a very big deal; we
+	 * might leave some dead tuples lying around, but the next vacuum will
+	 * find them.  But even when scan_all is set, it's still OK if we miss a
+	 * page whose all-frozen marking has just been cleared.  Any new XIDs just
+	 * added to that page are necessarily newer than the GlobalXmin we
+	 * computed, so they'll have no effect on the value to which we can safely
+	 * set relfrozenxid.  A similar argument applies for MXIDs and relminmxid.
 	 */
-	for (next_not_all_visible_block = 0;
-		 next_not_all_visible_block < nblocks;
-		 next_not_all_visible_block++)
-	{
-		if (!visibilitymap_test(onerel, next_not_all_visible_block, &vmbuffer))
-			break;
-		vacuum_delay_point();
-	}
-	if (next_not_all_visible_block >= SKIP_PAGES_THRESHOLD)
-		skipping_all_visible_blocks = true;
+	scanstate.onerel = onerel;
+	scanstate.vacrelstats = vacrelstats;
+	scanstate.scan_all = scan_all;
+	scanstate.nblocks = nblocks;
+	scanstate.next_block = 0;
+	scanstate.vmbuffer = InvalidBuffer;
+	lazy_find_unskippable_block(&scanstate, 0);
+	if (scanstate.next_unskippable_block >= SKIP_PAGES_THRESHOLD)
+		scanstate.skipping_blocks = true;
 	else
-		skipping_all_visible_blocks = false;
+		scanstate.skipping_blocks = false;
+
+	stream = BeginReadStream(onerel, MAIN_FORKNUM, vac_strategy,
+							 lazy_scan_next_block, &scanstate,
+							 sizeof(bool));
 
-	for (blkno = 0; blkno < nblocks; blkno++)
+	while (BufferIsValid(buf = ReadStreamNextBuffer(stream, &per_buffer_data)))
 	{
-		Buffer		buf;
 		Page		page;
 		OffsetNumber offnum,
 					maxoff;
@@ -508,46 +555,21 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		Size		freespace;
 		bool		all_visible_according_to_vm;
 		bool		all_visible;
+		bool		all_frozen = true;	/* provided all_visible is also true */
 		bool		has_dead_tuples;
 		TransactionId visibility_cutoff_xid = InvalidTransactionId;
 
-		if (blkno == next_not_all_visible_block)
-		{
-			/* Time to advance next_not_all_visible_block */
-			for (next_not_all_visible_block++;
-				 next_not_all_visible_block < nblocks;
-				 next_not_all_visible_block++)
-			{
-				if (!visibilitymap_test(onerel, next_not_all_visible_block,
-										&vmbuffer))
-					break;
-				vacuum_delay_point();
-			}
-
-			/*
-			 * We know we can't skip the current block.  But set up
-			 * skipping_all_visible_blocks to do the right thing at the
-			 * following blocks.
-			 */
-			if (next_not_all_visible_block - blkno > SKIP_PAGES_THRESHOLD)
-				skipping_all_visible_blocks = true;
-			else
-				skipping_all_visible_blocks = false;
-			all_visible_according_to_vm = false;
-		}
-		else
-		{
-			/* Current block is all-visible */
-			if (skipping_all_visible_blocks && !scan_all)
-				continue;
-			all_visible_according_to_vm = true;
-		}
+		blkno = BufferGetBlockNumber(buf);
+		all_visible_according_to_vm = *((bool *) per_buffer_data);
 
 		vacuum_delay_point();
 
 		/*
 		 * If we are close to overrunning the available space for dead-tuple
 		 * TIDs, pause and do a cycle of vacuuming before we tackle this page.
+		 * The pages the read stream has pinned ahead of us stay pinned, but
+		 * none of them can have dead tuples remembered yet, so that doesn't
+		 * get in the way of lazy_vacuum_heap.
 		 */
 		if ((vacrelstats->max_dead_tuples - vacrelstats->num_dead_tuples) < MaxHeapTuplesPerPage &&
 			vacrelstats->num_dead_tuples > 0)
@@ -563,6 +585,11 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 				ReleaseBuffer(vmbuffer);
 				vmbuffer = InvalidBuffer;
 			}
+			if (BufferIsValid(scanstate.vmbuffer))
+			{
+				ReleaseBuffer(scanstate.vmbuffer);
+				scanstate.vmbuffer = InvalidBuffer;
+			}
 
 			/* Log cleanup info before we touch indexes */
 			vacuum_log_cleanup_info(onerel, vacrelstats);
@@ -588,15 +615,12 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		 * Pin the visibility map page in case we need to mark the page
 		 * all-visible.  In most cases this will be very cheap, because we'll
 		 * already have the correct page pinned anyway.  However, it's
-		 * possible that (a) next_not_all_visible_block is covered by a
-		 * different VM page than the current block or (b) we released our pin
-		 * and did a cycle of index vacuuming.
+		 * possible that (a) the current block is covered by a different VM
+		 * page than the previous one or (b) we released our pin and did a
+		 * cycle of index vacuuming.
 		 */
 		visibilitymap_pin(onerel, blkno, &vmbuffer);
 
-		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, blkno,
-								 RBM_NORMAL, vac_strategy);
-
 		/* We need buffer cleanup lock so that we can prune HOT chains. */
 		if (!ConditionalLockBufferForCleanup(buf))
 		{
@@ -685,7 +709,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			empty_pages++;
 			freespace = PageGetHeapFreeSpace(page);
 
-			/* empty pages are always all-visible */
+			/* empty pages are always all-visible and all-frozen */
 			if (!PageIsAllVisible(page))
 			{
 				START_CRIT_SECTION();
@@ -713,7 +737,8 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 
 				PageSetAllVisible(page);
 				visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
-								  vmbuffer, InvalidTransactionId);
+								  vmbuffer, InvalidTransactionId,
+					   VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
 				END_CRIT_SECTION();
 			}
 
@@ -889,6 +914,8 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			}
 			else
 			{
+				bool		tuple_totally_frozen;
+
 				num_tuples += 1;
 				hastup = true;
 
@@ -897,8 +924,12 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 				 * freezing.  Note we already have exclusive buffer lock.
 				 */
 				if (heap_prepare_freeze_tuple(tuple.t_data, FreezeLimit,
-										  MultiXactCutoff, &frozen[nfrozen]))
+										  MultiXactCutoff, &frozen[nfrozen],
+											  &tuple_totally_frozen))
 					frozen[nfrozen++].offset = offnum;
+
+				if (!tuple_totally_frozen)
+					all_frozen = false;
 			}
 		}						/* scan along page */
 
@@ -963,6 +994,11 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		/* mark page all-visible, if appropriate */
 		if (all_visible && !all_visible_according_to_vm)
 		{
+			uint8		flags = VISIBILITYMAP_ALL_VISIBLE;
+
+			if (all_frozen)
+				flags |= VISIBILITYMAP_ALL_FROZEN;
+
 			/*
 			 * It should never be the case that the visibility map page is set
 			 * while the page-level bit is clear, but the reverse is allowed
@@ -979,7 +1015,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			PageSetAllVisible(page);
 			MarkBufferDirty(buf);
 			visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
-							  vmbuffer, visibility_cutoff_xid);
+							  vmbuffer, visibility_cutoff_xid, flags);
 		}
 
 		/*
@@ -990,11 +1026,12 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		 * that something bad has happened.
 		 */
 		else if (all_visible_according_to_vm && !PageIsAllVisible(page)
-				 && visibilitymap_test(onerel, blkno, &vmbuffer))
+				 && VM_ALL_VISIBLE(onerel, blkno, &vmbuffer))
 		{
 			elog(WARNING, "page is not marked all-visible but visibility map bit is set in relation \"%s\" page %u",
 				 relname, blkno);
-			visibilitymap_clear(onerel, blkno, vmbuffer);
+			visibilitymap_clear(onerel, blkno, vmbuffer,
+								VISIBILITYMAP_VALID_BITS);
 		}
 
 		/*
@@ -1016,7 +1053,25 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 				 relname, blkno);
 			PageClearAllVisible(page);
 			MarkBufferDirty(buf);
-			visibilitymap_clear(onerel, blkno, vmbuffer);
+			visibilitymap_clear(onerel, blkno, vmbuffer,
+								VISIBILITYMAP_VALID_BITS);
+		}
+
+		/*
+		 * If the all-visible page turns out to be all-frozen but not marked
+		 * as such, we should so mark it.  Note that all_frozen is only valid
+		 * if all_visible is true, so we must check both.  We can pass
+		 * InvalidTransactionId as the cutoff XID here, because setting the
+		 * all-frozen bit doesn't cause recovery conflicts.
+		 */
+		else if (all_visible_according_to_vm && all_visible && all_frozen &&
+				 PageIsAllVisible(page) &&
+				 visibilitymap_get_status(onerel, blkno, &vmbuffer) ==
+				 VISIBILITYMAP_ALL_VISIBLE)
+		{
+			visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
+							  vmbuffer, InvalidTransactionId,
+							  VISIBILITYMAP_ALL_FROZEN);
 		}
 
 		UnlockReleaseBuffer(buf);
@@ -1036,6 +1091,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			RecordPageWithFreeSpace(onerel, blkno, freespace);
 	}
 
+	EndReadStream(stream);
 	pfree(frozen);
 
 	/* save stats for use later */
@@ -1049,13 +1105,18 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 														 num_tuples);
 
 	/*
-	 * Release any remaining pin on visibility map page.
+	 * Release any remaining pins on visibility map pages.
 	 */
 	if (BufferIsValid(vmbuffer))
 	{
 		ReleaseBuffer(vmbuffer);
 		vmbuffer = InvalidBuffer;
 	}
+	if (BufferIsValid(scanstate.vmbuffer))
+	{
+		ReleaseBuffer(scanstate.vmbuffer);
+		scanstate.vmbuffer = InvalidBuffer;
+	}
 
 	/* If any tuples need to be deleted, perform final vacuum cycle */
 	/* XXX put a threshold on min number of tuples here? */
@@ -1101,6 +1162,116 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 }
 
 
+/*
+ *	lazy_find_unskippable_block() -- find the next block we can't skip
+ *
+ *		Sets scanstate->next_unskippable_block to the first block >= start
+ *		that is not all-visible (or, for a scan_all vacuum, not all-frozen)
+ *		according to the visibility map, or to nblocks if there is none.
+ */
+static void
+lazy_find_unskippable_block(LVScanState *scanstate, BlockNumber start)
+{
+	BlockNumber blkno;
+
+	for (blkno = start; blkno < scanstate->nblocks; blkno++)
+	{
+		uint8		vmstatus;
+
+		vmstatus = visibilitymap_get_status(scanstate->onerel, blkno,
+											&scanstate->vmbuffer);
+		if (scanstate->scan_all)
+		{
+			if ((vmstatus & VISIBILITYMAP_ALL_FROZEN) == 0)
+				break;
+		}
+		else
+		{
+			if ((vmstatus & VISIBILITYMAP_ALL_VISIBLE) == 0)
+				break;
+		}
+		vacuum_delay_point();
+	}
+	scanstate->next_unskippable_block = blkno;
+}
+
+/*
+ *	lazy_scan_next_block() -- read stream callback for lazy_scan_heap
+ *
+ *		Returns the next block lazy_scan_heap has to look at, skipping pages
+ *		as explained there, or InvalidBlockNumber at the end of the heap.
+ *		The per-buffer data is a bool that is set to whether the block was
+ *		all-visible according to the visibility map.
+ */
+static BlockNumber
+lazy_scan_next_block(ReadStream *stream, void *callback_private_data,
+					 void *per_buffer_data)
+{
+	LVScanState *scanstate = (LVScanState *) callback_private_data;
+	bool	   *all_visible_according_to_vm = (bool *) per_buffer_data;
+
+	while (scanstate->next_block < scanstate->nblocks)
+	{
+		BlockNumber blkno = scanstate->next_block++;
+
+		if (blkno == scanstate->next_unskippable_block)
+		{
+			/* Time to advance next_unskippable_block */
+			lazy_find_unskippable_block(scanstate, blkno + 1);
+
+			/*
+			 * We know we can't skip the current block.  But set up
+			 * skipping_blocks to do the right thing at the following blocks.
+			 */
+			if (scanstate->next_unskippable_block - blkno > SKIP_PAGES_THRESHOLD)
+				scanstate->skipping_blocks = true;
+			else
+				scanstate->skipping_blocks = false;
+
+			/*
+			 * Normally, the fact that we can't skip this block must mean that
+			 * it's not all-visible.  But in a scan_all vacuum we know only
+			 * that it's not all-frozen, so it might still be all-visible.
+			 */
+			*all_visible_according_to_vm =
+				(scanstate->scan_all &&
+				 VM_ALL_VISIBLE(scanstate->onerel, blkno,
+								&scanstate->vmbuffer));
+			return blkno;
+		}
+
+		/*
+		 * The current block is potentially skippable; if we've seen a long
+		 * enough run of skippable blocks to justify skipping it, then go
+		 * ahead and skip.  Otherwise, the page must be at least all-visible
+		 * if not all-frozen, so we can set all_visible_according_to_vm =
+		 * true.
+		 */
+		if (scanstate->skipping_blocks)
+		{
+			/*
+			 * Tricky, tricky.  If this is a scan_all vacuum, the page must
+			 * have been all-frozen at the time we checked whether it was
+			 * skippable, but it might not be any more.  We must be careful to
+			 * count it as a skipped all-frozen page in that case, or else
+			 * we'll think we can't update relfrozenxid and relminmxid.  If
+			 * it's not a scan_all vacuum, we don't know whether it was
+			 * all-frozen, so we have to recheck; but in this case an
+			 * approximate answer is OK.
+			 */
+			if (scanstate->scan_all ||
+				VM_ALL_FROZEN(scanstate->onerel, blkno, &scanstate->vmbuffer))
+				scanstate->vacrelstats->frozenskipped_pages++;
+			continue;
+		}
+
+		*all_visible_according_to_vm = true;
+		return blkno;
+	}
+
+	return InvalidBlockNumber;
+}
+
 /*
  *	lazy_vacuum_heap() -- second pass over the heap
  *
@@ -1186,6 +1357,7 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 	OffsetNumber unused[MaxOffsetNumber];
 	int			uncnt = 0;
 	TransactionId visibility_cutoff_xid;
+	bool		all_frozen;
 
 	START_CRIT_SECTION();
 
@@ -1225,15 +1397,26 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 
 	/*
 	 * Now that we have removed the dead tuples from the page, once again
-	 * check if the page has become all-visible.
+	 * check if the page has become all-visible, and maybe all-frozen too.
 	 */
-	if (!visibilitymap_test(onerel, blkno, vmbuffer) &&
-		heap_page_is_all_visible(buffer, &visibility_cutoff_xid))
+	if (heap_page_is_all_visible(buffer, &visibility_cutoff_xid, &all_frozen))
 	{
-		Assert(BufferIsValid(*vmbuffer));
-		PageSetAllVisible(page);
-		visibilitymap_set(onerel, blkno, buffer, InvalidXLogRecPtr, *vmbuffer,
-						  visibility_cutoff_xid);
+		uint8		vm_status = visibilitymap_get_status(onerel, blkno,
+														 vmbuffer);
+		uint8		flags = 0;
+
+		if ((vm_status & VISIBILITYMAP_ALL_VISIBLE) == 0)
+			flags |= VISIBILITYMAP_ALL_VISIBLE;
+		if ((vm_status & VISIBILITYMAP_ALL_FROZEN) == 0 && all_frozen)
+			flags |= VISIBILITYMAP_ALL_FROZEN;
+
+		if (flags != 0)
+		{
+			Assert(BufferIsValid(*vmbuffer));
+			PageSetAllVisible(page);
+			visibilitymap_set(onerel, blkno, buffer, InvalidXLogRecPtr,
+							  *vmbuffer, visibility_cutoff_xid, flags);
+		}
 	}
 
 	END_CRIT_SECTION();
@@ -1721,10 +1904,13 @@ vac_cmp_itemptr(const void *left, const void *right)
 /*
  * Check if every tuple in the given page is visible to all current and future
  * transactions. Also return the visibility_cutoff_xid which is the highest
- * xmin amongst the visible tuples.
+ * xmin amongst the visible tuples, and *all_frozen which is true if every
+ * tuple on the page is also frozen.  *all_frozen is only meaningful if the
+ * function returns true.
  */
 static bool
-heap_page_is_all_visible(Buffer buf, TransactionId *visibility_cutoff_xid)
+heap_page_is_all_visible(Buffer buf, TransactionId *visibility_cutoff_xid,
+						 bool *all_frozen)
 {
 	Page		page = BufferGetPage(buf);
 	OffsetNumber offnum,
@@ -1732,6 +1918,7 @@ heap_page_is_all_visible(Buffer buf, TransactionId *visibility_cutoff_xid)
 	bool		all_visible = true;
 
 	*visibility_cutoff_xid = InvalidTransactionId;
+	*all_frozen = true;
 
 	/*
 	 * This is a stripped down version of the line pointer scan in
@@ -1794,6 +1981,11 @@ heap_page_is_all_visible(Buffer buf, TransactionId *visibility_cutoff_xid)
 					/* Track newest xmin on page. */
 					if (TransactionIdFollows(xmin, *visibility_cutoff_xid))
 						*visibility_cutoff_xid = xmin;
+
+					/* Check whether this tuple is already frozen or not */
+					if (all_visible && *all_frozen &&
+						heap_tuple_needs_eventual_freeze(tuple.t_data))
+						*all_frozen = false;
 				}
 				break;
 
@@ -42,6 +42,7 @@
 #include "access/transam.h"
 #include "access/xact.h"
 #include "catalog/namespace.h"
+#include "catalog/partition.h"
 #include "commands/trigger.h"
 #include "executor/execdebug.h"
 #include "foreign/fdwapi.h"
@@ -733,6 +734,7 @@ InitPlan(QueryDesc *queryDesc, int eflags)
 	 */
 	estate->es_range_table = rangeTable;
 	estate->es_plannedstmt = plannedstmt;
+	estate->es_jit_flags = plannedstmt->jitFlags;
 
 	/*
 	 * initialize result relation stuff, and open/lock the result rels.
@@ -1170,6 +1172,9 @@ InitResultRelInfo(ResultRelInfo *resultRelInfo,
 	resultRelInfo->ri_ConstraintExprs = NULL;
 	resultRelInfo->ri_junkFilter = NULL;
 	resultRelInfo->ri_projectReturning = NULL;
+	resultRelInfo->ri_CheckPartition = RelationIsPartition(resultRelationDesc);
+	resultRelInfo->ri_PartitionCheck = NULL;
+	resultRelInfo->ri_PartitionRoot = NULL;
 }
 
 /*
@@ -1629,6 +1634,44 @@ ExecConstraints(ResultRelInfo *resultRelInfo,
 	}
 }
 
+/*
+ * ExecPartitionCheck --- check that a new tuple satisfies the partition
+ * bounds of the result relation, at every level of partitioning
+ *
+ * Callers should only call this if ri_CheckPartition is set.
+ */
+void
+ExecPartitionCheck(ResultRelInfo *resultRelInfo,
+				   TupleTableSlot *slot, EState *estate)
+{
+	Relation	rel = resultRelInfo->ri_RelationDesc;
+
+	if (resultRelInfo->ri_PartitionCheck == NULL)
+	{
+		MemoryContext oldContext;
+
+		oldContext = MemoryContextSwitchTo(estate->es_query_cxt);
+		resultRelInfo->ri_PartitionCheck = get_partition_check(rel);
+		MemoryContextSwitchTo(oldContext);
+
+		/* could only happen if the partition were concurrently detached */
+		if (resultRelInfo->ri_PartitionCheck == NULL)
+			elog(ERROR, "relation \"%s\" is not a partition",
+				 RelationGetRelationName(rel));
+	}
+
+	if (!partition_check_tuple(resultRelInfo->ri_PartitionCheck, slot))
+		ereport(ERROR,
+				(errcode(ERRCODE_CHECK_VIOLATION),
+				 errmsg("new row for relation \"%s\" violates partition constraint",
+						RelationGetRelationName(rel)),
+				 errdetail("Failing row contains %s.",
+						   ExecBuildSlotValueDescription(slot,
+														 RelationGetDescr(rel),
+														 64)),
+				 errtable(rel)));
+}
+
 /*
  * ExecBuildSlotValueDescription -- construct a string representing a tuple
  *
@@ -2343,6 +2386,7 @@ EvalPlanQualStart(EPQState *epqstate, EState *parentestate, Plan *planTree)
 	estate->es_crosscheck_snapshot = parentestate->es_crosscheck_snapshot;
 	estate->es_range_table = parentestate->es_range_table;
 	estate->es_plannedstmt = parentestate->es_plannedstmt;
+	estate->es_jit_flags = parentestate->es_jit_flags;
 	estate->es_junkFilter = parentestate->es_junkFilter;
 	estate->es_output_cid = parentestate->es_output_cid;
 	estate->es_result_relations = parentestate->es_result_relations;
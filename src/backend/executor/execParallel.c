@@ -0,0 +1,78 @@
+/*-------------------------------------------------------------------------
+ *
+ * execParallel.c
+ *	  Support routines for parallel execution.
+ *
+ * This file contains the part of a parallel sequential scan that runs in
+ * each worker process; see access/transam/parallel.c for how the workers
+ * are set up, and nodeGather.c for the leader's side.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/execParallel.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/heapam.h"
+#include "executor/execParallel.h"
+#include "executor/executor.h"
+#include "miscadmin.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+
+
+/*
+ * ExecParallelScan
+ *
+ * Scan the blocks of rel handed to us by the shared block allocator, and
+ * send every tuple satisfying qual to the leader through mqh, as a
+ * MinimalTuple.  The qual has come from the leader's plan tree, so it
+ * references the scan tuple only.
+ *
+ * Stops early if the leader detaches from the queue.
+ */
+void
+ExecParallelScan(Relation rel, Snapshot snapshot, ParallelHeapScanDesc pscan,
+				 List *qual, shm_mq_handle *mqh)
+{
+	EState	   *estate;
+	ExprContext *econtext;
+	List	   *qualstate;
+	TupleTableSlot *slot;
+	HeapScanDesc scan;
+	HeapTuple	tuple;
+
+	estate = CreateExecutorState();
+	econtext = GetPerTupleExprContext(estate);
+	qualstate = (List *) ExecPrepareExpr((Expr *) qual, estate);
+
+	slot = MakeSingleTupleTableSlot(RelationGetDescr(rel));
+	econtext->ecxt_scantuple = slot;
+
+	scan = heap_beginscan_parallel(rel, snapshot, pscan);
+
+	while ((tuple = heap_getnext(scan, ForwardScanDirection)) != NULL)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		ResetExprContext(econtext);
+		ExecStoreTuple(tuple, slot, scan->rs_cbuf, false);
+
+		if (qualstate == NIL || ExecQual(qualstate, econtext, false))
+		{
+			MinimalTuple mtup = ExecFetchSlotMinimalTuple(slot);
+
+			if (shm_mq_send(mqh, mtup->t_len, mtup) == SHM_MQ_DETACHED)
+				break;
+		}
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+	heap_endscan(scan);
+	FreeExecutorState(estate);
+}
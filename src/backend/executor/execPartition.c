@@ -0,0 +1,346 @@
+/*-------------------------------------------------------------------------
+ *
+ * execPartition.c
+ *	  Support routines for routing tuples to partitions.
+ *
+ * A tuple inserted into a partitioned table is stored in one of its leaf
+ * partitions.  At executor startup we open every partition in the tree and
+ * build a ResultRelInfo for each leaf; for each tuple we then descend the
+ * tree, at each level picking the partition whose bound accepts the tuple's
+ * partition key, until a leaf is reached.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/execPartition.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/heapam.h"
+#include "catalog/pg_inherits_fn.h"
+#include "executor/execPartition.h"
+#include "executor/executor.h"
+#include "lib/stringinfo.h"
+#include "mb/pg_wchar.h"
+#include "utils/builtins.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
+
+
+static void get_partition_dispatch_recurse(Relation rel, Relation root,
+							   List **pds, List **leaf_parts);
+static char *ExecBuildPartitionKeyDescription(PartitionDispatch pd,
+								 Datum *values, bool *isnull,
+								 int maxfieldlen);
+
+
+/*
+ * ExecSetupPartitionTupleRouting
+ *		Set up the state needed to route tuples inserted into the
+ *		partitioned table of rootRelInfo to its leaf partitions.
+ *
+ * All the partitions in the tree are locked and opened, and a ResultRelInfo
+ * with open indexes is built for each leaf.  Everything is allocated in
+ * CurrentMemoryContext, which should be the executor's per-query context.
+ */
+PartitionTupleRouting *
+ExecSetupPartitionTupleRouting(ResultRelInfo *rootRelInfo, EState *estate)
+{
+	Relation	rel = rootRelInfo->ri_RelationDesc;
+	TupleDesc	rootdesc = RelationGetDescr(rel);
+	PartitionTupleRouting *proute;
+	List	   *pds = NIL;
+	List	   *leaf_parts = NIL;
+	ListCell   *lc;
+	int			i;
+
+	/*
+	 * Lock all the partitions up front.  find_all_inheritors locks them in a
+	 * consistent order, so that concurrent inserts cannot deadlock.
+	 */
+	(void) find_all_inheritors(RelationGetRelid(rel), RowExclusiveLock, NULL);
+
+	get_partition_dispatch_recurse(rel, rel, &pds, &leaf_parts);
+
+	proute = (PartitionTupleRouting *) palloc0(sizeof(PartitionTupleRouting));
+
+	proute->num_dispatch = list_length(pds);
+	proute->dispatch = (PartitionDispatch *)
+		palloc(proute->num_dispatch * sizeof(PartitionDispatch));
+	i = 0;
+	foreach(lc, pds)
+		proute->dispatch[i++] = (PartitionDispatch) lfirst(lc);
+
+	proute->num_partitions = list_length(leaf_parts);
+	proute->partitions = (ResultRelInfo *)
+		palloc(proute->num_partitions * sizeof(ResultRelInfo));
+	proute->maps = (TupleConversionMap **)
+		palloc(proute->num_partitions * sizeof(TupleConversionMap *));
+	proute->rootmaps = (TupleConversionMap **)
+		palloc(proute->num_partitions * sizeof(TupleConversionMap *));
+
+	i = 0;
+	foreach(lc, leaf_parts)
+	{
+		Relation	partrel = (Relation) lfirst(lc);
+		ResultRelInfo *leaf_rri = &proute->partitions[i];
+		TupleDesc	partdesc = RelationGetDescr(partrel);
+
+		CheckValidResultRel(partrel, CMD_INSERT);
+
+		InitResultRelInfo(leaf_rri,
+						  partrel,
+						  rootRelInfo->ri_RangeTableIndex,
+						  estate->es_instrument);
+		leaf_rri->ri_PartitionRoot = rel;
+
+		/*
+		 * Routing ensures the tuple satisfies the partition's bound, unless
+		 * a BEFORE ROW trigger on the partition changes it afterwards.
+		 */
+		leaf_rri->ri_CheckPartition =
+			(leaf_rri->ri_TrigDesc != NULL &&
+			 leaf_rri->ri_TrigDesc->trig_insert_before_row);
+
+		ExecOpenIndices(leaf_rri);
+
+		proute->maps[i] =
+			convert_tuples_by_name(rootdesc, partdesc,
+								 gettext_noop("could not convert row type"));
+		proute->rootmaps[i] =
+			convert_tuples_by_name(partdesc, rootdesc,
+								 gettext_noop("could not convert row type"));
+		i++;
+	}
+
+	proute->partition_slot = ExecInitExtraTupleSlot(estate);
+	proute->root_slot = ExecInitExtraTupleSlot(estate);
+	ExecSetSlotDescriptor(proute->root_slot, rootdesc);
+
+	return proute;
+}
+
+/*
+ * get_partition_dispatch_recurse
+ *		Add a PartitionDispatch for partitioned table rel, and for all the
+ *		partitioned tables below it, to *pds; add the leaf partitions to
+ *		*leaf_parts.
+ *
+ * The partitions have already been locked.
+ */
+static void
+get_partition_dispatch_recurse(Relation rel, Relation root,
+							   List **pds, List **leaf_parts)
+{
+	PartitionKey key = RelationGetPartitionKey(rel);
+	PartitionDesc partdesc = RelationGetPartitionDesc(rel);
+	PartitionDispatch pd;
+	int			i;
+
+	Assert(key != NULL);
+
+	pd = (PartitionDispatch) palloc(sizeof(PartitionDispatchData));
+	pd->reldesc = rel;
+	pd->key = key;
+	pd->partdesc = partdesc;
+	pd->keyattnos = map_partition_key_attnos(rel, root);
+	pd->indexes = (int *) palloc(partdesc->nparts * sizeof(int));
+	*pds = lappend(*pds, pd);
+
+	for (i = 0; i < partdesc->nparts; i++)
+	{
+		Relation	partrel = heap_open(partdesc->oids[i], NoLock);
+
+		if (RelationGetPartitionKey(partrel) != NULL)
+		{
+			pd->indexes[i] = -1 - list_length(*pds);
+			get_partition_dispatch_recurse(partrel, root, pds, leaf_parts);
+		}
+		else
+		{
+			pd->indexes[i] = list_length(*leaf_parts);
+			*leaf_parts = lappend(*leaf_parts, partrel);
+		}
+	}
+}
+
+/*
+ * ExecFindPartition
+ *		Find the leaf partition for the tuple in slot, which is in the
+ *		format of the root table.
+ *
+ * Returns the leaf's index in proute->partitions.  If the root table is
+ * itself a partition, the tuple is first checked against its bound.
+ */
+int
+ExecFindPartition(ResultRelInfo *rootRelInfo, PartitionTupleRouting *proute,
+				  TupleTableSlot *slot, EState *estate)
+{
+	PartitionDispatch pd = proute->dispatch[0];
+	Datum		values[PARTITION_MAX_KEYS];
+	bool		isnull[PARTITION_MAX_KEYS];
+
+	if (rootRelInfo->ri_CheckPartition)
+		ExecPartitionCheck(rootRelInfo, slot, estate);
+
+	for (;;)
+	{
+		int			i;
+		int			idx;
+
+		for (i = 0; i < pd->key->partnatts; i++)
+			values[i] = slot_getattr(slot, pd->keyattnos[i], &isnull[i]);
+
+		idx = get_partition_for_tuple(pd->key, pd->partdesc, values, isnull);
+		if (idx < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_CHECK_VIOLATION),
+					 errmsg("no partition of relation \"%s\" found for row",
+							RelationGetRelationName(pd->reldesc)),
+					 errdetail("Partition key of the failing row contains %s.",
+							   ExecBuildPartitionKeyDescription(pd, values,
+																isnull, 64)),
+					 errtable(pd->reldesc)));
+
+		idx = pd->indexes[idx];
+		if (idx >= 0)
+			return idx;
+		pd = proute->dispatch[-1 - idx];
+	}
+}
+
+/*
+ * ExecConvertToPartition
+ *		Convert a tuple in the root table's format to the format of the
+ *		given leaf partition.
+ *
+ * Returns slot itself if the formats are the same, else proute's
+ * partition_slot holding a converted copy.
+ */
+TupleTableSlot *
+ExecConvertToPartition(PartitionTupleRouting *proute, int leaf,
+					   TupleTableSlot *slot)
+{
+	TupleConversionMap *map = proute->maps[leaf];
+	HeapTuple	tuple;
+
+	if (map == NULL)
+		return slot;
+
+	tuple = do_convert_tuple(ExecMaterializeSlot(slot), map);
+	ExecSetSlotDescriptor(proute->partition_slot, map->outdesc);
+	return ExecStoreTuple(tuple, proute->partition_slot, InvalidBuffer, true);
+}
+
+/*
+ * ExecConvertFromPartition
+ *		Convert a tuple stored in a leaf partition back to the root table's
+ *		format, for RETURNING.
+ */
+TupleTableSlot *
+ExecConvertFromPartition(PartitionTupleRouting *proute, int leaf,
+						 TupleTableSlot *slot)
+{
+	TupleConversionMap *map = proute->rootmaps[leaf];
+	HeapTuple	tuple;
+	HeapTuple	result;
+
+	if (map == NULL)
+		return slot;
+
+	tuple = ExecMaterializeSlot(slot);
+	result = do_convert_tuple(tuple, map);
+	result->t_self = tuple->t_self;
+	result->t_tableOid = tuple->t_tableOid;
+	return ExecStoreTuple(result, proute->root_slot, InvalidBuffer, true);
+}
+
+/*
+ * ExecCleanupTupleRouting
+ *		Close the partitions opened by ExecSetupPartitionTupleRouting.
+ *
+ * The root table is left open; it belongs to the caller.  Locks are kept
+ * until end of transaction.
+ */
+void
+ExecCleanupTupleRouting(PartitionTupleRouting *proute)
+{
+	int			i;
+
+	for (i = 1; i < proute->num_dispatch; i++)
+		heap_close(proute->dispatch[i]->reldesc, NoLock);
+
+	for (i = 0; i < proute->num_partitions; i++)
+	{
+		ResultRelInfo *leaf_rri = &proute->partitions[i];
+
+		ExecCloseIndices(leaf_rri);
+		heap_close(leaf_rri->ri_RelationDesc, NoLock);
+	}
+}
+
+/*
+ * ExecBuildPartitionKeyDescription
+ *		Construct a string describing the partition key of a tuple, like
+ *		"(a, b)=(1, 2)", for error messages.  Long values are truncated to
+ *		maxfieldlen bytes, as in ExecBuildSlotValueDescription.
+ */
+static char *
+ExecBuildPartitionKeyDescription(PartitionDispatch pd,
+								 Datum *values, bool *isnull,
+								 int maxfieldlen)
+{
+	PartitionKey key = pd->key;
+	StringInfoData buf;
+	int			i;
+
+	initStringInfo(&buf);
+	appendStringInfoChar(&buf, '(');
+	for (i = 0; i < key->partnatts; i++)
+	{
+		Form_pg_attribute att = pd->reldesc->rd_att->attrs[key->partattrs[i] - 1];
+
+		if (i > 0)
+			appendStringInfoString(&buf, ", ");
+		appendStringInfoString(&buf, quote_identifier(NameStr(att->attname)));
+	}
+	appendStringInfoString(&buf, ")=(");
+
+	for (i = 0; i < key->partnatts; i++)
+	{
+		char	   *val;
+		int			vallen;
+
+		if (isnull[i])
+			val = "null";
+		else
+		{
+			Oid			foutoid;
+			bool		typisvarlena;
+
+			getTypeOutputInfo(key->parttypid[i], &foutoid, &typisvarlena);
+			val = OidOutputFunctionCall(foutoid, values[i]);
+		}
+
+		if (i > 0)
+			appendStringInfoString(&buf, ", ");
+
+		/* truncate if needed */
+		vallen = strlen(val);
+		if (vallen <= maxfieldlen)
+			appendStringInfoString(&buf, val);
+		else
+		{
+			vallen = pg_mbcliplen(val, vallen, maxfieldlen);
+			appendBinaryStringInfo(&buf, val, vallen);
+			appendStringInfoString(&buf, "...");
+		}
+	}
+	appendStringInfoChar(&buf, ')');
+
+	return buf.data;
+}
@@ -28,10 +28,18 @@
  *		to facilitate attribute sharing between nodes wherever possible,
  *		instead of doing needless copying.	-cim 5/31/91
  *
+ *		ExecInitExpr flattens the commonest kinds of top-level expressions
+ *		into a linear program of steps, which ExecEvalProgram executes without
+ *		recursing through the ExprState tree; see "Flat expression programs"
+ *		below.  The recursive ExecEval* routines remain in use for the node
+ *		types the program doesn't handle inline, and for expressions that
+ *		can return sets.
+ *
  *		During expression evaluation, we check_stack_depth only in
- *		ExecMakeFunctionResult (and substitute routines) rather than at every
- *		single node.  This is a compromise that trades off precision of the
- *		stack limit setting to gain speed.
+ *		ExecMakeFunctionResult (and substitute routines, including
+ *		ExecEvalProgram) rather than at every single node.  This is a
+ *		compromise that trades off precision of the stack limit setting to
+ *		gain speed.
  */
 
 #include "postgres.h"
@@ -43,8 +51,11 @@
 #include "catalog/pg_type.h"
 #include "commands/typecmds.h"
 #include "executor/execdebug.h"
+#include "executor/execExpr.h"
+#include "executor/nodeAgg.h"
 #include "executor/nodeSubplan.h"
 #include "funcapi.h"
+#include "jit/jit.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
@@ -53,6 +64,7 @@
 #include "pgstat.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
+#include "utils/datum.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/typcache.h"
@@ -181,6 +193,10 @@ static Datum ExecEvalArrayCoerceExpr(ArrayCoerceExprState *astate,
 						bool *isNull, ExprDoneCond *isDone);
 static Datum ExecEvalCurrentOfExpr(ExprState *exprstate, ExprContext *econtext,
 					  bool *isNull, ExprDoneCond *isDone);
+static void ExecCompileExpr(ExprState *state, PlanState *parent);
+static Datum ExecEvalProgram(ExprState *exprstate, ExprContext *econtext,
+				bool *isNull, ExprDoneCond *isDone);
+static ExprState *ExecInitExprRec(Expr *node, PlanState *parent);
 
 
 /* ----------------------------------------------------------------
@@ -607,43 +623,9 @@ ExecEvalScalarVar(ExprState *exprstate, ExprContext *econtext,
 
 	/*
 	 * If it's a user attribute, check validity (bogus system attnums will be
-	 * caught inside slot_getattr).  What we have to check for here is the
-	 * possibility of an attribute having been changed in type since the plan
-	 * tree was created.  Ideally the plan will get invalidated and not
-	 * re-used, but just in case, we keep these defenses.  Fortunately it's
-	 * sufficient to check once on the first time through.
-	 *
-	 * Note: we allow a reference to a dropped attribute.  slot_getattr will
-	 * force a NULL result in such cases.
-	 *
-	 * Note: ideally we'd check typmod as well as typid, but that seems
-	 * impractical at the moment: in many cases the tupdesc will have been
-	 * generated by ExecTypeFromTL(), and that can't guarantee to generate an
-	 * accurate typmod in all cases, because some expression node types don't
-	 * carry typmod.
+	 * caught inside slot_getattr).
 	 */
-	if (attnum > 0)
-	{
-		TupleDesc	slot_tupdesc = slot->tts_tupleDescriptor;
-		Form_pg_attribute attr;
-
-		if (attnum > slot_tupdesc->natts)		/* should never happen */
-			elog(ERROR, "attribute number %d exceeds number of columns %d",
-				 attnum, slot_tupdesc->natts);
-
-		attr = slot_tupdesc->attrs[attnum - 1];
-
-		/* can't check type if dropped, since atttypid is probably 0 */
-		if (!attr->attisdropped)
-		{
-			if (variable->vartype != attr->atttypid)
-				ereport(ERROR,
-						(errmsg("attribute %d has wrong type", attnum),
-						 errdetail("Table has type %s, but query expects %s.",
-								   format_type_be(attr->atttypid),
-								   format_type_be(variable->vartype))));
-		}
-	}
+	CheckVarSlotCompatibility(slot, attnum, variable->vartype);
 
 	/* Skip the checking on future executions of node */
 	exprstate->evalfunc = ExecEvalScalarVarFast;
@@ -4303,6 +4285,1040 @@ ExecEvalCurrentOfExpr(ExprState *exprstate, ExprContext *econtext,
 	return 0;					/* keep compiler quiet */
 }
 
+/* ----------------------------------------------------------------
+ *		Flat expression programs
+ *
+ * Evaluating an expression by walking the ExprState tree costs a function
+ * call through the evalfunc pointer for every node, plus the overhead of
+ * setting up the isNull/isDone outputs, which for simple operators often
+ * outweighs the work of the operator itself.  So ExecInitExpr additionally
+ * flattens each top-level expression into an array of steps, which
+ * ExecEvalProgram runs in a single loop without recursion.
+ *
+ * Each step stores its result into the location given by its resvalue and
+ * resnull fields.  The steps computing a function's arguments write directly
+ * into the function's FunctionCallInfoData, so the call step only has to
+ * check for NULL arguments (if the function is strict) and invoke the
+ * function.  Short-circuiting in AND, OR, CASE and COALESCE is done with
+ * jumps to other steps.
+ *
+ * Only the common node types are flattened; any other subexpression is
+ * evaluated by a GENERIC step that hands its ExprState to ExecEvalExpr.
+ * Expressions that can return sets are left to the recursive routines
+ * entirely, so the program never needs to deal with isDone.
+ *
+ * The ExprState tree is kept intact; the program merely replaces the
+ * evalfunc of its root node, and refers to the FuncExprStates etc. of the
+ * tree for run-time state.  This keeps the node types seen by other code
+ * unchanged.
+ *
+ * An Agg node also gets a program, built by ExecBuildAggTrans, that computes
+ * the arguments of its aggregates and advances their transition values for
+ * one input tuple, so that the transition function calls are compiled along
+ * with the argument expressions.
+ *
+ * The step representation is declared in executor/execExpr.h, so that a JIT
+ * provider (see jit/jit.h) can translate programs into native code.
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * Use the GCC "labels as values" extension to dispatch directly to the code
+ * for the next step, if available.  Otherwise fall back to a switch.
+ */
+#if defined(__GNUC__)
+#define EEO_USE_COMPUTED_GOTO
+#endif
+
+/*
+ * Check that the type of a Var still matches the slot it's fetched from.
+ */
+void
+CheckVarSlotCompatibility(TupleTableSlot *slot, AttrNumber attnum, Oid vartype)
+{
+	/*
+	 * What we have to check for here is the possibility of an attribute
+	 * having been changed in type since the plan tree was created.  Ideally
+	 * the plan will get invalidated and not re-used, but just in case, we
+	 * keep these defenses.  Fortunately it's sufficient to check once on the
+	 * first time through.
+	 *
+	 * Note: we allow a reference to a dropped attribute.  slot_getattr will
+	 * force a NULL result in such cases.
+	 *
+	 * Note: ideally we'd check typmod as well as typid, but that seems
+	 * impractical at the moment: in many cases the tupdesc will have been
+	 * generated by ExecTypeFromTL(), and that can't guarantee to generate an
+	 * accurate typmod in all cases, because some expression node types don't
+	 * carry typmod.
+	 */
+	if (attnum > 0)
+	{
+		TupleDesc	slot_tupdesc = slot->tts_tupleDescriptor;
+		Form_pg_attribute attr;
+
+		if (attnum > slot_tupdesc->natts)		/* should never happen */
+			elog(ERROR, "attribute number %d exceeds number of columns %d",
+				 attnum, slot_tupdesc->natts);
+
+		attr = slot_tupdesc->attrs[attnum - 1];
+
+		/* can't check type if dropped, since atttypid is probably 0 */
+		if (!attr->attisdropped)
+		{
+			if (vartype != attr->atttypid)
+				ereport(ERROR,
+						(errmsg("attribute %d has wrong type", attnum),
+						 errdetail("Table has type %s, but query expects %s.",
+								   format_type_be(attr->atttypid),
+								   format_type_be(vartype))));
+		}
+	}
+}
+
+/*
+ * Look up the function of a FUNCEXPR_INIT step on first use, and turn the
+ * step into a FUNCEXPR or FUNCEXPR_STRICT step.
+ */
+void
+ExecEvalFuncExprInit(ExprEvalStep *op, ExprContext *econtext)
+{
+	FuncExprState *fcache = op->d.func.fcache;
+
+	/*
+	 * The FuncExprState might already have been initialized if somebody else
+	 * evaluates it through the tree, too.
+	 */
+	if (fcache->func.fn_oid == InvalidOid)
+	{
+		Expr	   *expr = fcache->xprstate.expr;
+
+		if (IsA(expr, FuncExpr))
+			init_fcache(((FuncExpr *) expr)->funcid,
+						((FuncExpr *) expr)->inputcollid,
+						fcache, econtext->ecxt_per_query_memory, false);
+		else
+			init_fcache(((OpExpr *) expr)->opfuncid,
+						((OpExpr *) expr)->inputcollid,
+						fcache, econtext->ecxt_per_query_memory, false);
+	}
+
+	/* ExecCompileExpr checked this, but pg_proc could have changed */
+	if (fcache->func.fn_retset)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+
+	op->opcode = fcache->func.fn_strict ? EEOP_FUNCEXPR_STRICT : EEOP_FUNCEXPR;
+}
+
+/*
+ * Use the first non-NULL input of a strict transition function as the
+ * initial transValue of a group that doesn't have one yet.  (ExecInitAgg
+ * checked that the agg's input type is binary-compatible with its
+ * transtype, so straight copy here is OK.)
+ *
+ * We must copy the datum into aggcontext if it is pass-by-ref.  We do not
+ * need to pfree the old transValue, since it's NULL.
+ */
+void
+ExecAggInitGroup(ExprEvalStep *op, AggStatePerGroup pergroup)
+{
+	FunctionCallInfo fcinfo = op->d.aggtrans.fcinfo;
+	MemoryContext oldContext;
+
+	oldContext = MemoryContextSwitchTo(op->d.aggtrans.aggstate->aggcontext);
+	pergroup->transValue = datumCopy(fcinfo->arg[1],
+									 op->d.aggtrans.transtypeByVal,
+									 op->d.aggtrans.transtypeLen);
+	pergroup->transValueIsNull = false;
+	pergroup->noTransValue = false;
+	MemoryContextSwitchTo(oldContext);
+}
+
+/*
+ * Given the result of a pass-by-ref transition function, return the value
+ * to store as the group's new transValue: a copy in aggcontext, unless the
+ * function returned a pointer to its first input.  The prior transValue is
+ * freed if it's being replaced.
+ */
+Datum
+ExecAggTransReparent(ExprEvalStep *op, AggStatePerGroup pergroup,
+					 Datum newValue)
+{
+	if (DatumGetPointer(newValue) == DatumGetPointer(pergroup->transValue))
+		return newValue;
+
+	if (!op->d.aggtrans.fcinfo->isnull)
+	{
+		MemoryContext oldContext;
+
+		oldContext = MemoryContextSwitchTo(op->d.aggtrans.aggstate->aggcontext);
+		newValue = datumCopy(newValue,
+							 op->d.aggtrans.transtypeByVal,
+							 op->d.aggtrans.transtypeLen);
+		MemoryContextSwitchTo(oldContext);
+	}
+	if (!pergroup->transValueIsNull)
+		pfree(DatumGetPointer(pergroup->transValue));
+
+	return newValue;
+}
+
+/*
+ * Append a step to a program being built, returning its index.
+ */
+static int
+ExprEvalPushStep(ExprEvalProgram *prog, ExprEvalStep *step)
+{
+	if (prog->nsteps >= prog->maxsteps)
+	{
+		prog->maxsteps *= 2;
+		prog->steps = (ExprEvalStep *)
+			repalloc(prog->steps, prog->maxsteps * sizeof(ExprEvalStep));
+	}
+	prog->steps[prog->nsteps] = *step;
+	return prog->nsteps++;
+}
+
+/*
+ * Append the steps computing the expression represented by 'state' to a
+ * program, arranging for the result to be stored in *resvalue and *resnull.
+ */
+static void
+ExecCompileExprRec(ExprEvalProgram *prog, ExprState *state,
+				   Datum *resvalue, bool *resnull)
+{
+	Expr	   *node = state->expr;
+	ExprEvalStep step;
+
+	/* Guard against stack overflow due to overly complex expressions */
+	check_stack_depth();
+
+	memset(&step, 0, sizeof(step));
+	step.resvalue = resvalue;
+	step.resnull = resnull;
+
+	switch (nodeTag(node))
+	{
+		case T_Var:
+			{
+				Var		   *variable = (Var *) node;
+
+				/* system columns and whole-row Vars are left to the tree */
+				if (variable->varattno <= 0)
+					break;
+
+				switch (variable->varno)
+				{
+					case INNER_VAR:
+						step.opcode = EEOP_INNER_VAR_FIRST;
+						prog->last_inner = Max(prog->last_inner,
+											   variable->varattno);
+						break;
+					case OUTER_VAR:
+						step.opcode = EEOP_OUTER_VAR_FIRST;
+						prog->last_outer = Max(prog->last_outer,
+											   variable->varattno);
+						break;
+
+						/* INDEX_VAR is handled by default case */
+
+					default:
+						step.opcode = EEOP_SCAN_VAR_FIRST;
+						prog->last_scan = Max(prog->last_scan,
+											  variable->varattno);
+						break;
+				}
+				step.d.var.attnum = variable->varattno - 1;
+				step.d.var.vartype = variable->vartype;
+				ExprEvalPushStep(prog, &step);
+				return;
+			}
+
+		case T_Const:
+			{
+				Const	   *con = (Const *) node;
+
+				step.opcode = EEOP_CONST;
+				step.d.constval.value = con->constvalue;
+				step.d.constval.isnull = con->constisnull;
+				ExprEvalPushStep(prog, &step);
+				return;
+			}
+
+		case T_CaseTestExpr:
+			step.opcode = EEOP_CASE_TESTVAL;
+			ExprEvalPushStep(prog, &step);
+			return;
+
+		case T_FuncExpr:
+		case T_OpExpr:
+			{
+				FuncExprState *fcache = (FuncExprState *) state;
+				ListCell   *lc;
+				int			i;
+
+				/* let init_fcache complain about too many arguments */
+				if (list_length(fcache->args) > FUNC_MAX_ARGS)
+					break;
+
+				i = 0;
+				foreach(lc, fcache->args)
+				{
+					ExecCompileExprRec(prog, (ExprState *) lfirst(lc),
+									   &fcache->fcinfo_data.arg[i],
+									   &fcache->fcinfo_data.argnull[i]);
+					i++;
+				}
+
+				step.opcode = EEOP_FUNCEXPR_INIT;
+				step.d.func.fcache = fcache;
+				step.d.func.nargs = i;
+				ExprEvalPushStep(prog, &step);
+				return;
+			}
+
+		case T_BoolExpr:
+			{
+				BoolExprState *bstate = (BoolExprState *) state;
+				BoolExpr   *boolexpr = (BoolExpr *) node;
+				int			nargs = list_length(bstate->args);
+				List	   *jumps = NIL;
+				bool	   *anynull;
+				ListCell   *lc;
+				int			i;
+
+				if (boolexpr->boolop == NOT_EXPR)
+				{
+					ExecCompileExprRec(prog,
+									 (ExprState *) linitial(bstate->args),
+									   resvalue, resnull);
+					step.opcode = EEOP_BOOL_NOT;
+					ExprEvalPushStep(prog, &step);
+					return;
+				}
+
+				/* the planner never makes an AND or OR of fewer arguments */
+				if (nargs < 2)
+					break;
+
+				anynull = (bool *) palloc(sizeof(bool));
+				i = 0;
+				foreach(lc, bstate->args)
+				{
+					ExecCompileExprRec(prog, (ExprState *) lfirst(lc),
+									   resvalue, resnull);
+
+					if (boolexpr->boolop == AND_EXPR)
+						step.opcode = (i == 0) ? EEOP_BOOL_AND_STEP_FIRST :
+							(i == nargs - 1) ? EEOP_BOOL_AND_STEP_LAST :
+							EEOP_BOOL_AND_STEP;
+					else
+						step.opcode = (i == 0) ? EEOP_BOOL_OR_STEP_FIRST :
+							(i == nargs - 1) ? EEOP_BOOL_OR_STEP_LAST :
+							EEOP_BOOL_OR_STEP;
+					step.d.boolexpr.anynull = anynull;
+					step.d.boolexpr.jumpdone = -1;	/* fixed below */
+					jumps = lappend_int(jumps, ExprEvalPushStep(prog, &step));
+					i++;
+				}
+
+				foreach(lc, jumps)
+					prog->steps[lfirst_int(lc)].d.boolexpr.jumpdone = prog->nsteps;
+				list_free(jumps);
+				return;
+			}
+
+		case T_NullTest:
+			{
+				NullTestState *nstate = (NullTestState *) state;
+				NullTest   *ntest = (NullTest *) node;
+
+				/* rowtype tests need to look at the fields; not inlined */
+				if (ntest->argisrow)
+					break;
+
+				ExecCompileExprRec(prog, nstate->arg, resvalue, resnull);
+				step.opcode = (ntest->nulltesttype == IS_NULL) ?
+					EEOP_NULLTEST_ISNULL : EEOP_NULLTEST_ISNOTNULL;
+				ExprEvalPushStep(prog, &step);
+				return;
+			}
+
+		case T_RelabelType:
+			/* nothing to do at run time, just compute the argument */
+			ExecCompileExprRec(prog, ((GenericExprState *) state)->arg,
+							   resvalue, resnull);
+			return;
+
+		case T_CaseExpr:
+			{
+				CaseExprState *cstate = (CaseExprState *) state;
+				List	   *jumps = NIL;
+				ExprEvalStep savestep;
+				ListCell   *lc;
+
+				/*
+				 * If there's a test expression, compute it and make it the
+				 * value of the CaseTestExpr placeholders while the WHEN
+				 * clauses are evaluated, like ExecEvalCase does.
+				 */
+				memset(&savestep, 0, sizeof(savestep));
+				if (cstate->arg)
+				{
+					savestep.resvalue = (Datum *) palloc(sizeof(Datum));
+					savestep.resnull = (bool *) palloc(sizeof(bool));
+					ExecCompileExprRec(prog, cstate->arg,
+									   savestep.resvalue, savestep.resnull);
+
+					savestep.opcode = EEOP_CASE_SETVAL;
+					savestep.d.casesave.save_value =
+						(Datum *) palloc(sizeof(Datum));
+					savestep.d.casesave.save_isnull =
+						(bool *) palloc(sizeof(bool));
+					ExprEvalPushStep(prog, &savestep);
+					savestep.opcode = EEOP_CASE_RESTORE;
+				}
+
+				foreach(lc, cstate->args)
+				{
+					CaseWhenState *wclause = (CaseWhenState *) lfirst(lc);
+					int			whenjump;
+
+					/* the WHEN result can use our result as workspace */
+					ExecCompileExprRec(prog, wclause->expr, resvalue, resnull);
+					step.opcode = EEOP_JUMP_IF_NOT_TRUE;
+					step.d.jump.jumpdone = -1;	/* fixed below */
+					whenjump = ExprEvalPushStep(prog, &step);
+
+					if (cstate->arg)
+						ExprEvalPushStep(prog, &savestep);
+					ExecCompileExprRec(prog, wclause->result,
+									   resvalue, resnull);
+					step.opcode = EEOP_JUMP;
+					jumps = lappend_int(jumps, ExprEvalPushStep(prog, &step));
+
+					prog->steps[whenjump].d.jump.jumpdone = prog->nsteps;
+				}
+
+				if (cstate->arg)
+					ExprEvalPushStep(prog, &savestep);
+				if (cstate->defresult)
+					ExecCompileExprRec(prog, cstate->defresult,
+									   resvalue, resnull);
+				else
+				{
+					step.opcode = EEOP_CONST;
+					step.d.constval.value = (Datum) 0;
+					step.d.constval.isnull = true;
+					ExprEvalPushStep(prog, &step);
+				}
+
+				foreach(lc, jumps)
+					prog->steps[lfirst_int(lc)].d.jump.jumpdone = prog->nsteps;
+				list_free(jumps);
+				return;
+			}
+
+		case T_CoalesceExpr:
+			{
+				CoalesceExprState *cstate = (CoalesceExprState *) state;
+				List	   *jumps = NIL;
+				ListCell   *lc;
+
+				/* stop at the first non-null argument */
+				foreach(lc, cstate->args)
+				{
+					ExecCompileExprRec(prog, (ExprState *) lfirst(lc),
+									   resvalue, resnull);
+					if (lnext(lc) != NULL)
+					{
+						step.opcode = EEOP_JUMP_IF_NOT_NULL;
+						step.d.jump.jumpdone = -1;	/* fixed below */
+						jumps = lappend_int(jumps,
+											ExprEvalPushStep(prog, &step));
+					}
+				}
+
+				foreach(lc, jumps)
+					prog->steps[lfirst_int(lc)].d.jump.jumpdone = prog->nsteps;
+				list_free(jumps);
+				return;
+			}
+
+		default:
+			break;
+	}
+
+	/* Anything else is evaluated by the recursive routines */
+	step.opcode = EEOP_GENERIC;
+	step.d.generic.state = state;
+	ExprEvalPushStep(prog, &step);
+}
+
+/*
+ * ExecCompileExpr: flatten a top-level expression into an ExprEvalProgram,
+ * if that looks worthwhile, and make ExecEvalExpr run the program.
+ *
+ * If the plan is expensive enough, the JIT provider then gets a chance to
+ * turn the program into native code.
+ */
+static void
+ExecCompileExpr(ExprState *state, PlanState *parent)
+{
+	ExprEvalProgram *prog;
+	ExprEvalStep step;
+
+	if (state == NULL)
+		return;
+
+	/* For a targetlist entry, it's the expression being projected */
+	if (IsA(state, GenericExprState) && IsA(state->expr, TargetEntry))
+	{
+		state = ((GenericExprState *) state)->arg;
+		if (state == NULL)
+			return;
+	}
+
+	/*
+	 * Only do it if there's something for the program to do inline; a lone
+	 * Var, for example, is evaluated just as fast by ExecEvalScalarVarFast.
+	 */
+	switch (nodeTag(state->expr))
+	{
+		case T_FuncExpr:
+		case T_OpExpr:
+		case T_BoolExpr:
+		case T_NullTest:
+		case T_CaseExpr:
+		case T_CoalesceExpr:
+			break;
+		default:
+			return;
+	}
+
+	/* Sets are left to the recursive routines */
+	if (expression_returns_set((Node *) state->expr))
+		return;
+
+	prog = (ExprEvalProgram *) palloc0(sizeof(ExprEvalProgram));
+	prog->maxsteps = 16;
+	prog->steps = (ExprEvalStep *) palloc(prog->maxsteps * sizeof(ExprEvalStep));
+
+	ExecCompileExprRec(prog, state, &prog->resvalue, &prog->resnull);
+
+	/*
+	 * If the root node turned out not to be inlinable after all, the program
+	 * is a single GENERIC step that would call us right back.
+	 */
+	if (prog->nsteps == 1 && prog->steps[0].opcode == EEOP_GENERIC)
+	{
+		pfree(prog->steps);
+		pfree(prog);
+		return;
+	}
+
+	memset(&step, 0, sizeof(step));
+	step.opcode = EEOP_DONE;
+	ExprEvalPushStep(prog, &step);
+
+	state->program = prog;
+	state->evalfunc = ExecEvalProgram;
+
+	(void) jit_compile_expr(state, parent);
+}
+
+/*
+ * ExecBuildAggTrans: build the program that advances the aggregates of an
+ * Agg node for one input tuple, which is in aggstate->tmpcontext's outer
+ * tuple.
+ *
+ * For each aggregate, the arguments are computed straight into the
+ * transition function's fcinfo, followed by a step calling the function on
+ * the transValue of the aggregate's entry in aggstate->curpergroup.
+ * Aggregates with DISTINCT or ORDER BY are left out, since their input goes
+ * through a sort first; returns NULL if that leaves none.
+ *
+ * The program must be run in the per-tuple memory of aggstate->tmpcontext,
+ * where the transition functions expect to be called.
+ */
+ExprState *
+ExecBuildAggTrans(AggState *aggstate)
+{
+	ExprState  *state;
+	ExprEvalProgram *prog;
+	ExprEvalStep step;
+	int			aggno;
+
+	prog = (ExprEvalProgram *) palloc0(sizeof(ExprEvalProgram));
+	prog->maxsteps = 16;
+	prog->steps = (ExprEvalStep *) palloc(prog->maxsteps * sizeof(ExprEvalStep));
+
+	for (aggno = 0; aggno < aggstate->numaggs; aggno++)
+	{
+		AggStatePerAgg peraggstate = &aggstate->peragg[aggno];
+		FunctionCallInfo fcinfo = &peraggstate->transfn_fcinfo;
+		ListCell   *lc;
+		int			argno;
+
+		if (peraggstate->numSortCols > 0)
+			continue;
+
+		InitFunctionCallInfoData(*fcinfo, &peraggstate->transfn,
+								 peraggstate->numArguments + 1,
+								 peraggstate->aggCollation,
+								 (void *) aggstate, NULL);
+
+		/* without sorting, there are no resjunk inputs */
+		Assert(peraggstate->numInputs == peraggstate->numArguments);
+		argno = 1;
+		foreach(lc, peraggstate->aggrefstate->args)
+		{
+			GenericExprState *tlestate = (GenericExprState *) lfirst(lc);
+
+			ExecCompileExprRec(prog, tlestate->arg,
+							   &fcinfo->arg[argno], &fcinfo->argnull[argno]);
+			argno++;
+		}
+
+		memset(&step, 0, sizeof(step));
+		step.opcode = peraggstate->transfn.fn_strict ?
+			EEOP_AGG_STRICT_TRANS : EEOP_AGG_TRANS;
+		step.resvalue = &prog->resvalue;
+		step.resnull = &prog->resnull;
+		step.d.aggtrans.aggstate = aggstate;
+		step.d.aggtrans.aggno = aggno;
+		step.d.aggtrans.fcinfo = fcinfo;
+		step.d.aggtrans.nargs = peraggstate->numArguments;
+		step.d.aggtrans.transtypeLen = peraggstate->transtypeLen;
+		step.d.aggtrans.transtypeByVal = peraggstate->transtypeByVal;
+		ExprEvalPushStep(prog, &step);
+	}
+
+	if (prog->nsteps == 0)
+	{
+		pfree(prog->steps);
+		pfree(prog);
+		return NULL;
+	}
+
+	memset(&step, 0, sizeof(step));
+	step.opcode = EEOP_DONE;
+	ExprEvalPushStep(prog, &step);
+
+	state = makeNode(ExprState);
+	state->program = prog;
+	state->evalfunc = ExecEvalProgram;
+
+	(void) jit_compile_expr(state, &aggstate->ss.ps);
+
+	return state;
+}
+
+#ifdef EEO_USE_COMPUTED_GOTO
+#define EEO_SWITCH()
+#define EEO_CASE(name)		CASE_##name:
+#define EEO_DISPATCH()		goto *dispatch_table[op->opcode]
+#else
+#define EEO_SWITCH()		starteval: switch (op->opcode)
+#define EEO_CASE(name)		case name:
+#define EEO_DISPATCH()		goto starteval
+#endif
+
+#define EEO_NEXT() \
+	do { \
+		op++; \
+		EEO_DISPATCH(); \
+	} while (0)
+
+#define EEO_JUMP(stepno) \
+	do { \
+		op = &prog->steps[stepno]; \
+		EEO_DISPATCH(); \
+	} while (0)
+
+/* ----------------------------------------------------------------
+ *		ExecEvalProgram
+ *
+ *		Evaluate an expression that has been flattened by ExecCompileExpr.
+ * ----------------------------------------------------------------
+ */
+static Datum
+ExecEvalProgram(ExprState *exprstate, ExprContext *econtext,
+				bool *isNull, ExprDoneCond *isDone)
+{
+	ExprEvalProgram *prog = exprstate->program;
+	ExprEvalStep *op = prog->steps;
+	TupleTableSlot *innerslot = econtext->ecxt_innertuple;
+	TupleTableSlot *outerslot = econtext->ecxt_outertuple;
+	TupleTableSlot *scanslot = econtext->ecxt_scantuple;
+
+#ifdef EEO_USE_COMPUTED_GOTO
+	static const void *const dispatch_table[] = {
+		&&CASE_EEOP_DONE,
+		&&CASE_EEOP_INNER_VAR_FIRST,
+		&&CASE_EEOP_INNER_VAR,
+		&&CASE_EEOP_OUTER_VAR_FIRST,
+		&&CASE_EEOP_OUTER_VAR,
+		&&CASE_EEOP_SCAN_VAR_FIRST,
+		&&CASE_EEOP_SCAN_VAR,
+		&&CASE_EEOP_CONST,
+		&&CASE_EEOP_CASE_TESTVAL,
+		&&CASE_EEOP_FUNCEXPR_INIT,
+		&&CASE_EEOP_FUNCEXPR,
+		&&CASE_EEOP_FUNCEXPR_STRICT,
+		&&CASE_EEOP_BOOL_AND_STEP_FIRST,
+		&&CASE_EEOP_BOOL_AND_STEP,
+		&&CASE_EEOP_BOOL_AND_STEP_LAST,
+		&&CASE_EEOP_BOOL_OR_STEP_FIRST,
+		&&CASE_EEOP_BOOL_OR_STEP,
+		&&CASE_EEOP_BOOL_OR_STEP_LAST,
+		&&CASE_EEOP_BOOL_NOT,
+		&&CASE_EEOP_NULLTEST_ISNULL,
+		&&CASE_EEOP_NULLTEST_ISNOTNULL,
+		&&CASE_EEOP_JUMP,
+		&&CASE_EEOP_JUMP_IF_NOT_TRUE,
+		&&CASE_EEOP_JUMP_IF_NOT_NULL,
+		&&CASE_EEOP_CASE_SETVAL,
+		&&CASE_EEOP_CASE_RESTORE,
+		&&CASE_EEOP_AGG_STRICT_TRANS,
+		&&CASE_EEOP_AGG_TRANS,
+		&&CASE_EEOP_GENERIC
+	};
+
+	StaticAssertStmt(lengthof(dispatch_table) == EEOP_LAST,
+					 "dispatch_table out of whack with ExprEvalOp");
+#endif
+
+	/* Guard against stack overflow, as ExecMakeFunctionResult would */
+	check_stack_depth();
+
+	if (isDone)
+		*isDone = ExprSingleResult;
+
+	/*
+	 * Extract all the attributes referenced by Var steps up front, with one
+	 * slot_getsomeattrs call per slot.
+	 */
+	if (prog->last_inner > 0)
+		slot_getsomeattrs(innerslot, prog->last_inner);
+	if (prog->last_outer > 0)
+		slot_getsomeattrs(outerslot, prog->last_outer);
+	if (prog->last_scan > 0)
+		slot_getsomeattrs(scanslot, prog->last_scan);
+
+	EEO_DISPATCH();
+
+	EEO_SWITCH()
+	{
+		EEO_CASE(EEOP_DONE)
+		{
+			*isNull = prog->resnull;
+			return prog->resvalue;
+		}
+
+		EEO_CASE(EEOP_INNER_VAR_FIRST)
+		{
+			CheckVarSlotCompatibility(innerslot, op->d.var.attnum + 1,
+									  op->d.var.vartype);
+			op->opcode = EEOP_INNER_VAR;
+			/* FALL THRU */
+		}
+
+		EEO_CASE(EEOP_INNER_VAR)
+		{
+			int			attnum = op->d.var.attnum;
+
+			*op->resvalue = innerslot->tts_values[attnum];
+			*op->resnull = innerslot->tts_isnull[attnum];
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_OUTER_VAR_FIRST)
+		{
+			CheckVarSlotCompatibility(outerslot, op->d.var.attnum + 1,
+									  op->d.var.vartype);
+			op->opcode = EEOP_OUTER_VAR;
+			/* FALL THRU */
+		}
+
+		EEO_CASE(EEOP_OUTER_VAR)
+		{
+			int			attnum = op->d.var.attnum;
+
+			*op->resvalue = outerslot->tts_values[attnum];
+			*op->resnull = outerslot->tts_isnull[attnum];
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_SCAN_VAR_FIRST)
+		{
+			CheckVarSlotCompatibility(scanslot, op->d.var.attnum + 1,
+									  op->d.var.vartype);
+			op->opcode = EEOP_SCAN_VAR;
+			/* FALL THRU */
+		}
+
+		EEO_CASE(EEOP_SCAN_VAR)
+		{
+			int			attnum = op->d.var.attnum;
+
+			*op->resvalue = scanslot->tts_values[attnum];
+			*op->resnull = scanslot->tts_isnull[attnum];
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_CONST)
+		{
+			*op->resvalue = op->d.constval.value;
+			*op->resnull = op->d.constval.isnull;
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_CASE_TESTVAL)
+		{
+			*op->resvalue = econtext->caseValue_datum;
+			*op->resnull = econtext->caseValue_isNull;
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_FUNCEXPR_INIT)
+		{
+			/* this rewrites the step's opcode to the right kind of call */
+			ExecEvalFuncExprInit(op, econtext);
+			EEO_DISPATCH();
+		}
+
+		EEO_CASE(EEOP_FUNCEXPR_STRICT)
+		{
+			FunctionCallInfo fcinfo = &op->d.func.fcache->fcinfo_data;
+			int			i;
+
+			/*
+			 * If the function is strict and there are any NULL arguments,
+			 * skip calling it and return NULL.
+			 */
+			for (i = 0; i < op->d.func.nargs; i++)
+			{
+				if (fcinfo->argnull[i])
+				{
+					*op->resvalue = (Datum) 0;
+					*op->resnull = true;
+					EEO_NEXT();
+				}
+			}
+			/* FALL THRU */
+		}
+
+		EEO_CASE(EEOP_FUNCEXPR)
+		{
+			FunctionCallInfo fcinfo = &op->d.func.fcache->fcinfo_data;
+			PgStat_FunctionCallUsage fcusage;
+
+			pgstat_init_function_usage(fcinfo, &fcusage);
+
+			fcinfo->isnull = false;
+			*op->resvalue = FunctionCallInvoke(fcinfo);
+			*op->resnull = fcinfo->isnull;
+
+			pgstat_end_function_usage(&fcusage, true);
+			EEO_NEXT();
+		}
+
+		/*
+		 * The arguments of an AND are all evaluated into its result, each one
+		 * followed by a step that checks it.  If we find a FALSE result, we
+		 * can stop and return FALSE.  If some arguments yield NULL but none
+		 * yield FALSE, the result is NULL.
+		 */
+		EEO_CASE(EEOP_BOOL_AND_STEP_FIRST)
+		{
+			*op->d.boolexpr.anynull = false;
+			/* FALL THRU */
+		}
+
+		EEO_CASE(EEOP_BOOL_AND_STEP)
+		{
+			if (*op->resnull)
+				*op->d.boolexpr.anynull = true;
+			else if (!DatumGetBool(*op->resvalue))
+				EEO_JUMP(op->d.boolexpr.jumpdone);	/* result is FALSE */
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_BOOL_AND_STEP_LAST)
+		{
+			if (*op->resnull)
+				;				/* result is NULL */
+			else if (!DatumGetBool(*op->resvalue))
+				;				/* result is FALSE */
+			else if (*op->d.boolexpr.anynull)
+			{
+				*op->resvalue = (Datum) 0;
+				*op->resnull = true;
+			}
+			EEO_NEXT();
+		}
+
+		/* Likewise for OR, with the roles of TRUE and FALSE reversed */
+		EEO_CASE(EEOP_BOOL_OR_STEP_FIRST)
+		{
+			*op->d.boolexpr.anynull = false;
+			/* FALL THRU */
+		}
+
+		EEO_CASE(EEOP_BOOL_OR_STEP)
+		{
+			if (*op->resnull)
+				*op->d.boolexpr.anynull = true;
+			else if (DatumGetBool(*op->resvalue))
+				EEO_JUMP(op->d.boolexpr.jumpdone);	/* result is TRUE */
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_BOOL_OR_STEP_LAST)
+		{
+			if (*op->resnull)
+				;				/* result is NULL */
+			else if (DatumGetBool(*op->resvalue))
+				;				/* result is TRUE */
+			else if (*op->d.boolexpr.anynull)
+			{
+				*op->resvalue = (Datum) 0;
+				*op->resnull = true;
+			}
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_BOOL_NOT)
+		{
+			/* NOT NULL is NULL, and the argument's result is in place */
+			if (!*op->resnull)
+				*op->resvalue = BoolGetDatum(!DatumGetBool(*op->resvalue));
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_NULLTEST_ISNULL)
+		{
+			*op->resvalue = BoolGetDatum(*op->resnull);
+			*op->resnull = false;
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_NULLTEST_ISNOTNULL)
+		{
+			*op->resvalue = BoolGetDatum(!*op->resnull);
+			*op->resnull = false;
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_JUMP)
+		{
+			EEO_JUMP(op->d.jump.jumpdone);
+		}
+
+		EEO_CASE(EEOP_JUMP_IF_NOT_TRUE)
+		{
+			/* a NULL result is not considered true */
+			if (*op->resnull || !DatumGetBool(*op->resvalue))
+				EEO_JUMP(op->d.jump.jumpdone);
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_JUMP_IF_NOT_NULL)
+		{
+			if (!*op->resnull)
+				EEO_JUMP(op->d.jump.jumpdone);
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_CASE_SETVAL)
+		{
+			*op->d.casesave.save_value = econtext->caseValue_datum;
+			*op->d.casesave.save_isnull = econtext->caseValue_isNull;
+			econtext->caseValue_datum = *op->resvalue;
+			econtext->caseValue_isNull = *op->resnull;
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_CASE_RESTORE)
+		{
+			econtext->caseValue_datum = *op->d.casesave.save_value;
+			econtext->caseValue_isNull = *op->d.casesave.save_isnull;
+			EEO_NEXT();
+		}
+
+		/*
+		 * For a strict transition function, nothing happens when there's a
+		 * NULL input; we just keep the prior transValue.  The first non-NULL
+		 * input of a group without an initial value becomes its transValue.
+		 */
+		EEO_CASE(EEOP_AGG_STRICT_TRANS)
+		{
+			FunctionCallInfo fcinfo = op->d.aggtrans.fcinfo;
+			AggStatePerGroup pergroup;
+			int			i;
+
+			for (i = 1; i <= op->d.aggtrans.nargs; i++)
+			{
+				if (fcinfo->argnull[i])
+					EEO_NEXT();
+			}
+
+			pergroup = &op->d.aggtrans.aggstate->curpergroup[op->d.aggtrans.aggno];
+			if (pergroup->noTransValue)
+			{
+				ExecAggInitGroup(op, pergroup);
+				EEO_NEXT();
+			}
+
+			/*
+			 * Don't call a strict function with a NULL transValue, which it
+			 * returned on a prior cycle; the NULL stays to the end.
+			 */
+			if (pergroup->transValueIsNull)
+				EEO_NEXT();
+			/* FALL THRU */
+		}
+
+		EEO_CASE(EEOP_AGG_TRANS)
+		{
+			FunctionCallInfo fcinfo = op->d.aggtrans.fcinfo;
+			AggStatePerGroup pergroup;
+			Datum		newVal;
+
+			pergroup = &op->d.aggtrans.aggstate->curpergroup[op->d.aggtrans.aggno];
+			fcinfo->arg[0] = pergroup->transValue;
+			fcinfo->argnull[0] = pergroup->transValueIsNull;
+			fcinfo->isnull = false;
+
+			newVal = FunctionCallInvoke(fcinfo);
+
+			if (!op->d.aggtrans.transtypeByVal)
+				newVal = ExecAggTransReparent(op, pergroup, newVal);
+			pergroup->transValue = newVal;
+			pergroup->transValueIsNull = fcinfo->isnull;
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_GENERIC)
+		{
+			*op->resvalue = ExecEvalExpr(op->d.generic.state, econtext,
+										 op->resnull, NULL);
+			EEO_NEXT();
+		}
+
+#ifndef EEO_USE_COMPUTED_GOTO
+		default:
+			elog(ERROR, "unrecognized expression step: %d",
+				 (int) op->opcode);
+#endif
+	}
+
+	return (Datum) 0;			/* keep compiler quiet */
+}
+
 
 /*
  * ExecEvalExprSwitchContext
@@ -4356,12 +5372,38 @@ ExecEvalExprSwitchContext(ExprState *expression,
  * 'parent' may be NULL if we are preparing an expression that is not
  * associated with a plan tree.  (If so, it can't have aggs or subplans.)
  * This case should usually come through ExecPrepareExpr, not directly here.
+ *
+ * If 'node' is a List, as for quals and targetlists, each member expression
+ * is flattened into its own program by ExecCompileExpr.
  */
 ExprState *
 ExecInitExpr(Expr *node, PlanState *parent)
 {
 	ExprState  *state;
 
+	state = ExecInitExprRec(node, parent);
+
+	if (state != NULL && IsA(state, List))
+	{
+		ListCell   *l;
+
+		foreach(l, (List *) state)
+			ExecCompileExpr((ExprState *) lfirst(l), parent);
+	}
+	else
+		ExecCompileExpr(state, parent);
+
+	return state;
+}
+
+/*
+ * ExecInitExprRec: guts of ExecInitExpr, building the ExprState tree
+ */
+static ExprState *
+ExecInitExprRec(Expr *node, PlanState *parent)
+{
+	ExprState  *state;
+
 	if (node == NULL)
 		return NULL;
 
@@ -4429,7 +5471,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 					aggstate->aggs = lcons(astate, aggstate->aggs);
 					naggs = ++aggstate->numaggs;
 
-					astate->args = (List *) ExecInitExpr((Expr *) aggref->args,
+					astate->args = (List *) ExecInitExprRec((Expr *) aggref->args,
 														 parent);
 
 					/*
@@ -4467,7 +5509,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 					if (wfunc->winagg)
 						winstate->numaggs++;
 
-					wfstate->args = (List *) ExecInitExpr((Expr *) wfunc->args,
+					wfstate->args = (List *) ExecInitExprRec((Expr *) wfunc->args,
 														  parent);
 
 					/*
@@ -4496,11 +5538,11 @@ ExecInitExpr(Expr *node, PlanState *parent)
 
 				astate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalArrayRef;
 				astate->refupperindexpr = (List *)
-					ExecInitExpr((Expr *) aref->refupperindexpr, parent);
+					ExecInitExprRec((Expr *) aref->refupperindexpr, parent);
 				astate->reflowerindexpr = (List *)
-					ExecInitExpr((Expr *) aref->reflowerindexpr, parent);
-				astate->refexpr = ExecInitExpr(aref->refexpr, parent);
-				astate->refassgnexpr = ExecInitExpr(aref->refassgnexpr,
+					ExecInitExprRec((Expr *) aref->reflowerindexpr, parent);
+				astate->refexpr = ExecInitExprRec(aref->refexpr, parent);
+				astate->refassgnexpr = ExecInitExprRec(aref->refassgnexpr,
 													parent);
 				/* do one-time catalog lookups for type info */
 				astate->refattrlength = get_typlen(aref->refarraytype);
@@ -4518,7 +5560,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 
 				fstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalFunc;
 				fstate->args = (List *)
-					ExecInitExpr((Expr *) funcexpr->args, parent);
+					ExecInitExprRec((Expr *) funcexpr->args, parent);
 				fstate->func.fn_oid = InvalidOid;		/* not initialized */
 				state = (ExprState *) fstate;
 			}
@@ -4530,7 +5572,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 
 				fstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalOper;
 				fstate->args = (List *)
-					ExecInitExpr((Expr *) opexpr->args, parent);
+					ExecInitExprRec((Expr *) opexpr->args, parent);
 				fstate->func.fn_oid = InvalidOid;		/* not initialized */
 				state = (ExprState *) fstate;
 			}
@@ -4542,7 +5584,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 
 				fstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalDistinct;
 				fstate->args = (List *)
-					ExecInitExpr((Expr *) distinctexpr->args, parent);
+					ExecInitExprRec((Expr *) distinctexpr->args, parent);
 				fstate->func.fn_oid = InvalidOid;		/* not initialized */
 				state = (ExprState *) fstate;
 			}
@@ -4554,7 +5596,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 
 				fstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalNullIf;
 				fstate->args = (List *)
-					ExecInitExpr((Expr *) nullifexpr->args, parent);
+					ExecInitExprRec((Expr *) nullifexpr->args, parent);
 				fstate->func.fn_oid = InvalidOid;		/* not initialized */
 				state = (ExprState *) fstate;
 			}
@@ -4566,7 +5608,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 
 				sstate->fxprstate.xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalScalarArrayOp;
 				sstate->fxprstate.args = (List *)
-					ExecInitExpr((Expr *) opexpr->args, parent);
+					ExecInitExprRec((Expr *) opexpr->args, parent);
 				sstate->fxprstate.func.fn_oid = InvalidOid;		/* not initialized */
 				sstate->element_type = InvalidOid;		/* ditto */
 				state = (ExprState *) sstate;
@@ -4594,7 +5636,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 						break;
 				}
 				bstate->args = (List *)
-					ExecInitExpr((Expr *) boolexpr->args, parent);
+					ExecInitExprRec((Expr *) boolexpr->args, parent);
 				state = (ExprState *) bstate;
 			}
 			break;
@@ -4633,7 +5675,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				FieldSelectState *fstate = makeNode(FieldSelectState);
 
 				fstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalFieldSelect;
-				fstate->arg = ExecInitExpr(fselect->arg, parent);
+				fstate->arg = ExecInitExprRec(fselect->arg, parent);
 				fstate->argdesc = NULL;
 				state = (ExprState *) fstate;
 			}
@@ -4644,8 +5686,8 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				FieldStoreState *fstate = makeNode(FieldStoreState);
 
 				fstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalFieldStore;
-				fstate->arg = ExecInitExpr(fstore->arg, parent);
-				fstate->newvals = (List *) ExecInitExpr((Expr *) fstore->newvals, parent);
+				fstate->arg = ExecInitExprRec(fstore->arg, parent);
+				fstate->newvals = (List *) ExecInitExprRec((Expr *) fstore->newvals, parent);
 				fstate->argdesc = NULL;
 				state = (ExprState *) fstate;
 			}
@@ -4656,7 +5698,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				GenericExprState *gstate = makeNode(GenericExprState);
 
 				gstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalRelabelType;
-				gstate->arg = ExecInitExpr(relabel->arg, parent);
+				gstate->arg = ExecInitExprRec(relabel->arg, parent);
 				state = (ExprState *) gstate;
 			}
 			break;
@@ -4668,7 +5710,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				bool		typisvarlena;
 
 				iostate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalCoerceViaIO;
-				iostate->arg = ExecInitExpr(iocoerce->arg, parent);
+				iostate->arg = ExecInitExprRec(iocoerce->arg, parent);
 				/* lookup the result type's input function */
 				getTypeInputInfo(iocoerce->resulttype, &iofunc,
 								 &iostate->intypioparam);
@@ -4686,7 +5728,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				ArrayCoerceExprState *astate = makeNode(ArrayCoerceExprState);
 
 				astate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalArrayCoerceExpr;
-				astate->arg = ExecInitExpr(acoerce->arg, parent);
+				astate->arg = ExecInitExprRec(acoerce->arg, parent);
 				astate->resultelemtype = get_element_type(acoerce->resulttype);
 				if (astate->resultelemtype == InvalidOid)
 					ereport(ERROR,
@@ -4706,7 +5748,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				ConvertRowtypeExprState *cstate = makeNode(ConvertRowtypeExprState);
 
 				cstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalConvertRowtype;
-				cstate->arg = ExecInitExpr(convert->arg, parent);
+				cstate->arg = ExecInitExprRec(convert->arg, parent);
 				state = (ExprState *) cstate;
 			}
 			break;
@@ -4718,7 +5760,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				ListCell   *l;
 
 				cstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalCase;
-				cstate->arg = ExecInitExpr(caseexpr->arg, parent);
+				cstate->arg = ExecInitExprRec(caseexpr->arg, parent);
 				foreach(l, caseexpr->args)
 				{
 					CaseWhen   *when = (CaseWhen *) lfirst(l);
@@ -4727,12 +5769,12 @@ ExecInitExpr(Expr *node, PlanState *parent)
 					Assert(IsA(when, CaseWhen));
 					wstate->xprstate.evalfunc = NULL;	/* not used */
 					wstate->xprstate.expr = (Expr *) when;
-					wstate->expr = ExecInitExpr(when->expr, parent);
-					wstate->result = ExecInitExpr(when->result, parent);
+					wstate->expr = ExecInitExprRec(when->expr, parent);
+					wstate->result = ExecInitExprRec(when->result, parent);
 					outlist = lappend(outlist, wstate);
 				}
 				cstate->args = outlist;
-				cstate->defresult = ExecInitExpr(caseexpr->defresult, parent);
+				cstate->defresult = ExecInitExprRec(caseexpr->defresult, parent);
 				state = (ExprState *) cstate;
 			}
 			break;
@@ -4749,7 +5791,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 					Expr	   *e = (Expr *) lfirst(l);
 					ExprState  *estate;
 
-					estate = ExecInitExpr(e, parent);
+					estate = ExecInitExprRec(e, parent);
 					outlist = lappend(outlist, estate);
 				}
 				astate->elements = outlist;
@@ -4818,7 +5860,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 						 */
 						e = (Expr *) makeNullConst(INT4OID, -1, InvalidOid);
 					}
-					estate = ExecInitExpr(e, parent);
+					estate = ExecInitExprRec(e, parent);
 					outlist = lappend(outlist, estate);
 					i++;
 				}
@@ -4845,7 +5887,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 					Expr	   *e = (Expr *) lfirst(l);
 					ExprState  *estate;
 
-					estate = ExecInitExpr(e, parent);
+					estate = ExecInitExprRec(e, parent);
 					outlist = lappend(outlist, estate);
 				}
 				rstate->largs = outlist;
@@ -4856,7 +5898,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 					Expr	   *e = (Expr *) lfirst(l);
 					ExprState  *estate;
 
-					estate = ExecInitExpr(e, parent);
+					estate = ExecInitExprRec(e, parent);
 					outlist = lappend(outlist, estate);
 				}
 				rstate->rargs = outlist;
@@ -4909,7 +5951,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 					Expr	   *e = (Expr *) lfirst(l);
 					ExprState  *estate;
 
-					estate = ExecInitExpr(e, parent);
+					estate = ExecInitExprRec(e, parent);
 					outlist = lappend(outlist, estate);
 				}
 				cstate->args = outlist;
@@ -4930,7 +5972,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 					Expr	   *e = (Expr *) lfirst(l);
 					ExprState  *estate;
 
-					estate = ExecInitExpr(e, parent);
+					estate = ExecInitExprRec(e, parent);
 					outlist = lappend(outlist, estate);
 				}
 				mstate->args = outlist;
@@ -4967,7 +6009,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 					Expr	   *e = (Expr *) lfirst(arg);
 					ExprState  *estate;
 
-					estate = ExecInitExpr(e, parent);
+					estate = ExecInitExprRec(e, parent);
 					outlist = lappend(outlist, estate);
 				}
 				xstate->named_args = outlist;
@@ -4978,7 +6020,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 					Expr	   *e = (Expr *) lfirst(arg);
 					ExprState  *estate;
 
-					estate = ExecInitExpr(e, parent);
+					estate = ExecInitExprRec(e, parent);
 					outlist = lappend(outlist, estate);
 				}
 				xstate->args = outlist;
@@ -4992,7 +6034,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				NullTestState *nstate = makeNode(NullTestState);
 
 				nstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalNullTest;
-				nstate->arg = ExecInitExpr(ntest->arg, parent);
+				nstate->arg = ExecInitExprRec(ntest->arg, parent);
 				nstate->argdesc = NULL;
 				state = (ExprState *) nstate;
 			}
@@ -5003,7 +6045,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				GenericExprState *gstate = makeNode(GenericExprState);
 
 				gstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalBooleanTest;
-				gstate->arg = ExecInitExpr(btest->arg, parent);
+				gstate->arg = ExecInitExprRec(btest->arg, parent);
 				state = (ExprState *) gstate;
 			}
 			break;
@@ -5013,7 +6055,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				CoerceToDomainState *cstate = makeNode(CoerceToDomainState);
 
 				cstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalCoerceToDomain;
-				cstate->arg = ExecInitExpr(ctest->arg, parent);
+				cstate->arg = ExecInitExprRec(ctest->arg, parent);
 				cstate->constraints = GetDomainConstraints(ctest->resulttype);
 				state = (ExprState *) cstate;
 			}
@@ -5028,7 +6070,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				GenericExprState *gstate = makeNode(GenericExprState);
 
 				gstate->xprstate.evalfunc = NULL;		/* not used */
-				gstate->arg = ExecInitExpr(tle->expr, parent);
+				gstate->arg = ExecInitExprRec(tle->expr, parent);
 				state = (ExprState *) gstate;
 			}
 			break;
@@ -5040,7 +6082,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				foreach(l, (List *) node)
 				{
 					outlist = lappend(outlist,
-									  ExecInitExpr((Expr *) lfirst(l),
+									  ExecInitExprRec((Expr *) lfirst(l),
 												   parent));
 				}
 				/* Don't fall through to the "common" code below */
@@ -46,6 +46,7 @@
 #include "access/transam.h"
 #include "catalog/index.h"
 #include "executor/execdebug.h"
+#include "jit/jit.h"
 #include "nodes/nodeFuncs.h"
 #include "parser/parsetree.h"
 #include "storage/lmgr.h"
@@ -139,6 +140,9 @@ CreateExecutorState(void)
 	estate->es_instrument = 0;
 	estate->es_finished = false;
 
+	estate->es_jit_flags = PGJIT_NONE;
+	estate->es_jit = NULL;
+
 	estate->es_exprcontexts = NIL;
 
 	estate->es_subplanstates = NIL;
@@ -194,6 +198,13 @@ FreeExecutorState(EState *estate)
 		/* FreeExprContext removed the list link for us */
 	}
 
+	/* release JIT context, if allocated */
+	if (estate->es_jit)
+	{
+		jit_release_context(estate->es_jit);
+		estate->es_jit = NULL;
+	}
+
 	/*
 	 * Free the per-query memory context, thereby releasing all working
 	 * memory, including the EState node itself.
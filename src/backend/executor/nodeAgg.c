@@ -56,12 +56,23 @@
  *	  but in the aggregate case we know the left input is either the initial
  *	  transition value or a previous function result, and in either case its
  *	  value need not be preserved.	See int8inc() for an example.  Notice that
- *	  advance_transition_function() is coded to avoid a data copy step when
+ *	  the transition steps (see ExecBuildAggTrans) and
+ *	  advance_transition_function() are coded to avoid a data copy step when
  *	  the previous transition value pointer is returned.  Also, some
  *	  transition functions want to store working state in addition to the
  *	  nominal transition value; they can use the memory context returned by
  *	  AggCheckCallContext() to do that.
  *
+ *	  In AGG_HASHED mode, the hash table is limited to work_mem.  Once it
+ *	  reaches that size we stop adding new groups to it: input tuples that
+ *	  belong to groups already in the table are still aggregated in memory,
+ *	  but the others are written out to one of several batch files,
+ *	  partitioned on their hash value.  When the input is exhausted, we
+ *	  emit the groups in the hash table, empty it, and then process each
+ *	  batch file as if it were the input, recursively spilling again with
+ *	  different hash bits if need be.  Transition values are never written
+ *	  out, so every group is aggregated completely within a single pass.
+ *
  *	  Note: AggCheckCallContext() is available as of PostgreSQL 9.0.  The
  *	  AggState is available as context in earlier releases (back to 8.1),
  *	  but direct examination of the node is needed to use it before 9.0.
@@ -91,6 +102,7 @@
 #include "optimizer/tlist.h"
 #include "parser/parse_agg.h"
 #include "parser/parse_coerce.h"
+#include "storage/buffile.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
@@ -100,144 +112,6 @@
 #include "utils/datum.h"
 
 
-/*
- * AggStatePerAggData - per-aggregate working state for the Agg scan
- */
-typedef struct AggStatePerAggData
-{
-	/*
-	 * These values are set up during ExecInitAgg() and do not change
-	 * thereafter:
-	 */
-
-	/* Links to Aggref expr and state nodes this working state is for */
-	AggrefExprState *aggrefstate;
-	Aggref	   *aggref;
-
-	/* number of input arguments for aggregate function proper */
-	int			numArguments;
-
-	/* number of inputs including ORDER BY expressions */
-	int			numInputs;
-
-	/* Oids of transfer functions */
-	Oid			transfn_oid;
-	Oid			finalfn_oid;	/* may be InvalidOid */
-
-	/*
-	 * fmgr lookup data for transfer functions --- only valid when
-	 * corresponding oid is not InvalidOid.  Note in particular that fn_strict
-	 * flags are kept here.
-	 */
-	FmgrInfo	transfn;
-	FmgrInfo	finalfn;
-
-	/* Input collation derived for aggregate */
-	Oid			aggCollation;
-
-	/* number of sorting columns */
-	int			numSortCols;
-
-	/* number of sorting columns to consider in DISTINCT comparisons */
-	/* (this is either zero or the same as numSortCols) */
-	int			numDistinctCols;
-
-	/* deconstructed sorting information (arrays of length numSortCols) */
-	AttrNumber *sortColIdx;
-	Oid		   *sortOperators;
-	Oid		   *sortCollations;
-	bool	   *sortNullsFirst;
-
-	/*
-	 * fmgr lookup data for input columns' equality operators --- only
-	 * set/used when aggregate has DISTINCT flag.  Note that these are in
-	 * order of sort column index, not parameter index.
-	 */
-	FmgrInfo   *equalfns;		/* array of length numDistinctCols */
-
-	/*
-	 * initial value from pg_aggregate entry
-	 */
-	Datum		initValue;
-	bool		initValueIsNull;
-
-	/*
-	 * We need the len and byval info for the agg's input, result, and
-	 * transition data types in order to know how to copy/delete values.
-	 *
-	 * Note that the info for the input type is used only when handling
-	 * DISTINCT aggs with just one argument, so there is only one input type.
-	 */
-	int16		inputtypeLen,
-				resulttypeLen,
-				transtypeLen;
-	bool		inputtypeByVal,
-				resulttypeByVal,
-				transtypeByVal;
-
-	/*
-	 * Stuff for evaluation of inputs.	We used to just use ExecEvalExpr, but
-	 * with the addition of ORDER BY we now need at least a slot for passing
-	 * data to the sort object, which requires a tupledesc, so we might as
-	 * well go whole hog and use ExecProject too.
-	 */
-	TupleDesc	evaldesc;		/* descriptor of input tuples */
-	ProjectionInfo *evalproj;	/* projection machinery */
-
-	/*
-	 * Slots for holding the evaluated input arguments.  These are set up
-	 * during ExecInitAgg() and then used for each input row.
-	 */
-	TupleTableSlot *evalslot;	/* current input tuple */
-	TupleTableSlot *uniqslot;	/* used for multi-column DISTINCT */
-
-	/*
-	 * These values are working state that is initialized at the start of an
-	 * input tuple group and updated for each input tuple.
-	 *
-	 * For a simple (non DISTINCT/ORDER BY) aggregate, we just feed the input
-	 * values straight to the transition function.	If it's DISTINCT or
-	 * requires ORDER BY, we pass the input values into a Tuplesort object;
-	 * then at completion of the input tuple group, we scan the sorted values,
-	 * eliminate duplicates if needed, and run the transition function on the
-	 * rest.
-	 */
-
-	Tuplesortstate *sortstate;	/* sort object, if DISTINCT or ORDER BY */
-}	AggStatePerAggData;
-
-/*
- * AggStatePerGroupData - per-aggregate-per-group working state
- *
- * These values are working state that is initialized at the start of
- * an input tuple group and updated for each input tuple.
- *
- * In AGG_PLAIN and AGG_SORTED modes, we have a single array of these
- * structs (pointed to by aggstate->pergroup); we re-use the array for
- * each input group, if it's AGG_SORTED mode.  In AGG_HASHED mode, the
- * hash table contains an array of these structs for each tuple group.
- *
- * Logically, the sortstate field belongs in this struct, but we do not
- * keep it here for space reasons: we don't support DISTINCT aggregates
- * in AGG_HASHED mode, so there's no reason to use up a pointer field
- * in every entry of the hashtable.
- */
-typedef struct AggStatePerGroupData
-{
-	Datum		transValue;		/* current transition value */
-	bool		transValueIsNull;
-
-	bool		noTransValue;	/* true if transValue not set yet */
-
-	/*
-	 * Note: noTransValue initially has the same value as transValueIsNull,
-	 * and if true both are cleared to false at the same time.	They are not
-	 * the same though: if transfn later returns a NULL, we want to keep that
-	 * NULL and not auto-replace it with a later input value. Only the first
-	 * non-NULL input will be auto-substituted.
-	 */
-} AggStatePerGroupData;
-
 /*
  * To implement hashed aggregation, we need a hashtable that stores a
  * representative tuple and an array of AggStatePerGroup structs for each
@@ -253,6 +127,22 @@ typedef struct AggHashEntryData
 	AggStatePerGroupData pergroup[1];	/* VARIABLE LENGTH ARRAY */
 }	AggHashEntryData;	/* VARIABLE LENGTH STRUCT */
 
+/*
+ * When the hash table overflows work_mem, tuples for groups that are not
+ * in the table are spilled to 2^hash_partition_bits batch files, chosen by
+ * successive bits of the grouping columns' hash value, starting from the
+ * most significant ones.  Each batch file is later read back as the input
+ * to a fresh hash table.
+ */
+#define HASHAGG_MIN_PARTITION_BITS	2
+#define HASHAGG_MAX_PARTITION_BITS	5
+
+typedef struct HashAggBatch
+{
+	BufFile    *file;			/* spilled input tuples */
+	int			level;			/* number of times these were spilled */
+} HashAggBatch;
+
 
 static void initialize_aggregates(AggState *aggstate,
 					  AggStatePerAgg peragg,
@@ -277,6 +167,13 @@ static bool find_unaggregated_cols_walker(Node *node, Bitmapset **colnos);
 static void build_hash_table(AggState *aggstate);
 static AggHashEntry lookup_hash_entry(AggState *aggstate,
 				  TupleTableSlot *inputslot);
+static void hash_check_memory(AggState *aggstate);
+static uint32 hash_group_value(AggState *aggstate, TupleTableSlot *hashslot);
+static void hash_spill_tuple(AggState *aggstate, TupleTableSlot *inputslot);
+static TupleTableSlot *hash_read_spilled_tuple(AggState *aggstate);
+static void hash_finish_pass(AggState *aggstate);
+static bool hash_next_batch(AggState *aggstate);
+static void hash_reset_spill_state(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_direct(AggState *aggstate);
 static void agg_fill_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table(AggState *aggstate);
@@ -365,7 +262,9 @@ initialize_aggregates(AggState *aggstate,
 }
 
 /*
- * Given new input value(s), advance the transition function of an aggregate.
+ * Given new input value(s), advance the transition function of a DISTINCT or
+ * ORDER BY aggregate.  (The others are advanced by aggstate->evaltrans, whose
+ * transition steps do the same as this.)
  *
  * The new values (and null flags) have been preloaded into argument positions
  * 1 and up in fcinfo, so that we needn't copy them again to pass to the
@@ -473,6 +372,11 @@ advance_transition_function(AggState *aggstate,
  * to ExecEvalExpr.  pergroup is the array of per-group structs to use
  * (this might be in a hashtable entry).
  *
+ * The aggregates without DISTINCT or ORDER BY are advanced by the program
+ * built by ExecBuildAggTrans, which computes their inputs and applies the
+ * transition functions right away.  The others have their inputs put into
+ * the sort object here.
+ *
  * When called, CurrentMemoryContext should be the per-query context.
  */
 static void
@@ -480,65 +384,55 @@ advance_aggregates(AggState *aggstate, AggStatePerGroup pergroup)
 {
 	int			aggno;
 
+	if (aggstate->evaltrans != NULL)
+	{
+		bool		isnull;
+
+		aggstate->curpergroup = pergroup;
+		(void) ExecEvalExprSwitchContext(aggstate->evaltrans,
+										 aggstate->tmpcontext,
+										 &isnull, NULL);
+	}
+
 	for (aggno = 0; aggno < aggstate->numaggs; aggno++)
 	{
 		AggStatePerAgg peraggstate = &aggstate->peragg[aggno];
-		AggStatePerGroup pergroupstate = &pergroup[aggno];
 		int			nargs = peraggstate->numArguments;
 		int			i;
 		TupleTableSlot *slot;
 
+		if (peraggstate->numSortCols == 0)
+			continue;
+
 		/* Evaluate the current input expressions for this aggregate */
 		slot = ExecProject(peraggstate->evalproj, NULL);
+		Assert(slot->tts_nvalid == peraggstate->numInputs);
 
-		if (peraggstate->numSortCols > 0)
-		{
-			/* DISTINCT and/or ORDER BY case */
-			Assert(slot->tts_nvalid == peraggstate->numInputs);
-
-			/*
-			 * If the transfn is strict, we want to check for nullity before
-			 * storing the row in the sorter, to save space if there are a lot
-			 * of nulls.  Note that we must only check numArguments columns,
-			 * not numInputs, since nullity in columns used only for sorting
-			 * is not relevant here.
-			 */
-			if (peraggstate->transfn.fn_strict)
-			{
-				for (i = 0; i < nargs; i++)
-				{
-					if (slot->tts_isnull[i])
-						break;
-				}
-				if (i < nargs)
-					continue;
-			}
-
-			/* OK, put the tuple into the tuplesort object */
-			if (peraggstate->numInputs == 1)
-				tuplesort_putdatum(peraggstate->sortstate,
-								   slot->tts_values[0],
-								   slot->tts_isnull[0]);
-			else
-				tuplesort_puttupleslot(peraggstate->sortstate, slot);
-		}
-		else
+		/*
+		 * If the transfn is strict, we want to check for nullity before
+		 * storing the row in the sorter, to save space if there are a lot of
+		 * nulls.  Note that we must only check numArguments columns, not
+		 * numInputs, since nullity in columns used only for sorting is not
+		 * relevant here.
+		 */
+		if (peraggstate->transfn.fn_strict)
 		{
-			/* We can apply the transition function immediately */
-			FunctionCallInfoData fcinfo;
-
-			/* Load values into fcinfo */
-			/* Start from 1, since the 0th arg will be the transition value */
-			Assert(slot->tts_nvalid >= nargs);
 			for (i = 0; i < nargs; i++)
 			{
-				fcinfo.arg[i + 1] = slot->tts_values[i];
-				fcinfo.argnull[i + 1] = slot->tts_isnull[i];
+				if (slot->tts_isnull[i])
+					break;
 			}
-
-			advance_transition_function(aggstate, peraggstate, pergroupstate,
-										&fcinfo);
+			if (i < nargs)
+				continue;
 		}
+
+		/* OK, put the tuple into the tuplesort object */
+		if (peraggstate->numInputs == 1)
+			tuplesort_putdatum(peraggstate->sortstate,
+							   slot->tts_values[0],
+							   slot->tts_isnull[0]);
+		else
+			tuplesort_puttupleslot(peraggstate->sortstate, slot);
 	}
 }
 
@@ -831,6 +725,7 @@ build_hash_table(AggState *aggstate)
 	Agg		   *node = (Agg *) aggstate->ss.ps.plan;
 	MemoryContext tmpmem = aggstate->tmpcontext->ecxt_per_tuple_memory;
 	Size		entrysize;
+	long		nbuckets;
 
 	Assert(node->aggstrategy == AGG_HASHED);
 	Assert(node->numGroups > 0);
@@ -838,11 +733,19 @@ build_hash_table(AggState *aggstate)
 	entrysize = sizeof(AggHashEntryData) +
 		(aggstate->numaggs - 1) * sizeof(AggStatePerGroupData);
 
+	/*
+	 * Don't size the table for more groups than can fit in work_mem; if the
+	 * estimate is that far off, the excess will be spilled anyway.
+	 */
+	nbuckets = node->numGroups;
+	if (nbuckets > work_mem * 1024L / entrysize)
+		nbuckets = Max(work_mem * 1024L / entrysize, 1);
+
 	aggstate->hashtable = BuildTupleHashTable(node->numCols,
 											  node->grpColIdx,
 											  aggstate->eqfunctions,
 											  aggstate->hashfunctions,
-											  node->numGroups,
+											  nbuckets,
 											  entrysize,
 											  aggstate->aggcontext,
 											  tmpmem);
@@ -919,6 +822,10 @@ hash_agg_entry_size(int numAggs)
  * Find or create a hashtable entry for the tuple group containing the
  * given tuple.
  *
+ * Returns NULL if the group is not already in the table and the table has
+ * reached its memory limit; the caller must spill the tuple.  The filtered
+ * grouping columns are left in aggstate->hashslot in either case.
+ *
  * When called, CurrentMemoryContext should be the per-query context.
  */
 static AggHashEntry
@@ -947,6 +854,12 @@ lookup_hash_entry(AggState *aggstate, TupleTableSlot *inputslot)
 		hashslot->tts_isnull[varNumber] = inputslot->tts_isnull[varNumber];
 	}
 
+	/* once the table is full, only look for existing groups */
+	if (aggstate->hash_spill_mode)
+		return (AggHashEntry) LookupTupleHashEntry(aggstate->hashtable,
+												   hashslot,
+												   NULL);
+
 	/* find or create the hashtable entry using the filtered tuple */
 	entry = (AggHashEntry) LookupTupleHashEntry(aggstate->hashtable,
 												hashslot,
@@ -956,11 +869,294 @@ lookup_hash_entry(AggState *aggstate, TupleTableSlot *inputslot)
 	{
 		/* initialize aggregates for new tuple group */
 		initialize_aggregates(aggstate, aggstate->peragg, entry->pergroup);
+
+		/* stop adding groups if that took us over the limit */
+		hash_check_memory(aggstate);
 	}
 
 	return entry;
 }
 
+/*
+ * Check whether the hash table has outgrown work_mem, and if so, switch to
+ * spilling the input for new groups.
+ *
+ * We only check when a group is added, so transition values that grow
+ * without new groups appearing (as with array_agg) can push us somewhat
+ * past the limit, but the overrun is bounded by what the existing groups
+ * would need anyway.
+ */
+static void
+hash_check_memory(AggState *aggstate)
+{
+	Size		used = MemoryContextMemAllocated(aggstate->aggcontext, true);
+
+	if (used > aggstate->hash_mem_peak)
+		aggstate->hash_mem_peak = used;
+
+	if (used <= aggstate->hash_mem_limit)
+		return;
+
+	/*
+	 * Once every hash bit has been used for partitioning, spilling again
+	 * can't separate the remaining groups, so just let the table grow.
+	 */
+	if ((aggstate->hash_level + 1) * aggstate->hash_partition_bits > 32)
+		return;
+
+	aggstate->hash_spill_mode = true;
+}
+
+/*
+ * Compute the hash value of the grouping columns stored in hashslot.
+ *
+ * This computes the same value as the hash table itself does, and the hash
+ * table picks buckets by the low-order bits.  The groups in one batch all
+ * agree in the bits used to choose the batch, so those must be taken from
+ * the high-order end; otherwise a reloaded batch would crowd into a
+ * fraction of the buckets.
+ */
+static uint32
+hash_group_value(AggState *aggstate, TupleTableSlot *hashslot)
+{
+	Agg		   *node = (Agg *) aggstate->ss.ps.plan;
+	uint32		hashkey = 0;
+	int			i;
+
+	for (i = 0; i < node->numCols; i++)
+	{
+		AttrNumber	att = node->grpColIdx[i] - 1;
+
+		/* rotate hashkey left 1 bit at each step */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		if (!hashslot->tts_isnull[att])
+		{
+			uint32		hkey;
+
+			hkey = DatumGetUInt32(FunctionCall1(&aggstate->hashfunctions[i],
+											hashslot->tts_values[att]));
+			hashkey ^= hkey;
+		}
+	}
+
+	return hashkey;
+}
+
+/*
+ * Write an input tuple whose group is not in the hash table to the batch
+ * file for its partition.
+ *
+ * The data recorded in the file for each tuple is its hash value, then the
+ * tuple in MinimalTuple format, just as for hash join batch files.
+ */
+static void
+hash_spill_tuple(AggState *aggstate, TupleTableSlot *inputslot)
+{
+	MemoryContext tmpmem = aggstate->tmpcontext->ecxt_per_tuple_memory;
+	MemoryContext oldcontext;
+	MinimalTuple tuple;
+	BufFile   **fileptr;
+	uint32		hashvalue;
+	int			partition;
+	size_t		written;
+
+	if (aggstate->hash_spill_files == NULL)
+		aggstate->hash_spill_files = (BufFile **)
+			palloc0(sizeof(BufFile *) << aggstate->hash_partition_bits);
+
+	/* hash functions may leak, so run them in the per-tuple context */
+	oldcontext = MemoryContextSwitchTo(tmpmem);
+	hashvalue = hash_group_value(aggstate, aggstate->hashslot);
+	MemoryContextSwitchTo(oldcontext);
+
+	partition = (hashvalue >>
+				 (32 - (aggstate->hash_level + 1) * aggstate->hash_partition_bits)) &
+		((1 << aggstate->hash_partition_bits) - 1);
+	fileptr = &aggstate->hash_spill_files[partition];
+
+	if (*fileptr == NULL)
+	{
+		/* First write to this batch file, so open it. */
+		*fileptr = BufFileCreateTemp(false);
+	}
+
+	tuple = ExecFetchSlotMinimalTuple(inputslot);
+
+	written = BufFileWrite(*fileptr, (void *) &hashvalue, sizeof(uint32));
+	if (written != sizeof(uint32))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+			  errmsg("could not write to hash-aggregate temporary file: %m")));
+
+	written = BufFileWrite(*fileptr, (void *) tuple, tuple->t_len);
+	if (written != tuple->t_len)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+			  errmsg("could not write to hash-aggregate temporary file: %m")));
+}
+
+/*
+ * Read the next tuple from the batch being processed, or return NULL at
+ * the end of the batch.
+ */
+static TupleTableSlot *
+hash_read_spilled_tuple(AggState *aggstate)
+{
+	TupleTableSlot *slot = aggstate->hash_spill_slot;
+	BufFile    *file = aggstate->hash_batch_file;
+	uint32		header[2];
+	size_t		nread;
+	MinimalTuple tuple;
+
+	/*
+	 * Both the hash value and the MinimalTuple length word are uint32, so we
+	 * can read them in one call.  We recompute the hash value if the tuple
+	 * is spilled again, so it is not needed here.
+	 */
+	nread = BufFileRead(file, (void *) header, sizeof(header));
+	if (nread == 0)				/* end of file */
+		return ExecClearTuple(slot);
+	if (nread != sizeof(header))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+			 errmsg("could not read from hash-aggregate temporary file: %m")));
+	tuple = (MinimalTuple) palloc(header[1]);
+	tuple->t_len = header[1];
+	nread = BufFileRead(file,
+						(void *) ((char *) tuple + sizeof(uint32)),
+						header[1] - sizeof(uint32));
+	if (nread != header[1] - sizeof(uint32))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+			 errmsg("could not read from hash-aggregate temporary file: %m")));
+	return ExecStoreMinimalTuple(tuple, slot, true);
+}
+
+/*
+ * Finish a pass over the input: queue up the batch files written during
+ * the pass, and release the batch that was read, if any.
+ */
+static void
+hash_finish_pass(AggState *aggstate)
+{
+	Size		used = MemoryContextMemAllocated(aggstate->aggcontext, true);
+
+	if (used > aggstate->hash_mem_peak)
+		aggstate->hash_mem_peak = used;
+
+	if (aggstate->hash_batch_file != NULL)
+	{
+		BufFileClose(aggstate->hash_batch_file);
+		aggstate->hash_batch_file = NULL;
+	}
+
+	if (aggstate->hash_spill_files != NULL)
+	{
+		int			npartitions = 1 << aggstate->hash_partition_bits;
+		int			i;
+
+		for (i = 0; i < npartitions; i++)
+		{
+			BufFile    *file = aggstate->hash_spill_files[i];
+			HashAggBatch *batch;
+
+			if (file == NULL)
+				continue;
+
+			if (BufFileSeek(file, 0, 0L, SEEK_SET))
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not rewind hash-aggregate temporary file: %m")));
+
+			batch = (HashAggBatch *) palloc(sizeof(HashAggBatch));
+			batch->file = file;
+			batch->level = aggstate->hash_level + 1;
+			aggstate->hash_batches = lcons(batch, aggstate->hash_batches);
+		}
+
+		pfree(aggstate->hash_spill_files);
+		aggstate->hash_spill_files = NULL;
+	}
+
+	aggstate->hash_spill_mode = false;
+}
+
+/*
+ * Empty the hash table and refill it from the next spilled batch.
+ *
+ * Returns false if there are no more batches.  The groups previously in
+ * the table must all have been returned already.
+ */
+static bool
+hash_next_batch(AggState *aggstate)
+{
+	HashAggBatch *batch;
+
+	if (aggstate->hash_batches == NIL)
+		return false;
+
+	batch = (HashAggBatch *) linitial(aggstate->hash_batches);
+	aggstate->hash_batches = list_delete_first(aggstate->hash_batches);
+
+	/* See ExecReScanAgg for why we delete children too */
+	MemoryContextResetAndDeleteChildren(aggstate->aggcontext);
+	build_hash_table(aggstate);
+
+	aggstate->hash_batch_file = batch->file;
+	aggstate->hash_level = batch->level;
+	pfree(batch);
+
+	agg_fill_hash_table(aggstate);
+
+	return true;
+}
+
+/*
+ * Close any batch files and forget all spilling state.
+ */
+static void
+hash_reset_spill_state(AggState *aggstate)
+{
+	ListCell   *lc;
+
+	if (aggstate->hash_spill_files != NULL)
+	{
+		int			npartitions = 1 << aggstate->hash_partition_bits;
+		int			i;
+
+		for (i = 0; i < npartitions; i++)
+		{
+			if (aggstate->hash_spill_files[i] != NULL)
+				BufFileClose(aggstate->hash_spill_files[i]);
+		}
+		pfree(aggstate->hash_spill_files);
+		aggstate->hash_spill_files = NULL;
+	}
+
+	if (aggstate->hash_batch_file != NULL)
+	{
+		BufFileClose(aggstate->hash_batch_file);
+		aggstate->hash_batch_file = NULL;
+	}
+
+	foreach(lc, aggstate->hash_batches)
+	{
+		HashAggBatch *batch = (HashAggBatch *) lfirst(lc);
+
+		BufFileClose(batch->file);
+	}
+	list_free_deep(aggstate->hash_batches);
+	aggstate->hash_batches = NIL;
+
+	if (aggstate->hash_spill_slot != NULL)
+		ExecClearTuple(aggstate->hash_spill_slot);
+
+	aggstate->hash_spill_mode = false;
+	aggstate->hash_level = 0;
+	aggstate->hash_batches_used = 0;
+}
+
 /*
  * ExecAgg -
  *
@@ -1216,6 +1412,9 @@ agg_retrieve_direct(AggState *aggstate)
 
 /*
  * ExecAgg for hashed case: phase 1, read input and build hash table
+ *
+ * The input is either the outer plan or, when called from hash_next_batch,
+ * a batch of previously spilled tuples.
  */
 static void
 agg_fill_hash_table(AggState *aggstate)
@@ -1238,7 +1437,13 @@ agg_fill_hash_table(AggState *aggstate)
 	 */
 	for (;;)
 	{
-		outerslot = ExecProcNode(outerPlan);
+		if (aggstate->hash_batch_file != NULL)
+		{
+			CHECK_FOR_INTERRUPTS();
+			outerslot = hash_read_spilled_tuple(aggstate);
+		}
+		else
+			outerslot = ExecProcNode(outerPlan);
 		if (TupIsNull(outerslot))
 			break;
 		/* set up for advance_aggregates call */
@@ -1247,13 +1452,24 @@ agg_fill_hash_table(AggState *aggstate)
 		/* Find or build hashtable entry for this tuple's group */
 		entry = lookup_hash_entry(aggstate, outerslot);
 
-		/* Advance the aggregates */
-		advance_aggregates(aggstate, entry->pergroup);
+		if (entry != NULL)
+		{
+			/* Advance the aggregates */
+			advance_aggregates(aggstate, entry->pergroup);
+		}
+		else
+		{
+			/* No room for a new group; process it in a later pass */
+			hash_spill_tuple(aggstate, outerslot);
+		}
 
 		/* Reset per-input-tuple context after each tuple */
 		ResetExprContext(tmpcontext);
 	}
 
+	hash_finish_pass(aggstate);
+	aggstate->hash_batches_used++;
+
 	aggstate->table_filled = true;
 	/* Initialize to walk the hash table */
 	ResetTupleHashIterator(aggstate->hashtable, &aggstate->hashiter);
@@ -1296,6 +1512,10 @@ agg_retrieve_hash_table(AggState *aggstate)
 		entry = (AggHashEntry) ScanTupleHashTable(&aggstate->hashiter);
 		if (entry == NULL)
 		{
+			/* Refill the hashtable from the next batch, if any */
+			if (hash_next_batch(aggstate))
+				continue;
+
 			/* No more entries in hashtable, so done */
 			aggstate->agg_done = TRUE;
 			return NULL;
@@ -1403,6 +1623,10 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 	aggstate->pergroup = NULL;
 	aggstate->grp_firstTuple = NULL;
 	aggstate->hashtable = NULL;
+	aggstate->hash_spill_files = NULL;
+	aggstate->hash_batch_file = NULL;
+	aggstate->hash_batches = NIL;
+	aggstate->hash_spill_slot = NULL;
 
 	/*
 	 * Create expression contexts.	We need two, one for per-input-tuple
@@ -1527,6 +1751,21 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 		aggstate->table_filled = false;
 		/* Compute the columns we actually need to hash on */
 		aggstate->hash_needed = find_hash_columns(aggstate);
+
+		/*
+		 * Set up for spilling.  Each open batch file has a BLCKSZ buffer, so
+		 * use fewer of them when work_mem is small: the buffers should take
+		 * no more than a quarter of it.
+		 */
+		aggstate->hash_mem_limit = work_mem * 1024L;
+		aggstate->hash_partition_bits = HASHAGG_MIN_PARTITION_BITS;
+		while (aggstate->hash_partition_bits < HASHAGG_MAX_PARTITION_BITS &&
+			   (Size) BLCKSZ * 4 << (aggstate->hash_partition_bits + 1) <=
+			   aggstate->hash_mem_limit)
+			aggstate->hash_partition_bits++;
+		aggstate->hash_spill_slot = ExecInitExtraTupleSlot(estate);
+		ExecSetSlotDescriptor(aggstate->hash_spill_slot,
+							  ExecGetResultType(outerPlanState(aggstate)));
 	}
 	else
 	{
@@ -1860,6 +2099,9 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 	/* Update numaggs to match number of unique aggregates found */
 	aggstate->numaggs = aggno + 1;
 
+	/* Build the program advancing the aggregates that take input directly */
+	aggstate->evaltrans = ExecBuildAggTrans(aggstate);
+
 	return aggstate;
 }
 
@@ -1894,6 +2136,10 @@ ExecEndAgg(AggState *node)
 			tuplesort_end(peraggstate->sortstate);
 	}
 
+	/* And any batch files */
+	if (((Agg *) node->ss.ps.plan)->aggstrategy == AGG_HASHED)
+		hash_reset_spill_state(node);
+
 	/*
 	 * Free both the expr contexts.
 	 */
@@ -1934,13 +2180,17 @@ ExecReScanAgg(AggState *node)
 		/*
 		 * If we do have the hash table and the subplan does not have any
 		 * parameter changes, then we can just rescan the existing hash table;
-		 * no need to build it again.
+		 * no need to build it again.  That doesn't work if we spilled, since
+		 * the table then holds only the groups of the last batch.
 		 */
-		if (node->ss.ps.lefttree->chgParam == NULL)
+		if (node->ss.ps.lefttree->chgParam == NULL &&
+			node->hash_batches_used == 1)
 		{
 			ResetTupleHashIterator(node->hashtable, &node->hashiter);
 			return;
 		}
+
+		hash_reset_spill_state(node);
 	}
 
 	/* Make sure we have closed any open tuplesorts */
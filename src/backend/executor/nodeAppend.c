@@ -53,14 +53,26 @@
  *			  nil	nil		 Scan	 Scan	  Scan	   Scan
  *							  |		  |		   |		|
  *							person employee student student-emp
+ *
+ *		When scanning a partitioned table, the planner leaves out the
+ *		partitions that the query's constant restrictions show can't
+ *		contain matching rows.  If the partition key is also compared
+ *		with Params, the Append itself evaluates those and skips the
+ *		subplans of partitions that can't match, each time it is
+ *		(re)scanned with new parameter values.
  */
 
 #include "postgres.h"
 
+#include "access/heapam.h"
+#include "catalog/partition.h"
 #include "executor/execdebug.h"
 #include "executor/nodeAppend.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
 
 static bool exec_append_initialize_next(AppendState *appendstate);
+static void exec_append_prune(AppendState *node);
 
 
 /* ----------------------------------------------------------------
@@ -81,6 +93,18 @@ exec_append_initialize_next(AppendState *appendstate)
 	 */
 	whichplan = appendstate->as_whichplan;
 
+	/* skip over subplans of partitions pruned at run time */
+	if (appendstate->as_valid != NULL && !appendstate->as_prune_pending)
+	{
+		int			step;
+
+		step = ScanDirectionIsForward(appendstate->ps.state->es_direction) ? 1 : -1;
+		while (whichplan >= 0 && whichplan < appendstate->as_nplans &&
+			   !appendstate->as_valid[whichplan])
+			whichplan += step;
+		appendstate->as_whichplan = whichplan;
+	}
+
 	if (whichplan < 0)
 	{
 		/*
@@ -146,9 +170,23 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 	/*
 	 * Miscellaneous initialization
 	 *
-	 * Append plans don't have expression contexts because they never call
-	 * ExecQual or ExecProject.
+	 * Append plans never call ExecQual or ExecProject, so they need an
+	 * expression context only to evaluate partition pruning values.
 	 */
+	if (node->part_prune_exprs != NIL)
+	{
+		ExecAssignExprContext(estate, &appendstate->ps);
+		appendstate->as_prune_exprs = (List *)
+			ExecInitExpr((Expr *) node->part_prune_exprs,
+						 (PlanState *) appendstate);
+		/* the planner already locked the table */
+		appendstate->as_partrel = heap_open(node->part_relid, NoLock);
+		appendstate->as_valid = (bool *) palloc(nplans * sizeof(bool));
+		memset(appendstate->as_valid, true, nplans * sizeof(bool));
+
+		/* the Params may not be set yet; prune when the scan starts */
+		appendstate->as_prune_pending = true;
+	}
 
 	/*
 	 * append nodes still have Result slots, which hold pointers to tuples, so
@@ -193,6 +231,13 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 TupleTableSlot *
 ExecAppend(AppendState *node)
 {
+	if (node->as_prune_pending)
+	{
+		exec_append_prune(node);
+		if (!exec_append_initialize_next(node))
+			return ExecClearTuple(node->ps.ps_ResultTupleSlot);
+	}
+
 	for (;;)
 	{
 		PlanState  *subnode;
@@ -260,6 +305,12 @@ ExecEndAppend(AppendState *node)
 	 */
 	for (i = 0; i < nplans; i++)
 		ExecEndNode(appendplans[i]);
+
+	if (node->as_partrel)
+	{
+		ExecFreeExprContext(&node->ps);
+		heap_close(node->as_partrel, NoLock);
+	}
 }
 
 void
@@ -285,6 +336,76 @@ ExecReScanAppend(AppendState *node)
 		if (subnode->chgParam == NULL)
 			ExecReScan(subnode);
 	}
+
+	/* The pruning values may have changed */
+	if (node->as_valid != NULL && node->ps.chgParam != NULL)
+		node->as_prune_pending = true;
+
 	node->as_whichplan = 0;
 	exec_append_initialize_next(node);
 }
+
+/* ----------------------------------------------------------------
+ *		exec_append_prune
+ *
+ *		Evaluate the partition pruning values and work out which
+ *		subplans can return rows.
+ * ----------------------------------------------------------------
+ */
+static void
+exec_append_prune(AppendState *node)
+{
+	Append	   *plan = (Append *) node->ps.plan;
+	ExprContext *econtext = node->ps.ps_ExprContext;
+	PartitionKey key = RelationGetPartitionKey(node->as_partrel);
+	PartitionDesc pdesc = RelationGetPartitionDesc(node->as_partrel);
+	MemoryContext oldcontext;
+	Bitmapset  *parts = NULL;
+	ListCell   *lc1;
+	ListCell   *lc2;
+	ListCell   *lc3;
+	int			i;
+
+	/* Do the work in short-lived memory */
+	ResetExprContext(econtext);
+	oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	for (i = 0; i < pdesc->nparts; i++)
+		parts = bms_add_member(parts, i);
+
+	forthree(lc1, node->as_prune_exprs,
+			 lc2, plan->part_prune_strategies,
+			 lc3, plan->part_prune_cmpprocs)
+	{
+		ExprState  *exprstate = (ExprState *) lfirst(lc1);
+		Datum		value;
+		bool		isnull;
+		Bitmapset  *matches;
+
+		value = ExecEvalExpr(exprstate, econtext, &isnull, NULL);
+
+		/* btree operators are strict, so a null value matches nothing */
+		if (isnull)
+		{
+			parts = NULL;
+			break;
+		}
+
+		matches = get_partitions_for_strategy(key, pdesc, 0,
+											  (StrategyNumber) lfirst_int(lc2),
+											  lfirst_oid(lc3), value);
+		parts = bms_int_members(parts, matches);
+	}
+
+	i = 0;
+	foreach(lc1, plan->part_subplan_indexes)
+	{
+		int			partidx = lfirst_int(lc1);
+
+		node->as_valid[i++] = (partidx < 0 || bms_is_member(partidx, parts));
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	node->as_prune_pending = false;
+}
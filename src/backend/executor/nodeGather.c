@@ -0,0 +1,288 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeGather.c
+ *	  Support routines for scanning a plan via multiple workers.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * A Gather executor launches parallel workers to run multiple copies of a
+ * plan.  It can also run the plan itself, if the workers are not available
+ * or have not started up yet.  It then merges all of the results it
+ * produces and the results from the workers into a single output stream.
+ * Therefore, it will normally be used with a plan where running multiple
+ * copies of the same plan does not produce duplicate output, such as a
+ * parallel-aware SeqScan.
+ *
+ * Workers evaluate the child's quals but not its targetlist; the tuples
+ * they return are whole heap rows, which we project here using the child's
+ * projection info, just as the child would have.
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeGather.c
+ *
+ *-------------------------------------------------------------------------
+ */
+/*
+ * INTERFACE ROUTINES
+ *		ExecGather				returns the next tuple from any participant
+ *		ExecInitGather			creates and initializes a gather node
+ *		ExecEndGather			releases any storage allocated
+ *		ExecReScanGather		rescans the subplan
+ */
+#include "postgres.h"
+
+#include "access/parallel.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "executor/executor.h"
+#include "executor/nodeGather.h"
+#include "executor/nodeSeqscan.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+
+static void ExecGatherBegin(GatherState *node);
+static TupleTableSlot *gather_project(GatherState *node, MinimalTuple tup);
+static void ExecShutdownGatherWorkers(GatherState *node);
+
+
+/* ----------------------------------------------------------------
+ *		ExecInitGather
+ * ----------------------------------------------------------------
+ */
+GatherState *
+ExecInitGather(Gather *node, EState *estate, int eflags)
+{
+	GatherState *gatherstate;
+	PlanState  *outerstate;
+
+	/* Gather node doesn't have innerPlan node. */
+	Assert(innerPlan(node) == NULL);
+
+	/* Only forward scans are supported. */
+	Assert(!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
+
+	/*
+	 * create state structure
+	 */
+	gatherstate = makeNode(GatherState);
+	gatherstate->ps.plan = (Plan *) node;
+	gatherstate->ps.state = estate;
+	gatherstate->initialized = false;
+	gatherstate->pcxt = NULL;
+	gatherstate->local_pscan = NULL;
+
+	/*
+	 * Gather nodes don't initialize their ExprContexts because they never
+	 * call ExecQual or ExecProject themselves.
+	 */
+
+	/*
+	 * tuple table initialization
+	 */
+	ExecInitResultTupleSlot(estate, &gatherstate->ps);
+	gatherstate->funnel_slot = ExecInitExtraTupleSlot(estate);
+
+	/*
+	 * now initialize outer plan
+	 */
+	outerstate = ExecInitNode(outerPlan(node), estate, eflags);
+	outerPlanState(gatherstate) = outerstate;
+
+	/* tuples from workers have the child's scan rowtype */
+	Assert(IsA(outerstate, SeqScanState));
+	ExecSetSlotDescriptor(gatherstate->funnel_slot,
+		((ScanState *) outerstate)->ss_ScanTupleSlot->tts_tupleDescriptor);
+
+	/*
+	 * initialize tuple type.  no need to initialize projection info because
+	 * this node doesn't do projections.
+	 */
+	ExecAssignResultTypeFromTL(&gatherstate->ps);
+	gatherstate->ps.ps_ProjInfo = NULL;
+
+	return gatherstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecGather(node)
+ *
+ *		Returns the next tuple produced either by a worker or by the
+ *		leader's own copy of the subplan.  Worker tuples are preferred when
+ *		available, so that workers are not left waiting on full queues.
+ * ----------------------------------------------------------------
+ */
+TupleTableSlot *
+ExecGather(GatherState *node)
+{
+	PlanState  *outerNode = outerPlanState(node);
+
+	if (!node->initialized)
+	{
+		ExecGatherBegin(node);
+		node->initialized = true;
+	}
+
+	for (;;)
+	{
+		if (node->pcxt != NULL && node->pcxt->nreaders > 0)
+		{
+			MinimalTuple tup;
+			bool		done;
+
+			/* Only block if there's nothing else for us to do. */
+			tup = ParallelContextReadTuple(node->pcxt,
+										   node->need_to_scan_locally,
+										   &done);
+			if (tup != NULL)
+				return gather_project(node, tup);
+		}
+
+		if (node->need_to_scan_locally)
+		{
+			TupleTableSlot *slot = ExecProcNode(outerNode);
+
+			if (!TupIsNull(slot))
+				return slot;
+
+			/*
+			 * All blocks have been handed out.  Workers that haven't started
+			 * yet can't help any more, so don't wait for them.
+			 */
+			node->need_to_scan_locally = false;
+			if (node->pcxt != NULL)
+				CloseParallelContext(node->pcxt);
+			continue;
+		}
+
+		if (node->pcxt == NULL || node->pcxt->nreaders == 0)
+			return ExecClearTuple(node->ps.ps_ResultTupleSlot);
+	}
+}
+
+/*
+ * Set up the shared scan state and launch workers, if possible.
+ */
+static void
+ExecGatherBegin(GatherState *node)
+{
+	Gather	   *gather = (Gather *) node->ps.plan;
+	SeqScanState *child = (SeqScanState *) outerPlanState(node);
+	EState	   *estate = node->ps.state;
+	ParallelHeapScanDesc pscan;
+
+	Assert(node->pcxt == NULL);
+
+	/*
+	 * Workers can't see any changes made by our transaction, nor take part
+	 * in its serializable conflict tracking, so in either case the leader
+	 * does all the work.
+	 */
+	if (gather->num_workers > 0 &&
+		!TransactionIdIsValid(GetTopTransactionIdIfAny()) &&
+		!IsolationIsSerializable())
+	{
+		node->pcxt = CreateParallelContext(gather->num_workers,
+										   child->ss_currentRelation,
+										   estate->es_snapshot,
+										   child->ps.plan->qual);
+		if (node->pcxt != NULL)
+			LaunchParallelWorkers(node->pcxt);
+	}
+
+	if (node->pcxt != NULL)
+		pscan = node->pcxt->pscan;
+	else
+	{
+		if (node->local_pscan == NULL)
+			node->local_pscan = (ParallelHeapScanDesc)
+				palloc(sizeof(ParallelHeapScanDescData));
+		heap_parallelscan_initialize(node->local_pscan,
+									 child->ss_currentRelation);
+		pscan = node->local_pscan;
+	}
+
+	ExecSeqScanInitializeParallel(child, pscan);
+	node->need_to_scan_locally = true;
+}
+
+/*
+ * Return a tuple received from a worker, projected as the child would have
+ * done it.
+ */
+static TupleTableSlot *
+gather_project(GatherState *node, MinimalTuple tup)
+{
+	PlanState  *outerNode = outerPlanState(node);
+	ExprContext *econtext;
+	ExprDoneCond isDone;
+
+	ExecStoreMinimalTuple(tup, node->funnel_slot, false);
+
+	if (outerNode->ps_ProjInfo == NULL)
+		return node->funnel_slot;
+
+	econtext = outerNode->ps_ExprContext;
+	ResetExprContext(econtext);
+	econtext->ecxt_scantuple = node->funnel_slot;
+
+	return ExecProject(outerNode->ps_ProjInfo, &isDone);
+}
+
+/*
+ * Shut down the workers, if any.  Tuples already returned remain valid.
+ */
+static void
+ExecShutdownGatherWorkers(GatherState *node)
+{
+	ExecClearTuple(node->funnel_slot);
+	if (node->pcxt != NULL)
+	{
+		DestroyParallelContext(node->pcxt);
+		node->pcxt = NULL;
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndGather
+ *
+ *		frees any storage allocated through C routines.
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndGather(GatherState *node)
+{
+	ExecShutdownGatherWorkers(node);
+
+	/*
+	 * clean out the tuple table
+	 */
+	ExecClearTuple(node->ps.ps_ResultTupleSlot);
+
+	/*
+	 * shut down the subplan
+	 */
+	ExecEndNode(outerPlanState(node));
+}
+
+/* ----------------------------------------------------------------
+ *		ExecReScanGather
+ *
+ *		Shuts down any running workers; they'll be relaunched, and the
+ *		shared scan state set up afresh, on the next call to ExecGather.
+ * ----------------------------------------------------------------
+ */
+void
+ExecReScanGather(GatherState *node)
+{
+	ExecShutdownGatherWorkers(node);
+	node->initialized = false;
+
+	/*
+	 * if chgParam of subnode is not null then plan will be re-scanned by
+	 * first ExecProcNode.
+	 */
+	if (node->ps.lefttree->chgParam == NULL)
+		ExecReScan(node->ps.lefttree);
+}
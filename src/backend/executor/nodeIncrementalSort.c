@@ -0,0 +1,341 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeIncrementalSort.c
+ *	  Routines to handle incremental sorting of relations.
+ *
+ * An incremental sort is used when the input is already sorted on a leading
+ * subset of the requested sort columns.  Rather than reading all of the
+ * input before returning anything, as a plain Sort must, we only need to
+ * sort together the tuples that are equal on the presorted columns; all the
+ * tuples of one such group sort before all the tuples of the next.  So we
+ * read the input one group at a time, sort it, return its tuples and move
+ * on to the next group.  The first tuples can be returned after reading
+ * just the first group, which makes a big difference below a LIMIT.
+ *
+ * Setting up and tearing down a tuplesort for every group would cost too
+ * much when the groups are small, so we collect at least
+ * INCSORT_MIN_BATCH_TUPLES tuples before sorting, extending the batch to
+ * the end of the group its last tuple belongs to.  A batch thus always
+ * consists of whole groups, and is sorted on all of the sort columns.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeIncrementalSort.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "executor/execdebug.h"
+#include "executor/executor.h"
+#include "executor/nodeIncrementalSort.h"
+#include "miscadmin.h"
+#include "utils/lsyscache.h"
+#include "utils/tuplesort.h"
+
+static bool incsort_next_batch(IncrementalSortState *node);
+
+
+/* ----------------------------------------------------------------
+ *		ExecIncrementalSort
+ *
+ *		Returns the next tuple in sort order, sorting the next batch of
+ *		groups from the outer plan whenever the current one runs out.
+ *
+ *		Conditions:
+ *		  -- none.
+ *
+ *		Initial States:
+ *		  -- the outer child is prepared to return the first tuple.
+ * ----------------------------------------------------------------
+ */
+TupleTableSlot *
+ExecIncrementalSort(IncrementalSortState *node)
+{
+	TupleTableSlot *slot = node->ss.ps.ps_ResultTupleSlot;
+
+	for (;;)
+	{
+		Tuplesortstate *tuplesortstate;
+
+		tuplesortstate = (Tuplesortstate *) node->tuplesortstate;
+		if (tuplesortstate != NULL)
+		{
+			if (tuplesort_gettupleslot(tuplesortstate, true, slot))
+			{
+				node->tuples_output++;
+				return slot;
+			}
+
+			/* Current batch is used up */
+			tuplesort_end(tuplesortstate);
+			node->tuplesortstate = NULL;
+		}
+
+		/* Stop if the input is exhausted, or a LIMIT has been satisfied */
+		if ((node->outer_done && !node->pivot_pending) ||
+			(node->bounded && node->tuples_output >= node->bound))
+			return ExecClearTuple(slot);
+
+		if (!incsort_next_batch(node))
+			return ExecClearTuple(slot);
+	}
+}
+
+/*
+ * incsort_next_batch
+ *		Read the next batch of groups from the outer plan and sort it.
+ *
+ * Returns false if there were no more input tuples.
+ */
+static bool
+incsort_next_batch(IncrementalSortState *node)
+{
+	IncrementalSort *plannode = (IncrementalSort *) node->ss.ps.plan;
+	PlanState  *outerNode = outerPlanState(node);
+	EState	   *estate = node->ss.ps.state;
+	ScanDirection dir = estate->es_direction;
+	MemoryContext tempContext = node->ss.ps.ps_ExprContext->ecxt_per_tuple_memory;
+	Tuplesortstate *tuplesortstate;
+	TupleTableSlot *pivot = node->group_pivot;
+	int64		ntuples = 0;
+
+	SO1_printf("ExecIncrementalSort: %s\n",
+			   "sorting next batch");
+
+	/*
+	 * Want to scan subplan in the forward direction while collecting the
+	 * batch.
+	 */
+	estate->es_direction = ForwardScanDirection;
+
+	tuplesortstate = tuplesort_begin_heap(ExecGetResultType(outerNode),
+										  plannode->sort.numCols,
+										  plannode->sort.sortColIdx,
+										  plannode->sort.sortOperators,
+										  plannode->sort.collations,
+										  plannode->sort.nullsFirst,
+										  work_mem,
+										  false);
+	if (node->bounded)
+		tuplesort_set_bound(tuplesortstate,
+							node->bound - node->tuples_output);
+
+	/* Start with the tuple that ended the previous batch, if any */
+	if (node->pivot_pending)
+	{
+		tuplesort_puttupleslot(tuplesortstate, pivot);
+		node->pivot_pending = false;
+		ntuples++;
+	}
+
+	while (!node->outer_done)
+	{
+		TupleTableSlot *slot = ExecProcNode(outerNode);
+
+		if (TupIsNull(slot))
+		{
+			node->outer_done = true;
+			break;
+		}
+
+		if (ntuples >= INCSORT_MIN_BATCH_TUPLES &&
+			!execTuplesMatch(pivot, slot,
+							 plannode->presortedCols,
+							 plannode->sort.sortColIdx,
+							 node->eqfunctions,
+							 tempContext))
+		{
+			/* First tuple of a new group; keep it for the next batch */
+			ExecCopySlot(pivot, slot);
+			node->pivot_pending = true;
+			break;
+		}
+
+		tuplesort_puttupleslot(tuplesortstate, slot);
+		ntuples++;
+
+		/*
+		 * The batch is big enough now, so it ends with the group of this
+		 * tuple.  Remember the tuple, to recognize the end of its group.
+		 */
+		if (ntuples == INCSORT_MIN_BATCH_TUPLES)
+			ExecCopySlot(pivot, slot);
+	}
+
+	estate->es_direction = dir;
+
+	if (ntuples == 0)
+	{
+		tuplesort_end(tuplesortstate);
+		return false;
+	}
+
+	tuplesort_performsort(tuplesortstate);
+	node->tuplesortstate = (void *) tuplesortstate;
+	node->nbatches++;
+
+	SO1_printf("ExecIncrementalSort: %s\n", "batch sorted");
+
+	return true;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitIncrementalSort
+ *
+ *		Creates the run-time state information for the incremental sort
+ *		node produced by the planner and initializes its outer subtree.
+ * ----------------------------------------------------------------
+ */
+IncrementalSortState *
+ExecInitIncrementalSort(IncrementalSort *node, EState *estate, int eflags)
+{
+	IncrementalSortState *incrsortstate;
+	Oid		   *eqOperators;
+	int			i;
+
+	SO1_printf("ExecInitIncrementalSort: %s\n",
+			   "initializing sort node");
+
+	/*
+	 * Incremental sort only keeps the current batch, so it can't support
+	 * backward scans or mark/restore.
+	 */
+	Assert(!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
+
+	/*
+	 * create state structure
+	 */
+	incrsortstate = makeNode(IncrementalSortState);
+	incrsortstate->ss.ps.plan = (Plan *) node;
+	incrsortstate->ss.ps.state = estate;
+
+	incrsortstate->bounded = false;
+	incrsortstate->pivot_pending = false;
+	incrsortstate->outer_done = false;
+	incrsortstate->tuples_output = 0;
+	incrsortstate->nbatches = 0;
+	incrsortstate->tuplesortstate = NULL;
+
+	/*
+	 * Miscellaneous initialization
+	 *
+	 * We don't do ExecQual or ExecProject, but we need a per-tuple memory
+	 * context for execTuplesMatch.
+	 */
+	ExecAssignExprContext(estate, &incrsortstate->ss.ps);
+
+	/*
+	 * tuple table initialization
+	 */
+	ExecInitResultTupleSlot(estate, &incrsortstate->ss.ps);
+	ExecInitScanTupleSlot(estate, &incrsortstate->ss);
+	incrsortstate->group_pivot = ExecInitExtraTupleSlot(estate);
+
+	/*
+	 * initialize child nodes
+	 *
+	 * We shield the child node from the need to support REWIND; we rescan
+	 * it instead of keeping the sorted data around.
+	 */
+	eflags &= ~EXEC_FLAG_REWIND;
+
+	outerPlanState(incrsortstate) = ExecInitNode(outerPlan(node), estate, eflags);
+
+	/*
+	 * initialize tuple type.  no need to initialize projection info because
+	 * this node doesn't do projections.
+	 */
+	ExecAssignResultTypeFromTL(&incrsortstate->ss.ps);
+	ExecAssignScanTypeFromOuterPlan(&incrsortstate->ss);
+	ExecSetSlotDescriptor(incrsortstate->group_pivot,
+						  ExecGetResultType(outerPlanState(incrsortstate)));
+	incrsortstate->ss.ps.ps_ProjInfo = NULL;
+
+	/*
+	 * Look up the equality functions used to find the group boundaries on
+	 * the presorted columns.
+	 */
+	eqOperators = (Oid *) palloc(node->presortedCols * sizeof(Oid));
+	for (i = 0; i < node->presortedCols; i++)
+	{
+		eqOperators[i] = get_equality_op_for_ordering_op(node->sort.sortOperators[i],
+														 NULL);
+		if (!OidIsValid(eqOperators[i]))
+			elog(ERROR, "could not find equality operator for ordering operator %u",
+				 node->sort.sortOperators[i]);
+	}
+	incrsortstate->eqfunctions = execTuplesMatchPrepare(node->presortedCols,
+														eqOperators);
+
+	SO1_printf("ExecInitIncrementalSort: %s\n",
+			   "sort node initialized");
+
+	return incrsortstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndIncrementalSort(node)
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndIncrementalSort(IncrementalSortState *node)
+{
+	SO1_printf("ExecEndIncrementalSort: %s\n",
+			   "shutting down sort node");
+
+	/*
+	 * clean out the tuple table
+	 */
+	ExecClearTuple(node->ss.ss_ScanTupleSlot);
+	/* must drop pointer to sort result tuple */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->group_pivot);
+
+	/*
+	 * Release tuplesort resources
+	 */
+	if (node->tuplesortstate != NULL)
+		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+	node->tuplesortstate = NULL;
+
+	ExecFreeExprContext(&node->ss.ps);
+
+	/*
+	 * shut down the subplan
+	 */
+	ExecEndNode(outerPlanState(node));
+
+	SO1_printf("ExecEndIncrementalSort: %s\n",
+			   "sort node shutdown");
+}
+
+void
+ExecReScanIncrementalSort(IncrementalSortState *node)
+{
+	/*
+	 * We don't keep the sorted output of past batches, so we always have to
+	 * start over from the beginning of the input.
+	 */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->group_pivot);
+
+	if (node->tuplesortstate != NULL)
+		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+	node->tuplesortstate = NULL;
+
+	node->pivot_pending = false;
+	node->outer_done = false;
+	node->tuples_output = 0;
+
+	/*
+	 * if chgParam of subnode is not null then plan will be re-scanned by
+	 * first ExecProcNode.
+	 */
+	if (node->ss.ps.lefttree->chgParam == NULL)
+		ExecReScan(node->ss.ps.lefttree);
+}
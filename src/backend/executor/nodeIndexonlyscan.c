@@ -85,7 +85,7 @@ IndexOnlyNext(IndexOnlyScanState *node)
 		 * which all tuples are known visible to everybody.  In any case,
 		 * we'll use the index tuple not the heap tuple as the data source.
 		 *
-		 * Note on Memory Ordering Effects: visibilitymap_test does not lock
+		 * Note on Memory Ordering Effects: VM_ALL_VISIBLE does not lock
 		 * the visibility map buffer, and therefore the result we read here
 		 * could be slightly stale.  However, it can't be stale enough to
 		 * matter.	It suffices to show that (1) there is a read barrier
@@ -98,9 +98,9 @@ IndexOnlyNext(IndexOnlyScanState *node)
 		 * reading the TID; and (2) is satisfied by the acquisition of the
 		 * buffer content lock in order to insert the TID.
 		 */
-		if (!visibilitymap_test(scandesc->heapRelation,
-								ItemPointerGetBlockNumber(tid),
-								&node->ioss_VMBuffer))
+		if (!VM_ALL_VISIBLE(scandesc->heapRelation,
+							ItemPointerGetBlockNumber(tid),
+							&node->ioss_VMBuffer))
 		{
 			/*
 			 * Rats, we have to visit the heap to check visibility.
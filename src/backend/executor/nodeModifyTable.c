@@ -40,6 +40,7 @@
 #include "access/htup_details.h"
 #include "access/xact.h"
 #include "commands/trigger.h"
+#include "executor/execPartition.h"
 #include "executor/executor.h"
 #include "executor/nodeModifyTable.h"
 #include "foreign/fdwapi.h"
@@ -161,14 +162,18 @@ ExecProcessReturning(ProjectionInfo *projectReturning,
  * ----------------------------------------------------------------
  */
 static TupleTableSlot *
-ExecInsert(TupleTableSlot *slot,
+ExecInsert(ModifyTableState *mtstate,
+		   TupleTableSlot *slot,
 		   TupleTableSlot *planSlot,
 		   EState *estate,
 		   bool canSetTag)
 {
 	HeapTuple	tuple;
 	ResultRelInfo *resultRelInfo;
+	ResultRelInfo *returningRelInfo;
 	Relation	resultRelationDesc;
+	PartitionTupleRouting *proute = mtstate->mt_partition_routing;
+	int			leaf = -1;
 	Oid			newId;
 	List	   *recheckIndexes = NIL;
 
@@ -182,6 +187,24 @@ ExecInsert(TupleTableSlot *slot,
 	 * get information on the (current) result relation
 	 */
 	resultRelInfo = estate->es_result_relation_info;
+	returningRelInfo = resultRelInfo;
+
+	/*
+	 * If the target is a partitioned table, the tuple goes into one of its
+	 * leaf partitions instead; make that the current result relation.  The
+	 * caller restores es_result_relation_info afterwards.  The partitioned
+	 * table's own row triggers are not fired.
+	 */
+	if (proute != NULL)
+	{
+		leaf = ExecFindPartition(resultRelInfo, proute, slot, estate);
+		resultRelInfo = &proute->partitions[leaf];
+		estate->es_result_relation_info = resultRelInfo;
+
+		slot = ExecConvertToPartition(proute, leaf, slot);
+		tuple = ExecMaterializeSlot(slot);
+	}
+
 	resultRelationDesc = resultRelInfo->ri_RelationDesc;
 
 	/*
@@ -251,6 +274,8 @@ ExecInsert(TupleTableSlot *slot,
 		 */
 		if (resultRelationDesc->rd_att->constr)
 			ExecConstraints(resultRelInfo, slot, estate);
+		if (resultRelInfo->ri_CheckPartition)
+			ExecPartitionCheck(resultRelInfo, slot, estate);
 
 		/*
 		 * insert the tuple
@@ -281,10 +306,17 @@ ExecInsert(TupleTableSlot *slot,
 
 	list_free(recheckIndexes);
 
-	/* Process RETURNING if present */
-	if (resultRelInfo->ri_projectReturning)
-		return ExecProcessReturning(resultRelInfo->ri_projectReturning,
+	/*
+	 * Process RETURNING if present.  A routed tuple must be converted back
+	 * to the partitioned table's rowtype, which the projection expects.
+	 */
+	if (returningRelInfo->ri_projectReturning)
+	{
+		if (proute != NULL)
+			slot = ExecConvertFromPartition(proute, leaf, slot);
+		return ExecProcessReturning(returningRelInfo->ri_projectReturning,
 									slot, planSlot);
+	}
 
 	return NULL;
 }
@@ -661,6 +693,8 @@ ExecUpdate(ItemPointer tupleid,
 lreplace:;
 		if (resultRelationDesc->rd_att->constr)
 			ExecConstraints(resultRelInfo, slot, estate);
+		if (resultRelInfo->ri_CheckPartition)
+			ExecPartitionCheck(resultRelInfo, slot, estate);
 
 		/*
 		 * replace the heap tuple
@@ -991,7 +1025,10 @@ ExecModifyTable(ModifyTableState *node)
 		switch (operation)
 		{
 			case CMD_INSERT:
-				slot = ExecInsert(slot, planSlot, estate, node->canSetTag);
+				slot = ExecInsert(node, slot, planSlot, estate,
+								  node->canSetTag);
+				/* tuple routing may have changed the current result rel */
+				estate->es_result_relation_info = resultRelInfo;
 				break;
 			case CMD_UPDATE:
 				slot = ExecUpdate(tupleid, oldtuple, slot, planSlot,
@@ -1129,6 +1166,15 @@ ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags)
 
 	estate->es_result_relation_info = saved_resultRelInfo;
 
+	/*
+	 * If inserting into a partitioned table, set up to route the tuples to
+	 * its partitions.
+	 */
+	if (operation == CMD_INSERT &&
+		RelationGetPartitionKey(mtstate->resultRelInfo->ri_RelationDesc) != NULL)
+		mtstate->mt_partition_routing =
+			ExecSetupPartitionTupleRouting(mtstate->resultRelInfo, estate);
+
 	/*
 	 * Initialize RETURNING projections if needed.
 	 */
@@ -1360,6 +1406,12 @@ ExecEndModifyTable(ModifyTableState *node)
 														   resultRelInfo);
 	}
 
+	/*
+	 * Close any partitions opened for tuple routing
+	 */
+	if (node->mt_partition_routing)
+		ExecCleanupTupleRouting(node->mt_partition_routing);
+
 	/*
 	 * Free the exprcontext
 	 */
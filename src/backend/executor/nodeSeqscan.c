@@ -21,9 +21,11 @@
  *		ExecReScanSeqScan		rescans the relation
  *		ExecSeqMarkPos			marks scan position
  *		ExecSeqRestrPos			restores scan position
+ *		ExecSeqScanInitializeParallel	joins a parallel scan
  */
 #include "postgres.h"
 
+#include "access/heapam.h"
 #include "access/relscan.h"
 #include "executor/execdebug.h"
 #include "executor/nodeSeqscan.h"
@@ -135,11 +137,18 @@ InitScanRelation(SeqScanState *node, EState *estate, int eflags)
 									  ((SeqScan *) node->ps.plan)->scanrelid,
 										   eflags);
 
-	/* initialize a heapscan */
-	currentScanDesc = heap_beginscan(currentRelation,
-									 estate->es_snapshot,
-									 0,
-									 NULL);
+	/*
+	 * initialize a heapscan, unless this scan is to be divided among several
+	 * processes; in that case, the Gather node above us will call
+	 * ExecSeqScanInitializeParallel once the shared state is set up.
+	 */
+	if (((SeqScan *) node->ps.plan)->plan.parallel_aware)
+		currentScanDesc = NULL;
+	else
+		currentScanDesc = heap_beginscan(currentRelation,
+										 estate->es_snapshot,
+										 0,
+										 NULL);
 
 	node->ss_currentRelation = currentRelation;
 	node->ss_currentScanDesc = currentScanDesc;
@@ -243,7 +252,8 @@ ExecEndSeqScan(SeqScanState *node)
 	/*
 	 * close heap scan
 	 */
-	heap_endscan(scanDesc);
+	if (scanDesc != NULL)
+		heap_endscan(scanDesc);
 
 	/*
 	 * close the heap relation.
@@ -269,12 +279,35 @@ ExecReScanSeqScan(SeqScanState *node)
 
 	scan = node->ss_currentScanDesc;
 
-	heap_rescan(scan,			/* scan desc */
-				NULL);			/* new scan keys */
+	if (scan != NULL)
+		heap_rescan(scan,		/* scan desc */
+					NULL);		/* new scan keys */
 
 	ExecScanReScan((ScanState *) node);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecSeqScanInitializeParallel
+ *
+ *		Begins (or restarts) a parallel-aware scan, taking blocks from the
+ *		given shared block allocator.
+ * ----------------------------------------------------------------
+ */
+void
+ExecSeqScanInitializeParallel(SeqScanState *node, ParallelHeapScanDesc pscan)
+{
+	if (node->ss_currentScanDesc != NULL)
+	{
+		ExecClearTuple(node->ss_ScanTupleSlot);
+		heap_endscan(node->ss_currentScanDesc);
+	}
+
+	node->ss_currentScanDesc =
+		heap_beginscan_parallel(node->ss_currentRelation,
+								node->ps.state->es_snapshot,
+								pscan);
+}
+
 /* ----------------------------------------------------------------
  *		ExecSeqMarkPos(node)
  *
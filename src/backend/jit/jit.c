@@ -0,0 +1,189 @@
+/*-------------------------------------------------------------------------
+ *
+ * jit.c
+ *	  Provider independent JIT infrastructure.
+ *
+ * Code related to loading JIT providers, redirecting calls into the
+ * provider, and deciding which queries are worth compiling.  The provider
+ * itself is a loadable library, so that the server does not depend on a
+ * compiler framework; when it is not installed, or JIT is disabled,
+ * everything is evaluated by the interpreter in execQual.c.  The LLVM based
+ * provider in src/backend/jit/llvm is built when configured --with-llvm.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/jit/jit.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fmgr.h"
+#include "jit/jit.h"
+#include "miscadmin.h"
+
+
+/* GUCs */
+bool		jit_enabled = false;
+char	   *jit_provider = NULL;
+bool		jit_expressions = true;
+bool		jit_tuple_deforming = true;
+double		jit_above_cost = 100000;
+double		jit_inline_above_cost = 500000;
+double		jit_optimize_above_cost = 500000;
+
+static JitProviderCallbacks provider;
+static bool provider_successfully_loaded = false;
+static bool provider_failed_loading = false;
+
+
+static bool provider_init(void);
+static bool file_exists(const char *name);
+
+
+/*
+ * Load the JIT provider, if not done yet.  Returns true if it's available.
+ *
+ * If the provider library isn't installed, JIT is silently disabled for the
+ * rest of the session.
+ */
+static bool
+provider_init(void)
+{
+	char		path[MAXPGPATH];
+	JitProviderInit init;
+
+	/* don't even try to load if not enabled */
+	if (!jit_enabled)
+		return false;
+
+	/*
+	 * Don't retry loading after failing - attempting to load the provider
+	 * for every query would be expensive.
+	 */
+	if (provider_failed_loading)
+		return false;
+	if (provider_successfully_loaded)
+		return true;
+
+	/*
+	 * Check whether the provider is installed before trying to load it, to
+	 * avoid an error if it isn't.
+	 */
+	snprintf(path, MAXPGPATH, "%s/%s%s", pkglib_path, jit_provider, DLSUFFIX);
+	elog(DEBUG1, "probing availability of JIT provider at %s", path);
+	if (!file_exists(path))
+	{
+		elog(DEBUG1,
+			 "provider not available, disabling JIT for current session");
+		provider_failed_loading = true;
+		return false;
+	}
+
+	/*
+	 * If loading the library fails, it's most likely an installation
+	 * problem, so don't try again in this session.
+	 */
+	provider_failed_loading = true;
+
+	init = (JitProviderInit)
+		load_external_function(path, JIT_PROVIDER_INIT_FUNCTION, true, NULL);
+	init(&provider);
+
+	provider_successfully_loaded = true;
+	provider_failed_loading = false;
+
+	elog(DEBUG1, "successfully loaded JIT provider in current session");
+
+	return true;
+}
+
+/*
+ * Decide, based on the estimated cost of a plan, what kind of JIT
+ * compilation is worthwhile for it.  The result goes into
+ * PlannedStmt->jitFlags.
+ */
+int
+jit_plan_flags(double total_cost)
+{
+	int			flags = PGJIT_NONE;
+
+	if (!jit_enabled || jit_above_cost < 0 ||
+		total_cost <= jit_above_cost)
+		return PGJIT_NONE;
+
+	flags |= PGJIT_PERFORM;
+	if (jit_optimize_above_cost >= 0 &&
+		total_cost > jit_optimize_above_cost)
+		flags |= PGJIT_OPT3;
+	if (jit_inline_above_cost >= 0 &&
+		total_cost > jit_inline_above_cost)
+		flags |= PGJIT_INLINE;
+	if (jit_expressions)
+		flags |= PGJIT_EXPR;
+	if (jit_tuple_deforming)
+		flags |= PGJIT_DEFORM;
+
+	return flags;
+}
+
+/*
+ * Ask the provider to compile an expression that has been flattened into a
+ * program, if the query's plan asks for that.  Returns true if the
+ * expression will now be evaluated by generated code.
+ */
+bool
+jit_compile_expr(ExprState *state, PlanState *parent)
+{
+	/* expressions not belonging to a plan are never worth compiling */
+	if (parent == NULL)
+		return false;
+
+	if (!(parent->state->es_jit_flags & PGJIT_PERFORM))
+		return false;
+	if (!(parent->state->es_jit_flags & PGJIT_EXPR))
+		return false;
+
+	/* the provider translates programs, not ExprState trees */
+	if (state->program == NULL)
+		return false;
+
+	if (provider_init())
+		return provider.compile_expr(state, parent);
+
+	return false;
+}
+
+/*
+ * Release the resources of a query's JIT context.
+ */
+void
+jit_release_context(JitContext *context)
+{
+	if (provider_successfully_loaded)
+		provider.release_context(context);
+}
+
+static bool
+file_exists(const char *name)
+{
+	struct stat st;
+
+	AssertArg(name != NULL);
+
+	if (stat(name, &st) == 0)
+		return S_ISDIR(st.st_mode) ? false : true;
+	else if (!(errno == ENOENT || errno == ENOTDIR))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not access file \"%s\": %m", name)));
+
+	return false;
+}
@@ -0,0 +1,494 @@
+/*-------------------------------------------------------------------------
+ *
+ * llvmjit.c
+ *	  Core part of the LLVM JIT provider.
+ *
+ * This sets up LLVM for the session, creates and releases the JIT contexts
+ * of queries, and turns the modules built by llvmjit_expr.c into machine
+ * code.  Generated code refers to executor data structures and backend
+ * functions by their addresses, which it embeds as constants, so no symbols
+ * need to be resolved when the code is linked.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/jit/llvm/llvmjit.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <llvm-c/Analysis.h>
+#include <llvm-c/Core.h>
+#include <llvm-c/ErrorHandling.h>
+#include <llvm-c/LLJIT.h>
+#include <llvm-c/Orc.h>
+#include <llvm-c/Target.h>
+#include <llvm-c/TargetMachine.h>
+#include <llvm-c/Transforms/PassManagerBuilder.h>
+#include <llvm-c/Transforms/Utils.h>
+
+#include "fmgr.h"
+#include "jit/llvmjit.h"
+#include "utils/memutils.h"
+
+
+PG_MODULE_MAGIC;
+
+
+/* types used by generated code */
+LLVMTypeRef TypeSizeT;
+LLVMTypeRef TypeDatum;
+LLVMTypeRef TypeStorageBool;
+LLVMTypeRef TypeInt8;
+LLVMTypeRef TypeInt16;
+LLVMTypeRef TypeInt32;
+LLVMTypeRef TypeInt64;
+LLVMTypeRef TypeVoid;
+LLVMTypeRef TypePtr;
+
+static bool llvm_session_initialized = false;
+
+/* all code is generated in this context */
+static LLVMOrcThreadSafeContextRef llvm_ts_context;
+static LLVMContextRef llvm_context;
+
+/* JITs for unoptimized and optimized code, created on first use */
+static LLVMOrcLLJITRef llvm_opt0_orc = NULL;
+static LLVMOrcLLJITRef llvm_opt3_orc = NULL;
+
+/* live JIT contexts */
+static dlist_head llvm_contexts = DLIST_STATIC_INIT(llvm_contexts);
+
+/* for unique function names */
+static int	llvm_generation = 0;
+
+
+extern void _PG_jit_provider_init(JitProviderCallbacks *cb);
+
+static void llvm_session_initialize(void);
+static void llvm_release_context(JitContext *context);
+static void llvm_resource_release(ResourceReleasePhase phase, bool isCommit,
+					  bool isTopLevel, void *arg);
+static LLVMOrcLLJITRef llvm_create_jit(LLVMCodeGenOptLevel level);
+static LLVMOrcLLJITRef llvm_get_jit(LLVMJitContext *context);
+static void llvm_optimize_module(LLVMJitContext *context,
+					 LLVMModuleRef module);
+static void llvm_fatal_error_handler(const char *reason);
+static void llvm_error_check(LLVMErrorRef error, const char *what);
+
+
+/*
+ * Initialize LLVM JIT provider.
+ */
+void
+_PG_jit_provider_init(JitProviderCallbacks *cb)
+{
+	cb->compile_expr = llvm_compile_expr;
+	cb->release_context = llvm_release_context;
+}
+
+/*
+ * Set up LLVM for the current session, if not done yet.
+ */
+static void
+llvm_session_initialize(void)
+{
+	if (llvm_session_initialized)
+		return;
+
+	LLVMInitializeNativeTarget();
+	LLVMInitializeNativeAsmPrinter();
+	LLVMInitializeNativeAsmParser();
+
+	/* don't let LLVM abort() the backend without telling why */
+	LLVMInstallFatalErrorHandler(llvm_fatal_error_handler);
+
+	llvm_ts_context = LLVMOrcCreateNewThreadSafeContext();
+	llvm_context = LLVMOrcThreadSafeContextGetContext(llvm_ts_context);
+
+	TypeInt8 = LLVMInt8TypeInContext(llvm_context);
+	TypeInt16 = LLVMInt16TypeInContext(llvm_context);
+	TypeInt32 = LLVMInt32TypeInContext(llvm_context);
+	TypeInt64 = LLVMInt64TypeInContext(llvm_context);
+	TypeSizeT = LLVMIntTypeInContext(llvm_context, sizeof(size_t) * BITS_PER_BYTE);
+	TypeDatum = LLVMIntTypeInContext(llvm_context, sizeof(Datum) * BITS_PER_BYTE);
+	TypeStorageBool = LLVMIntTypeInContext(llvm_context, sizeof(bool) * BITS_PER_BYTE);
+	TypeVoid = LLVMVoidTypeInContext(llvm_context);
+	TypePtr = LLVMPointerType(TypeInt8, 0);
+
+	RegisterResourceReleaseCallback(llvm_resource_release, NULL);
+
+	llvm_session_initialized = true;
+}
+
+/*
+ * Create a JIT context for a query.  It lives until FreeExecutorState calls
+ * llvm_release_context, or until the resource owner that was current here is
+ * released after an error.
+ */
+static LLVMJitContext *
+llvm_create_context(int jitFlags)
+{
+	LLVMJitContext *context;
+
+	context = (LLVMJitContext *)
+		MemoryContextAllocZero(TopMemoryContext, sizeof(LLVMJitContext));
+	context->base.flags = jitFlags;
+	context->resowner = CurrentResourceOwner;
+	context->tracker = NULL;
+	dlist_push_tail(&llvm_contexts, &context->node);
+
+	return context;
+}
+
+/*
+ * Return the JIT context of the query an expression belongs to, creating it
+ * on first use.
+ */
+LLVMJitContext *
+llvm_get_context(EState *estate)
+{
+	llvm_session_initialize();
+
+	if (estate->es_jit == NULL)
+		estate->es_jit = &llvm_create_context(estate->es_jit_flags)->base;
+
+	return (LLVMJitContext *) estate->es_jit;
+}
+
+/*
+ * Release the code generated for a query.
+ */
+static void
+llvm_release_context(JitContext *context)
+{
+	LLVMJitContext *llvmctx = (LLVMJitContext *) context;
+
+	dlist_delete(&llvmctx->node);
+
+	if (llvmctx->tracker)
+	{
+		LLVMErrorRef error;
+
+		error = LLVMOrcResourceTrackerRemove(llvmctx->tracker);
+		LLVMOrcReleaseResourceTracker(llvmctx->tracker);
+		llvmctx->tracker = NULL;
+		if (error)
+		{
+			char	   *msg = LLVMGetErrorMessage(error);
+
+			elog(WARNING, "could not release JIT code: %s", msg);
+			LLVMDisposeErrorMessage(msg);
+		}
+	}
+
+	pfree(llvmctx);
+}
+
+/*
+ * Release the contexts of queries that failed, which FreeExecutorState
+ * never got to.  They are recognized by the resource owner being released.
+ */
+static void
+llvm_resource_release(ResourceReleasePhase phase, bool isCommit,
+					  bool isTopLevel, void *arg)
+{
+	dlist_mutable_iter iter;
+
+	if (phase != RESOURCE_RELEASE_AFTER_LOCKS)
+		return;
+
+	dlist_foreach_modify(iter, &llvm_contexts)
+	{
+		LLVMJitContext *context =
+		dlist_container(LLVMJitContext, node, iter.cur);
+
+		if (context->resowner == CurrentResourceOwner)
+			llvm_release_context(&context->base);
+	}
+}
+
+/*
+ * Return a new, empty module for code of the given context.
+ */
+LLVMModuleRef
+llvm_create_module(LLVMJitContext *context)
+{
+	LLVMOrcLLJITRef jit = llvm_get_jit(context);
+	LLVMModuleRef module;
+
+	module = LLVMModuleCreateWithNameInContext("pg", llvm_context);
+	LLVMSetTarget(module, LLVMOrcLLJITGetTripleString(jit));
+	LLVMSetDataLayout(module, LLVMOrcLLJITGetDataLayoutStr(jit));
+
+	return module;
+}
+
+/*
+ * Optimize a module, turn it into machine code, and return the address of
+ * the named function in it.  The module is consumed.
+ */
+void *
+llvm_emit_module(LLVMJitContext *context, LLVMModuleRef module,
+				 const char *funcname)
+{
+	LLVMOrcLLJITRef jit = llvm_get_jit(context);
+	LLVMOrcThreadSafeModuleRef ts_module;
+	LLVMOrcExecutorAddress addr;
+
+#ifdef USE_ASSERT_CHECKING
+	if (LLVMVerifyModule(module, LLVMPrintMessageAction, NULL))
+		elog(ERROR, "generated code for \"%s\" is broken", funcname);
+#endif
+
+	llvm_optimize_module(context, module);
+
+	if (context->tracker == NULL)
+		context->tracker = LLVMOrcJITDylibCreateResourceTracker(
+									   LLVMOrcLLJITGetMainJITDylib(jit));
+
+	ts_module = LLVMOrcCreateNewThreadSafeModule(module, llvm_ts_context);
+	llvm_error_check(LLVMOrcLLJITAddLLVMIRModuleWithRT(jit, context->tracker,
+													   ts_module),
+					 "add module");
+
+	/* this is where the machine code actually gets generated */
+	llvm_error_check(LLVMOrcLLJITLookup(jit, &addr, funcname),
+					 "look up function");
+
+	return (void *) (uintptr_t) addr;
+}
+
+/*
+ * Return a name for a generated function that is unique in this process.
+ */
+char *
+llvm_unique_name(const char *prefix)
+{
+	char	   *name = palloc(NAMEDATALEN);
+
+	snprintf(name, NAMEDATALEN, "%s_%d", prefix, ++llvm_generation);
+	return name;
+}
+
+/*
+ * Return the JIT matching the optimization level a context asks for.
+ */
+static LLVMOrcLLJITRef
+llvm_get_jit(LLVMJitContext *context)
+{
+	if (context->base.flags & PGJIT_OPT3)
+	{
+		if (llvm_opt3_orc == NULL)
+			llvm_opt3_orc = llvm_create_jit(LLVMCodeGenLevelAggressive);
+		return llvm_opt3_orc;
+	}
+	else
+	{
+		if (llvm_opt0_orc == NULL)
+			llvm_opt0_orc = llvm_create_jit(LLVMCodeGenLevelNone);
+		return llvm_opt0_orc;
+	}
+}
+
+static LLVMOrcLLJITRef
+llvm_create_jit(LLVMCodeGenOptLevel level)
+{
+	char	   *triple;
+	char	   *cpu;
+	char	   *features;
+	char	   *errmsg = NULL;
+	LLVMTargetRef target;
+	LLVMTargetMachineRef tm;
+	LLVMOrcLLJITBuilderRef builder;
+	LLVMOrcLLJITRef jit;
+
+	triple = LLVMGetDefaultTargetTriple();
+	if (LLVMGetTargetFromTriple(triple, &target, &errmsg))
+	{
+		char	   *msg = pstrdup(errmsg);
+
+		LLVMDisposeMessage(errmsg);
+		LLVMDisposeMessage(triple);
+		elog(ERROR, "could not find LLVM target: %s", msg);
+	}
+
+	cpu = LLVMGetHostCPUName();
+	features = LLVMGetHostCPUFeatures();
+	tm = LLVMCreateTargetMachine(target, triple, cpu, features, level,
+								 LLVMRelocDefault, LLVMCodeModelJITDefault);
+	LLVMDisposeMessage(triple);
+	LLVMDisposeMessage(cpu);
+	LLVMDisposeMessage(features);
+
+	builder = LLVMOrcCreateLLJITBuilder();
+	LLVMOrcLLJITBuilderSetJITTargetMachineBuilder(builder,
+					LLVMOrcJITTargetMachineBuilderCreateFromTargetMachine(tm));
+	llvm_error_check(LLVMOrcCreateLLJIT(&jit, builder), "create JIT");
+
+	return jit;
+}
+
+/*
+ * Run the optimizer over a module.  Without PGJIT_OPT3 we only turn the
+ * stack slots the code generator uses for local variables into registers,
+ * which is cheap and makes a big difference to the quality of the code.
+ */
+static void
+llvm_optimize_module(LLVMJitContext *context, LLVMModuleRef module)
+{
+	LLVMPassManagerBuilderRef pmb;
+	LLVMPassManagerRef fpm;
+	LLVMPassManagerRef mpm;
+	LLVMValueRef func;
+	bool		opt3 = (context->base.flags & PGJIT_OPT3) != 0;
+
+	pmb = LLVMPassManagerBuilderCreate();
+	LLVMPassManagerBuilderSetOptLevel(pmb, opt3 ? 3 : 0);
+
+	fpm = LLVMCreateFunctionPassManagerForModule(module);
+	if (opt3)
+		LLVMPassManagerBuilderUseInlinerWithThreshold(pmb, 512);
+	else
+		LLVMAddPromoteMemoryToRegisterPass(fpm);
+	LLVMPassManagerBuilderPopulateFunctionPassManager(pmb, fpm);
+
+	LLVMInitializeFunctionPassManager(fpm);
+	for (func = LLVMGetFirstFunction(module);
+		 func != NULL;
+		 func = LLVMGetNextFunction(func))
+	{
+		if (!LLVMIsDeclaration(func))
+			LLVMRunFunctionPassManager(fpm, func);
+	}
+	LLVMFinalizeFunctionPassManager(fpm);
+	LLVMDisposePassManager(fpm);
+
+	mpm = LLVMCreatePassManager();
+	LLVMPassManagerBuilderPopulateModulePassManager(pmb, mpm);
+	LLVMRunPassManager(mpm, module);
+	LLVMDisposePassManager(mpm);
+
+	LLVMPassManagerBuilderDispose(pmb);
+}
+
+static void
+llvm_fatal_error_handler(const char *reason)
+{
+	ereport(FATAL,
+			(errcode(ERRCODE_OUT_OF_MEMORY),
+			 errmsg("fatal llvm error: %s", reason)));
+}
+
+/*
+ * Throw an error if an LLVM operation failed.
+ */
+static void
+llvm_error_check(LLVMErrorRef error, const char *what)
+{
+	char	   *llvm_msg;
+	char	   *msg;
+
+	if (error == NULL)
+		return;
+
+	llvm_msg = LLVMGetErrorMessage(error);
+	msg = pstrdup(llvm_msg);
+	LLVMDisposeErrorMessage(llvm_msg);
+
+	elog(ERROR, "LLVM failed to %s: %s", what, msg);
+}
+
+
+/*
+ * Helpers for building code.
+ *
+ * Executor data structures are accessed through an i8 pointer to their
+ * start plus the offset of the field in question, which keeps us from
+ * having to mirror the structs in LLVM types.
+ */
+
+/* a pointer constant of the given type */
+LLVMValueRef
+l_ptr_const(void *ptr, LLVMTypeRef type)
+{
+	LLVMValueRef c = LLVMConstInt(TypeSizeT, (uintptr_t) ptr, false);
+
+	return LLVMConstIntToPtr(c, type);
+}
+
+LLVMValueRef
+l_int8_const(int8 i)
+{
+	return LLVMConstInt(TypeInt8, i, false);
+}
+
+LLVMValueRef
+l_int16_const(int16 i)
+{
+	return LLVMConstInt(TypeInt16, i, false);
+}
+
+LLVMValueRef
+l_int32_const(int32 i)
+{
+	return LLVMConstInt(TypeInt32, i, false);
+}
+
+LLVMValueRef
+l_int64_const(int64 i)
+{
+	return LLVMConstInt(TypeInt64, i, false);
+}
+
+LLVMValueRef
+l_sizet_const(size_t i)
+{
+	return LLVMConstInt(TypeSizeT, i, false);
+}
+
+/* pointer to the field of the given type at offset bytes into *base */
+LLVMValueRef
+l_field_ptr(LLVMBuilderRef b, LLVMValueRef base, size_t offset,
+			LLVMTypeRef type)
+{
+	LLVMValueRef off = l_sizet_const(offset);
+	LLVMValueRef ptr;
+
+	ptr = LLVMBuildGEP2(b, TypeInt8, base, &off, 1, "");
+	return LLVMBuildBitCast(b, ptr, LLVMPointerType(type, 0), "");
+}
+
+LLVMValueRef
+l_load_field(LLVMBuilderRef b, LLVMValueRef base, size_t offset,
+			 LLVMTypeRef type, const char *name)
+{
+	return LLVMBuildLoad2(b, type, l_field_ptr(b, base, offset, type), name);
+}
+
+void
+l_store_field(LLVMBuilderRef b, LLVMValueRef value, LLVMValueRef base,
+			  size_t offset)
+{
+	LLVMBuildStore(b, value,
+				   l_field_ptr(b, base, offset, LLVMTypeOf(value)));
+}
+
+/*
+ * Call the C function at address fn.  Only pass pointers and integers of
+ * at least int width, since we don't tell LLVM how the C calling convention
+ * extends narrower ones.
+ */
+LLVMValueRef
+l_call(LLVMBuilderRef b, void *fn, LLVMTypeRef rettype,
+	   LLVMTypeRef *paramtypes, LLVMValueRef *args, int nargs)
+{
+	LLVMTypeRef fntype = LLVMFunctionType(rettype, paramtypes, nargs, false);
+
+	return LLVMBuildCall2(b, fntype,
+						  l_ptr_const(fn, LLVMPointerType(fntype, 0)),
+						  args, nargs, "");
+}
@@ -0,0 +1,474 @@
+/*-------------------------------------------------------------------------
+ *
+ * llvmjit_deform.c
+ *	  Generate code for deforming a heap tuple.
+ *
+ * This gains performance over slot_getsomeattrs mainly by unrolling the
+ * loop over the attributes, and by knowing their types, alignment and
+ * nullability up front.  Where the offset of an attribute can't vary, it is
+ * computed at compile time.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/jit/llvm/llvmjit_deform.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "access/tupdesc.h"
+#include "executor/tuptable.h"
+#include "jit/llvmjit.h"
+
+
+static Size llvmjit_varsize_external(char *ptr);
+static LLVMValueRef l_align(LLVMBuilderRef b, LLVMValueRef off, int alignto);
+static int	attalign_bytes(char attalign);
+
+
+/*
+ * Create a function that deforms the first natts attributes of a heap tuple
+ * with descriptor desc into a slot, and returns nothing.
+ *
+ * The generated code only handles the common case of a slot with that very
+ * descriptor, holding a physical tuple that has at least natts attributes,
+ * none of which have been extracted yet.  Anything else is passed on to
+ * slot_getsomeattrs.  The slot is left in a state slot_getattr can continue
+ * from.
+ */
+LLVMValueRef
+slot_compile_deform(LLVMModuleRef module, TupleDesc desc, int natts)
+{
+	LLVMContextRef lc = LLVMGetModuleContext(module);
+	LLVMBuilderRef b;
+	LLVMTypeRef deform_sig;
+	LLVMValueRef v_deform;
+	LLVMBasicBlockRef b_entry;
+	LLVMBasicBlockRef b_check;
+	LLVMBasicBlockRef b_checknatts;
+	LLVMBasicBlockRef b_start;
+	LLVMBasicBlockRef b_fallback;
+	LLVMBasicBlockRef b_out;
+	LLVMBasicBlockRef b_done;
+	LLVMBasicBlockRef *attcheckblocks;
+	LLVMBasicBlockRef *attstartblocks;
+	LLVMValueRef v_slot;
+	LLVMValueRef v_nvalid;
+	LLVMValueRef v_tuple;
+	LLVMValueRef v_tupdata;
+	LLVMValueRef v_infomask;
+	LLVMValueRef v_hasnulls;
+	LLVMValueRef v_maxatt;
+	LLVMValueRef v_tp;
+	LLVMValueRef v_bits;
+	LLVMValueRef v_values;
+	LLVMValueRef v_nulls;
+	LLVMValueRef v_offp;
+	LLVMValueRef cond;
+	char	   *funcname;
+	long		known_off = 0;	/* offset at compile time, or -1 */
+	int			attnum;
+
+	Assert(natts > 0 && natts <= desc->natts);
+
+	funcname = llvm_unique_name("deform");
+	deform_sig = LLVMFunctionType(TypeVoid, &TypePtr, 1, false);
+	v_deform = LLVMAddFunction(module, funcname, deform_sig);
+	LLVMSetLinkage(v_deform, LLVMInternalLinkage);
+	v_slot = LLVMGetParam(v_deform, 0);
+
+	b = LLVMCreateBuilderInContext(lc);
+
+	b_entry = LLVMAppendBasicBlockInContext(lc, v_deform, "entry");
+	b_check = LLVMAppendBasicBlockInContext(lc, v_deform, "check");
+	b_checknatts = LLVMAppendBasicBlockInContext(lc, v_deform, "checknatts");
+	b_start = LLVMAppendBasicBlockInContext(lc, v_deform, "start");
+
+	attcheckblocks = palloc(sizeof(LLVMBasicBlockRef) * natts);
+	attstartblocks = palloc(sizeof(LLVMBasicBlockRef) * natts);
+	for (attnum = 0; attnum < natts; attnum++)
+	{
+		attcheckblocks[attnum] =
+			LLVMAppendBasicBlockInContext(lc, v_deform, "attcheck");
+		attstartblocks[attnum] =
+			LLVMAppendBasicBlockInContext(lc, v_deform, "attstart");
+	}
+	b_out = LLVMAppendBasicBlockInContext(lc, v_deform, "out");
+	b_fallback = LLVMAppendBasicBlockInContext(lc, v_deform, "fallback");
+	b_done = LLVMAppendBasicBlockInContext(lc, v_deform, "done");
+
+	/* quick out if the attributes have been extracted already */
+	LLVMPositionBuilderAtEnd(b, b_entry);
+	v_offp = LLVMBuildAlloca(b, TypeSizeT, "v_offp");
+	v_nvalid = l_load_field(b, v_slot, offsetof(TupleTableSlot, tts_nvalid),
+							TypeInt32, "nvalid");
+	cond = LLVMBuildICmp(b, LLVMIntSGE, v_nvalid, l_int32_const(natts), "");
+	LLVMBuildCondBr(b, cond, b_done, b_check);
+
+	/* is this a case we handle? */
+	LLVMPositionBuilderAtEnd(b, b_check);
+	v_tuple = l_load_field(b, v_slot, offsetof(TupleTableSlot, tts_tuple),
+						   TypePtr, "tuple");
+	cond = LLVMBuildICmp(b, LLVMIntEQ,
+						 l_load_field(b, v_slot,
+								 offsetof(TupleTableSlot, tts_tupleDescriptor),
+									  TypePtr, "desc"),
+						 l_ptr_const(desc, TypePtr), "");
+	cond = LLVMBuildAnd(b, cond,
+						LLVMBuildICmp(b, LLVMIntEQ, v_nvalid,
+									  l_int32_const(0), ""), "");
+	cond = LLVMBuildAnd(b, cond,
+						LLVMBuildIsNotNull(b, v_tuple, ""), "");
+	LLVMBuildCondBr(b, cond, b_checknatts, b_fallback);
+
+	/* tuples from before columns were added need the missing ones nulled */
+	LLVMPositionBuilderAtEnd(b, b_checknatts);
+	v_tupdata = l_load_field(b, v_tuple, offsetof(HeapTupleData, t_data),
+							 TypePtr, "tupdata");
+	v_maxatt = LLVMBuildAnd(b,
+							l_load_field(b, v_tupdata,
+								 offsetof(HeapTupleHeaderData, t_infomask2),
+										 TypeInt16, "infomask2"),
+							l_int16_const(HEAP_NATTS_MASK), "maxatt");
+	cond = LLVMBuildICmp(b, LLVMIntUGE, v_maxatt, l_int16_const(natts), "");
+	LLVMBuildCondBr(b, cond, b_start, b_fallback);
+
+	LLVMPositionBuilderAtEnd(b, b_start);
+	v_infomask = l_load_field(b, v_tupdata,
+							  offsetof(HeapTupleHeaderData, t_infomask),
+							  TypeInt16, "infomask");
+	v_hasnulls = LLVMBuildICmp(b, LLVMIntNE,
+							   LLVMBuildAnd(b, v_infomask,
+											l_int16_const(HEAP_HASNULL), ""),
+							   l_int16_const(0), "hasnulls");
+	v_tp = LLVMBuildZExt(b,
+						 l_load_field(b, v_tupdata,
+									  offsetof(HeapTupleHeaderData, t_hoff),
+									  TypeInt8, "hoff"),
+						 TypeSizeT, "");
+	v_tp = LLVMBuildGEP2(b, TypeInt8, v_tupdata, &v_tp, 1, "tp");
+	v_bits = l_field_ptr(b, v_tupdata, offsetof(HeapTupleHeaderData, t_bits),
+						 TypeInt8);
+	v_values = l_load_field(b, v_slot, offsetof(TupleTableSlot, tts_values),
+							LLVMPointerType(TypeDatum, 0), "values");
+	v_nulls = l_load_field(b, v_slot, offsetof(TupleTableSlot, tts_isnull),
+						   LLVMPointerType(TypeStorageBool, 0), "nulls");
+	LLVMBuildStore(b, l_sizet_const(0), v_offp);
+	LLVMBuildBr(b, attcheckblocks[0]);
+
+	for (attnum = 0; attnum < natts; attnum++)
+	{
+		Form_pg_attribute att = desc->attrs[attnum];
+		LLVMBasicBlockRef b_next;
+		LLVMValueRef v_attnum = l_int32_const(attnum);
+		LLVMValueRef v_off;
+		LLVMValueRef v_attdatap;
+		LLVMValueRef v_value;
+		int			alignto = attalign_bytes(att->attalign);
+
+		b_next = (attnum + 1 < natts) ? attcheckblocks[attnum + 1] : b_out;
+
+		/*
+		 * Check for a NULL, unless the column can't contain any.  A NULL
+		 * takes no space, so the offsets of later attributes aren't known
+		 * at compile time anymore.
+		 */
+		LLVMPositionBuilderAtEnd(b, attcheckblocks[attnum]);
+		if (!att->attnotnull)
+		{
+			LLVMBasicBlockRef b_checkbit;
+			LLVMBasicBlockRef b_isnull;
+			LLVMValueRef v_nullbyte;
+			LLVMValueRef v_nullbit;
+			LLVMValueRef v_byteoff = l_int32_const(attnum >> 3);
+
+			b_checkbit = LLVMInsertBasicBlockInContext(lc, attstartblocks[attnum],
+													   "checkbit");
+			b_isnull = LLVMInsertBasicBlockInContext(lc, attstartblocks[attnum],
+													 "attisnull");
+
+			LLVMBuildCondBr(b, v_hasnulls, b_checkbit, attstartblocks[attnum]);
+
+			LLVMPositionBuilderAtEnd(b, b_checkbit);
+			v_nullbyte = LLVMBuildLoad2(b, TypeInt8,
+										LLVMBuildGEP2(b, TypeInt8, v_bits,
+													  &v_byteoff, 1, ""),
+										"nullbyte");
+			v_nullbit = LLVMBuildAnd(b, v_nullbyte,
+									 l_int8_const(1 << (attnum & 0x07)), "");
+			cond = LLVMBuildICmp(b, LLVMIntEQ, v_nullbit, l_int8_const(0),
+								 "attisnull");
+			LLVMBuildCondBr(b, cond, b_isnull, attstartblocks[attnum]);
+
+			LLVMPositionBuilderAtEnd(b, b_isnull);
+			LLVMBuildStore(b, LLVMConstInt(TypeDatum, 0, false),
+						   LLVMBuildGEP2(b, TypeDatum, v_values,
+										 &v_attnum, 1, ""));
+			LLVMBuildStore(b, LLVMConstInt(TypeStorageBool, 1, false),
+						   LLVMBuildGEP2(b, TypeStorageBool, v_nulls,
+										 &v_attnum, 1, ""));
+			LLVMBuildBr(b, b_next);
+		}
+		else
+			LLVMBuildBr(b, attstartblocks[attnum]);
+
+		LLVMPositionBuilderAtEnd(b, attstartblocks[attnum]);
+		LLVMBuildStore(b, LLVMConstInt(TypeStorageBool, 0, false),
+					   LLVMBuildGEP2(b, TypeStorageBool, v_nulls,
+									 &v_attnum, 1, ""));
+
+		/*
+		 * Align the offset, as att_align_pointer would.  Whether a varlena
+		 * is preceded by padding depends on its header, unless the offset
+		 * is aligned already.
+		 */
+		if (known_off >= 0 &&
+			(att->attlen != -1 ||
+			 known_off == att_align_nominal(known_off, att->attalign)))
+		{
+			known_off = att_align_nominal(known_off, att->attalign);
+			v_off = l_sizet_const(known_off);
+		}
+		else
+		{
+			if (known_off >= 0)
+				v_off = l_sizet_const(known_off);
+			else
+				v_off = LLVMBuildLoad2(b, TypeSizeT, v_offp, "off");
+			known_off = -1;
+
+			if (alignto > 1)
+			{
+				LLVMValueRef v_aligned = l_align(b, v_off, alignto);
+
+				if (att->attlen == -1)
+				{
+					LLVMValueRef v_firstbyte;
+
+					/* a varlena with a short header is not aligned */
+					v_firstbyte =
+						LLVMBuildLoad2(b, TypeInt8,
+									   LLVMBuildGEP2(b, TypeInt8, v_tp,
+													 &v_off, 1, ""),
+									   "firstbyte");
+					cond = LLVMBuildICmp(b, LLVMIntNE, v_firstbyte,
+										 l_int8_const(0), "");
+					v_off = LLVMBuildSelect(b, cond, v_off, v_aligned, "");
+				}
+				else
+					v_off = v_aligned;
+			}
+		}
+
+		/* fetch the value, as fetchatt would */
+		v_attdatap = LLVMBuildGEP2(b, TypeInt8, v_tp, &v_off, 1, "attdatap");
+		if (att->attbyval)
+		{
+			LLVMTypeRef vartype = LLVMIntTypeInContext(lc, att->attlen * BITS_PER_BYTE);
+
+			v_value = LLVMBuildLoad2(b, vartype,
+									 LLVMBuildBitCast(b, v_attdatap,
+											   LLVMPointerType(vartype, 0), ""),
+									 "");
+			LLVMSetAlignment(v_value, alignto);
+			if (att->attlen < (int) sizeof(Datum))
+				v_value = LLVMBuildZExt(b, v_value, TypeDatum, "");
+		}
+		else
+			v_value = LLVMBuildPtrToInt(b, v_attdatap, TypeDatum, "");
+		LLVMBuildStore(b, v_value,
+					   LLVMBuildGEP2(b, TypeDatum, v_values, &v_attnum, 1, ""));
+
+		/* compute the offset of the next attribute */
+		if (att->attlen > 0)
+		{
+			if (known_off >= 0)
+				known_off += att->attlen;
+			v_off = LLVMBuildAdd(b, v_off, l_sizet_const(att->attlen), "");
+		}
+		else if (att->attlen == -1)
+		{
+			LLVMBasicBlockRef b_4b;
+			LLVMBasicBlockRef b_1b;
+			LLVMBasicBlockRef b_1be;
+			LLVMBasicBlockRef b_len;
+			LLVMBasicBlockRef b_cur;
+			LLVMValueRef v_firstbyte;
+			LLVMValueRef v_len4b;
+			LLVMValueRef v_len1b;
+			LLVMValueRef v_len1be;
+			LLVMValueRef v_len;
+			LLVMValueRef incoming[3];
+			LLVMBasicBlockRef incomingblocks[3];
+
+			/* VARSIZE_ANY, with the external case out of line */
+			b_cur = LLVMGetInsertBlock(b);
+			b_4b = LLVMInsertBasicBlockInContext(lc, b_next, "len4b");
+			b_1b = LLVMInsertBasicBlockInContext(lc, b_next, "len1b");
+			b_1be = LLVMInsertBasicBlockInContext(lc, b_next, "len1be");
+			b_len = LLVMInsertBasicBlockInContext(lc, b_next, "len");
+
+			LLVMPositionBuilderAtEnd(b, b_cur);
+			v_firstbyte = LLVMBuildLoad2(b, TypeInt8, v_attdatap, "firstbyte");
+#ifdef WORDS_BIGENDIAN
+			cond = LLVMBuildICmp(b, LLVMIntEQ,
+								 LLVMBuildAnd(b, v_firstbyte,
+											  l_int8_const(0x80), ""),
+								 l_int8_const(0), "is4b");
+#else
+			cond = LLVMBuildICmp(b, LLVMIntEQ,
+								 LLVMBuildAnd(b, v_firstbyte,
+											  l_int8_const(0x01), ""),
+								 l_int8_const(0), "is4b");
+#endif
+			LLVMBuildCondBr(b, cond, b_4b, b_1b);
+
+			LLVMPositionBuilderAtEnd(b, b_4b);
+			v_len4b = LLVMBuildLoad2(b, TypeInt32,
+									 LLVMBuildBitCast(b, v_attdatap,
+											  LLVMPointerType(TypeInt32, 0), ""),
+									 "");
+			LLVMSetAlignment(v_len4b, alignto);
+#ifndef WORDS_BIGENDIAN
+			v_len4b = LLVMBuildLShr(b, v_len4b, l_int32_const(2), "");
+#endif
+			v_len4b = LLVMBuildAnd(b, v_len4b, l_int32_const(0x3FFFFFFF), "");
+			v_len4b = LLVMBuildZExt(b, v_len4b, TypeSizeT, "");
+			LLVMBuildBr(b, b_len);
+
+			LLVMPositionBuilderAtEnd(b, b_1b);
+#ifdef WORDS_BIGENDIAN
+			cond = LLVMBuildICmp(b, LLVMIntEQ, v_firstbyte,
+								 l_int8_const(0x80), "is1be");
+			v_len1b = LLVMBuildAnd(b, v_firstbyte, l_int8_const(0x7F), "");
+#else
+			cond = LLVMBuildICmp(b, LLVMIntEQ, v_firstbyte,
+								 l_int8_const(0x01), "is1be");
+			v_len1b = LLVMBuildAnd(b,
+								   LLVMBuildLShr(b, v_firstbyte,
+												 l_int8_const(1), ""),
+								   l_int8_const(0x7F), "");
+#endif
+			v_len1b = LLVMBuildZExt(b, v_len1b, TypeSizeT, "");
+			LLVMBuildCondBr(b, cond, b_1be, b_len);
+
+			LLVMPositionBuilderAtEnd(b, b_1be);
+			v_len1be = l_call(b, (void *) llvmjit_varsize_external, TypeSizeT,
+							  &TypePtr, &v_attdatap, 1);
+			LLVMBuildBr(b, b_len);
+
+			LLVMPositionBuilderAtEnd(b, b_len);
+			v_len = LLVMBuildPhi(b, TypeSizeT, "attlen");
+			incoming[0] = v_len4b;
+			incomingblocks[0] = b_4b;
+			incoming[1] = v_len1b;
+			incomingblocks[1] = b_1b;
+			incoming[2] = v_len1be;
+			incomingblocks[2] = b_1be;
+			LLVMAddIncoming(v_len, incoming, incomingblocks, 3);
+
+			known_off = -1;
+			v_off = LLVMBuildAdd(b, v_off, v_len, "");
+		}
+		else
+		{
+			LLVMTypeRef strlen_params[1];
+			LLVMValueRef v_len;
+
+			Assert(att->attlen == -2);
+
+			strlen_params[0] = TypePtr;
+			v_len = l_call(b, (void *) strlen, TypeSizeT, strlen_params,
+						   &v_attdatap, 1);
+			known_off = -1;
+			v_off = LLVMBuildAdd(b, v_off,
+								 LLVMBuildAdd(b, v_len, l_sizet_const(1), ""),
+								 "");
+		}
+		LLVMBuildStore(b, v_off, v_offp);
+
+		if (!att->attnotnull)
+			known_off = -1;
+
+		LLVMBuildBr(b, b_next);
+	}
+
+	/*
+	 * Save the state for slot_getattr.  Since we don't maintain attcacheoff,
+	 * tell it not to rely on it.
+	 */
+	LLVMPositionBuilderAtEnd(b, b_out);
+	l_store_field(b, l_int32_const(natts), v_slot,
+				  offsetof(TupleTableSlot, tts_nvalid));
+	l_store_field(b,
+				  LLVMBuildIntCast(b, LLVMBuildLoad2(b, TypeSizeT, v_offp, ""),
+								   LLVMIntTypeInContext(lc, sizeof(long) * BITS_PER_BYTE),
+								   ""),
+				  v_slot, offsetof(TupleTableSlot, tts_off));
+	l_store_field(b, LLVMConstInt(TypeStorageBool, 1, false), v_slot,
+				  offsetof(TupleTableSlot, tts_slow));
+	LLVMBuildBr(b, b_done);
+
+	LLVMPositionBuilderAtEnd(b, b_fallback);
+	{
+		LLVMTypeRef params[2];
+		LLVMValueRef args[2];
+
+		params[0] = TypePtr;
+		params[1] = TypeInt32;
+		args[0] = v_slot;
+		args[1] = l_int32_const(natts);
+		l_call(b, (void *) slot_getsomeattrs, TypeVoid, params, args, 2);
+		LLVMBuildBr(b, b_done);
+	}
+
+	LLVMPositionBuilderAtEnd(b, b_done);
+	LLVMBuildRetVoid(b);
+
+	LLVMDisposeBuilder(b);
+	pfree(attcheckblocks);
+	pfree(attstartblocks);
+
+	return v_deform;
+}
+
+/*
+ * Length of a varlena with a 1-byte external header.
+ */
+static Size
+llvmjit_varsize_external(char *ptr)
+{
+	return VARSIZE_EXTERNAL(ptr);
+}
+
+/* round off up to the next multiple of alignto, a power of 2 */
+static LLVMValueRef
+l_align(LLVMBuilderRef b, LLVMValueRef off, int alignto)
+{
+	return LLVMBuildAnd(b,
+						LLVMBuildAdd(b, off, l_sizet_const(alignto - 1), ""),
+						l_sizet_const(~((size_t) (alignto - 1))), "");
+}
+
+static int
+attalign_bytes(char attalign)
+{
+	switch (attalign)
+	{
+		case 'i':
+			return ALIGNOF_INT;
+		case 'c':
+			return 1;
+		case 'd':
+			return ALIGNOF_DOUBLE;
+		case 's':
+			return ALIGNOF_SHORT;
+		default:
+			elog(ERROR, "unrecognized attalign: %d", (int) attalign);
+			return 0;			/* keep compiler quiet */
+	}
+}
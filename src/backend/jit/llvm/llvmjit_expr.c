@@ -0,0 +1,1032 @@
+/*-------------------------------------------------------------------------
+ *
+ * llvmjit_expr.c
+ *	  Translate expression programs into native code with LLVM.
+ *
+ * Each step of an ExprEvalProgram (see executor/execExpr.h) becomes a basic
+ * block doing what ExecEvalProgram does for the step, and jumps between
+ * steps become branches.  Run-time state stays where the interpreter keeps
+ * it, in the steps and the ExprState tree, so generated code and the
+ * recursive routines can work on the same expression.
+ *
+ * The code for an expression is generated the first time it's evaluated,
+ * rather than when ExecInitExpr hands it to us, because only then are the
+ * descriptors of the slots it reads from known; the attributes it needs are
+ * extracted by code specialized for those descriptors (see
+ * llvmjit_deform.c).
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/jit/llvm/llvmjit_expr.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "executor/execExpr.h"
+#include "executor/nodeAgg.h"
+#include "executor/tuptable.h"
+#include "jit/llvmjit.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+
+
+static Datum llvm_compile_and_run_expr(ExprState *state,
+						  ExprContext *econtext,
+						  bool *isNull,
+						  ExprDoneCond *isDone);
+static ExprStateEvalFunc llvm_build_program(LLVMJitContext *context,
+				   ExprEvalProgram *prog,
+				   ExprContext *econtext);
+static void build_slot_setup(LLVMJitContext *context, LLVMModuleRef module,
+				 LLVMBuilderRef b, LLVMValueRef v_econtext,
+				 TupleTableSlot *slot, size_t slotoffset, int natts,
+				 LLVMValueRef *v_slot, LLVMValueRef *v_values,
+				 LLVMValueRef *v_nulls);
+static LLVMValueRef l_datum_getbool(LLVMBuilderRef b, LLVMValueRef v);
+static void llvmjit_check_var(TupleTableSlot *slot, int attnum, Oid vartype);
+static void llvmjit_end_function_usage(PgStat_FunctionCallUsage *fcu);
+
+
+/*
+ * Take over evaluation of an expression program.  The code is generated on
+ * first use, see llvm_compile_and_run_expr.
+ */
+bool
+llvm_compile_expr(ExprState *state, PlanState *parent)
+{
+	state->program->jit_private = llvm_get_context(parent->state);
+	state->evalfunc = llvm_compile_and_run_expr;
+
+	return true;
+}
+
+/*
+ * evalfunc of a program whose code hasn't been generated yet.  Generate it,
+ * install it as the evalfunc, and run it.
+ */
+static Datum
+llvm_compile_and_run_expr(ExprState *state, ExprContext *econtext,
+						  bool *isNull, ExprDoneCond *isDone)
+{
+	ExprEvalProgram *prog = state->program;
+	ExprStateEvalFunc func;
+
+	func = llvm_build_program((LLVMJitContext *) prog->jit_private,
+							  prog, econtext);
+	state->evalfunc = func;
+
+	return func(state, econtext, isNull, isDone);
+}
+
+/*
+ * Generate the code for a program, returning a function with the signature
+ * of ExprStateEvalFunc.  econtext is only used to find the slots the code
+ * will likely be handed.
+ */
+static ExprStateEvalFunc
+llvm_build_program(LLVMJitContext *context, ExprEvalProgram *prog,
+				   ExprContext *econtext)
+{
+	LLVMModuleRef module;
+	LLVMContextRef lc;
+	LLVMBuilderRef b;
+	LLVMTypeRef eval_sig;
+	LLVMTypeRef eval_params[4];
+	LLVMTypeRef pgfunc_sig;
+	LLVMValueRef eval_fn;
+	LLVMValueRef v_econtext;
+	LLVMValueRef v_isnullp;
+	LLVMValueRef v_isdonep;
+	LLVMValueRef v_fcusage;
+	LLVMValueRef v_innerslot = NULL;
+	LLVMValueRef v_innervalues = NULL;
+	LLVMValueRef v_innernulls = NULL;
+	LLVMValueRef v_outerslot = NULL;
+	LLVMValueRef v_outervalues = NULL;
+	LLVMValueRef v_outernulls = NULL;
+	LLVMValueRef v_scanslot = NULL;
+	LLVMValueRef v_scanvalues = NULL;
+	LLVMValueRef v_scannulls = NULL;
+	LLVMBasicBlockRef b_entry;
+	LLVMBasicBlockRef b_setdone;
+	LLVMBasicBlockRef b_deform;
+	LLVMBasicBlockRef *opblocks;
+	char	   *funcname;
+	int			i;
+
+	module = llvm_create_module(context);
+	lc = LLVMGetModuleContext(module);
+	b = LLVMCreateBuilderInContext(lc);
+
+	funcname = llvm_unique_name("evalexpr");
+	eval_params[0] = TypePtr;	/* ExprState *state */
+	eval_params[1] = TypePtr;	/* ExprContext *econtext */
+	eval_params[2] = TypePtr;	/* bool *isNull */
+	eval_params[3] = TypePtr;	/* ExprDoneCond *isDone */
+	eval_sig = LLVMFunctionType(TypeDatum, eval_params, 4, false);
+	eval_fn = LLVMAddFunction(module, funcname, eval_sig);
+	v_econtext = LLVMGetParam(eval_fn, 1);
+	v_isnullp = LLVMGetParam(eval_fn, 2);
+	v_isdonep = LLVMGetParam(eval_fn, 3);
+
+	pgfunc_sig = LLVMFunctionType(TypeDatum, &TypePtr, 1, false);
+
+	b_entry = LLVMAppendBasicBlockInContext(lc, eval_fn, "entry");
+	b_setdone = LLVMAppendBasicBlockInContext(lc, eval_fn, "setdone");
+	b_deform = LLVMAppendBasicBlockInContext(lc, eval_fn, "deform");
+
+	opblocks = palloc(sizeof(LLVMBasicBlockRef) * prog->nsteps);
+	for (i = 0; i < prog->nsteps; i++)
+		opblocks[i] = LLVMAppendBasicBlockInContext(lc, eval_fn, "b.op.start");
+
+	/* guard against stack overflow, and report a single result */
+	LLVMPositionBuilderAtEnd(b, b_entry);
+	v_fcusage = LLVMBuildAlloca(b,
+								LLVMArrayType(TypeInt64,
+						  (sizeof(PgStat_FunctionCallUsage) + 7) / 8),
+								"fcusage");
+	l_call(b, (void *) check_stack_depth, TypeVoid, NULL, NULL, 0);
+	LLVMBuildCondBr(b, LLVMBuildIsNotNull(b, v_isdonep, ""),
+					b_setdone, b_deform);
+
+	LLVMPositionBuilderAtEnd(b, b_setdone);
+	LLVMBuildStore(b, l_int32_const(ExprSingleResult),
+				   LLVMBuildBitCast(b, v_isdonep,
+									LLVMPointerType(TypeInt32, 0), ""));
+	LLVMBuildBr(b, b_deform);
+
+	/* extract the attributes the Var steps reference, up front */
+	LLVMPositionBuilderAtEnd(b, b_deform);
+	if (prog->last_inner > 0)
+		build_slot_setup(context, module, b, v_econtext,
+						 econtext->ecxt_innertuple,
+						 offsetof(ExprContext, ecxt_innertuple),
+						 prog->last_inner,
+						 &v_innerslot, &v_innervalues, &v_innernulls);
+	if (prog->last_outer > 0)
+		build_slot_setup(context, module, b, v_econtext,
+						 econtext->ecxt_outertuple,
+						 offsetof(ExprContext, ecxt_outertuple),
+						 prog->last_outer,
+						 &v_outerslot, &v_outervalues, &v_outernulls);
+	if (prog->last_scan > 0)
+		build_slot_setup(context, module, b, v_econtext,
+						 econtext->ecxt_scantuple,
+						 offsetof(ExprContext, ecxt_scantuple),
+						 prog->last_scan,
+						 &v_scanslot, &v_scanvalues, &v_scannulls);
+	LLVMBuildBr(b, opblocks[0]);
+
+	for (i = 0; i < prog->nsteps; i++)
+	{
+		ExprEvalStep *op = &prog->steps[i];
+		LLVMBasicBlockRef b_next;
+		LLVMValueRef v_resvaluep;
+		LLVMValueRef v_resnullp;
+		LLVMValueRef v_opcodep;
+
+		LLVMPositionBuilderAtEnd(b, opblocks[i]);
+
+		/* DONE is the last step */
+		b_next = (i + 1 < prog->nsteps) ? opblocks[i + 1] : NULL;
+
+		v_resvaluep = l_ptr_const(op->resvalue, LLVMPointerType(TypeDatum, 0));
+		v_resnullp = l_ptr_const(op->resnull,
+								 LLVMPointerType(TypeStorageBool, 0));
+		v_opcodep = l_ptr_const(&op->opcode, LLVMPointerType(TypeInt32, 0));
+
+		switch (op->opcode)
+		{
+			case EEOP_DONE:
+				{
+					LLVMValueRef v_resvalue;
+					LLVMValueRef v_resnull;
+
+					v_resnull = LLVMBuildLoad2(b, TypeStorageBool,
+								l_ptr_const(&prog->resnull,
+										LLVMPointerType(TypeStorageBool, 0)),
+											   "");
+					v_resvalue = LLVMBuildLoad2(b, TypeDatum,
+								l_ptr_const(&prog->resvalue,
+											LLVMPointerType(TypeDatum, 0)),
+												"");
+					LLVMBuildStore(b, v_resnull, v_isnullp);
+					LLVMBuildRet(b, v_resvalue);
+					break;
+				}
+
+			case EEOP_INNER_VAR_FIRST:
+			case EEOP_INNER_VAR:
+			case EEOP_OUTER_VAR_FIRST:
+			case EEOP_OUTER_VAR:
+			case EEOP_SCAN_VAR_FIRST:
+			case EEOP_SCAN_VAR:
+				{
+					LLVMValueRef v_slot;
+					LLVMValueRef v_values;
+					LLVMValueRef v_nulls;
+					LLVMValueRef v_attnum;
+					ExprEvalOp	varop;
+
+					if (op->opcode == EEOP_INNER_VAR_FIRST ||
+						op->opcode == EEOP_INNER_VAR)
+					{
+						v_slot = v_innerslot;
+						v_values = v_innervalues;
+						v_nulls = v_innernulls;
+						varop = EEOP_INNER_VAR;
+					}
+					else if (op->opcode == EEOP_OUTER_VAR_FIRST ||
+							 op->opcode == EEOP_OUTER_VAR)
+					{
+						v_slot = v_outerslot;
+						v_values = v_outervalues;
+						v_nulls = v_outernulls;
+						varop = EEOP_OUTER_VAR;
+					}
+					else
+					{
+						v_slot = v_scanslot;
+						v_values = v_scanvalues;
+						v_nulls = v_scannulls;
+						varop = EEOP_SCAN_VAR;
+					}
+
+					/* check the type once, like the interpreter */
+					if (op->opcode != varop)
+					{
+						LLVMBasicBlockRef b_check;
+						LLVMBasicBlockRef b_fetch;
+						LLVMTypeRef params[3];
+						LLVMValueRef args[3];
+
+						b_check = LLVMInsertBasicBlockInContext(lc, b_next,
+																"op.check");
+						b_fetch = LLVMInsertBasicBlockInContext(lc, b_next,
+																"op.fetch");
+						LLVMBuildCondBr(b,
+										LLVMBuildICmp(b, LLVMIntEQ,
+											   LLVMBuildLoad2(b, TypeInt32,
+														 v_opcodep, ""),
+												l_int32_const(op->opcode), ""),
+										b_check, b_fetch);
+
+						LLVMPositionBuilderAtEnd(b, b_check);
+						params[0] = TypePtr;
+						params[1] = TypeInt32;
+						params[2] = TypeInt32;
+						args[0] = v_slot;
+						args[1] = l_int32_const(op->d.var.attnum + 1);
+						args[2] = l_int32_const(op->d.var.vartype);
+						l_call(b, (void *) llvmjit_check_var, TypeVoid,
+							   params, args, 3);
+						LLVMBuildStore(b, l_int32_const(varop), v_opcodep);
+						LLVMBuildBr(b, b_fetch);
+
+						LLVMPositionBuilderAtEnd(b, b_fetch);
+					}
+
+					v_attnum = l_int32_const(op->d.var.attnum);
+					LLVMBuildStore(b,
+								   LLVMBuildLoad2(b, TypeDatum,
+											  LLVMBuildGEP2(b, TypeDatum,
+															v_values,
+															&v_attnum, 1, ""),
+												  ""),
+								   v_resvaluep);
+					LLVMBuildStore(b,
+								   LLVMBuildLoad2(b, TypeStorageBool,
+										  LLVMBuildGEP2(b, TypeStorageBool,
+														v_nulls,
+														&v_attnum, 1, ""),
+												  ""),
+								   v_resnullp);
+					LLVMBuildBr(b, b_next);
+					break;
+				}
+
+			case EEOP_CONST:
+				LLVMBuildStore(b,
+							   LLVMConstInt(TypeDatum,
+											op->d.constval.value, false),
+							   v_resvaluep);
+				LLVMBuildStore(b,
+							   LLVMConstInt(TypeStorageBool,
+											op->d.constval.isnull, false),
+							   v_resnullp);
+				LLVMBuildBr(b, b_next);
+				break;
+
+			case EEOP_CASE_TESTVAL:
+				LLVMBuildStore(b,
+							   l_load_field(b, v_econtext,
+									 offsetof(ExprContext, caseValue_datum),
+											TypeDatum, ""),
+							   v_resvaluep);
+				LLVMBuildStore(b,
+							   l_load_field(b, v_econtext,
+									offsetof(ExprContext, caseValue_isNull),
+											TypeStorageBool, ""),
+							   v_resnullp);
+				LLVMBuildBr(b, b_next);
+				break;
+
+			case EEOP_FUNCEXPR_INIT:
+			case EEOP_FUNCEXPR:
+			case EEOP_FUNCEXPR_STRICT:
+				{
+					FuncExprState *fcache = op->d.func.fcache;
+					FunctionCallInfo fcinfo = &fcache->fcinfo_data;
+					LLVMValueRef v_fcinfo = l_ptr_const(fcinfo, TypePtr);
+					LLVMValueRef v_flinfo = l_ptr_const(&fcache->func, TypePtr);
+					Expr	   *expr = fcache->xprstate.expr;
+					Oid			funcid;
+					LLVMBasicBlockRef b_strict;
+					LLVMBasicBlockRef b_call;
+					LLVMBasicBlockRef b_statsinit;
+					LLVMBasicBlockRef b_invoke;
+					LLVMBasicBlockRef b_statsend;
+					LLVMValueRef v_wantstats;
+					LLVMValueRef v_fn;
+					LLVMValueRef v_result;
+					int			argno;
+
+					funcid = IsA(expr, FuncExpr) ?
+						((FuncExpr *) expr)->funcid :
+						((OpExpr *) expr)->opfuncid;
+
+					b_strict = LLVMInsertBasicBlockInContext(lc, b_next,
+															 "op.strict");
+					b_call = LLVMInsertBasicBlockInContext(lc, b_next,
+														   "op.call");
+					b_statsinit = LLVMInsertBasicBlockInContext(lc, b_next,
+														   "op.statsinit");
+					b_invoke = LLVMInsertBasicBlockInContext(lc, b_next,
+															 "op.invoke");
+					b_statsend = LLVMInsertBasicBlockInContext(lc, b_next,
+															"op.statsend");
+
+					if (op->opcode == EEOP_FUNCEXPR_INIT)
+					{
+						LLVMBasicBlockRef b_init;
+						LLVMBasicBlockRef b_dispatch;
+						LLVMTypeRef params[2];
+						LLVMValueRef args[2];
+
+						/* look up the function on first use */
+						b_init = LLVMInsertBasicBlockInContext(lc, b_strict,
+															   "op.init");
+						b_dispatch = LLVMInsertBasicBlockInContext(lc, b_strict,
+															 "op.dispatch");
+						LLVMBuildCondBr(b,
+										LLVMBuildICmp(b, LLVMIntEQ,
+											   LLVMBuildLoad2(b, TypeInt32,
+														 v_opcodep, ""),
+										   l_int32_const(EEOP_FUNCEXPR_INIT),
+													  ""),
+										b_init, b_dispatch);
+
+						LLVMPositionBuilderAtEnd(b, b_init);
+						params[0] = TypePtr;
+						params[1] = TypePtr;
+						args[0] = l_ptr_const(op, TypePtr);
+						args[1] = v_econtext;
+						l_call(b, (void *) ExecEvalFuncExprInit, TypeVoid,
+							   params, args, 2);
+						LLVMBuildBr(b, b_dispatch);
+
+						/* the step now says whether the function is strict */
+						LLVMPositionBuilderAtEnd(b, b_dispatch);
+						LLVMBuildCondBr(b,
+										LLVMBuildICmp(b, LLVMIntEQ,
+											   LLVMBuildLoad2(b, TypeInt32,
+														 v_opcodep, ""),
+										 l_int32_const(EEOP_FUNCEXPR_STRICT),
+													  ""),
+										b_strict, b_call);
+					}
+					else if (op->opcode == EEOP_FUNCEXPR_STRICT)
+						LLVMBuildBr(b, b_strict);
+					else
+						LLVMBuildBr(b, b_call);
+
+					/*
+					 * If the function is strict and there are any NULL
+					 * arguments, skip calling it and return NULL.
+					 */
+					LLVMPositionBuilderAtEnd(b, b_strict);
+					if (op->d.func.nargs > 0)
+					{
+						LLVMBasicBlockRef b_retnull;
+
+						b_retnull = LLVMInsertBasicBlockInContext(lc, b_call,
+															  "op.retnull");
+						for (argno = 0; argno < op->d.func.nargs; argno++)
+						{
+							LLVMBasicBlockRef b_argok;
+							LLVMValueRef v_argnull;
+
+							b_argok = (argno + 1 < op->d.func.nargs) ?
+								LLVMInsertBasicBlockInContext(lc, b_retnull,
+															  "op.argok") :
+								b_call;
+							v_argnull = LLVMBuildLoad2(b, TypeStorageBool,
+											 l_ptr_const(&fcinfo->argnull[argno],
+									 LLVMPointerType(TypeStorageBool, 0)),
+													   "");
+							LLVMBuildCondBr(b,
+											LLVMBuildICmp(b, LLVMIntNE,
+														  v_argnull,
+								 LLVMConstInt(TypeStorageBool, 0, false),
+														  ""),
+											b_retnull, b_argok);
+							LLVMPositionBuilderAtEnd(b, b_argok);
+						}
+
+						LLVMPositionBuilderAtEnd(b, b_retnull);
+						LLVMBuildStore(b, LLVMConstInt(TypeDatum, 0, false),
+									   v_resvaluep);
+						LLVMBuildStore(b,
+									 LLVMConstInt(TypeStorageBool, 1, false),
+									   v_resnullp);
+						LLVMBuildBr(b, b_next);
+					}
+					else
+						LLVMBuildBr(b, b_call);
+
+					/*
+					 * Compute the result of simple built-in functions right
+					 * here.  Those are all strict and never tracked by pgstat.
+					 */
+					if ((context->base.flags & PGJIT_INLINE) &&
+						op->d.func.nargs == 2 && llvm_can_inline(funcid))
+					{
+						LLVMTypeRef t_datump = LLVMPointerType(TypeDatum, 0);
+						LLVMValueRef v_args[2];
+
+						LLVMPositionBuilderAtEnd(b, b_call);
+						for (argno = 0; argno < 2; argno++)
+						{
+							LLVMValueRef v_argp;
+
+							v_argp = l_ptr_const(&fcinfo->arg[argno], t_datump);
+							v_args[argno] = LLVMBuildLoad2(b, TypeDatum, v_argp, "");
+						}
+						LLVMBuildStore(b, llvm_inline_builtin(b, funcid, v_args),
+									   v_resvaluep);
+						LLVMBuildStore(b, LLVMConstInt(TypeStorageBool, 0, false),
+									   v_resnullp);
+						LLVMBuildBr(b, b_next);
+
+						LLVMDeleteBasicBlock(b_statsinit);
+						LLVMDeleteBasicBlock(b_invoke);
+						LLVMDeleteBasicBlock(b_statsend);
+						break;
+					}
+
+					/*
+					 * Only bother with pgstat_init_function_usage if it's
+					 * going to track the call.
+					 */
+					LLVMPositionBuilderAtEnd(b, b_call);
+					v_wantstats =
+						LLVMBuildICmp(b, LLVMIntSGT,
+									  LLVMBuildLoad2(b, TypeInt32,
+										  l_ptr_const(&pgstat_track_functions,
+										  LLVMPointerType(TypeInt32, 0)), ""),
+									  LLVMBuildZExt(b,
+											  l_load_field(b, v_flinfo,
+											  offsetof(FmgrInfo, fn_stats),
+														 TypeInt8, ""),
+													TypeInt32, ""),
+									  "wantstats");
+					LLVMBuildCondBr(b, v_wantstats, b_statsinit, b_invoke);
+
+					LLVMPositionBuilderAtEnd(b, b_statsinit);
+					{
+						LLVMTypeRef params[2];
+						LLVMValueRef args[2];
+
+						params[0] = TypePtr;
+						params[1] = TypePtr;
+						args[0] = v_fcinfo;
+						args[1] = LLVMBuildBitCast(b, v_fcusage, TypePtr, "");
+						l_call(b, (void *) pgstat_init_function_usage,
+							   TypeVoid, params, args, 2);
+						LLVMBuildBr(b, b_invoke);
+					}
+
+					LLVMPositionBuilderAtEnd(b, b_invoke);
+					l_store_field(b, LLVMConstInt(TypeStorageBool, 0, false),
+								  v_fcinfo,
+								  offsetof(FunctionCallInfoData, isnull));
+					v_fn = l_load_field(b, v_flinfo,
+										offsetof(FmgrInfo, fn_addr),
+										LLVMPointerType(pgfunc_sig, 0),
+										"fn_addr");
+					v_result = LLVMBuildCall2(b, pgfunc_sig, v_fn,
+											  &v_fcinfo, 1, "funcresult");
+					LLVMBuildStore(b, v_result, v_resvaluep);
+					LLVMBuildStore(b,
+								   l_load_field(b, v_fcinfo,
+									   offsetof(FunctionCallInfoData, isnull),
+												TypeStorageBool, ""),
+								   v_resnullp);
+					LLVMBuildCondBr(b, v_wantstats, b_statsend, b_next);
+
+					LLVMPositionBuilderAtEnd(b, b_statsend);
+					{
+						LLVMValueRef v_arg;
+
+						v_arg = LLVMBuildBitCast(b, v_fcusage, TypePtr, "");
+						l_call(b, (void *) llvmjit_end_function_usage,
+							   TypeVoid, &TypePtr, &v_arg, 1);
+						LLVMBuildBr(b, b_next);
+					}
+					break;
+				}
+
+				/*
+				 * The arguments of an AND are all evaluated into its result,
+				 * each one followed by a step that checks it.  If we find a
+				 * FALSE result, we can stop and return FALSE.  If some
+				 * arguments yield NULL but none yield FALSE, the result is
+				 * NULL.  Likewise for OR, with the roles of TRUE and FALSE
+				 * reversed.
+				 */
+			case EEOP_BOOL_AND_STEP_FIRST:
+			case EEOP_BOOL_AND_STEP:
+			case EEOP_BOOL_OR_STEP_FIRST:
+			case EEOP_BOOL_OR_STEP:
+				{
+					LLVMValueRef v_anynullp;
+					LLVMBasicBlockRef b_setanynull;
+					LLVMBasicBlockRef b_checkvalue;
+					LLVMValueRef v_value;
+					bool		is_and;
+
+					is_and = (op->opcode == EEOP_BOOL_AND_STEP_FIRST ||
+							  op->opcode == EEOP_BOOL_AND_STEP);
+					v_anynullp = l_ptr_const(op->d.boolexpr.anynull,
+									   LLVMPointerType(TypeStorageBool, 0));
+
+					if (op->opcode == EEOP_BOOL_AND_STEP_FIRST ||
+						op->opcode == EEOP_BOOL_OR_STEP_FIRST)
+						LLVMBuildStore(b,
+									 LLVMConstInt(TypeStorageBool, 0, false),
+									   v_anynullp);
+
+					b_setanynull = LLVMInsertBasicBlockInContext(lc, b_next,
+															"op.setanynull");
+					b_checkvalue = LLVMInsertBasicBlockInContext(lc, b_next,
+															"op.checkvalue");
+					LLVMBuildCondBr(b,
+									LLVMBuildICmp(b, LLVMIntNE,
+									LLVMBuildLoad2(b, TypeStorageBool,
+												   v_resnullp, ""),
+								 LLVMConstInt(TypeStorageBool, 0, false), ""),
+									b_setanynull, b_checkvalue);
+
+					LLVMPositionBuilderAtEnd(b, b_setanynull);
+					LLVMBuildStore(b, LLVMConstInt(TypeStorageBool, 1, false),
+								   v_anynullp);
+					LLVMBuildBr(b, b_next);
+
+					/* short-circuit on FALSE for AND, on TRUE for OR */
+					LLVMPositionBuilderAtEnd(b, b_checkvalue);
+					v_value = l_datum_getbool(b,
+								  LLVMBuildLoad2(b, TypeDatum, v_resvaluep,
+												 ""));
+					if (is_and)
+						LLVMBuildCondBr(b, v_value, b_next,
+										opblocks[op->d.boolexpr.jumpdone]);
+					else
+						LLVMBuildCondBr(b, v_value,
+										opblocks[op->d.boolexpr.jumpdone],
+										b_next);
+					break;
+				}
+
+			case EEOP_BOOL_AND_STEP_LAST:
+			case EEOP_BOOL_OR_STEP_LAST:
+				{
+					LLVMBasicBlockRef b_checkvalue;
+					LLVMBasicBlockRef b_checkanynull;
+					LLVMBasicBlockRef b_setnull;
+					LLVMValueRef v_value;
+
+					b_checkvalue = LLVMInsertBasicBlockInContext(lc, b_next,
+															"op.checkvalue");
+					b_checkanynull = LLVMInsertBasicBlockInContext(lc, b_next,
+														  "op.checkanynull");
+					b_setnull = LLVMInsertBasicBlockInContext(lc, b_next,
+															  "op.setnull");
+
+					/* a NULL result stays */
+					LLVMBuildCondBr(b,
+									LLVMBuildICmp(b, LLVMIntNE,
+									LLVMBuildLoad2(b, TypeStorageBool,
+												   v_resnullp, ""),
+								 LLVMConstInt(TypeStorageBool, 0, false), ""),
+									b_next, b_checkvalue);
+
+					/* so does FALSE for AND, TRUE for OR */
+					LLVMPositionBuilderAtEnd(b, b_checkvalue);
+					v_value = l_datum_getbool(b,
+								  LLVMBuildLoad2(b, TypeDatum, v_resvaluep,
+												 ""));
+					if (op->opcode == EEOP_BOOL_AND_STEP_LAST)
+						LLVMBuildCondBr(b, v_value, b_checkanynull, b_next);
+					else
+						LLVMBuildCondBr(b, v_value, b_next, b_checkanynull);
+
+					/* otherwise the result is NULL if any argument was */
+					LLVMPositionBuilderAtEnd(b, b_checkanynull);
+					LLVMBuildCondBr(b,
+									LLVMBuildICmp(b, LLVMIntNE,
+									LLVMBuildLoad2(b, TypeStorageBool,
+							   l_ptr_const(op->d.boolexpr.anynull,
+									   LLVMPointerType(TypeStorageBool, 0)),
+												   ""),
+								 LLVMConstInt(TypeStorageBool, 0, false), ""),
+									b_setnull, b_next);
+
+					LLVMPositionBuilderAtEnd(b, b_setnull);
+					LLVMBuildStore(b, LLVMConstInt(TypeDatum, 0, false),
+								   v_resvaluep);
+					LLVMBuildStore(b, LLVMConstInt(TypeStorageBool, 1, false),
+								   v_resnullp);
+					LLVMBuildBr(b, b_next);
+					break;
+				}
+
+			case EEOP_BOOL_NOT:
+				{
+					LLVMBasicBlockRef b_negate;
+					LLVMValueRef v_value;
+
+					/* NOT NULL is NULL, and the argument's result is in place */
+					b_negate = LLVMInsertBasicBlockInContext(lc, b_next,
+															 "op.negate");
+					LLVMBuildCondBr(b,
+									LLVMBuildICmp(b, LLVMIntNE,
+									LLVMBuildLoad2(b, TypeStorageBool,
+												   v_resnullp, ""),
+								 LLVMConstInt(TypeStorageBool, 0, false), ""),
+									b_next, b_negate);
+
+					LLVMPositionBuilderAtEnd(b, b_negate);
+					v_value = l_datum_getbool(b,
+								  LLVMBuildLoad2(b, TypeDatum, v_resvaluep,
+												 ""));
+					v_value = LLVMBuildNot(b, v_value, "");
+					LLVMBuildStore(b, LLVMBuildZExt(b, v_value, TypeDatum, ""),
+								   v_resvaluep);
+					LLVMBuildBr(b, b_next);
+					break;
+				}
+
+			case EEOP_NULLTEST_ISNULL:
+			case EEOP_NULLTEST_ISNOTNULL:
+				{
+					LLVMValueRef v_isnull;
+
+					v_isnull = LLVMBuildICmp(b,
+								 op->opcode == EEOP_NULLTEST_ISNULL ?
+											 LLVMIntNE : LLVMIntEQ,
+											 LLVMBuildLoad2(b, TypeStorageBool,
+														 v_resnullp, ""),
+								 LLVMConstInt(TypeStorageBool, 0, false), "");
+					LLVMBuildStore(b, LLVMBuildZExt(b, v_isnull, TypeDatum, ""),
+								   v_resvaluep);
+					LLVMBuildStore(b, LLVMConstInt(TypeStorageBool, 0, false),
+								   v_resnullp);
+					LLVMBuildBr(b, b_next);
+					break;
+				}
+
+			case EEOP_JUMP:
+				LLVMBuildBr(b, opblocks[op->d.jump.jumpdone]);
+				break;
+
+			case EEOP_JUMP_IF_NOT_TRUE:
+				{
+					LLVMBasicBlockRef b_checkvalue;
+
+					/* a NULL result is not considered true */
+					b_checkvalue = LLVMInsertBasicBlockInContext(lc, b_next,
+															"op.checkvalue");
+					LLVMBuildCondBr(b,
+									LLVMBuildICmp(b, LLVMIntNE,
+									LLVMBuildLoad2(b, TypeStorageBool,
+												   v_resnullp, ""),
+								 LLVMConstInt(TypeStorageBool, 0, false), ""),
+									opblocks[op->d.jump.jumpdone],
+									b_checkvalue);
+
+					LLVMPositionBuilderAtEnd(b, b_checkvalue);
+					LLVMBuildCondBr(b,
+									l_datum_getbool(b,
+								  LLVMBuildLoad2(b, TypeDatum, v_resvaluep,
+												 "")),
+									b_next,
+									opblocks[op->d.jump.jumpdone]);
+					break;
+				}
+
+			case EEOP_JUMP_IF_NOT_NULL:
+				LLVMBuildCondBr(b,
+								LLVMBuildICmp(b, LLVMIntEQ,
+									LLVMBuildLoad2(b, TypeStorageBool,
+												   v_resnullp, ""),
+								 LLVMConstInt(TypeStorageBool, 0, false), ""),
+								opblocks[op->d.jump.jumpdone],
+								b_next);
+				break;
+
+			case EEOP_CASE_SETVAL:
+				LLVMBuildStore(b,
+							   l_load_field(b, v_econtext,
+									 offsetof(ExprContext, caseValue_datum),
+											TypeDatum, ""),
+							   l_ptr_const(op->d.casesave.save_value,
+										   LLVMPointerType(TypeDatum, 0)));
+				LLVMBuildStore(b,
+							   l_load_field(b, v_econtext,
+									offsetof(ExprContext, caseValue_isNull),
+											TypeStorageBool, ""),
+							   l_ptr_const(op->d.casesave.save_isnull,
+									   LLVMPointerType(TypeStorageBool, 0)));
+				l_store_field(b,
+							  LLVMBuildLoad2(b, TypeDatum, v_resvaluep, ""),
+							  v_econtext,
+							  offsetof(ExprContext, caseValue_datum));
+				l_store_field(b,
+							  LLVMBuildLoad2(b, TypeStorageBool, v_resnullp, ""),
+							  v_econtext,
+							  offsetof(ExprContext, caseValue_isNull));
+				LLVMBuildBr(b, b_next);
+				break;
+
+			case EEOP_CASE_RESTORE:
+				l_store_field(b,
+							  LLVMBuildLoad2(b, TypeDatum,
+								  l_ptr_const(op->d.casesave.save_value,
+										   LLVMPointerType(TypeDatum, 0)), ""),
+							  v_econtext,
+							  offsetof(ExprContext, caseValue_datum));
+				l_store_field(b,
+							  LLVMBuildLoad2(b, TypeStorageBool,
+								  l_ptr_const(op->d.casesave.save_isnull,
+								   LLVMPointerType(TypeStorageBool, 0)), ""),
+							  v_econtext,
+							  offsetof(ExprContext, caseValue_isNull));
+				LLVMBuildBr(b, b_next);
+				break;
+
+				/*
+				 * For a strict transition function, nothing happens when
+				 * there's a NULL input.  The first non-NULL input of a group
+				 * without an initial value becomes its transValue, and a NULL
+				 * transValue returned on a prior cycle stays to the end.
+				 */
+			case EEOP_AGG_STRICT_TRANS:
+			case EEOP_AGG_TRANS:
+				{
+					FunctionCallInfo fcinfo = op->d.aggtrans.fcinfo;
+					LLVMValueRef v_fcinfo = l_ptr_const(fcinfo, TypePtr);
+					LLVMValueRef v_op = l_ptr_const(op, TypePtr);
+					LLVMValueRef v_pergroup;
+					LLVMValueRef v_fn;
+					LLVMValueRef v_result;
+					LLVMBasicBlockRef b_call;
+					LLVMTypeRef params[3];
+					LLVMValueRef args[3];
+
+					b_call = LLVMInsertBasicBlockInContext(lc, b_next,
+														   "op.call");
+
+					/* &aggstate->curpergroup[aggno] */
+					v_pergroup = l_load_field(b,
+								l_ptr_const(op->d.aggtrans.aggstate, TypePtr),
+											  offsetof(AggState, curpergroup),
+											  TypePtr, "curpergroup");
+					v_pergroup = l_field_ptr(b, v_pergroup,
+											 op->d.aggtrans.aggno *
+											 sizeof(AggStatePerGroupData),
+											 TypeInt8);
+
+					if (op->opcode == EEOP_AGG_STRICT_TRANS)
+					{
+						LLVMBasicBlockRef b_init;
+						LLVMBasicBlockRef b_checknull;
+						int			argno;
+
+						b_init = LLVMInsertBasicBlockInContext(lc, b_call,
+															   "op.init");
+						b_checknull = LLVMInsertBasicBlockInContext(lc, b_call,
+															"op.checknull");
+
+						for (argno = 1; argno <= op->d.aggtrans.nargs; argno++)
+						{
+							LLVMBasicBlockRef b_argok;
+							LLVMValueRef v_argnull;
+
+							b_argok = LLVMInsertBasicBlockInContext(lc, b_init,
+																"op.argok");
+							v_argnull = LLVMBuildLoad2(b, TypeStorageBool,
+											 l_ptr_const(&fcinfo->argnull[argno],
+									 LLVMPointerType(TypeStorageBool, 0)),
+													   "");
+							LLVMBuildCondBr(b,
+											LLVMBuildICmp(b, LLVMIntNE,
+														  v_argnull,
+								 LLVMConstInt(TypeStorageBool, 0, false),
+														  ""),
+											b_next, b_argok);
+							LLVMPositionBuilderAtEnd(b, b_argok);
+						}
+
+						LLVMBuildCondBr(b,
+										LLVMBuildICmp(b, LLVMIntNE,
+											  l_load_field(b, v_pergroup,
+									offsetof(AggStatePerGroupData, noTransValue),
+														TypeStorageBool, ""),
+								 LLVMConstInt(TypeStorageBool, 0, false), ""),
+										b_init, b_checknull);
+
+						LLVMPositionBuilderAtEnd(b, b_init);
+						params[0] = TypePtr;
+						params[1] = TypePtr;
+						args[0] = v_op;
+						args[1] = v_pergroup;
+						l_call(b, (void *) ExecAggInitGroup, TypeVoid,
+							   params, args, 2);
+						LLVMBuildBr(b, b_next);
+
+						LLVMPositionBuilderAtEnd(b, b_checknull);
+						LLVMBuildCondBr(b,
+										LLVMBuildICmp(b, LLVMIntNE,
+											  l_load_field(b, v_pergroup,
+							   offsetof(AggStatePerGroupData, transValueIsNull),
+														TypeStorageBool, ""),
+								 LLVMConstInt(TypeStorageBool, 0, false), ""),
+										b_next, b_call);
+					}
+					else
+						LLVMBuildBr(b, b_call);
+
+					/* the function was looked up by ExecInitAgg, call it */
+					LLVMPositionBuilderAtEnd(b, b_call);
+					LLVMBuildStore(b,
+								   l_load_field(b, v_pergroup,
+									 offsetof(AggStatePerGroupData, transValue),
+												TypeDatum, ""),
+								   l_ptr_const(&fcinfo->arg[0],
+											   LLVMPointerType(TypeDatum, 0)));
+					LLVMBuildStore(b,
+								   l_load_field(b, v_pergroup,
+							   offsetof(AggStatePerGroupData, transValueIsNull),
+												TypeStorageBool, ""),
+								   l_ptr_const(&fcinfo->argnull[0],
+									   LLVMPointerType(TypeStorageBool, 0)));
+					l_store_field(b, LLVMConstInt(TypeStorageBool, 0, false),
+								  v_fcinfo,
+								  offsetof(FunctionCallInfoData, isnull));
+					v_fn = l_ptr_const((void *) fcinfo->flinfo->fn_addr,
+									   LLVMPointerType(pgfunc_sig, 0));
+					v_result = LLVMBuildCall2(b, pgfunc_sig, v_fn,
+											  &v_fcinfo, 1, "transresult");
+
+					if (!op->d.aggtrans.transtypeByVal)
+					{
+						params[0] = TypePtr;
+						params[1] = TypePtr;
+						params[2] = TypeDatum;
+						args[0] = v_op;
+						args[1] = v_pergroup;
+						args[2] = v_result;
+						v_result = l_call(b, (void *) ExecAggTransReparent,
+										  TypeDatum, params, args, 3);
+					}
+
+					l_store_field(b, v_result, v_pergroup,
+								  offsetof(AggStatePerGroupData, transValue));
+					l_store_field(b,
+								  l_load_field(b, v_fcinfo,
+									   offsetof(FunctionCallInfoData, isnull),
+											   TypeStorageBool, ""),
+								  v_pergroup,
+							   offsetof(AggStatePerGroupData, transValueIsNull));
+					LLVMBuildBr(b, b_next);
+					break;
+				}
+
+			case EEOP_GENERIC:
+				{
+					LLVMValueRef v_state;
+					LLVMValueRef v_evalfunc;
+					LLVMValueRef args[4];
+
+					/* hand the subexpression to ExecEvalExpr */
+					v_state = l_ptr_const(op->d.generic.state, TypePtr);
+					v_evalfunc = l_load_field(b, v_state,
+											  offsetof(ExprState, evalfunc),
+											  LLVMPointerType(eval_sig, 0),
+											  "evalfunc");
+					args[0] = v_state;
+					args[1] = v_econtext;
+					args[2] = l_ptr_const(op->resnull, TypePtr);
+					args[3] = LLVMConstNull(TypePtr);
+					LLVMBuildStore(b,
+								   LLVMBuildCall2(b, eval_sig, v_evalfunc,
+												  args, 4, ""),
+								   v_resvaluep);
+					LLVMBuildBr(b, b_next);
+					break;
+				}
+
+			case EEOP_LAST:
+				elog(ERROR, "unrecognized expression step: %d",
+					 (int) op->opcode);
+				break;
+		}
+	}
+
+	LLVMDisposeBuilder(b);
+	pfree(opblocks);
+
+	return (ExprStateEvalFunc) llvm_emit_module(context, module, funcname);
+}
+
+/*
+ * Emit code extracting the first natts attributes of the slot that
+ * econtext points to at slotoffset, and return the slot and its value and
+ * null arrays.  If we know what the slot looks like, the attributes are
+ * extracted by code specialized for its descriptor.
+ */
+static void
+build_slot_setup(LLVMJitContext *context, LLVMModuleRef module,
+				 LLVMBuilderRef b, LLVMValueRef v_econtext,
+				 TupleTableSlot *slot, size_t slotoffset, int natts,
+				 LLVMValueRef *v_slot, LLVMValueRef *v_values,
+				 LLVMValueRef *v_nulls)
+{
+	*v_slot = l_load_field(b, v_econtext, slotoffset, TypePtr, "slot");
+
+	if ((context->base.flags & PGJIT_DEFORM) &&
+		slot != NULL && slot->tts_tupleDescriptor != NULL &&
+		natts <= slot->tts_tupleDescriptor->natts)
+	{
+		LLVMValueRef v_deform;
+
+		v_deform = slot_compile_deform(module, slot->tts_tupleDescriptor,
+									   natts);
+		LLVMBuildCall2(b, LLVMGlobalGetValueType(v_deform), v_deform,
+					   v_slot, 1, "");
+	}
+	else
+	{
+		LLVMTypeRef params[2];
+		LLVMValueRef args[2];
+
+		params[0] = TypePtr;
+		params[1] = TypeInt32;
+		args[0] = *v_slot;
+		args[1] = l_int32_const(natts);
+		l_call(b, (void *) slot_getsomeattrs, TypeVoid, params, args, 2);
+	}
+
+	*v_values = l_load_field(b, *v_slot, offsetof(TupleTableSlot, tts_values),
+							 LLVMPointerType(TypeDatum, 0), "values");
+	*v_nulls = l_load_field(b, *v_slot, offsetof(TupleTableSlot, tts_isnull),
+							LLVMPointerType(TypeStorageBool, 0), "nulls");
+}
+
+/* DatumGetBool, as an i1 */
+static LLVMValueRef
+l_datum_getbool(LLVMBuilderRef b, LLVMValueRef v)
+{
+	return LLVMBuildICmp(b, LLVMIntNE,
+						 LLVMBuildTrunc(b, v, TypeStorageBool, ""),
+						 LLVMConstInt(TypeStorageBool, 0, false), "");
+}
+
+/*
+ * Wrappers for functions taking arguments narrower than int, see l_call.
+ */
+static void
+llvmjit_check_var(TupleTableSlot *slot, int attnum, Oid vartype)
+{
+	CheckVarSlotCompatibility(slot, attnum, vartype);
+}
+
+static void
+llvmjit_end_function_usage(PgStat_FunctionCallUsage *fcu)
+{
+	pgstat_end_function_usage(fcu, true);
+}
@@ -0,0 +1,375 @@
+/*-------------------------------------------------------------------------
+ *
+ * llvmjit_inline.c
+ *	  Inline calls to simple built-in functions into generated code.
+ *
+ * Calling a built-in function through fmgr costs far more than the work
+ * many of them do: the integer, oid, bool and char comparisons and the
+ * integer arithmetic that make up most quals.  For those, the generated
+ * code computes the result itself, from the arguments in the FunctionCall
+ * InfoData.  The functions handled here are all strict, take two arguments
+ * and are never tracked by pgstat (see fmgr_info), so the caller only has
+ * to check for NULL arguments as for any strict function.  Overflow is
+ * reported with the same error as the C function would.
+ *
+ * int8 functions are only inlined where int8 is pass-by-value.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/jit/llvm/llvmjit_inline.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "jit/llvmjit.h"
+#include "utils/fmgroids.h"
+
+
+typedef enum InlineOp
+{
+	INLINE_EQ,
+	INLINE_NE,
+	INLINE_LT,
+	INLINE_LE,
+	INLINE_GT,
+	INLINE_GE,
+	INLINE_PL,
+	INLINE_MI,
+	INLINE_MUL
+} InlineOp;
+
+/*
+ * Argument types: 'b' bool, 'c' char, 'o' oid, 's' int2, 'i' int4, 'l'
+ * int8.  Mixed-width integer functions compute in the wider type.
+ */
+typedef struct InlineBuiltin
+{
+	Oid			funcid;
+	InlineOp	op;
+	char		arg1type;
+	char		arg2type;
+} InlineBuiltin;
+
+static const InlineBuiltin inline_builtins[] = {
+	{F_BOOLEQ, INLINE_EQ, 'b', 'b'},
+	{F_BOOLNE, INLINE_NE, 'b', 'b'},
+	{F_CHAREQ, INLINE_EQ, 'c', 'c'},
+	{F_CHARNE, INLINE_NE, 'c', 'c'},
+	{F_OIDEQ, INLINE_EQ, 'o', 'o'},
+	{F_OIDNE, INLINE_NE, 'o', 'o'},
+	{F_OIDLT, INLINE_LT, 'o', 'o'},
+	{F_OIDLE, INLINE_LE, 'o', 'o'},
+	{F_OIDGT, INLINE_GT, 'o', 'o'},
+	{F_OIDGE, INLINE_GE, 'o', 'o'},
+	{F_INT2EQ, INLINE_EQ, 's', 's'},
+	{F_INT2NE, INLINE_NE, 's', 's'},
+	{F_INT2LT, INLINE_LT, 's', 's'},
+	{F_INT2LE, INLINE_LE, 's', 's'},
+	{F_INT2GT, INLINE_GT, 's', 's'},
+	{F_INT2GE, INLINE_GE, 's', 's'},
+	{F_INT2PL, INLINE_PL, 's', 's'},
+	{F_INT2MI, INLINE_MI, 's', 's'},
+	{F_INT2MUL, INLINE_MUL, 's', 's'},
+	{F_INT4EQ, INLINE_EQ, 'i', 'i'},
+	{F_INT4NE, INLINE_NE, 'i', 'i'},
+	{F_INT4LT, INLINE_LT, 'i', 'i'},
+	{F_INT4LE, INLINE_LE, 'i', 'i'},
+	{F_INT4GT, INLINE_GT, 'i', 'i'},
+	{F_INT4GE, INLINE_GE, 'i', 'i'},
+	{F_INT4PL, INLINE_PL, 'i', 'i'},
+	{F_INT4MI, INLINE_MI, 'i', 'i'},
+	{F_INT4MUL, INLINE_MUL, 'i', 'i'},
+	{F_INT24EQ, INLINE_EQ, 's', 'i'},
+	{F_INT24NE, INLINE_NE, 's', 'i'},
+	{F_INT24LT, INLINE_LT, 's', 'i'},
+	{F_INT24LE, INLINE_LE, 's', 'i'},
+	{F_INT24GT, INLINE_GT, 's', 'i'},
+	{F_INT24GE, INLINE_GE, 's', 'i'},
+	{F_INT24PL, INLINE_PL, 's', 'i'},
+	{F_INT24MI, INLINE_MI, 's', 'i'},
+	{F_INT24MUL, INLINE_MUL, 's', 'i'},
+	{F_INT42EQ, INLINE_EQ, 'i', 's'},
+	{F_INT42NE, INLINE_NE, 'i', 's'},
+	{F_INT42LT, INLINE_LT, 'i', 's'},
+	{F_INT42LE, INLINE_LE, 'i', 's'},
+	{F_INT42GT, INLINE_GT, 'i', 's'},
+	{F_INT42GE, INLINE_GE, 'i', 's'},
+	{F_INT42PL, INLINE_PL, 'i', 's'},
+	{F_INT42MI, INLINE_MI, 'i', 's'},
+	{F_INT42MUL, INLINE_MUL, 'i', 's'},
+#ifdef USE_FLOAT8_BYVAL
+	{F_INT8EQ, INLINE_EQ, 'l', 'l'},
+	{F_INT8NE, INLINE_NE, 'l', 'l'},
+	{F_INT8LT, INLINE_LT, 'l', 'l'},
+	{F_INT8LE, INLINE_LE, 'l', 'l'},
+	{F_INT8GT, INLINE_GT, 'l', 'l'},
+	{F_INT8GE, INLINE_GE, 'l', 'l'},
+	{F_INT8PL, INLINE_PL, 'l', 'l'},
+	{F_INT8MI, INLINE_MI, 'l', 'l'},
+	{F_INT8MUL, INLINE_MUL, 'l', 'l'},
+	{F_INT48EQ, INLINE_EQ, 'i', 'l'},
+	{F_INT48NE, INLINE_NE, 'i', 'l'},
+	{F_INT48LT, INLINE_LT, 'i', 'l'},
+	{F_INT48LE, INLINE_LE, 'i', 'l'},
+	{F_INT48GT, INLINE_GT, 'i', 'l'},
+	{F_INT48GE, INLINE_GE, 'i', 'l'},
+	{F_INT48PL, INLINE_PL, 'i', 'l'},
+	{F_INT48MI, INLINE_MI, 'i', 'l'},
+	{F_INT48MUL, INLINE_MUL, 'i', 'l'},
+	{F_INT84EQ, INLINE_EQ, 'l', 'i'},
+	{F_INT84NE, INLINE_NE, 'l', 'i'},
+	{F_INT84LT, INLINE_LT, 'l', 'i'},
+	{F_INT84LE, INLINE_LE, 'l', 'i'},
+	{F_INT84GT, INLINE_GT, 'l', 'i'},
+	{F_INT84GE, INLINE_GE, 'l', 'i'},
+	{F_INT84PL, INLINE_PL, 'l', 'i'},
+	{F_INT84MI, INLINE_MI, 'l', 'i'},
+	{F_INT84MUL, INLINE_MUL, 'l', 'i'},
+#endif
+};
+
+
+static const InlineBuiltin *llvm_find_inline(Oid funcid);
+static int	inline_type_width(char type);
+static LLVMValueRef inline_arg(LLVMBuilderRef b, LLVMValueRef v_datum,
+		   char type, int width);
+static LLVMValueRef inline_arith(LLVMBuilderRef b, InlineOp op,
+			 LLVMValueRef v_arg1, LLVMValueRef v_arg2, int width);
+static void llvmjit_smallint_out_of_range(void);
+static void llvmjit_integer_out_of_range(void);
+static void llvmjit_bigint_out_of_range(void);
+
+
+/*
+ * Can a call to this function be inlined by llvm_inline_builtin?
+ */
+bool
+llvm_can_inline(Oid funcid)
+{
+	return llvm_find_inline(funcid) != NULL;
+}
+
+/*
+ * Emit code computing the result of a call to a built-in function, given
+ * the Datums of its two (non-NULL) arguments.
+ */
+LLVMValueRef
+llvm_inline_builtin(LLVMBuilderRef b, Oid funcid, LLVMValueRef *v_args)
+{
+	const InlineBuiltin *builtin = llvm_find_inline(funcid);
+	LLVMValueRef v_arg1;
+	LLVMValueRef v_arg2;
+	LLVMValueRef v_result;
+	int			width;
+
+	if (builtin == NULL)
+		elog(ERROR, "function %u cannot be inlined", funcid);
+
+	width = Max(inline_type_width(builtin->arg1type),
+				inline_type_width(builtin->arg2type));
+	v_arg1 = inline_arg(b, v_args[0], builtin->arg1type, width);
+	v_arg2 = inline_arg(b, v_args[1], builtin->arg2type, width);
+
+	switch (builtin->op)
+	{
+		case INLINE_PL:
+		case INLINE_MI:
+		case INLINE_MUL:
+			/* the result has the wider type; zero-extend like XGetDatum */
+			v_result = inline_arith(b, builtin->op, v_arg1, v_arg2, width);
+			return LLVMBuildZExt(b, v_result, TypeDatum, "");
+		default:
+			break;
+	}
+
+	/* comparisons; oids are unsigned, bools were turned into i1 */
+	{
+		bool		is_signed = (builtin->arg1type != 'o');
+		LLVMIntPredicate pred;
+
+		switch (builtin->op)
+		{
+			case INLINE_EQ:
+				pred = LLVMIntEQ;
+				break;
+			case INLINE_NE:
+				pred = LLVMIntNE;
+				break;
+			case INLINE_LT:
+				pred = is_signed ? LLVMIntSLT : LLVMIntULT;
+				break;
+			case INLINE_LE:
+				pred = is_signed ? LLVMIntSLE : LLVMIntULE;
+				break;
+			case INLINE_GT:
+				pred = is_signed ? LLVMIntSGT : LLVMIntUGT;
+				break;
+			case INLINE_GE:
+				pred = is_signed ? LLVMIntSGE : LLVMIntUGE;
+				break;
+			default:
+				elog(ERROR, "unexpected inline operation %d",
+					 (int) builtin->op);
+				pred = LLVMIntEQ;	/* keep compiler quiet */
+				break;
+		}
+		v_result = LLVMBuildICmp(b, pred, v_arg1, v_arg2, "");
+		return LLVMBuildZExt(b, v_result, TypeDatum, "");
+	}
+}
+
+static const InlineBuiltin *
+llvm_find_inline(Oid funcid)
+{
+	int			i;
+
+	for (i = 0; i < lengthof(inline_builtins); i++)
+	{
+		if (inline_builtins[i].funcid == funcid)
+			return &inline_builtins[i];
+	}
+	return NULL;
+}
+
+/* width in bits that arguments of the type are compared or computed in */
+static int
+inline_type_width(char type)
+{
+	switch (type)
+	{
+		case 'b':
+			return 1;
+		case 'c':
+			return 8;
+		case 's':
+			return 16;
+		case 'o':
+		case 'i':
+			return 32;
+		case 'l':
+			return 64;
+	}
+	elog(ERROR, "unexpected inline argument type %c", type);
+	return 0;					/* keep compiler quiet */
+}
+
+/*
+ * Turn an argument Datum into an integer of the given width, the way the
+ * DatumGetX macro for its type would.
+ */
+static LLVMValueRef
+inline_arg(LLVMBuilderRef b, LLVMValueRef v_datum, char type, int width)
+{
+	LLVMContextRef lc = LLVMGetTypeContext(TypeDatum);
+	LLVMTypeRef widthtype = LLVMIntTypeInContext(lc, width);
+	int			typewidth = inline_type_width(type);
+	LLVMValueRef v_value;
+
+	/* DatumGetBool looks at the low-order byte only */
+	if (type == 'b')
+		return LLVMBuildICmp(b, LLVMIntNE,
+							 LLVMBuildTrunc(b, v_datum, TypeInt8, ""),
+							 l_int8_const(0), "");
+
+	v_value = LLVMBuildTrunc(b, v_datum,
+							 LLVMIntTypeInContext(lc, typewidth), "");
+	if (typewidth == width)
+		return v_value;
+	Assert(type != 'o' && type != 'c');
+	return LLVMBuildSExt(b, v_value, widthtype, "");
+}
+
+/*
+ * Emit integer arithmetic that raises the C function's error on overflow.
+ */
+static LLVMValueRef
+inline_arith(LLVMBuilderRef b, InlineOp op, LLVMValueRef v_arg1,
+			 LLVMValueRef v_arg2, int width)
+{
+	LLVMBasicBlockRef b_current = LLVMGetInsertBlock(b);
+	LLVMValueRef fn = LLVMGetBasicBlockParent(b_current);
+	LLVMModuleRef module = LLVMGetGlobalParent(fn);
+	LLVMContextRef lc = LLVMGetModuleContext(module);
+	LLVMTypeRef widthtype = LLVMIntTypeInContext(lc, width);
+	LLVMBasicBlockRef b_overflow;
+	LLVMBasicBlockRef b_ok;
+	const char *intrinsic;
+	unsigned	intrinsic_id;
+	LLVMValueRef v_intrinsic;
+	LLVMValueRef args[2];
+	LLVMValueRef v_ret;
+	void	   *errfn;
+
+	switch (op)
+	{
+		case INLINE_PL:
+			intrinsic = "llvm.sadd.with.overflow";
+			break;
+		case INLINE_MI:
+			intrinsic = "llvm.ssub.with.overflow";
+			break;
+		case INLINE_MUL:
+			intrinsic = "llvm.smul.with.overflow";
+			break;
+		default:
+			elog(ERROR, "unexpected inline operation %d", (int) op);
+			intrinsic = NULL;	/* keep compiler quiet */
+			break;
+	}
+
+	if (width == 16)
+		errfn = (void *) llvmjit_smallint_out_of_range;
+	else if (width == 32)
+		errfn = (void *) llvmjit_integer_out_of_range;
+	else
+		errfn = (void *) llvmjit_bigint_out_of_range;
+
+	intrinsic_id = LLVMLookupIntrinsicID(intrinsic, strlen(intrinsic));
+	v_intrinsic = LLVMGetIntrinsicDeclaration(module, intrinsic_id,
+											  &widthtype, 1);
+	args[0] = v_arg1;
+	args[1] = v_arg2;
+	v_ret = LLVMBuildCall2(b, LLVMGlobalGetValueType(v_intrinsic),
+						   v_intrinsic, args, 2, "");
+
+	b_overflow = LLVMAppendBasicBlockInContext(lc, fn, "op.overflow");
+	b_ok = LLVMAppendBasicBlockInContext(lc, fn, "op.nooverflow");
+	LLVMMoveBasicBlockAfter(b_ok, b_current);
+	LLVMBuildCondBr(b, LLVMBuildExtractValue(b, v_ret, 1, ""),
+					b_overflow, b_ok);
+
+	LLVMPositionBuilderAtEnd(b, b_overflow);
+	l_call(b, errfn, TypeVoid, NULL, NULL, 0);
+	LLVMBuildUnreachable(b);
+
+	LLVMPositionBuilderAtEnd(b, b_ok);
+	return LLVMBuildExtractValue(b, v_ret, 0, "");
+}
+
+static void
+llvmjit_smallint_out_of_range(void)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+			 errmsg("smallint out of range")));
+}
+
+static void
+llvmjit_integer_out_of_range(void)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+			 errmsg("integer out of range")));
+}
+
+static void
+llvmjit_bigint_out_of_range(void)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+			 errmsg("bigint out of range")));
+}
@@ -17,6 +17,7 @@
 
 #include <math.h>
 
+#include "access/heapam.h"
 #include "catalog/pg_class.h"
 #include "foreign/fdwapi.h"
 #include "nodes/nodeFuncs.h"
@@ -37,6 +38,7 @@
 #include "parser/parsetree.h"
 #include "rewrite/rewriteManip.h"
 #include "utils/lsyscache.h"
+#include "utils/rel.h"
 
 
 /* These parameters are set by GUC */
@@ -57,6 +59,11 @@ static void set_plain_rel_size(PlannerInfo *root, RelOptInfo *rel,
 				   RangeTblEntry *rte);
 static void set_plain_rel_pathlist(PlannerInfo *root, RelOptInfo *rel,
 					   RangeTblEntry *rte);
+static void create_parallel_paths(PlannerInfo *root, RelOptInfo *rel,
+					  RangeTblEntry *rte);
+static bool rel_is_parallel_safe(PlannerInfo *root, RelOptInfo *rel,
+					 RangeTblEntry *rte);
+static bool contain_params_walker(Node *node, void *context);
 static void set_foreign_size(PlannerInfo *root, RelOptInfo *rel,
 				 RangeTblEntry *rte);
 static void set_foreign_pathlist(PlannerInfo *root, RelOptInfo *rel,
@@ -391,7 +398,11 @@ set_plain_rel_pathlist(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
 	required_outer = rel->lateral_relids;
 
 	/* Consider sequential scan */
-	add_path(rel, create_seqscan_path(root, rel, required_outer));
+	add_path(rel, create_seqscan_path(root, rel, required_outer, 0));
+
+	/* Consider parallel sequential scan */
+	if (max_parallel_degree > 0 && required_outer == NULL)
+		create_parallel_paths(root, rel, rte);
 
 	/* Consider index scans */
 	create_index_paths(root, rel);
@@ -403,6 +414,83 @@ set_plain_rel_pathlist(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
 	set_cheapest(rel);
 }
 
+/*
+ * create_parallel_paths
+ *	  Build a Gather path over a parallel sequential scan of a plain
+ *	  relation, if it's safe to do so.
+ */
+static void
+create_parallel_paths(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
+{
+	Path	   *subpath;
+
+	if (!rel_is_parallel_safe(root, rel, rte))
+		return;
+
+	subpath = create_seqscan_path(root, rel, NULL, max_parallel_degree);
+	add_path(rel, (Path *)
+			 create_gather_path(root, rel, subpath, max_parallel_degree));
+}
+
+/*
+ * rel_is_parallel_safe
+ *	  Check whether a scan of the relation can be divided among workers.
+ *
+ * Workers run the scan and its restriction clauses under the leader's
+ * snapshot, but they know nothing else about the leader's state: not its
+ * uncommitted changes, not its temporary tables, not its parameter values,
+ * and not its settings.  So we insist on a read-only query over a permanent
+ * or unlogged table, whose restriction clauses involve only immutable
+ * functions and no parameters or subplans.  The targetlist is evaluated in
+ * the leader, so it can contain anything.
+ */
+static bool
+rel_is_parallel_safe(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
+{
+	Query	   *parse = root->parse;
+	Relation	relation;
+	bool		uses_local_buffers;
+	ListCell   *lc;
+
+	if (rel->reloptkind != RELOPT_BASEREL ||
+		rel->lateral_relids != NULL)
+		return false;
+
+	if (parse->commandType != CMD_SELECT ||
+		parse->rowMarks != NIL ||
+		parse->hasModifyingCTE)
+		return false;
+
+	foreach(lc, rel->baserestrictinfo)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+		Node	   *clause = (Node *) rinfo->clause;
+
+		if (rinfo->pseudoconstant ||
+			contain_mutable_functions(clause) ||
+			contain_subplans(clause) ||
+			contain_params_walker(clause, NULL))
+			return false;
+	}
+
+	/* The planner already holds a lock on the relation. */
+	relation = heap_open(rte->relid, NoLock);
+	uses_local_buffers = RelationUsesLocalBuffers(relation);
+	heap_close(relation, NoLock);
+
+	return !uses_local_buffers;
+}
+
+static bool
+contain_params_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Param))
+		return true;
+	return expression_tree_walker(node, contain_params_walker, context);
+}
+
 /*
  * set_foreign_size
  *		Set size estimates for a foreign table RTE
@@ -2065,6 +2153,10 @@ print_path(PlannerInfo *root, Path *path, int indent)
 			ptype = "Material";
 			subpath = ((MaterialPath *) path)->subpath;
 			break;
+		case T_GatherPath:
+			ptype = "Gather";
+			subpath = ((GatherPath *) path)->subpath;
+			break;
 		case T_UniquePath:
 			ptype = "Unique";
 			subpath = ((UniquePath *) path)->subpath;
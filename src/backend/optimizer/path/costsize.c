@@ -11,6 +11,8 @@
  *	cpu_tuple_cost		Cost of typical CPU time to process a tuple
  *	cpu_index_tuple_cost  Cost of typical CPU time to process an index tuple
  *	cpu_operator_cost	Cost of CPU time to execute an operator or function
+ *	parallel_tuple_cost Cost of CPU time to pass a tuple from worker to master backend
+ *	parallel_setup_cost Cost of setting up shared memory for parallelism
  *
  * We expect that the kernel will typically do some amount of read-ahead
  * optimization; this in conjunction with seek costs means that seq_page_cost
@@ -76,6 +78,7 @@
 #include "access/htup_details.h"
 #include "executor/executor.h"
 #include "executor/nodeHash.h"
+#include "executor/nodeIncrementalSort.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
@@ -101,6 +104,8 @@ double		random_page_cost = DEFAULT_RANDOM_PAGE_COST;
 double		cpu_tuple_cost = DEFAULT_CPU_TUPLE_COST;
 double		cpu_index_tuple_cost = DEFAULT_CPU_INDEX_TUPLE_COST;
 double		cpu_operator_cost = DEFAULT_CPU_OPERATOR_COST;
+double		parallel_tuple_cost = DEFAULT_PARALLEL_TUPLE_COST;
+double		parallel_setup_cost = DEFAULT_PARALLEL_SETUP_COST;
 
 int			effective_cache_size = DEFAULT_EFFECTIVE_CACHE_SIZE;
 
@@ -112,12 +117,15 @@ bool		enable_indexonlyscan = true;
 bool		enable_bitmapscan = true;
 bool		enable_tidscan = true;
 bool		enable_sort = true;
+bool		enable_incrementalsort = true;
 bool		enable_hashagg = true;
 bool		enable_nestloop = true;
 bool		enable_material = true;
 bool		enable_mergejoin = true;
 bool		enable_hashjoin = true;
 
+int			max_parallel_degree = 0;
+
 typedef struct
 {
 	PlannerInfo *root;
@@ -127,6 +135,10 @@ typedef struct
 static MergeScanSelCache *cached_scansel(PlannerInfo *root,
 			   RestrictInfo *rinfo,
 			   PathKey *pathkey);
+static void cost_tuplesort(Cost *startup_cost, Cost *run_cost,
+			   double tuples, int width,
+			   Cost comparison_cost, int sort_mem,
+			   double limit_tuples);
 static void cost_rescan(PlannerInfo *root, Path *path,
 			Cost *rescan_startup_cost, Cost *rescan_total_cost);
 static bool cost_qual_eval_walker(Node *node, cost_qual_eval_context *context);
@@ -173,10 +185,12 @@ clamp_row_est(double nrows)
  *
  * 'baserel' is the relation to be scanned
  * 'param_info' is the ParamPathInfo if this is a parameterized path, else NULL
+ * 'nworkers' is the number of workers sharing the scan, or 0 if none
  */
 void
 cost_seqscan(Path *path, PlannerInfo *root,
-			 RelOptInfo *baserel, ParamPathInfo *param_info)
+			 RelOptInfo *baserel, ParamPathInfo *param_info,
+			 int nworkers)
 {
 	Cost		startup_cost = 0;
 	Cost		run_cost = 0;
@@ -212,7 +226,13 @@ cost_seqscan(Path *path, PlannerInfo *root,
 
 	startup_cost += qpqual_cost.startup;
 	cpu_per_tuple = cpu_tuple_cost + qpqual_cost.per_tuple;
-	run_cost += cpu_per_tuple * baserel->tuples;
+
+	/*
+	 * In a parallel scan the leader and each worker process a share of the
+	 * tuples.  The disk costs are not divided, since the participants all
+	 * read from the same storage.
+	 */
+	run_cost += cpu_per_tuple * baserel->tuples / (nworkers + 1);
 
 	path->startup_cost = startup_cost;
 	path->total_cost = startup_cost + run_cost;
@@ -1240,17 +1260,43 @@ cost_sort(Path *path, PlannerInfo *root,
 		  double limit_tuples)
 {
 	Cost		startup_cost = input_cost;
-	Cost		run_cost = 0;
-	double		input_bytes = relation_byte_size(tuples, width);
-	double		output_bytes;
-	double		output_tuples;
-	long		sort_mem_bytes = sort_mem * 1024L;
+	Cost		sort_startup_cost;
+	Cost		sort_run_cost;
 
 	if (!enable_sort)
 		startup_cost += disable_cost;
 
 	path->rows = tuples;
 
+	cost_tuplesort(&sort_startup_cost, &sort_run_cost,
+				   tuples, width, comparison_cost, sort_mem,
+				   limit_tuples);
+
+	path->startup_cost = startup_cost + sort_startup_cost;
+	path->total_cost = path->startup_cost + sort_run_cost;
+}
+
+/*
+ * cost_tuplesort
+ *	  Determines the cost of sorting tuples with tuplesort.c, not counting
+ *	  the cost of reading the input; see cost_sort for the details.
+ *
+ * The cost of doing the sort is returned in *startup_cost, and the cost of
+ * returning the sorted tuples in *run_cost.
+ */
+static void
+cost_tuplesort(Cost *startup_cost, Cost *run_cost,
+			   double tuples, int width,
+			   Cost comparison_cost, int sort_mem,
+			   double limit_tuples)
+{
+	double		input_bytes = relation_byte_size(tuples, width);
+	double		output_bytes;
+	double		output_tuples;
+	long		sort_mem_bytes = sort_mem * 1024L;
+
+	*startup_cost = 0;
+
 	/*
 	 * We want to be sure the cost of a sort is never estimated as zero, even
 	 * if passed-in tuple count is zero.  Besides, mustn't do log(0)...
@@ -1289,7 +1335,7 @@ cost_sort(Path *path, PlannerInfo *root,
 		 *
 		 * Assume about N log2 N comparisons
 		 */
-		startup_cost += comparison_cost * tuples * LOG2(tuples);
+		*startup_cost += comparison_cost * tuples * LOG2(tuples);
 
 		/* Disk costs */
 
@@ -1300,7 +1346,7 @@ cost_sort(Path *path, PlannerInfo *root,
 			log_runs = 1.0;
 		npageaccesses = 2.0 * npages * log_runs;
 		/* Assume 3/4ths of accesses are sequential, 1/4th are not */
-		startup_cost += npageaccesses *
+		*startup_cost += npageaccesses *
 			(seq_page_cost * 0.75 + random_page_cost * 0.25);
 	}
 	else if (tuples > 2 * output_tuples || input_bytes > sort_mem_bytes)
@@ -1311,12 +1357,12 @@ cost_sort(Path *path, PlannerInfo *root,
 		 * factor is a bit higher than for quicksort.  Tweak it so that the
 		 * cost curve is continuous at the crossover point.
 		 */
-		startup_cost += comparison_cost * tuples * LOG2(2.0 * output_tuples);
+		*startup_cost += comparison_cost * tuples * LOG2(2.0 * output_tuples);
 	}
 	else
 	{
 		/* We'll use plain quicksort on all the input tuples */
-		startup_cost += comparison_cost * tuples * LOG2(tuples);
+		*startup_cost += comparison_cost * tuples * LOG2(tuples);
 	}
 
 	/*
@@ -1327,12 +1373,121 @@ cost_sort(Path *path, PlannerInfo *root,
 	 * here --- the upper LIMIT will pro-rate the run cost so we'd be double
 	 * counting the LIMIT otherwise.
 	 */
-	run_cost += cpu_operator_cost * tuples;
+	*run_cost = cpu_operator_cost * tuples;
+}
+
+/*
+ * cost_incremental_sort
+ *	  Determines and returns the cost of an IncrementalSort node, which
+ *	  sorts input that is already sorted by the first presorted_keys of
+ *	  the pathkeys.
+ *
+ * The input is sorted in batches made of whole groups of tuples with equal
+ * presorted keys, each at least INCSORT_MIN_BATCH_TUPLES tuples (see
+ * nodeIncrementalSort.c).  Only the first batch has to be read and sorted
+ * before the first tuple can be returned, which is what makes this
+ * attractive under a LIMIT: the startup cost is that of sorting one batch,
+ * rather than the whole input.
+ *
+ * The arguments are as for cost_sort, except that we need the input's
+ * startup cost as well as its total cost.
+ */
+void
+cost_incremental_sort(Path *path, PlannerInfo *root,
+					  List *pathkeys, int presorted_keys,
+					  Cost input_startup_cost, Cost input_total_cost,
+					  double input_tuples, int width, Cost comparison_cost,
+					  int sort_mem, double limit_tuples)
+{
+	Cost		startup_cost = input_startup_cost;
+	Cost		run_cost = 0;
+	Cost		input_run_cost = input_total_cost - input_startup_cost;
+	Cost		batch_startup_cost;
+	Cost		batch_run_cost;
+	double		input_groups;
+	double		batch_tuples;
+	double		nbatches;
+	List	   *presorted_exprs = NIL;
+	ListCell   *lc;
+
+	Assert(presorted_keys > 0 && presorted_keys < list_length(pathkeys));
+
+	path->rows = input_tuples;
+
+	if (input_tuples < 2.0)
+		input_tuples = 2.0;
+
+	/* Estimate the number of groups of tuples with equal presorted keys */
+	foreach(lc, pathkeys)
+	{
+		PathKey    *pathkey = (PathKey *) lfirst(lc);
+		EquivalenceMember *member = (EquivalenceMember *)
+		linitial(pathkey->pk_eclass->ec_members);
+
+		presorted_exprs = lappend(presorted_exprs, member->em_expr);
+		if (list_length(presorted_exprs) >= presorted_keys)
+			break;
+	}
+	input_groups = estimate_num_groups(root, presorted_exprs, input_tuples);
+
+	/* Small groups are combined into batches */
+	batch_tuples = Max(input_tuples / input_groups, INCSORT_MIN_BATCH_TUPLES);
+	batch_tuples = Min(batch_tuples, input_tuples);
+	nbatches = ceil(input_tuples / batch_tuples);
+
+	cost_tuplesort(&batch_startup_cost, &batch_run_cost,
+				   batch_tuples, width, comparison_cost, sort_mem,
+				   limit_tuples);
+
+	/* The first batch has to be read and sorted before we return anything */
+	startup_cost += input_run_cost * (batch_tuples / input_tuples) +
+		batch_startup_cost;
+
+	/* Then the rest of the input, and the remaining batches */
+	run_cost += input_run_cost * (1.0 - batch_tuples / input_tuples);
+	run_cost += batch_run_cost +
+		(nbatches - 1) * (batch_startup_cost + batch_run_cost);
+
+	/*
+	 * Charge for comparing the presorted keys to find the end of each group,
+	 * and for setting up a fresh tuplesort for each batch.
+	 */
+	run_cost += cpu_operator_cost * presorted_keys * input_tuples;
+	run_cost += cpu_tuple_cost * nbatches;
 
 	path->startup_cost = startup_cost;
 	path->total_cost = startup_cost + run_cost;
 }
 
+/*
+ * cost_sort_presorted
+ *	  Determines the cost of sorting input that is already sorted by
+ *	  input_pathkeys into pathkeys order, which it doesn't satisfy yet.
+ *
+ * An incremental sort is assumed if the input is sorted by a leading subset
+ * of pathkeys, and a plain Sort otherwise.  Other arguments are as for
+ * cost_incremental_sort.
+ */
+void
+cost_sort_presorted(Path *path, PlannerInfo *root,
+					List *pathkeys, List *input_pathkeys,
+					Cost input_startup_cost, Cost input_total_cost,
+					double tuples, int width, double limit_tuples)
+{
+	int			presorted_keys;
+
+	if (enable_incrementalsort &&
+		!pathkeys_count_contained_in(pathkeys, input_pathkeys,
+									 &presorted_keys) &&
+		presorted_keys > 0)
+		cost_incremental_sort(path, root, pathkeys, presorted_keys,
+							  input_startup_cost, input_total_cost,
+							  tuples, width, 0.0, work_mem, limit_tuples);
+	else
+		cost_sort(path, root, pathkeys, input_total_cost,
+				  tuples, width, 0.0, work_mem, limit_tuples);
+}
+
 /*
  * cost_merge_append
  *	  Determines and returns the cost of a MergeAppend node.
@@ -1452,6 +1607,42 @@ cost_material(Path *path,
 	path->total_cost = startup_cost + run_cost;
 }
 
+/*
+ * cost_gather
+ *	  Determines and returns the cost of a gather path, including the cost
+ *	  of its input.
+ *
+ * Launching workers costs parallel_setup_cost up front, and each tuple
+ * passed back from a worker costs parallel_tuple_cost.
+ *
+ * 'baserel' is the relation to be scanned
+ * 'param_info' is the ParamPathInfo if this is a parameterized path, else NULL
+ */
+void
+cost_gather(GatherPath *path, PlannerInfo *root,
+			RelOptInfo *baserel, ParamPathInfo *param_info)
+{
+	Cost		startup_cost = 0;
+	Cost		run_cost = 0;
+
+	/* Mark the path with the correct row estimate */
+	if (param_info)
+		path->path.rows = param_info->ppi_rows;
+	else
+		path->path.rows = baserel->rows;
+
+	startup_cost = path->subpath->startup_cost;
+
+	run_cost = path->subpath->total_cost - path->subpath->startup_cost;
+
+	/* Parallel setup and communication cost. */
+	startup_cost += parallel_setup_cost;
+	run_cost += parallel_tuple_cost * path->path.rows;
+
+	path->path.startup_cost = startup_cost;
+	path->path.total_cost = (startup_cost + run_cost);
+}
+
 /*
  * cost_agg
  *		Determines and returns the cost of performing an Agg plan node,
@@ -1546,6 +1737,58 @@ cost_agg(Path *path, PlannerInfo *root,
 	path->total_cost = total_cost;
 }
 
+/*
+ * cost_hashagg_spill
+ *		Add the cost of spilling to disk to a hashed aggregation whose
+ *		hashtable is not expected to fit in work_mem.
+ *
+ * Once the hashtable is full, the executor writes the input tuples of any
+ * groups that didn't fit out to batch files and reads them back later,
+ * repeating the process on a batch that still doesn't fit.  We charge for
+ * writing and reading the fraction of the input that overflows, once per
+ * level of recursion, using the same mix of sequential and random access
+ * that cost_sort assumes for its tapes.
+ *
+ * 'numGroups' is the estimated number of groups
+ * 'hashentrysize' is the estimated size of a hashtable entry for one group
+ * 'input_tuples' is the number of input tuples
+ * 'input_width' is the average width of the input tuples
+ */
+void
+cost_hashagg_spill(Path *path, double numGroups, double hashentrysize,
+				   double input_tuples, int input_width)
+{
+	double		hashtable_bytes = numGroups * hashentrysize;
+	double		work_mem_bytes = work_mem * 1024.0;
+	double		spill_fraction;
+	double		depth;
+	double		npages;
+	Cost		spill_cost;
+
+	if (hashtable_bytes <= work_mem_bytes)
+		return;
+
+	/* The groups that fit are aggregated without spilling their input */
+	spill_fraction = 1.0 - work_mem_bytes / hashtable_bytes;
+
+	/* Each level splits the spilled input about 32 ways */
+	depth = ceil(log(hashtable_bytes / work_mem_bytes) / log(32.0));
+	if (depth < 1.0)
+		depth = 1.0;
+
+	npages = page_size(input_tuples * spill_fraction, input_width);
+
+	/* Write and read back each spilled page, at every level */
+	spill_cost = 2.0 * npages * depth *
+		(seq_page_cost * 0.75 + random_page_cost * 0.25);
+	/* ... and process the spilled tuples again */
+	spill_cost += cpu_tuple_cost * input_tuples * spill_fraction * depth;
+
+	/* The first batch of groups can't be returned until the input is read */
+	path->startup_cost += spill_cost;
+	path->total_cost += spill_cost;
+}
+
 /*
  * cost_windowagg
  *		Determines and returns the cost of performing a WindowAgg plan node,
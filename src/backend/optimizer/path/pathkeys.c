@@ -22,6 +22,7 @@
 #include "nodes/nodeFuncs.h"
 #include "nodes/plannodes.h"
 #include "optimizer/clauses.h"
+#include "optimizer/cost.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
 #include "optimizer/tlist.h"
@@ -330,6 +331,43 @@ pathkeys_contained_in(List *keys1, List *keys2)
 	return false;
 }
 
+/*
+ * pathkeys_count_contained_in
+ *	  Same as pathkeys_contained_in, but also sets *n_common to the number
+ *	  of leading keys of keys1 that keys2 is sorted by.
+ *
+ * When keys2 doesn't fully satisfy keys1, this tells whether an input
+ * sorted by keys2 is of any use for an incremental sort by keys1.
+ */
+bool
+pathkeys_count_contained_in(List *keys1, List *keys2, int *n_common)
+{
+	int			n = 0;
+	ListCell   *key1,
+			   *key2;
+
+	/* Fall out quickly for identical lists, as in compare_pathkeys */
+	if (keys1 == keys2)
+	{
+		*n_common = list_length(keys1);
+		return true;
+	}
+
+	forboth(key1, keys1, key2, keys2)
+	{
+		if (lfirst(key1) != lfirst(key2))
+		{
+			*n_common = n;
+			return false;
+		}
+		n++;
+	}
+
+	/* keys2 satisfies keys1 unless keys1 is longer */
+	*n_common = n;
+	return (key1 == NULL);
+}
+
 /*
  * get_cheapest_path_for_pathkeys
  *	  Find the cheapest path (according to the specified criterion) that
@@ -1399,25 +1437,36 @@ right_merge_direction(PlannerInfo *root, PathKey *pathkey)
  *		Count the number of pathkeys that are useful for meeting the
  *		query's requested output ordering.
  *
- * Unlike merge pathkeys, this is an all-or-nothing affair: it does us
- * no good to order by just the first key(s) of the requested ordering.
- * So the result is always either 0 or list_length(root->query_pathkeys).
+ * A path sorted by just the first key(s) of the requested ordering can be
+ * finished off with an incremental sort, which query_planner considers for
+ * ORDER BY and DISTINCT, so then we count the leading keys that match.
+ * Otherwise this is an all-or-nothing affair, and the result is either 0
+ * or list_length(root->query_pathkeys).
  */
 static int
 pathkeys_useful_for_ordering(PlannerInfo *root, List *pathkeys)
 {
+	int			n_common_pathkeys;
+
 	if (root->query_pathkeys == NIL)
 		return 0;				/* no special ordering requested */
 
 	if (pathkeys == NIL)
 		return 0;				/* unordered path */
 
-	if (pathkeys_contained_in(root->query_pathkeys, pathkeys))
+	if (pathkeys_count_contained_in(root->query_pathkeys, pathkeys,
+									&n_common_pathkeys))
 	{
 		/* It's useful ... or at least the first N keys are */
 		return list_length(root->query_pathkeys);
 	}
 
+	/* Partially useful, if an incremental sort can make up the rest */
+	if (enable_incrementalsort &&
+		root->group_pathkeys == NIL &&
+		root->window_pathkeys == NIL)
+		return n_common_pathkeys;
+
 	return 0;					/* path ordering not useful */
 }
 
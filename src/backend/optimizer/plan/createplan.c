@@ -19,7 +19,9 @@
 #include <limits.h>
 #include <math.h>
 
+#include "access/heapam.h"
 #include "access/skey.h"
+#include "catalog/partition.h"
 #include "catalog/pg_class.h"
 #include "foreign/fdwapi.h"
 #include "miscadmin.h"
@@ -40,6 +42,7 @@
 #include "parser/parse_clause.h"
 #include "parser/parsetree.h"
 #include "utils/lsyscache.h"
+#include "utils/rel.h"
 
 
 static Plan *create_plan_recurse(PlannerInfo *root, Path *best_path);
@@ -50,9 +53,14 @@ static void disuse_physical_tlist(PlannerInfo *root, Plan *plan, Path *path);
 static Plan *create_gating_plan(PlannerInfo *root, Plan *plan, List *quals);
 static Plan *create_join_plan(PlannerInfo *root, JoinPath *best_path);
 static Plan *create_append_plan(PlannerInfo *root, AppendPath *best_path);
+static void add_partition_pruning_info(PlannerInfo *root,
+						   AppendPath *best_path, Append *plan);
+static int	partition_index_of_child(PartitionDesc pdesc, Oid parentOID,
+						 Oid childOID);
 static Plan *create_merge_append_plan(PlannerInfo *root, MergeAppendPath *best_path);
 static Result *create_result_plan(PlannerInfo *root, ResultPath *best_path);
 static Material *create_material_plan(PlannerInfo *root, MaterialPath *best_path);
+static Gather *create_gather_plan(PlannerInfo *root, GatherPath *best_path);
 static Plan *create_unique_plan(PlannerInfo *root, UniquePath *best_path);
 static SeqScan *create_seqscan_plan(PlannerInfo *root, Path *best_path,
 					List *tlist, List *scan_clauses);
@@ -168,6 +176,7 @@ static EquivalenceMember *find_ec_member_for_tle(EquivalenceClass *ec,
 					   TargetEntry *tle,
 					   Relids relids);
 static Material *make_material(Plan *lefttree);
+static Gather *make_gather(Plan *lefttree, int num_workers);
 
 
 /*
@@ -259,6 +268,10 @@ create_plan_recurse(PlannerInfo *root, Path *best_path)
 			plan = (Plan *) create_material_plan(root,
 												 (MaterialPath *) best_path);
 			break;
+		case T_Gather:
+			plan = (Plan *) create_gather_plan(root,
+											   (GatherPath *) best_path);
+			break;
 		case T_Unique:
 			plan = create_unique_plan(root,
 									  (UniquePath *) best_path);
@@ -719,9 +732,162 @@ create_append_plan(PlannerInfo *root, AppendPath *best_path)
 
 	plan = make_append(subplans, tlist);
 
+	add_partition_pruning_info(root, best_path, plan);
+
 	return (Plan *) plan;
 }
 
+/*
+ * add_partition_pruning_info
+ *	  If the appendrel is a partitioned table, look for comparisons of its
+ *	  first partition key column with values that are only known at run
+ *	  time, so that the executor can skip partitions that can't match.
+ *
+ * Comparisons with constants have already been used to leave partitions
+ * out of the appendrel altogether (see expand_inherited_rtentry); here we
+ * want Params, including nestloop Params standing for outer-relation Vars
+ * of the join clauses of a parameterized path.
+ */
+static void
+add_partition_pruning_info(PlannerInfo *root, AppendPath *best_path,
+						   Append *plan)
+{
+	RelOptInfo *rel = best_path->path.parent;
+	RangeTblEntry *rte;
+	Relation	relation;
+	PartitionKey key;
+	List	   *clauses;
+	ListCell   *lc;
+
+	if (rel->reloptkind != RELOPT_BASEREL)
+		return;
+	rte = planner_rt_fetch(rel->relid, root);
+	if (rte->rtekind != RTE_RELATION)
+		return;
+
+	/* We need not lock the relation; the planner already has */
+	relation = heap_open(rte->relid, NoLock);
+	key = RelationGetPartitionKey(relation);
+	if (key == NULL)
+	{
+		heap_close(relation, NoLock);
+		return;
+	}
+
+	clauses = extract_actual_clauses(rel->baserestrictinfo, false);
+
+	/* Add the join clauses a parameterized path can use, as in relnode.c */
+	if (best_path->path.param_info)
+	{
+		Relids		required_outer = best_path->path.param_info->ppi_req_outer;
+		Relids		joinrelids = bms_union(rel->relids, required_outer);
+		List	   *jclauses = NIL;
+
+		foreach(lc, rel->joininfo)
+		{
+			RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+			if (join_clause_is_movable_into(rinfo, rel->relids, joinrelids))
+				jclauses = lappend(jclauses, rinfo);
+		}
+		jclauses = list_concat(jclauses,
+							   generate_join_implied_equalities(root,
+																joinrelids,
+																required_outer,
+																rel));
+		clauses = list_concat(clauses,
+							  extract_actual_clauses(jclauses, false));
+	}
+
+	foreach(lc, clauses)
+	{
+		Expr	   *clause = (Expr *) lfirst(lc);
+		int			keycol;
+		StrategyNumber strategy;
+		Oid			cmpproc;
+		Expr	   *expr;
+
+		if (!match_partition_key_clause(key, rel->relid, key->partattrs,
+										clause, &keycol, &strategy,
+										&cmpproc, &expr))
+			continue;
+
+		/* Only the first key column orders the partitions */
+		if (keycol != 0 || IsA(expr, Const))
+			continue;
+		if (bms_overlap(pull_varnos((Node *) expr), rel->relids) ||
+			contain_volatile_functions((Node *) expr) ||
+			contain_subplans((Node *) expr))
+			continue;
+		expr = (Expr *) replace_nestloop_params(root, (Node *) expr);
+		if (contain_var_clause((Node *) expr))
+			continue;
+
+		plan->part_prune_exprs = lappend(plan->part_prune_exprs, expr);
+		plan->part_prune_strategies = lappend_int(plan->part_prune_strategies,
+												  strategy);
+		plan->part_prune_cmpprocs = lappend_oid(plan->part_prune_cmpprocs,
+												cmpproc);
+	}
+
+	if (plan->part_prune_exprs != NIL)
+	{
+		PartitionDesc pdesc = RelationGetPartitionDesc(relation);
+
+		plan->part_relid = rte->relid;
+		foreach(lc, best_path->subpaths)
+		{
+			Path	   *subpath = (Path *) lfirst(lc);
+			RangeTblEntry *childrte;
+
+			childrte = planner_rt_fetch(subpath->parent->relid, root);
+			plan->part_subplan_indexes =
+				lappend_int(plan->part_subplan_indexes,
+							partition_index_of_child(pdesc, rte->relid,
+													 childrte->relid));
+		}
+	}
+
+	heap_close(relation, NoLock);
+}
+
+/*
+ * partition_index_of_child
+ *	  Find the partition of parentOID that childOID is, or belongs to if it
+ *	  is a partition of a partition, and return its index in pdesc.  Returns
+ *	  -1 if childOID is the parent itself.
+ */
+static int
+partition_index_of_child(PartitionDesc pdesc, Oid parentOID, Oid childOID)
+{
+	while (childOID != parentOID)
+	{
+		Relation	childrel = heap_open(childOID, NoLock);
+		Oid			partparent = InvalidOid;
+
+		if (RelationIsPartition(childrel))
+			partparent = childrel->rd_partparent;
+		heap_close(childrel, NoLock);
+
+		if (partparent == parentOID)
+		{
+			int			i;
+
+			for (i = 0; i < pdesc->nparts; i++)
+			{
+				if (pdesc->oids[i] == childOID)
+					return i;
+			}
+			break;
+		}
+		if (!OidIsValid(partparent))
+			break;
+		childOID = partparent;
+	}
+
+	return -1;
+}
+
 /*
  * create_merge_append_plan
  *	  Create a MergeAppend plan for 'best_path' and (recursively) plans
@@ -872,6 +1038,33 @@ create_material_plan(PlannerInfo *root, MaterialPath *best_path)
 	return plan;
 }
 
+/*
+ * create_gather_plan
+ *	  Create a Gather plan for 'best_path' and (recursively) plans
+ *	  for its subpaths.
+ *
+ *	  Returns a Plan node.
+ */
+static Gather *
+create_gather_plan(PlannerInfo *root, GatherPath *best_path)
+{
+	Gather	   *plan;
+	Plan	   *subplan;
+
+	subplan = create_plan_recurse(root, best_path->subpath);
+
+	/* nodeGather.c only knows how to divide up a sequential scan */
+	if (!IsA(subplan, SeqScan))
+		elog(ERROR, "unexpected plan node type under Gather: %d",
+			 (int) nodeTag(subplan));
+
+	plan = make_gather(subplan, best_path->num_workers);
+
+	copy_path_costsize(&plan->plan, (Path *) best_path);
+
+	return plan;
+}
+
 /*
  * create_unique_plan
  *	  Create a Unique plan for 'best_path' and (recursively) plans
@@ -3174,6 +3367,7 @@ copy_path_costsize(Plan *dest, Path *src)
 		dest->total_cost = src->total_cost;
 		dest->plan_rows = src->rows;
 		dest->plan_width = src->parent->width;
+		dest->parallel_aware = src->parallel_aware;
 	}
 	else
 	{
@@ -3181,6 +3375,7 @@ copy_path_costsize(Plan *dest, Path *src)
 		dest->total_cost = 0;
 		dest->plan_rows = 0;
 		dest->plan_width = 0;
+		dest->parallel_aware = false;
 	}
 }
 
@@ -4127,6 +4322,91 @@ make_sort_from_pathkeys(PlannerInfo *root, Plan *lefttree, List *pathkeys,
 					 nullsFirst, limit_tuples);
 }
 
+/*
+ * make_sort_from_presorted_pathkeys
+ *	  Create a plan to sort according to given pathkeys, the input being
+ *	  already sorted by input_pathkeys
+ *
+ *	  If the input is sorted by a leading subset of the pathkeys, this
+ *	  builds an IncrementalSort node, else a plain Sort.  The caller should
+ *	  have checked that input_pathkeys don't satisfy the pathkeys already.
+ *
+ *	  'lefttree' is the node which yields input tuples
+ *	  'pathkeys' is the list of pathkeys by which the result is to be sorted
+ *	  'input_pathkeys' is the list of pathkeys the input is sorted by
+ *	  'limit_tuples' is the bound on the number of output tuples;
+ *				-1 if no bound
+ */
+Plan *
+make_sort_from_presorted_pathkeys(PlannerInfo *root, Plan *lefttree,
+								  List *pathkeys, List *input_pathkeys,
+								  double limit_tuples)
+{
+	int			presortedCols;
+	int			numsortkeys;
+	AttrNumber *sortColIdx;
+	Oid		   *sortOperators;
+	Oid		   *collations;
+	bool	   *nullsFirst;
+	IncrementalSort *node;
+	Plan	   *plan;
+	Path		sort_path;		/* dummy for result of cost_incremental_sort */
+
+	if (!enable_incrementalsort ||
+		pathkeys_count_contained_in(pathkeys, input_pathkeys, &presortedCols) ||
+		presortedCols == 0)
+		return (Plan *) make_sort_from_pathkeys(root, lefttree, pathkeys,
+												limit_tuples);
+
+	/* Compute sort column info, and adjust lefttree as needed */
+	lefttree = prepare_sort_from_pathkeys(root, lefttree, pathkeys,
+										  NULL,
+										  NULL,
+										  false,
+										  &numsortkeys,
+										  &sortColIdx,
+										  &sortOperators,
+										  &collations,
+										  &nullsFirst);
+
+	/*
+	 * If duplicate sort columns were eliminated, the presorted columns might
+	 * cover all of them; then the input is really sorted already, but let a
+	 * plain Sort take care of that rare case.
+	 */
+	if (presortedCols >= numsortkeys)
+		return (Plan *) make_sort(root, lefttree, numsortkeys,
+								  sortColIdx, sortOperators, collations,
+								  nullsFirst, limit_tuples);
+
+	node = makeNode(IncrementalSort);
+	plan = &node->sort.plan;
+
+	copy_plan_costsize(plan, lefttree); /* only care about copying size */
+	cost_incremental_sort(&sort_path, root, pathkeys, presortedCols,
+						  lefttree->startup_cost,
+						  lefttree->total_cost,
+						  lefttree->plan_rows,
+						  lefttree->plan_width,
+						  0.0,
+						  work_mem,
+						  limit_tuples);
+	plan->startup_cost = sort_path.startup_cost;
+	plan->total_cost = sort_path.total_cost;
+	plan->targetlist = lefttree->targetlist;
+	plan->qual = NIL;
+	plan->lefttree = lefttree;
+	plan->righttree = NULL;
+	node->sort.numCols = numsortkeys;
+	node->sort.sortColIdx = sortColIdx;
+	node->sort.sortOperators = sortOperators;
+	node->sort.collations = collations;
+	node->sort.nullsFirst = nullsFirst;
+	node->presortedCols = presortedCols;
+
+	return plan;
+}
+
 /*
  * make_sort_from_sortclauses
  *	  Create sort plan to sort according to given sortclauses
@@ -4237,6 +4517,22 @@ make_material(Plan *lefttree)
 	return node;
 }
 
+static Gather *
+make_gather(Plan *lefttree, int num_workers)
+{
+	Gather	   *node = makeNode(Gather);
+	Plan	   *plan = &node->plan;
+
+	/* cost should be inserted by caller */
+	plan->targetlist = lefttree->targetlist;
+	plan->qual = NIL;
+	plan->lefttree = lefttree;
+	plan->righttree = NULL;
+	node->num_workers = num_workers;
+
+	return node;
+}
+
 /*
  * materialize_finished_plan: stick a Material node atop a completed plan
  *
@@ -4844,7 +5140,9 @@ is_projection_capable_plan(Plan *plan)
 	{
 		case T_Hash:
 		case T_Material:
+		case T_Gather:
 		case T_Sort:
+		case T_IncrementalSort:
 		case T_Unique:
 		case T_SetOp:
 		case T_LockRows:
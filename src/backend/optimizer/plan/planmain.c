@@ -57,7 +57,9 @@
  * Output parameters:
  * *cheapest_path receives the overall-cheapest path for the query
  * *sorted_path receives the cheapest presorted path for the query,
- *				if any (NULL if there is no useful presorted path)
+ *				if any (NULL if there is no useful presorted path).  It may
+ *				be sorted by just a leading subset of the query pathkeys, if
+ *				an incremental sort on top of it looks cheapest.
  * *num_groups receives the estimated number of groups, or 1 if query
  *				does not use grouping
  *
@@ -419,6 +421,77 @@ query_planner(PlannerInfo *root, List *tlist,
 		}
 	}
 
+	/*
+	 * If the query wants its output in an order the cheapest path doesn't
+	 * provide, a path sorted by a leading subset of the query pathkeys might
+	 * win with an incremental sort on top, particularly with a LIMIT: the
+	 * incremental sort can return its first tuples long before a full sort
+	 * has read all of its input.  grouping_planner only knows how to finish
+	 * such a path off for ORDER BY and DISTINCT, so don't bother when there
+	 * is grouping or windowing.
+	 */
+	if (enable_incrementalsort &&
+		root->query_pathkeys != NIL &&
+		root->group_pathkeys == NIL &&
+		root->window_pathkeys == NIL &&
+		!pathkeys_contained_in(root->query_pathkeys, cheapestpath->pathkeys))
+	{
+		Path	   *partialpath = NULL;
+		Path		partial_cost;	/* cost of partialpath plus its sort */
+		Path		sort_path;	/* dummy for result of cost_sort_presorted */
+		ListCell   *lc;
+
+		foreach(lc, final_rel->pathlist)
+		{
+			Path	   *path = (Path *) lfirst(lc);
+			int			presorted_keys;
+
+			if (pathkeys_count_contained_in(root->query_pathkeys,
+											path->pathkeys,
+											&presorted_keys) ||
+				presorted_keys == 0)
+				continue;
+
+			cost_incremental_sort(&sort_path, root, root->query_pathkeys,
+								  presorted_keys,
+								  path->startup_cost, path->total_cost,
+								  final_rel->rows, final_rel->width,
+								  0.0, work_mem, limit_tuples);
+			if (partialpath == NULL ||
+				compare_fractional_path_costs(&sort_path, &partial_cost,
+											  tuple_fraction) < 0)
+			{
+				partialpath = path;
+				partial_cost = sort_path;
+			}
+		}
+
+		if (partialpath != NULL)
+		{
+			/* Compare with the best of the alternatives considered above */
+			if (sortedpath == NULL)
+			{
+				cost_sort_presorted(&sort_path, root, root->query_pathkeys,
+									cheapestpath->pathkeys,
+									cheapestpath->startup_cost,
+									cheapestpath->total_cost,
+									final_rel->rows, final_rel->width,
+									limit_tuples);
+				sortedpath = &sort_path;
+			}
+
+			if (compare_fractional_path_costs(&partial_cost, sortedpath,
+											  tuple_fraction) < 0)
+				sortedpath = partialpath;
+			else if (sortedpath == &sort_path)
+				sortedpath = NULL;
+
+			/* As above, don't return the cheapest path in both guises */
+			if (sortedpath == cheapestpath)
+				sortedpath = NULL;
+		}
+	}
+
 	*cheapest_path = cheapestpath;
 	*sorted_path = sortedpath;
 }
@@ -20,6 +20,7 @@
 #include "access/htup_details.h"
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
+#include "jit/jit.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #ifdef OPTIMIZER_DEBUG
@@ -254,6 +255,9 @@ standard_planner(Query *parse, int cursorOptions, ParamListInfo boundParams)
 	result->invalItems = glob->invalItems;
 	result->nParamExec = glob->nParamExec;
 
+	/* decide whether the plan is expensive enough to be worth compiling */
+	result->jitFlags = jit_plan_flags(top_plan->total_cost);
+
 	return result;
 }
 
@@ -1711,6 +1715,8 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 
 			if (!pathkeys_contained_in(needed_pathkeys, current_pathkeys))
 			{
+				List	   *input_pathkeys = current_pathkeys;
+
 				if (list_length(root->distinct_pathkeys) >=
 					list_length(root->sort_pathkeys))
 					current_pathkeys = root->distinct_pathkeys;
@@ -1722,10 +1728,11 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 												 current_pathkeys));
 				}
 
-				result_plan = (Plan *) make_sort_from_pathkeys(root,
-															   result_plan,
+				result_plan = make_sort_from_presorted_pathkeys(root,
+																result_plan,
 															current_pathkeys,
-															   -1.0);
+															input_pathkeys,
+																-1.0);
 			}
 
 			result_plan = (Plan *) make_unique(result_plan,
@@ -1743,10 +1750,11 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 	{
 		if (!pathkeys_contained_in(root->sort_pathkeys, current_pathkeys))
 		{
-			result_plan = (Plan *) make_sort_from_pathkeys(root,
-														   result_plan,
+			result_plan = make_sort_from_presorted_pathkeys(root,
+															result_plan,
 														 root->sort_pathkeys,
-														   limit_tuples);
+															current_pathkeys,
+															limit_tuples);
 			current_pathkeys = root->sort_pathkeys;
 		}
 	}
@@ -2521,8 +2529,8 @@ choose_hashed_grouping(PlannerInfo *root,
 		return false;
 
 	/*
-	 * Don't do it if it doesn't look like the hashtable will fit into
-	 * work_mem.
+	 * Estimate the size of the hashtable, so we can charge for spilling to
+	 * disk if it doesn't look like it will fit into work_mem.
 	 */
 
 	/* Estimate per-hash-entry space at tuple width... */
@@ -2532,9 +2540,6 @@ choose_hashed_grouping(PlannerInfo *root,
 	/* plus the per-hash-entry overhead */
 	hashentrysize += hash_agg_entry_size(agg_costs->numAggs);
 
-	if (hashentrysize * dNumGroups > work_mem * 1024L)
-		return false;
-
 	/*
 	 * When we have both GROUP BY and DISTINCT, use the more-rigorous of
 	 * DISTINCT and ORDER BY as the assumed required output sort order. This
@@ -2568,6 +2573,8 @@ choose_hashed_grouping(PlannerInfo *root,
 			 numGroupCols, dNumGroups,
 			 cheapest_path->startup_cost, cheapest_path->total_cost,
 			 path_rows);
+	cost_hashagg_spill(&hashed_p, dNumGroups, hashentrysize,
+					   path_rows, path_width);
 	/* Result of hashed agg is always unsorted */
 	if (target_pathkeys)
 		cost_sort(&hashed_p, root, target_pathkeys, hashed_p.total_cost,
@@ -2693,8 +2700,8 @@ choose_hashed_distinct(PlannerInfo *root,
 		return false;
 
 	/*
-	 * Don't do it if it doesn't look like the hashtable will fit into
-	 * work_mem.
+	 * Estimate the size of the hashtable, so we can charge for spilling to
+	 * disk if it doesn't look like it will fit into work_mem.
 	 */
 
 	/* Estimate per-hash-entry space at tuple width... */
@@ -2702,9 +2709,6 @@ choose_hashed_distinct(PlannerInfo *root,
 	/* plus the per-hash-entry overhead */
 	hashentrysize += hash_agg_entry_size(0);
 
-	if (hashentrysize * dNumDistinctRows > work_mem * 1024L)
-		return false;
-
 	/*
 	 * See if the estimated cost is no more than doing it the other way. While
 	 * avoiding the need for sorted input is usually a win, the fact that the
@@ -2722,6 +2726,8 @@ choose_hashed_distinct(PlannerInfo *root,
 			 numDistinctCols, dNumDistinctRows,
 			 cheapest_startup_cost, cheapest_total_cost,
 			 path_rows);
+	cost_hashagg_spill(&hashed_p, dNumDistinctRows, hashentrysize,
+					   path_rows, path_width);
 
 	/*
 	 * Result of hashed agg is always unsorted, so if ORDER BY is present we
@@ -2752,18 +2758,19 @@ choose_hashed_distinct(PlannerInfo *root,
 			current_pathkeys = root->distinct_pathkeys;
 		else
 			current_pathkeys = root->sort_pathkeys;
-		cost_sort(&sorted_p, root, current_pathkeys, sorted_p.total_cost,
-				  path_rows, path_width,
-				  0.0, work_mem, -1.0);
+		cost_sort_presorted(&sorted_p, root, current_pathkeys, sorted_pathkeys,
+							sorted_p.startup_cost, sorted_p.total_cost,
+							path_rows, path_width, -1.0);
 	}
 	cost_group(&sorted_p, root, numDistinctCols, dNumDistinctRows,
 			   sorted_p.startup_cost, sorted_p.total_cost,
 			   path_rows);
 	if (parse->sortClause &&
 		!pathkeys_contained_in(root->sort_pathkeys, current_pathkeys))
-		cost_sort(&sorted_p, root, root->sort_pathkeys, sorted_p.total_cost,
-				  dNumDistinctRows, path_width,
-				  0.0, work_mem, limit_tuples);
+		cost_sort_presorted(&sorted_p, root, root->sort_pathkeys,
+							current_pathkeys,
+							sorted_p.startup_cost, sorted_p.total_cost,
+							dNumDistinctRows, path_width, limit_tuples);
 
 	/*
 	 * Now make the decision using the top-level tuple fraction.  First we
@@ -3554,7 +3561,7 @@ plan_cluster_use_sort(Oid tableOid, Oid indexOid)
 	comparisonCost = 2.0 * (indexExprCost.startup + indexExprCost.per_tuple);
 
 	/* Estimate the cost of seq scan + sort */
-	seqScanPath = create_seqscan_path(root, rel, NULL);
+	seqScanPath = create_seqscan_path(root, rel, NULL, 0);
 	cost_sort(&seqScanAndSortPath, root, NIL,
 			  seqScanPath->total_cost, rel->tuples, rel->width,
 			  comparisonCost, maintenance_work_mem, -1.0);
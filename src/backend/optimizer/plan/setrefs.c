@@ -587,7 +587,9 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 
 		case T_Hash:
 		case T_Material:
+		case T_Gather:
 		case T_Sort:
+		case T_IncrementalSort:
 		case T_Unique:
 		case T_SetOp:
 
@@ -783,6 +785,10 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 											  (Plan *) lfirst(l),
 											  rtoffset);
 				}
+				/* The partition pruning values contain no Vars */
+				splan->part_prune_exprs = (List *)
+					fix_scan_expr(root, (Node *) splan->part_prune_exprs,
+								  rtoffset);
 			}
 			break;
 		case T_MergeAppend:
@@ -2250,6 +2250,8 @@ finalize_plan(PlannerInfo *root, Plan *plan, Bitmapset *valid_params,
 													  valid_params,
 													  scan_params));
 				}
+				finalize_primnode((Node *) ((Append *) plan)->part_prune_exprs,
+								  &context);
 			}
 			break;
 
@@ -2366,7 +2368,9 @@ finalize_plan(PlannerInfo *root, Plan *plan, Bitmapset *valid_params,
 		case T_Hash:
 		case T_Agg:
 		case T_Material:
+		case T_Gather:
 		case T_Sort:
+		case T_IncrementalSort:
 		case T_Unique:
 		case T_SetOp:
 		case T_Group:
@@ -33,19 +33,23 @@
 #include "access/heapam.h"
 #include "access/htup_details.h"
 #include "access/sysattr.h"
+#include "catalog/partition.h"
 #include "catalog/pg_inherits_fn.h"
 #include "catalog/pg_type.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
 #include "optimizer/cost.h"
 #include "optimizer/pathnode.h"
+#include "optimizer/plancat.h"
 #include "optimizer/planmain.h"
 #include "optimizer/planner.h"
 #include "optimizer/prep.h"
 #include "optimizer/tlist.h"
 #include "parser/parse_coerce.h"
 #include "parser/parsetree.h"
+#include "storage/lmgr.h"
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
 #include "utils/selfuncs.h"
@@ -100,6 +104,12 @@ static List *generate_append_tlist(List *colTypes, List *colCollations,
 static List *generate_setop_grouplist(SetOperationStmt *op, List *targetlist);
 static void expand_inherited_rtentry(PlannerInfo *root, RangeTblEntry *rte,
 						 Index rti);
+static List *get_unpruned_partitions(PlannerInfo *root, Index rti,
+						Relation rel, LOCKMODE lockmode);
+static void expand_partitions_recurse(PlannerInfo *root, Index rti,
+						  Relation rootrel, Relation rel, List *quals,
+						  LOCKMODE lockmode, List **partOIDs);
+static bool collect_partition_quals(Node *jtnode, Index rti, List **quals);
 static void make_inh_translation_list(Relation oldrelation,
 						  Relation newrelation,
 						  Index newvarno,
@@ -1277,8 +1287,21 @@ expand_inherited_rtentry(PlannerInfo *root, RangeTblEntry *rte, Index rti)
 	else
 		lockmode = AccessShareLock;
 
-	/* Scan for all members of inheritance set, acquire needed locks */
-	inhOIDs = find_all_inheritors(parentOID, lockmode, NULL);
+	/*
+	 * Must open the parent relation to examine its tupdesc.  We need not lock
+	 * it; we assume the rewriter already did.
+	 */
+	oldrelation = heap_open(parentOID, NoLock);
+
+	/*
+	 * Scan for all members of inheritance set, acquire needed locks.  For a
+	 * partitioned table, only the partitions that can't be excluded by the
+	 * query's restrictions are included, and the others aren't even locked.
+	 */
+	if (RelationGetPartitionKey(oldrelation) != NULL)
+		inhOIDs = get_unpruned_partitions(root, rti, oldrelation, lockmode);
+	else
+		inhOIDs = find_all_inheritors(parentOID, lockmode, NULL);
 
 	/*
 	 * Check that there's at least one descendant, else treat as no-child
@@ -1287,6 +1310,7 @@ expand_inherited_rtentry(PlannerInfo *root, RangeTblEntry *rte, Index rti)
 	 */
 	if (list_length(inhOIDs) < 2)
 	{
+		heap_close(oldrelation, NoLock);
 		/* Clear flag before returning */
 		rte->inh = false;
 		return;
@@ -1300,12 +1324,6 @@ expand_inherited_rtentry(PlannerInfo *root, RangeTblEntry *rte, Index rti)
 	if (oldrc)
 		oldrc->isParent = true;
 
-	/*
-	 * Must open the parent relation to examine its tupdesc.  We need not lock
-	 * it; we assume the rewriter already did.
-	 */
-	oldrelation = heap_open(parentOID, NoLock);
-
 	/* Scan the inheritance set and expand it */
 	appinfos = NIL;
 	foreach(l, inhOIDs)
@@ -1417,6 +1435,152 @@ expand_inherited_rtentry(PlannerInfo *root, RangeTblEntry *rte, Index rti)
 	root->append_rel_list = list_concat(root->append_rel_list, appinfos);
 }
 
+/*
+ * get_unpruned_partitions
+ *		Find the members of the partition tree rooted at partitioned table
+ *		rel (which is RTE rti) that the query may need to scan, and lock
+ *		them with lockmode.
+ *
+ * The result is a list of OIDs like find_all_inheritors', starting with
+ * rel itself.  Partitions are excluded using the restriction clauses that
+ * apply directly to the RTE; see collect_partition_quals.
+ */
+static List *
+get_unpruned_partitions(PlannerInfo *root, Index rti, Relation rel,
+						LOCKMODE lockmode)
+{
+	List	   *quals = NIL;
+	List	   *result;
+
+	if (collect_partition_quals((Node *) root->parse->jointree, rti, &quals) &&
+		quals != NIL)
+	{
+		Node	   *qual;
+
+		/*
+		 * The quals haven't been preprocessed yet.  Simplify a copy of them
+		 * so that we can look for comparisons of the key with constants.
+		 */
+		qual = (Node *) make_andclause(quals);
+		qual = eval_const_expressions(root, copyObject(qual));
+		quals = make_ands_implicit((Expr *) qual);
+	}
+	else
+		quals = NIL;
+
+	result = list_make1_oid(RelationGetRelid(rel));
+	expand_partitions_recurse(root, rti, rel, rel, quals, lockmode, &result);
+
+	return result;
+}
+
+/*
+ * expand_partitions_recurse
+ *		Add the partitions of rel that can match quals, and recursively the
+ *		partitions of those that are themselves partitioned, to *partOIDs.
+ *
+ * quals refer to the columns of the root table of the tree, rootrel.
+ */
+static void
+expand_partitions_recurse(PlannerInfo *root, Index rti, Relation rootrel,
+						  Relation rel, List *quals, LOCKMODE lockmode,
+						  List **partOIDs)
+{
+	PartitionKey key = RelationGetPartitionKey(rel);
+	PartitionDesc pdesc = RelationGetPartitionDesc(rel);
+	AttrNumber *keyattnos;
+	Bitmapset  *parts;
+	int			i;
+
+	keyattnos = map_partition_key_attnos(rel, rootrel);
+	parts = get_matching_partitions(key, pdesc, rti, keyattnos, quals);
+
+	while ((i = bms_first_member(parts)) >= 0)
+	{
+		Oid			partOID = pdesc->oids[i];
+		Relation	partrel;
+
+		/*
+		 * The partitions can't change under us, since adding or removing one
+		 * requires an exclusive lock on rel.
+		 */
+		LockRelationOid(partOID, lockmode);
+		partrel = heap_open(partOID, NoLock);
+
+		*partOIDs = lappend_oid(*partOIDs, partOID);
+		if (RelationGetPartitionKey(partrel) != NULL)
+			expand_partitions_recurse(root, rti, rootrel, partrel, quals,
+									  lockmode, partOIDs);
+
+		heap_close(partrel, NoLock);
+	}
+
+	bms_free(parts);
+	pfree(keyattnos);
+}
+
+/*
+ * collect_partition_quals
+ *		Collect the qual clauses that restrict RTE rti directly, from the
+ *		join tree node jtnode down.
+ *
+ * These are the quals of the FromExprs and JoinExprs above the RTE's
+ * RangeTblRef, leaving out the join quals of outer and anti joins.  Any row
+ * of the RTE that fails one of them can't contribute to the query result,
+ * so partitions holding only such rows needn't be scanned.  Returns false if
+ * the RTE can be null-extended by an outer join, since a row that fails to
+ * join then still produces a result row.
+ */
+static bool
+collect_partition_quals(Node *jtnode, Index rti, List **quals)
+{
+	bool		found = false;
+
+	if (jtnode == NULL)
+		return false;
+	if (IsA(jtnode, RangeTblRef))
+		return ((RangeTblRef *) jtnode)->rtindex == (int) rti;
+	if (IsA(jtnode, FromExpr))
+	{
+		FromExpr   *f = (FromExpr *) jtnode;
+		ListCell   *l;
+
+		foreach(l, f->fromlist)
+		{
+			if (collect_partition_quals((Node *) lfirst(l), rti, quals))
+			{
+				found = true;
+				break;
+			}
+		}
+		if (found && f->quals != NULL)
+			*quals = lappend(*quals, f->quals);
+	}
+	else if (IsA(jtnode, JoinExpr))
+	{
+		JoinExpr   *j = (JoinExpr *) jtnode;
+
+		switch (j->jointype)
+		{
+			case JOIN_INNER:
+			case JOIN_SEMI:
+				found = (collect_partition_quals(j->larg, rti, quals) ||
+						 collect_partition_quals(j->rarg, rti, quals));
+				if (found && j->quals != NULL)
+					*quals = lappend(*quals, j->quals);
+				break;
+			case JOIN_LEFT:
+			case JOIN_ANTI:
+				found = collect_partition_quals(j->larg, rti, quals);
+				break;
+			default:
+				break;
+		}
+	}
+
+	return found;
+}
+
 /*
  * make_inh_translation_list
  *	  Build the list of translations from parent Vars to child Vars for
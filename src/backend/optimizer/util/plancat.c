@@ -26,6 +26,7 @@
 #include "access/xlog.h"
 #include "catalog/catalog.h"
 #include "catalog/heap.h"
+#include "catalog/partition.h"
 #include "foreign/fdwapi.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
@@ -39,6 +40,7 @@
 #include "rewrite/rewriteManip.h"
 #include "storage/bufmgr.h"
 #include "utils/lsyscache.h"
+#include "utils/array.h"
 #include "utils/rel.h"
 #include "utils/snapmgr.h"
 
@@ -56,6 +58,14 @@ static List *get_relation_constraints(PlannerInfo *root,
 						 bool include_notnull);
 static List *build_index_tlist(PlannerInfo *root, IndexOptInfo *index,
 				  Relation heapRelation);
+static int	partition_key_column(PartitionKey key, Index varno,
+					 AttrNumber *keyattnos, Node *node);
+static bool partition_key_operator(PartitionKey key, int keycol, Oid opno,
+					   Oid inputcollid, StrategyNumber *strategy,
+					   Oid *cmpproc);
+static bool partition_clause_matches(PartitionKey key, PartitionDesc pdesc,
+						 Index varno, AttrNumber *keyattnos,
+						 Expr *clause, Bitmapset **matches);
 
 
 /*
@@ -824,6 +834,314 @@ relation_excluded_by_constraints(PlannerInfo *root,
 }
 
 
+/*
+ * get_matching_partitions
+ *
+ * Find the partitions of a partitioned table that can contain rows
+ * satisfying all of quals, an implicitly-ANDed list of const-simplified
+ * qual clauses.  The table's Vars in the quals have varno varno, and
+ * keyattnos[] gives the attribute numbers of the partition key columns in
+ * those Vars.  Returns a set of indexes into pdesc.
+ *
+ * This is the partitioned-table counterpart of constraint exclusion: rather
+ * than trying to refute each child's constraints in turn, we look up the
+ * values compared with the partition key in the sorted partition bounds.
+ */
+Bitmapset *
+get_matching_partitions(PartitionKey key, PartitionDesc pdesc, Index varno,
+						AttrNumber *keyattnos, List *quals)
+{
+	Bitmapset  *result = NULL;
+	ListCell   *lc;
+	int			i;
+
+	for (i = 0; i < pdesc->nparts; i++)
+		result = bms_add_member(result, i);
+
+	foreach(lc, quals)
+	{
+		Bitmapset  *matches;
+
+		if (!partition_clause_matches(key, pdesc, varno, keyattnos,
+									  (Expr *) lfirst(lc), &matches))
+			continue;
+		result = bms_int_members(result, matches);
+		bms_free(matches);
+		if (bms_is_empty(result))
+			break;
+	}
+
+	return result;
+}
+
+/*
+ * match_partition_key_clause
+ *
+ * Is clause of the form "key op expr" or "expr op key", where key is a
+ * partition key column and op is a btree operator of the column's operator
+ * family?  If so, return true, and set *keycol to the key column's index,
+ * *strategy to the operator's strategy (commuted if need be, so that the key
+ * is on the left), *cmpproc to the btree comparison function to use with
+ * get_partitions_for_strategy, and *expr to the other side of the clause.
+ * Nothing is checked about expr; that's up to the caller.
+ */
+bool
+match_partition_key_clause(PartitionKey key, Index varno,
+						   AttrNumber *keyattnos, Expr *clause,
+						   int *keycol, StrategyNumber *strategy,
+						   Oid *cmpproc, Expr **expr)
+{
+	Node	   *leftop;
+	Node	   *rightop;
+	Oid			opno;
+	int			i;
+
+	if (!is_opclause(clause) || list_length(((OpExpr *) clause)->args) != 2)
+		return false;
+
+	leftop = get_leftop(clause);
+	rightop = get_rightop(clause);
+	opno = ((OpExpr *) clause)->opno;
+
+	if ((i = partition_key_column(key, varno, keyattnos, leftop)) >= 0)
+		*expr = (Expr *) rightop;
+	else if ((i = partition_key_column(key, varno, keyattnos, rightop)) >= 0)
+	{
+		*expr = (Expr *) leftop;
+		opno = get_commutator(opno);
+		if (!OidIsValid(opno))
+			return false;
+	}
+	else
+		return false;
+
+	if (!partition_key_operator(key, i, opno,
+								((OpExpr *) clause)->inputcollid,
+								strategy, cmpproc))
+		return false;
+
+	*keycol = i;
+	return true;
+}
+
+/*
+ * partition_key_column
+ *		If node is a Var for one of the partition key columns, possibly
+ *		under a binary-compatible relabeling, return its key column index;
+ *		else -1.
+ */
+static int
+partition_key_column(PartitionKey key, Index varno, AttrNumber *keyattnos,
+					 Node *node)
+{
+	Var		   *var;
+	int			i;
+
+	if (node && IsA(node, RelabelType))
+		node = (Node *) ((RelabelType *) node)->arg;
+	if (node == NULL || !IsA(node, Var))
+		return -1;
+
+	var = (Var *) node;
+	if (var->varno != varno || var->varlevelsup != 0)
+		return -1;
+	for (i = 0; i < key->partnatts; i++)
+	{
+		if (var->varattno == keyattnos[i])
+			return i;
+	}
+	return -1;
+}
+
+/*
+ * partition_key_operator
+ *		Can "key column keycol <opno> value" be used for partition pruning?
+ *
+ * The operator must belong to the column's btree operator family with the
+ * opclass's input type on the left, and the clause must use the key's
+ * collation.
+ */
+static bool
+partition_key_operator(PartitionKey key, int keycol, Oid opno,
+					   Oid inputcollid, StrategyNumber *strategy,
+					   Oid *cmpproc)
+{
+	Oid			opfamily = key->partopfamily[keycol];
+	int			strat;
+	Oid			lefttype;
+	Oid			righttype;
+
+	if (!op_in_opfamily(opno, opfamily))
+		return false;
+	if (OidIsValid(key->partcollation[keycol]) &&
+		inputcollid != key->partcollation[keycol])
+		return false;
+
+	get_op_opfamily_properties(opno, opfamily, false,
+							   &strat, &lefttype, &righttype);
+	if (lefttype != key->partopcintype[keycol])
+		return false;
+
+	*cmpproc = get_opfamily_proc(opfamily, lefttype, righttype, BTORDER_PROC);
+	if (!OidIsValid(*cmpproc))
+		return false;
+
+	*strategy = (StrategyNumber) strat;
+	return true;
+}
+
+/*
+ * partition_clause_matches
+ *		Find the partitions that can contain rows satisfying clause.
+ *
+ * Returns false if clause can't be used to exclude any partitions.
+ * Otherwise *matches is set to the partitions that may match, and the
+ * result is true.
+ */
+static bool
+partition_clause_matches(PartitionKey key, PartitionDesc pdesc, Index varno,
+						 AttrNumber *keyattnos, Expr *clause,
+						 Bitmapset **matches)
+{
+	int			keycol;
+	StrategyNumber strategy;
+	Oid			cmpproc;
+	Expr	   *expr;
+
+	/* A constant-FALSE or NULL clause excludes everything */
+	if (IsA(clause, Const))
+	{
+		Const	   *c = (Const *) clause;
+
+		if (c->constisnull || !DatumGetBool(c->constvalue))
+		{
+			*matches = NULL;
+			return true;
+		}
+		return false;
+	}
+
+	if (and_clause((Node *) clause))
+	{
+		bool		found = false;
+		ListCell   *lc;
+
+		*matches = NULL;
+		foreach(lc, ((BoolExpr *) clause)->args)
+		{
+			Bitmapset  *argmatches;
+
+			if (!partition_clause_matches(key, pdesc, varno, keyattnos,
+										  (Expr *) lfirst(lc), &argmatches))
+				continue;
+			if (found)
+				*matches = bms_int_members(*matches, argmatches);
+			else
+				*matches = argmatches;
+			found = true;
+		}
+		return found;
+	}
+
+	if (or_clause((Node *) clause))
+	{
+		ListCell   *lc;
+
+		/* every arm must be usable, else we can't exclude anything */
+		*matches = NULL;
+		foreach(lc, ((BoolExpr *) clause)->args)
+		{
+			Bitmapset  *argmatches;
+
+			if (!partition_clause_matches(key, pdesc, varno, keyattnos,
+										  (Expr *) lfirst(lc), &argmatches))
+				return false;
+			*matches = bms_join(*matches, argmatches);
+		}
+		return true;
+	}
+
+	if (IsA(clause, NullTest))
+	{
+		NullTest   *ntest = (NullTest *) clause;
+
+		if (ntest->nulltesttype != IS_NULL || ntest->argisrow)
+			return false;
+		keycol = partition_key_column(key, varno, keyattnos,
+									  (Node *) ntest->arg);
+		if (keycol < 0)
+			return false;
+		*matches = get_partitions_for_null(key, pdesc, keycol);
+		return true;
+	}
+
+	if (IsA(clause, ScalarArrayOpExpr))
+	{
+		ScalarArrayOpExpr *saop = (ScalarArrayOpExpr *) clause;
+		Const	   *arrayconst = (Const *) lsecond(saop->args);
+		ArrayType  *arrayval;
+		int16		elmlen;
+		bool		elmbyval;
+		char		elmalign;
+		Datum	   *elem_values;
+		bool	   *elem_nulls;
+		int			num_elems;
+		int			i;
+
+		/* Only "key op ANY (constant array)" is handled */
+		if (!saop->useOr || !IsA(arrayconst, Const))
+			return false;
+		keycol = partition_key_column(key, varno, keyattnos,
+									  (Node *) linitial(saop->args));
+		if (keycol < 0 ||
+			!partition_key_operator(key, keycol, saop->opno,
+									saop->inputcollid, &strategy, &cmpproc))
+			return false;
+
+		*matches = NULL;
+		if (arrayconst->constisnull)
+			return true;
+
+		arrayval = DatumGetArrayTypeP(arrayconst->constvalue);
+		get_typlenbyvalalign(ARR_ELEMTYPE(arrayval),
+							 &elmlen, &elmbyval, &elmalign);
+		deconstruct_array(arrayval,
+						  ARR_ELEMTYPE(arrayval),
+						  elmlen, elmbyval, elmalign,
+						  &elem_values, &elem_nulls, &num_elems);
+		for (i = 0; i < num_elems; i++)
+		{
+			/* btree operators are strict, so null elements match nothing */
+			if (elem_nulls[i])
+				continue;
+			*matches = bms_join(*matches,
+								get_partitions_for_strategy(key, pdesc, keycol,
+															strategy, cmpproc,
+															elem_values[i]));
+		}
+		return true;
+	}
+
+	if (match_partition_key_clause(key, varno, keyattnos, clause,
+								   &keycol, &strategy, &cmpproc, &expr) &&
+		IsA(expr, Const))
+	{
+		Const	   *c = (Const *) expr;
+
+		/* btree operators are strict, so a null value matches nothing */
+		if (c->constisnull)
+			*matches = NULL;
+		else
+			*matches = get_partitions_for_strategy(key, pdesc, keycol,
+												   strategy, cmpproc,
+												   c->constvalue);
+		return true;
+	}
+
+	return false;
+}
+
+
 /*
  * build_physical_tlist
  *
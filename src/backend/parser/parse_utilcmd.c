@@ -32,6 +32,7 @@
 #include "catalog/heap.h"
 #include "catalog/index.h"
 #include "catalog/namespace.h"
+#include "catalog/partition.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_constraint.h"
 #include "catalog/pg_opclass.h"
@@ -44,8 +45,10 @@
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/planner.h"
 #include "parser/analyze.h"
 #include "parser/parse_clause.h"
+#include "parser/parse_coerce.h"
 #include "parser/parse_collate.h"
 #include "parser/parse_expr.h"
 #include "parser/parse_relation.h"
@@ -123,6 +126,8 @@ static void transformConstraintAttrs(CreateStmtContext *cxt,
 						 List *constraintList);
 static void transformColumnType(CreateStmtContext *cxt, ColumnDef *column);
 static void setSchemaName(char *context_schema, char **stmt_schema_name);
+static Node *transformPartitionBoundValue(ParseState *pstate, Node *val,
+							 char *colName, Oid colType, int32 colTypmod);
 
 
 /*
@@ -2800,3 +2805,171 @@ setSchemaName(char *context_schema, char **stmt_schema_name)
 						"different from the one being created (%s)",
 						*stmt_schema_name, context_schema)));
 }
+
+/*
+ * transformPartitionBound
+ *		Transform the FOR VALUES clause of CREATE TABLE ... PARTITION OF
+ *
+ * The bound values are coerced to the types of the parent's partition key
+ * columns and reduced to Consts.
+ */
+PartitionBoundSpec *
+transformPartitionBound(ParseState *pstate, Relation parent,
+						PartitionBoundSpec *spec)
+{
+	PartitionBoundSpec *result;
+	PartitionKey key = RelationGetPartitionKey(parent);
+	ListCell   *cell;
+	int			i;
+
+	Assert(key != NULL);
+
+	result = makeNode(PartitionBoundSpec);
+	result->strategy = spec->strategy;
+	result->location = spec->location;
+
+	if (key->strategy == PARTITION_STRATEGY_LIST)
+	{
+		char	   *colname;
+
+		if (spec->strategy != PARTITION_STRATEGY_LIST)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+				  errmsg("invalid bound specification for a list partition"),
+					 parser_errposition(pstate, spec->location)));
+
+		colname = get_relid_attribute_name(RelationGetRelid(parent),
+										   key->partattrs[0]);
+		foreach(cell, spec->listdatums)
+		{
+			Node	   *value;
+
+			value = transformPartitionBoundValue(pstate, lfirst(cell),
+												 colname,
+												 key->parttypid[0],
+												 key->parttypmod[0]);
+			result->listdatums = lappend(result->listdatums, value);
+		}
+	}
+	else if (key->strategy == PARTITION_STRATEGY_RANGE)
+	{
+		List	   *bounds[2];
+		List	   *results[2] = {NIL, NIL};
+		int			j;
+
+		if (spec->strategy != PARTITION_STRATEGY_RANGE)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+				 errmsg("invalid bound specification for a range partition"),
+					 parser_errposition(pstate, spec->location)));
+
+		if (list_length(spec->lowerdatums) != key->partnatts)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+					 errmsg("FROM must specify exactly one value per partitioning column"),
+					 parser_errposition(pstate, spec->location)));
+		if (list_length(spec->upperdatums) != key->partnatts)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+					 errmsg("TO must specify exactly one value per partitioning column"),
+					 parser_errposition(pstate, spec->location)));
+
+		bounds[0] = spec->lowerdatums;
+		bounds[1] = spec->upperdatums;
+		for (j = 0; j < 2; j++)
+		{
+			PartitionRangeDatumKind prevkind = PARTITION_RANGE_DATUM_VALUE;
+
+			i = 0;
+			foreach(cell, bounds[j])
+			{
+				PartitionRangeDatum *datum = (PartitionRangeDatum *) lfirst(cell);
+				PartitionRangeDatum *newdatum;
+
+				/*
+				 * Once a bound has MINVALUE or MAXVALUE in one column, the
+				 * remaining columns can't matter, so insist that they say
+				 * the same thing.
+				 */
+				if (prevkind != PARTITION_RANGE_DATUM_VALUE &&
+					datum->kind != prevkind)
+					ereport(ERROR,
+							(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+							 prevkind == PARTITION_RANGE_DATUM_MINVALUE ?
+							 errmsg("every bound following MINVALUE must also be MINVALUE") :
+							 errmsg("every bound following MAXVALUE must also be MAXVALUE"),
+							 parser_errposition(pstate, datum->location)));
+				prevkind = datum->kind;
+
+				newdatum = makeNode(PartitionRangeDatum);
+				newdatum->kind = datum->kind;
+				newdatum->location = datum->location;
+				if (datum->kind == PARTITION_RANGE_DATUM_VALUE)
+				{
+					char	   *colname;
+					Const	   *value;
+
+					colname = get_relid_attribute_name(RelationGetRelid(parent),
+													   key->partattrs[i]);
+					value = (Const *)
+						transformPartitionBoundValue(pstate, datum->value,
+													 colname,
+													 key->parttypid[i],
+													 key->parttypmod[i]);
+					if (value->constisnull)
+						ereport(ERROR,
+								(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+								 errmsg("cannot specify NULL in range bound"),
+								 parser_errposition(pstate, datum->location)));
+					newdatum->value = (Node *) value;
+				}
+				results[j] = lappend(results[j], newdatum);
+				i++;
+			}
+		}
+		result->lowerdatums = results[0];
+		result->upperdatums = results[1];
+	}
+	else
+		elog(ERROR, "unexpected partition strategy: %d", (int) key->strategy);
+
+	return result;
+}
+
+/*
+ * transformPartitionBoundValue
+ *		Transform one value of a partition bound into a Const of the key
+ *		column's type
+ */
+static Node *
+transformPartitionBoundValue(ParseState *pstate, Node *val, char *colName,
+							 Oid colType, int32 colTypmod)
+{
+	Node	   *value;
+
+	value = transformExpr(pstate, val, EXPR_KIND_PARTITION_BOUND);
+	value = coerce_to_target_type(pstate,
+								  value, exprType(value),
+								  colType,
+								  colTypmod,
+								  COERCION_ASSIGNMENT,
+								  COERCE_IMPLICIT_CAST,
+								  -1);
+	if (value == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATATYPE_MISMATCH),
+				 errmsg("specified value cannot be cast to type %s for column \"%s\"",
+						format_type_be(colType), colName),
+				 parser_errposition(pstate, exprLocation(val))));
+
+	/* Simplify the expression, in case we had a coercion */
+	value = (Node *) expression_planner((Expr *) value);
+	if (!IsA(value, Const))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+				 errmsg("partition bound for column \"%s\" is not a constant",
+						colName),
+				 parser_errposition(pstate, exprLocation(val))));
+
+	return value;
+}
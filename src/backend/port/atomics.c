@@ -0,0 +1,141 @@
+/*-------------------------------------------------------------------------
+ *
+ * atomics.c
+ *	  Non-inline parts of the atomics implementation
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/port/atomics.c
+ *
+ * NOTES
+ *	  This file provides the atomics.h functions as regular functions if
+ *	  the compiler doesn't support inlining, and the spinlock-based
+ *	  emulation used on platforms without native atomic operations.
+ *
+ *	  The emulation doesn't embed a spinlock in each variable: without TAS
+ *	  support every spinlock is a semaphore, and the number of those has to
+ *	  be known before shared memory is laid out.  Instead a fixed pool of
+ *	  NUM_ATOMICS_SPINLOCKS spinlocks is created at startup, and each
+ *	  variable uses the one its address hashes to.  No operation here takes
+ *	  more than one of them, so sharing can't deadlock.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+/* See atomics.h */
+#define ATOMICS_INCLUDE_DEFINITIONS
+
+#include "port/atomics.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+
+
+#ifndef PG_HAVE_ATOMIC_U32_SUPPORT
+
+/* the pool of spinlocks, in shared memory */
+NON_EXEC_STATIC slock_t *AtomicsSpinlocks = NULL;
+
+/* spinlock protecting the given variable */
+#define AtomicsSpinlockFor(ptr) \
+	(&AtomicsSpinlocks[((uintptr_t) (ptr) / sizeof(pg_atomic_uint32)) % \
+					   NUM_ATOMICS_SPINLOCKS])
+
+Size
+AtomicsShmemSize(void)
+{
+	return mul_size(NUM_ATOMICS_SPINLOCKS, sizeof(slock_t));
+}
+
+/*
+ * Create the spinlock pool.  Called by the postmaster (or a standalone
+ * backend) before anything initializes an atomic variable; EXEC_BACKEND
+ * children get the pointer through the backend parameters.
+ */
+void
+AtomicsShmemInit(void)
+{
+	int			i;
+
+	AtomicsSpinlocks = (slock_t *) ShmemAlloc(AtomicsShmemSize());
+	for (i = 0; i < NUM_ATOMICS_SPINLOCKS; i++)
+		SpinLockInit(&AtomicsSpinlocks[i]);
+}
+
+void
+pg_atomic_init_u32_impl(volatile pg_atomic_uint32 *ptr, uint32 val)
+{
+	Assert(AtomicsSpinlocks != NULL);
+	ptr->value = val;
+}
+
+void
+pg_atomic_write_u32_impl(volatile pg_atomic_uint32 *ptr, uint32 val)
+{
+	/*
+	 * Take the spinlock, so that a concurrent compare-exchange can't
+	 * overwrite the new value with one computed from the old one.
+	 */
+	volatile slock_t *lock = AtomicsSpinlockFor(ptr);
+
+	SpinLockAcquire(lock);
+	ptr->value = val;
+	SpinLockRelease(lock);
+}
+
+bool
+pg_atomic_compare_exchange_u32_impl(volatile pg_atomic_uint32 *ptr,
+									uint32 *expected, uint32 newval)
+{
+	volatile slock_t *lock = AtomicsSpinlockFor(ptr);
+	bool		ret;
+
+	/*
+	 * Do the work under the spinlock.  Acquiring and releasing it also
+	 * provides the full barrier semantics the caller expects.
+	 */
+	SpinLockAcquire(lock);
+
+	ret = (ptr->value == *expected);
+	if (ret)
+		ptr->value = newval;
+	else
+		*expected = ptr->value;
+
+	SpinLockRelease(lock);
+
+	return ret;
+}
+
+uint32
+pg_atomic_fetch_add_u32_impl(volatile pg_atomic_uint32 *ptr, int32 add_)
+{
+	volatile slock_t *lock = AtomicsSpinlockFor(ptr);
+	uint32		oldval;
+
+	SpinLockAcquire(lock);
+	oldval = ptr->value;
+	ptr->value += add_;
+	SpinLockRelease(lock);
+
+	return oldval;
+}
+
+#else							/* PG_HAVE_ATOMIC_U32_SUPPORT */
+
+/* native atomics need no shared state */
+Size
+AtomicsShmemSize(void)
+{
+	return 0;
+}
+
+void
+AtomicsShmemInit(void)
+{
+}
+
+#endif   /* !PG_HAVE_ATOMIC_U32_SUPPORT */
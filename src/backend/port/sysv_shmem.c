@@ -29,6 +29,7 @@
 #endif
 
 #include "miscadmin.h"
+#include "storage/fd.h"
 #include "storage/ipc.h"
 #include "storage/pg_shmem.h"
 
@@ -72,6 +73,9 @@ static void IpcMemoryDetach(int status, Datum shmaddr);
 static void IpcMemoryDelete(int status, Datum shmId);
 static PGShmemHeader *PGSharedMemoryAttach(IpcMemoryKey key,
 					 IpcMemoryId *shmid);
+#ifndef EXEC_BACKEND
+static void *CreateAnonymousSegment(Size *size);
+#endif
 
 
 /*
@@ -340,6 +344,126 @@ PGSharedMemoryIsInUse(unsigned long id1, unsigned long id2)
 	return true;
 }
 
+#ifndef EXEC_BACKEND
+
+#ifdef MAP_HUGETLB
+
+/*
+ * GetHugePageSize
+ *
+ * Return the size of the huge pages the kernel hands out by default, as
+ * reported in /proc/meminfo.  If that can't be determined, assume 2MB, which
+ * is the usual size on x86-64.
+ */
+static Size
+GetHugePageSize(void)
+{
+	Size		result = 2 * 1024 * 1024;
+	FILE	   *fp;
+	char		buf[128];
+
+	fp = AllocateFile("/proc/meminfo", "r");
+	if (fp)
+	{
+		while (fgets(buf, sizeof(buf), fp))
+		{
+			unsigned int sz;
+			char		ch;
+
+			if (sscanf(buf, "Hugepagesize: %u %c", &sz, &ch) == 2)
+			{
+				if (ch == 'k')
+					result = (Size) sz * 1024;
+				break;
+			}
+		}
+		FreeFile(fp);
+	}
+
+	return result;
+}
+#endif   /* MAP_HUGETLB */
+
+/*
+ * Creates an anonymous mmap()ed shared memory segment.
+ *
+ * Pass the requested size in *size.  This function will modify *size to the
+ * actual size of the allocation, if it ends up allocating a segment that is
+ * larger than requested.
+ */
+static void *
+CreateAnonymousSegment(Size *size)
+{
+	Size		allocsize = *size;
+	void	   *ptr = MAP_FAILED;
+	int			mmap_errno = 0;
+
+#ifndef MAP_HUGETLB
+	if (huge_pages == HUGE_PAGES_ON)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("huge pages not supported on this platform")));
+#else
+	if (huge_pages == HUGE_PAGES_ON || huge_pages == HUGE_PAGES_TRY)
+	{
+		/*
+		 * Round up the request size to a multiple of the huge page size, as
+		 * mmap() with MAP_HUGETLB requires.  The extra space isn't wasted:
+		 * the caller records the enlarged size in the segment header, so it
+		 * becomes available to ShmemAlloc.
+		 */
+		Size		hugepagesize = GetHugePageSize();
+
+		if (allocsize % hugepagesize != 0)
+			allocsize += hugepagesize - (allocsize % hugepagesize);
+
+		ptr = mmap(NULL, allocsize, PROT_READ | PROT_WRITE,
+				   PG_MMAP_FLAGS | MAP_HUGETLB, -1, 0);
+		mmap_errno = errno;
+		if (huge_pages == HUGE_PAGES_TRY && ptr == MAP_FAILED)
+			ereport(LOG,
+					(errmsg("could not map anonymous shared memory with huge pages, falling back to regular pages: %m"),
+					 errdetail("Failed system call was mmap(%lu bytes) with MAP_HUGETLB, using a huge page size of %lu bytes.",
+							   (unsigned long) allocsize,
+							   (unsigned long) hugepagesize),
+					 (mmap_errno == ENOMEM) ?
+					 errhint("Not enough huge pages were free.  Set vm.nr_hugepages "
+							 "to reserve more, or reduce PostgreSQL's shared memory "
+							 "usage.") : 0));
+	}
+#endif
+
+	if (ptr == MAP_FAILED && huge_pages != HUGE_PAGES_ON)
+	{
+		/*
+		 * use the original size, not the rounded up value, when falling back
+		 * to non-huge pages.
+		 */
+		allocsize = *size;
+		ptr = mmap(NULL, allocsize, PROT_READ | PROT_WRITE,
+				   PG_MMAP_FLAGS, -1, 0);
+		mmap_errno = errno;
+	}
+
+	if (ptr == MAP_FAILED)
+	{
+		errno = mmap_errno;
+		ereport(FATAL,
+				(errmsg("could not map anonymous shared memory: %m"),
+				 (mmap_errno == ENOMEM) ?
+				 errhint("This error usually means that PostgreSQL's request "
+					"for a shared memory segment exceeded available memory, "
+					  "swap space or huge pages. To reduce the request size "
+						 "(currently %lu bytes), reduce PostgreSQL's shared "
+					   "memory usage, perhaps by reducing shared_buffers or "
+						 "max_connections.",
+						 (unsigned long) allocsize) : 0));
+	}
+
+	*size = allocsize;
+	return ptr;
+}
+#endif   /* EXEC_BACKEND */
 
 /*
  * PGSharedMemoryCreate
@@ -386,9 +510,15 @@ PGSharedMemoryCreate(Size size, bool makePrivate, int port)
 	 * to the old method of allocating the entire segment using System V
 	 * shared memory, because there's no way to attach an mmap'd segment to a
 	 * process after exec().  Since EXEC_BACKEND is intended only for
-	 * developer use, this shouldn't be a big problem.
+	 * developer use, this shouldn't be a big problem.  Because of this,
+	 * huge_pages = on is not supported with EXEC_BACKEND either.
 	 */
-#ifndef EXEC_BACKEND
+#ifdef EXEC_BACKEND
+	if (huge_pages == HUGE_PAGES_ON)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("huge pages not supported on this platform")));
+#else
 	{
 		long		pagesize = sysconf(_SC_PAGE_SIZE);
 
@@ -409,23 +539,7 @@ PGSharedMemoryCreate(Size size, bool makePrivate, int port)
 		 * out to be false, we might need to add a run-time test here and do
 		 * this only if the running kernel supports it.
 		 */
-		AnonymousShmem = mmap(NULL, size, PROT_READ | PROT_WRITE, PG_MMAP_FLAGS,
-							  -1, 0);
-		if (AnonymousShmem == MAP_FAILED)
-		{
-			int		saved_errno = errno;
-
-			ereport(FATAL,
-					(errmsg("could not map anonymous shared memory: %m"),
-					 (saved_errno == ENOMEM) ?
-				errhint("This error usually means that PostgreSQL's request "
-					 "for a shared memory segment exceeded available memory "
-					  "or swap space. To reduce the request size (currently "
-					  "%lu bytes), reduce PostgreSQL's shared memory usage, "
-						"perhaps by reducing shared_buffers or "
-						"max_connections.",
-						(unsigned long) size) : 0));
-		}
+		AnonymousShmem = CreateAnonymousSegment(&size);
 		AnonymousShmemSize = size;
 
 		/* Now we need only allocate a minimal-sized SysV shmem block. */
@@ -131,6 +131,11 @@ PGSharedMemoryCreate(Size size, bool makePrivate, int port)
 	/* Room for a header? */
 	Assert(size > MAXALIGN(sizeof(PGShmemHeader)));
 
+	if (huge_pages == HUGE_PAGES_ON)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("huge pages not supported on this platform")));
+
 	szShareMem = GetSharedMemName();
 
 	UsedShmemSegAddr = NULL;
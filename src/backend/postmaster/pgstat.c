@@ -3,10 +3,15 @@
  *
  *	All the statistics collector stuff hacked up in one big, ugly file.
  *
- *	TODO:	- Separate collector, postmaster and backend stuff
- *			  into different files.
+ *	The statistics are kept in hash tables in shared memory: one entry per
+ *	database, and one per table or function keyed by database OID and object
+ *	OID.  Backends accumulate their counts locally and add them to the shared
+ *	entries in batches, at most once every PGSTAT_STAT_INTERVAL msec.  Readers
+ *	copy what they need into a backend-local snapshot on first access, which
+ *	is kept until the end of the transaction.  The shared tables are written
+ *	to disk at each checkpoint and read back when shared memory is created.
  *
- *			- Add some automatic call for pgstat vacuuming.
+ *	TODO:	- Add some automatic call for pgstat vacuuming.
  *
  *			- Add a pgstat config column to pg_database, so this
  *			  entire thing can be enabled/disabled on a per db basis.
@@ -22,11 +27,6 @@
 #include <fcntl.h>
 #include <sys/param.h>
 #include <sys/time.h>
-#include <sys/socket.h>
-#include <netdb.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <signal.h>
 #include <time.h>
 
 #include "pgstat.h"
@@ -36,28 +36,23 @@
 #include "access/transam.h"
 #include "access/twophase_rmgr.h"
 #include "access/xact.h"
+#include "access/xlogprefetch.h"
 #include "catalog/pg_database.h"
 #include "catalog/pg_proc.h"
-#include "lib/ilist.h"
-#include "libpq/ip.h"
 #include "libpq/libpq.h"
-#include "libpq/pqsignal.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "postmaster/autovacuum.h"
-#include "postmaster/fork_process.h"
-#include "postmaster/postmaster.h"
 #include "storage/backendid.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
-#include "storage/latch.h"
-#include "storage/pg_shmem.h"
+#include "storage/lwlock.h"
 #include "storage/procsignal.h"
+#include "storage/shmem.h"
 #include "utils/ascii.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
-#include "utils/ps_status.h"
 #include "utils/rel.h"
 #include "utils/timestamp.h"
 #include "utils/tqual.h"
@@ -75,34 +70,34 @@
  * Timer definitions.
  * ----------
  */
-#define PGSTAT_STAT_INTERVAL	500		/* Minimum time between stats file
-										 * updates; in milliseconds. */
+#define PGSTAT_STAT_INTERVAL	500		/* Minimum time between flushes of a
+										 * backend's counts to shared memory;
+										 * in milliseconds. */
 
-#define PGSTAT_RETRY_DELAY		10		/* How long to wait between checks for
-										 * a new file; in milliseconds. */
-
-#define PGSTAT_MAX_WAIT_TIME	10000	/* Maximum time to wait for a stats
-										 * file update; in milliseconds. */
-
-#define PGSTAT_INQ_INTERVAL		640		/* How often to ping the collector for
-										 * a new file; in milliseconds. */
-
-#define PGSTAT_RESTART_INTERVAL 60		/* How often to attempt to restart a
-										 * failed statistics collector; in
-										 * seconds. */
-
-#define PGSTAT_POLL_LOOP_COUNT	(PGSTAT_MAX_WAIT_TIME / PGSTAT_RETRY_DELAY)
-#define PGSTAT_INQ_LOOP_COUNT	(PGSTAT_INQ_INTERVAL / PGSTAT_RETRY_DELAY)
+#define PGSTAT_FULL_REPORT_INTERVAL	60000	/* Minimum time between warnings
+											 * that a shared hash table is
+											 * full; in milliseconds. */
 
 
 /* ----------
- * The initial size hints for the hash tables used in the collector.
+ * The initial size hints for the backend-local hash tables.
  * ----------
  */
 #define PGSTAT_DB_HASH_SIZE		16
 #define PGSTAT_TAB_HASH_SIZE	512
 #define PGSTAT_FUNCTION_HASH_SIZE	512
 
+/*
+ * Maximum number of entries in the shared hash tables.  The table and
+ * function tables hold up to max_stats_entries entries each, counting the
+ * objects of all databases together; databases are far fewer, so we allow a
+ * fraction of that for them.
+ */
+#define PGSTAT_MAX_DB_ENTRIES \
+	Max(pgstat_max_entries / 16, 4 * PGSTAT_DB_HASH_SIZE)
+#define PGSTAT_MAX_TAB_ENTRIES		pgstat_max_entries
+#define PGSTAT_MAX_FUNCTION_ENTRIES pgstat_max_entries
+
 
 /* ----------
  * GUC parameters
@@ -112,14 +107,7 @@ bool		pgstat_track_activities = false;
 bool		pgstat_track_counts = false;
 int			pgstat_track_functions = TRACK_FUNC_OFF;
 int			pgstat_track_activity_query_size = 1024;
-
-/* ----------
- * Built from GUC parameter
- * ----------
- */
-char	   *pgstat_stat_directory = NULL;
-char	   *pgstat_stat_filename = NULL;
-char	   *pgstat_stat_tmpname = NULL;
+int			pgstat_max_entries = 250000;
 
 /*
  * BgWriter global statistics counters (unused in other processes).
@@ -128,23 +116,75 @@ char	   *pgstat_stat_tmpname = NULL;
  */
 PgStat_MsgBgWriter BgWriterStats;
 
+/*
+ * SLRU statistics counters pending to be added to the shared statistics, by
+ * whatever process did the work.  We assume this inits to zeroes.
+ */
+PgStat_SLRUCounts SLRUStats[SLRU_NUM_ELEMENTS];
+bool		have_slru_stats = false;
+
+/*
+ * SLRU caches we keep statistics for, identified by the prefix of the name
+ * they pass to SimpleLruInit.  The last entry collects all other SLRUs, so
+ * it must stay last; SLRU_NUM_ELEMENTS must match the length of the list.
+ */
+static const char *const slru_names[] = {
+	"CLOG",
+	"SUBTRANS",
+	"MultiXactOffset",
+	"MultiXactMember",
+	"Async",
+	"OldSerXid",
+	"other"
+};
+
 /* ----------
- * Local data
+ * Shared-memory statistics
+ *
+ * The database entries and the cluster-wide statistics are protected by
+ * PgStatLock.  The table and function hash tables are partitioned, each
+ * partition being protected by one of the NUM_PGSTAT_PARTITIONS locks
+ * starting at FirstPgStatLock.  Nothing ever holds PgStatLock and a
+ * partition lock at the same time, and the partition locks are taken in
+ * ascending order when more than one is needed, so there's no deadlock
+ * risk.
+ *
+ * The database entries in shared memory don't use their tables and
+ * functions fields; those are only filled in in backend-local snapshots.
  * ----------
  */
-NON_EXEC_STATIC pgsocket pgStatSock = PGINVALID_SOCKET;
+typedef struct PgStat_ObjectKey
+{
+	Oid			databaseid;		/* InvalidOid for shared relations */
+	Oid			objectid;		/* table or function OID */
+} PgStat_ObjectKey;
 
-static Latch pgStatLatch;
+typedef struct PgStat_SharedTabEntry
+{
+	PgStat_ObjectKey key;		/* hash key (must be first) */
+	PgStat_StatTabEntry stats;
+} PgStat_SharedTabEntry;
 
-static struct sockaddr_storage pgStatAddr;
+typedef struct PgStat_SharedFuncEntry
+{
+	PgStat_ObjectKey key;		/* hash key (must be first) */
+	PgStat_StatFuncEntry stats;
+} PgStat_SharedFuncEntry;
 
-static time_t last_pgstat_start_time;
+#define PgStatHashPartition(hashcode) \
+	((hashcode) % NUM_PGSTAT_PARTITIONS)
+#define PgStatPartitionLock(hashcode) \
+	((LWLockId) (FirstPgStatLock + PgStatHashPartition(hashcode)))
 
-static bool pgStatRunningInCollector = false;
+static PgStat_GlobalStats *sharedGlobalStats = NULL;
+static PgStat_SLRUStats *sharedSLRUStats = NULL;
+static HTAB *pgStatSharedDBHash = NULL;
+static HTAB *pgStatSharedTabHash = NULL;
+static HTAB *pgStatSharedFuncHash = NULL;
 
 /*
  * Structures in which backends store per-table info that's waiting to be
- * sent to the collector.
+ * added to the shared statistics.
  *
  * NOTE: once allocated, TabStatusArray structures are never moved or deleted
  * for the life of the backend.  Also, we zero out the t_id fields of the
@@ -165,14 +205,14 @@ typedef struct TabStatusArray
 static TabStatusArray *pgStatTabList = NULL;
 
 /*
- * Backends store per-function info that's waiting to be sent to the collector
- * in this hash table (indexed by function OID).
+ * Backends store per-function info that's waiting to be added to the shared
+ * statistics in this hash table (indexed by function OID).
  */
 static HTAB *pgStatFunctions = NULL;
 
 /*
  * Indicates if backend has some function stats that it hasn't yet
- * sent to the collector.
+ * added to the shared statistics.
  */
 static bool have_function_stats = false;
 
@@ -208,7 +248,7 @@ typedef struct TwoPhasePgStatRecord
 } TwoPhasePgStatRecord;
 
 /*
- * Info about current "snapshot" of stats file
+ * Info about current snapshot of the shared statistics
  */
 static MemoryContext pgStatLocalContext = NULL;
 static HTAB *pgStatDBHash = NULL;
@@ -216,25 +256,16 @@ static PgBackendStatus *localBackendStatusTable = NULL;
 static int	localNumBackends = 0;
 
 /*
- * Cluster wide statistics, kept in the stats collector.
+ * Cluster wide statistics, as of the current snapshot.
  * Contains statistics that are not collected per database
  * or per table.
  */
 static PgStat_GlobalStats globalStats;
 
-/* Write request info for each database */
-typedef struct DBWriteRequest
-{
-	Oid			databaseid;		/* OID of the database to write */
-	TimestampTz request_time;	/* timestamp of the last write request */
-	slist_node	next;
-} DBWriteRequest;
-
-/* Latest statistics request times from backends */
-static slist_head last_statrequests = SLIST_STATIC_INIT(last_statrequests);
-
-static volatile bool need_exit = false;
-static volatile bool got_SIGHUP = false;
+/*
+ * SLRU statistics, as of the current snapshot.
+ */
+static PgStat_SLRUStats slruStats[SLRU_NUM_ELEMENTS];
 
 /*
  * Total time charged to functions so far in the current backend.
@@ -248,28 +279,23 @@ static instr_time total_func_time;
  * Local function forward declarations
  * ----------
  */
-#ifdef EXEC_BACKEND
-static pid_t pgstat_forkexec(void);
-#endif
-
-NON_EXEC_STATIC void PgstatCollectorMain(int argc, char *argv[]) __attribute__((noreturn));
-static void pgstat_exit(SIGNAL_ARGS);
 static void pgstat_beshutdown_hook(int code, Datum arg);
-static void pgstat_sighup_handler(SIGNAL_ARGS);
 
 static PgStat_StatDBEntry *pgstat_get_db_entry(Oid databaseid, bool create);
-static PgStat_StatTabEntry *pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry,
-					 Oid tableoid, bool create);
-static void pgstat_write_statsfiles(bool permanent, bool allDbs);
-static void pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent);
-static HTAB *pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep);
-static void pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash, bool permanent);
-static void backend_read_statsfile(void);
+static void pgstat_create_db_entry(Oid databaseid);
+static PgStat_StatTabEntry *pgstat_get_tab_entry(PgStat_ObjectKey *key,
+					 uint32 hashcode, bool create);
+static PgStat_StatFuncEntry *pgstat_get_func_entry(PgStat_ObjectKey *key,
+					  uint32 hashcode, bool create);
+static void *pgstat_shared_hash_enter(HTAB *htab, long max_entries,
+						 const void *key, uint32 hashcode, bool *found);
+static void pgstat_remove_objects(Oid databaseid, bool alldbs);
+static void pgstat_reset_slru_stats(void);
+static void pgstat_read_statsfile(void);
+static PgStat_StatDBEntry *pgstat_snapshot_db_hashes(Oid databaseid);
+static void pgstat_snapshot_stats(void);
 static void pgstat_read_current_status(void);
 
-static bool pgstat_write_statsfile_needed(void);
-static bool pgstat_db_requested(Oid databaseid);
-
 static void pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg);
 static void pgstat_send_funcstats(void);
 static HTAB *pgstat_collect_oids(Oid catalogid);
@@ -281,7 +307,6 @@ static void pgstat_setup_memcxt(void);
 static void pgstat_setheader(PgStat_MsgHdr *hdr, StatMsgType mtype);
 static void pgstat_send(void *msg, int len);
 
-static void pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len);
 static void pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len);
 static void pgstat_recv_tabpurge(PgStat_MsgTabpurge *msg, int len);
 static void pgstat_recv_dropdb(PgStat_MsgDropdb *msg, int len);
@@ -297,259 +322,92 @@ static void pgstat_recv_funcpurge(PgStat_MsgFuncpurge *msg, int len);
 static void pgstat_recv_recoveryconflict(PgStat_MsgRecoveryConflict *msg, int len);
 static void pgstat_recv_deadlock(PgStat_MsgDeadlock *msg, int len);
 static void pgstat_recv_tempfile(PgStat_MsgTempFile *msg, int len);
+static void pgstat_recv_slru(PgStat_MsgSLRU *msg, int len);
 
 /* ------------------------------------------------------------
  * Public functions called from postmaster follow
  * ------------------------------------------------------------
  */
 
-/* ----------
- * pgstat_init() -
+/*
+ * Report shared-memory space needed by CreateSharedPgStat.
+ */
+Size
+PgStatShmemSize(void)
+{
+	Size		size;
+
+	size = MAXALIGN(sizeof(PgStat_GlobalStats));
+	size = add_size(size, MAXALIGN(sizeof(slruStats)));
+	size = add_size(size, hash_estimate_size(PGSTAT_MAX_DB_ENTRIES,
+											 sizeof(PgStat_StatDBEntry)));
+	size = add_size(size, hash_estimate_size(PGSTAT_MAX_TAB_ENTRIES,
+											 sizeof(PgStat_SharedTabEntry)));
+	size = add_size(size, hash_estimate_size(PGSTAT_MAX_FUNCTION_ENTRIES,
+											 sizeof(PgStat_SharedFuncEntry)));
+	return size;
+}
+
+/*
+ * Initialize the shared statistics hash tables during postmaster startup,
+ * loading them from the stats file saved at the last checkpoint if there is
+ * one.
  *
- *	Called from postmaster at startup. Create the resources required
- *	by the statistics collector process.  If unable to do so, do not
- *	fail --- better to let the postmaster start with stats collection
- *	disabled.
- * ----------
+ * All the entries are allocated up front, and the tables are never allowed
+ * to grow beyond that (see pgstat_shared_hash_enter), so that they don't eat
+ * into the shared memory slop that the lock tables rely on.
  */
 void
-pgstat_init(void)
+CreateSharedPgStat(void)
 {
-	ACCEPT_TYPE_ARG3 alen;
-	struct addrinfo *addrs = NULL,
-			   *addr,
-				hints;
-	int			ret;
-	fd_set		rset;
-	struct timeval tv;
-	char		test_byte;
-	int			sel_res;
-	int			tries = 0;
-
-#define TESTBYTEVAL ((char) 199)
+	HASHCTL		info;
+	bool		found;
 
-	/*
-	 * Create the UDP socket for sending and receiving statistic messages
-	 */
-	hints.ai_flags = AI_PASSIVE;
-	hints.ai_family = PF_UNSPEC;
-	hints.ai_socktype = SOCK_DGRAM;
-	hints.ai_protocol = 0;
-	hints.ai_addrlen = 0;
-	hints.ai_addr = NULL;
-	hints.ai_canonname = NULL;
-	hints.ai_next = NULL;
-	ret = pg_getaddrinfo_all("localhost", NULL, &hints, &addrs);
-	if (ret || !addrs)
-	{
-		ereport(LOG,
-				(errmsg("could not resolve \"localhost\": %s",
-						gai_strerror(ret))));
-		goto startup_failed;
-	}
+	sharedGlobalStats = (PgStat_GlobalStats *)
+		ShmemInitStruct("Global Statistics", sizeof(PgStat_GlobalStats),
+						&found);
+	sharedSLRUStats = (PgStat_SLRUStats *)
+		ShmemInitStruct("SLRU Statistics", sizeof(slruStats), &found);
+
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(Oid);
+	info.entrysize = sizeof(PgStat_StatDBEntry);
+	info.hash = oid_hash;
+	pgStatSharedDBHash = ShmemInitHash("Database Statistics",
+									   PGSTAT_MAX_DB_ENTRIES,
+									   PGSTAT_MAX_DB_ENTRIES,
+									   &info,
+									   HASH_ELEM | HASH_FUNCTION);
+
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(PgStat_ObjectKey);
+	info.entrysize = sizeof(PgStat_SharedTabEntry);
+	info.hash = tag_hash;
+	info.num_partitions = NUM_PGSTAT_PARTITIONS;
+	pgStatSharedTabHash = ShmemInitHash("Table Statistics",
+										PGSTAT_MAX_TAB_ENTRIES,
+										PGSTAT_MAX_TAB_ENTRIES,
+										&info,
+									HASH_ELEM | HASH_FUNCTION | HASH_PARTITION);
+
+	info.entrysize = sizeof(PgStat_SharedFuncEntry);
+	pgStatSharedFuncHash = ShmemInitHash("Function Statistics",
+										 PGSTAT_MAX_FUNCTION_ENTRIES,
+										 PGSTAT_MAX_FUNCTION_ENTRIES,
+										 &info,
+									HASH_ELEM | HASH_FUNCTION | HASH_PARTITION);
 
-	/*
-	 * On some platforms, pg_getaddrinfo_all() may return multiple addresses
-	 * only one of which will actually work (eg, both IPv6 and IPv4 addresses
-	 * when kernel will reject IPv6).  Worse, the failure may occur at the
-	 * bind() or perhaps even connect() stage.	So we must loop through the
-	 * results till we find a working combination. We will generate LOG
-	 * messages, but no error, for bogus combinations.
-	 */
-	for (addr = addrs; addr; addr = addr->ai_next)
+	if (!found)
 	{
-#ifdef HAVE_UNIX_SOCKETS
-		/* Ignore AF_UNIX sockets, if any are returned. */
-		if (addr->ai_family == AF_UNIX)
-			continue;
-#endif
-
-		if (++tries > 1)
-			ereport(LOG,
-			(errmsg("trying another address for the statistics collector")));
-
-		/*
-		 * Create the socket.
-		 */
-		if ((pgStatSock = socket(addr->ai_family, SOCK_DGRAM, 0)) == PGINVALID_SOCKET)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-			errmsg("could not create socket for statistics collector: %m")));
-			continue;
-		}
-
-		/*
-		 * Bind it to a kernel assigned port on localhost and get the assigned
-		 * port via getsockname().
-		 */
-		if (bind(pgStatSock, addr->ai_addr, addr->ai_addrlen) < 0)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-			  errmsg("could not bind socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-
-		alen = sizeof(pgStatAddr);
-		if (getsockname(pgStatSock, (struct sockaddr *) & pgStatAddr, &alen) < 0)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("could not get address of socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-
-		/*
-		 * Connect the socket to its own address.  This saves a few cycles by
-		 * not having to respecify the target address on every send. This also
-		 * provides a kernel-level check that only packets from this same
-		 * address will be received.
-		 */
-		if (connect(pgStatSock, (struct sockaddr *) & pgStatAddr, alen) < 0)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-			errmsg("could not connect socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-
-		/*
-		 * Try to send and receive a one-byte test message on the socket. This
-		 * is to catch situations where the socket can be created but will not
-		 * actually pass data (for instance, because kernel packet filtering
-		 * rules prevent it).
-		 */
-		test_byte = TESTBYTEVAL;
-
-retry1:
-		if (send(pgStatSock, &test_byte, 1, 0) != 1)
-		{
-			if (errno == EINTR)
-				goto retry1;	/* if interrupted, just retry */
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("could not send test message on socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-
 		/*
-		 * There could possibly be a little delay before the message can be
-		 * received.  We arbitrarily allow up to half a second before deciding
-		 * it's broken.
+		 * We're the first - initialize, and load the saved statistics.
 		 */
-		for (;;)				/* need a loop to handle EINTR */
-		{
-			FD_ZERO(&rset);
-			FD_SET(pgStatSock, &rset);
-
-			tv.tv_sec = 0;
-			tv.tv_usec = 500000;
-			sel_res = select(pgStatSock + 1, &rset, NULL, NULL, &tv);
-			if (sel_res >= 0 || errno != EINTR)
-				break;
-		}
-		if (sel_res < 0)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("select() failed in statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-		if (sel_res == 0 || !FD_ISSET(pgStatSock, &rset))
-		{
-			/*
-			 * This is the case we actually think is likely, so take pains to
-			 * give a specific message for it.
-			 *
-			 * errno will not be set meaningfully here, so don't use it.
-			 */
-			ereport(LOG,
-					(errcode(ERRCODE_CONNECTION_FAILURE),
-					 errmsg("test message did not get through on socket for statistics collector")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-
-		test_byte++;			/* just make sure variable is changed */
-
-retry2:
-		if (recv(pgStatSock, &test_byte, 1, 0) != 1)
-		{
-			if (errno == EINTR)
-				goto retry2;	/* if interrupted, just retry */
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("could not receive test message on socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-
-		if (test_byte != TESTBYTEVAL)	/* strictly paranoia ... */
-		{
-			ereport(LOG,
-					(errcode(ERRCODE_INTERNAL_ERROR),
-					 errmsg("incorrect test message transmission on socket for statistics collector")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-
-		/* If we get here, we have a working socket */
-		break;
-	}
+		memset(sharedGlobalStats, 0, sizeof(PgStat_GlobalStats));
+		sharedGlobalStats->stat_reset_timestamp = GetCurrentTimestamp();
+		pgstat_reset_slru_stats();
 
-	/* Did we find a working address? */
-	if (!addr || pgStatSock == PGINVALID_SOCKET)
-		goto startup_failed;
-
-	/*
-	 * Set the socket to non-blocking IO.  This ensures that if the collector
-	 * falls behind, statistics messages will be discarded; backends won't
-	 * block waiting to send messages to the collector.
-	 */
-	if (!pg_set_noblock(pgStatSock))
-	{
-		ereport(LOG,
-				(errcode_for_socket_access(),
-				 errmsg("could not set statistics collector socket to nonblocking mode: %m")));
-		goto startup_failed;
+		pgstat_read_statsfile();
 	}
-
-	pg_freeaddrinfo_all(hints.ai_family, addrs);
-
-	return;
-
-startup_failed:
-	ereport(LOG,
-	  (errmsg("disabling statistics collector for lack of working socket")));
-
-	if (addrs)
-		pg_freeaddrinfo_all(hints.ai_family, addrs);
-
-	if (pgStatSock != PGINVALID_SOCKET)
-		closesocket(pgStatSock);
-	pgStatSock = PGINVALID_SOCKET;
-
-	/*
-	 * Adjust GUC variables to suppress useless activity, and for debugging
-	 * purposes (seeing track_counts off is a clue that we failed here). We
-	 * use PGC_S_OVERRIDE because there is no point in trying to turn it back
-	 * on from postgresql.conf without a restart.
-	 */
-	SetConfigOption("track_counts", "off", PGC_INTERNAL, PGC_S_OVERRIDE);
 }
 
 /*
@@ -570,7 +428,8 @@ pgstat_reset_remove_files(const char *directory)
 
 		/*
 		 * Skip directory entries that don't match the file names we write.
-		 * See get_dbstat_filename for the database-specific pattern.
+		 * Per-database files are no longer written, but remove any that a
+		 * previous release left behind.
 		 */
 		if (strncmp(entry->d_name, "global.", 7) == 0)
 			nchars = 7;
@@ -600,118 +459,32 @@ pgstat_reset_remove_files(const char *directory)
 /*
  * pgstat_reset_all() -
  *
- * Remove the stats files.	This is currently used only if WAL
- * recovery is needed after a crash.
+ * Discard all statistics, both in shared memory and on disk.  This is
+ * currently used only at the start of archive recovery, when the saved
+ * statistics may belong to an unrelated point in the cluster's history.
  */
 void
 pgstat_reset_all(void)
 {
-	pgstat_reset_remove_files(pgstat_stat_directory);
-	pgstat_reset_remove_files(PGSTAT_STAT_PERMANENT_DIRECTORY);
-}
-
-#ifdef EXEC_BACKEND
-
-/*
- * pgstat_forkexec() -
- *
- * Format up the arglist for, then fork and exec, statistics collector process
- */
-static pid_t
-pgstat_forkexec(void)
-{
-	char	   *av[10];
-	int			ac = 0;
-
-	av[ac++] = "postgres";
-	av[ac++] = "--forkcol";
-	av[ac++] = NULL;			/* filled in by postmaster_forkexec */
-
-	av[ac] = NULL;
-	Assert(ac < lengthof(av));
-
-	return postmaster_forkexec(ac, av);
-}
-#endif   /* EXEC_BACKEND */
-
-
-/*
- * pgstat_start() -
- *
- *	Called from postmaster at startup or after an existing collector
- *	died.  Attempt to fire up a fresh statistics collector.
- *
- *	Returns PID of child process, or 0 if fail.
- *
- *	Note: if fail, we will be called again from the postmaster main loop.
- */
-int
-pgstat_start(void)
-{
-	time_t		curtime;
-	pid_t		pgStatPid;
-
-	/*
-	 * Check that the socket is there, else pgstat_init failed and we can do
-	 * nothing useful.
-	 */
-	if (pgStatSock == PGINVALID_SOCKET)
-		return 0;
-
-	/*
-	 * Do nothing if too soon since last collector start.  This is a safety
-	 * valve to protect against continuous respawn attempts if the collector
-	 * is dying immediately at launch.	Note that since we will be re-called
-	 * from the postmaster main loop, we will get another chance later.
-	 */
-	curtime = time(NULL);
-	if ((unsigned int) (curtime - last_pgstat_start_time) <
-		(unsigned int) PGSTAT_RESTART_INTERVAL)
-		return 0;
-	last_pgstat_start_time = curtime;
-
-	/*
-	 * Okay, fork off the collector.
-	 */
-#ifdef EXEC_BACKEND
-	switch ((pgStatPid = pgstat_forkexec()))
-#else
-	switch ((pgStatPid = fork_process()))
-#endif
-	{
-		case -1:
-			ereport(LOG,
-					(errmsg("could not fork statistics collector: %m")));
-			return 0;
-
-#ifndef EXEC_BACKEND
-		case 0:
-			/* in postmaster child ... */
-			/* Close the postmaster's sockets */
-			ClosePostmasterPorts(false);
+	HASH_SEQ_STATUS hstat;
+	PgStat_StatDBEntry *dbentry;
 
-			/* Lose the postmaster's on-exit routines */
-			on_exit_reset();
+	LWLockAcquire(PgStatLock, LW_EXCLUSIVE);
 
-			/* Drop our connection to postmaster's shared memory, as well */
-			PGSharedMemoryDetach();
+	hash_seq_init(&hstat, pgStatSharedDBHash);
+	while ((dbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
+		(void) hash_search(pgStatSharedDBHash, (void *) &dbentry->databaseid,
+						   HASH_REMOVE, NULL);
 
-			PgstatCollectorMain(0, NULL);
-			break;
-#endif
+	memset(sharedGlobalStats, 0, sizeof(PgStat_GlobalStats));
+	sharedGlobalStats->stat_reset_timestamp = GetCurrentTimestamp();
+	pgstat_reset_slru_stats();
 
-		default:
-			return (int) pgStatPid;
-	}
+	LWLockRelease(PgStatLock);
 
-	/* shouldn't get here */
-	return 0;
-}
+	pgstat_remove_objects(InvalidOid, true);
 
-void
-allow_immediate_pgstat_restart(void)
-{
-	last_pgstat_start_time = 0;
+	pgstat_reset_remove_files(PGSTAT_STAT_PERMANENT_DIRECTORY);
 }
 
 /* ------------------------------------------------------------
@@ -723,8 +496,8 @@ allow_immediate_pgstat_restart(void)
 /* ----------
  * pgstat_report_stat() -
  *
- *	Called from tcop/postgres.c to send the so far collected per-table
- *	and function usage statistics to the collector.  Note that this is
+ *	Called from tcop/postgres.c to add the so far collected per-table
+ *	and function usage statistics to the shared statistics.  Note that this is
  *	called only when not within a transaction, so it is fair to use
  *	transaction stop time as an approximation of current time.
  * ----------
@@ -744,12 +517,14 @@ pgstat_report_stat(bool force)
 
 	/* Don't expend a clock check if nothing to do */
 	if ((pgStatTabList == NULL || pgStatTabList->tsa_used == 0) &&
-		!have_function_stats && !force)
+		!have_function_stats && !have_slru_stats && !force)
 		return;
 
 	/*
-	 * Don't send a message unless it's been at least PGSTAT_STAT_INTERVAL
-	 * msec since we last sent one, or the caller wants to force stats out.
+	 * Don't flush unless it's been at least PGSTAT_STAT_INTERVAL msec since
+	 * we last did, or the caller wants to force stats out.  Batching the
+	 * updates like this keeps the traffic on the shared hash tables' locks
+	 * down.
 	 */
 	now = GetCurrentTransactionStopTimestamp();
 	if (!force &&
@@ -819,6 +594,9 @@ pgstat_report_stat(bool force)
 
 	/* Now, send function statistics */
 	pgstat_send_funcstats();
+
+	/* ... and the SLRU statistics */
+	pgstat_send_slru();
 }
 
 /*
@@ -830,10 +608,6 @@ pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg)
 	int			n;
 	int			len;
 
-	/* It's unlikely we'd get here with no socket, but maybe not impossible */
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	/*
 	 * Report and reset accumulated xact commit/rollback and I/O timings
 	 * whenever we send a normal tabstat message
@@ -924,7 +698,7 @@ pgstat_send_funcstats(void)
 /* ----------
  * pgstat_vacuum_stat() -
  *
- *	Will tell the collector about objects he can get rid of.
+ *	Remove the statistics of objects that no longer exist.
  * ----------
  */
 void
@@ -939,14 +713,11 @@ pgstat_vacuum_stat(void)
 	PgStat_StatFuncEntry *funcentry;
 	int			len;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
+	 * If not done for this transaction, take a snapshot of the shared
+	 * statistics.
 	 */
-	backend_read_statsfile();
+	pgstat_snapshot_stats();
 
 	/*
 	 * Read pg_database and make a list of OIDs of all existing databases
@@ -954,8 +725,7 @@ pgstat_vacuum_stat(void)
 	htab = pgstat_collect_oids(DatabaseRelationId);
 
 	/*
-	 * Search the database hash table for dead databases and tell the
-	 * collector to drop them.
+	 * Search the database hash table for dead databases and drop them.
 	 */
 	hash_seq_init(&hstat, pgStatDBHash);
 	while ((dbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
@@ -1148,9 +918,9 @@ pgstat_collect_oids(Oid catalogid)
 /* ----------
  * pgstat_drop_database() -
  *
- *	Tell the collector that we just dropped a database.
- *	(If the message gets lost, we will still clean the dead DB eventually
- *	via future invocations of pgstat_vacuum_stat().)
+ *	Forget the statistics of a database we just dropped.  (If we fail
+ *	before getting here, pgstat_vacuum_stat() will still clean the dead
+ *	DB out eventually.)
  * ----------
  */
 void
@@ -1158,9 +928,6 @@ pgstat_drop_database(Oid databaseid)
 {
 	PgStat_MsgDropdb msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_DROPDB);
 	msg.m_databaseid = databaseid;
 	pgstat_send(&msg, sizeof(msg));
@@ -1170,9 +937,9 @@ pgstat_drop_database(Oid databaseid)
 /* ----------
  * pgstat_drop_relation() -
  *
- *	Tell the collector that we just dropped a relation.
- *	(If the message gets lost, we will still clean the dead entry eventually
- *	via future invocations of pgstat_vacuum_stat().)
+ *	Forget the statistics of a relation we just dropped.  (If we fail
+ *	before getting here, pgstat_vacuum_stat() will still clean the dead
+ *	entry out eventually.)
  *
  *	Currently not used for lack of any good place to call it; we rely
  *	entirely on pgstat_vacuum_stat() to clean out stats for dead rels.
@@ -1185,9 +952,6 @@ pgstat_drop_relation(Oid relid)
 	PgStat_MsgTabpurge msg;
 	int			len;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	msg.m_tableid[0] = relid;
 	msg.m_nentries = 1;
 
@@ -1203,7 +967,7 @@ pgstat_drop_relation(Oid relid)
 /* ----------
  * pgstat_reset_counters() -
  *
- *	Tell the statistics collector to reset counters for our database.
+ *	Reset the statistics counters for our database.
  * ----------
  */
 void
@@ -1211,9 +975,6 @@ pgstat_reset_counters(void)
 {
 	PgStat_MsgResetcounter msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	if (!superuser())
 		ereport(ERROR,
 				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
@@ -1227,7 +988,7 @@ pgstat_reset_counters(void)
 /* ----------
  * pgstat_reset_shared_counters() -
  *
- *	Tell the statistics collector to reset cluster-wide shared counters.
+ *	Reset cluster-wide shared counters.
  * ----------
  */
 void
@@ -1235,9 +996,6 @@ pgstat_reset_shared_counters(const char *target)
 {
 	PgStat_MsgResetsharedcounter msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	if (!superuser())
 		ereport(ERROR,
 				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
@@ -1245,11 +1003,19 @@ pgstat_reset_shared_counters(const char *target)
 
 	if (strcmp(target, "bgwriter") == 0)
 		msg.m_resettarget = RESET_BGWRITER;
+	else if (strcmp(target, "slru") == 0)
+		msg.m_resettarget = RESET_SLRU;
+	else if (strcmp(target, "recovery_prefetch") == 0)
+	{
+		/* these live in shared memory, no need to involve the collector */
+		XLogPrefetchResetStats();
+		return;
+	}
 	else
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 				 errmsg("unrecognized reset target: \"%s\"", target),
-				 errhint("Target must be \"bgwriter\".")));
+				 errhint("Target must be \"bgwriter\", \"slru\" or \"recovery_prefetch\".")));
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RESETSHAREDCOUNTER);
 	pgstat_send(&msg, sizeof(msg));
@@ -1258,7 +1024,7 @@ pgstat_reset_shared_counters(const char *target)
 /* ----------
  * pgstat_reset_single_counter() -
  *
- *	Tell the statistics collector to reset a single counter.
+ *	Reset the statistics counters of a single object.
  * ----------
  */
 void
@@ -1266,9 +1032,6 @@ pgstat_reset_single_counter(Oid objoid, PgStat_Single_Reset_Type type)
 {
 	PgStat_MsgResetsinglecounter msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	if (!superuser())
 		ereport(ERROR,
 				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
@@ -1295,9 +1058,6 @@ pgstat_report_autovac(Oid dboid)
 {
 	PgStat_MsgAutovacStart msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_AUTOVAC_START);
 	msg.m_databaseid = dboid;
 	msg.m_start_time = GetCurrentTimestamp();
@@ -1309,7 +1069,7 @@ pgstat_report_autovac(Oid dboid)
 /* ---------
  * pgstat_report_vacuum() -
  *
- *	Tell the collector about the table we just vacuumed.
+ *	Record the results of the VACUUM we just did on a table.
  * ---------
  */
 void
@@ -1317,7 +1077,7 @@ pgstat_report_vacuum(Oid tableoid, bool shared, PgStat_Counter tuples)
 {
 	PgStat_MsgVacuum msg;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_VACUUM);
@@ -1332,7 +1092,7 @@ pgstat_report_vacuum(Oid tableoid, bool shared, PgStat_Counter tuples)
 /* --------
  * pgstat_report_analyze() -
  *
- *	Tell the collector about the table we just analyzed.
+ *	Record the results of the ANALYZE we just did on a table.
  * --------
  */
 void
@@ -1341,7 +1101,7 @@ pgstat_report_analyze(Relation rel,
 {
 	PgStat_MsgAnalyze msg;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
 	/*
@@ -1349,10 +1109,9 @@ pgstat_report_analyze(Relation rel,
 	 * already inserted and/or deleted rows in the target table. ANALYZE will
 	 * have counted such rows as live or dead respectively. Because we will
 	 * report our counts of such rows at transaction end, we should subtract
-	 * off these counts from what we send to the collector now, else they'll
-	 * be double-counted after commit.	(This approach also ensures that the
-	 * collector ends up with the right numbers if we abort instead of
-	 * committing.)
+	 * off these counts from what we store now, else they'll be double-counted
+	 * after commit.  (This approach also ensures that the shared statistics
+	 * end up with the right numbers if we abort instead of committing.)
 	 */
 	if (rel->pgstat_info != NULL)
 	{
@@ -1383,7 +1142,7 @@ pgstat_report_analyze(Relation rel,
 /* --------
  * pgstat_report_recovery_conflict() -
  *
- *	Tell the collector about a Hot Standby recovery conflict.
+ *	Count a Hot Standby recovery conflict.
  * --------
  */
 void
@@ -1391,7 +1150,7 @@ pgstat_report_recovery_conflict(int reason)
 {
 	PgStat_MsgRecoveryConflict msg;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RECOVERYCONFLICT);
@@ -1403,7 +1162,7 @@ pgstat_report_recovery_conflict(int reason)
 /* --------
  * pgstat_report_deadlock() -
  *
- *	Tell the collector about a deadlock detected.
+ *	Count a deadlock detected.
  * --------
  */
 void
@@ -1411,7 +1170,7 @@ pgstat_report_deadlock(void)
 {
 	PgStat_MsgDeadlock msg;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_DEADLOCK);
@@ -1422,7 +1181,7 @@ pgstat_report_deadlock(void)
 /* --------
  * pgstat_report_tempfile() -
  *
- *	Tell the collector about a temporary file.
+ *	Count a temporary file.
  * --------
  */
 void
@@ -1430,7 +1189,7 @@ pgstat_report_tempfile(size_t filesize)
 {
 	PgStat_MsgTempFile msg;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TEMPFILE);
@@ -1440,43 +1199,6 @@ pgstat_report_tempfile(size_t filesize)
 }
 
 
-/* ----------
- * pgstat_ping() -
- *
- *	Send some junk data to the collector to increase traffic.
- * ----------
- */
-void
-pgstat_ping(void)
-{
-	PgStat_MsgDummy msg;
-
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_DUMMY);
-	pgstat_send(&msg, sizeof(msg));
-}
-
-/* ----------
- * pgstat_send_inquiry() -
- *
- *	Notify collector that we need fresh data.
- * ----------
- */
-static void
-pgstat_send_inquiry(TimestampTz clock_time, TimestampTz cutoff_time, Oid databaseid)
-{
-	PgStat_MsgInquiry msg;
-
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_INQUIRY);
-	msg.clock_time = clock_time;
-	msg.cutoff_time = cutoff_time;
-	msg.databaseid = databaseid;
-	pgstat_send(&msg, sizeof(msg));
-}
-
-
 /*
  * Initialize function call usage data.
  * Called by the executor before invoking a function.
@@ -1628,7 +1350,7 @@ pgstat_initstats(Relation rel)
 		return;
 	}
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 	{
 		/* We're not counting at all */
 		rel->pgstat_info = NULL;
@@ -2068,7 +1790,7 @@ AtPrepare_PgStat(void)
  *
  * All we need do here is unlink the transaction stats state from the
  * nontransactional state.	The nontransactional action counts will be
- * reported to the stats collector immediately, while the effects on live
+ * reported to the shared statistics immediately, while the effects on live
  * and dead tuple counts are preserved in the 2PC state file.
  *
  * Note: AtEOXact_PgStat is not called during PREPARE.
@@ -2159,18 +1881,18 @@ pgstat_twophase_postabort(TransactionId xid, uint16 info,
  *
  *	Support function for the SQL-callable pgstat* functions. Returns
  *	the collected statistics for one database or NULL. NULL doesn't mean
- *	that the database doesn't exist, it is just not yet known by the
- *	collector, so the caller is better off to report ZERO instead.
+ *	that the database doesn't exist, it just has no statistics entry yet,
+ *	so the caller is better off to report ZERO instead.
  * ----------
  */
 PgStat_StatDBEntry *
 pgstat_fetch_stat_dbentry(Oid dbid)
 {
 	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
+	 * If not done for this transaction, take a snapshot of the shared
+	 * statistics.
 	 */
-	backend_read_statsfile();
+	pgstat_snapshot_stats();
 
 	/*
 	 * Lookup the requested database; return NULL if not found
@@ -2186,8 +1908,8 @@ pgstat_fetch_stat_dbentry(Oid dbid)
  *
  *	Support function for the SQL-callable pgstat* functions. Returns
  *	the collected statistics for one table or NULL. NULL doesn't mean
- *	that the table doesn't exist, it is just not yet known by the
- *	collector, so the caller is better off to report ZERO instead.
+ *	that the table doesn't exist, it just has no statistics entry yet,
+ *	so the caller is better off to report ZERO instead.
  * ----------
  */
 PgStat_StatTabEntry *
@@ -2198,10 +1920,10 @@ pgstat_fetch_stat_tabentry(Oid relid)
 	PgStat_StatTabEntry *tabentry;
 
 	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
+	 * If not done for this transaction, take a snapshot of the shared
+	 * statistics.
 	 */
-	backend_read_statsfile();
+	pgstat_snapshot_stats();
 
 	/*
 	 * Lookup our database, then look in its table hash table.
@@ -2252,8 +1974,8 @@ pgstat_fetch_stat_funcentry(Oid func_id)
 	PgStat_StatDBEntry *dbentry;
 	PgStat_StatFuncEntry *funcentry = NULL;
 
-	/* load the stats file if needed */
-	backend_read_statsfile();
+	/* take a snapshot of the statistics if needed */
+	pgstat_snapshot_stats();
 
 	/* Lookup our database, then find the requested function.  */
 	dbentry = pgstat_fetch_stat_dbentry(MyDatabaseId);
@@ -2316,11 +2038,71 @@ pgstat_fetch_stat_numbackends(void)
 PgStat_GlobalStats *
 pgstat_fetch_global(void)
 {
-	backend_read_statsfile();
+	pgstat_snapshot_stats();
 
 	return &globalStats;
 }
 
+/*
+ * ---------
+ * pgstat_fetch_slru() -
+ *
+ *	Support function for the SQL-callable pgstat* functions. Returns
+ *	a pointer to the SLRU statistics array, SLRU_NUM_ELEMENTS long.
+ * ---------
+ */
+PgStat_SLRUStats *
+pgstat_fetch_slru(void)
+{
+	pgstat_snapshot_stats();
+
+	return slruStats;
+}
+
+/*
+ * ---------
+ * pgstat_slru_index() -
+ *
+ *	Determine the statistics entry for an SLRU, given the name it was
+ *	created with.  SLRUs we don't know are counted as "other".
+ * ---------
+ */
+int
+pgstat_slru_index(const char *name)
+{
+	int			i;
+
+	StaticAssertStmt(lengthof(slru_names) == SLRU_NUM_ELEMENTS,
+					 "slru_names[] and SLRU_NUM_ELEMENTS out of sync");
+
+	for (i = 0; i < SLRU_NUM_ELEMENTS - 1; i++)
+	{
+		size_t		len = strlen(slru_names[i]);
+
+		if (strncmp(name, slru_names[i], len) == 0 && name[len] == ' ')
+			return i;
+	}
+
+	return SLRU_NUM_ELEMENTS - 1;
+}
+
+/*
+ * ---------
+ * pgstat_slru_name() -
+ *
+ *	Return the name of an SLRU statistics entry, or NULL if slru_idx is out
+ *	of range.
+ * ---------
+ */
+const char *
+pgstat_slru_name(int slru_idx)
+{
+	if (slru_idx < 0 || slru_idx >= SLRU_NUM_ELEMENTS)
+		return NULL;
+
+	return slru_names[slru_idx];
+}
+
 
 /* ------------------------------------------------------------
  * Functions for management of the shared-memory PgBackendStatus array
@@ -2542,7 +2324,7 @@ pgstat_bestart(void)
 /*
  * Shut down a single backend's statistics reporting at process exit.
  *
- * Flush any remaining statistics counts out to the collector.
+ * Flush any remaining statistics counts out to shared memory.
  * Without this, operations triggered during backend exit (such as
  * temp table deletions) won't be counted.
  *
@@ -2555,7 +2337,7 @@ pgstat_beshutdown_hook(int code, Datum arg)
 
 	/*
 	 * If we got as far as discovering our own database ID, we can report what
-	 * we did to the collector.  Otherwise, we'd be sending an invalid
+	 * we did.  Otherwise, we'd be reporting under an invalid
 	 * database ID, so forget it.  (This means that accesses to pg_database
 	 * during failed backend starts might never get counted.)
 	 */
@@ -2752,7 +2534,6 @@ pgstat_read_current_status(void)
 			   *localactivity;
 	int			i;
 
-	Assert(!pgStatRunningInCollector);
 	if (localBackendStatusTable)
 		return;					/* already done */
 
@@ -2993,36 +2774,95 @@ pgstat_setheader(PgStat_MsgHdr *hdr, StatMsgType mtype)
 /* ----------
  * pgstat_send() -
  *
- *		Send out one statistics message to the collector
+ *		Apply one statistics message to the shared statistics
  * ----------
  */
 static void
 pgstat_send(void *msg, int len)
 {
-	int			rc;
+	PgStat_MsgHdr *hdr = (PgStat_MsgHdr *) msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
+	hdr->m_size = len;
 
-	((PgStat_MsgHdr *) msg)->m_size = len;
-
-	/* We'll retry after EINTR, but ignore all other failures */
-	do
+	switch (hdr->m_type)
 	{
-		rc = send(pgStatSock, msg, len, 0);
-	} while (rc < 0 && errno == EINTR);
-
-#ifdef USE_ASSERT_CHECKING
-	/* In debug builds, log send failures ... */
-	if (rc < 0)
-		elog(LOG, "could not send to statistics collector: %m");
-#endif
+		case PGSTAT_MTYPE_TABSTAT:
+			pgstat_recv_tabstat((PgStat_MsgTabstat *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_TABPURGE:
+			pgstat_recv_tabpurge((PgStat_MsgTabpurge *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_DROPDB:
+			pgstat_recv_dropdb((PgStat_MsgDropdb *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_RESETCOUNTER:
+			pgstat_recv_resetcounter((PgStat_MsgResetcounter *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_RESETSHAREDCOUNTER:
+			pgstat_recv_resetsharedcounter((PgStat_MsgResetsharedcounter *) msg,
+										   len);
+			break;
+
+		case PGSTAT_MTYPE_RESETSINGLECOUNTER:
+			pgstat_recv_resetsinglecounter((PgStat_MsgResetsinglecounter *) msg,
+										   len);
+			break;
+
+		case PGSTAT_MTYPE_AUTOVAC_START:
+			pgstat_recv_autovac((PgStat_MsgAutovacStart *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_VACUUM:
+			pgstat_recv_vacuum((PgStat_MsgVacuum *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_ANALYZE:
+			pgstat_recv_analyze((PgStat_MsgAnalyze *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_BGWRITER:
+			pgstat_recv_bgwriter((PgStat_MsgBgWriter *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_FUNCSTAT:
+			pgstat_recv_funcstat((PgStat_MsgFuncstat *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_FUNCPURGE:
+			pgstat_recv_funcpurge((PgStat_MsgFuncpurge *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_RECOVERYCONFLICT:
+			pgstat_recv_recoveryconflict((PgStat_MsgRecoveryConflict *) msg,
+										 len);
+			break;
+
+		case PGSTAT_MTYPE_DEADLOCK:
+			pgstat_recv_deadlock((PgStat_MsgDeadlock *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_TEMPFILE:
+			pgstat_recv_tempfile((PgStat_MsgTempFile *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_SLRU:
+			pgstat_recv_slru((PgStat_MsgSLRU *) msg, len);
+			break;
+
+		default:
+			elog(ERROR, "unrecognized statistics message type: %d",
+				 (int) hdr->m_type);
+	}
 }
 
 /* ----------
  * pgstat_send_bgwriter() -
  *
- *		Send bgwriter statistics to the collector
+ *		Add bgwriter statistics to the shared statistics
  * ----------
  */
 void
@@ -3033,8 +2873,8 @@ pgstat_send_bgwriter(void)
 
 	/*
 	 * This function can be called even if nothing at all has happened. In
-	 * this case, avoid sending a completely empty message to the stats
-	 * collector.
+	 * this case, avoid applying a completely empty message to the shared
+	 * statistics.
 	 */
 	if (memcmp(&BgWriterStats, &all_zeroes, sizeof(PgStat_MsgBgWriter)) == 0)
 		return;
@@ -3049,323 +2889,47 @@ pgstat_send_bgwriter(void)
 	 * Clear out the statistics buffer, so it can be re-used.
 	 */
 	MemSet(&BgWriterStats, 0, sizeof(BgWriterStats));
-}
 
+	/*
+	 * The checkpointer does most of the SLRU flushing, and never calls
+	 * pgstat_report_stat, so send its SLRU statistics from here.
+	 */
+	pgstat_send_slru();
+}
 
 /* ----------
- * PgstatCollectorMain() -
+ * pgstat_send_slru() -
  *
- *	Start up the statistics collector process.	This is the body of the
- *	postmaster child process.
- *
- *	The argc/argv parameters are valid only in EXEC_BACKEND case.
+ *		Add SLRU statistics collected by this process to the shared
+ *		statistics
  * ----------
  */
-NON_EXEC_STATIC void
-PgstatCollectorMain(int argc, char *argv[])
+void
+pgstat_send_slru(void)
 {
-	int			len;
-	PgStat_Msg	msg;
-	int			wr;
-
-	IsUnderPostmaster = true;	/* we are a postmaster subprocess now */
-
-	MyProcPid = getpid();		/* reset MyProcPid */
-
-	MyStartTime = time(NULL);	/* record Start Time for logging */
-
-	/*
-	 * If possible, make this process a group leader, so that the postmaster
-	 * can signal any child processes too.	(pgstat probably never has any
-	 * child processes, but for consistency we make all postmaster child
-	 * processes do this.)
-	 */
-#ifdef HAVE_SETSID
-	if (setsid() < 0)
-		elog(FATAL, "setsid() failed: %m");
-#endif
-
-	InitializeLatchSupport();	/* needed for latch waits */
-
-	/* Initialize private latch for use by signal handlers */
-	InitLatch(&pgStatLatch);
-
-	/*
-	 * Ignore all signals usually bound to some action in the postmaster,
-	 * except SIGHUP and SIGQUIT.  Note we don't need a SIGUSR1 handler to
-	 * support latch operations, because pgStatLatch is local not shared.
-	 */
-	pqsignal(SIGHUP, pgstat_sighup_handler);
-	pqsignal(SIGINT, SIG_IGN);
-	pqsignal(SIGTERM, SIG_IGN);
-	pqsignal(SIGQUIT, pgstat_exit);
-	pqsignal(SIGALRM, SIG_IGN);
-	pqsignal(SIGPIPE, SIG_IGN);
-	pqsignal(SIGUSR1, SIG_IGN);
-	pqsignal(SIGUSR2, SIG_IGN);
-	pqsignal(SIGCHLD, SIG_DFL);
-	pqsignal(SIGTTIN, SIG_DFL);
-	pqsignal(SIGTTOU, SIG_DFL);
-	pqsignal(SIGCONT, SIG_DFL);
-	pqsignal(SIGWINCH, SIG_DFL);
-	PG_SETMASK(&UnBlockSig);
-
-	/*
-	 * Identify myself via ps
-	 */
-	init_ps_display("stats collector process", "", "", "");
-
-	/*
-	 * Read in an existing statistics stats file or initialize the stats to
-	 * zero.
-	 */
-	pgStatRunningInCollector = true;
-	pgStatDBHash = pgstat_read_statsfiles(InvalidOid, true, true);
-
-	/*
-	 * Loop to process messages until we get SIGQUIT or detect ungraceful
-	 * death of our parent postmaster.
-	 *
-	 * For performance reasons, we don't want to do ResetLatch/WaitLatch after
-	 * every message; instead, do that only after a recv() fails to obtain a
-	 * message.  (This effectively means that if backends are sending us stuff
-	 * like mad, we won't notice postmaster death until things slack off a
-	 * bit; which seems fine.)	To do that, we have an inner loop that
-	 * iterates as long as recv() succeeds.  We do recognize got_SIGHUP inside
-	 * the inner loop, which means that such interrupts will get serviced but
-	 * the latch won't get cleared until next time there is a break in the
-	 * action.
-	 */
-	for (;;)
-	{
-		/* Clear any already-pending wakeups */
-		ResetLatch(&pgStatLatch);
-
-		/*
-		 * Quit if we get SIGQUIT from the postmaster.
-		 */
-		if (need_exit)
-			break;
-
-		/*
-		 * Inner loop iterates as long as we keep getting messages, or until
-		 * need_exit becomes set.
-		 */
-		while (!need_exit)
-		{
-			/*
-			 * Reload configuration if we got SIGHUP from the postmaster.
-			 */
-			if (got_SIGHUP)
-			{
-				got_SIGHUP = false;
-				ProcessConfigFile(PGC_SIGHUP);
-			}
-
-			/*
-			 * Write the stats file if a new request has arrived that is not
-			 * satisfied by existing file.
-			 */
-			if (pgstat_write_statsfile_needed())
-				pgstat_write_statsfiles(false, false);
-
-			/*
-			 * Try to receive and process a message.  This will not block,
-			 * since the socket is set to non-blocking mode.
-			 *
-			 * XXX On Windows, we have to force pgwin32_recv to cooperate,
-			 * despite the previous use of pg_set_noblock() on the socket.
-			 * This is extremely broken and should be fixed someday.
-			 */
-#ifdef WIN32
-			pgwin32_noblock = 1;
-#endif
-
-			len = recv(pgStatSock, (char *) &msg,
-					   sizeof(PgStat_Msg), 0);
-
-#ifdef WIN32
-			pgwin32_noblock = 0;
-#endif
-
-			if (len < 0)
-			{
-				if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
-					break;		/* out of inner loop */
-				ereport(ERROR,
-						(errcode_for_socket_access(),
-						 errmsg("could not read statistics message: %m")));
-			}
-
-			/*
-			 * We ignore messages that are smaller than our common header
-			 */
-			if (len < sizeof(PgStat_MsgHdr))
-				continue;
-
-			/*
-			 * The received length must match the length in the header
-			 */
-			if (msg.msg_hdr.m_size != len)
-				continue;
-
-			/*
-			 * O.K. - we accept this message.  Process it.
-			 */
-			switch (msg.msg_hdr.m_type)
-			{
-				case PGSTAT_MTYPE_DUMMY:
-					break;
-
-				case PGSTAT_MTYPE_INQUIRY:
-					pgstat_recv_inquiry((PgStat_MsgInquiry *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_TABSTAT:
-					pgstat_recv_tabstat((PgStat_MsgTabstat *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_TABPURGE:
-					pgstat_recv_tabpurge((PgStat_MsgTabpurge *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_DROPDB:
-					pgstat_recv_dropdb((PgStat_MsgDropdb *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_RESETCOUNTER:
-					pgstat_recv_resetcounter((PgStat_MsgResetcounter *) &msg,
-											 len);
-					break;
-
-				case PGSTAT_MTYPE_RESETSHAREDCOUNTER:
-					pgstat_recv_resetsharedcounter(
-									   (PgStat_MsgResetsharedcounter *) &msg,
-												   len);
-					break;
-
-				case PGSTAT_MTYPE_RESETSINGLECOUNTER:
-					pgstat_recv_resetsinglecounter(
-									   (PgStat_MsgResetsinglecounter *) &msg,
-												   len);
-					break;
-
-				case PGSTAT_MTYPE_AUTOVAC_START:
-					pgstat_recv_autovac((PgStat_MsgAutovacStart *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_VACUUM:
-					pgstat_recv_vacuum((PgStat_MsgVacuum *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_ANALYZE:
-					pgstat_recv_analyze((PgStat_MsgAnalyze *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_BGWRITER:
-					pgstat_recv_bgwriter((PgStat_MsgBgWriter *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_FUNCSTAT:
-					pgstat_recv_funcstat((PgStat_MsgFuncstat *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_FUNCPURGE:
-					pgstat_recv_funcpurge((PgStat_MsgFuncpurge *) &msg, len);
-					break;
+	PgStat_MsgSLRU msg;
 
-				case PGSTAT_MTYPE_RECOVERYCONFLICT:
-					pgstat_recv_recoveryconflict((PgStat_MsgRecoveryConflict *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_DEADLOCK:
-					pgstat_recv_deadlock((PgStat_MsgDeadlock *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_TEMPFILE:
-					pgstat_recv_tempfile((PgStat_MsgTempFile *) &msg, len);
-					break;
-
-				default:
-					break;
-			}
-		}						/* end of inner message-processing loop */
-
-		/* Sleep until there's something to do */
-#ifndef WIN32
-		wr = WaitLatchOrSocket(&pgStatLatch,
-					 WL_LATCH_SET | WL_POSTMASTER_DEATH | WL_SOCKET_READABLE,
-							   pgStatSock,
-							   -1L);
-#else
-
-		/*
-		 * Windows, at least in its Windows Server 2003 R2 incarnation,
-		 * sometimes loses FD_READ events.	Waking up and retrying the recv()
-		 * fixes that, so don't sleep indefinitely.  This is a crock of the
-		 * first water, but until somebody wants to debug exactly what's
-		 * happening there, this is the best we can do.  The two-second
-		 * timeout matches our pre-9.2 behavior, and needs to be short enough
-		 * to not provoke "pgstat wait timeout" complaints from
-		 * backend_read_statsfile.
-		 */
-		wr = WaitLatchOrSocket(&pgStatLatch,
-		WL_LATCH_SET | WL_POSTMASTER_DEATH | WL_SOCKET_READABLE | WL_TIMEOUT,
-							   pgStatSock,
-							   2 * 1000L /* msec */ );
-#endif
-
-		/*
-		 * Emergency bailout if postmaster has died.  This is to avoid the
-		 * necessity for manual cleanup of all postmaster children.
-		 */
-		if (wr & WL_POSTMASTER_DEATH)
-			break;
-	}							/* end of outer loop */
-
-	/*
-	 * Save the final stats to reuse at next startup.
-	 */
-	pgstat_write_statsfiles(true, true);
-
-	exit(0);
-}
-
-
-/* SIGQUIT signal handler for collector process */
-static void
-pgstat_exit(SIGNAL_ARGS)
-{
-	int			save_errno = errno;
+	if (!have_slru_stats)
+		return;
 
-	need_exit = true;
-	SetLatch(&pgStatLatch);
+	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_SLRU);
+	memcpy(msg.m_counts, SLRUStats, sizeof(SLRUStats));
+	pgstat_send(&msg, sizeof(msg));
 
-	errno = save_errno;
+	MemSet(SLRUStats, 0, sizeof(SLRUStats));
+	have_slru_stats = false;
 }
 
-/* SIGHUP handler for collector process */
-static void
-pgstat_sighup_handler(SIGNAL_ARGS)
-{
-	int			save_errno = errno;
-
-	got_SIGHUP = true;
-	SetLatch(&pgStatLatch);
-
-	errno = save_errno;
-}
 
 /*
  * Subroutine to clear stats in a database entry
  *
- * Tables and functions hashes are initialized to empty.
+ * The caller is responsible for removing the database's table and function
+ * entries, if needed.
  */
 static void
 reset_dbentry_counters(PgStat_StatDBEntry *dbentry)
 {
-	HASHCTL		hash_ctl;
-
 	dbentry->n_xact_commit = 0;
 	dbentry->n_xact_rollback = 0;
 	dbentry->n_blocks_fetched = 0;
@@ -3388,50 +2952,86 @@ reset_dbentry_counters(PgStat_StatDBEntry *dbentry)
 	dbentry->n_block_write_time = 0;
 
 	dbentry->stat_reset_timestamp = GetCurrentTimestamp();
-	dbentry->stats_timestamp = 0;
 
-	memset(&hash_ctl, 0, sizeof(hash_ctl));
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
-	hash_ctl.hash = oid_hash;
-	dbentry->tables = hash_create("Per-database table",
-								  PGSTAT_TAB_HASH_SIZE,
-								  &hash_ctl,
-								  HASH_ELEM | HASH_FUNCTION);
+	dbentry->tables = NULL;
+	dbentry->functions = NULL;
+}
 
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
-	hash_ctl.hash = oid_hash;
-	dbentry->functions = hash_create("Per-database function",
-									 PGSTAT_FUNCTION_HASH_SIZE,
-									 &hash_ctl,
-									 HASH_ELEM | HASH_FUNCTION);
+/*
+ * Find or create an entry in one of the shared statistics hash tables.
+ *
+ * New entries are only added while the table is below its size limit (see
+ * CreateSharedPgStat); beyond that, NULL is returned for objects that don't
+ * have an entry yet, and their statistics are lost.  That is not harmless:
+ * autovacuum only processes tables without statistics to prevent wraparound,
+ * so we keep warning about it, once per PGSTAT_FULL_REPORT_INTERVAL in each
+ * process.  The entry count is checked without regard to other partitions,
+ * so the limit can be exceeded by a few entries, which the slop in the
+ * shared memory size covers.
+ *
+ * The caller must hold the lock protecting the entry exclusively.
+ */
+static void *
+pgstat_shared_hash_enter(HTAB *htab, long max_entries,
+						 const void *key, uint32 hashcode, bool *found)
+{
+	static TimestampTz last_full_report = 0;
+	HASHACTION	action;
+	void	   *result;
+
+	action = (hash_get_num_entries(htab) < max_entries) ?
+		HASH_ENTER_NULL : HASH_FIND;
+	result = hash_search_with_hash_value(htab, key, hashcode, action, found);
+
+	if (result == NULL)
+	{
+		TimestampTz now = GetCurrentTimestamp();
+
+		if (last_full_report == 0 ||
+			TimestampDifferenceExceeds(last_full_report, now,
+									   PGSTAT_FULL_REPORT_INTERVAL))
+		{
+			ereport(WARNING,
+					(errcode(ERRCODE_OUT_OF_MEMORY),
+					 errmsg("statistics hash table is full"),
+					 errdetail("Statistics for objects without an entry are being discarded, and autovacuum will not process such tables except to prevent transaction ID wraparound."),
+					 errhint("Increase max_stats_entries.")));
+			last_full_report = now;
+		}
+	}
+
+	return result;
 }
 
 /*
- * Lookup the hash table entry for the specified database. If no hash
+ * Lookup the shared hash table entry for the specified database. If no hash
  * table entry exists, initialize it, if the create parameter is true.
- * Else, return NULL.
+ * Else, or if there's no room for a new entry, return NULL.
+ *
+ * The caller must hold PgStatLock, in exclusive mode if create is true.
  */
 static PgStat_StatDBEntry *
 pgstat_get_db_entry(Oid databaseid, bool create)
 {
 	PgStat_StatDBEntry *result;
 	bool		found;
-	HASHACTION	action = (create ? HASH_ENTER : HASH_FIND);
 
-	/* Lookup or create the hash table entry for this database */
-	result = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												&databaseid,
-												action, &found);
+	if (create)
+		result = (PgStat_StatDBEntry *)
+			pgstat_shared_hash_enter(pgStatSharedDBHash, PGSTAT_MAX_DB_ENTRIES,
+									 &databaseid,
+									 get_hash_value(pgStatSharedDBHash,
+													&databaseid),
+									 &found);
+	else
+		result = (PgStat_StatDBEntry *) hash_search(pgStatSharedDBHash,
+													&databaseid,
+													HASH_FIND, &found);
 
-	if (!create && !found)
+	if (result == NULL)
 		return NULL;
 
-	/*
-	 * If not found, initialize the new one.  This creates empty hash tables
-	 * for tables and functions, too.
-	 */
+	/* If not found, initialize the new one. */
 	if (!found)
 		reset_dbentry_counters(result);
 
@@ -3440,79 +3040,198 @@ pgstat_get_db_entry(Oid databaseid, bool create)
 
 
 /*
- * Lookup the hash table entry for the specified table. If no hash
+ * Lookup the shared hash table entry for the specified table. If no hash
  * table entry exists, initialize it, if the create parameter is true.
- * Else, return NULL.
+ * Else, or if there's no room for a new entry, return NULL.
+ *
+ * hashcode is the hash value of the key; the caller must hold the
+ * corresponding partition lock, in exclusive mode if create is true.
  */
 static PgStat_StatTabEntry *
-pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry, Oid tableoid, bool create)
+pgstat_get_tab_entry(PgStat_ObjectKey *key, uint32 hashcode, bool create)
 {
-	PgStat_StatTabEntry *result;
+	PgStat_SharedTabEntry *result;
 	bool		found;
-	HASHACTION	action = (create ? HASH_ENTER : HASH_FIND);
 
-	/* Lookup or create the hash table entry for this table */
-	result = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-												 &tableoid,
-												 action, &found);
+	if (create)
+		result = (PgStat_SharedTabEntry *)
+			pgstat_shared_hash_enter(pgStatSharedTabHash,
+									 PGSTAT_MAX_TAB_ENTRIES,
+									 key, hashcode, &found);
+	else
+		result = (PgStat_SharedTabEntry *)
+			hash_search_with_hash_value(pgStatSharedTabHash, key, hashcode,
+										HASH_FIND, &found);
 
-	if (!create && !found)
+	if (result == NULL)
 		return NULL;
 
 	/* If not found, initialize the new one. */
 	if (!found)
 	{
-		result->numscans = 0;
-		result->tuples_returned = 0;
-		result->tuples_fetched = 0;
-		result->tuples_inserted = 0;
-		result->tuples_updated = 0;
-		result->tuples_deleted = 0;
-		result->tuples_hot_updated = 0;
-		result->n_live_tuples = 0;
-		result->n_dead_tuples = 0;
-		result->changes_since_analyze = 0;
-		result->blocks_fetched = 0;
-		result->blocks_hit = 0;
-		result->vacuum_timestamp = 0;
-		result->vacuum_count = 0;
-		result->autovac_vacuum_timestamp = 0;
-		result->autovac_vacuum_count = 0;
-		result->analyze_timestamp = 0;
-		result->analyze_count = 0;
-		result->autovac_analyze_timestamp = 0;
-		result->autovac_analyze_count = 0;
+		memset(&result->stats, 0, sizeof(PgStat_StatTabEntry));
+		result->stats.tableid = key->objectid;
 	}
 
-	return result;
+	return &result->stats;
+}
+
+/*
+ * Same for functions.
+ */
+static PgStat_StatFuncEntry *
+pgstat_get_func_entry(PgStat_ObjectKey *key, uint32 hashcode, bool create)
+{
+	PgStat_SharedFuncEntry *result;
+	bool		found;
+
+	if (create)
+		result = (PgStat_SharedFuncEntry *)
+			pgstat_shared_hash_enter(pgStatSharedFuncHash,
+									 PGSTAT_MAX_FUNCTION_ENTRIES,
+									 key, hashcode, &found);
+	else
+		result = (PgStat_SharedFuncEntry *)
+			hash_search_with_hash_value(pgStatSharedFuncHash, key, hashcode,
+										HASH_FIND, &found);
+
+	if (result == NULL)
+		return NULL;
+
+	/* If not found, initialize the new one. */
+	if (!found)
+	{
+		memset(&result->stats, 0, sizeof(PgStat_StatFuncEntry));
+		result->stats.functionid = key->objectid;
+	}
+
+	return &result->stats;
+}
+
+/*
+ * Clear the shared SLRU statistics.  Caller must hold PgStatLock exclusively,
+ * or be initializing shared memory.
+ */
+static void
+pgstat_reset_slru_stats(void)
+{
+	TimestampTz ts = GetCurrentTimestamp();
+	int			i;
+
+	memset(sharedSLRUStats, 0, sizeof(slruStats));
+	for (i = 0; i < SLRU_NUM_ELEMENTS; i++)
+		sharedSLRUStats[i].stat_reset_timestamp = ts;
+}
+
+/*
+ * Remove the table and function entries of the given database from the
+ * shared hash tables, or those of all databases if alldbs is true.
+ */
+static void
+pgstat_remove_objects(Oid databaseid, bool alldbs)
+{
+	HASH_SEQ_STATUS hstat;
+	PgStat_ObjectKey *key;
+	int			i;
+
+	for (i = 0; i < NUM_PGSTAT_PARTITIONS; i++)
+		LWLockAcquire(FirstPgStatLock + i, LW_EXCLUSIVE);
+
+	hash_seq_init(&hstat, pgStatSharedTabHash);
+	while ((key = (PgStat_ObjectKey *) hash_seq_search(&hstat)) != NULL)
+	{
+		if (alldbs || key->databaseid == databaseid)
+			(void) hash_search(pgStatSharedTabHash, (void *) key,
+							   HASH_REMOVE, NULL);
+	}
+
+	hash_seq_init(&hstat, pgStatSharedFuncHash);
+	while ((key = (PgStat_ObjectKey *) hash_seq_search(&hstat)) != NULL)
+	{
+		if (alldbs || key->databaseid == databaseid)
+			(void) hash_search(pgStatSharedFuncHash, (void *) key,
+							   HASH_REMOVE, NULL);
+	}
+
+	for (i = NUM_PGSTAT_PARTITIONS; --i >= 0;)
+		LWLockRelease(FirstPgStatLock + i);
 }
 
 
 /* ----------
- * pgstat_write_statsfiles() -
- *		Write the global statistics file, as well as requested DB files.
+ * pgstat_write_statsfile() -
+ *		Write the shared statistics out to the permanent stats file.
  *
- *	If writing to the permanent files (happens when the collector is
- *	shutting down only), remove the temporary files so that backends
- *	starting up under a new postmaster can't read the old data before
- *	the new collector is ready.
- *
- *	When 'allDbs' is false, only the requested databases (listed in
- *	last_statrequests) will be written; otherwise, all databases will be
- *	written.
+ *	This is called at every checkpoint and restartpoint, so that the
+ *	statistics survive a shutdown or a crash.  The shared tables are copied
+ *	into local memory first, to avoid holding the locks while writing.
  * ----------
  */
-static void
-pgstat_write_statsfiles(bool permanent, bool allDbs)
+void
+pgstat_write_statsfile(void)
 {
 	HASH_SEQ_STATUS hstat;
+	PgStat_GlobalStats globals;
+	PgStat_SLRUStats slrustats[SLRU_NUM_ELEMENTS];
 	PgStat_StatDBEntry *dbentry;
+	PgStat_SharedTabEntry *tabentry;
+	PgStat_SharedFuncEntry *funcentry;
+	PgStat_StatDBEntry *dbentries;
+	PgStat_SharedTabEntry *tabentries;
+	PgStat_SharedFuncEntry *funcentries;
+	long		ndbentries = 0;
+	long		ntabentries = 0;
+	long		nfuncentries = 0;
+	long		i;
 	FILE	   *fpout;
 	int32		format_id;
-	const char *tmpfile = permanent ? PGSTAT_STAT_PERMANENT_TMPFILE : pgstat_stat_tmpname;
-	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
+	const char *tmpfile = PGSTAT_STAT_PERMANENT_TMPFILE;
+	const char *statfile = PGSTAT_STAT_PERMANENT_FILENAME;
 	int			rc;
 
+	/*
+	 * Copy the global and per-database statistics.
+	 */
+	LWLockAcquire(PgStatLock, LW_SHARED);
+
+	memcpy(&globals, sharedGlobalStats, sizeof(PgStat_GlobalStats));
+	memcpy(slrustats, sharedSLRUStats, sizeof(slrustats));
+
+	dbentries = (PgStat_StatDBEntry *)
+		palloc(hash_get_num_entries(pgStatSharedDBHash) *
+			   sizeof(PgStat_StatDBEntry));
+	hash_seq_init(&hstat, pgStatSharedDBHash);
+	while ((dbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
+		memcpy(&dbentries[ndbentries++], dbentry, sizeof(PgStat_StatDBEntry));
+
+	LWLockRelease(PgStatLock);
+
+	/*
+	 * Copy the table and function entries.  Holding all the partition locks
+	 * keeps the entry counts from changing underneath us.
+	 */
+	for (i = 0; i < NUM_PGSTAT_PARTITIONS; i++)
+		LWLockAcquire(FirstPgStatLock + i, LW_SHARED);
+
+	tabentries = (PgStat_SharedTabEntry *)
+		palloc(hash_get_num_entries(pgStatSharedTabHash) *
+			   sizeof(PgStat_SharedTabEntry));
+	hash_seq_init(&hstat, pgStatSharedTabHash);
+	while ((tabentry = (PgStat_SharedTabEntry *) hash_seq_search(&hstat)) != NULL)
+		memcpy(&tabentries[ntabentries++], tabentry,
+			   sizeof(PgStat_SharedTabEntry));
+
+	funcentries = (PgStat_SharedFuncEntry *)
+		palloc(hash_get_num_entries(pgStatSharedFuncHash) *
+			   sizeof(PgStat_SharedFuncEntry));
+	hash_seq_init(&hstat, pgStatSharedFuncHash);
+	while ((funcentry = (PgStat_SharedFuncEntry *) hash_seq_search(&hstat)) != NULL)
+		memcpy(&funcentries[nfuncentries++], funcentry,
+			   sizeof(PgStat_SharedFuncEntry));
+
+	for (i = NUM_PGSTAT_PARTITIONS; --i >= 0;)
+		LWLockRelease(FirstPgStatLock + i);
+
 	elog(DEBUG2, "writing statsfile '%s'", statfile);
 
 	/*
@@ -3525,16 +3244,11 @@ pgstat_write_statsfiles(bool permanent, bool allDbs)
 				(errcode_for_file_access(),
 				 errmsg("could not open temporary statistics file \"%s\": %m",
 						tmpfile)));
-		return;
+		goto done;
 	}
 
 	/*
-	 * Set the timestamp of the stats file.
-	 */
-	globalStats.stats_timestamp = GetCurrentTimestamp();
-
-	/*
-	 * Write the file header --- currently just a format ID.
+	 * Write the file header --- currently just a format ID.
 	 */
 	format_id = PGSTAT_FILE_FORMAT_ID;
 	rc = fwrite(&format_id, sizeof(format_id), 1, fpout);
@@ -3543,194 +3257,47 @@ pgstat_write_statsfiles(bool permanent, bool allDbs)
 	/*
 	 * Write global stats struct
 	 */
-	rc = fwrite(&globalStats, sizeof(globalStats), 1, fpout);
+	rc = fwrite(&globals, sizeof(globals), 1, fpout);
 	(void) rc;					/* we'll check for error with ferror */
 
 	/*
-	 * Walk through the database table.
-	 */
-	hash_seq_init(&hstat, pgStatDBHash);
-	while ((dbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
-	{
-		/*
-		 * Write out the tables and functions into the DB stat file, if
-		 * required.
-		 *
-		 * We need to do this before the dbentry write, to ensure the
-		 * timestamps written to both are consistent.
-		 */
-		if (allDbs || pgstat_db_requested(dbentry->databaseid))
-		{
-			dbentry->stats_timestamp = globalStats.stats_timestamp;
-			pgstat_write_db_statsfile(dbentry, permanent);
-		}
-
-		/*
-		 * Write out the DB entry. We don't write the tables or functions
-		 * pointers, since they're of no use to any other process.
-		 */
-		fputc('D', fpout);
-		rc = fwrite(dbentry, offsetof(PgStat_StatDBEntry, tables), 1, fpout);
-		(void) rc;				/* we'll check for error with ferror */
-	}
-
-	/*
-	 * No more output to be done. Close the temp file and replace the old
-	 * pgstat.stat with it.  The ferror() check replaces testing for error
-	 * after each individual fputc or fwrite above.
+	 * Write SLRU stats array
 	 */
-	fputc('E', fpout);
-
-	if (ferror(fpout))
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-			   errmsg("could not write temporary statistics file \"%s\": %m",
-					  tmpfile)));
-		FreeFile(fpout);
-		unlink(tmpfile);
-	}
-	else if (FreeFile(fpout) < 0)
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-			   errmsg("could not close temporary statistics file \"%s\": %m",
-					  tmpfile)));
-		unlink(tmpfile);
-	}
-	else if (rename(tmpfile, statfile) < 0)
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not rename temporary statistics file \"%s\" to \"%s\": %m",
-						tmpfile, statfile)));
-		unlink(tmpfile);
-	}
-
-	if (permanent)
-		unlink(pgstat_stat_filename);
-
-	/*
-	 * Now throw away the list of requests.  Note that requests sent after we
-	 * started the write are still waiting on the network socket.
-	 */
-	if (!slist_is_empty(&last_statrequests))
-	{
-		slist_mutable_iter iter;
-
-		/*
-		 * Strictly speaking we should do slist_delete_current() before
-		 * freeing each request struct.  We skip that and instead
-		 * re-initialize the list header at the end.  Nonetheless, we must use
-		 * slist_foreach_modify, not just slist_foreach, since we will free
-		 * the node's storage before advancing.
-		 */
-		slist_foreach_modify(iter, &last_statrequests)
-		{
-			DBWriteRequest *req;
-
-			req = slist_container(DBWriteRequest, next, iter.cur);
-			pfree(req);
-		}
-
-		slist_init(&last_statrequests);
-	}
-}
-
-/*
- * return the filename for a DB stat file; filename is the output buffer,
- * of length len.
- */
-static void
-get_dbstat_filename(bool permanent, bool tempname, Oid databaseid,
-					char *filename, int len)
-{
-	int			printed;
-
-	/* NB -- pgstat_reset_remove_files knows about the pattern this uses */
-	printed = snprintf(filename, len, "%s/db_%u.%s",
-					   permanent ? PGSTAT_STAT_PERMANENT_DIRECTORY :
-					   pgstat_stat_directory,
-					   databaseid,
-					   tempname ? "tmp" : "stat");
-	if (printed > len)
-		elog(ERROR, "overlength pgstat path");
-}
-
-/* ----------
- * pgstat_write_db_statsfile() -
- *		Write the stat file for a single database.
- *
- *	If writing to the permanent file (happens when the collector is
- *	shutting down only), remove the temporary file so that backends
- *	starting up under a new postmaster can't read the old data before
- *	the new collector is ready.
- * ----------
- */
-static void
-pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent)
-{
-	HASH_SEQ_STATUS tstat;
-	HASH_SEQ_STATUS fstat;
-	PgStat_StatTabEntry *tabentry;
-	PgStat_StatFuncEntry *funcentry;
-	FILE	   *fpout;
-	int32		format_id;
-	Oid			dbid = dbentry->databaseid;
-	int			rc;
-	char		tmpfile[MAXPGPATH];
-	char		statfile[MAXPGPATH];
-
-	get_dbstat_filename(permanent, true, dbid, tmpfile, MAXPGPATH);
-	get_dbstat_filename(permanent, false, dbid, statfile, MAXPGPATH);
-
-	elog(DEBUG2, "writing statsfile '%s'", statfile);
+	rc = fwrite(slrustats, sizeof(slrustats), 1, fpout);
+	(void) rc;					/* we'll check for error with ferror */
 
 	/*
-	 * Open the statistics temp file to write out the current values.
+	 * Write out the DB entries. We don't write the tables or functions
+	 * pointers, since they're of no use to any other process.
 	 */
-	fpout = AllocateFile(tmpfile, PG_BINARY_W);
-	if (fpout == NULL)
+	for (i = 0; i < ndbentries; i++)
 	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not open temporary statistics file \"%s\": %m",
-						tmpfile)));
-		return;
+		fputc('D', fpout);
+		rc = fwrite(&dbentries[i], offsetof(PgStat_StatDBEntry, tables), 1,
+					fpout);
+		(void) rc;				/* we'll check for error with ferror */
 	}
 
 	/*
-	 * Write the file header --- currently just a format ID.
-	 */
-	format_id = PGSTAT_FILE_FORMAT_ID;
-	rc = fwrite(&format_id, sizeof(format_id), 1, fpout);
-	(void) rc;					/* we'll check for error with ferror */
-
-	/*
-	 * Walk through the database's access stats per table.
+	 * Then the table and function entries, along with their keys.
 	 */
-	hash_seq_init(&tstat, dbentry->tables);
-	while ((tabentry = (PgStat_StatTabEntry *) hash_seq_search(&tstat)) != NULL)
+	for (i = 0; i < ntabentries; i++)
 	{
 		fputc('T', fpout);
-		rc = fwrite(tabentry, sizeof(PgStat_StatTabEntry), 1, fpout);
+		rc = fwrite(&tabentries[i], sizeof(PgStat_SharedTabEntry), 1, fpout);
 		(void) rc;				/* we'll check for error with ferror */
 	}
 
-	/*
-	 * Walk through the database's function stats table.
-	 */
-	hash_seq_init(&fstat, dbentry->functions);
-	while ((funcentry = (PgStat_StatFuncEntry *) hash_seq_search(&fstat)) != NULL)
+	for (i = 0; i < nfuncentries; i++)
 	{
 		fputc('F', fpout);
-		rc = fwrite(funcentry, sizeof(PgStat_StatFuncEntry), 1, fpout);
+		rc = fwrite(&funcentries[i], sizeof(PgStat_SharedFuncEntry), 1, fpout);
 		(void) rc;				/* we'll check for error with ferror */
 	}
 
 	/*
 	 * No more output to be done. Close the temp file and replace the old
-	 * pgstat.stat with it.  The ferror() check replaces testing for error
+	 * global.stat with it.  The ferror() check replaces testing for error
 	 * after each individual fputc or fwrite above.
 	 */
 	fputc('E', fpout);
@@ -3761,85 +3328,56 @@ pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent)
 		unlink(tmpfile);
 	}
 
-	if (permanent)
-	{
-		get_dbstat_filename(false, false, dbid, statfile, MAXPGPATH);
-
-		elog(DEBUG2, "removing temporary stat file '%s'", statfile);
-		unlink(statfile);
-	}
+done:
+	pfree(dbentries);
+	pfree(tabentries);
+	pfree(funcentries);
 }
 
+
 /* ----------
- * pgstat_read_statsfiles() -
+ * pgstat_read_statsfile() -
  *
- *	Reads in the existing statistics collector files and initializes the
- *	databases' hash table.  If the permanent file name is requested (which
- *	only happens in the stats collector itself), also remove the file after
- *	reading; the in-memory status is now authoritative, and the permanent file
- *	would be out of date in case somebody else reads it.
+ *	Load the statistics saved by pgstat_write_statsfile into the freshly
+ *	created shared hash tables.  This runs while shared memory is being
+ *	initialized, so there's no need for locking.
  *
- *	If a deep read is requested, table/function stats are read also, otherwise
- *	the table/function hash tables remain empty.
+ *	The file is left in place: it stays valid until the next checkpoint
+ *	replaces it, and we need it again if we crash before that.
  * ----------
  */
-static HTAB *
-pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
+static void
+pgstat_read_statsfile(void)
 {
-	PgStat_StatDBEntry *dbentry;
+	PgStat_GlobalStats globalbuf;
+	PgStat_SLRUStats slrubuf[SLRU_NUM_ELEMENTS];
 	PgStat_StatDBEntry dbbuf;
-	HASHCTL		hash_ctl;
-	HTAB	   *dbhash;
+	PgStat_SharedTabEntry tabbuf;
+	PgStat_SharedFuncEntry funcbuf;
+	PgStat_StatDBEntry *dbentry;
+	PgStat_SharedTabEntry *tabentry;
+	PgStat_SharedFuncEntry *funcentry;
 	FILE	   *fpin;
 	int32		format_id;
 	bool		found;
-	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
-
-	/*
-	 * The tables will live in pgStatLocalContext.
-	 */
-	pgstat_setup_memcxt();
-
-	/*
-	 * Create the DB hashtable
-	 */
-	memset(&hash_ctl, 0, sizeof(hash_ctl));
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatDBEntry);
-	hash_ctl.hash = oid_hash;
-	hash_ctl.hcxt = pgStatLocalContext;
-	dbhash = hash_create("Databases hash", PGSTAT_DB_HASH_SIZE, &hash_ctl,
-						 HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
+	const char *statfile = PGSTAT_STAT_PERMANENT_FILENAME;
 
 	/*
-	 * Clear out global statistics so they start from zero in case we can't
-	 * load an existing statsfile.
-	 */
-	memset(&globalStats, 0, sizeof(globalStats));
-
-	/*
-	 * Set the current timestamp (will be kept only in case we can't load an
-	 * existing statsfile).
-	 */
-	globalStats.stat_reset_timestamp = GetCurrentTimestamp();
-
-	/*
-	 * Try to open the stats file. If it doesn't exist, the backends simply
-	 * return zero for anything and the collector simply starts from scratch
-	 * with empty counters.
+	 * Try to open the stats file. If it doesn't exist, we simply start from
+	 * scratch with empty counters.
 	 *
-	 * ENOENT is a possibility if the stats collector is not running or has
-	 * not yet written the stats file the first time.  Any other failure
-	 * condition is suspicious.
+	 * ENOENT is a possibility if no checkpoint has been completed yet with
+	 * statistics in shared memory.  Any other failure condition is
+	 * suspicious.
 	 */
 	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
 	{
 		if (errno != ENOENT)
-			ereport(pgStatRunningInCollector ? LOG : WARNING,
+			ereport(LOG,
 					(errcode_for_file_access(),
 					 errmsg("could not open statistics file \"%s\": %m",
 							statfile)));
-		return dbhash;
+		return;
 	}
 
 	/*
@@ -3847,25 +3385,26 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 	 */
 	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
 		format_id != PGSTAT_FILE_FORMAT_ID)
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		goto done;
-	}
+		goto corrupted;
 
 	/*
 	 * Read global stats struct
 	 */
-	if (fread(&globalStats, 1, sizeof(globalStats), fpin) != sizeof(globalStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		goto done;
-	}
+	if (fread(&globalbuf, 1, sizeof(globalbuf), fpin) != sizeof(globalbuf))
+		goto corrupted;
+	memcpy(sharedGlobalStats, &globalbuf, sizeof(PgStat_GlobalStats));
+
+	/*
+	 * Read SLRU stats array
+	 */
+	if (fread(slrubuf, 1, sizeof(slrubuf), fpin) != sizeof(slrubuf))
+		goto corrupted;
+	memcpy(sharedSLRUStats, slrubuf, sizeof(slrubuf));
 
 	/*
-	 * We found an existing collector stats file. Read it and put all the
-	 * hashtable entries into place.
+	 * We found an existing stats file. Read it and put all the hashtable
+	 * entries into place.  Entries that don't fit into the tables anymore
+	 * are silently dropped.
 	 */
 	for (;;)
 	{
@@ -3878,493 +3417,233 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 			case 'D':
 				if (fread(&dbbuf, 1, offsetof(PgStat_StatDBEntry, tables),
 						  fpin) != offsetof(PgStat_StatDBEntry, tables))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				/*
-				 * Add to the DB hash
-				 */
-				dbentry = (PgStat_StatDBEntry *) hash_search(dbhash,
-												  (void *) &dbbuf.databaseid,
-															 HASH_ENTER,
-															 &found);
+					goto corrupted;
+
+				dbentry = (PgStat_StatDBEntry *)
+					pgstat_shared_hash_enter(pgStatSharedDBHash,
+											 PGSTAT_MAX_DB_ENTRIES,
+											 &dbbuf.databaseid,
+											 get_hash_value(pgStatSharedDBHash,
+														&dbbuf.databaseid),
+											 &found);
 				if (found)
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
+					goto corrupted;
+				if (dbentry == NULL)
+					break;
 
-				memcpy(dbentry, &dbbuf, sizeof(PgStat_StatDBEntry));
+				memcpy(dbentry, &dbbuf, offsetof(PgStat_StatDBEntry, tables));
 				dbentry->tables = NULL;
 				dbentry->functions = NULL;
+				break;
 
 				/*
-				 * Don't collect tables if not the requested DB (or the
-				 * shared-table info)
+				 * 'T'	A PgStat_SharedTabEntry follows.
 				 */
-				if (onlydb != InvalidOid)
-				{
-					if (dbbuf.databaseid != onlydb &&
-						dbbuf.databaseid != InvalidOid)
-						break;
-				}
-
-				memset(&hash_ctl, 0, sizeof(hash_ctl));
-				hash_ctl.keysize = sizeof(Oid);
-				hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
-				hash_ctl.hash = oid_hash;
-				hash_ctl.hcxt = pgStatLocalContext;
-				dbentry->tables = hash_create("Per-database table",
-											  PGSTAT_TAB_HASH_SIZE,
-											  &hash_ctl,
-								   HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
-
-				hash_ctl.keysize = sizeof(Oid);
-				hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
-				hash_ctl.hash = oid_hash;
-				hash_ctl.hcxt = pgStatLocalContext;
-				dbentry->functions = hash_create("Per-database function",
-												 PGSTAT_FUNCTION_HASH_SIZE,
-												 &hash_ctl,
-								   HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
+			case 'T':
+				if (fread(&tabbuf, 1, sizeof(PgStat_SharedTabEntry),
+						  fpin) != sizeof(PgStat_SharedTabEntry))
+					goto corrupted;
+
+				tabentry = (PgStat_SharedTabEntry *)
+					pgstat_shared_hash_enter(pgStatSharedTabHash,
+											 PGSTAT_MAX_TAB_ENTRIES,
+											 &tabbuf.key,
+											 get_hash_value(pgStatSharedTabHash,
+															&tabbuf.key),
+											 &found);
+				if (found)
+					goto corrupted;
+				if (tabentry != NULL)
+					memcpy(tabentry, &tabbuf, sizeof(PgStat_SharedTabEntry));
+				break;
 
 				/*
-				 * If requested, read the data from the database-specific
-				 * file. If there was onlydb specified (!= InvalidOid), we
-				 * would not get here because of a break above. So we don't
-				 * need to recheck.
+				 * 'F'	A PgStat_SharedFuncEntry follows.
 				 */
-				if (deep)
-					pgstat_read_db_statsfile(dbentry->databaseid,
-											 dbentry->tables,
-											 dbentry->functions,
-											 permanent);
-
+			case 'F':
+				if (fread(&funcbuf, 1, sizeof(PgStat_SharedFuncEntry),
+						  fpin) != sizeof(PgStat_SharedFuncEntry))
+					goto corrupted;
+
+				funcentry = (PgStat_SharedFuncEntry *)
+					pgstat_shared_hash_enter(pgStatSharedFuncHash,
+											 PGSTAT_MAX_FUNCTION_ENTRIES,
+											 &funcbuf.key,
+											 get_hash_value(pgStatSharedFuncHash,
+															&funcbuf.key),
+											 &found);
+				if (found)
+					goto corrupted;
+				if (funcentry != NULL)
+					memcpy(funcentry, &funcbuf, sizeof(PgStat_SharedFuncEntry));
 				break;
 
 			case 'E':
 				goto done;
 
 			default:
-				ereport(pgStatRunningInCollector ? LOG : WARNING,
-						(errmsg("corrupted statistics file \"%s\"",
-								statfile)));
-				goto done;
+				goto corrupted;
 		}
 	}
 
+corrupted:
+	ereport(LOG,
+			(errmsg("corrupted statistics file \"%s\"", statfile)));
+
 done:
 	FreeFile(fpin);
-
-	/* If requested to read the permanent file, also get rid of it. */
-	if (permanent)
-	{
-		elog(DEBUG2, "removing permanent stats file '%s'", statfile);
-		unlink(statfile);
-	}
-
-	return dbhash;
 }
 
 
-/* ----------
- * pgstat_read_db_statsfile() -
- *
- *	Reads in the existing statistics collector file for the given database,
- *	and initializes the tables and functions hash tables.
- *
- *	As pgstat_read_statsfiles, if the permanent file is requested, it is
- *	removed after reading.
- * ----------
+/*
+ * Subroutine for pgstat_snapshot_stats: set up the hash tables for the table
+ * and function entries of one database in the snapshot, if the database has
+ * an entry at all.
  */
-static void
-pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash,
-						 bool permanent)
+static PgStat_StatDBEntry *
+pgstat_snapshot_db_hashes(Oid databaseid)
 {
-	PgStat_StatTabEntry *tabentry;
-	PgStat_StatTabEntry tabbuf;
-	PgStat_StatFuncEntry funcbuf;
-	PgStat_StatFuncEntry *funcentry;
-	FILE	   *fpin;
-	int32		format_id;
-	bool		found;
-	char		statfile[MAXPGPATH];
-
-	get_dbstat_filename(permanent, false, databaseid, statfile, MAXPGPATH);
-
-	/*
-	 * Try to open the stats file. If it doesn't exist, the backends simply
-	 * return zero for anything and the collector simply starts from scratch
-	 * with empty counters.
-	 *
-	 * ENOENT is a possibility if the stats collector is not running or has
-	 * not yet written the stats file the first time.  Any other failure
-	 * condition is suspicious.
-	 */
-	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
-	{
-		if (errno != ENOENT)
-			ereport(pgStatRunningInCollector ? LOG : WARNING,
-					(errcode_for_file_access(),
-					 errmsg("could not open statistics file \"%s\": %m",
-							statfile)));
-		return;
-	}
-
-	/*
-	 * Verify it's of the expected format.
-	 */
-	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
-		format_id != PGSTAT_FILE_FORMAT_ID)
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		goto done;
-	}
-
-	/*
-	 * We found an existing collector stats file. Read it and put all the
-	 * hashtable entries into place.
-	 */
-	for (;;)
-	{
-		switch (fgetc(fpin))
-		{
-				/*
-				 * 'T'	A PgStat_StatTabEntry follows.
-				 */
-			case 'T':
-				if (fread(&tabbuf, 1, sizeof(PgStat_StatTabEntry),
-						  fpin) != sizeof(PgStat_StatTabEntry))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				/*
-				 * Skip if table belongs to a not requested database.
-				 */
-				if (tabhash == NULL)
-					break;
-
-				tabentry = (PgStat_StatTabEntry *) hash_search(tabhash,
-													(void *) &tabbuf.tableid,
-														 HASH_ENTER, &found);
-
-				if (found)
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				memcpy(tabentry, &tabbuf, sizeof(tabbuf));
-				break;
-
-				/*
-				 * 'F'	A PgStat_StatFuncEntry follows.
-				 */
-			case 'F':
-				if (fread(&funcbuf, 1, sizeof(PgStat_StatFuncEntry),
-						  fpin) != sizeof(PgStat_StatFuncEntry))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				/*
-				 * Skip if function belongs to a not requested database.
-				 */
-				if (funchash == NULL)
-					break;
-
-				funcentry = (PgStat_StatFuncEntry *) hash_search(funchash,
-												(void *) &funcbuf.functionid,
-														 HASH_ENTER, &found);
-
-				if (found)
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				memcpy(funcentry, &funcbuf, sizeof(funcbuf));
-				break;
-
-				/*
-				 * 'E'	The EOF marker of a complete stats file.
-				 */
-			case 'E':
-				goto done;
+	PgStat_StatDBEntry *dbentry;
+	HASHCTL		hash_ctl;
 
-			default:
-				ereport(pgStatRunningInCollector ? LOG : WARNING,
-						(errmsg("corrupted statistics file \"%s\"",
-								statfile)));
-				goto done;
-		}
-	}
+	dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
+												 (void *) &databaseid,
+												 HASH_FIND, NULL);
+	if (dbentry == NULL || dbentry->tables != NULL)
+		return dbentry;
 
-done:
-	FreeFile(fpin);
+	memset(&hash_ctl, 0, sizeof(hash_ctl));
+	hash_ctl.keysize = sizeof(Oid);
+	hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
+	hash_ctl.hash = oid_hash;
+	hash_ctl.hcxt = pgStatLocalContext;
+	dbentry->tables = hash_create("Per-database table",
+								  PGSTAT_TAB_HASH_SIZE,
+								  &hash_ctl,
+								  HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
 
-	if (permanent)
-	{
-		elog(DEBUG2, "removing permanent stats file '%s'", statfile);
-		unlink(statfile);
-	}
+	hash_ctl.keysize = sizeof(Oid);
+	hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
+	hash_ctl.hash = oid_hash;
+	hash_ctl.hcxt = pgStatLocalContext;
+	dbentry->functions = hash_create("Per-database function",
+									 PGSTAT_FUNCTION_HASH_SIZE,
+									 &hash_ctl,
+									 HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
 
-	return;
+	return dbentry;
 }
 
 /* ----------
- * pgstat_read_db_statsfile_timestamp() -
- *
- *	Attempt to determine the timestamp of the last db statfile write.
- *	Returns TRUE if successful; the timestamp is stored in *ts.
- *
- *	This needs to be careful about handling databases for which no stats file
- *	exists, such as databases without a stat entry or those not yet written:
+ * pgstat_snapshot_stats() -
  *
- *	- if there's a database entry in the global file, return the corresponding
- *	stats_timestamp value.
+ *	If not already done, copy the shared statistics into backend-local hash
+ *	tables, which are kept until the end of the transaction.
  *
- *	- if there's no db stat entry (e.g. for a new or inactive database),
- *	there's no stat_timestamp value, but also nothing to write so we return
- *	the timestamp of the global statfile.
+ *	The global statistics and all the database entries are copied.  Table and
+ *	function entries are copied only for our own database and for shared
+ *	objects; the autovacuum launcher needs none of them.
  * ----------
  */
-static bool
-pgstat_read_db_statsfile_timestamp(Oid databaseid, bool permanent,
-								   TimestampTz *ts)
+static void
+pgstat_snapshot_stats(void)
 {
-	PgStat_StatDBEntry dbentry;
-	PgStat_GlobalStats myGlobalStats;
-	FILE	   *fpin;
-	int32		format_id;
-	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
-
-	/*
-	 * Try to open the stats file.	As above, anything but ENOENT is worthy of
-	 * complaining about.
-	 */
-	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
-	{
-		if (errno != ENOENT)
-			ereport(pgStatRunningInCollector ? LOG : WARNING,
-					(errcode_for_file_access(),
-					 errmsg("could not open statistics file \"%s\": %m",
-							statfile)));
-		return false;
-	}
-
-	/*
-	 * Verify it's of the expected format.
-	 */
-	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
-		format_id != PGSTAT_FILE_FORMAT_ID)
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		FreeFile(fpin);
-		return false;
-	}
-
-	/*
-	 * Read global stats struct
-	 */
-	if (fread(&myGlobalStats, 1, sizeof(myGlobalStats),
-			  fpin) != sizeof(myGlobalStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		FreeFile(fpin);
-		return false;
-	}
+	HASH_SEQ_STATUS hstat;
+	HASHCTL		hash_ctl;
+	PgStat_StatDBEntry *shdbentry;
+	PgStat_StatDBEntry *dbentry;
+	PgStat_StatDBEntry *mydbentry;
+	PgStat_StatDBEntry *shareddbentry;
+	PgStat_SharedTabEntry *shtabentry;
+	PgStat_SharedFuncEntry *shfuncentry;
+	int			i;
 
-	/* By default, we're going to return the timestamp of the global file. */
-	*ts = myGlobalStats.stats_timestamp;
+	/* already done in this transaction? */
+	if (pgStatDBHash != NULL)
+		return;
 
 	/*
-	 * We found an existing collector stats file.  Read it and look for a
-	 * record for the requested database.  If found, use its timestamp.
+	 * The tables will live in pgStatLocalContext.
 	 */
-	for (;;)
-	{
-		switch (fgetc(fpin))
-		{
-				/*
-				 * 'D'	A PgStat_StatDBEntry struct describing a database
-				 * follows.
-				 */
-			case 'D':
-				if (fread(&dbentry, 1, offsetof(PgStat_StatDBEntry, tables),
-						  fpin) != offsetof(PgStat_StatDBEntry, tables))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
+	pgstat_setup_memcxt();
 
-				/*
-				 * If this is the DB we're looking for, save its timestamp and
-				 * we're done.
-				 */
-				if (dbentry.databaseid == databaseid)
-				{
-					*ts = dbentry.stats_timestamp;
-					goto done;
-				}
+	memset(&hash_ctl, 0, sizeof(hash_ctl));
+	hash_ctl.keysize = sizeof(Oid);
+	hash_ctl.entrysize = sizeof(PgStat_StatDBEntry);
+	hash_ctl.hash = oid_hash;
+	hash_ctl.hcxt = pgStatLocalContext;
+	pgStatDBHash = hash_create("Databases hash", PGSTAT_DB_HASH_SIZE,
+							   &hash_ctl,
+							   HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
 
-				break;
+	LWLockAcquire(PgStatLock, LW_SHARED);
 
-			case 'E':
-				goto done;
+	memcpy(&globalStats, sharedGlobalStats, sizeof(PgStat_GlobalStats));
+	memcpy(slruStats, sharedSLRUStats, sizeof(slruStats));
 
-			default:
-				ereport(pgStatRunningInCollector ? LOG : WARNING,
-						(errmsg("corrupted statistics file \"%s\"",
-								statfile)));
-				goto done;
-		}
+	hash_seq_init(&hstat, pgStatSharedDBHash);
+	while ((shdbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
+	{
+		dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
+												(void *) &shdbentry->databaseid,
+													 HASH_ENTER, NULL);
+		memcpy(dbentry, shdbentry, sizeof(PgStat_StatDBEntry));
+		dbentry->tables = NULL;
+		dbentry->functions = NULL;
 	}
 
-done:
-	FreeFile(fpin);
-	return true;
-}
-
-/*
- * If not already done, read the statistics collector stats file into
- * some hash tables.  The results will be kept until pgstat_clear_snapshot()
- * is called (typically, at end of transaction).
- */
-static void
-backend_read_statsfile(void)
-{
-	TimestampTz min_ts = 0;
-	TimestampTz ref_ts = 0;
-	int			count;
+	LWLockRelease(PgStatLock);
 
-	/* already read it? */
-	if (pgStatDBHash)
+	if (IsAutoVacuumLauncherProcess())
 		return;
-	Assert(!pgStatRunningInCollector);
-
-	/*
-	 * Loop until fresh enough stats file is available or we ran out of time.
-	 * The stats inquiry message is sent repeatedly in case collector drops
-	 * it; but not every single time, as that just swamps the collector.
-	 */
-	for (count = 0; count < PGSTAT_POLL_LOOP_COUNT; count++)
-	{
-		bool		ok;
-		TimestampTz file_ts = 0;
-		TimestampTz cur_ts;
-
-		CHECK_FOR_INTERRUPTS();
-
-		ok = pgstat_read_db_statsfile_timestamp(MyDatabaseId, false, &file_ts);
-
-		cur_ts = GetCurrentTimestamp();
-		/* Calculate min acceptable timestamp, if we didn't already */
-		if (count == 0 || cur_ts < ref_ts)
-		{
-			/*
-			 * We set the minimum acceptable timestamp to PGSTAT_STAT_INTERVAL
-			 * msec before now.  This indirectly ensures that the collector
-			 * needn't write the file more often than PGSTAT_STAT_INTERVAL. In
-			 * an autovacuum worker, however, we want a lower delay to avoid
-			 * using stale data, so we use PGSTAT_RETRY_DELAY (since the
-			 * number of workers is low, this shouldn't be a problem).
-			 *
-			 * We don't recompute min_ts after sleeping, except in the
-			 * unlikely case that cur_ts went backwards.  So we might end up
-			 * accepting a file a bit older than PGSTAT_STAT_INTERVAL.	In
-			 * practice that shouldn't happen, though, as long as the sleep
-			 * time is less than PGSTAT_STAT_INTERVAL; and we don't want to
-			 * tell the collector that our cutoff time is less than what we'd
-			 * actually accept.
-			 */
-			ref_ts = cur_ts;
-			if (IsAutoVacuumWorkerProcess())
-				min_ts = TimestampTzPlusMilliseconds(ref_ts,
-													 -PGSTAT_RETRY_DELAY);
-			else
-				min_ts = TimestampTzPlusMilliseconds(ref_ts,
-													 -PGSTAT_STAT_INTERVAL);
-		}
-
-		/*
-		 * If the file timestamp is actually newer than cur_ts, we must have
-		 * had a clock glitch (system time went backwards) or there is clock
-		 * skew between our processor and the stats collector's processor.
-		 * Accept the file, but send an inquiry message anyway to make
-		 * pgstat_recv_inquiry do a sanity check on the collector's time.
-		 */
-		if (ok && file_ts > cur_ts)
-		{
-			/*
-			 * A small amount of clock skew between processors isn't terribly
-			 * surprising, but a large difference is worth logging.  We
-			 * arbitrarily define "large" as 1000 msec.
-			 */
-			if (file_ts >= TimestampTzPlusMilliseconds(cur_ts, 1000))
-			{
-				char	   *filetime;
-				char	   *mytime;
-
-				/* Copy because timestamptz_to_str returns a static buffer */
-				filetime = pstrdup(timestamptz_to_str(file_ts));
-				mytime = pstrdup(timestamptz_to_str(cur_ts));
-				elog(LOG, "stats collector's time %s is later than backend local time %s",
-					 filetime, mytime);
-				pfree(filetime);
-				pfree(mytime);
-			}
 
-			pgstat_send_inquiry(cur_ts, min_ts, MyDatabaseId);
-			break;
-		}
+	mydbentry = pgstat_snapshot_db_hashes(MyDatabaseId);
+	shareddbentry = pgstat_snapshot_db_hashes(InvalidOid);
+	if (mydbentry == NULL && shareddbentry == NULL)
+		return;
 
-		/* Normal acceptance case: file is not older than cutoff time */
-		if (ok && file_ts >= min_ts)
-			break;
+	for (i = 0; i < NUM_PGSTAT_PARTITIONS; i++)
+		LWLockAcquire(FirstPgStatLock + i, LW_SHARED);
 
-		/* Not there or too old, so kick the collector and wait a bit */
-		if ((count % PGSTAT_INQ_LOOP_COUNT) == 0)
-			pgstat_send_inquiry(cur_ts, min_ts, MyDatabaseId);
+	hash_seq_init(&hstat, pgStatSharedTabHash);
+	while ((shtabentry = (PgStat_SharedTabEntry *) hash_seq_search(&hstat)) != NULL)
+	{
+		PgStat_StatTabEntry *tabentry;
+
+		if (shtabentry->key.databaseid == MyDatabaseId && mydbentry)
+			dbentry = mydbentry;
+		else if (shtabentry->key.databaseid == InvalidOid && shareddbentry)
+			dbentry = shareddbentry;
+		else
+			continue;
 
-		pg_usleep(PGSTAT_RETRY_DELAY * 1000L);
+		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
+											 (void *) &shtabentry->key.objectid,
+													   HASH_ENTER, NULL);
+		memcpy(tabentry, &shtabentry->stats, sizeof(PgStat_StatTabEntry));
 	}
 
-	if (count >= PGSTAT_POLL_LOOP_COUNT)
-		elog(WARNING, "pgstat wait timeout");
+	hash_seq_init(&hstat, pgStatSharedFuncHash);
+	while ((shfuncentry = (PgStat_SharedFuncEntry *) hash_seq_search(&hstat)) != NULL)
+	{
+		PgStat_StatFuncEntry *funcentry;
 
-	/*
-	 * Autovacuum launcher wants stats about all databases, but a shallow read
-	 * is sufficient.
-	 */
-	if (IsAutoVacuumLauncherProcess())
-		pgStatDBHash = pgstat_read_statsfiles(InvalidOid, false, false);
-	else
-		pgStatDBHash = pgstat_read_statsfiles(MyDatabaseId, false, true);
-}
+		if (shfuncentry->key.databaseid == MyDatabaseId && mydbentry)
+			dbentry = mydbentry;
+		else if (shfuncentry->key.databaseid == InvalidOid && shareddbentry)
+			dbentry = shareddbentry;
+		else
+			continue;
+
+		funcentry = (PgStat_StatFuncEntry *) hash_search(dbentry->functions,
+											(void *) &shfuncentry->key.objectid,
+														 HASH_ENTER, NULL);
+		memcpy(funcentry, &shfuncentry->stats, sizeof(PgStat_StatFuncEntry));
+	}
 
+	for (i = NUM_PGSTAT_PARTITIONS; --i >= 0;)
+		LWLockRelease(FirstPgStatLock + i);
+}
 
 /* ----------
  * pgstat_setup_memcxt() -
@@ -4409,89 +3688,6 @@ pgstat_clear_snapshot(void)
 }
 
 
-/* ----------
- * pgstat_recv_inquiry() -
- *
- *	Process stat inquiry requests.
- * ----------
- */
-static void
-pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len)
-{
-	slist_iter	iter;
-	DBWriteRequest *newreq;
-	PgStat_StatDBEntry *dbentry;
-
-	elog(DEBUG2, "received inquiry for %d", msg->databaseid);
-
-	/*
-	 * Find the last write request for this DB.  If it's older than the
-	 * request's cutoff time, update it; otherwise there's nothing to do.
-	 *
-	 * Note that if a request is found, we return early and skip the below
-	 * check for clock skew.  This is okay, since the only way for a DB
-	 * request to be present in the list is that we have been here since the
-	 * last write round.
-	 */
-	slist_foreach(iter, &last_statrequests)
-	{
-		DBWriteRequest *req = slist_container(DBWriteRequest, next, iter.cur);
-
-		if (req->databaseid != msg->databaseid)
-			continue;
-
-		if (msg->cutoff_time > req->request_time)
-			req->request_time = msg->cutoff_time;
-		return;
-	}
-
-	/*
-	 * There's no request for this DB yet, so create one.
-	 */
-	newreq = palloc(sizeof(DBWriteRequest));
-
-	newreq->databaseid = msg->databaseid;
-	newreq->request_time = msg->clock_time;
-	slist_push_head(&last_statrequests, &newreq->next);
-
-	/*
-	 * If the requestor's local clock time is older than stats_timestamp, we
-	 * should suspect a clock glitch, ie system time going backwards; though
-	 * the more likely explanation is just delayed message receipt.  It is
-	 * worth expending a GetCurrentTimestamp call to be sure, since a large
-	 * retreat in the system clock reading could otherwise cause us to neglect
-	 * to update the stats file for a long time.
-	 */
-	dbentry = pgstat_get_db_entry(msg->databaseid, false);
-	if ((dbentry != NULL) && (msg->clock_time < dbentry->stats_timestamp))
-	{
-		TimestampTz cur_ts = GetCurrentTimestamp();
-
-		if (cur_ts < dbentry->stats_timestamp)
-		{
-			/*
-			 * Sure enough, time went backwards.  Force a new stats file write
-			 * to get back in sync; but first, log a complaint.
-			 */
-			char	   *writetime;
-			char	   *mytime;
-
-			/* Copy because timestamptz_to_str returns a static buffer */
-			writetime = pstrdup(timestamptz_to_str(dbentry->stats_timestamp));
-			mytime = pstrdup(timestamptz_to_str(cur_ts));
-			elog(LOG,
-			"stats_timestamp %s is later than collector's time %s for db %d",
-				 writetime, mytime, dbentry->databaseid);
-			pfree(writetime);
-			pfree(mytime);
-
-			newreq->request_time = cur_ts;
-			dbentry->stats_timestamp = cur_ts - 1;
-		}
-	}
-}
-
-
 /* ----------
  * pgstat_recv_tabstat() -
  *
@@ -4503,63 +3699,32 @@ pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len)
 {
 	PgStat_StatDBEntry *dbentry;
 	PgStat_StatTabEntry *tabentry;
+	PgStat_TableCounts dbcounts;
+	PgStat_ObjectKey key;
 	int			i;
-	bool		found;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
 
-	/*
-	 * Update database-wide stats.
-	 */
-	dbentry->n_xact_commit += (PgStat_Counter) (msg->m_xact_commit);
-	dbentry->n_xact_rollback += (PgStat_Counter) (msg->m_xact_rollback);
-	dbentry->n_block_read_time += msg->m_block_read_time;
-	dbentry->n_block_write_time += msg->m_block_write_time;
+	memset(&dbcounts, 0, sizeof(dbcounts));
+	key.databaseid = msg->m_databaseid;
 
 	/*
-	 * Process all table entries in the message.
+	 * Process all table entries in the message, summing up the per-database
+	 * totals as we go.
 	 */
 	for (i = 0; i < msg->m_nentries; i++)
 	{
 		PgStat_TableEntry *tabmsg = &(msg->m_entry[i]);
+		uint32		hashcode;
+		LWLockId	partitionLock;
 
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-													(void *) &(tabmsg->t_id),
-													   HASH_ENTER, &found);
+		key.objectid = tabmsg->t_id;
+		hashcode = get_hash_value(pgStatSharedTabHash, (void *) &key);
+		partitionLock = PgStatPartitionLock(hashcode);
 
-		if (!found)
-		{
-			/*
-			 * If it's a new table entry, initialize counters to the values we
-			 * just got.
-			 */
-			tabentry->numscans = tabmsg->t_counts.t_numscans;
-			tabentry->tuples_returned = tabmsg->t_counts.t_tuples_returned;
-			tabentry->tuples_fetched = tabmsg->t_counts.t_tuples_fetched;
-			tabentry->tuples_inserted = tabmsg->t_counts.t_tuples_inserted;
-			tabentry->tuples_updated = tabmsg->t_counts.t_tuples_updated;
-			tabentry->tuples_deleted = tabmsg->t_counts.t_tuples_deleted;
-			tabentry->tuples_hot_updated = tabmsg->t_counts.t_tuples_hot_updated;
-			tabentry->n_live_tuples = tabmsg->t_counts.t_delta_live_tuples;
-			tabentry->n_dead_tuples = tabmsg->t_counts.t_delta_dead_tuples;
-			tabentry->changes_since_analyze = tabmsg->t_counts.t_changed_tuples;
-			tabentry->blocks_fetched = tabmsg->t_counts.t_blocks_fetched;
-			tabentry->blocks_hit = tabmsg->t_counts.t_blocks_hit;
-
-			tabentry->vacuum_timestamp = 0;
-			tabentry->vacuum_count = 0;
-			tabentry->autovac_vacuum_timestamp = 0;
-			tabentry->autovac_vacuum_count = 0;
-			tabentry->analyze_timestamp = 0;
-			tabentry->analyze_count = 0;
-			tabentry->autovac_analyze_timestamp = 0;
-			tabentry->autovac_analyze_count = 0;
-		}
-		else
+		LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+
+		tabentry = pgstat_get_tab_entry(&key, hashcode, true);
+		if (tabentry != NULL)
 		{
-			/*
-			 * Otherwise add the values to the existing entry.
-			 */
 			tabentry->numscans += tabmsg->t_counts.t_numscans;
 			tabentry->tuples_returned += tabmsg->t_counts.t_tuples_returned;
 			tabentry->tuples_fetched += tabmsg->t_counts.t_tuples_fetched;
@@ -4572,56 +3737,82 @@ pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len)
 			tabentry->changes_since_analyze += tabmsg->t_counts.t_changed_tuples;
 			tabentry->blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
 			tabentry->blocks_hit += tabmsg->t_counts.t_blocks_hit;
+
+			/* Clamp n_live_tuples in case of negative delta_live_tuples */
+			tabentry->n_live_tuples = Max(tabentry->n_live_tuples, 0);
+			/* Likewise for n_dead_tuples */
+			tabentry->n_dead_tuples = Max(tabentry->n_dead_tuples, 0);
 		}
 
-		/* Clamp n_live_tuples in case of negative delta_live_tuples */
-		tabentry->n_live_tuples = Max(tabentry->n_live_tuples, 0);
-		/* Likewise for n_dead_tuples */
-		tabentry->n_dead_tuples = Max(tabentry->n_dead_tuples, 0);
+		LWLockRelease(partitionLock);
 
-		/*
-		 * Add per-table stats to the per-database entry, too.
-		 */
-		dbentry->n_tuples_returned += tabmsg->t_counts.t_tuples_returned;
-		dbentry->n_tuples_fetched += tabmsg->t_counts.t_tuples_fetched;
-		dbentry->n_tuples_inserted += tabmsg->t_counts.t_tuples_inserted;
-		dbentry->n_tuples_updated += tabmsg->t_counts.t_tuples_updated;
-		dbentry->n_tuples_deleted += tabmsg->t_counts.t_tuples_deleted;
-		dbentry->n_blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
-		dbentry->n_blocks_hit += tabmsg->t_counts.t_blocks_hit;
+		dbcounts.t_tuples_returned += tabmsg->t_counts.t_tuples_returned;
+		dbcounts.t_tuples_fetched += tabmsg->t_counts.t_tuples_fetched;
+		dbcounts.t_tuples_inserted += tabmsg->t_counts.t_tuples_inserted;
+		dbcounts.t_tuples_updated += tabmsg->t_counts.t_tuples_updated;
+		dbcounts.t_tuples_deleted += tabmsg->t_counts.t_tuples_deleted;
+		dbcounts.t_blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
+		dbcounts.t_blocks_hit += tabmsg->t_counts.t_blocks_hit;
+	}
+
+	/*
+	 * Update database-wide stats.
+	 */
+	LWLockAcquire(PgStatLock, LW_EXCLUSIVE);
+
+	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	if (dbentry != NULL)
+	{
+		dbentry->n_xact_commit += (PgStat_Counter) (msg->m_xact_commit);
+		dbentry->n_xact_rollback += (PgStat_Counter) (msg->m_xact_rollback);
+		dbentry->n_block_read_time += msg->m_block_read_time;
+		dbentry->n_block_write_time += msg->m_block_write_time;
+
+		dbentry->n_tuples_returned += dbcounts.t_tuples_returned;
+		dbentry->n_tuples_fetched += dbcounts.t_tuples_fetched;
+		dbentry->n_tuples_inserted += dbcounts.t_tuples_inserted;
+		dbentry->n_tuples_updated += dbcounts.t_tuples_updated;
+		dbentry->n_tuples_deleted += dbcounts.t_tuples_deleted;
+		dbentry->n_blocks_fetched += dbcounts.t_blocks_fetched;
+		dbentry->n_blocks_hit += dbcounts.t_blocks_hit;
 	}
+
+	LWLockRelease(PgStatLock);
 }
 
 
 /* ----------
  * pgstat_recv_tabpurge() -
  *
- *	Arrange for dead table removal.
+ *	Remove the entries of dead tables.
  * ----------
  */
 static void
 pgstat_recv_tabpurge(PgStat_MsgTabpurge *msg, int len)
 {
-	PgStat_StatDBEntry *dbentry;
+	PgStat_ObjectKey key;
 	int			i;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
-
-	/*
-	 * No need to purge if we don't even know the database.
-	 */
-	if (!dbentry || !dbentry->tables)
-		return;
+	key.databaseid = msg->m_databaseid;
 
 	/*
 	 * Process all table entries in the message.
 	 */
 	for (i = 0; i < msg->m_nentries; i++)
 	{
+		uint32		hashcode;
+		LWLockId	partitionLock;
+
+		key.objectid = msg->m_tableid[i];
+		hashcode = get_hash_value(pgStatSharedTabHash, (void *) &key);
+		partitionLock = PgStatPartitionLock(hashcode);
+
 		/* Remove from hashtable if present; we don't care if it's not. */
-		(void) hash_search(dbentry->tables,
-						   (void *) &(msg->m_tableid[i]),
-						   HASH_REMOVE, NULL);
+		LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+		(void) hash_search_with_hash_value(pgStatSharedTabHash,
+										   (void *) &key, hashcode,
+										   HASH_REMOVE, NULL);
+		LWLockRelease(partitionLock);
 	}
 }
 
@@ -4629,43 +3820,20 @@ pgstat_recv_tabpurge(PgStat_MsgTabpurge *msg, int len)
 /* ----------
  * pgstat_recv_dropdb() -
  *
- *	Arrange for dead database removal
+ *	Remove the entries of a dead database.
  * ----------
  */
 static void
 pgstat_recv_dropdb(PgStat_MsgDropdb *msg, int len)
 {
 	Oid			dbid = msg->m_databaseid;
-	PgStat_StatDBEntry *dbentry;
-
-	/*
-	 * Lookup the database in the hashtable.
-	 */
-	dbentry = pgstat_get_db_entry(dbid, false);
-
-	/*
-	 * If found, remove it (along with the db statfile).
-	 */
-	if (dbentry)
-	{
-		char		statfile[MAXPGPATH];
-
-		get_dbstat_filename(false, false, dbid, statfile, MAXPGPATH);
-
-		elog(DEBUG2, "removing %s", statfile);
-		unlink(statfile);
 
-		if (dbentry->tables != NULL)
-			hash_destroy(dbentry->tables);
-		if (dbentry->functions != NULL)
-			hash_destroy(dbentry->functions);
+	LWLockAcquire(PgStatLock, LW_EXCLUSIVE);
+	(void) hash_search(pgStatSharedDBHash, (void *) &dbid,
+					   HASH_REMOVE, NULL);
+	LWLockRelease(PgStatLock);
 
-		if (hash_search(pgStatDBHash,
-						(void *) &dbid,
-						HASH_REMOVE, NULL) == NULL)
-			ereport(ERROR,
-					(errmsg("database hash table corrupted during cleanup --- abort")));
-	}
+	pgstat_remove_objects(dbid, false);
 }
 
 
@@ -4679,32 +3847,25 @@ static void
 pgstat_recv_resetcounter(PgStat_MsgResetcounter *msg, int len)
 {
 	PgStat_StatDBEntry *dbentry;
+	bool		found;
 
 	/*
 	 * Lookup the database in the hashtable.  Nothing to do if not there.
 	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
-
-	if (!dbentry)
-		return;
+	LWLockAcquire(PgStatLock, LW_EXCLUSIVE);
 
-	/*
-	 * We simply throw away all the database's table entries by recreating a
-	 * new hash table for them.
-	 */
-	if (dbentry->tables != NULL)
-		hash_destroy(dbentry->tables);
-	if (dbentry->functions != NULL)
-		hash_destroy(dbentry->functions);
+	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
+	found = (dbentry != NULL);
+	if (found)
+		reset_dbentry_counters(dbentry);
 
-	dbentry->tables = NULL;
-	dbentry->functions = NULL;
+	LWLockRelease(PgStatLock);
 
 	/*
-	 * Reset database-level stats, too.  This creates empty hash tables for
-	 * tables and functions.
+	 * We simply throw away all the database's table and function entries.
 	 */
-	reset_dbentry_counters(dbentry);
+	if (found)
+		pgstat_remove_objects(msg->m_databaseid, false);
 }
 
 /* ----------
@@ -4719,8 +3880,17 @@ pgstat_recv_resetsharedcounter(PgStat_MsgResetsharedcounter *msg, int len)
 	if (msg->m_resettarget == RESET_BGWRITER)
 	{
 		/* Reset the global background writer statistics for the cluster. */
-		memset(&globalStats, 0, sizeof(globalStats));
-		globalStats.stat_reset_timestamp = GetCurrentTimestamp();
+		LWLockAcquire(PgStatLock, LW_EXCLUSIVE);
+		memset(sharedGlobalStats, 0, sizeof(PgStat_GlobalStats));
+		sharedGlobalStats->stat_reset_timestamp = GetCurrentTimestamp();
+		LWLockRelease(PgStatLock);
+	}
+	else if (msg->m_resettarget == RESET_SLRU)
+	{
+		/* Reset the SLRU statistics for the cluster. */
+		LWLockAcquire(PgStatLock, LW_EXCLUSIVE);
+		pgstat_reset_slru_stats();
+		LWLockRelease(PgStatLock);
 	}
 
 	/*
@@ -4739,22 +3909,41 @@ static void
 pgstat_recv_resetsinglecounter(PgStat_MsgResetsinglecounter *msg, int len)
 {
 	PgStat_StatDBEntry *dbentry;
+	PgStat_ObjectKey key;
+	HTAB	   *htab;
+	uint32		hashcode;
+	LWLockId	partitionLock;
+
+	LWLockAcquire(PgStatLock, LW_EXCLUSIVE);
 
 	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
 
+	/* Set the reset timestamp for the whole database */
+	if (dbentry)
+		dbentry->stat_reset_timestamp = GetCurrentTimestamp();
+
+	LWLockRelease(PgStatLock);
+
 	if (!dbentry)
 		return;
 
-	/* Set the reset timestamp for the whole database */
-	dbentry->stat_reset_timestamp = GetCurrentTimestamp();
-
-	/* Remove object if it exists, ignore it if not */
 	if (msg->m_resettype == RESET_TABLE)
-		(void) hash_search(dbentry->tables, (void *) &(msg->m_objectid),
-						   HASH_REMOVE, NULL);
+		htab = pgStatSharedTabHash;
 	else if (msg->m_resettype == RESET_FUNCTION)
-		(void) hash_search(dbentry->functions, (void *) &(msg->m_objectid),
-						   HASH_REMOVE, NULL);
+		htab = pgStatSharedFuncHash;
+	else
+		return;
+
+	/* Remove object if it exists, ignore it if not */
+	key.databaseid = msg->m_databaseid;
+	key.objectid = msg->m_objectid;
+	hashcode = get_hash_value(htab, (void *) &key);
+	partitionLock = PgStatPartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	(void) hash_search_with_hash_value(htab, (void *) &key, hashcode,
+									   HASH_REMOVE, NULL);
+	LWLockRelease(partitionLock);
 }
 
 /* ----------
@@ -4771,9 +3960,25 @@ pgstat_recv_autovac(PgStat_MsgAutovacStart *msg, int len)
 	/*
 	 * Store the last autovacuum time in the database's hashtable entry.
 	 */
+	LWLockAcquire(PgStatLock, LW_EXCLUSIVE);
+
 	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	if (dbentry)
+		dbentry->last_autovac_time = msg->m_start_time;
+
+	LWLockRelease(PgStatLock);
+}
 
-	dbentry->last_autovac_time = msg->m_start_time;
+/*
+ * Make sure the given database has an entry, before we add statistics for
+ * one of its objects.
+ */
+static void
+pgstat_create_db_entry(Oid databaseid)
+{
+	LWLockAcquire(PgStatLock, LW_EXCLUSIVE);
+	(void) pgstat_get_db_entry(databaseid, true);
+	LWLockRelease(PgStatLock);
 }
 
 /* ----------
@@ -4785,30 +3990,43 @@ pgstat_recv_autovac(PgStat_MsgAutovacStart *msg, int len)
 static void
 pgstat_recv_vacuum(PgStat_MsgVacuum *msg, int len)
 {
-	PgStat_StatDBEntry *dbentry;
 	PgStat_StatTabEntry *tabentry;
+	PgStat_ObjectKey key;
+	uint32		hashcode;
+	LWLockId	partitionLock;
+
+	pgstat_create_db_entry(msg->m_databaseid);
 
 	/*
 	 * Store the data in the table's hashtable entry.
 	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	key.databaseid = msg->m_databaseid;
+	key.objectid = msg->m_tableoid;
+	hashcode = get_hash_value(pgStatSharedTabHash, (void *) &key);
+	partitionLock = PgStatPartitionLock(hashcode);
 
-	tabentry = pgstat_get_tab_entry(dbentry, msg->m_tableoid, true);
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
 
-	tabentry->n_live_tuples = msg->m_tuples;
-	/* Resetting dead_tuples to 0 is an approximation ... */
-	tabentry->n_dead_tuples = 0;
-
-	if (msg->m_autovacuum)
-	{
-		tabentry->autovac_vacuum_timestamp = msg->m_vacuumtime;
-		tabentry->autovac_vacuum_count++;
-	}
-	else
+	tabentry = pgstat_get_tab_entry(&key, hashcode, true);
+	if (tabentry != NULL)
 	{
-		tabentry->vacuum_timestamp = msg->m_vacuumtime;
-		tabentry->vacuum_count++;
+		tabentry->n_live_tuples = msg->m_tuples;
+		/* Resetting dead_tuples to 0 is an approximation ... */
+		tabentry->n_dead_tuples = 0;
+
+		if (msg->m_autovacuum)
+		{
+			tabentry->autovac_vacuum_timestamp = msg->m_vacuumtime;
+			tabentry->autovac_vacuum_count++;
+		}
+		else
+		{
+			tabentry->vacuum_timestamp = msg->m_vacuumtime;
+			tabentry->vacuum_count++;
+		}
 	}
+
+	LWLockRelease(partitionLock);
 }
 
 /* ----------
@@ -4820,35 +4038,48 @@ pgstat_recv_vacuum(PgStat_MsgVacuum *msg, int len)
 static void
 pgstat_recv_analyze(PgStat_MsgAnalyze *msg, int len)
 {
-	PgStat_StatDBEntry *dbentry;
 	PgStat_StatTabEntry *tabentry;
+	PgStat_ObjectKey key;
+	uint32		hashcode;
+	LWLockId	partitionLock;
+
+	pgstat_create_db_entry(msg->m_databaseid);
 
 	/*
 	 * Store the data in the table's hashtable entry.
 	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	key.databaseid = msg->m_databaseid;
+	key.objectid = msg->m_tableoid;
+	hashcode = get_hash_value(pgStatSharedTabHash, (void *) &key);
+	partitionLock = PgStatPartitionLock(hashcode);
 
-	tabentry = pgstat_get_tab_entry(dbentry, msg->m_tableoid, true);
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
 
-	tabentry->n_live_tuples = msg->m_live_tuples;
-	tabentry->n_dead_tuples = msg->m_dead_tuples;
+	tabentry = pgstat_get_tab_entry(&key, hashcode, true);
+	if (tabentry != NULL)
+	{
+		tabentry->n_live_tuples = msg->m_live_tuples;
+		tabentry->n_dead_tuples = msg->m_dead_tuples;
 
-	/*
-	 * We reset changes_since_analyze to zero, forgetting any changes that
-	 * occurred while the ANALYZE was in progress.
-	 */
-	tabentry->changes_since_analyze = 0;
+		/*
+		 * We reset changes_since_analyze to zero, forgetting any changes
+		 * that occurred while the ANALYZE was in progress.
+		 */
+		tabentry->changes_since_analyze = 0;
 
-	if (msg->m_autovacuum)
-	{
-		tabentry->autovac_analyze_timestamp = msg->m_analyzetime;
-		tabentry->autovac_analyze_count++;
-	}
-	else
-	{
-		tabentry->analyze_timestamp = msg->m_analyzetime;
-		tabentry->analyze_count++;
+		if (msg->m_autovacuum)
+		{
+			tabentry->autovac_analyze_timestamp = msg->m_analyzetime;
+			tabentry->autovac_analyze_count++;
+		}
+		else
+		{
+			tabentry->analyze_timestamp = msg->m_analyzetime;
+			tabentry->analyze_count++;
+		}
 	}
+
+	LWLockRelease(partitionLock);
 }
 
 
@@ -4861,16 +4092,20 @@ pgstat_recv_analyze(PgStat_MsgAnalyze *msg, int len)
 static void
 pgstat_recv_bgwriter(PgStat_MsgBgWriter *msg, int len)
 {
-	globalStats.timed_checkpoints += msg->m_timed_checkpoints;
-	globalStats.requested_checkpoints += msg->m_requested_checkpoints;
-	globalStats.checkpoint_write_time += msg->m_checkpoint_write_time;
-	globalStats.checkpoint_sync_time += msg->m_checkpoint_sync_time;
-	globalStats.buf_written_checkpoints += msg->m_buf_written_checkpoints;
-	globalStats.buf_written_clean += msg->m_buf_written_clean;
-	globalStats.maxwritten_clean += msg->m_maxwritten_clean;
-	globalStats.buf_written_backend += msg->m_buf_written_backend;
-	globalStats.buf_fsync_backend += msg->m_buf_fsync_backend;
-	globalStats.buf_alloc += msg->m_buf_alloc;
+	LWLockAcquire(PgStatLock, LW_EXCLUSIVE);
+
+	sharedGlobalStats->timed_checkpoints += msg->m_timed_checkpoints;
+	sharedGlobalStats->requested_checkpoints += msg->m_requested_checkpoints;
+	sharedGlobalStats->checkpoint_write_time += msg->m_checkpoint_write_time;
+	sharedGlobalStats->checkpoint_sync_time += msg->m_checkpoint_sync_time;
+	sharedGlobalStats->buf_written_checkpoints += msg->m_buf_written_checkpoints;
+	sharedGlobalStats->buf_written_clean += msg->m_buf_written_clean;
+	sharedGlobalStats->maxwritten_clean += msg->m_maxwritten_clean;
+	sharedGlobalStats->buf_written_backend += msg->m_buf_written_backend;
+	sharedGlobalStats->buf_fsync_backend += msg->m_buf_fsync_backend;
+	sharedGlobalStats->buf_alloc += msg->m_buf_alloc;
+
+	LWLockRelease(PgStatLock);
 }
 
 /* ----------
@@ -4884,33 +4119,39 @@ pgstat_recv_recoveryconflict(PgStat_MsgRecoveryConflict *msg, int len)
 {
 	PgStat_StatDBEntry *dbentry;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	/*
+	 * Since we drop the information about the database as soon as it
+	 * replicates, there is no point in counting database conflicts.
+	 */
+	if (msg->m_reason == PROCSIG_RECOVERY_CONFLICT_DATABASE)
+		return;
 
-	switch (msg->m_reason)
-	{
-		case PROCSIG_RECOVERY_CONFLICT_DATABASE:
+	LWLockAcquire(PgStatLock, LW_EXCLUSIVE);
 
-			/*
-			 * Since we drop the information about the database as soon as it
-			 * replicates, there is no point in counting these conflicts.
-			 */
-			break;
-		case PROCSIG_RECOVERY_CONFLICT_TABLESPACE:
-			dbentry->n_conflict_tablespace++;
-			break;
-		case PROCSIG_RECOVERY_CONFLICT_LOCK:
-			dbentry->n_conflict_lock++;
-			break;
-		case PROCSIG_RECOVERY_CONFLICT_SNAPSHOT:
-			dbentry->n_conflict_snapshot++;
-			break;
-		case PROCSIG_RECOVERY_CONFLICT_BUFFERPIN:
-			dbentry->n_conflict_bufferpin++;
-			break;
-		case PROCSIG_RECOVERY_CONFLICT_STARTUP_DEADLOCK:
-			dbentry->n_conflict_startup_deadlock++;
-			break;
+	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	if (dbentry != NULL)
+	{
+		switch (msg->m_reason)
+		{
+			case PROCSIG_RECOVERY_CONFLICT_TABLESPACE:
+				dbentry->n_conflict_tablespace++;
+				break;
+			case PROCSIG_RECOVERY_CONFLICT_LOCK:
+				dbentry->n_conflict_lock++;
+				break;
+			case PROCSIG_RECOVERY_CONFLICT_SNAPSHOT:
+				dbentry->n_conflict_snapshot++;
+				break;
+			case PROCSIG_RECOVERY_CONFLICT_BUFFERPIN:
+				dbentry->n_conflict_bufferpin++;
+				break;
+			case PROCSIG_RECOVERY_CONFLICT_STARTUP_DEADLOCK:
+				dbentry->n_conflict_startup_deadlock++;
+				break;
+		}
 	}
+
+	LWLockRelease(PgStatLock);
 }
 
 /* ----------
@@ -4924,9 +4165,13 @@ pgstat_recv_deadlock(PgStat_MsgDeadlock *msg, int len)
 {
 	PgStat_StatDBEntry *dbentry;
 
+	LWLockAcquire(PgStatLock, LW_EXCLUSIVE);
+
 	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	if (dbentry != NULL)
+		dbentry->n_deadlocks++;
 
-	dbentry->n_deadlocks++;
+	LWLockRelease(PgStatLock);
 }
 
 /* ----------
@@ -4940,10 +4185,46 @@ pgstat_recv_tempfile(PgStat_MsgTempFile *msg, int len)
 {
 	PgStat_StatDBEntry *dbentry;
 
+	LWLockAcquire(PgStatLock, LW_EXCLUSIVE);
+
 	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	if (dbentry != NULL)
+	{
+		dbentry->n_temp_bytes += msg->m_filesize;
+		dbentry->n_temp_files += 1;
+	}
+
+	LWLockRelease(PgStatLock);
+}
+
+/* ----------
+ * pgstat_recv_slru() -
+ *
+ *	Process an SLRU message.
+ * ----------
+ */
+static void
+pgstat_recv_slru(PgStat_MsgSLRU *msg, int len)
+{
+	int			i;
+
+	LWLockAcquire(PgStatLock, LW_EXCLUSIVE);
+
+	for (i = 0; i < SLRU_NUM_ELEMENTS; i++)
+	{
+		PgStat_SLRUCounts *dst = &sharedSLRUStats[i].counts;
+		PgStat_SLRUCounts *src = &msg->m_counts[i];
+
+		dst->blocks_zeroed += src->blocks_zeroed;
+		dst->blocks_hit += src->blocks_hit;
+		dst->blocks_read += src->blocks_read;
+		dst->blocks_written += src->blocks_written;
+		dst->blocks_exists += src->blocks_exists;
+		dst->flush += src->flush;
+		dst->truncate += src->truncate;
+	}
 
-	dbentry->n_temp_bytes += msg->m_filesize;
-	dbentry->n_temp_files += 1;
+	LWLockRelease(PgStatLock);
 }
 
 /* ----------
@@ -4956,111 +4237,71 @@ static void
 pgstat_recv_funcstat(PgStat_MsgFuncstat *msg, int len)
 {
 	PgStat_FunctionEntry *funcmsg = &(msg->m_entry[0]);
-	PgStat_StatDBEntry *dbentry;
 	PgStat_StatFuncEntry *funcentry;
+	PgStat_ObjectKey key;
 	int			i;
-	bool		found;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	pgstat_create_db_entry(msg->m_databaseid);
+
+	key.databaseid = msg->m_databaseid;
 
 	/*
 	 * Process all function entries in the message.
 	 */
 	for (i = 0; i < msg->m_nentries; i++, funcmsg++)
 	{
-		funcentry = (PgStat_StatFuncEntry *) hash_search(dbentry->functions,
-												   (void *) &(funcmsg->f_id),
-														 HASH_ENTER, &found);
+		uint32		hashcode;
+		LWLockId	partitionLock;
 
-		if (!found)
-		{
-			/*
-			 * If it's a new function entry, initialize counters to the values
-			 * we just got.
-			 */
-			funcentry->f_numcalls = funcmsg->f_numcalls;
-			funcentry->f_total_time = funcmsg->f_total_time;
-			funcentry->f_self_time = funcmsg->f_self_time;
-		}
-		else
+		key.objectid = funcmsg->f_id;
+		hashcode = get_hash_value(pgStatSharedFuncHash, (void *) &key);
+		partitionLock = PgStatPartitionLock(hashcode);
+
+		LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+
+		funcentry = pgstat_get_func_entry(&key, hashcode, true);
+		if (funcentry != NULL)
 		{
-			/*
-			 * Otherwise add the values to the existing entry.
-			 */
 			funcentry->f_numcalls += funcmsg->f_numcalls;
 			funcentry->f_total_time += funcmsg->f_total_time;
 			funcentry->f_self_time += funcmsg->f_self_time;
 		}
+
+		LWLockRelease(partitionLock);
 	}
 }
 
 /* ----------
  * pgstat_recv_funcpurge() -
  *
- *	Arrange for dead function removal.
+ *	Remove the entries of dead functions.
  * ----------
  */
 static void
 pgstat_recv_funcpurge(PgStat_MsgFuncpurge *msg, int len)
 {
-	PgStat_StatDBEntry *dbentry;
+	PgStat_ObjectKey key;
 	int			i;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
-
-	/*
-	 * No need to purge if we don't even know the database.
-	 */
-	if (!dbentry || !dbentry->functions)
-		return;
+	key.databaseid = msg->m_databaseid;
 
 	/*
 	 * Process all function entries in the message.
 	 */
 	for (i = 0; i < msg->m_nentries; i++)
 	{
-		/* Remove from hashtable if present; we don't care if it's not. */
-		(void) hash_search(dbentry->functions,
-						   (void *) &(msg->m_functionid[i]),
-						   HASH_REMOVE, NULL);
-	}
-}
-
-/* ----------
- * pgstat_write_statsfile_needed() -
- *
- *	Do we need to write out the files?
- * ----------
- */
-static bool
-pgstat_write_statsfile_needed(void)
-{
-	if (!slist_is_empty(&last_statrequests))
-		return true;
-
-	/* Everything was written recently */
-	return false;
-}
-
-/* ----------
- * pgstat_db_requested() -
- *
- *	Checks whether stats for a particular DB need to be written to a file.
- * ----------
- */
-static bool
-pgstat_db_requested(Oid databaseid)
-{
-	slist_iter	iter;
+		uint32		hashcode;
+		LWLockId	partitionLock;
 
-	/* Check the databases if they need to refresh the stats. */
-	slist_foreach(iter, &last_statrequests)
-	{
-		DBWriteRequest *req = slist_container(DBWriteRequest, next, iter.cur);
+		key.objectid = msg->m_functionid[i];
+		hashcode = get_hash_value(pgStatSharedFuncHash, (void *) &key);
+		partitionLock = PgStatPartitionLock(hashcode);
 
-		if (req->databaseid == databaseid)
-			return true;
+		/* Remove from hashtable if present; we don't care if it's not. */
+		LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+		(void) hash_search_with_hash_value(pgStatSharedFuncHash,
+										   (void *) &key, hashcode,
+										   HASH_REMOVE, NULL);
+		LWLockRelease(partitionLock);
 	}
-
-	return false;
 }
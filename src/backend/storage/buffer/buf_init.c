@@ -21,6 +21,16 @@
 BufferDesc *BufferDescriptors;
 char	   *BufferBlocks;
 int32	   *PrivateRefCount;
+CkptSortItem *CkptBufferIds;
+
+/* writeback requests of buffers written by this backend itself */
+WritebackContext BackendWritebackContext;
+
+/* number of buffer mapping partitions; see InitializeBufferPartitions */
+int			NumBufferPartitions = MIN_BUFFER_PARTITIONS;
+
+/* shared buffers per mapping partition we aim for */
+#define BUFFERS_PER_PARTITION	128
 
 
 /*
@@ -63,6 +73,25 @@ int32	   *PrivateRefCount;
  */
 
 
+/*
+ * InitializeBufferPartitions -- choose the number of buffer mapping partitions
+ *
+ * One per BUFFERS_PER_PARTITION buffers, rounded up to a power of two and
+ * clamped to the range allowed by lwlock.h; that's 128 for the default
+ * shared_buffers.  The LWLock layout and the shared hashtable depend on it,
+ * so this must run before shared memory is sized, and give the same answer
+ * in every process, which it does since NBuffers can't change without a
+ * restart.
+ */
+void
+InitializeBufferPartitions(void)
+{
+	NumBufferPartitions = MIN_BUFFER_PARTITIONS;
+	while (NumBufferPartitions < MAX_BUFFER_PARTITIONS &&
+		   NumBufferPartitions * BUFFERS_PER_PARTITION < NBuffers)
+		NumBufferPartitions *= 2;
+}
+
 /*
  * Initialize shared buffer pool
  *
@@ -73,7 +102,8 @@ void
 InitBufferPool(void)
 {
 	bool		foundBufs,
-				foundDescs;
+				foundDescs,
+				foundCkpt;
 
 	BufferDescriptors = (BufferDesc *)
 		ShmemInitStruct("Buffer Descriptors",
@@ -83,10 +113,15 @@ InitBufferPool(void)
 		ShmemInitStruct("Buffer Blocks",
 						NBuffers * (Size) BLCKSZ, &foundBufs);
 
-	if (foundDescs || foundBufs)
+	/* the checkpointer's array for sorting the buffers it has to write */
+	CkptBufferIds = (CkptSortItem *)
+		ShmemInitStruct("Checkpoint BufferIds",
+						NBuffers * sizeof(CkptSortItem), &foundCkpt);
+
+	if (foundDescs || foundBufs || foundCkpt)
 	{
-		/* both should be present or neither */
-		Assert(foundDescs && foundBufs);
+		/* all should be present or neither */
+		Assert(foundDescs && foundBufs && foundCkpt);
 		/* note: this path is only taken in EXEC_BACKEND case */
 	}
 	else
@@ -112,17 +147,18 @@ InitBufferPool(void)
 			buf->buf_id = i;
 
 			/*
-			 * Initially link all the buffers together as unused. Subsequent
-			 * management of this list is done by freelist.c.
+			 * Initially link all the buffers together as unused, into one
+			 * list per freelist partition.  Subsequent management of these
+			 * lists is done by freelist.c.
 			 */
-			buf->freeNext = i + 1;
+			if (i + NUM_BUFFER_FREELISTS < NBuffers)
+				buf->freeNext = i + NUM_BUFFER_FREELISTS;
+			else
+				buf->freeNext = FREENEXT_END_OF_LIST;
 
 			buf->io_in_progress_lock = LWLockAssign();
 			buf->content_lock = LWLockAssign();
 		}
-
-		/* Correct last entry of linked list */
-		BufferDescriptors[NBuffers - 1].freeNext = FREENEXT_END_OF_LIST;
 	}
 
 	/* Init other shared buffer-management stuff */
@@ -152,6 +188,8 @@ InitBufferPoolAccess(void)
 		ereport(FATAL,
 				(errcode(ERRCODE_OUT_OF_MEMORY),
 				 errmsg("out of memory")));
+
+	WritebackContextInit(&BackendWritebackContext, &backend_flush_after);
 }
 
 /*
@@ -174,5 +212,8 @@ BufferShmemSize(void)
 	/* size of stuff controlled by freelist.c */
 	size = add_size(size, StrategyShmemSize());
 
+	/* size of checkpoint sort array in bufmgr.c */
+	size = add_size(size, mul_size(NBuffers, sizeof(CkptSortItem)));
+
 	return size;
 }
@@ -60,7 +60,7 @@ InitBufTable(int size)
 	info.keysize = sizeof(BufferTag);
 	info.entrysize = sizeof(BufferLookupEnt);
 	info.hash = tag_hash;
-	info.num_partitions = NUM_BUFFER_PARTITIONS;
+	info.num_partitions = NumBufferPartitions;
 
 	SharedBufHash = ShmemInitHash("Shared Buffer Lookup Table",
 								  size, size,
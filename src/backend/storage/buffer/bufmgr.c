@@ -37,6 +37,7 @@
 #include "catalog/storage.h"
 #include "common/relpath.h"
 #include "executor/instrument.h"
+#include "lib/binaryheap.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "pgstat.h"
@@ -66,6 +67,14 @@
 
 #define DROP_RELS_BSEARCH_THRESHOLD		20
 
+/*
+ * Dropping the buffers of a relation by looking up each of its blocks in the
+ * buffer mapping table is cheaper than scanning all of shared_buffers only
+ * if the relation is small enough.  Like DROP_RELS_BSEARCH_THRESHOLD, this
+ * is a guess rather than an exactly determined value.
+ */
+#define BUF_DROP_FULL_SCAN_THRESHOLD	(uint32) (NBuffers / 32)
+
 /* GUC variables */
 bool		zero_damaged_pages = false;
 int			bgwriter_lru_maxpages = 100;
@@ -79,8 +88,48 @@ bool		track_io_timing = false;
  */
 int			target_prefetch_pages = 0;
 
-/* local state for StartBufferIO and related functions */
-static volatile BufferDesc *InProgressBuf = NULL;
+/*
+ * Maximum number of consecutive blocks ReadBufferRange callers should try
+ * to read with a single system call.
+ */
+int			io_combine_limit = DEFAULT_IO_COMBINE_LIMIT;
+
+/*
+ * Number of pages written by the checkpointer, the bgwriter or a regular
+ * backend after which we ask the kernel to start writing them back to disk.
+ * This keeps the kernel from accumulating lots of dirty data, which would
+ * otherwise all have to be written at once by the fsyncs at the end of the
+ * checkpoint.  Zero disables.
+ */
+int			checkpoint_flush_after = DEFAULT_CHECKPOINT_FLUSH_AFTER;
+int			bgwriter_flush_after = DEFAULT_BGWRITER_FLUSH_AFTER;
+int			backend_flush_after = DEFAULT_BACKEND_FLUSH_AFTER;
+
+/*
+ * Status of one tablespace while BufferSync writes out its buffers.  To
+ * spread the writes evenly across tablespaces, each tablespace's progress
+ * is advanced by progress_slice for every buffer processed, so that all
+ * tablespaces reach the total number of buffers to write at the same time.
+ */
+typedef struct CkptTsStatus
+{
+	Oid			tsId;
+	double		progress;		/* progress of this tablespace */
+	double		progress_slice; /* progress per buffer processed */
+	int			num_to_scan;	/* number of buffers in this tablespace */
+	int			num_scanned;	/* number processed so far */
+	int			index;			/* next CkptBufferIds entry to process */
+} CkptTsStatus;
+
+/*
+ * local state for StartBufferIO and related functions
+ *
+ * A backend normally has at most one I/O in progress, but ReadBufferRange
+ * starts input I/O on up to MAX_IO_COMBINE_LIMIT buffers before reading
+ * them all at once.  Output I/O is always done one buffer at a time.
+ */
+static volatile BufferDesc *InProgressBufs[MAX_IO_COMBINE_LIMIT];
+static int	NumInProgressBufs = 0;
 static bool IsForInput;
 
 /* local state for LockBufferForCleanup */
@@ -95,7 +144,8 @@ static bool PinBuffer(volatile BufferDesc *buf, BufferAccessStrategy strategy);
 static void PinBuffer_Locked(volatile BufferDesc *buf);
 static void UnpinBuffer(volatile BufferDesc *buf, bool fixOwner);
 static void BufferSync(int flags);
-static int	SyncOneBuffer(int buf_id, bool skip_recently_used);
+static int SyncOneBuffer(int buf_id, bool skip_recently_used,
+			  WritebackContext *wb_context);
 static void WaitIO(volatile BufferDesc *buf);
 static bool StartBufferIO(volatile BufferDesc *buf, bool forInput);
 static void TerminateBufferIO(volatile BufferDesc *buf, bool clear_dirty,
@@ -107,11 +157,76 @@ static volatile BufferDesc *BufferAlloc(SMgrRelation smgr,
 			ForkNumber forkNum,
 			BlockNumber blockNum,
 			BufferAccessStrategy strategy,
+			bool startIO,
 			bool *foundPtr);
 static void FlushBuffer(volatile BufferDesc *buf, SMgrRelation reln);
 static void AtProcExit_Buffers(int code, Datum arg);
+static void FindAndDropRelFileNodeBuffers(RelFileNode rnode,
+							  ForkNumber forkNum,
+							  BlockNumber nForkBlock,
+							  BlockNumber firstDelBlock);
 static int	rnode_comparator(const void *p1, const void *p2);
+static int	buffertag_comparator(const void *p1, const void *p2);
+static int	ckpt_buforder_comparator(const void *p1, const void *p2);
+static int	ts_ckpt_progress_comparator(Datum a, Datum b, void *arg);
+
+
+/*
+ * PrefetchSharedBuffer -- initiate asynchronous read of a shared buffer
+ *
+ * This is the guts of PrefetchBuffer for relations that use shared buffers.
+ * It works on the smgr level, so that it can also be used during recovery,
+ * where there is no relcache entry to work with.  Returns true if a read
+ * was initiated, false if the block was found in shared buffers already.
+ * Always returns false if prefetching isn't compiled in.
+ */
+bool
+PrefetchSharedBuffer(SMgrRelation smgr_reln, ForkNumber forkNum,
+					 BlockNumber blockNum)
+{
+#ifdef USE_PREFETCH
+	BufferTag	newTag;			/* identity of requested block */
+	uint32		newHash;		/* hash value for newTag */
+	LWLockId	newPartitionLock;	/* buffer partition lock for it */
+	int			buf_id;
+
+	Assert(BlockNumberIsValid(blockNum));
+
+	/* create a tag so we can lookup the buffer */
+	INIT_BUFFERTAG(newTag, smgr_reln->smgr_rnode.node,
+				   forkNum, blockNum);
+
+	/* determine its hash code and partition lock ID */
+	newHash = BufTableHashCode(&newTag);
+	newPartitionLock = BufMappingPartitionLock(newHash);
+
+	/* see if the block is in the buffer pool already */
+	LWLockAcquire(newPartitionLock, LW_SHARED);
+	buf_id = BufTableLookup(&newTag, newHash);
+	LWLockRelease(newPartitionLock);
+
+	/* If not in buffers, initiate prefetch */
+	if (buf_id < 0)
+	{
+		smgrprefetch(smgr_reln, forkNum, blockNum);
+		return true;
+	}
+
+	/*
+	 * If the block *is* in buffers, we do nothing.  This is not really ideal:
+	 * the block might be just about to be evicted, which would be stupid
+	 * since we know we are going to need it soon.  But the only easy answer
+	 * is to bump the usage_count, which does not seem like a great solution:
+	 * when the caller does ultimately touch the block, usage_count would get
+	 * bumped again, resulting in too much favoritism for blocks that are
+	 * involved in a prefetch sequence. A real fix would involve some
+	 * additional per-buffer state, and it's not clear that there's enough of
+	 * a problem to justify that.
+	 */
+#endif   /* USE_PREFETCH */
 
+	return false;
+}
 
 /*
  * PrefetchBuffer -- initiate asynchronous read of a block of a relation
@@ -144,39 +259,8 @@ PrefetchBuffer(Relation reln, ForkNumber forkNum, BlockNumber blockNum)
 	}
 	else
 	{
-		BufferTag	newTag;		/* identity of requested block */
-		uint32		newHash;	/* hash value for newTag */
-		LWLockId	newPartitionLock;	/* buffer partition lock for it */
-		int			buf_id;
-
-		/* create a tag so we can lookup the buffer */
-		INIT_BUFFERTAG(newTag, reln->rd_smgr->smgr_rnode.node,
-					   forkNum, blockNum);
-
-		/* determine its hash code and partition lock ID */
-		newHash = BufTableHashCode(&newTag);
-		newPartitionLock = BufMappingPartitionLock(newHash);
-
-		/* see if the block is in the buffer pool already */
-		LWLockAcquire(newPartitionLock, LW_SHARED);
-		buf_id = BufTableLookup(&newTag, newHash);
-		LWLockRelease(newPartitionLock);
-
-		/* If not in buffers, initiate prefetch */
-		if (buf_id < 0)
-			smgrprefetch(reln->rd_smgr, forkNum, blockNum);
-
-		/*
-		 * If the block *is* in buffers, we do nothing.  This is not really
-		 * ideal: the block might be just about to be evicted, which would be
-		 * stupid since we know we are going to need it soon.  But the only
-		 * easy answer is to bump the usage_count, which does not seem like a
-		 * great solution: when the caller does ultimately touch the block,
-		 * usage_count would get bumped again, resulting in too much
-		 * favoritism for blocks that are involved in a prefetch sequence. A
-		 * real fix would involve some additional per-buffer state, and it's
-		 * not clear that there's enough of a problem to justify that.
-		 */
+		/* pass it to the shared buffer version */
+		(void) PrefetchSharedBuffer(reln->rd_smgr, forkNum, blockNum);
 	}
 #endif   /* USE_PREFETCH */
 }
@@ -259,6 +343,175 @@ ReadBufferExtended(Relation reln, ForkNumber forkNum, BlockNumber blockNum,
 	return buf;
 }
 
+/*
+ * ReadBufferRange -- pin nblocks consecutive blocks of a relation, starting
+ *		at firstBlockNum, reading in those that aren't in the buffer cache
+ *		yet.  buffers[i] is set to the pinned buffer for block
+ *		firstBlockNum + i.
+ *
+ * This is equivalent to calling ReadBufferExtended in RBM_NORMAL mode for
+ * each block, except that each run of blocks that miss the cache is read
+ * with one vectored smgrreadv call instead of one read per block.  nblocks
+ * must not exceed MAX_IO_COMBINE_LIMIT, and all the blocks must exist.
+ *
+ * Returns the number of blocks that had to be read in.
+ *
+ * Temporary relations are handled one block at a time, since their local
+ * buffers are few and cheap to read anyway.
+ */
+int
+ReadBufferRange(Relation reln, ForkNumber forkNum, BlockNumber firstBlockNum,
+				int nblocks, BufferAccessStrategy strategy, Buffer *buffers)
+{
+	volatile BufferDesc *bufHdrs[MAX_IO_COMBINE_LIMIT];
+	bool		valid[MAX_IO_COMBINE_LIMIT];
+	SMgrRelation smgr;
+	int			nread = 0;
+	int			i;
+
+	Assert(nblocks > 0 && nblocks <= MAX_IO_COMBINE_LIMIT);
+	Assert(BlockNumberIsValid(firstBlockNum));
+
+	/* Open it at the smgr level if not already done */
+	RelationOpenSmgr(reln);
+	smgr = reln->rd_smgr;
+
+	/* see comments in ReadBufferExtended */
+	if (RELATION_IS_OTHER_TEMP(reln))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot access temporary tables of other sessions")));
+
+	if (SmgrIsTemp(smgr))
+	{
+		for (i = 0; i < nblocks; i++)
+		{
+			bool		hit;
+
+			pgstat_count_buffer_read(reln);
+			buffers[i] = ReadBuffer_common(smgr, reln->rd_rel->relpersistence,
+										   forkNum, firstBlockNum + i,
+										   RBM_NORMAL, strategy, &hit);
+			if (hit)
+				pgstat_count_buffer_hit(reln);
+			else
+				nread++;
+		}
+		return nread;
+	}
+
+	/*
+	 * First pin all the buffers, without starting any I/O.  Evicting a victim
+	 * buffer may require writing it out, which we can't do while we have
+	 * input I/O in progress.
+	 */
+	for (i = 0; i < nblocks; i++)
+	{
+		/* Make sure we will have room to remember the buffer pin */
+		ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+
+		bufHdrs[i] = BufferAlloc(smgr, reln->rd_rel->relpersistence, forkNum,
+								 firstBlockNum + i, strategy, false,
+								 &valid[i]);
+		buffers[i] = BufferDescriptorGetBuffer(bufHdrs[i]);
+	}
+
+	/*
+	 * Now read in each run of blocks that are not valid.  We start I/O on
+	 * the buffers in ascending block order, so two backends reading
+	 * overlapping ranges can't deadlock waiting for each other's I/O.  If
+	 * StartBufferIO finds that someone else read the block in the meantime,
+	 * that ends the run.
+	 */
+	i = 0;
+	while (i < nblocks)
+	{
+		char	   *bufBlocks[MAX_IO_COMBINE_LIMIT];
+		BlockNumber runStart = firstBlockNum + i;
+		int			nrun = 0;
+		int			j;
+
+		while (i + nrun < nblocks && !valid[i + nrun])
+		{
+			if (!StartBufferIO(bufHdrs[i + nrun], true))
+			{
+				valid[i + nrun] = true;
+				break;
+			}
+			bufBlocks[nrun] = (char *) BufHdrGetBlock(bufHdrs[i + nrun]);
+			nrun++;
+		}
+
+		if (nrun == 0)
+		{
+			/* a cache hit */
+			pgstat_count_buffer_read(reln);
+			pgstat_count_buffer_hit(reln);
+			pgBufferUsage.shared_blks_hit++;
+			VacuumPageHit++;
+			if (VacuumCostActive)
+				VacuumCostBalance += VacuumCostPageHit;
+			i++;
+			continue;
+		}
+
+		{
+			instr_time	io_start,
+						io_time;
+
+			if (track_io_timing)
+				INSTR_TIME_SET_CURRENT(io_start);
+
+			smgrreadv(smgr, forkNum, runStart, bufBlocks, nrun);
+
+			if (track_io_timing)
+			{
+				INSTR_TIME_SET_CURRENT(io_time);
+				INSTR_TIME_SUBTRACT(io_time, io_start);
+				pgstat_count_buffer_read_time(INSTR_TIME_GET_MICROSEC(io_time));
+				INSTR_TIME_ADD(pgBufferUsage.blk_read_time, io_time);
+			}
+		}
+
+		for (j = 0; j < nrun; j++)
+		{
+			/* check for garbage data, as in ReadBuffer_common */
+			if (!PageIsVerified((Page) bufBlocks[j], runStart + j))
+			{
+				if (zero_damaged_pages)
+				{
+					ereport(WARNING,
+							(errcode(ERRCODE_DATA_CORRUPTED),
+							 errmsg("invalid page in block %u of relation %s; zeroing out page",
+									runStart + j,
+									relpath(smgr->smgr_rnode, forkNum))));
+					MemSet(bufBlocks[j], 0, BLCKSZ);
+				}
+				else
+					ereport(ERROR,
+							(errcode(ERRCODE_DATA_CORRUPTED),
+							 errmsg("invalid page in block %u of relation %s",
+									runStart + j,
+									relpath(smgr->smgr_rnode, forkNum))));
+			}
+
+			/* Set BM_VALID, terminate IO, and wake up any waiters */
+			TerminateBufferIO(bufHdrs[i + j], false, BM_VALID);
+
+			pgstat_count_buffer_read(reln);
+			pgBufferUsage.shared_blks_read++;
+			VacuumPageMiss++;
+			if (VacuumCostActive)
+				VacuumCostBalance += VacuumCostPageMiss;
+		}
+
+		nread += nrun;
+		i += nrun;
+	}
+
+	return nread;
+}
+
 
 /*
  * ReadBufferWithoutRelcache -- like ReadBufferExtended, but doesn't require
@@ -334,7 +587,7 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 		 * not currently in memory.
 		 */
 		bufHdr = BufferAlloc(smgr, relpersistence, forkNum, blockNum,
-							 strategy, &found);
+							 strategy, true, &found);
 		if (found)
 			pgBufferUsage.shared_blks_hit++;
 		else
@@ -529,12 +782,18 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
  * *foundPtr is actually redundant with the buffer's BM_VALID flag, but
  * we keep it for simplicity in ReadBuffer.
  *
+ * If startIO is false, no I/O is started on the buffer: *foundPtr is set
+ * FALSE whenever the buffer is not BM_VALID, and the caller must call
+ * StartBufferIO itself before reading the page in.  ReadBufferRange uses
+ * this to pin a whole range of buffers before starting any I/O.
+ *
  * No locks are held either at entry or exit.
  */
 static volatile BufferDesc *
 BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 			BlockNumber blockNum,
 			BufferAccessStrategy strategy,
+			bool startIO,
 			bool *foundPtr)
 {
 	BufferTag	newTag;			/* identity of requested block */
@@ -583,7 +842,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 			 * own read attempt if the page is still not BM_VALID.
 			 * StartBufferIO does it all.
 			 */
-			if (StartBufferIO(buf, true))
+			if (!startIO || StartBufferIO(buf, true))
 			{
 				/*
 				 * If we get here, previous attempts to read the buffer must
@@ -605,15 +864,11 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	/* Loop here in case we have to try another victim buffer */
 	for (;;)
 	{
-		bool		lock_held;
-
 		/*
 		 * Select a victim buffer.	The buffer is returned with its header
-		 * spinlock still held!  Also (in most cases) the BufFreelistLock is
-		 * still held, since it would be bad to hold the spinlock while
-		 * possibly waking up other processes.
+		 * spinlock still held!
 		 */
-		buf = StrategyGetBuffer(strategy, &lock_held);
+		buf = StrategyGetBuffer(strategy);
 
 		Assert(buf->refcount == 0);
 
@@ -623,10 +878,6 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 		/* Pin the buffer and then release the buffer spinlock */
 		PinBuffer_Locked(buf);
 
-		/* Now it's safe to release the freelist lock */
-		if (lock_held)
-			LWLockRelease(BufFreelistLock);
-
 		/*
 		 * If the buffer was dirty, try to write it out.  There is a race
 		 * condition here, in that someone might dirty it after we released it
@@ -688,6 +939,10 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 				FlushBuffer(buf, NULL);
 				LWLockRelease(buf->content_lock);
 
+				/* we still hold the pin, so the tag can't change */
+				ScheduleBufferTagForWriteback(&BackendWritebackContext,
+											  (BufferTag *) &buf->tag);
+
 				TRACE_POSTGRESQL_BUFFER_WRITE_DIRTY_DONE(forkNum, blockNum,
 											   smgr->smgr_rnode.node.spcNode,
 												smgr->smgr_rnode.node.dbNode,
@@ -792,7 +1047,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 				 * then set up our own read attempt if the page is still not
 				 * BM_VALID.  StartBufferIO does it all.
 				 */
-				if (StartBufferIO(buf, true))
+				if (!startIO || StartBufferIO(buf, true))
 				{
 					/*
 					 * If we get here, previous attempts to read the buffer
@@ -861,7 +1116,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	 * lock.  If StartBufferIO returns false, then someone else managed to
 	 * read it before we did, so there's nothing left for BufferAlloc() to do.
 	 */
-	if (StartBufferIO(buf, true))
+	if (!startIO || StartBufferIO(buf, true))
 		*foundPtr = FALSE;
 	else
 		*foundPtr = TRUE;
@@ -1208,15 +1463,28 @@ UnpinBuffer(volatile BufferDesc *buf, bool fixOwner)
  * is set, we disable delays between writes; if CHECKPOINT_IS_SHUTDOWN is
  * set, we write even unlogged buffers, which are otherwise skipped.  The
  * remaining flags currently have no effect here.
+ *
+ * The buffers are written in file and block order rather than in buffer
+ * order, so that each file is written sequentially, and the writes are
+ * interleaved between tablespaces in proportion to the number of buffers
+ * each has to write, so that all the disks are kept busy.  After every
+ * checkpoint_flush_after written buffers, we ask the kernel to start
+ * writing them back, rather than leaving all that work to the fsyncs at
+ * the end of the checkpoint.
  */
 static void
 BufferSync(int flags)
 {
 	int			buf_id;
 	int			num_to_scan;
-	int			num_to_write;
+	int			num_spaces;
+	int			num_processed;
 	int			num_written;
+	int			i;
 	int			mask = BM_DIRTY;
+	CkptTsStatus *per_ts_stat;
+	binaryheap *ts_heap;
+	WritebackContext wb_context;
 
 	/* Make sure we can handle the pin inside SyncOneBuffer */
 	ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
@@ -1231,8 +1499,9 @@ BufferSync(int flags)
 
 	/*
 	 * Loop over all buffers, and mark the ones that need to be written with
-	 * BM_CHECKPOINT_NEEDED.  Count them as we go (num_to_write), so that we
-	 * can estimate how much work needs to be done.
+	 * BM_CHECKPOINT_NEEDED.  Remember them in CkptBufferIds along with the
+	 * block they hold, so that we can sort them, and count them as we go
+	 * (num_to_scan), so that we can estimate how much work needs to be done.
 	 *
 	 * This allows us to write only those pages that were dirty when the
 	 * checkpoint began, and not those that get dirtied while it proceeds.
@@ -1245,7 +1514,7 @@ BufferSync(int flags)
 	 * BM_CHECKPOINT_NEEDED still set.	This is OK since any such buffer would
 	 * certainly need to be written for the next checkpoint attempt, too.
 	 */
-	num_to_write = 0;
+	num_to_scan = 0;
 	for (buf_id = 0; buf_id < NBuffers; buf_id++)
 	{
 		volatile BufferDesc *bufHdr = &BufferDescriptors[buf_id];
@@ -1258,32 +1527,97 @@ BufferSync(int flags)
 
 		if ((bufHdr->flags & mask) == mask)
 		{
+			CkptSortItem *item;
+
 			bufHdr->flags |= BM_CHECKPOINT_NEEDED;
-			num_to_write++;
+
+			item = &CkptBufferIds[num_to_scan++];
+			item->buf_id = buf_id;
+			item->tsId = bufHdr->tag.rnode.spcNode;
+			item->relNode = bufHdr->tag.rnode.relNode;
+			item->forkNum = bufHdr->tag.forkNum;
+			item->blockNum = bufHdr->tag.blockNum;
 		}
 
 		UnlockBufHdr(bufHdr);
 	}
 
-	if (num_to_write == 0)
+	if (num_to_scan == 0)
 		return;					/* nothing to do */
 
-	TRACE_POSTGRESQL_BUFFER_SYNC_START(NBuffers, num_to_write);
+	TRACE_POSTGRESQL_BUFFER_SYNC_START(NBuffers, num_to_scan);
 
 	/*
-	 * Loop over all buffers again, and write the ones (still) marked with
-	 * BM_CHECKPOINT_NEEDED.  In this loop, we start at the clock sweep point
-	 * since we might as well dump soon-to-be-recycled buffers first.
+	 * Sort the buffers to write by tablespace, file and block.  The tags
+	 * may have changed since we looked at them, if the buffers were evicted
+	 * meanwhile, but that only makes the order less perfect.
+	 */
+	qsort(CkptBufferIds, num_to_scan, sizeof(CkptSortItem),
+		  ckpt_buforder_comparator);
+
+	/*
+	 * Set up the progress tracking for each tablespace.  Since the array is
+	 * sorted by tablespace first, each tablespace's buffers are a contiguous
+	 * range of it.
+	 */
+	num_spaces = 0;
+	per_ts_stat = NULL;
+	for (i = 0; i < num_to_scan; i++)
+	{
+		CkptTsStatus *s;
+
+		if (i == 0 || CkptBufferIds[i].tsId != CkptBufferIds[i - 1].tsId)
+		{
+			if (per_ts_stat == NULL)
+				per_ts_stat = (CkptTsStatus *) palloc(sizeof(CkptTsStatus));
+			else
+				per_ts_stat = (CkptTsStatus *)
+					repalloc(per_ts_stat, sizeof(CkptTsStatus) * (num_spaces + 1));
+
+			s = &per_ts_stat[num_spaces++];
+			s->tsId = CkptBufferIds[i].tsId;
+			s->progress = 0;
+			s->num_to_scan = 0;
+			s->num_scanned = 0;
+			s->index = i;
+		}
+		per_ts_stat[num_spaces - 1].num_to_scan++;
+	}
+
+	/*
+	 * Always process the tablespace that is furthest behind next.  A binary
+	 * heap keyed by progress finds it cheaply even with many tablespaces.
+	 */
+	ts_heap = binaryheap_allocate(num_spaces, ts_ckpt_progress_comparator,
+								  (void *) per_ts_stat);
+	for (i = 0; i < num_spaces; i++)
+	{
+		CkptTsStatus *s = &per_ts_stat[i];
+
+		s->progress_slice = (double) num_to_scan / s->num_to_scan;
+		binaryheap_add_unordered(ts_heap, Int32GetDatum(i));
+	}
+	binaryheap_build(ts_heap);
+
+	WritebackContextInit(&wb_context, &checkpoint_flush_after);
+
+	/*
+	 * Loop over the sorted buffers, and write the ones (still) marked with
+	 * BM_CHECKPOINT_NEEDED.
 	 *
 	 * Note that we don't read the buffer alloc count here --- that should be
 	 * left untouched till the next BgBufferSync() call.
 	 */
-	buf_id = StrategySyncStart(NULL, NULL);
-	num_to_scan = NBuffers;
+	num_processed = 0;
 	num_written = 0;
-	while (num_to_scan-- > 0)
+	while (!binaryheap_empty(ts_heap))
 	{
-		volatile BufferDesc *bufHdr = &BufferDescriptors[buf_id];
+		CkptTsStatus *ts_stat = &per_ts_stat[
+							DatumGetInt32(binaryheap_first(ts_heap))];
+		volatile BufferDesc *bufHdr;
+
+		buf_id = CkptBufferIds[ts_stat->index].buf_id;
+		bufHdr = &BufferDescriptors[buf_id];
 
 		/*
 		 * We don't need to acquire the lock here, because we're only looking
@@ -1299,44 +1633,49 @@ BufferSync(int flags)
 		 */
 		if (bufHdr->flags & BM_CHECKPOINT_NEEDED)
 		{
-			if (SyncOneBuffer(buf_id, false) & BUF_WRITTEN)
+			if (SyncOneBuffer(buf_id, false, &wb_context) & BUF_WRITTEN)
 			{
 				TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(buf_id);
 				BgWriterStats.m_buf_written_checkpoints++;
 				num_written++;
-
-				/*
-				 * We know there are at most num_to_write buffers with
-				 * BM_CHECKPOINT_NEEDED set; so we can stop scanning if
-				 * num_written reaches num_to_write.
-				 *
-				 * Note that num_written doesn't include buffers written by
-				 * other backends, or by the bgwriter cleaning scan. That
-				 * means that the estimate of how much progress we've made is
-				 * conservative, and also that this test will often fail to
-				 * trigger.  But it seems worth making anyway.
-				 */
-				if (num_written >= num_to_write)
-					break;
-
-				/*
-				 * Sleep to throttle our I/O rate.
-				 */
-				CheckpointWriteDelay(flags, (double) num_written / num_to_write);
 			}
 		}
 
-		if (++buf_id >= NBuffers)
-			buf_id = 0;
+		/*
+		 * Measure progress by the buffers processed, not the buffers
+		 * written: those written by other backends or the bgwriter in the
+		 * meantime are done, too.
+		 */
+		num_processed++;
+		ts_stat->progress += ts_stat->progress_slice;
+		ts_stat->num_scanned++;
+		ts_stat->index++;
+
+		if (ts_stat->num_scanned == ts_stat->num_to_scan)
+			binaryheap_remove_first(ts_heap);
+		else
+			binaryheap_replace_first(ts_heap,
+									 Int32GetDatum(ts_stat - per_ts_stat));
+
+		/*
+		 * Sleep to throttle our I/O rate.
+		 */
+		CheckpointWriteDelay(flags, (double) num_processed / num_to_scan);
 	}
 
+	/* issue all pending flushes */
+	IssuePendingWritebacks(&wb_context);
+
+	pfree(per_ts_stat);
+	binaryheap_free(ts_heap);
+
 	/*
 	 * Update checkpoint statistics. As noted above, this doesn't include
 	 * buffers written by other backends or bgwriter scan.
 	 */
 	CheckpointStats.ckpt_bufs_written += num_written;
 
-	TRACE_POSTGRESQL_BUFFER_SYNC_DONE(NBuffers, num_written, num_to_write);
+	TRACE_POSTGRESQL_BUFFER_SYNC_DONE(NBuffers, num_written, num_to_scan);
 }
 
 /*
@@ -1349,14 +1688,18 @@ BufferSync(int flags)
  * has been "lapped" and no buffer allocations have occurred recently,
  * or if the bgwriter has been effectively disabled by setting
  * bgwriter_lru_maxpages to 0.)
+ *
+ * The buffers written are added to wb_context, which the bgwriter keeps
+ * across calls.
  */
 bool
-BgBufferSync(void)
+BgBufferSync(WritebackContext *wb_context)
 {
 	/* info obtained from freelist.c */
 	int			strategy_buf_id;
 	uint32		strategy_passes;
 	uint32		recent_alloc;
+	uint32		freelist_alloc;
 
 	/*
 	 * Information saved between calls so we can determine the strategy
@@ -1368,6 +1711,12 @@ BgBufferSync(void)
 	static int	next_to_clean;
 	static uint32 next_passes;
 
+	/*
+	 * How far past the clock hand the buffers taken from the freelists have
+	 * effectively moved the strategy point.
+	 */
+	static long freelist_lead = 0;
+
 	/* Moving averages of allocation rate and clean-buffer density */
 	static float smoothed_alloc = 0;
 	static float smoothed_density = 10.0;
@@ -1378,6 +1727,7 @@ BgBufferSync(void)
 
 	/* Used to compute how far we scan ahead */
 	long		strategy_delta;
+	uint32		clock_alloc;
 	int			bufs_to_lap;
 	int			bufs_ahead;
 	float		scans_per_alloc;
@@ -1398,7 +1748,8 @@ BgBufferSync(void)
 	 * Find out where the freelist clock sweep currently is, and how many
 	 * buffer allocations have happened since our last call.
 	 */
-	strategy_buf_id = StrategySyncStart(&strategy_passes, &recent_alloc);
+	strategy_buf_id = StrategySyncStart(&strategy_passes, &recent_alloc,
+										&freelist_alloc);
 
 	/* Report buffer alloc counts to pgstat */
 	BgWriterStats.m_buf_alloc += recent_alloc;
@@ -1469,6 +1820,7 @@ BgBufferSync(void)
 			next_to_clean = strategy_buf_id;
 			next_passes = strategy_passes;
 			bufs_to_lap = NBuffers;
+			freelist_lead = 0;
 		}
 	}
 	else
@@ -1485,6 +1837,7 @@ BgBufferSync(void)
 		next_to_clean = strategy_buf_id;
 		next_passes = strategy_passes;
 		bufs_to_lap = NBuffers;
+		freelist_lead = 0;
 	}
 
 	/* Update saved info for next time */
@@ -1495,12 +1848,18 @@ BgBufferSync(void)
 	/*
 	 * Compute how many buffers had to be scanned for each new allocation, ie,
 	 * 1/density of reusable buffers, and track a moving average of that.
+	 * Only allocations made by the clock sweep moved the strategy point; the
+	 * freelists serve the rest from buffers we prefilled.  (The two counters
+	 * aren't read atomically together, so guard against the freelist count
+	 * running slightly ahead.)
 	 *
 	 * If the strategy point didn't move, we don't update the density estimate
 	 */
-	if (strategy_delta > 0 && recent_alloc > 0)
+	clock_alloc = (recent_alloc > freelist_alloc) ?
+		recent_alloc - freelist_alloc : 0;
+	if (strategy_delta > 0 && clock_alloc > 0)
 	{
-		scans_per_alloc = (float) strategy_delta / (float) recent_alloc;
+		scans_per_alloc = (float) strategy_delta / (float) clock_alloc;
 		smoothed_density += (scans_per_alloc - smoothed_density) /
 			smoothing_samples;
 	}
@@ -1509,9 +1868,21 @@ BgBufferSync(void)
 	 * Estimate how many reusable buffers there are between the current
 	 * strategy point and where we've scanned ahead to, based on the smoothed
 	 * density estimate.
+	 *
+	 * Buffers taken from the freelists were consumed out of the stretch we
+	 * cleaned ahead of the clock hand, without moving it.  Treat each as
+	 * having advanced the strategy point by as many buffers as the clock
+	 * sweep would have scanned to find it; the hand's own progress since
+	 * last time eats into that lead.  Otherwise we'd keep counting buffers
+	 * that are already gone, and stop cleaning just when backends are
+	 * living off our work.
 	 */
 	bufs_ahead = NBuffers - bufs_to_lap;
-	reusable_buffers_est = (float) bufs_ahead / smoothed_density;
+	freelist_lead = Max(freelist_lead - strategy_delta, 0);
+	freelist_lead += (long) (freelist_alloc * smoothed_density);
+	freelist_lead = Min(freelist_lead, bufs_ahead);
+	reusable_buffers_est = (float) (bufs_ahead - freelist_lead) /
+		smoothed_density;
 
 	/*
 	 * Track a moving average of recent buffer allocations.  Here, rather than
@@ -1576,7 +1947,15 @@ BgBufferSync(void)
 	/* Execute the LRU scan */
 	while (num_to_scan > 0 && reusable_buffers < upcoming_alloc_est)
 	{
-		int			buffer_state = SyncOneBuffer(next_to_clean, true);
+		int			buffer_state = SyncOneBuffer(next_to_clean, true,
+													 wb_context);
+
+		/*
+		 * Put clean buffers that nobody is using onto the freelists, so that
+		 * backends can grab them without running the clock sweep.
+		 */
+		if (buffer_state & BUF_REUSABLE)
+			StrategyPrefillBuffer(&BufferDescriptors[next_to_clean]);
 
 		if (++next_to_clean >= NBuffers)
 		{
@@ -1650,13 +2029,17 @@ BgBufferSync(void)
  * (BUF_WRITTEN could be set in error if FlushBuffers finds the buffer clean
  * after locking it, but we don't care all that much.)
  *
+ * A written buffer is added to wb_context, to have the kernel write it back
+ * to disk soon.
+ *
  * Note: caller must have done ResourceOwnerEnlargeBuffers.
  */
 static int
-SyncOneBuffer(int buf_id, bool skip_recently_used)
+SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
 {
 	volatile BufferDesc *bufHdr = &BufferDescriptors[buf_id];
 	int			result = 0;
+	BufferTag	tag;
 
 	/*
 	 * Check whether buffer needs writing.
@@ -1695,8 +2078,13 @@ SyncOneBuffer(int buf_id, bool skip_recently_used)
 	FlushBuffer(bufHdr, NULL);
 
 	LWLockRelease(bufHdr->content_lock);
+
+	tag = bufHdr->tag;
+
 	UnpinBuffer(bufHdr, true);
 
+	ScheduleBufferTagForWriteback(wb_context, &tag);
+
 	return result | BUF_WRITTEN;
 }
 
@@ -2124,16 +2512,29 @@ BufferGetLSNAtomic(Buffer buffer)
  *		that no other process could be trying to load more pages of the
  *		relation into buffers.
  *
- *		XXX currently it sequentially searches the buffer pool, should be
- *		changed to more clever ways of searching.  However, this routine
- *		is used only in code paths that aren't very performance-critical,
- *		and we shouldn't slow down the hot paths to make it faster ...
+ *		If the blocks to drop are few compared to shared_buffers, we look up
+ *		each of them in the buffer mapping table, so that dropping or
+ *		truncating a small relation doesn't cost time proportional to
+ *		shared_buffers.  Otherwise we sequentially search the buffer pool.
+ *
+ *		The lookup relies on smgrnblocks() giving the true size of the fork,
+ *		which it does as long as nobody can be extending it.  During normal
+ *		running the caller's lock ensures that.  During recovery, drops and
+ *		truncations are replayed only at parallel redo barriers, when all
+ *		the redo workers are idle (see xlogparallel.c).  A per-backend cache
+ *		of the size would not do, since it doesn't see extensions made by
+ *		other processes.  Blocks beyond the end of the file can still have
+ *		buffers if extending the relation failed, or if reading past EOF
+ *		with zero_damaged_pages left a zero-filled page.  Neither holds any
+ *		data, and ReadBuffer_common copes with finding them when the
+ *		relation is extended again, so they may be left alone.
  * --------------------------------------------------------------------
  */
 void
-DropRelFileNodeBuffers(RelFileNodeBackend rnode, ForkNumber forkNum,
+DropRelFileNodeBuffers(SMgrRelation smgr_reln, ForkNumber forkNum,
 					   BlockNumber firstDelBlock)
 {
+	RelFileNodeBackend rnode = smgr_reln->smgr_rnode;
 	int			i;
 
 	/* If it's a local relation, it's localbuf.c's problem. */
@@ -2144,6 +2545,27 @@ DropRelFileNodeBuffers(RelFileNodeBackend rnode, ForkNumber forkNum,
 		return;
 	}
 
+	/*
+	 * A fork that doesn't exist has no buffers.  Otherwise, only blocks
+	 * below the current end of the file can have buffers worth dropping.
+	 */
+	if (!smgrexists(smgr_reln, forkNum))
+		return;
+	else
+	{
+		BlockNumber nForkBlock = smgrnblocks(smgr_reln, forkNum);
+
+		if (nForkBlock <= firstDelBlock)
+			return;
+
+		if (nForkBlock - firstDelBlock < BUF_DROP_FULL_SCAN_THRESHOLD)
+		{
+			FindAndDropRelFileNodeBuffers(rnode.node, forkNum, nForkBlock,
+										  firstDelBlock);
+			return;
+		}
+	}
+
 	for (i = 0; i < NBuffers; i++)
 	{
 		volatile BufferDesc *bufHdr = &BufferDescriptors[i];
@@ -2187,28 +2609,35 @@ DropRelFileNodeBuffers(RelFileNodeBackend rnode, ForkNumber forkNum,
  * --------------------------------------------------------------------
  */
 void
-DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes)
+DropRelFileNodesAllBuffers(SMgrRelation *smgr_reln, int nnodes)
 {
 	int			i,
+				j,
 				n = 0;
+	SMgrRelation *rels;
+	BlockNumber (*block)[MAX_FORKNUM + 1];
+	uint32		nBlocksToInvalidate = 0;
+	bool		use_lookup = true;
 	RelFileNode *nodes;
 	bool		use_bsearch;
 
 	if (nnodes == 0)
 		return;
 
-	nodes = palloc(sizeof(RelFileNode) * nnodes);		/* non-local relations */
+	rels = palloc(sizeof(SMgrRelation) * nnodes);		/* non-local relations */
 
 	/* If it's a local relation, it's localbuf.c's problem. */
 	for (i = 0; i < nnodes; i++)
 	{
-		if (RelFileNodeBackendIsTemp(rnodes[i]))
+		RelFileNodeBackend rnode = smgr_reln[i]->smgr_rnode;
+
+		if (RelFileNodeBackendIsTemp(rnode))
 		{
-			if (rnodes[i].backend == MyBackendId)
-				DropRelFileNodeAllLocalBuffers(rnodes[i].node);
+			if (rnode.backend == MyBackendId)
+				DropRelFileNodeAllLocalBuffers(rnode.node);
 		}
 		else
-			nodes[n++] = rnodes[i].node;
+			rels[n++] = smgr_reln[i];
 	}
 
 	/*
@@ -2217,10 +2646,63 @@ DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes)
 	 */
 	if (n == 0)
 	{
-		pfree(nodes);
+		pfree(rels);
+		return;
+	}
+
+	/*
+	 * If the relations are small in total, look up each of their blocks in
+	 * the buffer mapping table, as in DropRelFileNodeBuffers.  Forks that
+	 * don't exist have no buffers.  Stop counting as soon as it's clear that
+	 * a full scan of the buffer pool will be cheaper.
+	 */
+	block = palloc(sizeof(BlockNumber) * n * (MAX_FORKNUM + 1));
+	for (i = 0; i < n && use_lookup; i++)
+	{
+		for (j = 0; j <= MAX_FORKNUM; j++)
+		{
+			if (!smgrexists(rels[i], j))
+			{
+				block[i][j] = InvalidBlockNumber;
+				continue;
+			}
+
+			block[i][j] = smgrnblocks(rels[i], j);
+			nBlocksToInvalidate += block[i][j];
+			if (nBlocksToInvalidate >= BUF_DROP_FULL_SCAN_THRESHOLD)
+			{
+				use_lookup = false;
+				break;
+			}
+		}
+	}
+
+	if (use_lookup)
+	{
+		for (i = 0; i < n; i++)
+		{
+			for (j = 0; j <= MAX_FORKNUM; j++)
+			{
+				if (block[i][j] == InvalidBlockNumber)
+					continue;
+
+				FindAndDropRelFileNodeBuffers(rels[i]->smgr_rnode.node, j,
+											  block[i][j], 0);
+			}
+		}
+
+		pfree(block);
+		pfree(rels);
 		return;
 	}
 
+	pfree(block);
+
+	nodes = palloc(sizeof(RelFileNode) * n);
+	for (i = 0; i < n; i++)
+		nodes[i] = rels[i]->smgr_rnode.node;
+	pfree(rels);
+
 	/*
 	 * For low number of relations to drop just use a simple walk through, to
 	 * save the bsearch overhead. The threshold to use is rather a guess than
@@ -2277,6 +2759,63 @@ DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes)
 	pfree(nodes);
 }
 
+/* ---------------------------------------------------------------------
+ *		FindAndDropRelFileNodeBuffers
+ *
+ *		This function performs the work of DropRelFileNodeBuffers for a
+ *		fork of nForkBlock blocks by looking up each block from
+ *		firstDelBlock onwards in the buffer mapping table, rather than by
+ *		scanning the whole buffer pool.
+ * --------------------------------------------------------------------
+ */
+static void
+FindAndDropRelFileNodeBuffers(RelFileNode rnode, ForkNumber forkNum,
+							  BlockNumber nForkBlock,
+							  BlockNumber firstDelBlock)
+{
+	BlockNumber curBlock;
+
+	for (curBlock = firstDelBlock; curBlock < nForkBlock; curBlock++)
+	{
+		BufferTag	bufTag;		/* identity of requested block */
+		uint32		bufHash;	/* hash value for tag */
+		LWLockId	bufPartitionLock;	/* buffer partition lock for it */
+		int			buf_id;
+		volatile BufferDesc *bufHdr;
+
+		/* create a tag so we can lookup the buffer */
+		INIT_BUFFERTAG(bufTag, rnode, forkNum, curBlock);
+
+		/* determine its hash code and partition lock ID */
+		bufHash = BufTableHashCode(&bufTag);
+		bufPartitionLock = BufMappingPartitionLock(bufHash);
+
+		/* Check that it is in the buffer pool. If not, do nothing. */
+		LWLockAcquire(bufPartitionLock, LW_SHARED);
+		buf_id = BufTableLookup(&bufTag, bufHash);
+		LWLockRelease(bufPartitionLock);
+
+		if (buf_id < 0)
+			continue;
+
+		bufHdr = &BufferDescriptors[buf_id];
+
+		/*
+		 * We need to lock the buffer header and recheck if the buffer is
+		 * still associated with the same block because the buffer could be
+		 * evicted by some other backend loading blocks for a different
+		 * relation after we release the lock on the BufMapping table.
+		 */
+		LockBufHdr(bufHdr);
+		if (RelFileNodeEquals(bufHdr->tag.rnode, rnode) &&
+			bufHdr->tag.forkNum == forkNum &&
+			bufHdr->tag.blockNum >= firstDelBlock)
+			InvalidateBuffer(bufHdr);	/* releases spinlock */
+		else
+			UnlockBufHdr(bufHdr);
+	}
+}
+
 /* ---------------------------------------------------------------------
  *		DropDatabaseBuffers
  *
@@ -2990,7 +3529,8 @@ WaitIO(volatile BufferDesc *buf)
 /*
  * StartBufferIO: begin I/O on this buffer
  *	(Assumptions)
- *	My process is executing no IO
+ *	My process is executing no IO, or only input IO if forInput is true
+ *	(see ReadBufferRange)
  *	The buffer is Pinned
  *
  * In some scenarios there are race conditions in which multiple backends
@@ -3008,7 +3548,9 @@ WaitIO(volatile BufferDesc *buf)
 static bool
 StartBufferIO(volatile BufferDesc *buf, bool forInput)
 {
-	Assert(!InProgressBuf);
+	/* only input I/Os can be combined */
+	Assert(NumInProgressBufs == 0 || (forInput && IsForInput));
+	Assert(NumInProgressBufs < MAX_IO_COMBINE_LIMIT);
 
 	for (;;)
 	{
@@ -3048,7 +3590,7 @@ StartBufferIO(volatile BufferDesc *buf, bool forInput)
 
 	UnlockBufHdr(buf);
 
-	InProgressBuf = buf;
+	InProgressBufs[NumInProgressBufs++] = buf;
 	IsForInput = forInput;
 
 	return true;
@@ -3075,7 +3617,14 @@ static void
 TerminateBufferIO(volatile BufferDesc *buf, bool clear_dirty,
 				  int set_flag_bits)
 {
-	Assert(buf == InProgressBuf);
+	int			i;
+
+	for (i = NumInProgressBufs - 1; i >= 0; i--)
+	{
+		if (InProgressBufs[i] == buf)
+			break;
+	}
+	Assert(i >= 0);
 
 	LockBufHdr(buf);
 
@@ -3087,7 +3636,8 @@ TerminateBufferIO(volatile BufferDesc *buf, bool clear_dirty,
 
 	UnlockBufHdr(buf);
 
-	InProgressBuf = NULL;
+	/* forget it; order of the remaining entries doesn't matter */
+	InProgressBufs[i] = InProgressBufs[--NumInProgressBufs];
 
 	LWLockRelease(buf->io_in_progress_lock);
 }
@@ -3096,7 +3646,9 @@ TerminateBufferIO(volatile BufferDesc *buf, bool clear_dirty,
  * AbortBufferIO: Clean up any active buffer I/O after an error.
  *
  *	All LWLocks we might have held have been released,
- *	but we haven't yet released buffer pins, so the buffer is still pinned.
+ *	but we haven't yet released buffer pins, so the buffers are still pinned.
+ *	There can be several input I/Os in progress if the error happened in
+ *	ReadBufferRange.
  *
  *	If I/O was in progress, we always set BM_IO_ERROR, even though it's
  *	possible the error condition wasn't related to the I/O.
@@ -3104,10 +3656,10 @@ TerminateBufferIO(volatile BufferDesc *buf, bool clear_dirty,
 void
 AbortBufferIO(void)
 {
-	volatile BufferDesc *buf = InProgressBuf;
-
-	if (buf)
+	while (NumInProgressBufs > 0)
 	{
+		volatile BufferDesc *buf = InProgressBufs[NumInProgressBufs - 1];
+
 		/*
 		 * Since LWLockReleaseAll has already been called, we're not holding
 		 * the buffer's io_in_progress_lock. We have to re-acquire it so that
@@ -3215,3 +3767,179 @@ rnode_comparator(const void *p1, const void *p2)
 	else
 		return 0;
 }
+
+/*
+ * BufferTag comparator, for sorting writeback requests.
+ */
+static int
+buffertag_comparator(const void *a, const void *b)
+{
+	const BufferTag *ba = (const BufferTag *) a;
+	const BufferTag *bb = (const BufferTag *) b;
+	int			ret;
+
+	ret = rnode_comparator(&ba->rnode, &bb->rnode);
+	if (ret != 0)
+		return ret;
+
+	if (ba->forkNum < bb->forkNum)
+		return -1;
+	if (ba->forkNum > bb->forkNum)
+		return 1;
+
+	if (ba->blockNum < bb->blockNum)
+		return -1;
+	if (ba->blockNum > bb->blockNum)
+		return 1;
+
+	return 0;
+}
+
+/*
+ * Comparator determining the order in which BufferSync writes buffers:
+ * by tablespace, then by file, then by block.  Grouping by tablespace is
+ * what allows BufferSync to balance the writes across tablespaces.
+ */
+static int
+ckpt_buforder_comparator(const void *pa, const void *pb)
+{
+	const CkptSortItem *a = (const CkptSortItem *) pa;
+	const CkptSortItem *b = (const CkptSortItem *) pb;
+
+	if (a->tsId < b->tsId)
+		return -1;
+	else if (a->tsId > b->tsId)
+		return 1;
+	if (a->relNode < b->relNode)
+		return -1;
+	else if (a->relNode > b->relNode)
+		return 1;
+	if (a->forkNum < b->forkNum)
+		return -1;
+	else if (a->forkNum > b->forkNum)
+		return 1;
+	if (a->blockNum < b->blockNum)
+		return -1;
+	else if (a->blockNum > b->blockNum)
+		return 1;
+	/* equal page IDs are unlikely, but not impossible */
+	return 0;
+}
+
+/*
+ * Comparator for the tablespace heap in BufferSync.  binaryheap is a
+ * max-heap, so this sorts the tablespace with the least progress first.
+ */
+static int
+ts_ckpt_progress_comparator(Datum a, Datum b, void *arg)
+{
+	CkptTsStatus *per_ts_stat = (CkptTsStatus *) arg;
+	CkptTsStatus *sa = &per_ts_stat[DatumGetInt32(a)];
+	CkptTsStatus *sb = &per_ts_stat[DatumGetInt32(b)];
+
+	if (sa->progress < sb->progress)
+		return 1;
+	else if (sa->progress > sb->progress)
+		return -1;
+	else
+		return 0;
+}
+
+/*
+ * Initialize a writeback context, discarding any pending requests.
+ *
+ * *max_pending is the number of buffers after which the requests are
+ * issued; it's normally a GUC variable, so it's looked at anew each time.
+ */
+void
+WritebackContextInit(WritebackContext *context, int *max_pending)
+{
+	Assert(*max_pending <= WRITEBACK_MAX_PENDING_FLUSHES);
+
+	context->max_pending = max_pending;
+	context->nr_pending = 0;
+}
+
+/*
+ * Add the buffer with the given tag, which has just been written, to the
+ * pending writeback requests, and issue them if there are enough.
+ */
+void
+ScheduleBufferTagForWriteback(WritebackContext *context, BufferTag *tag)
+{
+	/* writeback control may be disabled */
+	if (*context->max_pending > 0)
+	{
+		Assert(*context->max_pending <= WRITEBACK_MAX_PENDING_FLUSHES);
+
+		context->pending_writebacks[context->nr_pending++].tag = *tag;
+	}
+
+	/*
+	 * Issue the requests if we've reached the limit.  This also flushes out
+	 * any requests left over if writeback control was disabled since they
+	 * were queued.
+	 */
+	if (context->nr_pending >= *context->max_pending)
+		IssuePendingWritebacks(context);
+}
+
+/*
+ * Ask the kernel to write back all the buffers in the writeback context.
+ *
+ * The requests are sorted, and consecutive blocks of the same file are
+ * merged into one request, which the kernel handles much more efficiently.
+ * The buffers may have been written again, or evicted and replaced, since
+ * they were queued; that is harmless, as writeback only affects kernel
+ * state.
+ */
+void
+IssuePendingWritebacks(WritebackContext *context)
+{
+	int			i;
+
+	if (context->nr_pending == 0)
+		return;
+
+	qsort(context->pending_writebacks, context->nr_pending,
+		  sizeof(PendingWriteback), buffertag_comparator);
+
+	/*
+	 * Collect runs of requests for consecutive blocks, and issue each run
+	 * with a single call.
+	 */
+	for (i = 0; i < context->nr_pending; i++)
+	{
+		BufferTag  *cur = &context->pending_writebacks[i].tag;
+		BlockNumber nblocks = 1;
+		SMgrRelation reln;
+		int			ahead;
+
+		for (ahead = 0; i + ahead + 1 < context->nr_pending; ahead++)
+		{
+			BufferTag  *next = &context->pending_writebacks[i + ahead + 1].tag;
+
+			/* different file, stop */
+			if (!RelFileNodeEquals(cur->rnode, next->rnode) ||
+				cur->forkNum != next->forkNum)
+				break;
+
+			/* the same block may be queued more than once; skip it */
+			if (cur->blockNum + nblocks - 1 == next->blockNum)
+				continue;
+
+			/* not consecutive, stop */
+			if (cur->blockNum + nblocks != next->blockNum)
+				break;
+
+			nblocks++;
+		}
+
+		i += ahead;
+
+		reln = smgropen(cur->rnode, InvalidBackendId);
+		smgrwriteback(reln, cur->forkNum, cur->blockNum, nblocks);
+	}
+
+	context->nr_pending = 0;
+}
@@ -15,17 +15,20 @@
  */
 #include "postgres.h"
 
+#include "miscadmin.h"
+#include "port/atomics.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
 
 
 /*
- * The shared freelist control information.
+ * One of the partitions of the list of free buffers.  Buffer buf_id always
+ * belongs to partition buf_id % NUM_BUFFER_FREELISTS, whose spinlock
+ * protects the freeNext links of its buffers.
  */
 typedef struct
 {
-	/* Clock sweep hand: index of next buffer to consider grabbing */
-	int			nextVictimBuffer;
+	slock_t		lock;			/* protects the fields below */
 
 	int			firstFreeBuffer;	/* Head of list of unused buffers */
 	int			lastFreeBuffer; /* Tail of list of unused buffers */
@@ -34,20 +37,54 @@ typedef struct
 	 * NOTE: lastFreeBuffer is undefined when firstFreeBuffer is -1 (that is,
 	 * when the list is empty)
 	 */
+} BufferFreelist;
+
+/*
+ * Pad each freelist to a cache line, so that backends working on different
+ * freelists don't interfere with each other.
+ */
+#define BUFFER_FREELIST_PADDED_SIZE		64
+
+typedef union BufferFreelistPadded
+{
+	BufferFreelist list;
+	char		pad[BUFFER_FREELIST_PADDED_SIZE];
+} BufferFreelistPadded;
+
+/*
+ * The shared freelist control information.
+ */
+typedef struct
+{
+	/*
+	 * Clock sweep hand: index of next buffer to consider grabbing.  This is
+	 * advanced with an atomic increment and is allowed to run past NBuffers
+	 * for a while; see ClockSweepTick.
+	 */
+	pg_atomic_uint32 nextVictimBuffer;
+
+	/* Protects completePasses and bgwriterLatch */
+	slock_t		strategy_lock;
 
 	/*
 	 * Statistics.	These counters should be wide enough that they can't
 	 * overflow during a single bgwriter cycle.
 	 */
 	uint32		completePasses; /* Complete cycles of the clock sweep */
-	uint32		numBufferAllocs;	/* Buffers allocated since last reset */
+	pg_atomic_uint32 numBufferAllocs;	/* Buffers allocated since last reset */
+	pg_atomic_uint32 numFreelistAllocs; /* ... of which came from freelists */
 
 	/*
 	 * Notification latch, or NULL if none.  See StrategyNotifyBgWriter.
 	 */
 	Latch	   *bgwriterLatch;
+
+	BufferFreelistPadded freelists[NUM_BUFFER_FREELISTS];
 } BufferStrategyControl;
 
+#define BufferFreelistFor(buf_id) \
+	(&StrategyControl->freelists[(buf_id) % NUM_BUFFER_FREELISTS].list)
+
 /* Pointers to shared state */
 static BufferStrategyControl *StrategyControl = NULL;
 
@@ -86,11 +123,143 @@ typedef struct BufferAccessStrategyData
 
 
 /* Prototypes for internal functions */
+static uint32 ClockSweepTick(void);
+static volatile BufferDesc *GetBufferFromFreelist(void);
 static volatile BufferDesc *GetBufferFromRing(BufferAccessStrategy strategy);
 static void AddBufferToRing(BufferAccessStrategy strategy,
 				volatile BufferDesc *buf);
 
 
+/*
+ * ClockSweepTick - Helper routine for StrategyGetBuffer()
+ *
+ * Move the clock hand one buffer ahead of its current position and return the
+ * id of the buffer now under the hand.
+ */
+static uint32
+ClockSweepTick(void)
+{
+	uint32		victim;
+
+	/*
+	 * Atomically move hand ahead one buffer - if there's several processes
+	 * doing this, this can lead to buffers being returned slightly out of
+	 * apparent order.
+	 */
+	victim = pg_atomic_fetch_add_u32(&StrategyControl->nextVictimBuffer, 1);
+
+	if (victim >= NBuffers)
+	{
+		uint32		originalVictim = victim;
+
+		/* always wrap what we look up in BufferDescriptors */
+		victim = victim % NBuffers;
+
+		/*
+		 * If we're the one that just caused a wraparound, force
+		 * completePasses to be incremented while holding the spinlock.  We
+		 * need the spinlock so StrategySyncStart() can return a consistent
+		 * value consisting of nextVictimBuffer and completePasses.
+		 */
+		if (victim == 0)
+		{
+			uint32		expected;
+			uint32		wrapped;
+			bool		success = false;
+
+			expected = originalVictim + 1;
+
+			while (!success)
+			{
+				/*
+				 * Acquire the spinlock while increasing completePasses. That
+				 * allows other readers to read nextVictimBuffer and
+				 * completePasses in a consistent manner which is required for
+				 * StrategySyncStart().  In theory delaying the increment
+				 * could lead to an overflow of nextVictimBuffer, but that's
+				 * highly unlikely and wouldn't be particularly harmful.
+				 */
+				SpinLockAcquire(&StrategyControl->strategy_lock);
+
+				wrapped = expected % NBuffers;
+
+				success = pg_atomic_compare_exchange_u32(&StrategyControl->nextVictimBuffer,
+														 &expected, wrapped);
+				if (success)
+					StrategyControl->completePasses++;
+				SpinLockRelease(&StrategyControl->strategy_lock);
+			}
+		}
+	}
+	return victim;
+}
+
+/*
+ * GetBufferFromFreelist - Helper routine for StrategyGetBuffer()
+ *
+ * Returns a usable buffer from the freelists with its header spinlock held,
+ * or NULL if they have none.  We start with the freelist chosen by our PID,
+ * so that concurrent backends mostly work on different freelists, and move
+ * on to the others if it's empty.
+ */
+static volatile BufferDesc *
+GetBufferFromFreelist(void)
+{
+	int			start = MyProcPid % NUM_BUFFER_FREELISTS;
+	int			i;
+
+	for (i = 0; i < NUM_BUFFER_FREELISTS; i++)
+	{
+		volatile BufferFreelist *freelist;
+
+		freelist = &StrategyControl->freelists[(start + i) % NUM_BUFFER_FREELISTS].list;
+
+		/*
+		 * An unlocked peek is good enough to skip lists that look empty; if
+		 * we miss a buffer that's just being added, the clock sweep will
+		 * find us another one.
+		 */
+		while (freelist->firstFreeBuffer >= 0)
+		{
+			volatile BufferDesc *buf;
+
+			SpinLockAcquire(&freelist->lock);
+
+			if (freelist->firstFreeBuffer < 0)
+			{
+				SpinLockRelease(&freelist->lock);
+				break;
+			}
+
+			buf = &BufferDescriptors[freelist->firstFreeBuffer];
+			Assert(buf->freeNext != FREENEXT_NOT_IN_LIST);
+
+			/* Unconditionally remove buffer from freelist */
+			freelist->firstFreeBuffer = buf->freeNext;
+			buf->freeNext = FREENEXT_NOT_IN_LIST;
+
+			/*
+			 * Release the freelist's spinlock before taking the buffer
+			 * header's, so that we never hold two spinlocks at once.
+			 */
+			SpinLockRelease(&freelist->lock);
+
+			/*
+			 * If the buffer is pinned or has a nonzero usage_count, we cannot
+			 * use it; discard it and retry.  (This happens if someone used a
+			 * buffer after VACUUM or the bgwriter put it in the freelist, and
+			 * before we got to it.)
+			 */
+			LockBufHdr(buf);
+			if (buf->refcount == 0 && buf->usage_count == 0)
+				return buf;
+			UnlockBufHdr(buf);
+		}
+	}
+
+	return NULL;
+}
+
 /*
  * StrategyGetBuffer
  *
@@ -101,15 +270,15 @@ static void AddBufferToRing(BufferAccessStrategy strategy,
  *	strategy is a BufferAccessStrategy object, or NULL for default strategy.
  *
  *	To ensure that no one else can pin the buffer before we do, we must
- *	return the buffer with the buffer header spinlock still held.  If
- *	*lock_held is set on exit, we have returned with the BufFreelistLock
- *	still held, as well; the caller must release that lock once the spinlock
- *	is dropped.  We do it that way because releasing the BufFreelistLock
- *	might awaken other processes, and it would be bad to do the associated
- *	kernel calls while holding the buffer header spinlock.
+ *	return the buffer with the buffer header spinlock still held.
+ *
+ *	No lock other than buffer header spinlocks is held for any length of
+ *	time here: the freelists are protected by their own spinlocks, and the
+ *	clock hand is advanced atomically, so that concurrent backends running
+ *	the clock sweep don't serialize on anything but the buffers themselves.
  */
 volatile BufferDesc *
-StrategyGetBuffer(BufferAccessStrategy strategy, bool *lock_held)
+StrategyGetBuffer(BufferAccessStrategy strategy)
 {
 	volatile BufferDesc *buf;
 	Latch	   *bgwriterLatch;
@@ -117,87 +286,64 @@ StrategyGetBuffer(BufferAccessStrategy strategy, bool *lock_held)
 
 	/*
 	 * If given a strategy object, see whether it can select a buffer. We
-	 * assume strategy objects don't need the BufFreelistLock.
+	 * assume strategy objects don't need any locking.
 	 */
 	if (strategy != NULL)
 	{
 		buf = GetBufferFromRing(strategy);
 		if (buf != NULL)
-		{
-			*lock_held = false;
 			return buf;
-		}
 	}
 
-	/* Nope, so lock the freelist */
-	*lock_held = true;
-	LWLockAcquire(BufFreelistLock, LW_EXCLUSIVE);
-
 	/*
-	 * We count buffer allocation requests so that the bgwriter can estimate
-	 * the rate of buffer consumption.	Note that buffers recycled by a
-	 * strategy object are intentionally not counted here.
-	 */
-	StrategyControl->numBufferAllocs++;
-
-	/*
-	 * If bgwriterLatch is set, we need to waken the bgwriter, but we should
-	 * not do so while holding BufFreelistLock; so release and re-grab.  This
-	 * is annoyingly tedious, but it happens at most once per bgwriter cycle,
-	 * so the performance hit is minimal.
+	 * If bgwriterLatch is set, we need to waken the bgwriter.  Do an unlocked
+	 * check first, so that we don't touch the spinlock in the common case;
+	 * it happens at most once per bgwriter cycle anyway.  We must not set
+	 * the latch while holding the spinlock, though.
 	 */
 	bgwriterLatch = StrategyControl->bgwriterLatch;
 	if (bgwriterLatch)
 	{
+		SpinLockAcquire(&StrategyControl->strategy_lock);
+		bgwriterLatch = StrategyControl->bgwriterLatch;
 		StrategyControl->bgwriterLatch = NULL;
-		LWLockRelease(BufFreelistLock);
-		SetLatch(bgwriterLatch);
-		LWLockAcquire(BufFreelistLock, LW_EXCLUSIVE);
+		SpinLockRelease(&StrategyControl->strategy_lock);
+
+		if (bgwriterLatch)
+			SetLatch(bgwriterLatch);
 	}
 
 	/*
-	 * Try to get a buffer from the freelist.  Note that the freeNext fields
-	 * are considered to be protected by the BufFreelistLock not the
-	 * individual buffer spinlocks, so it's OK to manipulate them without
-	 * holding the spinlock.
+	 * We count buffer allocation requests so that the bgwriter can estimate
+	 * the rate of buffer consumption.	Note that buffers recycled by a
+	 * strategy object are intentionally not counted here.
+	 */
+	pg_atomic_fetch_add_u32(&StrategyControl->numBufferAllocs, 1);
+
+	/*
+	 * Try to get a buffer from the freelists.  The bgwriter keeps them
+	 * stocked with clean, unused buffers ahead of the clock hand, so this
+	 * normally succeeds when it's keeping up.
 	 */
-	while (StrategyControl->firstFreeBuffer >= 0)
+	buf = GetBufferFromFreelist();
+	if (buf != NULL)
 	{
-		buf = &BufferDescriptors[StrategyControl->firstFreeBuffer];
-		Assert(buf->freeNext != FREENEXT_NOT_IN_LIST);
-
-		/* Unconditionally remove buffer from freelist */
-		StrategyControl->firstFreeBuffer = buf->freeNext;
-		buf->freeNext = FREENEXT_NOT_IN_LIST;
-
 		/*
-		 * If the buffer is pinned or has a nonzero usage_count, we cannot use
-		 * it; discard it and retry.  (This can only happen if VACUUM put a
-		 * valid buffer in the freelist and then someone else used it before
-		 * we got to it.  It's probably impossible altogether as of 8.3, but
-		 * we'd better check anyway.)
+		 * The clock hand doesn't move for these, so count them separately
+		 * for the bgwriter's estimate of where the strategy point is.
 		 */
-		LockBufHdr(buf);
-		if (buf->refcount == 0 && buf->usage_count == 0)
-		{
-			if (strategy != NULL)
-				AddBufferToRing(strategy, buf);
-			return buf;
-		}
-		UnlockBufHdr(buf);
+		pg_atomic_fetch_add_u32(&StrategyControl->numFreelistAllocs, 1);
+
+		if (strategy != NULL)
+			AddBufferToRing(strategy, buf);
+		return buf;
 	}
 
-	/* Nothing on the freelist, so run the "clock sweep" algorithm */
+	/* Nothing on the freelists, so run the "clock sweep" algorithm */
 	trycounter = NBuffers;
 	for (;;)
 	{
-		buf = &BufferDescriptors[StrategyControl->nextVictimBuffer];
-
-		if (++StrategyControl->nextVictimBuffer >= NBuffers)
-		{
-			StrategyControl->nextVictimBuffer = 0;
-			StrategyControl->completePasses++;
-		}
+		buf = &BufferDescriptors[ClockSweepTick()];
 
 		/*
 		 * If the buffer is pinned or has a nonzero usage_count, we cannot use
@@ -237,11 +383,16 @@ StrategyGetBuffer(BufferAccessStrategy strategy, bool *lock_held)
 
 /*
  * StrategyFreeBuffer: put a buffer on the freelist
+ *
+ * The buffer goes to the head of its freelist, to be reused before anything
+ * else there.  This is used for buffers that no longer hold a valid page.
  */
 void
 StrategyFreeBuffer(volatile BufferDesc *buf)
 {
-	LWLockAcquire(BufFreelistLock, LW_EXCLUSIVE);
+	volatile BufferFreelist *freelist = BufferFreelistFor(buf->buf_id);
+
+	SpinLockAcquire(&freelist->lock);
 
 	/*
 	 * It is possible that we are told to put something in the freelist that
@@ -249,13 +400,41 @@ StrategyFreeBuffer(volatile BufferDesc *buf)
 	 */
 	if (buf->freeNext == FREENEXT_NOT_IN_LIST)
 	{
-		buf->freeNext = StrategyControl->firstFreeBuffer;
+		buf->freeNext = freelist->firstFreeBuffer;
 		if (buf->freeNext < 0)
-			StrategyControl->lastFreeBuffer = buf->buf_id;
-		StrategyControl->firstFreeBuffer = buf->buf_id;
+			freelist->lastFreeBuffer = buf->buf_id;
+		freelist->firstFreeBuffer = buf->buf_id;
 	}
 
-	LWLockRelease(BufFreelistLock);
+	SpinLockRelease(&freelist->lock);
+}
+
+/*
+ * StrategyPrefillBuffer: add a reusable buffer to the tail of its freelist
+ *
+ * The bgwriter calls this for clean, unpinned buffers with zero usage count
+ * that it finds ahead of the clock hand, so that backends can take them from
+ * the freelists instead of running the clock sweep themselves.  Appending
+ * keeps them in clock order, and behind any buffers that are free outright.
+ */
+void
+StrategyPrefillBuffer(volatile BufferDesc *buf)
+{
+	volatile BufferFreelist *freelist = BufferFreelistFor(buf->buf_id);
+
+	SpinLockAcquire(&freelist->lock);
+
+	if (buf->freeNext == FREENEXT_NOT_IN_LIST)
+	{
+		buf->freeNext = FREENEXT_END_OF_LIST;
+		if (freelist->firstFreeBuffer < 0)
+			freelist->firstFreeBuffer = buf->buf_id;
+		else
+			BufferDescriptors[freelist->lastFreeBuffer].freeNext = buf->buf_id;
+		freelist->lastFreeBuffer = buf->buf_id;
+	}
+
+	SpinLockRelease(&freelist->lock);
 }
 
 /*
@@ -265,25 +444,38 @@ StrategyFreeBuffer(volatile BufferDesc *buf)
  * BufferSync() will proceed circularly around the buffer array from there.
  *
  * In addition, we return the completed-pass count (which is effectively
- * the higher-order bits of nextVictimBuffer) and the count of recent buffer
- * allocs if non-NULL pointers are passed.	The alloc count is reset after
- * being read.
+ * the higher-order bits of nextVictimBuffer), the count of recent buffer
+ * allocs, and how many of those were satisfied from the freelists without
+ * advancing the clock hand, if non-NULL pointers are passed.  The alloc
+ * counts are reset after being read.
  */
 int
-StrategySyncStart(uint32 *complete_passes, uint32 *num_buf_alloc)
+StrategySyncStart(uint32 *complete_passes, uint32 *num_buf_alloc,
+				  uint32 *num_freelist_alloc)
 {
+	uint32		nextVictimBuffer;
 	int			result;
 
-	LWLockAcquire(BufFreelistLock, LW_EXCLUSIVE);
-	result = StrategyControl->nextVictimBuffer;
+	SpinLockAcquire(&StrategyControl->strategy_lock);
+	nextVictimBuffer = pg_atomic_read_u32(&StrategyControl->nextVictimBuffer);
+	result = nextVictimBuffer % NBuffers;
+
 	if (complete_passes)
-		*complete_passes = StrategyControl->completePasses;
-	if (num_buf_alloc)
 	{
-		*num_buf_alloc = StrategyControl->numBufferAllocs;
-		StrategyControl->numBufferAllocs = 0;
+		*complete_passes = StrategyControl->completePasses;
+
+		/*
+		 * Additionally add the number of wraparounds that happened before
+		 * completePasses could be incremented. C.f. ClockSweepTick().
+		 */
+		*complete_passes += nextVictimBuffer / NBuffers;
 	}
-	LWLockRelease(BufFreelistLock);
+
+	if (num_buf_alloc)
+		*num_buf_alloc = pg_atomic_fetch_and_u32(&StrategyControl->numBufferAllocs, 0);
+	if (num_freelist_alloc)
+		*num_freelist_alloc = pg_atomic_fetch_and_u32(&StrategyControl->numFreelistAllocs, 0);
+	SpinLockRelease(&StrategyControl->strategy_lock);
 	return result;
 }
 
@@ -299,13 +491,13 @@ void
 StrategyNotifyBgWriter(Latch *bgwriterLatch)
 {
 	/*
-	 * We acquire the BufFreelistLock just to ensure that the store appears
-	 * atomic to StrategyGetBuffer.  The bgwriter should call this rather
-	 * infrequently, so there's no performance penalty from being safe.
+	 * We acquire the spinlock just to ensure that the store appears atomic to
+	 * StrategyGetBuffer.  The bgwriter should call this rather infrequently,
+	 * so there's no performance penalty from being safe.
 	 */
-	LWLockAcquire(BufFreelistLock, LW_EXCLUSIVE);
+	SpinLockAcquire(&StrategyControl->strategy_lock);
 	StrategyControl->bgwriterLatch = bgwriterLatch;
-	LWLockRelease(BufFreelistLock);
+	SpinLockRelease(&StrategyControl->strategy_lock);
 }
 
 
@@ -323,7 +515,7 @@ StrategyShmemSize(void)
 	Size		size = 0;
 
 	/* size of lookup hash table ... see comment in StrategyInitialize */
-	size = add_size(size, BufTableShmemSize(NBuffers + NUM_BUFFER_PARTITIONS));
+	size = add_size(size, BufTableShmemSize(NBuffers + NumBufferPartitions));
 
 	/* size of the shared replacement strategy control block */
 	size = add_size(size, MAXALIGN(sizeof(BufferStrategyControl)));
@@ -335,13 +527,15 @@ StrategyShmemSize(void)
  * StrategyInitialize -- initialize the buffer cache replacement
  *		strategy.
  *
- * Assumes: All of the buffers are already built into a linked list.
+ * Assumes: All of the buffers are already built into NUM_BUFFER_FREELISTS
+ *		linked lists, one per freelist (see InitBufferPool).
  *		Only called by postmaster and only during initialization.
  */
 void
 StrategyInitialize(bool init)
 {
 	bool		found;
+	int			i;
 
 	/*
 	 * Initialize the shared buffer lookup hashtable.
@@ -351,9 +545,9 @@ StrategyInitialize(bool init)
 	 * usage is of course NBuffers entries, but BufferAlloc() tries to insert
 	 * a new entry before deleting the old.  In principle this could be
 	 * happening in each partition concurrently, so we could need as many as
-	 * NBuffers + NUM_BUFFER_PARTITIONS entries.
+	 * NBuffers + NumBufferPartitions entries.
 	 */
-	InitBufTable(NBuffers + NUM_BUFFER_PARTITIONS);
+	InitBufTable(NBuffers + NumBufferPartitions);
 
 	/*
 	 * Get or create the shared strategy control block
@@ -371,18 +565,38 @@ StrategyInitialize(bool init)
 		Assert(init);
 
 		/*
-		 * Grab the whole linked list of free buffers for our strategy. We
-		 * assume it was previously set up by InitBufferPool().
+		 * Grab the linked lists of free buffers for our strategy. We assume
+		 * they were previously set up by InitBufferPool(): list i links
+		 * buffers i, i + NUM_BUFFER_FREELISTS, and so on.
 		 */
-		StrategyControl->firstFreeBuffer = 0;
-		StrategyControl->lastFreeBuffer = NBuffers - 1;
+		for (i = 0; i < NUM_BUFFER_FREELISTS; i++)
+		{
+			BufferFreelist *freelist = &StrategyControl->freelists[i].list;
+
+			SpinLockInit(&freelist->lock);
+			if (i < NBuffers)
+			{
+				freelist->firstFreeBuffer = i;
+				freelist->lastFreeBuffer = i +
+					((NBuffers - 1 - i) / NUM_BUFFER_FREELISTS) *
+					NUM_BUFFER_FREELISTS;
+			}
+			else
+			{
+				freelist->firstFreeBuffer = FREENEXT_END_OF_LIST;
+				freelist->lastFreeBuffer = FREENEXT_END_OF_LIST;
+			}
+		}
+
+		SpinLockInit(&StrategyControl->strategy_lock);
 
 		/* Initialize the clock sweep pointer */
-		StrategyControl->nextVictimBuffer = 0;
+		pg_atomic_init_u32(&StrategyControl->nextVictimBuffer, 0);
 
 		/* Clear statistics */
 		StrategyControl->completePasses = 0;
-		StrategyControl->numBufferAllocs = 0;
+		pg_atomic_init_u32(&StrategyControl->numBufferAllocs, 0);
+		pg_atomic_init_u32(&StrategyControl->numFreelistAllocs, 0);
 
 		/* No pending notification */
 		StrategyControl->bgwriterLatch = NULL;
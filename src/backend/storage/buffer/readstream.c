@@ -0,0 +1,297 @@
+/*-------------------------------------------------------------------------
+ *
+ * readstream.c
+ *	  Look-ahead reading of a sequence of relation blocks.
+ *
+ * A read stream is given a callback that produces the block numbers a scan
+ * is going to need, in order, and hands back pinned buffers for them one at
+ * a time.  Internally it keeps a queue of upcoming blocks, which lets it
+ *
+ * - read runs of consecutive blocks that aren't in the buffer cache with a
+ *	 single vectored read (see ReadBufferRange), up to io_combine_limit
+ *	 blocks at a time, and
+ *
+ * - issue PrefetchBuffer hints for blocks further ahead, so that the kernel
+ *	 can work on several reads concurrently.  The queue is allowed to grow
+ *	 to effective_io_concurrency times io_combine_limit blocks.  Hints are
+ *	 only given for blocks that don't follow the previous one; for
+ *	 sequential access the kernel's own readahead does better.
+ *
+ * The look-ahead distance adapts to the workload: it starts at a single
+ * block, doubles each time a read has to go to disk, and shrinks again when
+ * blocks are found in the buffer cache.  A scan of a cached relation thus
+ * costs about the same as reading it with ReadBufferExtended, while a scan
+ * that has to do I/O quickly ramps up to full-sized reads.
+ *
+ * Only buffers that are about to be returned are pinned: at most
+ * io_combine_limit of them are held by the stream at any time.  Blocks
+ * further ahead are just block numbers in the queue.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/buffer/readstream.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "miscadmin.h"
+#include "storage/readstream.h"
+#include "utils/rel.h"
+
+
+/* Upper limit on the look-ahead distance, in blocks */
+#define MAX_READ_STREAM_DISTANCE	256
+
+typedef struct ReadStreamEntry
+{
+	BlockNumber blocknum;
+	Buffer		buffer;			/* InvalidBuffer if not read yet */
+} ReadStreamEntry;
+
+struct ReadStream
+{
+	Relation	rel;
+	ForkNumber	forknum;
+	BufferAccessStrategy strategy;
+	ReadStreamBlockCB callback;
+	void	   *callback_private_data;
+	size_t		per_buffer_data_size;	/* MAXALIGN'd */
+
+	int			combine_limit;	/* max blocks per ReadBufferRange call */
+	int			max_distance;	/* size of the queue */
+	int			distance;		/* current look-ahead distance */
+	bool		advice_enabled; /* issue PrefetchBuffer hints? */
+	bool		finished;		/* callback returned InvalidBlockNumber */
+	BlockNumber seq_blocknum;	/* block following the last one queued */
+
+	/*
+	 * Circular queue of upcoming blocks, oldest first.  The entries that
+	 * have already been read (and pinned) always form a prefix of the queue.
+	 */
+	int			head;
+	int			count;
+	ReadStreamEntry *entries;
+	char	   *per_buffer_data;
+};
+
+
+static inline void *
+get_per_buffer_data(ReadStream *stream, int idx)
+{
+	if (stream->per_buffer_data_size == 0)
+		return NULL;
+	return stream->per_buffer_data + idx * stream->per_buffer_data_size;
+}
+
+/*
+ * Fill the queue up to the current look-ahead distance, hinting the kernel
+ * about non-sequential blocks as they're added.
+ */
+static void
+read_stream_look_ahead(ReadStream *stream)
+{
+	while (!stream->finished && stream->count < stream->distance)
+	{
+		int			idx = (stream->head + stream->count) % stream->max_distance;
+		BlockNumber blocknum;
+
+		blocknum = stream->callback(stream, stream->callback_private_data,
+									get_per_buffer_data(stream, idx));
+		if (blocknum == InvalidBlockNumber)
+		{
+			stream->finished = true;
+			break;
+		}
+
+		stream->entries[idx].blocknum = blocknum;
+		stream->entries[idx].buffer = InvalidBuffer;
+		stream->count++;
+
+		if (stream->advice_enabled && blocknum != stream->seq_blocknum)
+			PrefetchBuffer(stream->rel, stream->forknum, blocknum);
+		stream->seq_blocknum = blocknum + 1;
+	}
+}
+
+/*
+ * Read the run of consecutive blocks at the head of the queue, and adjust
+ * the look-ahead distance according to whether any I/O was needed.
+ */
+static void
+read_stream_read_run(ReadStream *stream)
+{
+	Buffer		buffers[MAX_IO_COMBINE_LIMIT];
+	BlockNumber first = stream->entries[stream->head].blocknum;
+	int			nblocks = 1;
+	int			nread;
+	int			i;
+
+	while (nblocks < stream->combine_limit && nblocks < stream->count)
+	{
+		int			idx = (stream->head + nblocks) % stream->max_distance;
+
+		if (stream->entries[idx].blocknum != first + nblocks)
+			break;
+		nblocks++;
+	}
+
+	nread = ReadBufferRange(stream->rel, stream->forknum, first, nblocks,
+							stream->strategy, buffers);
+
+	for (i = 0; i < nblocks; i++)
+	{
+		int			idx = (stream->head + i) % stream->max_distance;
+
+		stream->entries[idx].buffer = buffers[i];
+	}
+
+	if (nread > 0)
+		stream->distance = Min(stream->distance * 2, stream->max_distance);
+	else
+		stream->distance = Max(stream->distance - nblocks, 1);
+}
+
+/*
+ * BeginReadStream -- set up a read stream for a relation fork
+ *
+ * callback is called to obtain each block number to read, with
+ * callback_private_data passed through.  If per_buffer_data_size is not
+ * zero, the callback also gets that much space to fill in for each block,
+ * which ReadStreamNextBuffer returns along with the buffer.
+ */
+ReadStream *
+BeginReadStream(Relation rel, ForkNumber forknum,
+				BufferAccessStrategy strategy,
+				ReadStreamBlockCB callback,
+				void *callback_private_data,
+				size_t per_buffer_data_size)
+{
+	ReadStream *stream;
+	int			max_ios = 1;
+
+	stream = (ReadStream *) palloc0(sizeof(ReadStream));
+	stream->rel = rel;
+	stream->forknum = forknum;
+	stream->strategy = strategy;
+	stream->callback = callback;
+	stream->callback_private_data = callback_private_data;
+	stream->per_buffer_data_size = MAXALIGN(per_buffer_data_size);
+
+	/*
+	 * Don't let a single stream pin more than its fair share of shared
+	 * buffers.  Temporary relations have few local buffers, and reading
+	 * them is cheap, so we read those one block at a time.
+	 */
+	stream->combine_limit = Min(io_combine_limit, MAX_IO_COMBINE_LIMIT);
+	stream->combine_limit = Min(stream->combine_limit,
+								NBuffers / Max(MaxBackends, 1));
+	if (RelationUsesLocalBuffers(rel))
+		stream->combine_limit = 1;
+	stream->combine_limit = Max(stream->combine_limit, 1);
+
+#ifdef USE_PREFETCH
+	if (target_prefetch_pages > 0)
+	{
+		stream->advice_enabled = true;
+		max_ios = target_prefetch_pages;
+	}
+#endif
+
+	stream->max_distance = Min(stream->combine_limit * max_ios,
+							   MAX_READ_STREAM_DISTANCE);
+	stream->max_distance = Max(stream->max_distance, stream->combine_limit);
+
+	stream->entries = (ReadStreamEntry *)
+		palloc(stream->max_distance * sizeof(ReadStreamEntry));
+	if (stream->per_buffer_data_size > 0)
+		stream->per_buffer_data =
+			palloc(stream->max_distance * stream->per_buffer_data_size);
+
+	ResetReadStream(stream);
+
+	return stream;
+}
+
+/*
+ * ReadStreamNextBuffer -- return the next block of the stream, pinned
+ *
+ * Returns InvalidBuffer once the callback has run out of blocks.  The caller
+ * owns the pin on the returned buffer.  If per_buffer_data is not NULL, it
+ * is set to point to the block's per-buffer data, which stays valid until
+ * the next call.
+ */
+Buffer
+ReadStreamNextBuffer(ReadStream *stream, void **per_buffer_data)
+{
+	ReadStreamEntry *entry;
+	Buffer		buffer;
+
+	read_stream_look_ahead(stream);
+
+	if (stream->count == 0)
+	{
+		Assert(stream->finished);
+		if (per_buffer_data)
+			*per_buffer_data = NULL;
+		return InvalidBuffer;
+	}
+
+	entry = &stream->entries[stream->head];
+	if (!BufferIsValid(entry->buffer))
+		read_stream_read_run(stream);
+
+	buffer = entry->buffer;
+	Assert(BufferIsValid(buffer));
+	entry->buffer = InvalidBuffer;
+
+	if (per_buffer_data)
+		*per_buffer_data = get_per_buffer_data(stream, stream->head);
+
+	stream->head = (stream->head + 1) % stream->max_distance;
+	stream->count--;
+
+	return buffer;
+}
+
+/*
+ * ResetReadStream -- forget all queued blocks
+ *
+ * Pins held on blocks read ahead are released, and the callback will be
+ * called again for the next block, even if it had reported the end of the
+ * stream before.
+ */
+void
+ResetReadStream(ReadStream *stream)
+{
+	while (stream->count > 0)
+	{
+		ReadStreamEntry *entry = &stream->entries[stream->head];
+
+		if (BufferIsValid(entry->buffer))
+			ReleaseBuffer(entry->buffer);
+		stream->head = (stream->head + 1) % stream->max_distance;
+		stream->count--;
+	}
+
+	stream->head = 0;
+	stream->finished = false;
+	stream->distance = 1;
+	stream->seq_blocknum = InvalidBlockNumber;
+}
+
+/*
+ * EndReadStream -- release a read stream's resources
+ */
+void
+EndReadStream(ReadStream *stream)
+{
+	ResetReadStream(stream);
+	pfree(stream->entries);
+	if (stream->per_buffer_data)
+		pfree(stream->per_buffer_data);
+	pfree(stream);
+}
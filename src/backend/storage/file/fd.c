@@ -66,6 +66,9 @@
 #ifdef HAVE_SYS_RESOURCE_H
 #include <sys/resource.h>		/* for getrlimit */
 #endif
+#ifndef WIN32
+#include <sys/uio.h>			/* for readv */
+#endif
 
 #include "miscadmin.h"
 #include "access/xact.h"
@@ -1211,6 +1214,48 @@ FilePrefetch(File file, off_t offset, int amount)
 #endif
 }
 
+/*
+ * FileWriteback - ask the kernel to start writing back a given range of the
+ * file, without waiting for it to finish.  The logical seek position is
+ * unaffected.
+ *
+ * This is used to keep the amount of dirty data in the kernel's page cache
+ * bounded, so that a later fsync doesn't have to write out gigabytes at
+ * once.  It is only implemented with sync_file_range; posix_fadvise's
+ * POSIX_FADV_DONTNEED would also throw away the cached pages, which is not
+ * what we want here.  Like pg_flush_data, this is a no-op if enableFsync is
+ * off.  Failure is not fatal, since the data will be fsync'd later anyway.
+ */
+void
+FileWriteback(File file, off_t offset, off_t nbytes)
+{
+#if defined(HAVE_SYNC_FILE_RANGE)
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FileWriteback: %d (%s) " INT64_FORMAT " " INT64_FORMAT,
+			   file, VfdCache[file].fileName,
+			   (int64) offset, (int64) nbytes));
+
+	if (!enableFsync || nbytes <= 0)
+		return;
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return;
+
+	if (sync_file_range(VfdCache[file].fd, offset, nbytes,
+						SYNC_FILE_RANGE_WRITE) != 0)
+		ereport(WARNING,
+				(errcode_for_file_access(),
+				 errmsg("could not flush dirty data in file \"%s\": %m",
+						VfdCache[file].fileName)));
+#else
+	Assert(FileIsValid(file));
+#endif
+}
+
 int
 FileRead(File file, char *buffer, int amount)
 {
@@ -1266,6 +1311,84 @@ retry:
 	return returnCode;
 }
 
+/*
+ * FileReadV --- read into several buffers with a single system call
+ *
+ * Reads nbuffers chunks of "amount" bytes each, starting at the current seek
+ * position, into the given buffers.  Returns the total number of bytes read,
+ * or -1 on failure.  As with FileRead, a result shorter than requested means
+ * that we hit EOF, and callers must deal with it.
+ *
+ * On platforms without readv(), we simply issue one read() per buffer,
+ * stopping at the first short one.
+ */
+int
+FileReadV(File file, char **buffers, int nbuffers, int amount)
+{
+	int			returnCode;
+
+#ifndef WIN32
+	struct iovec iov[MAX_FILE_READV_BUFFERS];
+	int			i;
+#endif
+
+	Assert(FileIsValid(file));
+	Assert(nbuffers > 0 && nbuffers <= MAX_FILE_READV_BUFFERS);
+
+	DO_DB(elog(LOG, "FileReadV: %d (%s) " INT64_FORMAT " %d*%d",
+			   file, VfdCache[file].fileName,
+			   (int64) VfdCache[file].seekPos,
+			   nbuffers, amount));
+
+	if (nbuffers == 1)
+		return FileRead(file, buffers[0], amount);
+
+#ifndef WIN32
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+	for (i = 0; i < nbuffers; i++)
+	{
+		iov[i].iov_base = buffers[i];
+		iov[i].iov_len = amount;
+	}
+
+retry:
+	returnCode = readv(VfdCache[file].fd, iov, nbuffers);
+
+	if (returnCode >= 0)
+		VfdCache[file].seekPos += returnCode;
+	else
+	{
+		/* OK to retry if interrupted */
+		if (errno == EINTR)
+			goto retry;
+
+		/* Trouble, so assume we don't know the file position anymore */
+		VfdCache[file].seekPos = FileUnknownPos;
+	}
+
+	return returnCode;
+#else
+	{
+		int			total = 0;
+		int			i;
+
+		for (i = 0; i < nbuffers; i++)
+		{
+			returnCode = FileRead(file, buffers[i], amount);
+			if (returnCode < 0)
+				return returnCode;
+			total += returnCode;
+			if (returnCode != amount)
+				break;
+		}
+		return total;
+	}
+#endif   /* WIN32 */
+}
+
 int
 FileWrite(File file, char *buffer, int amount)
 {
@@ -18,12 +18,17 @@
 #include "access/heapam.h"
 #include "access/multixact.h"
 #include "access/nbtree.h"
+#include "access/parallel.h"
 #include "access/subtrans.h"
 #include "access/twophase.h"
+#include "access/xlogparallel.h"
+#include "access/xlogprefetch.h"
 #include "commands/async.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "port/atomics.h"
 #include "postmaster/autovacuum.h"
+#include "postmaster/bgworker_internals.h"
 #include "postmaster/bgwriter.h"
 #include "postmaster/postmaster.h"
 #include "replication/walreceiver.h"
@@ -87,6 +92,19 @@ RequestAddinShmemSpace(Size size)
 void
 CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 {
+	/*
+	 * The size of the fast-path lock arrays affects both the shared memory
+	 * size and the lock manager's view of PGPROCs, so every process must set
+	 * it, EXEC_BACKEND children included.
+	 */
+	InitializeFastPathLocks();
+
+	/*
+	 * Likewise the number of buffer mapping partitions, which fixes both the
+	 * LWLock layout and the shape of the shared buffer hashtable.
+	 */
+	InitializeBufferPartitions();
+
 	if (!IsUnderPostmaster)
 	{
 		PGShmemHeader *seghdr;
@@ -110,16 +128,22 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 		size = add_size(size, PredicateLockShmemSize());
 		size = add_size(size, ProcGlobalShmemSize());
 		size = add_size(size, XLOGShmemSize());
+		size = add_size(size, XLogPrefetchShmemSize());
+		size = add_size(size, ParallelRedoShmemSize());
 		size = add_size(size, CLOGShmemSize());
 		size = add_size(size, SUBTRANSShmemSize());
 		size = add_size(size, TwoPhaseShmemSize());
 		size = add_size(size, MultiXactShmemSize());
 		size = add_size(size, LWLockShmemSize());
+		size = add_size(size, AtomicsShmemSize());
 		size = add_size(size, ProcArrayShmemSize());
 		size = add_size(size, BackendStatusShmemSize());
+		size = add_size(size, PgStatShmemSize());
 		size = add_size(size, SInvalShmemSize());
 		size = add_size(size, PMSignalShmemSize());
 		size = add_size(size, ProcSignalShmemSize());
+		size = add_size(size, BackgroundWorkerShmemSize());
+		size = add_size(size, ParallelShmemSize());
 		size = add_size(size, CheckpointerShmemSize());
 		size = add_size(size, AutoVacuumShmemSize());
 		size = add_size(size, WalSndShmemSize());
@@ -175,6 +199,13 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 	if (!IsUnderPostmaster)
 		InitShmemAllocation();
 
+	/*
+	 * Set up the spinlocks behind emulated atomics, if any, before anything
+	 * initializes an atomic variable; LWLocks are the first to.
+	 */
+	if (!IsUnderPostmaster)
+		AtomicsShmemInit();
+
 	/*
 	 * Now initialize LWLocks, which do shared memory allocation and are
 	 * needed for InitShmemIndex.
@@ -191,6 +222,8 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 	 * Set up xlog, clog, and buffers
 	 */
 	XLOGShmemInit();
+	XLogPrefetchShmemInit();
+	ParallelRedoShmemInit();
 	CLOGShmemInit();
 	SUBTRANSShmemInit();
 	MultiXactShmemInit();
@@ -213,6 +246,7 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 		InitProcGlobal();
 	CreateSharedProcArray();
 	CreateSharedBackendStatus();
+	CreateSharedPgStat();
 	TwoPhaseShmemInit();
 
 	/*
@@ -225,6 +259,8 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 	 */
 	PMSignalShmemInit();
 	ProcSignalShmemInit();
+	BackgroundWorkerShmemInit();
+	ParallelShmemInit();
 	CheckpointerShmemInit();
 	AutoVacuumShmemInit();
 	WalSndShmemInit();
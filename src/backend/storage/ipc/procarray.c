@@ -145,6 +145,8 @@ static void DisplayXidCache(void);
 #define xc_slow_answer_inc()		((void) 0)
 #endif   /* XIDCACHE_DEBUG */
 
+static bool GetSnapshotDataReuse(Snapshot snapshot);
+
 /* Primitives for KnownAssignedXids array handling for standby */
 static void KnownAssignedXidsCompress(bool force);
 static void KnownAssignedXidsAdd(TransactionId from_xid, TransactionId to_xid,
@@ -234,6 +236,9 @@ CreateSharedProcArray(void)
 		procArray->headKnownAssignedXids = 0;
 		SpinLockInit(&procArray->known_assigned_xids_lck);
 		procArray->lastOverflowedXid = InvalidTransactionId;
+
+		/* 0 is reserved to mean "no cached snapshot", see GetSnapshotData */
+		ShmemVariableCache->xactCompletionCount = 1;
 	}
 
 	allProcs = ProcGlobal->allProcs;
@@ -337,6 +342,9 @@ ProcArrayRemove(PGPROC *proc, TransactionId latestXid)
 		if (TransactionIdPrecedes(ShmemVariableCache->latestCompletedXid,
 								  latestXid))
 			ShmemVariableCache->latestCompletedXid = latestXid;
+
+		/* Invalidate cached snapshots, as in ProcArrayEndTransaction */
+		ShmemVariableCache->xactCompletionCount++;
 	}
 	else
 	{
@@ -412,6 +420,9 @@ ProcArrayEndTransaction(PGPROC *proc, TransactionId latestXid)
 								  latestXid))
 			ShmemVariableCache->latestCompletedXid = latestXid;
 
+		/* Snapshots built before this point no longer match the ProcArray */
+		ShmemVariableCache->xactCompletionCount++;
+
 		LWLockRelease(ProcArrayLock);
 	}
 	else
@@ -450,11 +461,16 @@ ProcArrayClearTransaction(PGPROC *proc)
 	PGXACT	   *pgxact = &allPgXact[proc->pgprocno];
 
 	/*
-	 * We can skip locking ProcArrayLock here, because this action does not
-	 * actually change anyone's view of the set of running XIDs: our entry is
-	 * duplicate with the gxact that has already been inserted into the
-	 * ProcArray.
+	 * This action does not actually change anyone's view of the set of
+	 * running XIDs: our entry is duplicate with the gxact that has already
+	 * been inserted into the ProcArray.  But our own most recent snapshot
+	 * left out our XID, and it must not be reused now that the XID belongs
+	 * to the gxact; so bump the completion count, which requires the lock.
 	 */
+	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
+
+	ShmemVariableCache->xactCompletionCount++;
+
 	pgxact->xid = InvalidTransactionId;
 	proc->lxid = InvalidLocalTransactionId;
 	pgxact->xmin = InvalidTransactionId;
@@ -467,6 +483,8 @@ ProcArrayClearTransaction(PGPROC *proc)
 	/* Clear the subtransaction-XID cache too */
 	pgxact->nxids = 0;
 	pgxact->overflowed = false;
+
+	LWLockRelease(ProcArrayLock);
 }
 
 /*
@@ -719,6 +737,9 @@ ProcArrayApplyRecoveryInfo(RunningTransactions running)
 
 	Assert(TransactionIdIsNormal(ShmemVariableCache->latestCompletedXid));
 
+	/* KnownAssignedXids and possibly xmax changed */
+	ShmemVariableCache->xactCompletionCount++;
+
 	LWLockRelease(ProcArrayLock);
 
 	/*
@@ -1299,6 +1320,11 @@ GetMaxSnapshotSubxidCount(void)
  *			running transactions, except those running LAZY VACUUM).  This is
  *			the same computation done by GetOldestXmin(true, true).
  *
+ * If no transaction has completed since the given snapshot was last filled
+ * in by this function, its contents would come out exactly the same, and we
+ * skip the scan of the ProcArray (see GetSnapshotDataReuse).  Transactions
+ * that start in the meantime don't matter, since their XIDs are >= xmax.
+ *
  * Note: this function should probably not be called with an argument that's
  * not statically allocated (see xip allocation below).
  */
@@ -1313,6 +1339,7 @@ GetSnapshotData(Snapshot snapshot)
 	int			count = 0;
 	int			subcount = 0;
 	bool		suboverflowed = false;
+	uint64		curXactCompletionCount;
 
 	Assert(snapshot != NULL);
 
@@ -1354,6 +1381,14 @@ GetSnapshotData(Snapshot snapshot)
 	 */
 	LWLockAcquire(ProcArrayLock, LW_SHARED);
 
+	if (GetSnapshotDataReuse(snapshot))
+	{
+		LWLockRelease(ProcArrayLock);
+		return snapshot;
+	}
+
+	curXactCompletionCount = ShmemVariableCache->xactCompletionCount;
+
 	/* xmax is always latestCompletedXid + 1 */
 	xmax = ShmemVariableCache->latestCompletedXid;
 	Assert(TransactionIdIsNormal(xmax));
@@ -1524,9 +1559,48 @@ GetSnapshotData(Snapshot snapshot)
 	snapshot->regd_count = 0;
 	snapshot->copied = false;
 
+	snapshot->snapXactCompletionCount = curXactCompletionCount;
+
 	return snapshot;
 }
 
+/*
+ * GetSnapshotDataReuse -- try to reuse the contents of a previous snapshot
+ *
+ * If the snapshot was built by GetSnapshotData, and no transaction has
+ * completed since (checked via ShmemVariableCache->xactCompletionCount),
+ * the running-XID arrays, xmin and xmax it holds are still exact, so we need
+ * only redo the backend-local bookkeeping.  Returns false if the snapshot
+ * has to be rebuilt.
+ *
+ * Caller must hold ProcArrayLock.  RecentGlobalXmin is left alone: the value
+ * computed along with the snapshot is still a valid, if conservative, bound.
+ */
+static bool
+GetSnapshotDataReuse(Snapshot snapshot)
+{
+	if (snapshot->snapXactCompletionCount == 0 ||
+		snapshot->snapXactCompletionCount !=
+		ShmemVariableCache->xactCompletionCount)
+		return false;
+
+	/*
+	 * Our snapshot's xmin can't have been removed from under us, even if we
+	 * have reset MyPgXact->xmin meanwhile: every XID running when it was
+	 * taken is still running, so nobody's OldestXmin can have passed it.
+	 */
+	if (!TransactionIdIsValid(MyPgXact->xmin))
+		MyPgXact->xmin = TransactionXmin = snapshot->xmin;
+	RecentXmin = snapshot->xmin;
+
+	snapshot->curcid = GetCurrentCommandId(false);
+	snapshot->active_count = 0;
+	snapshot->regd_count = 0;
+	snapshot->copied = false;
+
+	return true;
+}
+
 /*
  * ProcArrayInstallImportedXmin -- install imported xmin into MyPgXact->xmin
  *
@@ -2571,6 +2645,9 @@ XidCacheRemoveRunningXids(TransactionId xid,
 							  latestXid))
 		ShmemVariableCache->latestCompletedXid = latestXid;
 
+	/* The aborted subtransactions are completed, too */
+	ShmemVariableCache->xactCompletionCount++;
+
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -2754,6 +2831,8 @@ ExpireTreeKnownAssignedTransactionIds(TransactionId xid, int nsubxids,
 							  max_xid))
 		ShmemVariableCache->latestCompletedXid = max_xid;
 
+	ShmemVariableCache->xactCompletionCount++;
+
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -2766,6 +2845,7 @@ ExpireAllKnownAssignedTransactionIds(void)
 {
 	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
 	KnownAssignedXidsRemovePreceding(InvalidTransactionId);
+	ShmemVariableCache->xactCompletionCount++;
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -2778,6 +2858,7 @@ ExpireOldKnownAssignedTransactionIds(TransactionId xid)
 {
 	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
 	KnownAssignedXidsRemovePreceding(xid);
+	ShmemVariableCache->xactCompletionCount++;
 	LWLockRelease(ProcArrayLock);
 }
 
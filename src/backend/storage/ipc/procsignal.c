@@ -21,6 +21,7 @@
 #include "miscadmin.h"
 #include "storage/latch.h"
 #include "storage/ipc.h"
+#include "storage/proc.h"
 #include "storage/shmem.h"
 #include "storage/sinval.h"
 #include "tcop/tcopprot.h"
@@ -283,6 +284,14 @@ procsignal_sigusr1_handler(SIGNAL_ARGS)
 	if (CheckProcSignal(PROCSIG_RECOVERY_CONFLICT_BUFFERPIN))
 		RecoveryConflictInterrupt(PROCSIG_RECOVERY_CONFLICT_BUFFERPIN);
 
+	/*
+	 * The postmaster also sends us SIGUSR1 when a background worker we
+	 * registered starts or stops; make sure anyone waiting on our process
+	 * latch for that to happen wakes up.
+	 */
+	if (MyProc != NULL)
+		SetLatch(&MyProc->procLatch);
+
 	latch_sigusr1_handler();
 
 	errno = save_errno;
@@ -0,0 +1,533 @@
+/*-------------------------------------------------------------------------
+ *
+ * shm_mq.c
+ *	  single-reader, single-writer shared memory message queue
+ *
+ * Both the sender and the receiver must have a PGPROC; their respective
+ * process latches are used for synchronization.  Only the sender may send,
+ * and only the receiver may receive.  This is intended to allow a backend
+ * to stream tuples to another backend without any further coordination
+ * beyond agreeing on the address of the queue.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/ipc/shm_mq.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "miscadmin.h"
+#include "storage/latch.h"
+#include "storage/shm_mq.h"
+#include "storage/spin.h"
+
+/*
+ * This structure represents the actual queue, stored in shared memory.
+ *
+ * mq_receiver and mq_sender are set once by the respective process and
+ * never changed afterwards; they are protected by mq_mutex.  mq_bytes_read
+ * is advanced only by the receiver and mq_bytes_written only by the sender,
+ * but both are read by the counterparty, so both are protected by mq_mutex
+ * as well.  Acquiring and releasing the spinlock also acts as a memory
+ * barrier, which guarantees that the ring contents are visible before the
+ * updated counter is.  mq_detached may be set by either side.
+ *
+ * Each message is stored as a Size length word followed by the payload,
+ * each padded out to a MAXALIGN boundary.  Since mq_ring_size is itself a
+ * multiple of MAXIMUM_ALIGNOF, a length word is never split across the end
+ * of the ring; the payload may be, and may also be larger than the ring,
+ * in which case the sender and receiver take turns.
+ */
+struct shm_mq
+{
+	slock_t		mq_mutex;
+	PGPROC	   *mq_receiver;
+	PGPROC	   *mq_sender;
+	uint64		mq_bytes_read;
+	uint64		mq_bytes_written;
+	Size		mq_ring_size;
+	bool		mq_detached;
+	uint8		mq_ring_offset;
+	char		mq_ring[FLEXIBLE_ARRAY_MEMBER];
+};
+
+/*
+ * This structure is a backend-private handle for access to a queue.
+ *
+ * mqh_handle, if not NULL, is the background worker which is expected to
+ * attach to the other end of the queue.  If it exits without ever having
+ * attached, we treat the queue as detached rather than waiting forever.
+ *
+ * The receiver reassembles each message in mqh_buffer, which lives in
+ * mqh_context.  mqh_partial_bytes counts how much of the current message
+ * (including trailing alignment padding) has been consumed so far, and
+ * mqh_expected_bytes is the payload length announced by its length word.
+ * This state allows a non-blocking receive to be resumed where it left off.
+ */
+struct shm_mq_handle
+{
+	shm_mq	   *mqh_queue;
+	BackgroundWorkerHandle *mqh_handle;
+	char	   *mqh_buffer;
+	Size		mqh_buflen;
+	Size		mqh_partial_bytes;
+	Size		mqh_expected_bytes;
+	bool		mqh_length_word_complete;
+	bool		mqh_counterparty_attached;
+	MemoryContext mqh_context;
+};
+
+static shm_mq_result shm_mq_send_bytes(shm_mq_handle *mqh, Size datalen,
+				  Size nbytes, const void *data);
+static void shm_mq_get_bytes(volatile shm_mq *mq, uint64 *readp,
+				 uint64 *writtenp, bool *detachedp);
+static void shm_mq_inc_bytes_read(volatile shm_mq *mq, Size n);
+static void shm_mq_inc_bytes_written(volatile shm_mq *mq, Size n);
+static bool shm_mq_counterparty_gone(volatile shm_mq *mq,
+						 BackgroundWorkerHandle *handle);
+static void shm_mq_wait(void);
+
+/* Minimum queue size is enough for header and at least one chunk of data. */
+const Size	shm_mq_minimum_size =
+MAXALIGN(offsetof(shm_mq, mq_ring)) + MAXIMUM_ALIGNOF;
+
+#define MQH_INITIAL_BUFSIZE				8192
+
+/*
+ * Initialize a new shared message queue.
+ */
+shm_mq *
+shm_mq_create(void *address, Size size)
+{
+	shm_mq	   *mq = address;
+	Size		data_offset = MAXALIGN(offsetof(shm_mq, mq_ring));
+
+	/* If the size isn't MAXALIGN'd, just discard the odd bytes. */
+	size = MAXALIGN_DOWN(size);
+
+	/* Queue size must be large enough to hold some data. */
+	Assert(size > data_offset);
+
+	/* Initialize queue header. */
+	SpinLockInit(&mq->mq_mutex);
+	mq->mq_receiver = NULL;
+	mq->mq_sender = NULL;
+	mq->mq_bytes_read = 0;
+	mq->mq_bytes_written = 0;
+	mq->mq_ring_size = size - data_offset;
+	mq->mq_detached = false;
+	mq->mq_ring_offset = data_offset - offsetof(shm_mq, mq_ring);
+
+	return mq;
+}
+
+/*
+ * Set the identity of the process that will receive from a shared message
+ * queue.
+ */
+void
+shm_mq_set_receiver(shm_mq *mq, PGPROC *proc)
+{
+	volatile shm_mq *vmq = mq;
+	PGPROC	   *sender;
+
+	SpinLockAcquire(&mq->mq_mutex);
+	Assert(vmq->mq_receiver == NULL);
+	vmq->mq_receiver = proc;
+	sender = vmq->mq_sender;
+	SpinLockRelease(&mq->mq_mutex);
+
+	if (sender != NULL)
+		SetLatch(&sender->procLatch);
+}
+
+/*
+ * Set the identity of the process that will send to a shared message queue.
+ */
+void
+shm_mq_set_sender(shm_mq *mq, PGPROC *proc)
+{
+	volatile shm_mq *vmq = mq;
+	PGPROC	   *receiver;
+
+	SpinLockAcquire(&mq->mq_mutex);
+	Assert(vmq->mq_sender == NULL);
+	vmq->mq_sender = proc;
+	receiver = vmq->mq_receiver;
+	SpinLockRelease(&mq->mq_mutex);
+
+	if (receiver != NULL)
+		SetLatch(&receiver->procLatch);
+}
+
+/*
+ * Get the configured receiver.
+ */
+PGPROC *
+shm_mq_get_receiver(shm_mq *mq)
+{
+	volatile shm_mq *vmq = mq;
+	PGPROC	   *receiver;
+
+	SpinLockAcquire(&mq->mq_mutex);
+	receiver = vmq->mq_receiver;
+	SpinLockRelease(&mq->mq_mutex);
+
+	return receiver;
+}
+
+/*
+ * Get the configured sender.
+ */
+PGPROC *
+shm_mq_get_sender(shm_mq *mq)
+{
+	volatile shm_mq *vmq = mq;
+	PGPROC	   *sender;
+
+	SpinLockAcquire(&mq->mq_mutex);
+	sender = vmq->mq_sender;
+	SpinLockRelease(&mq->mq_mutex);
+
+	return sender;
+}
+
+/*
+ * Attach to a shared message queue so we can send or receive messages.
+ *
+ * The memory context in effect at the time this function is called should
+ * be one which will last for at least as long as the message queue itself.
+ * Received messages are reassembled in memory allocated from it.
+ *
+ * If handle is not NULL, it should be the background worker which is to act
+ * as our counterparty; if it exits before attaching, receive operations
+ * will return SHM_MQ_DETACHED instead of waiting forever.
+ */
+shm_mq_handle *
+shm_mq_attach(shm_mq *mq, BackgroundWorkerHandle *handle)
+{
+	shm_mq_handle *mqh = palloc(sizeof(shm_mq_handle));
+
+	Assert(mq->mq_receiver == MyProc || mq->mq_sender == MyProc);
+	mqh->mqh_queue = mq;
+	mqh->mqh_handle = handle;
+	mqh->mqh_buffer = NULL;
+	mqh->mqh_buflen = 0;
+	mqh->mqh_partial_bytes = 0;
+	mqh->mqh_expected_bytes = 0;
+	mqh->mqh_length_word_complete = false;
+	mqh->mqh_counterparty_attached = false;
+	mqh->mqh_context = CurrentMemoryContext;
+
+	return mqh;
+}
+
+/*
+ * Notify counterparty that we're detaching from a shared message queue.
+ *
+ * The purpose of this function is to make sure that the process with which
+ * we're communicating doesn't block forever waiting for us to fill or drain
+ * the queue once we've lost interest.  It's safe to call this more than
+ * once, and from an on_shmem_exit callback.
+ */
+void
+shm_mq_detach(shm_mq *mq)
+{
+	volatile shm_mq *vmq = mq;
+	PGPROC	   *victim;
+
+	SpinLockAcquire(&mq->mq_mutex);
+	if (vmq->mq_sender == MyProc)
+		victim = vmq->mq_receiver;
+	else
+		victim = vmq->mq_sender;
+	vmq->mq_detached = true;
+	SpinLockRelease(&mq->mq_mutex);
+
+	if (victim != NULL)
+		SetLatch(&victim->procLatch);
+}
+
+/*
+ * Write a message into a shared message queue.
+ *
+ * This blocks until the whole message has been copied into the queue, which
+ * may require waiting for the receiver to make room.  If the receiver
+ * detaches first, SHM_MQ_DETACHED is returned, and the caller should stop
+ * producing data.
+ */
+shm_mq_result
+shm_mq_send(shm_mq_handle *mqh, Size nbytes, const void *data)
+{
+	shm_mq_result res;
+
+	Assert(mqh->mqh_queue->mq_sender == MyProc);
+
+	/* Length word, then payload; each padded to a MAXALIGN boundary. */
+	res = shm_mq_send_bytes(mqh, sizeof(Size), MAXALIGN(sizeof(Size)),
+							&nbytes);
+	if (res != SHM_MQ_SUCCESS)
+		return res;
+	return shm_mq_send_bytes(mqh, nbytes, MAXALIGN(nbytes), data);
+}
+
+/*
+ * Receive a message from a shared message queue.
+ *
+ * If nowait = false, we'll wait on our process latch until a message is
+ * available or the sender detaches.  If nowait = true, we return
+ * SHM_MQ_WOULD_BLOCK instead of waiting; any partial message received so far
+ * is remembered, and the next call resumes where this one left off.
+ *
+ * On success, *nbytesp and *datap describe the message.  The data remains
+ * valid only until the next receive on the same handle.
+ */
+shm_mq_result
+shm_mq_receive(shm_mq_handle *mqh, Size *nbytesp, void **datap, bool nowait)
+{
+	shm_mq	   *mq = mqh->mqh_queue;
+	uint64		rb;
+	uint64		wb;
+	bool		detached;
+	Size		used;
+	Size		offset;
+
+	Assert(mq->mq_receiver == MyProc);
+
+	for (;;)
+	{
+		shm_mq_get_bytes(mq, &rb, &wb, &detached);
+		used = wb - rb;
+		offset = rb % (uint64) mq->mq_ring_size;
+
+		if (!mqh->mqh_length_word_complete)
+		{
+			/* The length word is never split across the end of the ring. */
+			if (used >= MAXALIGN(sizeof(Size)))
+			{
+				Size		needed;
+
+				memcpy(&mqh->mqh_expected_bytes,
+					   &mq->mq_ring[mq->mq_ring_offset + offset],
+					   sizeof(Size));
+				shm_mq_inc_bytes_read(mq, MAXALIGN(sizeof(Size)));
+				mqh->mqh_length_word_complete = true;
+				mqh->mqh_partial_bytes = 0;
+
+				/* Make sure the reassembly buffer is big enough. */
+				needed = Max(mqh->mqh_expected_bytes, 1);
+				if (mqh->mqh_buflen < needed)
+				{
+					Size		newbuflen = Max(mqh->mqh_buflen,
+												MQH_INITIAL_BUFSIZE);
+
+					while (newbuflen < needed)
+						newbuflen *= 2;
+					if (mqh->mqh_buffer != NULL)
+						pfree(mqh->mqh_buffer);
+					mqh->mqh_buffer = MemoryContextAlloc(mqh->mqh_context,
+														 newbuflen);
+					mqh->mqh_buflen = newbuflen;
+				}
+				continue;
+			}
+		}
+		else
+		{
+			Size		expected = mqh->mqh_expected_bytes;
+			Size		total = MAXALIGN(expected);
+
+			if (mqh->mqh_partial_bytes >= total)
+			{
+				/* Whole message, including padding, has been consumed. */
+				mqh->mqh_length_word_complete = false;
+				*nbytesp = expected;
+				*datap = mqh->mqh_buffer;
+				return SHM_MQ_SUCCESS;
+			}
+
+			if (used > 0)
+			{
+				Size		readnow;
+
+				readnow = Min(used, mq->mq_ring_size - offset);
+				readnow = Min(readnow, total - mqh->mqh_partial_bytes);
+
+				/* Copy the part of this chunk that isn't padding. */
+				if (mqh->mqh_partial_bytes < expected)
+					memcpy(mqh->mqh_buffer + mqh->mqh_partial_bytes,
+						   &mq->mq_ring[mq->mq_ring_offset + offset],
+						   Min(readnow, expected - mqh->mqh_partial_bytes));
+				mqh->mqh_partial_bytes += readnow;
+				shm_mq_inc_bytes_read(mq, readnow);
+				continue;
+			}
+		}
+
+		/*
+		 * Nothing more can be consumed right now.  The sender writes all of
+		 * its data before detaching, so if it has detached, we're done.
+		 */
+		if (detached)
+			return SHM_MQ_DETACHED;
+
+		/* Check whether the sender failed to start at all. */
+		if (!mqh->mqh_counterparty_attached)
+		{
+			if (shm_mq_get_sender(mq) != NULL)
+				mqh->mqh_counterparty_attached = true;
+			else if (shm_mq_counterparty_gone(mq, mqh->mqh_handle))
+				return SHM_MQ_DETACHED;
+		}
+
+		if (nowait)
+			return SHM_MQ_WOULD_BLOCK;
+
+		shm_mq_wait();
+	}
+}
+
+/*
+ * Write datalen bytes into a shared message queue, followed by enough
+ * padding to make nbytes in all, waiting for space as needed.  The padding
+ * is not copied, merely skipped over.
+ */
+static shm_mq_result
+shm_mq_send_bytes(shm_mq_handle *mqh, Size datalen, Size nbytes,
+				  const void *data)
+{
+	shm_mq	   *mq = mqh->mqh_queue;
+	Size		sent = 0;
+	uint64		rb;
+	uint64		wb;
+	bool		detached;
+
+	while (sent < nbytes)
+	{
+		Size		available;
+		Size		offset;
+		Size		sendnow;
+
+		shm_mq_get_bytes(mq, &rb, &wb, &detached);
+		if (detached)
+			return SHM_MQ_DETACHED;
+
+		available = mq->mq_ring_size - (wb - rb);
+		if (available == 0)
+		{
+			/* Wait for the receiver to make some room. */
+			shm_mq_wait();
+			continue;
+		}
+
+		offset = wb % (uint64) mq->mq_ring_size;
+		sendnow = Min(available, mq->mq_ring_size - offset);
+		sendnow = Min(sendnow, nbytes - sent);
+
+		if (sent < datalen)
+			memcpy(&mq->mq_ring[mq->mq_ring_offset + offset],
+				   (const char *) data + sent,
+				   Min(sendnow, datalen - sent));
+		sent += sendnow;
+		shm_mq_inc_bytes_written(mq, sendnow);
+	}
+
+	return SHM_MQ_SUCCESS;
+}
+
+/*
+ * Read the queue's byte counters and detach flag.
+ */
+static void
+shm_mq_get_bytes(volatile shm_mq *mq, uint64 *readp, uint64 *writtenp,
+				 bool *detachedp)
+{
+	SpinLockAcquire(&mq->mq_mutex);
+	*readp = mq->mq_bytes_read;
+	*writtenp = mq->mq_bytes_written;
+	*detachedp = mq->mq_detached;
+	SpinLockRelease(&mq->mq_mutex);
+}
+
+/*
+ * Advance the read counter and wake the sender, which may be waiting for
+ * space.
+ */
+static void
+shm_mq_inc_bytes_read(volatile shm_mq *mq, Size n)
+{
+	PGPROC	   *sender;
+
+	SpinLockAcquire(&mq->mq_mutex);
+	mq->mq_bytes_read += n;
+	sender = mq->mq_sender;
+	SpinLockRelease(&mq->mq_mutex);
+
+	/* We shouldn't have any bytes to read without a sender. */
+	Assert(sender != NULL);
+	SetLatch(&sender->procLatch);
+}
+
+/*
+ * Advance the write counter and wake the receiver, which may be waiting for
+ * data.
+ */
+static void
+shm_mq_inc_bytes_written(volatile shm_mq *mq, Size n)
+{
+	PGPROC	   *receiver;
+
+	SpinLockAcquire(&mq->mq_mutex);
+	mq->mq_bytes_written += n;
+	receiver = mq->mq_receiver;
+	SpinLockRelease(&mq->mq_mutex);
+
+	if (receiver != NULL)
+		SetLatch(&receiver->procLatch);
+}
+
+/*
+ * Check whether the background worker which was supposed to attach to the
+ * other end of the queue has exited without doing so.  If so, mark the queue
+ * detached, so that later calls needn't repeat the check.
+ */
+static bool
+shm_mq_counterparty_gone(volatile shm_mq *mq, BackgroundWorkerHandle *handle)
+{
+	pid_t		pid;
+	BgwHandleStatus status;
+	bool		gone = false;
+
+	if (handle == NULL)
+		return false;
+
+	status = GetBackgroundWorkerPid(handle, &pid);
+	if (status != BGWH_STOPPED && status != BGWH_POSTMASTER_DIED)
+		return false;
+
+	/* Recheck under the lock, in case it attached and exited meanwhile. */
+	SpinLockAcquire(&mq->mq_mutex);
+	if (mq->mq_sender == NULL)
+	{
+		mq->mq_detached = true;
+		gone = true;
+	}
+	SpinLockRelease(&mq->mq_mutex);
+
+	return gone;
+}
+
+/*
+ * Wait for our process latch to be set by the counterparty.
+ */
+static void
+shm_mq_wait(void)
+{
+	WaitLatch(&MyProc->procLatch, WL_LATCH_SET, 0);
+	ResetLatch(&MyProc->procLatch);
+	CHECK_FOR_INTERRUPTS();
+}
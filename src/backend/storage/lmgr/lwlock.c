@@ -10,6 +10,21 @@
  * locking should be done with the full lock manager --- which depends on
  * LWLocks to protect its shared state.
  *
+ * The state of a lock (the number of shared holders, whether it's held
+ * exclusively, and a couple of flags) is kept in a single atomic variable,
+ * so that acquiring or releasing a lock that nobody is waiting for is a
+ * single compare-and-swap or atomic subtraction.  The per-lock spinlock only
+ * protects the queue of waiting processes, and is only taken when somebody
+ * has to wait, or has to be woken up.
+ *
+ * The tricky part is to make sure that a process adding itself to the wait
+ * queue can't miss the wakeup from a concurrent release.  Acquirers
+ * therefore first try to get the lock, then queue themselves (which sets
+ * LW_FLAG_HAS_WAITERS), then try to get the lock once more before going to
+ * sleep.  A releaser checks for LW_FLAG_HAS_WAITERS only after it has
+ * released the lock, so either it sees the flag and wakes the waiter, or
+ * the waiter's second attempt succeeds.
+ *
  *
  * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -23,10 +38,13 @@
 
 #include "access/clog.h"
 #include "access/multixact.h"
+#include "access/slru.h"
 #include "access/subtrans.h"
 #include "commands/async.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
+#include "port/atomics.h"
+#include "postmaster/postmaster.h"
 #include "storage/ipc.h"
 #include "storage/predicate.h"
 #include "storage/proc.h"
@@ -39,15 +57,29 @@ extern slock_t *ShmemLock;
 
 typedef struct LWLock
 {
-	slock_t		mutex;			/* Protects LWLock and queue of PGPROCs */
-	bool		releaseOK;		/* T if ok to release waiters */
-	char		exclusive;		/* # of exclusive holders (0 or 1) */
-	int			shared;			/* # of shared holders (0..MaxBackends) */
+	slock_t		mutex;			/* Protects queue of PGPROCs */
+	pg_atomic_uint32 state;		/* holders and flags, see below */
 	PGPROC	   *head;			/* head of list of waiting PGPROCs */
 	PGPROC	   *tail;			/* tail of list of waiting PGPROCs */
 	/* tail is undefined when head is NULL */
 } LWLock;
 
+/*
+ * Layout of LWLock.state: the low 24 bits count shared holders, bit 24 is
+ * set while the lock is held exclusively, and two flag bits say whether
+ * there are waiters in the queue, and whether LWLockRelease may wake them
+ * (it may not while previously woken waiters haven't had a chance to run).
+ */
+#define LW_FLAG_HAS_WAITERS			((uint32) 1 << 30)
+#define LW_FLAG_RELEASE_OK			((uint32) 1 << 29)
+
+#define LW_VAL_EXCLUSIVE			((uint32) 1 << 24)
+#define LW_VAL_SHARED				1
+
+#define LW_LOCK_MASK				((uint32) ((1 << 25) - 1))
+/* Must be greater than MAX_BACKENDS - which is 2^23-1, so we're fine. */
+#define LW_SHARED_MASK				((uint32) ((1 << 24) - 1))
+
 /*
  * All the LWLock structs are allocated as an array in shared memory.
  * (LWLockIds are indexes into the array.)	We force the array stride to
@@ -58,7 +90,8 @@ typedef struct LWLock
  * address is suitably aligned.)
  *
  * LWLock is between 16 and 32 bytes on all known platforms, so these two
- * cases are sufficient.
+ * cases are sufficient.  (It's larger where atomic operations are emulated
+ * with spinlocks, but still within 32 bytes.)
  */
 #define LWLOCK_PADDED_SIZE	(sizeof(LWLock) <= 16 ? 16 : 32)
 
@@ -80,12 +113,19 @@ NON_EXEC_STATIC LWLockPadded *LWLockArray = NULL;
  * We use this structure to keep track of locked LWLocks for release
  * during error recovery.  The maximum size could be determined at runtime
  * if necessary, but it seems unlikely that more than a few locks could
- * ever be held simultaneously.
+ * ever be held simultaneously, except for code that locks all the buffer
+ * mapping partitions at once (up to MAX_BUFFER_PARTITIONS of them).
  */
-#define MAX_SIMUL_LWLOCKS	100
+#define MAX_SIMUL_LWLOCKS	(MAX_BUFFER_PARTITIONS + 100)
+
+typedef struct LWLockHandle
+{
+	LWLockId	lockid;
+	LWLockMode	mode;			/* needed to release the lock */
+} LWLockHandle;
 
 static int	num_held_lwlocks = 0;
-static LWLockId held_lwlocks[MAX_SIMUL_LWLOCKS];
+static LWLockHandle held_lwlocks[MAX_SIMUL_LWLOCKS];
 
 static int	lock_addin_request = 0;
 static bool lock_addin_request_allowed = true;
@@ -102,13 +142,19 @@ static int *spin_delay_counts;
 bool		Trace_lwlocks = false;
 
 inline static void
-PRINT_LWDEBUG(const char *where, LWLockId lockid, const volatile LWLock *lock)
+PRINT_LWDEBUG(const char *where, LWLockId lockid, volatile LWLock *lock)
 {
 	if (Trace_lwlocks)
-		elog(LOG, "%s(%d): excl %d shared %d head %p rOK %d",
+	{
+		uint32		state = pg_atomic_read_u32(&lock->state);
+
+		elog(LOG, "%s(%d): excl %u shared %u haswaiters %u rOK %u",
 			 where, (int) lockid,
-			 (int) lock->exclusive, lock->shared, lock->head,
-			 (int) lock->releaseOK);
+			 (state & LW_VAL_EXCLUSIVE) != 0,
+			 state & LW_SHARED_MASK,
+			 (state & LW_FLAG_HAS_WAITERS) != 0,
+			 (state & LW_FLAG_RELEASE_OK) != 0);
+	}
 }
 
 inline static void
@@ -122,6 +168,9 @@ LOG_LWDEBUG(const char *where, LWLockId lockid, const char *msg)
 #define LOG_LWDEBUG(a,b,c)
 #endif   /* LOCK_DEBUG */
 
+static inline bool LWLockAcquireCommon(LWLockId lockid, LWLockMode mode,
+					uint64 *valptr, uint64 val);
+
 #ifdef LWLOCK_STATS
 
 static void init_lwlock_stats(void);
@@ -182,26 +231,31 @@ NumLWLocks(void)
 	/* Predefined LWLocks */
 	numLocks = (int) NumFixedLWLocks;
 
+	/* buf_table.c needs one per buffer mapping partition */
+	numLocks += NumBufferPartitions;
+
 	/* bufmgr.c needs two for each shared buffer */
 	numLocks += 2 * NBuffers;
 
 	/* proc.c needs one for each backend or auxiliary process */
 	numLocks += MaxBackends + NUM_AUXILIARY_PROCS;
 
-	/* clog.c needs one per CLOG buffer */
-	numLocks += CLOGShmemBuffers();
+	/* clog.c needs one per CLOG buffer, plus one per bank */
+	numLocks += CLOGShmemBuffers() +
+		SimpleLruNumBanks(CLOGShmemBuffers());
 
-	/* subtrans.c needs one per SubTrans buffer */
-	numLocks += NUM_SUBTRANS_BUFFERS;
+	/* subtrans.c needs one per SubTrans buffer, plus one per bank */
+	numLocks += SUBTRANSShmemBuffers() +
+		SimpleLruNumBanks(SUBTRANSShmemBuffers());
 
 	/* multixact.c needs two SLRU areas */
-	numLocks += NUM_MXACTOFFSET_BUFFERS + NUM_MXACTMEMBER_BUFFERS;
+	numLocks += multixact_offset_buffers + multixact_member_buffers;
 
 	/* async.c needs one per Async buffer */
-	numLocks += NUM_ASYNC_BUFFERS;
+	numLocks += notify_buffers;
 
 	/* predicate.c needs one per old serializable xid buffer */
-	numLocks += NUM_OLDSERXID_BUFFERS;
+	numLocks += serializable_buffers;
 
 	/*
 	 * Add any requested by loadable modules; for backwards-compatibility
@@ -267,6 +321,9 @@ CreateLWLocks(void)
 	char	   *ptr;
 	int			id;
 
+	StaticAssertStmt(LW_VAL_EXCLUSIVE > (uint32) MAX_BACKENDS,
+					 "MAX_BACKENDS too big for lwlock.c");
+
 	/* Allocate space */
 	ptr = (char *) ShmemAlloc(spaceLocks);
 
@@ -284,9 +341,7 @@ CreateLWLocks(void)
 	for (id = 0, lock = LWLockArray; id < numLocks; id++, lock++)
 	{
 		SpinLockInit(&lock->lock.mutex);
-		lock->lock.releaseOK = true;
-		lock->lock.exclusive = 0;
-		lock->lock.shared = 0;
+		pg_atomic_init_u32(&lock->lock.state, LW_FLAG_RELEASE_OK);
 		lock->lock.head = NULL;
 		lock->lock.tail = NULL;
 	}
@@ -296,7 +351,7 @@ CreateLWLocks(void)
 	 * the first LWLock.
 	 */
 	LWLockCounter = (int *) ((char *) LWLockArray - 2 * sizeof(int));
-	LWLockCounter[0] = (int) NumFixedLWLocks;
+	LWLockCounter[0] = (int) NumFixedLWLocks + NumBufferPartitions;
 	LWLockCounter[1] = numLocks;
 }
 
@@ -330,6 +385,306 @@ LWLockAssign(void)
 }
 
 
+/*
+ * Internal function that tries to atomically acquire the lwlock in the passed
+ * in mode.
+ *
+ * This function will not block waiting for a lock to become free - that's the
+ * caller's job.
+ *
+ * Returns true if the lock isn't free and we need to wait.
+ */
+static bool
+LWLockAttemptLock(volatile LWLock *lock, LWLockMode mode)
+{
+	uint32		old_state;
+
+	AssertArg(mode == LW_EXCLUSIVE || mode == LW_SHARED);
+
+	/*
+	 * Read once outside the loop, later iterations will get the newer value
+	 * via compare & exchange.
+	 */
+	old_state = pg_atomic_read_u32(&lock->state);
+
+	/* loop until we've determined whether we could acquire the lock or not */
+	for (;;)
+	{
+		uint32		desired_state;
+		bool		lock_free;
+
+		desired_state = old_state;
+
+		if (mode == LW_EXCLUSIVE)
+		{
+			lock_free = (old_state & LW_LOCK_MASK) == 0;
+			if (lock_free)
+				desired_state += LW_VAL_EXCLUSIVE;
+		}
+		else
+		{
+			lock_free = (old_state & LW_VAL_EXCLUSIVE) == 0;
+			if (lock_free)
+				desired_state += LW_VAL_SHARED;
+		}
+
+		/*
+		 * Attempt to swap in the state we are expecting.  If we didn't see
+		 * the lock to be free, that's just the old value.  If we saw it as
+		 * free, we'll attempt to mark it acquired.  The reason that we always
+		 * swap in the value is that this doubles as a memory barrier.
+		 *
+		 * Retry if the value changed since we last looked at it.
+		 */
+		if (pg_atomic_compare_exchange_u32(&lock->state,
+										   &old_state, desired_state))
+			return !lock_free;
+	}
+}
+
+/*
+ * Add ourselves to the wait queue of a lock, and set LW_FLAG_HAS_WAITERS.
+ *
+ * LW_WAIT_UNTIL_FREE waiters go to the front of the queue, so that
+ * LWLockUpdateVar can find them without scanning past the regular waiters.
+ */
+static void
+LWLockQueueSelf(LWLockId lockid, volatile LWLock *lock, LWLockMode mode)
+{
+	PGPROC	   *proc = MyProc;
+
+	/*
+	 * If we don't have a PGPROC structure, there's no way to wait.  This
+	 * should never occur, since MyProc should only be null during shared
+	 * memory initialization.
+	 */
+	if (proc == NULL)
+		elog(PANIC, "cannot wait without a PGPROC structure");
+
+	if (proc->lwWaiting)
+		elog(PANIC, "queueing for lock while waiting on another one");
+
+	/* Acquire mutex.  Time spent holding mutex should be short! */
+#ifdef LWLOCK_STATS
+	spin_delay_counts[lockid] += SpinLockAcquire(&lock->mutex);
+#else
+	SpinLockAcquire(&lock->mutex);
+#endif
+
+	/* setting the flag is protected by the mutex */
+	pg_atomic_fetch_or_u32(&lock->state, LW_FLAG_HAS_WAITERS);
+
+	proc->lwWaiting = true;
+	proc->lwWaitMode = mode;
+
+	if (mode == LW_WAIT_UNTIL_FREE)
+	{
+		proc->lwWaitLink = lock->head;
+		if (lock->head == NULL)
+			lock->tail = proc;
+		lock->head = proc;
+	}
+	else
+	{
+		proc->lwWaitLink = NULL;
+		if (lock->head == NULL)
+			lock->head = proc;
+		else
+			lock->tail->lwWaitLink = proc;
+		lock->tail = proc;
+	}
+
+	/* Can release the mutex now */
+	SpinLockRelease(&lock->mutex);
+}
+
+/*
+ * Remove ourselves from the wait queue of a lock, after the second attempt
+ * to acquire it succeeded.
+ *
+ * If a concurrent LWLockRelease already removed us from the queue, we have
+ * to absorb its wakeup instead, so that the semaphore count stays right.
+ */
+static void
+LWLockDequeueSelf(LWLockId lockid, volatile LWLock *lock)
+{
+	PGPROC	   *proc = MyProc;
+	PGPROC	   *cur;
+	PGPROC	   *prev = NULL;
+	bool		found = false;
+
+#ifdef LWLOCK_STATS
+	spin_delay_counts[lockid] += SpinLockAcquire(&lock->mutex);
+#else
+	SpinLockAcquire(&lock->mutex);
+#endif
+
+	for (cur = lock->head; cur != NULL; prev = cur, cur = cur->lwWaitLink)
+	{
+		if (cur == proc)
+		{
+			if (prev == NULL)
+				lock->head = cur->lwWaitLink;
+			else
+				prev->lwWaitLink = cur->lwWaitLink;
+			if (lock->tail == cur)
+				lock->tail = prev;
+			found = true;
+			break;
+		}
+	}
+
+	if (lock->head == NULL)
+		pg_atomic_fetch_and_u32(&lock->state, ~LW_FLAG_HAS_WAITERS);
+
+	SpinLockRelease(&lock->mutex);
+
+	if (found)
+	{
+		proc->lwWaiting = false;
+		proc->lwWaitLink = NULL;
+	}
+	else
+	{
+		int			extraWaits = 0;
+
+		/*
+		 * Somebody else dequeued us and has or will wake us up.  They will
+		 * also have cleared LW_FLAG_RELEASE_OK, expecting us to retry; since
+		 * we don't, set it again.
+		 */
+		pg_atomic_fetch_or_u32(&lock->state, LW_FLAG_RELEASE_OK);
+
+		for (;;)
+		{
+			/* "false" means cannot accept cancel/die interrupt here. */
+			PGSemaphoreLock(&proc->sem, false);
+			if (!proc->lwWaiting)
+				break;
+			extraWaits++;
+		}
+
+		/*
+		 * Fix the process wait semaphore's count for any absorbed wakeups.
+		 */
+		while (extraWaits-- > 0)
+			PGSemaphoreUnlock(&proc->sem);
+	}
+}
+
+/*
+ * Wake up the waiters that can make progress now that the lock has been
+ * released: the LW_WAIT_UNTIL_FREE waiters, plus either the first exclusive
+ * waiter or all shared waiters ahead of the first exclusive one.
+ */
+static void
+LWLockWakeup(LWLockId lockid, volatile LWLock *lock)
+{
+	bool		new_release_ok = true;
+	bool		wokeup_somebody = false;
+	PGPROC	   *wakeup = NULL;
+	PGPROC	   *wakeup_tail = NULL;
+	PGPROC	   *proc;
+	PGPROC	   *prev = NULL;
+	PGPROC	   *next;
+	uint32		old_state;
+
+#ifdef LWLOCK_STATS
+	spin_delay_counts[lockid] += SpinLockAcquire(&lock->mutex);
+#else
+	SpinLockAcquire(&lock->mutex);
+#endif
+
+	for (proc = lock->head; proc != NULL; proc = next)
+	{
+		next = proc->lwWaitLink;
+
+		if (wokeup_somebody && proc->lwWaitMode == LW_EXCLUSIVE)
+		{
+			prev = proc;
+			continue;
+		}
+
+		/* Remove from the wait queue ... */
+		if (prev == NULL)
+			lock->head = next;
+		else
+			prev->lwWaitLink = next;
+		if (lock->tail == proc)
+			lock->tail = prev;
+
+		/* ... and add to the list of processes to wake up */
+		proc->lwWaitLink = NULL;
+		if (wakeup == NULL)
+			wakeup = proc;
+		else
+			wakeup_tail->lwWaitLink = proc;
+		wakeup_tail = proc;
+
+		if (proc->lwWaitMode != LW_WAIT_UNTIL_FREE)
+		{
+			/*
+			 * Prevent additional wakeups until retryer gets to run.  Backends
+			 * that are just waiting for the lock to become free don't retry
+			 * automatically.
+			 */
+			new_release_ok = false;
+
+			/* Don't wake up exclusive waiters after this one */
+			wokeup_somebody = true;
+		}
+
+		/*
+		 * Once we've woken up an exclusive waiter, there's no point in
+		 * waking up anybody else.
+		 */
+		if (proc->lwWaitMode == LW_EXCLUSIVE)
+			break;
+	}
+
+	/* Update the flags, while nobody can change the queue */
+	old_state = pg_atomic_read_u32(&lock->state);
+	for (;;)
+	{
+		uint32		desired_state = old_state;
+
+		if (new_release_ok)
+			desired_state |= LW_FLAG_RELEASE_OK;
+		else
+			desired_state &= ~LW_FLAG_RELEASE_OK;
+
+		if (lock->head == NULL)
+			desired_state &= ~LW_FLAG_HAS_WAITERS;
+
+		if (pg_atomic_compare_exchange_u32(&lock->state,
+										   &old_state, desired_state))
+			break;
+	}
+
+	/* We are done updating shared state of the lock queue. */
+	SpinLockRelease(&lock->mutex);
+
+	/*
+	 * Awaken any waiters I removed from the queue.
+	 */
+	while (wakeup != NULL)
+	{
+		LOG_LWDEBUG("LWLockRelease", lockid, "release waiter");
+		proc = wakeup;
+		wakeup = proc->lwWaitLink;
+		proc->lwWaitLink = NULL;
+
+		/*
+		 * The waiter may return from its semaphore wait as soon as it sees
+		 * lwWaiting cleared, so make sure it doesn't see stale contents of
+		 * lwWaitLink.
+		 */
+		pg_write_barrier();
+		proc->lwWaiting = false;
+		PGSemaphoreUnlock(&proc->sem);
+	}
+}
+
 /*
  * LWLockAcquire - acquire a lightweight lock in the specified mode
  *
@@ -339,12 +694,38 @@ LWLockAssign(void)
  */
 void
 LWLockAcquire(LWLockId lockid, LWLockMode mode)
+{
+	(void) LWLockAcquireCommon(lockid, mode, NULL, 0);
+}
+
+/*
+ * LWLockAcquireWithVar - like LWLockAcquire, but also sets *valptr = val
+ *
+ * The lock is always acquired in exclusive mode with this function.  The
+ * variable is set while holding the lock's mutex, so that LWLockWaitForVar
+ * sees a consistent value.
+ *
+ * Returns true if the lock was available immediately, false if we had to
+ * sleep.
+ */
+bool
+LWLockAcquireWithVar(LWLockId lockid, uint64 *valptr, uint64 val)
+{
+	return LWLockAcquireCommon(lockid, LW_EXCLUSIVE, valptr, val);
+}
+
+/* internal function to implement LWLockAcquire and LWLockAcquireWithVar */
+static inline bool
+LWLockAcquireCommon(LWLockId lockid, LWLockMode mode, uint64 *valptr,
+					uint64 val)
 {
 	volatile LWLock *lock = &(LWLockArray[lockid].lock);
 	PGPROC	   *proc = MyProc;
-	bool		retry = false;
+	bool		result = true;
 	int			extraWaits = 0;
 
+	AssertArg(mode == LW_SHARED || mode == LW_EXCLUSIVE);
+
 	PRINT_LWDEBUG("LWLockAcquire", lockid, lock);
 
 #ifdef LWLOCK_STATS
@@ -396,63 +777,34 @@ LWLockAcquire(LWLockId lockid, LWLockMode mode)
 	{
 		bool		mustwait;
 
-		/* Acquire mutex.  Time spent holding mutex should be short! */
-#ifdef LWLOCK_STATS
-		spin_delay_counts[lockid] += SpinLockAcquire(&lock->mutex);
-#else
-		SpinLockAcquire(&lock->mutex);
-#endif
-
-		/* If retrying, allow LWLockRelease to release waiters again */
-		if (retry)
-			lock->releaseOK = true;
-
-		/* If I can get the lock, do so quickly. */
-		if (mode == LW_EXCLUSIVE)
-		{
-			if (lock->exclusive == 0 && lock->shared == 0)
-			{
-				lock->exclusive++;
-				mustwait = false;
-			}
-			else
-				mustwait = true;
-		}
-		else
-		{
-			if (lock->exclusive == 0)
-			{
-				lock->shared++;
-				mustwait = false;
-			}
-			else
-				mustwait = true;
-		}
+		/*
+		 * Try to grab the lock the first time, we're not in the wait queue
+		 * yet/anymore.
+		 */
+		mustwait = LWLockAttemptLock(lock, mode);
 
 		if (!mustwait)
 			break;				/* got the lock */
 
 		/*
-		 * Add myself to wait queue.
-		 *
-		 * If we don't have a PGPROC structure, there's no way to wait. This
-		 * should never occur, since MyProc should only be null during shared
-		 * memory initialization.
+		 * We couldn't get the lock.  We can't simply add ourselves to the
+		 * queue and sleep, because the lock might have been released in the
+		 * meantime, without the releaser seeing us in the queue.  So queue
+		 * ourselves first, and then try again.  If we still can't get the
+		 * lock, the holder is guaranteed to see our queue entry when it
+		 * releases the lock.
 		 */
-		if (proc == NULL)
-			elog(PANIC, "cannot wait without a PGPROC structure");
+		LWLockQueueSelf(lockid, lock, mode);
 
-		proc->lwWaiting = true;
-		proc->lwWaitMode = mode;
-		proc->lwWaitLink = NULL;
-		if (lock->head == NULL)
-			lock->head = proc;
-		else
-			lock->tail->lwWaitLink = proc;
-		lock->tail = proc;
+		mustwait = LWLockAttemptLock(lock, mode);
 
-		/* Can release the mutex now */
-		SpinLockRelease(&lock->mutex);
+		/* ok, grabbed the lock the second time round, need to undo queueing */
+		if (!mustwait)
+		{
+			LOG_LWDEBUG("LWLockAcquire", lockid, "acquired, undoing queue");
+			LWLockDequeueSelf(lockid, lock);
+			break;
+		}
 
 		/*
 		 * Wait until awakened.
@@ -483,27 +835,42 @@ LWLockAcquire(LWLockId lockid, LWLockMode mode)
 			extraWaits++;
 		}
 
+		/* Retrying, allow LWLockRelease to release waiters again. */
+		pg_atomic_fetch_or_u32(&lock->state, LW_FLAG_RELEASE_OK);
+
 		TRACE_POSTGRESQL_LWLOCK_WAIT_DONE(lockid, mode);
 
 		LOG_LWDEBUG("LWLockAcquire", lockid, "awakened");
 
 		/* Now loop back and try to acquire lock again. */
-		retry = true;
+		result = false;
 	}
 
-	/* We are done updating shared state of the lock itself. */
-	SpinLockRelease(&lock->mutex);
+	/*
+	 * If there's a variable associated with this lock, initialize it.  The
+	 * mutex makes the update atomic with respect to LWLockWaitForVar, as
+	 * we can't rely on 64-bit stores being atomic.
+	 */
+	if (valptr)
+	{
+		SpinLockAcquire(&lock->mutex);
+		*((volatile uint64 *) valptr) = val;
+		SpinLockRelease(&lock->mutex);
+	}
 
 	TRACE_POSTGRESQL_LWLOCK_ACQUIRE(lockid, mode);
 
 	/* Add lock to list of locks held by this backend */
-	held_lwlocks[num_held_lwlocks++] = lockid;
+	held_lwlocks[num_held_lwlocks].lockid = lockid;
+	held_lwlocks[num_held_lwlocks++].mode = mode;
 
 	/*
 	 * Fix the process wait semaphore's count for any absorbed wakeups.
 	 */
 	while (extraWaits-- > 0)
 		PGSemaphoreUnlock(&proc->sem);
+
+	return result;
 }
 
 /*
@@ -519,6 +886,8 @@ LWLockConditionalAcquire(LWLockId lockid, LWLockMode mode)
 	volatile LWLock *lock = &(LWLockArray[lockid].lock);
 	bool		mustwait;
 
+	AssertArg(mode == LW_SHARED || mode == LW_EXCLUSIVE);
+
 	PRINT_LWDEBUG("LWLockConditionalAcquire", lockid, lock);
 
 	/* Ensure we will have room to remember the lock */
@@ -532,33 +901,8 @@ LWLockConditionalAcquire(LWLockId lockid, LWLockMode mode)
 	 */
 	HOLD_INTERRUPTS();
 
-	/* Acquire mutex.  Time spent holding mutex should be short! */
-	SpinLockAcquire(&lock->mutex);
-
-	/* If I can get the lock, do so quickly. */
-	if (mode == LW_EXCLUSIVE)
-	{
-		if (lock->exclusive == 0 && lock->shared == 0)
-		{
-			lock->exclusive++;
-			mustwait = false;
-		}
-		else
-			mustwait = true;
-	}
-	else
-	{
-		if (lock->exclusive == 0)
-		{
-			lock->shared++;
-			mustwait = false;
-		}
-		else
-			mustwait = true;
-	}
-
-	/* We are done updating shared state of the lock itself. */
-	SpinLockRelease(&lock->mutex);
+	/* Check for the lock */
+	mustwait = LWLockAttemptLock(lock, mode);
 
 	if (mustwait)
 	{
@@ -570,7 +914,8 @@ LWLockConditionalAcquire(LWLockId lockid, LWLockMode mode)
 	else
 	{
 		/* Add lock to list of locks held by this backend */
-		held_lwlocks[num_held_lwlocks++] = lockid;
+		held_lwlocks[num_held_lwlocks].lockid = lockid;
+		held_lwlocks[num_held_lwlocks++].mode = mode;
 		TRACE_POSTGRESQL_LWLOCK_CONDACQUIRE(lockid, mode);
 	}
 
@@ -599,6 +944,8 @@ LWLockAcquireOrWait(LWLockId lockid, LWLockMode mode)
 	bool		mustwait;
 	int			extraWaits = 0;
 
+	AssertArg(mode == LW_SHARED || mode == LW_EXCLUSIVE);
+
 	PRINT_LWDEBUG("LWLockAcquireOrWait", lockid, lock);
 
 #ifdef LWLOCK_STATS
@@ -618,66 +965,228 @@ LWLockAcquireOrWait(LWLockId lockid, LWLockMode mode)
 	 */
 	HOLD_INTERRUPTS();
 
-	/* Acquire mutex.  Time spent holding mutex should be short! */
-	SpinLockAcquire(&lock->mutex);
+	/*
+	 * NB: We're using nearly the same twice-in-a-row lock acquisition
+	 * protocol as LWLockAcquire().  Check its comments for details.
+	 */
+	mustwait = LWLockAttemptLock(lock, mode);
 
-	/* If I can get the lock, do so quickly. */
-	if (mode == LW_EXCLUSIVE)
+	if (mustwait)
 	{
-		if (lock->exclusive == 0 && lock->shared == 0)
+		LWLockQueueSelf(lockid, lock, LW_WAIT_UNTIL_FREE);
+
+		mustwait = LWLockAttemptLock(lock, mode);
+
+		if (mustwait)
 		{
-			lock->exclusive++;
-			mustwait = false;
+			/*
+			 * Wait until awakened.  Like in LWLockAcquire, be prepared for
+			 * bogus wakups, because we share the semaphore with
+			 * ProcWaitForSignal.
+			 */
+			LOG_LWDEBUG("LWLockAcquireOrWait", lockid, "waiting");
+
+#ifdef LWLOCK_STATS
+			block_counts[lockid]++;
+#endif
+
+			TRACE_POSTGRESQL_LWLOCK_WAIT_START(lockid, mode);
+
+			for (;;)
+			{
+				/* "false" means cannot accept cancel/die interrupt here. */
+				PGSemaphoreLock(&proc->sem, false);
+				if (!proc->lwWaiting)
+					break;
+				extraWaits++;
+			}
+
+			TRACE_POSTGRESQL_LWLOCK_WAIT_DONE(lockid, mode);
+
+			LOG_LWDEBUG("LWLockAcquireOrWait", lockid, "awakened");
 		}
 		else
-			mustwait = true;
-	}
-	else
-	{
-		if (lock->exclusive == 0)
 		{
-			lock->shared++;
-			mustwait = false;
+			LOG_LWDEBUG("LWLockAcquireOrWait", lockid,
+						"acquired, undoing queue");
+
+			/*
+			 * Got lock in the second attempt, undo queueing.  We need to
+			 * treat this as having successfully acquired the lock, otherwise
+			 * we'd not necessarily wake up people we've prevented from
+			 * acquiring the lock.
+			 */
+			LWLockDequeueSelf(lockid, lock);
 		}
-		else
-			mustwait = true;
 	}
 
+	/*
+	 * Fix the process wait semaphore's count for any absorbed wakeups.
+	 */
+	while (extraWaits-- > 0)
+		PGSemaphoreUnlock(&proc->sem);
+
 	if (mustwait)
 	{
+		/* Failed to get lock, so release interrupt holdoff */
+		RESUME_INTERRUPTS();
+		LOG_LWDEBUG("LWLockAcquireOrWait", lockid, "failed");
+		TRACE_POSTGRESQL_LWLOCK_WAIT_UNTIL_FREE_FAIL(lockid, mode);
+	}
+	else
+	{
+		/* Add lock to list of locks held by this backend */
+		held_lwlocks[num_held_lwlocks].lockid = lockid;
+		held_lwlocks[num_held_lwlocks++].mode = mode;
+		TRACE_POSTGRESQL_LWLOCK_WAIT_UNTIL_FREE(lockid, mode);
+	}
+
+	return !mustwait;
+}
+
+/*
+ * Does the lwlock in its current state need to wait for the variable value to
+ * change?
+ *
+ * If we don't need to wait, and it's because the value of the variable has
+ * changed, store the current value in newval.
+ *
+ * *result is set to true if the lock was free, and false otherwise.
+ */
+static bool
+LWLockConflictsWithVar(volatile LWLock *lock, uint64 *valptr, uint64 oldval,
+					   uint64 *newval, bool *result)
+{
+	bool		mustwait;
+	uint64		value;
+
+	/*
+	 * Test first to see if it the lock is free right now.
+	 *
+	 * XXX: the caller uses a spinlock before this, so we don't need a memory
+	 * barrier here as far as the current usage is concerned.  But that might
+	 * not be safe in general.
+	 */
+	mustwait = (pg_atomic_read_u32(&lock->state) & LW_VAL_EXCLUSIVE) != 0;
+
+	if (!mustwait)
+	{
+		*result = true;
+		return false;
+	}
+
+	*result = false;
+
+	/*
+	 * Read the value under the mutex, as we can't rely on 64-bit loads being
+	 * atomic.
+	 */
+	SpinLockAcquire(&lock->mutex);
+	value = *((volatile uint64 *) valptr);
+	SpinLockRelease(&lock->mutex);
+
+	if (value != oldval)
+	{
+		mustwait = false;
+		*newval = value;
+	}
+	else
+		mustwait = true;
+
+	return mustwait;
+}
+
+/*
+ * LWLockWaitForVar - Wait until lock is free, or a variable is updated.
+ *
+ * If the lock is held and *valptr equals oldval, waits until the lock is
+ * either freed, or the lock holder updates *valptr by calling
+ * LWLockUpdateVar.  If the lock is free on exit (immediately or after
+ * waiting), returns true.  If the lock is still held, but *valptr no longer
+ * matches oldval, returns false and sets *newval to the current value in
+ * *valptr.
+ *
+ * It's possible that the lock holder releases the lock, but another backend
+ * acquires it again before we get a chance to observe that the lock was
+ * momentarily released.  We wouldn't need to wait for the new lock holder,
+ * but we cannot distinguish that case, so we will have to wait.
+ *
+ * Note: this function ignores shared lock holders; if the lock is held
+ * in shared mode, returns 'true'.
+ */
+bool
+LWLockWaitForVar(LWLockId lockid, uint64 *valptr, uint64 oldval,
+				 uint64 *newval)
+{
+	volatile LWLock *lock = &(LWLockArray[lockid].lock);
+	PGPROC	   *proc = MyProc;
+	int			extraWaits = 0;
+	bool		result = false;
+
+	PRINT_LWDEBUG("LWLockWaitForVar", lockid, lock);
+
+	/*
+	 * Lock out cancel/die interrupts while we sleep on the lock.  There is no
+	 * cleanup mechanism to remove us from the wait queue if we got
+	 * interrupted.
+	 */
+	HOLD_INTERRUPTS();
+
+	/*
+	 * Loop here to check the lock's status after each time we are signaled.
+	 */
+	for (;;)
+	{
+		bool		mustwait;
+
+		mustwait = LWLockConflictsWithVar(lock, valptr, oldval, newval,
+										  &result);
+
+		if (!mustwait)
+			break;				/* the lock was free or value didn't match */
+
 		/*
-		 * Add myself to wait queue.
-		 *
-		 * If we don't have a PGPROC structure, there's no way to wait.  This
-		 * should never occur, since MyProc should only be null during shared
-		 * memory initialization.
+		 * Add myself to wait queue.  Note that this is racy, somebody else
+		 * could wake up before we're finished queuing.  NB: We're using
+		 * nearly the same twice-in-a-row lock acquisition protocol as
+		 * LWLockAcquire().  Check its comments for details.  The only
+		 * difference is that we also have to check the variable's values
+		 * when checking the state of the lock.
 		 */
-		if (proc == NULL)
-			elog(PANIC, "cannot wait without a PGPROC structure");
+		LWLockQueueSelf(lockid, lock, LW_WAIT_UNTIL_FREE);
 
-		proc->lwWaiting = true;
-		proc->lwWaitMode = LW_WAIT_UNTIL_FREE;
-		proc->lwWaitLink = NULL;
-		if (lock->head == NULL)
-			lock->head = proc;
-		else
-			lock->tail->lwWaitLink = proc;
-		lock->tail = proc;
+		/*
+		 * Set RELEASE_OK flag, to make sure we get woken up as soon as the
+		 * lock is released.
+		 */
+		pg_atomic_fetch_or_u32(&lock->state, LW_FLAG_RELEASE_OK);
 
-		/* Can release the mutex now */
-		SpinLockRelease(&lock->mutex);
+		/*
+		 * We're now guaranteed to be woken up if necessary.  Recheck the
+		 * lock and variables state.
+		 */
+		mustwait = LWLockConflictsWithVar(lock, valptr, oldval, newval,
+										  &result);
+
+		/* Ok, no conflict after we queued ourselves.  Undo queueing. */
+		if (!mustwait)
+		{
+			LOG_LWDEBUG("LWLockWaitForVar", lockid, "free, undoing queue");
+			LWLockDequeueSelf(lockid, lock);
+			break;
+		}
 
 		/*
 		 * Wait until awakened.  Like in LWLockAcquire, be prepared for bogus
 		 * wakups, because we share the semaphore with ProcWaitForSignal.
 		 */
-		LOG_LWDEBUG("LWLockAcquireOrWait", lockid, "waiting");
+		LOG_LWDEBUG("LWLockWaitForVar", lockid, "waiting");
 
 #ifdef LWLOCK_STATS
 		block_counts[lockid]++;
 #endif
 
-		TRACE_POSTGRESQL_LWLOCK_WAIT_START(lockid, mode);
+		TRACE_POSTGRESQL_LWLOCK_WAIT_START(lockid, LW_EXCLUSIVE);
 
 		for (;;)
 		{
@@ -688,14 +1197,11 @@ LWLockAcquireOrWait(LWLockId lockid, LWLockMode mode)
 			extraWaits++;
 		}
 
-		TRACE_POSTGRESQL_LWLOCK_WAIT_DONE(lockid, mode);
+		TRACE_POSTGRESQL_LWLOCK_WAIT_DONE(lockid, LW_EXCLUSIVE);
 
-		LOG_LWDEBUG("LWLockAcquireOrWait", lockid, "awakened");
-	}
-	else
-	{
-		/* We are done updating shared state of the lock itself. */
-		SpinLockRelease(&lock->mutex);
+		LOG_LWDEBUG("LWLockWaitForVar", lockid, "awakened");
+
+		/* Now loop back and check the status of the lock again. */
 	}
 
 	/*
@@ -704,23 +1210,85 @@ LWLockAcquireOrWait(LWLockId lockid, LWLockMode mode)
 	while (extraWaits-- > 0)
 		PGSemaphoreUnlock(&proc->sem);
 
-	if (mustwait)
+	/*
+	 * Now okay to allow cancel/die interrupts.
+	 */
+	RESUME_INTERRUPTS();
+
+	return result;
+}
+
+
+/*
+ * LWLockUpdateVar - Update a variable and wake up waiters atomically
+ *
+ * Sets *valptr to 'val', and wakes up all processes waiting for us with
+ * LWLockWaitForVar().  Setting the value and waking up the processes happen
+ * atomically so that any process calling LWLockWaitForVar() on the same lock
+ * is guaranteed to see the new value, and act accordingly.
+ *
+ * The caller must be holding the lock in exclusive mode.
+ */
+void
+LWLockUpdateVar(LWLockId lockid, uint64 *valptr, uint64 val)
+{
+	volatile LWLock *lock = &(LWLockArray[lockid].lock);
+	volatile uint64 *valp = valptr;
+	PGPROC	   *head;
+	PGPROC	   *proc;
+	PGPROC	   *next;
+
+	/* Acquire mutex.  Time spent holding mutex should be short! */
+	SpinLockAcquire(&lock->mutex);
+
+	/* we should hold the lock */
+	Assert(pg_atomic_read_u32(&lock->state) & LW_VAL_EXCLUSIVE);
+
+	/* Update the lock's value */
+	*valp = val;
+
+	/*
+	 * See if there are any LW_WAIT_UNTIL_FREE waiters that need to be woken
+	 * up.  They are always in the front of the queue.
+	 */
+	head = lock->head;
+
+	if (head != NULL && head->lwWaitMode == LW_WAIT_UNTIL_FREE)
 	{
-		/* Failed to get lock, so release interrupt holdoff */
-		RESUME_INTERRUPTS();
-		LOG_LWDEBUG("LWLockAcquireOrWait", lockid, "failed");
-		TRACE_POSTGRESQL_LWLOCK_WAIT_UNTIL_FREE_FAIL(lockid, mode);
+		proc = head;
+		next = proc->lwWaitLink;
+		while (next && next->lwWaitMode == LW_WAIT_UNTIL_FREE)
+		{
+			proc = next;
+			next = next->lwWaitLink;
+		}
+
+		/* proc is now the last PGPROC to be released */
+		lock->head = next;
+		proc->lwWaitLink = NULL;
 	}
 	else
+		head = NULL;
+
+	/* We are done updating shared state of the lock queue. */
+	SpinLockRelease(&lock->mutex);
+
+	/*
+	 * Awaken any waiters I removed from the queue.
+	 */
+	while (head != NULL)
 	{
-		/* Add lock to list of locks held by this backend */
-		held_lwlocks[num_held_lwlocks++] = lockid;
-		TRACE_POSTGRESQL_LWLOCK_WAIT_UNTIL_FREE(lockid, mode);
+		proc = head;
+		head = proc->lwWaitLink;
+		proc->lwWaitLink = NULL;
+		/* see LWLockWakeup */
+		pg_write_barrier();
+		proc->lwWaiting = false;
+		PGSemaphoreUnlock(&proc->sem);
 	}
-
-	return !mustwait;
 }
 
+
 /*
  * LWLockRelease - release a previously acquired lock
  */
@@ -728,8 +1296,8 @@ void
 LWLockRelease(LWLockId lockid)
 {
 	volatile LWLock *lock = &(LWLockArray[lockid].lock);
-	PGPROC	   *head;
-	PGPROC	   *proc;
+	LWLockMode	mode;
+	uint32		oldstate;
 	int			i;
 
 	PRINT_LWDEBUG("LWLockRelease", lockid, lock);
@@ -740,26 +1308,27 @@ LWLockRelease(LWLockId lockid)
 	 */
 	for (i = num_held_lwlocks; --i >= 0;)
 	{
-		if (lockid == held_lwlocks[i])
+		if (lockid == held_lwlocks[i].lockid)
 			break;
 	}
 	if (i < 0)
 		elog(ERROR, "lock %d is not held", (int) lockid);
+	mode = held_lwlocks[i].mode;
 	num_held_lwlocks--;
 	for (; i < num_held_lwlocks; i++)
 		held_lwlocks[i] = held_lwlocks[i + 1];
 
-	/* Acquire mutex.  Time spent holding mutex should be short! */
-	SpinLockAcquire(&lock->mutex);
-
-	/* Release my hold on lock */
-	if (lock->exclusive > 0)
-		lock->exclusive--;
+	/*
+	 * Release my hold on lock, after that it can immediately be acquired by
+	 * others, even if we still have to wakeup other waiters.
+	 */
+	if (mode == LW_EXCLUSIVE)
+		oldstate = pg_atomic_sub_fetch_u32(&lock->state, LW_VAL_EXCLUSIVE);
 	else
-	{
-		Assert(lock->shared > 0);
-		lock->shared--;
-	}
+		oldstate = pg_atomic_sub_fetch_u32(&lock->state, LW_VAL_SHARED);
+
+	/* nobody else can have that kind of lock */
+	Assert(!(oldstate & LW_VAL_EXCLUSIVE));
 
 	/*
 	 * See if I need to awaken any waiters.  If I released a non-last shared
@@ -767,78 +1336,16 @@ LWLockRelease(LWLockId lockid)
 	 * if someone has already awakened waiters that haven't yet acquired the
 	 * lock.
 	 */
-	head = lock->head;
-	if (head != NULL)
+	if ((oldstate & (LW_FLAG_HAS_WAITERS | LW_FLAG_RELEASE_OK)) ==
+		(LW_FLAG_HAS_WAITERS | LW_FLAG_RELEASE_OK) &&
+		(oldstate & LW_LOCK_MASK) == 0)
 	{
-		if (lock->exclusive == 0 && lock->shared == 0 && lock->releaseOK)
-		{
-			/*
-			 * Remove the to-be-awakened PGPROCs from the queue.
-			 */
-			bool		releaseOK = true;
-
-			proc = head;
-
-			/*
-			 * First wake up any backends that want to be woken up without
-			 * acquiring the lock.
-			 */
-			while (proc->lwWaitMode == LW_WAIT_UNTIL_FREE && proc->lwWaitLink)
-				proc = proc->lwWaitLink;
-
-			/*
-			 * If the front waiter wants exclusive lock, awaken him only.
-			 * Otherwise awaken as many waiters as want shared access.
-			 */
-			if (proc->lwWaitMode != LW_EXCLUSIVE)
-			{
-				while (proc->lwWaitLink != NULL &&
-					   proc->lwWaitLink->lwWaitMode != LW_EXCLUSIVE)
-				{
-					if (proc->lwWaitMode != LW_WAIT_UNTIL_FREE)
-						releaseOK = false;
-					proc = proc->lwWaitLink;
-				}
-			}
-			/* proc is now the last PGPROC to be released */
-			lock->head = proc->lwWaitLink;
-			proc->lwWaitLink = NULL;
-
-			/*
-			 * Prevent additional wakeups until retryer gets to run. Backends
-			 * that are just waiting for the lock to become free don't retry
-			 * automatically.
-			 */
-			if (proc->lwWaitMode != LW_WAIT_UNTIL_FREE)
-				releaseOK = false;
-
-			lock->releaseOK = releaseOK;
-		}
-		else
-		{
-			/* lock is still held, can't awaken anything */
-			head = NULL;
-		}
+		LOG_LWDEBUG("LWLockRelease", lockid, "releasing waiters");
+		LWLockWakeup(lockid, lock);
 	}
 
-	/* We are done updating shared state of the lock itself. */
-	SpinLockRelease(&lock->mutex);
-
 	TRACE_POSTGRESQL_LWLOCK_RELEASE(lockid);
 
-	/*
-	 * Awaken any waiters I removed from the queue.
-	 */
-	while (head != NULL)
-	{
-		LOG_LWDEBUG("LWLockRelease", lockid, "release waiter");
-		proc = head;
-		head = proc->lwWaitLink;
-		proc->lwWaitLink = NULL;
-		proc->lwWaiting = false;
-		PGSemaphoreUnlock(&proc->sem);
-	}
-
 	/*
 	 * Now okay to allow cancel/die interrupts.
 	 */
@@ -862,7 +1369,7 @@ LWLockReleaseAll(void)
 	{
 		HOLD_INTERRUPTS();		/* match the upcoming RESUME_INTERRUPTS */
 
-		LWLockRelease(held_lwlocks[num_held_lwlocks - 1]);
+		LWLockRelease(held_lwlocks[num_held_lwlocks - 1].lockid);
 	}
 }
 
@@ -880,7 +1387,7 @@ LWLockHeldByMe(LWLockId lockid)
 
 	for (i = 0; i < num_held_lwlocks; i++)
 	{
-		if (held_lwlocks[i] == lockid)
+		if (held_lwlocks[i].lockid == lockid)
 			return true;
 	}
 	return false;
@@ -86,8 +86,19 @@ static volatile DeadLockState deadlock_state = DS_NOT_YET_CHECKED;
 static void RemoveProcFromArray(int code, Datum arg);
 static void ProcKill(int code, Datum arg);
 static void AuxiliaryProcKill(int code, Datum arg);
+static Size FastPathLockShmemSizePerProc(void);
 
 
+/*
+ * Report the space needed for one PGPROC's fast-path lock arrays.
+ */
+static Size
+FastPathLockShmemSizePerProc(void)
+{
+	return add_size(MAXALIGN(FastPathLockGroupsPerBackend * sizeof(uint64)),
+					MAXALIGN(FastPathLockSlotsPerBackend() * sizeof(Oid)));
+}
+
 /*
  * Report shared-memory space needed by InitProcGlobal.
  */
@@ -111,6 +122,12 @@ ProcGlobalShmemSize(void)
 	size = add_size(size, mul_size(NUM_AUXILIARY_PROCS, sizeof(PGXACT)));
 	size = add_size(size, mul_size(max_prepared_xacts, sizeof(PGXACT)));
 
+	/* Fast-path lock arrays */
+	size = add_size(size, mul_size(add_size(add_size(MaxBackends,
+													 NUM_AUXILIARY_PROCS),
+											max_prepared_xacts),
+								   FastPathLockShmemSizePerProc()));
+
 	return size;
 }
 
@@ -158,6 +175,7 @@ InitProcGlobal(void)
 {
 	PGPROC	   *procs;
 	PGXACT	   *pgxacts;
+	char	   *fpPtr;
 	int			i,
 				j;
 	bool		found;
@@ -210,10 +228,28 @@ InitProcGlobal(void)
 	MemSet(pgxacts, 0, TotalProcs * sizeof(PGXACT));
 	ProcGlobal->allPgXact = pgxacts;
 
+	/*
+	 * Allocate the fast-path lock arrays of all PGPROCs in one chunk.  Their
+	 * size depends on max_locks_per_transaction, so they can't be embedded
+	 * in PGPROC itself.
+	 */
+	fpPtr = ShmemAlloc(TotalProcs * FastPathLockShmemSizePerProc());
+	if (!fpPtr)
+		ereport(FATAL,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of shared memory")));
+	MemSet(fpPtr, 0, TotalProcs * FastPathLockShmemSizePerProc());
+
 	for (i = 0; i < TotalProcs; i++)
 	{
 		/* Common initialization for all PGPROCs, regardless of type. */
 
+		/* Point to this PGPROC's part of the fast-path lock arrays */
+		procs[i].fpLockBits = (uint64 *) fpPtr;
+		fpPtr += MAXALIGN(FastPathLockGroupsPerBackend * sizeof(uint64));
+		procs[i].fpRelId = (Oid *) fpPtr;
+		fpPtr += MAXALIGN(FastPathLockSlotsPerBackend() * sizeof(Oid));
+
 		/*
 		 * Set up per-PGPROC semaphore, latch, and backendLock. Prepared xact
 		 * dummy PGPROCs don't need these though - they're never associated
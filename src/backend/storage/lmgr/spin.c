@@ -23,6 +23,7 @@
 #include "postgres.h"
 
 #include "miscadmin.h"
+#include "port/atomics.h"
 #include "replication/walsender.h"
 #include "storage/lwlock.h"
 #include "storage/spin.h"
@@ -61,6 +62,9 @@ SpinlockSemas(void)
 	 * keep the knowledge here.
 	 */
 	nsemas = NumLWLocks();		/* one for each lwlock */
+#ifndef PG_HAVE_ATOMIC_U32_SUPPORT
+	nsemas += NUM_ATOMICS_SPINLOCKS;	/* pool behind emulated atomics */
+#endif
 	nsemas += NBuffers;			/* one for each buffer header */
 	nsemas += max_wal_senders;	/* one for each wal sender process */
 	nsemas += 30;				/* plus a bunch for other small-scale use */
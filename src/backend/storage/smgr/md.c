@@ -637,7 +637,15 @@ mdprefetch(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum)
 	off_t		seekpos;
 	MdfdVec    *v;
 
-	v = _mdfd_getseg(reln, forknum, blocknum, false, EXTENSION_FAIL);
+	/*
+	 * During recovery, the prefetcher looks at WAL records ahead of replay,
+	 * so the relation may well have been dropped or truncated since.  Don't
+	 * complain about missing files then, and don't create segments either.
+	 */
+	v = _mdfd_getseg(reln, forknum, blocknum, false,
+					 InRecovery ? EXTENSION_RETURN_NULL : EXTENSION_FAIL);
+	if (v == NULL)
+		return;
 
 	seekpos = (off_t) BLCKSZ *(blocknum % ((BlockNumber) RELSEG_SIZE));
 
@@ -714,6 +722,95 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	}
 }
 
+/*
+ *	mdreadv() -- Read a range of consecutive blocks from a relation.
+ *
+ *		This is equivalent to calling mdread() for blocks blocknum ..
+ *		blocknum + nblocks - 1, except that the blocks are fetched with as
+ *		few system calls as possible: one readv() per segment file touched,
+ *		or per MAX_FILE_READV_BUFFERS blocks, whichever is smaller.
+ */
+void
+mdreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		char **buffers, BlockNumber nblocks)
+{
+	while (nblocks > 0)
+	{
+		off_t		seekpos;
+		int			nbytes;
+		int			nthis;
+		int			nfull;
+		MdfdVec    *v;
+
+		/* don't cross a segment boundary, nor exceed what readv takes */
+		nthis = Min(nblocks,
+					RELSEG_SIZE - (blocknum % ((BlockNumber) RELSEG_SIZE)));
+		nthis = Min(nthis, MAX_FILE_READV_BUFFERS);
+
+		TRACE_POSTGRESQL_SMGR_MD_READ_START(forknum, blocknum,
+											reln->smgr_rnode.node.spcNode,
+											reln->smgr_rnode.node.dbNode,
+											reln->smgr_rnode.node.relNode,
+											reln->smgr_rnode.backend);
+
+		v = _mdfd_getseg(reln, forknum, blocknum, false, EXTENSION_FAIL);
+
+		seekpos = (off_t) BLCKSZ *(blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+		if (FileSeek(v->mdfd_vfd, seekpos, SEEK_SET) != seekpos)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not seek to block %u in file \"%s\": %m",
+							blocknum, FilePathName(v->mdfd_vfd))));
+
+		nbytes = FileReadV(v->mdfd_vfd, buffers, nthis, BLCKSZ);
+
+		TRACE_POSTGRESQL_SMGR_MD_READ_DONE(forknum, blocknum,
+										   reln->smgr_rnode.node.spcNode,
+										   reln->smgr_rnode.node.dbNode,
+										   reln->smgr_rnode.node.relNode,
+										   reln->smgr_rnode.backend,
+										   nbytes,
+										   nthis * BLCKSZ);
+
+		if (nbytes != nthis * BLCKSZ)
+		{
+			if (nbytes < 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not read blocks %u..%u in file \"%s\": %m",
+								blocknum, blocknum + nthis - 1,
+								FilePathName(v->mdfd_vfd))));
+
+			/*
+			 * Short read: same rules as in mdread().  The blocks that were
+			 * read completely are fine; the rest are zeroed if
+			 * zero_damaged_pages is ON or we are InRecovery.
+			 */
+			nfull = nbytes / BLCKSZ;
+			if (zero_damaged_pages || InRecovery)
+			{
+				int			i;
+
+				for (i = nfull; i < nthis; i++)
+					MemSet(buffers[i], 0, BLCKSZ);
+			}
+			else
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("could not read block %u in file \"%s\": read only %d of %d bytes",
+								blocknum + nfull, FilePathName(v->mdfd_vfd),
+								nbytes % BLCKSZ, BLCKSZ)));
+		}
+
+		blocknum += nthis;
+		buffers += nthis;
+		nblocks -= nthis;
+	}
+}
+
 /*
  *	mdwrite() -- Write the supplied block at the appropriate location.
  *
@@ -783,6 +880,44 @@ mdwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 		register_dirty_segment(reln, forknum, v);
 }
 
+/*
+ *	mdwriteback() -- Tell the kernel to write back a range of blocks.
+ *
+ *		The blocks must have been written with mdwrite() or mdextend()
+ *		before; this only asks the kernel to start writing them to disk,
+ *		without waiting for that to complete.
+ */
+void
+mdwriteback(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			BlockNumber nblocks)
+{
+	while (nblocks > 0)
+	{
+		BlockNumber nthis;
+		off_t		seekpos;
+		MdfdVec    *v;
+
+		/* don't cross a segment boundary */
+		nthis = Min(nblocks,
+					RELSEG_SIZE - (blocknum % ((BlockNumber) RELSEG_SIZE)));
+
+		/*
+		 * The relation may have been truncated or dropped since the blocks
+		 * were written.  There is nothing left to write back then.
+		 */
+		v = _mdfd_getseg(reln, forknum, blocknum, false, EXTENSION_RETURN_NULL);
+		if (v == NULL)
+			return;
+
+		seekpos = (off_t) BLCKSZ *(blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		FileWriteback(v->mdfd_vfd, seekpos, (off_t) BLCKSZ * nthis);
+
+		blocknum += nthis;
+		nblocks -= nthis;
+	}
+}
+
 /*
  *	mdnblocks() -- Get the number of blocks stored in a relation.
  *
@@ -1734,8 +1869,12 @@ _mdfd_getseg(SMgrRelation reln, ForkNumber forknum, BlockNumber blkno,
 			 * with zeroes if needed.  (This only matters if caller is
 			 * extending the relation discontiguously, but that can happen in
 			 * hash indexes.)
+			 *
+			 * A caller that asked for EXTENSION_RETURN_NULL is only probing,
+			 * so never create anything for it, even in recovery.
 			 */
-			if (behavior == EXTENSION_CREATE || InRecovery)
+			if (behavior == EXTENSION_CREATE ||
+				(InRecovery && behavior != EXTENSION_RETURN_NULL))
 			{
 				if (_mdnblocks(reln, forknum, v) < RELSEG_SIZE)
 				{
@@ -51,8 +51,13 @@ typedef struct f_smgr
 											  BlockNumber blocknum);
 	void		(*smgr_read) (SMgrRelation reln, ForkNumber forknum,
 										  BlockNumber blocknum, char *buffer);
+	void		(*smgr_readv) (SMgrRelation reln, ForkNumber forknum,
+								 BlockNumber blocknum, char **buffers,
+										   BlockNumber nblocks);
 	void		(*smgr_write) (SMgrRelation reln, ForkNumber forknum,
 						 BlockNumber blocknum, char *buffer, bool skipFsync);
+	void		(*smgr_writeback) (SMgrRelation reln, ForkNumber forknum,
+								 BlockNumber blocknum, BlockNumber nblocks);
 	BlockNumber (*smgr_nblocks) (SMgrRelation reln, ForkNumber forknum);
 	void		(*smgr_truncate) (SMgrRelation reln, ForkNumber forknum,
 											  BlockNumber nblocks);
@@ -66,8 +71,8 @@ typedef struct f_smgr
 static const f_smgr smgrsw[] = {
 	/* magnetic disk */
 	{mdinit, NULL, mdclose, mdcreate, mdexists, mdunlink, mdextend,
-		mdprefetch, mdread, mdwrite, mdnblocks, mdtruncate, mdimmedsync,
-		mdpreckpt, mdsync, mdpostckpt
+		mdprefetch, mdread, mdreadv, mdwrite, mdwriteback, mdnblocks, mdtruncate,
+		mdimmedsync, mdpreckpt, mdsync, mdpostckpt
 	}
 };
 
@@ -416,15 +421,16 @@ smgrdounlink(SMgrRelation reln, bool isRedo)
 	int			which = reln->smgr_which;
 	ForkNumber	forknum;
 
-	/* Close the forks at smgr level */
-	for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
-		(*(smgrsw[which].smgr_close)) (reln, forknum);
-
 	/*
 	 * Get rid of any remaining buffers for the relation.  bufmgr will just
-	 * drop them without bothering to write the contents.
+	 * drop them without bothering to write the contents.  This is done
+	 * before closing the forks, as bufmgr may look at the fork sizes.
 	 */
-	DropRelFileNodesAllBuffers(&rnode, 1);
+	DropRelFileNodesAllBuffers(&reln, 1);
+
+	/* Close the forks at smgr level */
+	for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+		(*(smgrsw[which].smgr_close)) (reln, forknum);
 
 	/*
 	 * It'd be nice to tell the stats collector to forget it immediately, too.
@@ -476,6 +482,13 @@ smgrdounlinkall(SMgrRelation *rels, int nrels, bool isRedo)
 	if (nrels == 0)
 		return;
 
+	/*
+	 * Get rid of any remaining buffers for the relations.	bufmgr will just
+	 * drop them without bothering to write the contents.  This is done
+	 * before closing the forks, as bufmgr may look at the fork sizes.
+	 */
+	DropRelFileNodesAllBuffers(rels, nrels);
+
 	/*
 	 * create an array which contains all relations to be dropped, and close
 	 * each relation's forks at the smgr level while at it
@@ -493,12 +506,6 @@ smgrdounlinkall(SMgrRelation *rels, int nrels, bool isRedo)
 			(*(smgrsw[which].smgr_close)) (rels[i], forknum);
 	}
 
-	/*
-	 * Get rid of any remaining buffers for the relations.	bufmgr will just
-	 * drop them without bothering to write the contents.
-	 */
-	DropRelFileNodesAllBuffers(rnodes, nrels);
-
 	/*
 	 * It'd be nice to tell the stats collector to forget them immediately,
 	 * too. But we can't because we don't know the OIDs.
@@ -550,14 +557,15 @@ smgrdounlinkfork(SMgrRelation reln, ForkNumber forknum, bool isRedo)
 	RelFileNodeBackend rnode = reln->smgr_rnode;
 	int			which = reln->smgr_which;
 
-	/* Close the fork at smgr level */
-	(*(smgrsw[which].smgr_close)) (reln, forknum);
-
 	/*
 	 * Get rid of any remaining buffers for the fork.  bufmgr will just drop
-	 * them without bothering to write the contents.
+	 * them without bothering to write the contents.  This is done before
+	 * closing the fork, as bufmgr may look at its size.
 	 */
-	DropRelFileNodeBuffers(rnode, forknum, 0);
+	DropRelFileNodeBuffers(reln, forknum, 0);
+
+	/* Close the fork at smgr level */
+	(*(smgrsw[which].smgr_close)) (reln, forknum);
 
 	/*
 	 * It'd be nice to tell the stats collector to forget it immediately, too.
@@ -627,6 +635,21 @@ smgrread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	(*(smgrsw[reln->smgr_which].smgr_read)) (reln, forknum, blocknum, buffer);
 }
 
+/*
+ *	smgrreadv() -- read a range of consecutive blocks from a relation.
+ *
+ *		buffers[i] receives block blocknum + i.  This is equivalent to
+ *		calling smgrread() once per block, but the storage manager is free
+ *		to transfer the whole range at once.
+ */
+void
+smgrreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		  char **buffers, BlockNumber nblocks)
+{
+	(*(smgrsw[reln->smgr_which].smgr_readv)) (reln, forknum, blocknum,
+											  buffers, nblocks);
+}
+
 /*
  *	smgrwrite() -- Write the supplied buffer out.
  *
@@ -650,6 +673,21 @@ smgrwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 											  buffer, skipFsync);
 }
 
+/*
+ *	smgrwriteback() -- Trigger kernel writeback of a range of blocks.
+ *
+ *		The blocks must already have been written with smgrwrite() or
+ *		smgrextend().  This only starts writing them to disk; they are
+ *		not durable until the relation is fsync'd.
+ */
+void
+smgrwriteback(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			  BlockNumber nblocks)
+{
+	(*(smgrsw[reln->smgr_which].smgr_writeback)) (reln, forknum, blocknum,
+												  nblocks);
+}
+
 /*
  *	smgrnblocks() -- Calculate the number of blocks in the
  *					 supplied relation.
@@ -673,7 +711,7 @@ smgrtruncate(SMgrRelation reln, ForkNumber forknum, BlockNumber nblocks)
 	 * Get rid of any buffers for the about-to-be-deleted blocks. bufmgr will
 	 * just drop them without bothering to write the contents.
 	 */
-	DropRelFileNodeBuffers(reln->smgr_rnode, forknum, nblocks);
+	DropRelFileNodeBuffers(reln, forknum, nblocks);
 
 	/*
 	 * Send a shared-inval message to force other backends to close any smgr
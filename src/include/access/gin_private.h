@@ -33,10 +33,11 @@ typedef struct GinPageOpaqueData
 {
 	BlockNumber rightlink;		/* next page if any */
 	OffsetNumber maxoff;		/* number entries on GIN_DATA page: number of
-								 * heap ItemPointers on GIN_DATA|GIN_LEAF page
-								 * or number of PostingItems on GIN_DATA &
-								 * ~GIN_LEAF page. On GIN_LIST page, number of
-								 * heap tuples. */
+								 * heap ItemPointers on an uncompressed
+								 * GIN_DATA|GIN_LEAF page or number of
+								 * PostingItems on GIN_DATA & ~GIN_LEAF page.
+								 * Unused on compressed leaf pages. On
+								 * GIN_LIST page, number of heap tuples. */
 	uint16		flags;			/* see bit definitions below */
 } GinPageOpaqueData;
 
@@ -48,6 +49,8 @@ typedef GinPageOpaqueData *GinPageOpaque;
 #define GIN_META		  (1 << 3)
 #define GIN_LIST		  (1 << 4)
 #define GIN_LIST_FULLROW  (1 << 5)		/* makes sense only on GIN_LIST page */
+#define GIN_COMPRESSED	  (1 << 6)		/* leaf data page holds compressed
+										 * posting lists */
 
 /* Page numbers of fixed-location pages */
 #define GIN_METAPAGE_BLKNO	(0)
@@ -87,7 +90,12 @@ typedef struct GinMetaPageData
 	 * GIN version number (ideally this should have been at the front, but too
 	 * late now.  Don't move it!)
 	 *
-	 * Currently 1 (for indexes initialized in 9.1 or later)
+	 * Currently 2 (for indexes initialized with compressed posting lists)
+	 *
+	 * Version 1 (indexes initialized in 9.1 to 9.3) stores posting lists as
+	 * plain ItemPointerData arrays.  Such lists are still readable, and are
+	 * converted to the compressed format whenever they are modified, so an
+	 * index may contain a mix of both formats.
 	 *
 	 * Version 0 (indexes initialized in 9.0 or before) is compatible but may
 	 * be missing null entries, including both null keys and placeholders.
@@ -96,7 +104,7 @@ typedef struct GinMetaPageData
 	int32		ginVersion;
 } GinMetaPageData;
 
-#define GIN_CURRENT_VERSION		1
+#define GIN_CURRENT_VERSION		2
 
 #define GinPageGetMeta(p) \
 	((GinMetaPageData *) PageGetContents(p))
@@ -115,6 +123,8 @@ typedef struct GinMetaPageData
 #define GinPageSetList(page)   ( GinPageGetOpaque(page)->flags |= GIN_LIST )
 #define GinPageHasFullRow(page)    ( GinPageGetOpaque(page)->flags & GIN_LIST_FULLROW )
 #define GinPageSetFullRow(page)   ( GinPageGetOpaque(page)->flags |= GIN_LIST_FULLROW )
+#define GinPageIsCompressed(page)	 ( GinPageGetOpaque(page)->flags & GIN_COMPRESSED )
+#define GinPageSetCompressed(page)	 ( GinPageGetOpaque(page)->flags |= GIN_COMPRESSED )
 
 #define GinPageIsDeleted(page) ( GinPageGetOpaque(page)->flags & GIN_DELETED)
 #define GinPageSetDeleted(page)    ( GinPageGetOpaque(page)->flags |= GIN_DELETED)
@@ -132,6 +142,12 @@ typedef struct GinMetaPageData
 #define GinItemPointerGetOffsetNumber(pointer) \
 	((pointer)->ip_posid)
 
+#define GinItemPointerSetBlockNumber(pointer, blkno) \
+	(BlockIdSet(&((pointer)->ip_blkid), blkno))
+
+#define GinItemPointerSetOffsetNumber(pointer, offnum) \
+	((pointer)->ip_posid = (offnum))
+
 /*
  * Special-case item pointer values needed by the GIN search logic.
  *	MIN: sorts less than any valid item pointer
@@ -174,6 +190,30 @@ typedef struct
 #define PostingItemSetBlockNumber(pointer, blockNumber) \
 	BlockIdSet(&((pointer)->child_blkno), (blockNumber))
 
+/*
+ * A compressed posting list.
+ *
+ * Note: This requires 2-byte alignment.
+ */
+typedef struct
+{
+	ItemPointerData first;		/* first item in this posting list (unpacked) */
+	uint16		nbytes;			/* number of bytes that follow */
+	unsigned char bytes[1];		/* varbyte encoded items (variable length) */
+} GinPostingList;
+
+#define SizeOfGinPostingList(plist) \
+	(offsetof(GinPostingList, bytes) + SHORTALIGN((plist)->nbytes) )
+#define GinNextPostingListSegment(cur) \
+	((GinPostingList *) (((char *) (cur)) + SizeOfGinPostingList((cur))))
+
+/*
+ * Maximum size of a posting list segment on a leaf data page.  Keeping the
+ * segments small means an insertion only needs to re-encode the segment it
+ * falls into and the ones after it, not the whole page.
+ */
+#define GinPostingListSegmentMaxSize	256
+
 /*
  * Category codes to distinguish placeholder nulls from ordinary NULL keys.
  * Note that the datatype size and the first two code values are chosen to be
@@ -211,9 +251,16 @@ typedef signed char GinNullCategory;
 #define GinSetPostingTree(itup, blkno)	( GinSetNPosting((itup),GIN_TREE_POSTING), ItemPointerSetBlockNumber(&(itup)->t_tid, blkno) )
 #define GinGetPostingTree(itup) GinItemPointerGetBlockNumber(&(itup)->t_tid)
 
-#define GinGetPostingOffset(itup)	GinItemPointerGetBlockNumber(&(itup)->t_tid)
-#define GinSetPostingOffset(itup,n) ItemPointerSetBlockNumber(&(itup)->t_tid,n)
-#define GinGetPosting(itup)			((ItemPointer) ((char*)(itup) + GinGetPostingOffset(itup)))
+/*
+ * The high bit of the posting list offset marks a compressed posting list;
+ * tuples written before compression was introduced have it clear and carry
+ * a plain ItemPointerData array instead.
+ */
+#define GIN_ITUP_COMPRESSED		(1U << 31)
+#define GinItupIsCompressed(itup)	(GinItemPointerGetBlockNumber(&(itup)->t_tid) & GIN_ITUP_COMPRESSED)
+#define GinGetPostingOffset(itup)	(GinItemPointerGetBlockNumber(&(itup)->t_tid) & (~GIN_ITUP_COMPRESSED))
+#define GinSetPostingOffset(itup,n) ItemPointerSetBlockNumber(&(itup)->t_tid,(n)|GIN_ITUP_COMPRESSED)
+#define GinGetPosting(itup)			((Pointer) ((char*)(itup) + GinGetPostingOffset(itup)))
 
 #define GinMaxItemSize \
 	MAXALIGN_DOWN(((BLCKSZ - SizeOfPageHeaderData - \
@@ -243,11 +290,27 @@ typedef signed char GinNullCategory;
 	 - GinPageGetOpaque(page)->maxoff * GinSizeOfDataPageItem(page) \
 	 - MAXALIGN(sizeof(GinPageOpaqueData)))
 
-#define GinMaxLeafDataItems \
-	((BLCKSZ - MAXALIGN(SizeOfPageHeaderData) - \
-	  MAXALIGN(sizeof(ItemPointerData)) - \
-	  MAXALIGN(sizeof(GinPageOpaqueData))) \
-	 / sizeof(ItemPointerData))
+/*
+ * Compressed leaf data pages hold a sequence of GinPostingList segments
+ * after the right bound; pd_lower marks the end of the last segment.
+ */
+#define GinDataLeafPageGetPostingList(page) \
+	((GinPostingList *) GinDataPageGetData(page))
+#define GinDataLeafPageGetPostingListSize(page) \
+	(((PageHeader) (page))->pd_lower - MAXALIGN(SizeOfPageHeaderData) - \
+	 MAXALIGN(sizeof(ItemPointerData)))
+#define GinDataLeafPageSetPostingListSize(page, size) \
+	(((PageHeader) (page))->pd_lower = (size) + \
+	 MAXALIGN(SizeOfPageHeaderData) + MAXALIGN(sizeof(ItemPointerData)))
+#define GinDataLeafPageIsEmpty(page) \
+	(GinPageIsCompressed(page) ? \
+	 (GinDataLeafPageGetPostingListSize(page) == 0) : \
+	 (GinPageGetOpaque(page)->maxoff < FirstOffsetNumber))
+
+#define GinDataLeafMaxContentSize \
+	(BLCKSZ - MAXALIGN(SizeOfPageHeaderData) - \
+	 MAXALIGN(sizeof(ItemPointerData)) - \
+	 MAXALIGN(sizeof(GinPageOpaqueData)))
 
 /*
  * List pages
@@ -322,8 +385,8 @@ typedef struct ginxlogCreatePostingTree
 {
 	RelFileNode node;
 	BlockNumber blkno;
-	uint32		nitem;
-	/* follows list of heap's ItemPointer */
+	uint32		size;
+	/* follows compressed posting lists, size bytes */
 } ginxlogCreatePostingTree;
 
 #define XLOG_GIN_INSERT  0x20
@@ -340,8 +403,8 @@ typedef struct ginxlogInsert
 	OffsetNumber nitem;
 
 	/*
-	 * follows: tuples or ItemPointerData or PostingItem or list of
-	 * ItemPointerData
+	 * follows: tuple, PostingItem, or (on a leaf data page) the nitem new
+	 * ItemPointerData that were merged into the page's posting list
 	 */
 } ginxlogInsert;
 
@@ -365,7 +428,11 @@ typedef struct ginxlogSplit
 	BlockNumber updateBlkno;
 
 	ItemPointerData rightbound; /* used only in posting tree */
-	/* follows: list of tuple or ItemPointerData or PostingItem */
+
+	/* sizes of the compressed data areas, used only for posting tree leaves */
+	uint16		lsize;
+	uint16		rsize;
+	/* follows: list of tuple or PostingItem, or left and right data areas */
 } ginxlogSplit;
 
 #define XLOG_GIN_VACUUM_PAGE	0x40
@@ -375,7 +442,12 @@ typedef struct ginxlogVacuumPage
 	RelFileNode node;
 	BlockNumber blkno;
 	OffsetNumber nitem;
-	/* follows content of page */
+
+	/*
+	 * follows content of page: index tuples on an entry page; on a data page
+	 * either nitem uncompressed ItemPointerData or, if nitem is 0, the
+	 * compressed posting lists filling the rest of the record
+	 */
 } ginxlogVacuumPage;
 
 #define XLOG_GIN_DELETE_PAGE	0x50
@@ -509,6 +581,15 @@ typedef struct GinBtreeData
 	uint32		curitem;
 
 	PostingItem pitem;
+
+	/*
+	 * New content of a leaf data page, computed by isEnoughSpace so that
+	 * placeToPage only has to copy it in.  leafNewItems is the number of
+	 * items, starting at curitem, that are merged into the page.
+	 */
+	char	   *leafData;
+	Size		leafDataSize;
+	uint32		leafNewItems;
 } GinBtreeData;
 
 extern GinBtreeStack *ginPrepareFindLeafPage(GinBtree btree, BlockNumber blkno);
@@ -522,8 +603,9 @@ extern void ginFindParents(GinBtree btree, GinBtreeStack *stack, BlockNumber roo
 /* ginentrypage.c */
 extern IndexTuple GinFormTuple(GinState *ginstate,
 			 OffsetNumber attnum, Datum key, GinNullCategory category,
-			 ItemPointerData *ipd, uint32 nipd, bool errorTooBig);
-extern void GinShortenTuple(IndexTuple itup, uint32 nipd);
+			 Pointer data, Size dataSize, int nipd, bool errorTooBig);
+extern ItemPointer ginReadTuple(GinState *ginstate, OffsetNumber attnum,
+			 IndexTuple itup, int *nitems);
 extern void ginPrepareEntryScan(GinBtree btree, OffsetNumber attnum,
 					Datum key, GinNullCategory category,
 					GinState *ginstate);
@@ -538,6 +620,11 @@ extern uint32 ginMergeItemPointers(ItemPointerData *dst,
 
 extern void GinDataPageAddItem(Page page, void *data, OffsetNumber offset);
 extern void GinPageDeletePostingItem(Page page, OffsetNumber offset);
+extern ItemPointer GinDataLeafPageGetItems(Page page, int *nitems);
+extern uint32 ginDataLeafPageEncode(Page page, ItemPointerData *items,
+					 uint32 nitems);
+extern bool ginDataLeafPageAddItems(Page page, ItemPointerData *items,
+						uint32 nitems);
 
 typedef struct
 {
@@ -554,6 +641,15 @@ extern Buffer ginScanBeginPostingTree(GinPostingTreeScan *gdi);
 extern void ginDataFillRoot(GinBtree btree, Buffer root, Buffer lbuf, Buffer rbuf);
 extern void ginPrepareDataScan(GinBtree btree, Relation index);
 
+/* ginpostinglist.c */
+extern GinPostingList *ginCompressPostingList(const ItemPointer ipd, int nipd,
+					   int maxsize, int *nwritten);
+extern ItemPointer ginPostingListDecode(GinPostingList *ptr, int *ndecoded);
+extern ItemPointer ginPostingListDecodeAllSegments(GinPostingList *ptr,
+								int len, int *ndecoded);
+extern int ginPostingListDecodeAllSegmentsToTbm(GinPostingList *ptr, int len,
+									 TIDBitmap *tbm);
+
 /* ginscan.c */
 
 /*
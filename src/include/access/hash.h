@@ -45,24 +45,39 @@ typedef uint32 Bucket;
  * available to other buckets by calling _hash_freeovflpage(). If all
  * the tuples are deleted from a bucket page, no additional action is
  * necessary.
+ *
+ * The primary page of a bucket additionally carries a flag while a split
+ * of that bucket is in progress: LH_BUCKET_BEING_SPLIT on the old bucket,
+ * and LH_BUCKET_BEING_POPULATED on the new bucket that receives its tuples
+ * (see README).  Use LH_PAGE_TYPE to extract just the page type.
  */
 #define LH_UNUSED_PAGE			(0)
 #define LH_OVERFLOW_PAGE		(1 << 0)
 #define LH_BUCKET_PAGE			(1 << 1)
 #define LH_BITMAP_PAGE			(1 << 2)
 #define LH_META_PAGE			(1 << 3)
+#define LH_BUCKET_BEING_POPULATED	(1 << 4)
+#define LH_BUCKET_BEING_SPLIT	(1 << 5)
+
+#define LH_PAGE_TYPE \
+	(LH_OVERFLOW_PAGE | LH_BUCKET_PAGE | LH_BITMAP_PAGE | LH_META_PAGE)
 
 typedef struct HashPageOpaqueData
 {
 	BlockNumber hasho_prevblkno;	/* previous ovfl (or bucket) blkno */
 	BlockNumber hasho_nextblkno;	/* next ovfl blkno */
 	Bucket		hasho_bucket;	/* bucket number this pg belongs to */
-	uint16		hasho_flag;		/* page type code, see above */
+	uint16		hasho_flag;		/* page type code + flag bits, see above */
 	uint16		hasho_page_id;	/* for identification of hash indexes */
 } HashPageOpaqueData;
 
 typedef HashPageOpaqueData *HashPageOpaque;
 
+#define H_BUCKET_BEING_SPLIT(opaque) \
+	(((opaque)->hasho_flag & LH_BUCKET_BEING_SPLIT) != 0)
+#define H_BUCKET_BEING_POPULATED(opaque) \
+	(((opaque)->hasho_flag & LH_BUCKET_BEING_POPULATED) != 0)
+
 /*
  * The page ID is for the convenience of pg_filedump and similar utilities,
  * which otherwise would have a hard time telling pages of different index
@@ -92,6 +107,30 @@ typedef struct HashScanOpaqueData
 	 */
 	BlockNumber hashso_bucket_blkno;
 
+	/*
+	 * We keep the primary page of the bucket pinned for the whole scan.  WAL
+	 * replay of operations that move or remove tuples takes a cleanup lock
+	 * on that page, so the pin keeps such changes away from hot standby
+	 * scans, which take no heavyweight locks the startup process respects.
+	 */
+	Buffer		hashso_bucket_buf;
+
+	/*
+	 * If the bucket is still being populated by a split, tuples that belong
+	 * to it may still be in the bucket being split, so we must scan that one
+	 * too.  We then hold a share lock and a pin on the primary page of the
+	 * bucket being split as well.
+	 */
+	Bucket		hashso_split_bucket;
+	BlockNumber hashso_split_bucket_blkno;
+	Buffer		hashso_split_bucket_buf;
+
+	/* Whether the bucket being scanned is being populated by a split */
+	bool		hashso_buc_populated;
+
+	/* Whether we are currently scanning the bucket being split */
+	bool		hashso_buc_split;
+
 	/*
 	 * We also want to remember which buffer we're currently examining in the
 	 * scan. We keep the buffer pinned (but not locked) across hashgettuple
@@ -287,13 +326,18 @@ extern Datum hash_uint32(uint32 k);
 extern void _hash_doinsert(Relation rel, IndexTuple itup);
 extern OffsetNumber _hash_pgaddtup(Relation rel, Buffer buf,
 			   Size itemsize, IndexTuple itup);
+extern void _hash_movetuples(Relation rel, Buffer wbuf, Buffer rbuf,
+				 BlockNumber wbucket_blkno, BlockNumber rbucket_blkno,
+				 IndexTuple *itups, OffsetNumber *deletable,
+				 uint16 nitups);
 
 /* hashovfl.c */
 extern Buffer _hash_addovflpage(Relation rel, Buffer metabuf, Buffer buf);
-extern BlockNumber _hash_freeovflpage(Relation rel, Buffer ovflbuf,
-				   BufferAccessStrategy bstrategy);
+extern BlockNumber _hash_freeovflpage(Relation rel, BlockNumber bucket_blkno,
+				   Buffer ovflbuf, BufferAccessStrategy bstrategy);
 extern void _hash_initbitmap(Relation rel, HashMetaPage metap,
 				 BlockNumber blkno, ForkNumber forkNum);
+extern void _hash_initbitmapbuffer(Buffer buf, uint16 bmsize, bool initpage);
 extern void _hash_squeezebucket(Relation rel,
 					Bucket bucket, BlockNumber bucket_blkno,
 					BufferAccessStrategy bstrategy);
@@ -312,13 +356,14 @@ extern Buffer _hash_getbuf_with_strategy(Relation rel, BlockNumber blkno,
 						   BufferAccessStrategy bstrategy);
 extern void _hash_relbuf(Relation rel, Buffer buf);
 extern void _hash_dropbuf(Relation rel, Buffer buf);
-extern void _hash_wrtbuf(Relation rel, Buffer buf);
+extern void _hash_dropscanbuf(Relation rel, HashScanOpaque so);
 extern void _hash_chgbufaccess(Relation rel, Buffer buf, int from_access,
 				   int to_access);
 extern uint32 _hash_metapinit(Relation rel, double num_tuples,
 				ForkNumber forkNum);
 extern void _hash_pageinit(Page page, Size size);
 extern void _hash_expandtable(Relation rel, Buffer metabuf);
+extern void _hash_finish_split(Relation rel, Buffer metabuf, Bucket bucket);
 
 /* hashscan.c */
 extern void _hash_regscan(IndexScanDesc scan);
@@ -352,9 +397,8 @@ extern IndexTuple _hash_form_tuple(Relation index,
 				 Datum *values, bool *isnull);
 extern OffsetNumber _hash_binsearch(Page page, uint32 hash_value);
 extern OffsetNumber _hash_binsearch_last(Page page, uint32 hash_value);
-
-/* hash.c */
-extern void hash_redo(XLogRecPtr lsn, XLogRecord *record);
-extern void hash_desc(StringInfo buf, uint8 xl_info, char *rec);
+extern Bucket _hash_get_oldbucket(Bucket new_bucket);
+extern Bucket _hash_get_newbucket(Bucket old_bucket, uint32 lowmask,
+					uint32 maxbucket);
 
 #endif   /* HASH_H */
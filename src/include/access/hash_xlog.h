@@ -0,0 +1,207 @@
+/*-------------------------------------------------------------------------
+ *
+ * hash_xlog.h
+ *	  header file for Postgres hash AM WAL definitions.
+ *
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/hash_xlog.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef HASH_XLOG_H
+#define HASH_XLOG_H
+
+#include "access/hash.h"
+#include "access/xlog.h"
+#include "lib/stringinfo.h"
+#include "storage/off.h"
+#include "storage/relfilenode.h"
+
+
+/*
+ * XLOG records for hash operations
+ *
+ * XLOG allows to store some information in high 4 bits of log
+ * record xl_info field.
+ *
+ * Index creation writes full-page images of the new pages with
+ * log_newpage, so there are no records of our own for that.
+ */
+#define XLOG_HASH_INSERT				0x00	/* add index tuple */
+#define XLOG_HASH_ADD_OVFL_PAGE			0x10	/* add overflow page */
+#define XLOG_HASH_SPLIT_ALLOCATE_PAGE	0x20	/* start a bucket split */
+#define XLOG_HASH_SPLIT_COMPLETE		0x30	/* finish a bucket split */
+#define XLOG_HASH_MOVE_PAGE_CONTENTS	0x40	/* move tuples between pages,
+												 * for split or squeeze */
+#define XLOG_HASH_FREE_OVFL_PAGE		0x50	/* remove empty overflow page
+												 * from its bucket */
+#define XLOG_HASH_DELETE				0x60	/* delete index tuples */
+#define XLOG_HASH_UPDATE_META_PAGE		0x70	/* update tuple count */
+
+/*
+ * This is what we need to know about a simple (without split) insert.
+ *
+ * The page is backup block 0 and the metapage backup block 1.  The index
+ * tuple follows the struct, unless the page was backed up.
+ */
+typedef struct xl_hash_insert
+{
+	RelFileNode node;
+	BlockNumber blkno;			/* page the tuple was added to */
+	OffsetNumber offnum;		/* position of the new tuple */
+	/* INDEX TUPLE FOLLOWS AT END OF STRUCT */
+} xl_hash_insert;
+
+#define SizeOfHashInsert	(offsetof(xl_hash_insert, offnum) + sizeof(OffsetNumber))
+
+/*
+ * This is what we need to know about the addition of an overflow page to a
+ * bucket chain.
+ *
+ * The overflow page, and the new bitmap page if one was needed, are
+ * reinitialized from scratch, so they are never backed up.  The backup
+ * blocks are the previous tail page of the chain, then the bitmap page in
+ * which a free page was found (if mapblkno is valid), and then the metapage.
+ */
+typedef struct xl_hash_add_ovfl_page
+{
+	RelFileNode node;
+	Bucket		bucket;			/* bucket the page is added to */
+	BlockNumber ovflblkno;		/* the new overflow page */
+	BlockNumber prevblkno;		/* previous tail page of the bucket */
+	BlockNumber mapblkno;		/* bitmap page a recycled page was found in,
+								 * or InvalidBlockNumber */
+	uint32		bitmapbit;		/* bit to set in that bitmap page */
+	BlockNumber newmapblkno;	/* newly added bitmap page, or
+								 * InvalidBlockNumber */
+	uint32		firstfree;		/* new hashm_firstfree */
+	uint32		spares;			/* new hashm_spares[hashm_ovflpoint] */
+	uint16		bmsize;			/* hashm_bmsize, to initialize new bitmap */
+} xl_hash_add_ovfl_page;
+
+#define SizeOfHashAddOvflPage	(offsetof(xl_hash_add_ovfl_page, bmsize) + sizeof(uint16))
+
+/*
+ * This is what we need to know about the beginning of a bucket split: the
+ * metapage changes that create the new bucket, the initialization of the new
+ * bucket's primary page, and the split-in-progress flag of the old bucket.
+ *
+ * The old bucket's primary page is backup block 0, the metapage backup
+ * block 1.  The new bucket's primary page is initialized from scratch.
+ */
+typedef struct xl_hash_split_allocate_page
+{
+	RelFileNode node;
+	Bucket		new_bucket;		/* new hashm_maxbucket */
+	BlockNumber old_bucket_blkno;	/* primary page of the bucket being split */
+	BlockNumber new_bucket_blkno;	/* primary page of the new bucket */
+	uint32		lowmask;		/* new hashm_lowmask */
+	uint32		highmask;		/* new hashm_highmask */
+	uint32		ovflpoint;		/* new hashm_ovflpoint */
+	uint32		spares;			/* new hashm_spares[ovflpoint] */
+} xl_hash_split_allocate_page;
+
+#define SizeOfHashSplitAllocatePage	(offsetof(xl_hash_split_allocate_page, spares) + sizeof(uint32))
+
+/*
+ * This is what we need to know when a split is complete: the
+ * split-in-progress flags are cleared on both primary bucket pages, which
+ * are backup blocks 0 (old bucket) and 1 (new bucket).
+ */
+typedef struct xl_hash_split_complete
+{
+	RelFileNode node;
+	BlockNumber old_bucket_blkno;
+	BlockNumber new_bucket_blkno;
+} xl_hash_split_complete;
+
+#define SizeOfHashSplitComplete	(offsetof(xl_hash_split_complete, new_bucket_blkno) + sizeof(BlockNumber))
+
+/*
+ * This is what we need to know about a batch of tuples moved from one page
+ * to another, by a bucket split or by squeezing a bucket.  Adding the tuples
+ * to the "write" page and removing them from the "read" page is a single
+ * atomic action, so a crash can never leave a tuple on both pages or on
+ * neither.
+ *
+ * The write page is backup block 0 and the read page backup block 1.  Unless
+ * the write page was backed up, the struct is followed by the offsets the
+ * tuples were added at and then by the tuples themselves, each one
+ * MAXALIGN'd; unless the read page was backed up, the offsets of the
+ * removed tuples follow.
+ *
+ * The primary pages of the buckets the two pages belong to are recorded as
+ * well, because replay must lock out hot standby scans of those buckets;
+ * see the README.  When squeezing, it is the same bucket.
+ */
+typedef struct xl_hash_move_page_contents
+{
+	RelFileNode node;
+	BlockNumber wbucket_blkno;	/* primary page of the write page's bucket */
+	BlockNumber rbucket_blkno;	/* primary page of the read page's bucket */
+	BlockNumber wblkno;			/* page the tuples were added to */
+	BlockNumber rblkno;			/* page the tuples were removed from */
+	uint16		ntups;			/* number of tuples moved */
+} xl_hash_move_page_contents;
+
+#define SizeOfHashMovePageContents	(offsetof(xl_hash_move_page_contents, ntups) + sizeof(uint16))
+
+/*
+ * This is what we need to know about freeing an empty overflow page: it is
+ * unlinked from its bucket chain, reinitialized as an unused page (never
+ * backed up), and marked free in the bitmap.
+ *
+ * Backup blocks are the previous page in the chain (if prevblkno is valid),
+ * the next page (if nextblkno is valid), the bitmap page, and then the
+ * metapage if update_firstfree is set.
+ */
+typedef struct xl_hash_free_ovfl_page
+{
+	RelFileNode node;
+	BlockNumber bucket_blkno;	/* primary page of the bucket */
+	BlockNumber ovflblkno;		/* the page being freed */
+	BlockNumber prevblkno;
+	BlockNumber nextblkno;
+	BlockNumber mapblkno;		/* bitmap page with the page's bit */
+	uint32		bitmapbit;		/* bit to clear in that bitmap page */
+	uint32		firstfree;		/* new hashm_firstfree ... */
+	bool		update_firstfree;	/* ... if this is set */
+} xl_hash_free_ovfl_page;
+
+#define SizeOfHashFreeOvflPage	(offsetof(xl_hash_free_ovfl_page, update_firstfree) + sizeof(bool))
+
+/*
+ * This is what we need to know about the removal of dead tuples from a page
+ * by VACUUM.  The page is backup block 0; unless it was backed up, the
+ * offsets of the deleted tuples follow the struct.
+ */
+typedef struct xl_hash_delete
+{
+	RelFileNode node;
+	BlockNumber bucket_blkno;	/* primary page of the bucket */
+	BlockNumber blkno;			/* page the tuples were removed from */
+	/* TARGET OFFSET NUMBERS FOLLOW AT THE END */
+} xl_hash_delete;
+
+#define SizeOfHashDelete	(offsetof(xl_hash_delete, blkno) + sizeof(BlockNumber))
+
+/*
+ * This is what we need to know about VACUUM's update of the tuple count in
+ * the metapage, which is backup block 0.
+ */
+typedef struct xl_hash_update_meta_page
+{
+	RelFileNode node;
+	double		ntuples;
+} xl_hash_update_meta_page;
+
+#define SizeOfHashUpdateMetaPage	(offsetof(xl_hash_update_meta_page, ntuples) + sizeof(double))
+
+
+extern void hash_redo(XLogRecPtr lsn, XLogRecord *record);
+extern void hash_desc(StringInfo buf, uint8 xl_info, char *rec);
+
+#endif   /* HASH_XLOG_H */
@@ -0,0 +1,63 @@
+/*-------------------------------------------------------------------------
+ *
+ * parallel.h
+ *	  Infrastructure for launching parallel workers
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/parallel.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "access/htup.h"
+#include "access/relscan.h"
+#include "lib/ilist.h"
+#include "postmaster/bgworker.h"
+#include "storage/shm_mq.h"
+#include "utils/relcache.h"
+#include "utils/snapshot.h"
+
+/* Opaque shared-memory state for one parallel operation. */
+struct ParallelQuerySlot;
+
+/*
+ * Backend-private state for a parallel operation started by this backend.
+ * Contexts are allocated in TopTransactionContext and are cleaned up
+ * automatically at the end of the (sub)transaction that created them.
+ */
+typedef struct ParallelContext
+{
+	dlist_node	node;			/* link in list of live contexts */
+	SubTransactionId subid;		/* subtransaction that created it */
+	int			nworkers;		/* number of worker queues */
+	int			nworkers_launched;		/* number of workers registered */
+	int			nreaders;		/* number of queues not yet drained */
+	int			nextreader;		/* queue to try next */
+	struct ParallelQuerySlot *slot;
+	shm_mq_handle **queues;
+	bool	   *queue_active;
+	ParallelHeapScanDesc pscan; /* shared block allocator */
+} ParallelContext;
+
+extern Size ParallelShmemSize(void);
+extern void ParallelShmemInit(void);
+
+extern ParallelContext *CreateParallelContext(int nworkers, Relation rel,
+					  Snapshot snapshot, List *qual);
+extern void LaunchParallelWorkers(ParallelContext *pcxt);
+extern void CloseParallelContext(ParallelContext *pcxt);
+extern MinimalTuple ParallelContextReadTuple(ParallelContext *pcxt,
+						 bool nowait, bool *done);
+extern void DestroyParallelContext(ParallelContext *pcxt);
+
+extern void AtEOXact_Parallel(bool isCommit);
+extern void AtEOSubXact_Parallel(bool isCommit, SubTransactionId mySubId,
+					 SubTransactionId parentSubId);
+
+extern void ParallelQueryWorkerMain(Datum main_arg);
+
+#endif   /* PARALLEL_H */
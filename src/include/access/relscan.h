@@ -19,7 +19,27 @@
 #include "access/htup_details.h"
 #include "access/itup.h"
 #include "access/tupdesc.h"
+#include "storage/readstream.h"
+#include "storage/spin.h"
 
+/*
+ * Shared state for a parallel heap scan.
+ *
+ * Each backend participating in a parallel heap scan has its own
+ * HeapScanDesc in backend-private memory, and those objects all contain
+ * a pointer to this structure.  The information here must be sufficient
+ * to properly initialize each new HeapScanDesc as workers join the scan,
+ * and it must act as a font of block numbers for those workers.  The
+ * structure can live in shared memory, or in ordinary backend-local memory
+ * if the scan ends up not being parallel after all.
+ */
+typedef struct ParallelHeapScanDescData
+{
+	Oid			phs_relid;		/* OID of relation to scan */
+	BlockNumber phs_nblocks;	/* # blocks in relation at start of scan */
+	slock_t		phs_mutex;		/* mutual exclusion for block number fields */
+	BlockNumber phs_cblock;		/* next block to be handed out */
+}	ParallelHeapScanDescData;
 
 typedef struct HeapScanDescData
 {
@@ -36,8 +56,17 @@ typedef struct HeapScanDescData
 	/* state set up at initscan time */
 	BlockNumber rs_nblocks;		/* number of blocks to scan */
 	BlockNumber rs_startblock;	/* block # to start at */
+	BlockNumber rs_numblocks;	/* max number of blocks to scan */
+	/* rs_numblocks is usually InvalidBlockNumber, meaning "scan whole rel" */
 	BufferAccessStrategy rs_strategy;	/* access strategy for reads */
 	bool		rs_syncscan;	/* report location to syncscan logic? */
+	ParallelHeapScanDesc rs_parallel;	/* parallel scan information */
+	bool		rs_readahead;	/* read pages through rs_stream? */
+
+	/* read-ahead state, only used if rs_readahead */
+	ReadStream *rs_stream;		/* NULL until the first page is read */
+	BlockNumber rs_stream_block;	/* next block to feed into rs_stream */
+	BlockNumber rs_stream_next; /* next block rs_stream will return */
 
 	/* scan current state */
 	bool		rs_inited;		/* false = scan not init'd yet */
@@ -36,6 +36,19 @@
  */
 #define SLRU_PAGES_PER_SEGMENT	32
 
+/*
+ * The buffer slots of an SLRU are divided into banks of SLRU_BANK_SIZE
+ * slots; a given page can only ever be held by the bank selected by its
+ * page number (see SlruPageBank), so that looking up a page or choosing a
+ * victim slot only has to search one bank.  SLRUs with fewer slots than
+ * this have a single bank.  Configurable buffer counts must be a multiple
+ * of the bank size.
+ */
+#define SLRU_BANK_SIZE			16
+
+/* Upper limit for the configurable buffer counts (1GB worth of pages) */
+#define SLRU_MAX_BUFFERS		(1024 * 1024 * 1024 / BLCKSZ)
+
 /*
  * Page status codes.  Note that these do not include the "dirty" bit.
  * page_dirty can be TRUE only in the VALID or WRITE_IN_PROGRESS states;
@@ -55,11 +68,19 @@ typedef enum
  */
 typedef struct SlruSharedData
 {
-	LWLockId	ControlLock;
-
 	/* Number of buffers managed by this SLRU structure */
 	int			num_slots;
 
+	/*
+	 * The slots are divided into num_banks banks of bank_size slots each.
+	 * bank_locks[] holds the lock protecting each bank's slots; depending on
+	 * how the SLRU was initialized, these are either all the same lock (the
+	 * SLRU's control lock) or one separate lock per bank.
+	 */
+	int			num_banks;
+	int			bank_size;
+	LWLockId   *bank_locks;
+
 	/*
 	 * Arrays holding info for each buffer slot.  Page number is undefined
 	 * when status is EMPTY, as is page_lru_count.
@@ -83,26 +104,38 @@ typedef struct SlruSharedData
 	int			lsn_groups_per_page;
 
 	/*----------
-	 * We mark a page "most recently used" by setting
-	 *		page_lru_count[slotno] = ++cur_lru_count;
-	 * The oldest page is therefore the one with the highest value of
-	 *		cur_lru_count - page_lru_count[slotno]
+	 * Each bank has its own LRU counter.  We mark a page "most recently
+	 * used" by setting
+	 *		page_lru_count[slotno] = ++bank_cur_lru_count[bankno];
+	 * The oldest page in a bank is therefore the one with the highest value
+	 * of
+	 *		bank_cur_lru_count[bankno] - page_lru_count[slotno]
 	 * The counts will eventually wrap around, but this calculation still
 	 * works as long as no page's age exceeds INT_MAX counts.
 	 *----------
 	 */
-	int			cur_lru_count;
+	int		   *bank_cur_lru_count;
 
 	/*
 	 * latest_page_number is the page number of the current end of the log;
 	 * this is not critical data, since we use it only to avoid swapping out
-	 * the latest page.
+	 * the latest page.  It is set under the bank lock of the page in
+	 * question, so readers holding some other bank's lock may see a stale
+	 * value.
 	 */
 	int			latest_page_number;
+
+	/* index of this SLRU in the cumulative statistics, see pgstat.c */
+	int			slru_stats_idx;
 } SlruSharedData;
 
 typedef SlruSharedData *SlruShared;
 
+/* Which bank a page belongs to, and the lock protecting that bank */
+#define SlruPageBank(shared, pageno)	((pageno) % (shared)->num_banks)
+#define SimpleLruGetBankLock(ctl, pageno) \
+	((ctl)->shared->bank_locks[SlruPageBank((ctl)->shared, pageno)])
+
 /*
  * SlruCtlData is an unshared structure that points to the active information
  * in shared memory.
@@ -135,8 +168,11 @@ typedef SlruCtlData *SlruCtl;
 
 
 extern Size SimpleLruShmemSize(int nslots, int nlsns);
+extern int	SimpleLruNumBanks(int nslots);
 extern void SimpleLruInit(SlruCtl ctl, const char *name, int nslots, int nlsns,
 			  LWLockId ctllock, const char *subdir);
+extern void SimpleLruInitBanked(SlruCtl ctl, const char *name, int nslots,
+					int nlsns, const char *subdir);
 extern int	SimpleLruZeroPage(SlruCtl ctl, int pageno);
 extern int SimpleLruReadPage(SlruCtl ctl, int pageno, bool write_ok,
 				  TransactionId xid);
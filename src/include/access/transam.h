@@ -123,6 +123,14 @@ typedef struct VariableCacheData
 	 */
 	TransactionId latestCompletedXid;	/* newest XID that has committed or
 										 * aborted */
+
+	/*
+	 * Number of top-level transactions with XIDs completed (committed or
+	 * aborted) since shared memory was initialized.  Lets GetSnapshotData
+	 * tell whether a previously built snapshot would still be the same.
+	 * Also protected by ProcArrayLock.
+	 */
+	uint64		xactCompletionCount;
 } VariableCacheData;
 
 typedef VariableCacheData *VariableCache;
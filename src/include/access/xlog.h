@@ -32,7 +32,9 @@
  * bits).  XLogRecord structs always start on MAXALIGN boundaries in the WAL
  * files, and we round up SizeOfXLogRecord so that the rmgr data is also
  * guaranteed to begin on a MAXALIGN boundary.	However, no padding is added
- * to align BkpBlock structs or backup block data.
+ * to align BkpBlock structs or backup block data.  The backup block data is
+ * the page image, minus its unused "hole" and possibly compressed; see
+ * BkpBlock in xlog_internal.h.
  *
  * NOTE: xl_len counts only the rmgr data, not the XLogRecord header,
  * and also not any backup blocks.	xl_tot_len counts everything.  Neither
@@ -189,6 +191,7 @@ extern bool XLogArchiveMode;
 extern char *XLogArchiveCommand;
 extern bool EnableHotStandby;
 extern bool fullPageWrites;
+extern bool wal_compression;
 extern bool log_checkpoints;
 
 /* WAL levels */
@@ -287,6 +290,7 @@ extern bool HotStandbyActiveInReplay(void);
 extern bool XLogInsertAllowed(void);
 extern void GetXLogReceiptTime(TimestampTz *rtime, bool *fromStream);
 extern XLogRecPtr GetXLogReplayRecPtr(TimeLineID *replayTLI);
+extern void XLogAdvanceReplayedUpTo(XLogRecPtr recptr, TimeLineID tli);
 extern XLogRecPtr GetXLogInsertRecPtr(void);
 extern XLogRecPtr GetXLogWriteRecPtr(void);
 extern bool RecoveryIsPaused(void);
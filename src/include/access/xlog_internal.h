@@ -34,8 +34,10 @@
  * PG data pages usually contain an unused "hole" in the middle, which
  * contains only zero bytes.  If hole_length > 0 then we have removed
  * such a "hole" from the stored data (and it's not counted in the
- * XLOG record's CRC, either).  Hence, the amount of block data actually
- * present following the BkpBlock struct is BLCKSZ - hole_length bytes.
+ * XLOG record's CRC, either).  If wal_compression is enabled, the remaining
+ * BLCKSZ - hole_length bytes are further compressed with pglz, and
+ * BKPBLOCK_COMPRESSED is set.  Either way, the amount of block data actually
+ * present following the BkpBlock struct is given by length.
  *
  * Note that we don't attempt to align either the BkpBlock struct or the
  * block's data.  So, the struct must be copied to aligned local storage
@@ -48,14 +50,19 @@ typedef struct BkpBlock
 	BlockNumber block;			/* block number */
 	uint16		hole_offset;	/* number of bytes before "hole" */
 	uint16		hole_length;	/* number of bytes in "hole" */
+	uint16		length;			/* number of bytes of block data stored */
+	uint16		bkp_info;		/* flag bits, see below */
 
 	/* ACTUAL BLOCK DATA FOLLOWS AT END OF STRUCT */
 } BkpBlock;
 
+/* Block data is compressed with pglz; it starts with a PGLZ_Header */
+#define BKPBLOCK_COMPRESSED		0x0001
+
 /*
  * Each page of XLOG file has a header like this:
  */
-#define XLOG_PAGE_MAGIC 0xD075	/* can be used as WAL version indicator */
+#define XLOG_PAGE_MAGIC 0xD07A	/* can be used as WAL version indicator */
 
 typedef struct XLogPageHeaderData
 {
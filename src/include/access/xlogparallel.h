@@ -0,0 +1,31 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogparallel.h
+ *		Declarations for parallel WAL redo.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *		src/include/access/xlogparallel.h
+ *-------------------------------------------------------------------------
+ */
+#ifndef XLOGPARALLEL_H
+#define XLOGPARALLEL_H
+
+#include "access/xlog.h"
+
+/* GUC variable */
+extern int	parallel_redo_workers;
+
+extern Size ParallelRedoShmemSize(void);
+extern void ParallelRedoShmemInit(void);
+
+extern bool ParallelRedoDispatch(XLogRecPtr EndRecPtr, TimeLineID tli,
+					 XLogRecord *record);
+extern XLogRecPtr ParallelRedoReplayedUpTo(XLogRecPtr EndRecPtr);
+extern void ParallelRedoFinish(void);
+
+extern void ParallelRedoWorkerMain(Datum main_arg);
+
+#endif   /* XLOGPARALLEL_H */
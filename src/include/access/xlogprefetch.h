@@ -0,0 +1,50 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogprefetch.h
+ *		Declarations for the recovery prefetching module.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *		src/include/access/xlogprefetch.h
+ *-------------------------------------------------------------------------
+ */
+#ifndef XLOGPREFETCH_H
+#define XLOGPREFETCH_H
+
+#include "access/xlogdefs.h"
+#include "datatype/timestamp.h"
+
+/* GUC variable */
+extern int	recovery_prefetch_distance;
+
+typedef struct XLogPrefetcher XLogPrefetcher;
+
+/*
+ * Snapshot of the recovery prefetching counters, as shown in the
+ * pg_stat_recovery_prefetch view.
+ */
+typedef struct XLogPrefetchStats
+{
+	TimestampTz stat_reset_timestamp;
+	int64		prefetch;		/* reads initiated */
+	int64		hit;			/* blocks found in shared buffers already */
+	int64		skip_init;		/* pages that replay will initialize */
+	int64		skip_fpw;		/* blocks restored from full page images */
+	int64		skip_rep;		/* blocks prefetched recently */
+	int			wal_distance;	/* bytes of WAL decoded ahead of replay */
+} XLogPrefetchStats;
+
+extern Size XLogPrefetchShmemSize(void);
+extern void XLogPrefetchShmemInit(void);
+
+extern XLogPrefetcher *XLogPrefetcherAllocate(void);
+extern void XLogPrefetcherFree(XLogPrefetcher *prefetcher);
+extern void XLogPrefetch(XLogPrefetcher *prefetcher, XLogRecPtr replayRecPtr,
+			 XLogRecPtr replayEndRecPtr, TimeLineID replayTLI);
+
+extern void XLogPrefetchGetStats(XLogPrefetchStats *stats);
+extern void XLogPrefetchResetStats(void);
+
+#endif   /* XLOGPREFETCH_H */
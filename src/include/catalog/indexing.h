@@ -311,6 +311,14 @@ DECLARE_UNIQUE_INDEX(pg_extension_name_index, 3081, on pg_extension using btree(
 DECLARE_UNIQUE_INDEX(pg_range_rngtypid_index, 3542, on pg_range using btree(rngtypid oid_ops));
 #define RangeTypidIndexId					3542
 
+DECLARE_UNIQUE_INDEX(pg_partitioned_table_partrelid_index, 3351, on pg_partitioned_table using btree(partrelid oid_ops));
+#define PartitionedRelidIndexId				3351
+
+DECLARE_UNIQUE_INDEX(pg_partition_partrelid_index, 3353, on pg_partition using btree(partrelid oid_ops));
+#define PartitionRelidIndexId				3353
+DECLARE_INDEX(pg_partition_partparent_index, 3354, on pg_partition using btree(partparent oid_ops));
+#define PartitionParentIndexId				3354
+
 /* last step of initialization script: build the indexes declared above */
 BUILD_INDICES
 
@@ -0,0 +1,112 @@
+/*-------------------------------------------------------------------------
+ *
+ * partition.h
+ *	  Header file for structures and utility functions related to
+ *	  declarative partitioning
+ *
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/catalog/partition.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include "access/skey.h"
+#include "access/tupdesc.h"
+#include "executor/tuptable.h"
+#include "fmgr.h"
+#include "nodes/bitmapset.h"
+#include "nodes/parsenodes.h"
+#include "utils/relcache.h"
+
+/* Maximum number of columns in a partition key */
+#define PARTITION_MAX_KEYS	32
+
+/*
+ * Information about the partition key of a partitioned table, built from
+ * its pg_partitioned_table row.
+ */
+typedef struct PartitionKeyData
+{
+	char		strategy;		/* PARTITION_STRATEGY_LIST or _RANGE */
+	int16		partnatts;		/* number of key columns */
+	AttrNumber *partattrs;		/* attribute numbers of key columns */
+
+	Oid		   *partopfamily;	/* btree opfamily of each column's opclass */
+	Oid		   *partopcintype;	/* opclass's declared input type */
+	FmgrInfo   *partsupfunc;	/* btree comparison function for the type */
+	Oid		   *partcollation;	/* collation to compare with */
+
+	/* Type information of the key columns */
+	Oid		   *parttypid;
+	int32	   *parttypmod;
+	int16	   *parttyplen;
+	bool	   *parttypbyval;
+} PartitionKeyData;
+
+typedef struct PartitionKeyData *PartitionKey;
+
+/*
+ * In-memory representation of the bounds of all partitions of a table; the
+ * contents are private to partition.c.
+ */
+typedef struct PartitionBoundInfoData *PartitionBoundInfo;
+
+/*
+ * The partitions of a partitioned table.  For a range partitioned table the
+ * partitions are listed in order of their bounds; for a list partitioned
+ * table, in OID order.  Partitions are identified by their index in oids[]
+ * throughout the partition.c API.
+ */
+typedef struct PartitionDescData
+{
+	int			nparts;			/* number of partitions */
+	Oid		   *oids;			/* OIDs of the partitions */
+	PartitionBoundInfo boundinfo;
+} PartitionDescData;
+
+typedef struct PartitionDescData *PartitionDesc;
+
+/* State for checking that a tuple belongs in a partition; opaque */
+typedef struct PartitionCheckData *PartitionCheck;
+
+/* relcache support */
+extern void RelationBuildPartitionInfo(Relation rel);
+extern bool equalPartitionInfo(Relation rel1, Relation rel2);
+extern PartitionKey RelationGetPartitionKey(Relation rel);
+extern bool RelationIsPartition(Relation rel);
+extern PartitionDesc RelationGetPartitionDesc(Relation rel);
+
+/* catalog manipulation */
+extern void StorePartitionKey(Relation rel, char strategy, int16 partnatts,
+				  AttrNumber *partattrs, Oid *partopclass,
+				  Oid *partcollation);
+extern void RemovePartitionKeyByRelId(Oid relid);
+extern void StorePartitionBound(Oid relid, Oid parentId,
+					PartitionBoundSpec *bound);
+extern void RemovePartitionBoundByRelId(Oid relid);
+extern Oid	get_partition_parent(Oid relid);
+extern bool is_partition_key_column(Relation rel, AttrNumber attnum);
+extern AttrNumber *map_partition_key_attnos(Relation keyrel, Relation rel);
+extern void check_new_partition_bound(char *relname, Relation parent,
+						  PartitionBoundSpec *bound);
+
+/* tuple routing and constraint checking */
+extern int get_partition_for_tuple(PartitionKey key, PartitionDesc pdesc,
+						Datum *values, bool *isnull);
+extern PartitionCheck get_partition_check(Relation rel);
+extern bool partition_check_tuple(PartitionCheck check, TupleTableSlot *slot);
+
+/* partition pruning */
+extern Bitmapset *get_partitions_for_strategy(PartitionKey key,
+							PartitionDesc pdesc, int keycol,
+							StrategyNumber strategy, Oid cmpproc,
+							Datum value);
+extern Bitmapset *get_partitions_for_null(PartitionKey key,
+						PartitionDesc pdesc, int keycol);
+
+#endif   /* PARTITION_H */
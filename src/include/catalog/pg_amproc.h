@@ -118,11 +118,13 @@ DATA(insert (	1984   829 829 1 836 ));
 DATA(insert (	1986   19 19 1 359 ));
 DATA(insert (	1986   19 19 2 3135 ));
 DATA(insert (	1988   1700 1700 1 1769 ));
+DATA(insert (	1988   1700 1700 2 3283 ));
 DATA(insert (	1989   26 26 1 356 ));
 DATA(insert (	1989   26 26 2 3134 ));
 DATA(insert (	1991   30 30 1 404 ));
 DATA(insert (	2994   2249 2249 1 2987 ));
 DATA(insert (	1994   25 25 1 360 ));
+DATA(insert (	1994   25 25 2 3255 ));
 DATA(insert (	1996   1083 1083 1 1107 ));
 DATA(insert (	2000   1266 1266 1 1358 ));
 DATA(insert (	2002   1562 1562 1 1672 ));
@@ -133,6 +135,7 @@ DATA(insert (	2233   703 703 1  380 ));
 DATA(insert (	2234   704 704 1  381 ));
 DATA(insert (	2789   27 27 1 2794 ));
 DATA(insert (	2968   2950 2950 1 2960 ));
+DATA(insert (	2968   2950 2950 2 3300 ));
 DATA(insert (	3522   3500 3500 1 3514 ));
 
 
@@ -379,4 +382,78 @@ DATA(insert (	3474   3831 3831 3 3471 ));
 DATA(insert (	3474   3831 3831 4 3472 ));
 DATA(insert (	3474   3831 3831 5 3473 ));
 
+/* BRIN integer_minmax_ops */
+DATA(insert (	4054   20 20 1 3793 ));
+DATA(insert (	4054   20 20 2 3794 ));
+DATA(insert (	4054   20 20 3 3795 ));
+DATA(insert (	4054   20 20 4 3796 ));
+DATA(insert (	4054   21 21 1 3793 ));
+DATA(insert (	4054   21 21 2 3794 ));
+DATA(insert (	4054   21 21 3 3795 ));
+DATA(insert (	4054   21 21 4 3796 ));
+DATA(insert (	4054   23 23 1 3793 ));
+DATA(insert (	4054   23 23 2 3794 ));
+DATA(insert (	4054   23 23 3 3795 ));
+DATA(insert (	4054   23 23 4 3796 ));
+
+/* BRIN numeric_minmax_ops */
+DATA(insert (	4055   1700 1700 1 3793 ));
+DATA(insert (	4055   1700 1700 2 3794 ));
+DATA(insert (	4055   1700 1700 3 3795 ));
+DATA(insert (	4055   1700 1700 4 3796 ));
+
+/* BRIN text_minmax_ops */
+DATA(insert (	4056   25 25 1 3793 ));
+DATA(insert (	4056   25 25 2 3794 ));
+DATA(insert (	4056   25 25 3 3795 ));
+DATA(insert (	4056   25 25 4 3796 ));
+
+/* BRIN time_minmax_ops */
+DATA(insert (	4058   1083 1083 1 3793 ));
+DATA(insert (	4058   1083 1083 2 3794 ));
+DATA(insert (	4058   1083 1083 3 3795 ));
+DATA(insert (	4058   1083 1083 4 3796 ));
+
+/* BRIN datetime_minmax_ops */
+DATA(insert (	4059   1082 1082 1 3793 ));
+DATA(insert (	4059   1082 1082 2 3794 ));
+DATA(insert (	4059   1082 1082 3 3795 ));
+DATA(insert (	4059   1082 1082 4 3796 ));
+DATA(insert (	4059   1114 1114 1 3793 ));
+DATA(insert (	4059   1114 1114 2 3794 ));
+DATA(insert (	4059   1114 1114 3 3795 ));
+DATA(insert (	4059   1114 1114 4 3796 ));
+DATA(insert (	4059   1184 1184 1 3793 ));
+DATA(insert (	4059   1184 1184 2 3794 ));
+DATA(insert (	4059   1184 1184 3 3795 ));
+DATA(insert (	4059   1184 1184 4 3796 ));
+
+/* BRIN oid_minmax_ops */
+DATA(insert (	4068   26 26 1 3793 ));
+DATA(insert (	4068   26 26 2 3794 ));
+DATA(insert (	4068   26 26 3 3795 ));
+DATA(insert (	4068   26 26 4 3796 ));
+
+/* BRIN float_minmax_ops */
+DATA(insert (	4070   700 700 1 3793 ));
+DATA(insert (	4070   700 700 2 3794 ));
+DATA(insert (	4070   700 700 3 3795 ));
+DATA(insert (	4070   700 700 4 3796 ));
+DATA(insert (	4070   701 701 1 3793 ));
+DATA(insert (	4070   701 701 2 3794 ));
+DATA(insert (	4070   701 701 3 3795 ));
+DATA(insert (	4070   701 701 4 3796 ));
+
+/* BRIN interval_minmax_ops */
+DATA(insert (	4078   1186 1186 1 3793 ));
+DATA(insert (	4078   1186 1186 2 3794 ));
+DATA(insert (	4078   1186 1186 3 3795 ));
+DATA(insert (	4078   1186 1186 4 3796 ));
+
+/* BRIN uuid_minmax_ops */
+DATA(insert (	4081   2950 2950 1 3793 ));
+DATA(insert (	4081   2950 2950 2 3794 ));
+DATA(insert (	4081   2950 2950 3 3795 ));
+DATA(insert (	4081   2950 2950 4 3796 ));
+
 #endif   /* PG_AMPROC_H */
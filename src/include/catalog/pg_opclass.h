@@ -228,4 +228,20 @@ DATA(insert (	4000	quad_point_ops		PGNSP PGUID 4015  600 t 0 ));
 DATA(insert (	4000	kd_point_ops		PGNSP PGUID 4016  600 f 0 ));
 DATA(insert (	4000	text_ops			PGNSP PGUID 4017  25 t 0 ));
 
+/* BRIN opclasses */
+DATA(insert (	3580	int8_minmax_ops		PGNSP PGUID 4054  20 t 0 ));
+DATA(insert (	3580	int2_minmax_ops		PGNSP PGUID 4054  21 t 0 ));
+DATA(insert (	3580	int4_minmax_ops		PGNSP PGUID 4054  23 t 0 ));
+DATA(insert (	3580	numeric_minmax_ops	PGNSP PGUID 4055  1700 t 0 ));
+DATA(insert (	3580	text_minmax_ops		PGNSP PGUID 4056  25 t 0 ));
+DATA(insert (	3580	time_minmax_ops		PGNSP PGUID 4058  1083 t 0 ));
+DATA(insert (	3580	date_minmax_ops		PGNSP PGUID 4059  1082 t 0 ));
+DATA(insert (	3580	timestamp_minmax_ops	PGNSP PGUID 4059  1114 t 0 ));
+DATA(insert (	3580	timestamptz_minmax_ops	PGNSP PGUID 4059  1184 t 0 ));
+DATA(insert (	3580	oid_minmax_ops		PGNSP PGUID 4068  26 t 0 ));
+DATA(insert (	3580	float4_minmax_ops	PGNSP PGUID 4070  700 t 0 ));
+DATA(insert (	3580	float8_minmax_ops	PGNSP PGUID 4070  701 t 0 ));
+DATA(insert (	3580	interval_minmax_ops	PGNSP PGUID 4078  1186 t 0 ));
+DATA(insert (	3580	uuid_minmax_ops		PGNSP PGUID 4081  2950 t 0 ));
+
 #endif   /* PG_OPCLASS_H */
@@ -148,4 +148,14 @@ DATA(insert OID = 4016 (	4000	kd_point_ops	PGNSP PGUID ));
 DATA(insert OID = 4017 (	4000	text_ops		PGNSP PGUID ));
 #define TEXT_SPGIST_FAM_OID 4017
 
+DATA(insert OID = 4054 (	3580	integer_minmax_ops	PGNSP PGUID ));
+DATA(insert OID = 4055 (	3580	numeric_minmax_ops	PGNSP PGUID ));
+DATA(insert OID = 4056 (	3580	text_minmax_ops	PGNSP PGUID ));
+DATA(insert OID = 4058 (	3580	time_minmax_ops	PGNSP PGUID ));
+DATA(insert OID = 4059 (	3580	datetime_minmax_ops	PGNSP PGUID ));
+DATA(insert OID = 4068 (	3580	oid_minmax_ops	PGNSP PGUID ));
+DATA(insert OID = 4070 (	3580	float_minmax_ops	PGNSP PGUID ));
+DATA(insert OID = 4078 (	3580	interval_minmax_ops	PGNSP PGUID ));
+DATA(insert OID = 4081 (	3580	uuid_minmax_ops	PGNSP PGUID ));
+
 #endif   /* PG_OPFAMILY_H */
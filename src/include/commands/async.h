@@ -15,12 +15,8 @@
 
 #include "fmgr.h"
 
-/*
- * The number of SLRU page buffers we use for the notification queue.
- */
-#define NUM_ASYNC_BUFFERS	8
-
 extern bool Trace_notify;
+extern int	notify_buffers;
 
 extern Size AsyncShmemSize(void);
 extern void AsyncShmemInit(void);
@@ -0,0 +1,152 @@
+/*-------------------------------------------------------------------------
+ *
+ * execExpr.h
+ *	  Flattened expression programs, as run by ExecEvalProgram
+ *
+ * These are private to execQual.c, except that a JIT provider needs to
+ * know the step representation in order to translate programs.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/executor/execExpr.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef EXEC_EXPR_H
+#define EXEC_EXPR_H
+
+#include "nodes/execnodes.h"
+
+
+typedef enum ExprEvalOp
+{
+	EEOP_DONE,					/* end of program */
+	EEOP_INNER_VAR_FIRST,		/* Var of the inner tuple, first time */
+	EEOP_INNER_VAR,				/* Var of the inner tuple */
+	EEOP_OUTER_VAR_FIRST,		/* same for outer tuple */
+	EEOP_OUTER_VAR,
+	EEOP_SCAN_VAR_FIRST,		/* same for scan tuple */
+	EEOP_SCAN_VAR,
+	EEOP_CONST,					/* Const */
+	EEOP_CASE_TESTVAL,			/* CaseTestExpr */
+	EEOP_FUNCEXPR_INIT,			/* FuncExpr or OpExpr, first time */
+	EEOP_FUNCEXPR,				/* call non-strict function */
+	EEOP_FUNCEXPR_STRICT,		/* call strict function */
+	EEOP_BOOL_AND_STEP_FIRST,	/* check first argument of AND */
+	EEOP_BOOL_AND_STEP,			/* check a middle argument of AND */
+	EEOP_BOOL_AND_STEP_LAST,	/* check last argument of AND */
+	EEOP_BOOL_OR_STEP_FIRST,	/* same for OR */
+	EEOP_BOOL_OR_STEP,
+	EEOP_BOOL_OR_STEP_LAST,
+	EEOP_BOOL_NOT,				/* NOT of the result of the previous step */
+	EEOP_NULLTEST_ISNULL,		/* IS NULL test of a scalar */
+	EEOP_NULLTEST_ISNOTNULL,	/* IS NOT NULL test of a scalar */
+	EEOP_JUMP,					/* unconditional jump */
+	EEOP_JUMP_IF_NOT_TRUE,		/* jump unless result is non-null true */
+	EEOP_JUMP_IF_NOT_NULL,		/* jump if result is not null */
+	EEOP_CASE_SETVAL,			/* set CASE test value, saving old one */
+	EEOP_CASE_RESTORE,			/* restore saved CASE test value */
+	EEOP_AGG_STRICT_TRANS,		/* advance aggregate, strict transfn */
+	EEOP_AGG_TRANS,				/* advance aggregate, non-strict transfn */
+	EEOP_GENERIC,				/* evaluate subexpression with ExecEvalExpr */
+	EEOP_LAST					/* must be last */
+} ExprEvalOp;
+
+typedef struct ExprEvalStep
+{
+	ExprEvalOp	opcode;
+
+	/* where to store the result of this step */
+	Datum	   *resvalue;
+	bool	   *resnull;
+
+	union
+	{
+		/* for EEOP_*_VAR* */
+		struct
+		{
+			int			attnum;		/* zero-based attribute number */
+			Oid			vartype;	/* for the first-time check */
+		}			var;
+
+		/* for EEOP_CONST */
+		struct
+		{
+			Datum		value;
+			bool		isnull;
+		}			constval;
+
+		/* for EEOP_FUNCEXPR* */
+		struct
+		{
+			FuncExprState *fcache;
+			int			nargs;
+		}			func;
+
+		/* for EEOP_BOOL_*_STEP* */
+		struct
+		{
+			bool	   *anynull;	/* shared by all steps of one AND/OR */
+			int			jumpdone;	/* step to jump to on short-circuit */
+		}			boolexpr;
+
+		/* for EEOP_JUMP* */
+		struct
+		{
+			int			jumpdone;
+		}			jump;
+
+		/* for EEOP_CASE_SETVAL and EEOP_CASE_RESTORE */
+		struct
+		{
+			Datum	   *save_value;
+			bool	   *save_isnull;
+		}			casesave;
+
+		/* for EEOP_AGG_*TRANS */
+		struct
+		{
+			AggState   *aggstate;
+			int			aggno;		/* index into aggstate->curpergroup */
+			FunctionCallInfo fcinfo;	/* arguments 1..nargs are set */
+			int			nargs;
+			int16		transtypeLen;
+			bool		transtypeByVal;
+		}			aggtrans;
+
+		/* for EEOP_GENERIC */
+		struct
+		{
+			ExprState  *state;
+		}			generic;
+	}			d;
+} ExprEvalStep;
+
+typedef struct ExprEvalProgram
+{
+	ExprEvalStep *steps;
+	int			nsteps;
+	int			maxsteps;		/* allocated length of steps array */
+
+	/* highest attribute numbers referenced by the Var steps */
+	AttrNumber	last_inner;
+	AttrNumber	last_outer;
+	AttrNumber	last_scan;
+
+	/* result of the whole expression */
+	Datum		resvalue;
+	bool		resnull;
+
+	/* private state of the JIT provider, if it took over the program */
+	void	   *jit_private;
+} ExprEvalProgram;
+
+extern void CheckVarSlotCompatibility(TupleTableSlot *slot, AttrNumber attnum,
+						  Oid vartype);
+extern void ExecEvalFuncExprInit(ExprEvalStep *op, ExprContext *econtext);
+extern void ExecAggInitGroup(ExprEvalStep *op, AggStatePerGroup pergroup);
+extern Datum ExecAggTransReparent(ExprEvalStep *op, AggStatePerGroup pergroup,
+					 Datum newValue);
+
+#endif   /* EXEC_EXPR_H */
@@ -0,0 +1,26 @@
+/*--------------------------------------------------------------------
+ * execParallel.h
+ *		POSTGRES parallel execution interface
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *		src/include/executor/execParallel.h
+ *--------------------------------------------------------------------
+ */
+
+#ifndef EXECPARALLEL_H
+#define EXECPARALLEL_H
+
+#include "access/relscan.h"
+#include "nodes/pg_list.h"
+#include "storage/shm_mq.h"
+#include "utils/relcache.h"
+#include "utils/snapshot.h"
+
+extern void ExecParallelScan(Relation rel, Snapshot snapshot,
+				 ParallelHeapScanDesc pscan, List *qual,
+				 shm_mq_handle *mqh);
+
+#endif   /* EXECPARALLEL_H */
@@ -0,0 +1,67 @@
+/*--------------------------------------------------------------------
+ * execPartition.h
+ *		POSTGRES tuple routing for partitioned tables
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *		src/include/executor/execPartition.h
+ *--------------------------------------------------------------------
+ */
+
+#ifndef EXECPARTITION_H
+#define EXECPARTITION_H
+
+#include "access/tupconvert.h"
+#include "catalog/partition.h"
+#include "nodes/execnodes.h"
+
+/*
+ * Routing information for one partitioned table in a partition tree.
+ *
+ * keyattnos[] are the attribute numbers of the partition key columns in the
+ * root table, so that the key can be extracted from a tuple in the root's
+ * format at every level.  indexes[] has an entry for each partition: a leaf
+ * partition's index in PartitionTupleRouting.partitions, or, for a partition
+ * that is itself partitioned, -1 minus its index in the dispatch array.
+ */
+typedef struct PartitionDispatchData
+{
+	Relation	reldesc;
+	PartitionKey key;
+	PartitionDesc partdesc;
+	AttrNumber *keyattnos;
+	int		   *indexes;
+} PartitionDispatchData;
+
+typedef struct PartitionDispatchData *PartitionDispatch;
+
+/*
+ * State for routing tuples inserted into a partitioned table to its leaf
+ * partitions.  dispatch[0] is the table the tuples are inserted into.
+ */
+typedef struct PartitionTupleRouting
+{
+	PartitionDispatch *dispatch;	/* partitioned tables in the tree */
+	int			num_dispatch;
+	ResultRelInfo *partitions;	/* one per leaf partition */
+	int			num_partitions;
+	TupleConversionMap **maps;	/* root to leaf format; NULL if same */
+	TupleConversionMap **rootmaps;		/* leaf to root format; NULL if same */
+	TupleTableSlot *partition_slot;		/* holds tuples in leaf format */
+	TupleTableSlot *root_slot;	/* holds tuples converted back to root format */
+} PartitionTupleRouting;
+
+extern PartitionTupleRouting *ExecSetupPartitionTupleRouting(ResultRelInfo *rootRelInfo,
+							   EState *estate);
+extern int ExecFindPartition(ResultRelInfo *rootRelInfo,
+				  PartitionTupleRouting *proute,
+				  TupleTableSlot *slot, EState *estate);
+extern TupleTableSlot *ExecConvertToPartition(PartitionTupleRouting *proute,
+					   int leaf, TupleTableSlot *slot);
+extern TupleTableSlot *ExecConvertFromPartition(PartitionTupleRouting *proute,
+						 int leaf, TupleTableSlot *slot);
+extern void ExecCleanupTupleRouting(PartitionTupleRouting *proute);
+
+#endif   /* EXECPARTITION_H */
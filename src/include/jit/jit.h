@@ -0,0 +1,87 @@
+/*-------------------------------------------------------------------------
+ *
+ * jit.h
+ *	  Provider independent JIT infrastructure.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/jit/jit.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef JIT_H
+#define JIT_H
+
+#include "nodes/execnodes.h"
+
+
+/* Flags determining what kind of JIT operations to perform */
+#define PGJIT_NONE		0
+#define PGJIT_PERFORM	(1 << 0)
+#define PGJIT_OPT3		(1 << 1)
+#define PGJIT_INLINE	(1 << 2)
+#define PGJIT_EXPR		(1 << 3)
+#define PGJIT_DEFORM	(1 << 4)
+
+
+/*
+ * State of JIT compilation for one query.  A provider embeds this at the
+ * start of its own struct, and keeps whatever it needs to release the
+ * generated code there.
+ */
+typedef struct JitContext
+{
+	int			flags;			/* PGJIT_* flags in effect */
+} JitContext;
+
+/*
+ * Entry points of a JIT provider.
+ *
+ * compile_expr is called for each expression that ExecInitExpr has
+ * flattened into a program (see executor/execExpr.h), if the plan's
+ * es_jit_flags ask for expressions to be compiled.  It may replace
+ * state->evalfunc with generated code and return true, or leave the state
+ * alone and return false, in which case the interpreter runs the program.
+ * The provider creates parent->state->es_jit on first use.  If PGJIT_DEFORM
+ * is set, the generated code may also replace the slot_getsomeattrs calls
+ * of the program prologue with tuple deforming specialized for the slot's
+ * descriptor; if PGJIT_INLINE is set, it may inline the bodies of built-in
+ * functions, which are listed in utils/fmgrtab.h.
+ *
+ * release_context is called by FreeExecutorState.  Contexts of queries that
+ * fail never get there; a provider that needs to release resources other
+ * than memory must take care of those itself, for example with a resource
+ * release callback.
+ */
+typedef bool (*JitProviderCompileExprCB) (ExprState *state,
+													  PlanState *parent);
+typedef void (*JitProviderReleaseContextCB) (JitContext *context);
+
+typedef struct JitProviderCallbacks
+{
+	JitProviderCompileExprCB compile_expr;
+	JitProviderReleaseContextCB release_context;
+} JitProviderCallbacks;
+
+/* the provider library must export a function of this type */
+typedef void (*JitProviderInit) (JitProviderCallbacks *cb);
+
+#define JIT_PROVIDER_INIT_FUNCTION "_PG_jit_provider_init"
+
+
+/* GUCs */
+extern bool jit_enabled;
+extern char *jit_provider;
+extern bool jit_expressions;
+extern bool jit_tuple_deforming;
+extern double jit_above_cost;
+extern double jit_inline_above_cost;
+extern double jit_optimize_above_cost;
+
+
+extern int	jit_plan_flags(double total_cost);
+extern bool jit_compile_expr(ExprState *state, PlanState *parent);
+extern void jit_release_context(JitContext *context);
+
+#endif   /* JIT_H */
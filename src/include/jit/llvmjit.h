@@ -0,0 +1,90 @@
+/*-------------------------------------------------------------------------
+ *
+ * llvmjit.h
+ *	  LLVM JIT provider.
+ *
+ * Declarations shared by the files of the provider in src/backend/jit/llvm.
+ * Only those files may include this, since it pulls in the LLVM headers.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/jit/llvmjit.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef LLVMJIT_H
+#define LLVMJIT_H
+
+#include <llvm-c/Core.h>
+#include <llvm-c/Orc.h>
+
+#include "jit/jit.h"
+#include "lib/ilist.h"
+#include "utils/resowner.h"
+
+
+/*
+ * A provider's JitContext: the code generated for one query.
+ */
+typedef struct LLVMJitContext
+{
+	JitContext	base;
+
+	/* resource owner that was current when the context was created */
+	ResourceOwner resowner;
+
+	/* link in list of all live contexts, for cleanup after errors */
+	dlist_node	node;
+
+	/* tracks the code emitted for this context, or NULL if none yet */
+	LLVMOrcResourceTrackerRef tracker;
+} LLVMJitContext;
+
+
+/* types used by generated code, set up by llvm_session_initialize */
+extern LLVMTypeRef TypeSizeT;
+extern LLVMTypeRef TypeDatum;
+extern LLVMTypeRef TypeStorageBool;
+extern LLVMTypeRef TypeInt8;
+extern LLVMTypeRef TypeInt16;
+extern LLVMTypeRef TypeInt32;
+extern LLVMTypeRef TypeInt64;
+extern LLVMTypeRef TypeVoid;
+extern LLVMTypeRef TypePtr;
+
+/* llvmjit.c */
+extern LLVMJitContext *llvm_get_context(EState *estate);
+extern LLVMModuleRef llvm_create_module(LLVMJitContext *context);
+extern void *llvm_emit_module(LLVMJitContext *context, LLVMModuleRef module,
+				 const char *funcname);
+extern char *llvm_unique_name(const char *prefix);
+
+extern LLVMValueRef l_ptr_const(void *ptr, LLVMTypeRef type);
+extern LLVMValueRef l_int8_const(int8 i);
+extern LLVMValueRef l_int16_const(int16 i);
+extern LLVMValueRef l_int32_const(int32 i);
+extern LLVMValueRef l_int64_const(int64 i);
+extern LLVMValueRef l_sizet_const(size_t i);
+extern LLVMValueRef l_field_ptr(LLVMBuilderRef b, LLVMValueRef base,
+			size_t offset, LLVMTypeRef type);
+extern LLVMValueRef l_load_field(LLVMBuilderRef b, LLVMValueRef base,
+			 size_t offset, LLVMTypeRef type, const char *name);
+extern void l_store_field(LLVMBuilderRef b, LLVMValueRef value,
+			  LLVMValueRef base, size_t offset);
+extern LLVMValueRef l_call(LLVMBuilderRef b, void *fn, LLVMTypeRef rettype,
+	   LLVMTypeRef *paramtypes, LLVMValueRef *args, int nargs);
+
+/* llvmjit_deform.c */
+extern LLVMValueRef slot_compile_deform(LLVMModuleRef module, TupleDesc desc,
+					int natts);
+
+/* llvmjit_inline.c */
+extern bool llvm_can_inline(Oid funcid);
+extern LLVMValueRef llvm_inline_builtin(LLVMBuilderRef b, Oid funcid,
+					LLVMValueRef *v_args);
+
+/* llvmjit_expr.c */
+extern bool llvm_compile_expr(ExprState *state, PlanState *parent);
+
+#endif   /* LLVMJIT_H */
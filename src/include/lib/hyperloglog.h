@@ -0,0 +1,44 @@
+/*
+ * hyperloglog.h
+ *
+ * A simple HyperLogLog cardinality estimator implementation
+ *
+ * Portions Copyright (c) 2013, PostgreSQL Global Development Group
+ *
+ * src/include/lib/hyperloglog.h
+ */
+
+#ifndef HYPERLOGLOG_H
+#define HYPERLOGLOG_H
+
+/*
+ * HyperLogLog is an approximate technique for computing the number of
+ * distinct entries in a set.  Importantly, it does this by using a fixed
+ * amount of memory, regardless of the number of values added.
+ *
+ * The state consists of 2^registerWidth one-byte registers.  Each hashed
+ * value selects a register with its leading registerWidth bits, and the
+ * register remembers the longest run of leading zero bits (plus one) seen
+ * among the remaining bits of any hash routed to it.  The estimate is a
+ * bias-corrected harmonic mean over all registers.  The relative error is
+ * about 1.04 / sqrt(2^registerWidth).
+ *
+ * The caller is responsible for hashing; values must be well-distributed
+ * 32-bit hashes, such as those produced by hash_any() or hash_uint32().
+ */
+typedef struct hyperLogLogState
+{
+	uint8		registerWidth;	/* log2 of the number of registers */
+	Size		nRegisters;		/* number of registers */
+	double		alphaMM;		/* bias correction constant times m^2 */
+	uint8	   *hashesArr;		/* the registers */
+	Size		arrSize;		/* allocated size of hashesArr */
+} hyperLogLogState;
+
+extern void initHyperLogLog(hyperLogLogState *cState, uint8 bwidth);
+extern void addHyperLogLog(hyperLogLogState *cState, uint32 hash);
+extern double estimateHyperLogLog(hyperLogLogState *cState);
+extern void mergeHyperLogLog(hyperLogLogState *cState,
+				 const hyperLogLogState *oState);
+
+#endif   /* HYPERLOGLOG_H */
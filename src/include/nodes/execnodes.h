@@ -306,6 +306,11 @@ typedef struct JunkFilter
  *		ConstraintExprs			array of constraint-checking expr states
  *		junkFilter				for removing junk attributes from tuples
  *		projectReturning		for computing a RETURNING list
+ *		CheckPartition			must new tuples be checked against the
+ *								relation's partition bound?
+ *		PartitionCheck			state for that check, built when first needed
+ *		PartitionRoot			partitioned table the tuples were routed
+ *								from, or NULL
  * ----------------
  */
 typedef struct ResultRelInfo
@@ -325,6 +330,9 @@ typedef struct ResultRelInfo
 	List	  **ri_ConstraintExprs;
 	JunkFilter *ri_junkFilter;
 	ProjectionInfo *ri_projectReturning;
+	bool		ri_CheckPartition;
+	struct PartitionCheckData *ri_PartitionCheck;
+	Relation	ri_PartitionRoot;
 } ResultRelInfo;
 
 /* ----------------
@@ -378,6 +386,9 @@ typedef struct EState
 	int			es_instrument;	/* OR of InstrumentOption flags */
 	bool		es_finished;	/* true when ExecutorFinish is done */
 
+	int			es_jit_flags;	/* PGJIT_* flags from the PlannedStmt */
+	struct JitContext *es_jit;	/* JIT provider's state, or NULL */
+
 	List	   *es_exprcontexts;	/* List of ExprContexts within EState */
 
 	List	   *es_subplanstates;		/* List of PlanState for SubPlans */
@@ -550,6 +561,8 @@ struct ExprState
 	NodeTag		type;
 	Expr	   *expr;			/* associated Expr node */
 	ExprStateEvalFunc evalfunc; /* routine to run to execute node */
+	struct ExprEvalProgram *program;	/* flattened form of the expression,
+										 * or NULL; see execQual.c */
 };
 
 /* ----------------
@@ -1081,6 +1094,8 @@ typedef struct ModifyTableState
 	List	  **mt_arowmarks;	/* per-subplan ExecAuxRowMark lists */
 	EPQState	mt_epqstate;	/* for evaluating EvalPlanQual rechecks */
 	bool		fireBSTriggers; /* do we need to fire stmt triggers? */
+	struct PartitionTupleRouting *mt_partition_routing;	/* INSERT into a
+														 * partitioned table */
 } ModifyTableState;
 
 /* ----------------
@@ -1088,6 +1103,10 @@ typedef struct ModifyTableState
  *
  *		nplans			how many plans are in the array
  *		whichplan		which plan is being executed (0 .. n-1)
+ *		partrel			partitioned table, if pruning partitions at run time
+ *		prune_exprs		ExprStates for the Append's part_prune_exprs
+ *		valid			which subplans can return rows, or NULL
+ *		prune_pending	must valid be recomputed before the next tuple?
  * ----------------
  */
 typedef struct AppendState
@@ -1096,6 +1115,10 @@ typedef struct AppendState
 	PlanState **appendplans;	/* array of PlanStates for my inputs */
 	int			as_nplans;
 	int			as_whichplan;
+	Relation	as_partrel;
+	List	   *as_prune_exprs;
+	bool	   *as_valid;
+	bool		as_prune_pending;
 } AppendState;
 
 /* ----------------
@@ -1653,6 +1676,30 @@ typedef struct SortState
 	void	   *tuplesortstate; /* private state of tuplesort.c */
 } SortState;
 
+/* ----------------
+ *	 IncrementalSortState information
+ *
+ *		The input is sorted in batches, each made of whole groups of tuples
+ *		with equal presorted columns.  group_pivot holds a tuple of the last
+ *		group in the batch being collected; once the batch is complete it
+ *		holds the first tuple of the next batch, already read from the
+ *		outer plan, and pivot_pending is set.
+ * ----------------
+ */
+typedef struct IncrementalSortState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	bool		bounded;		/* is the result set bounded? */
+	int64		bound;			/* if bounded, how many tuples are needed */
+	FmgrInfo   *eqfunctions;	/* equality fns for presorted columns */
+	TupleTableSlot *group_pivot;	/* tuple of the current prefix group */
+	bool		pivot_pending;	/* group_pivot not yet added to a batch? */
+	bool		outer_done;		/* outer plan exhausted? */
+	int64		tuples_output;	/* tuples returned so far */
+	long		nbatches;		/* number of batches sorted so far */
+	void	   *tuplesortstate; /* tuplesort.c state for the current batch */
+} IncrementalSortState;
+
 /* ---------------------
  *	GroupState information
  * -------------------------
@@ -1676,7 +1723,7 @@ typedef struct GroupState
  *	expressions and run the aggregate transition functions.
  * -------------------------
  */
-/* these structs are private in nodeAgg.c: */
+/* these structs are defined in executor/nodeAgg.h: */
 typedef struct AggStatePerAggData *AggStatePerAgg;
 typedef struct AggStatePerGroupData *AggStatePerGroup;
 
@@ -1690,6 +1737,8 @@ typedef struct AggState
 	AggStatePerAgg peragg;		/* per-Aggref information */
 	MemoryContext aggcontext;	/* memory context for long-lived data */
 	ExprContext *tmpcontext;	/* econtext for input expressions */
+	ExprState  *evaltrans;		/* advances unsorted aggs, or NULL if none */
+	AggStatePerGroup curpergroup;	/* groups evaltrans is advancing */
 	bool		agg_done;		/* indicates completion of Agg scan */
 	/* these fields are used in AGG_PLAIN and AGG_SORTED modes: */
 	AggStatePerGroup pergroup;	/* per-Aggref-per-group working state */
@@ -1700,6 +1749,17 @@ typedef struct AggState
 	List	   *hash_needed;	/* list of columns needed in hash table */
 	bool		table_filled;	/* hash table filled yet? */
 	TupleHashIterator hashiter; /* for iterating through hash table */
+	/* these fields are used when AGG_HASHED mode overflows work_mem: */
+	Size		hash_mem_limit; /* memory limit for hash table, in bytes */
+	bool		hash_spill_mode;	/* adding no new groups to hash table? */
+	int			hash_partition_bits;	/* log2 of number of spill files */
+	int			hash_level;		/* recursion depth of current batch */
+	struct BufFile **hash_spill_files;	/* spill files for current pass */
+	struct BufFile *hash_batch_file;	/* batch being read, or NULL */
+	List	   *hash_batches;	/* batches still to be processed */
+	TupleTableSlot *hash_spill_slot;	/* slot for reading spilled tuples */
+	int			hash_batches_used;		/* number of passes over input */
+	Size		hash_mem_peak;	/* peak memory used by hash table */
 } AggState;
 
 /* ----------------
@@ -1875,4 +1935,25 @@ typedef struct LimitState
 	TupleTableSlot *subSlot;	/* tuple last obtained from subplan */
 } LimitState;
 
+/* ----------------
+ *	 GatherState information
+ *
+ *		Gather nodes launch background workers to run copies of their
+ *		child plan, and read the tuples they produce as well as running
+ *		the child plan in the leader.
+ *
+ *		funnel_slot holds tuples received from workers; they are projected
+ *		using the child's projection info.
+ * ----------------
+ */
+typedef struct GatherState
+{
+	PlanState	ps;				/* its first field is NodeTag */
+	bool		initialized;	/* workers launched (or not) yet? */
+	bool		need_to_scan_locally;	/* leader still has work to do? */
+	struct ParallelContext *pcxt;	/* NULL if running without workers */
+	ParallelHeapScanDesc local_pscan;	/* used if pcxt is NULL */
+	TupleTableSlot *funnel_slot;
+} GatherState;
+
 #endif   /* EXECNODES_H */
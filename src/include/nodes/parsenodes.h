@@ -1455,6 +1455,79 @@ typedef struct VariableShowStmt
 	char	   *name;
 } VariableShowStmt;
 
+/* ----------------------
+ *		Partitioning definitions
+ * ----------------------
+ */
+
+/*
+ * PartitionElem - a partition key column (used in PARTITION BY)
+ */
+typedef struct PartitionElem
+{
+	NodeTag		type;
+	char	   *name;			/* name of column to partition on */
+	List	   *collation;		/* name of collation; NIL = default */
+	List	   *opclass;		/* name of desired opclass; NIL = default */
+	int			location;		/* token location, or -1 if unknown */
+} PartitionElem;
+
+/*
+ * PartitionSpec - the PARTITION BY clause of CREATE TABLE
+ */
+#define PARTITION_STRATEGY_LIST		'l'
+#define PARTITION_STRATEGY_RANGE	'r'
+
+typedef struct PartitionSpec
+{
+	NodeTag		type;
+	char	   *strategy;		/* partitioning strategy ("list" or "range") */
+	List	   *partParams;		/* List of PartitionElems */
+	int			location;		/* token location, or -1 if unknown */
+} PartitionSpec;
+
+/*
+ * PartitionBoundSpec - the FOR VALUES clause of CREATE TABLE ... PARTITION OF
+ *
+ * In the raw grammar output, the datums are A_Const nodes (or NULL_P, for
+ * list partitions); parse analysis turns them into Consts of the types of
+ * the partition key columns.  The transformed form is what's stored in
+ * pg_partition.partbound.
+ */
+typedef struct PartitionBoundSpec
+{
+	NodeTag		type;
+	char		strategy;		/* see PARTITION_STRATEGY codes above */
+
+	/* Partitioning info for LIST strategy: */
+	List	   *listdatums;		/* List of Consts (or A_Consts in raw tree) */
+
+	/* Partitioning info for RANGE strategy: */
+	List	   *lowerdatums;	/* List of PartitionRangeDatums */
+	List	   *upperdatums;	/* List of PartitionRangeDatums */
+
+	int			location;		/* token location, or -1 if unknown */
+} PartitionBoundSpec;
+
+/*
+ * PartitionRangeDatum - one column of a range partition bound
+ */
+typedef enum PartitionRangeDatumKind
+{
+	PARTITION_RANGE_DATUM_MINVALUE = -1,	/* less than any other value */
+	PARTITION_RANGE_DATUM_VALUE = 0,	/* a specific (bounded) value */
+	PARTITION_RANGE_DATUM_MAXVALUE = 1	/* greater than any other value */
+} PartitionRangeDatumKind;
+
+typedef struct PartitionRangeDatum
+{
+	NodeTag		type;
+	PartitionRangeDatumKind kind;
+	Node	   *value;			/* Const (or A_Const in raw tree), if kind is
+								 * PARTITION_RANGE_DATUM_VALUE, else NULL */
+	int			location;		/* token location, or -1 if unknown */
+} PartitionRangeDatum;
+
 /* ----------------------
  *		Create Table Statement
  *
@@ -1479,6 +1552,9 @@ typedef struct CreateStmt
 	OnCommitAction oncommit;	/* what do we do at COMMIT? */
 	char	   *tablespacename; /* table space to use, or NULL */
 	bool		if_not_exists;	/* just do nothing if it already exists? */
+	PartitionSpec *partspec;	/* PARTITION BY clause, or NULL */
+	PartitionBoundSpec *partbound;	/* FOR VALUES clause of PARTITION OF, or
+									 * NULL */
 } CreateStmt;
 
 /* ----------
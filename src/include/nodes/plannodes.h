@@ -67,6 +67,8 @@ typedef struct PlannedStmt
 	List	   *invalItems;		/* other dependencies, as PlanInvalItems */
 
 	int			nParamExec;		/* number of PARAM_EXEC Params used */
+
+	int			jitFlags;		/* which forms of JIT should be performed */
 } PlannedStmt;
 
 /* macro for fetching the Plan associated with a SubPlan node */
@@ -102,6 +104,11 @@ typedef struct Plan
 	double		plan_rows;		/* number of rows plan is expected to emit */
 	int			plan_width;		/* average row width in bytes */
 
+	/*
+	 * information needed for parallel query
+	 */
+	bool		parallel_aware; /* engage parallel-aware logic? */
+
 	/*
 	 * Common structural data for all Plan types.
 	 */
@@ -181,12 +188,24 @@ typedef struct ModifyTable
 /* ----------------
  *	 Append node -
  *		Generate the concatenation of the results of sub-plans.
+ *
+ * When scanning a partitioned table whose first partition key column is
+ * compared with values not known until run time (Params), the Append can
+ * skip the subplans of partitions that can't hold matching rows.  The
+ * comparisons are "key <strategy> expr", for each of part_prune_exprs, and
+ * part_subplan_indexes gives the index in the table's PartitionDesc of the
+ * partition each subplan belongs to, or -1 if it can't be skipped.
  * ----------------
  */
 typedef struct Append
 {
 	Plan		plan;
 	List	   *appendplans;
+	Oid			part_relid;		/* partitioned table, or InvalidOid */
+	List	   *part_prune_exprs;		/* values compared with the key */
+	List	   *part_prune_strategies;	/* integer list of btree strategies */
+	List	   *part_prune_cmpprocs;	/* OID list of comparison functions */
+	List	   *part_subplan_indexes;	/* integer list, one per subplan */
 } Append;
 
 /* ----------------
@@ -590,6 +609,19 @@ typedef struct Sort
 	bool	   *nullsFirst;		/* NULLS FIRST/LAST directions */
 } Sort;
 
+/* ----------------
+ *		incremental sort node
+ *
+ * The input is already sorted on the first presortedCols sort columns, so
+ * it can be sorted one group of tuples sharing those columns at a time.
+ * ----------------
+ */
+typedef struct IncrementalSort
+{
+	Sort		sort;
+	int			presortedCols;	/* number of presorted leading columns */
+} IncrementalSort;
+
 /* ---------------
  *	 group node -
  *		Used for queries with GROUP BY (but no aggregates) specified.
@@ -748,6 +780,20 @@ typedef struct Limit
 	Node	   *limitCount;		/* COUNT parameter, or NULL if none */
 } Limit;
 
+/* ----------------
+ *		gather node
+ *
+ * Runs its (parallel-aware) subplan in the leader and in up to num_workers
+ * background workers, and returns the union of their output.  The subplan
+ * must currently be a SeqScan.
+ * ----------------
+ */
+typedef struct Gather
+{
+	Plan		plan;
+	int			num_workers;
+} Gather;
+
 
 /*
  * RowMarkType -
@@ -721,6 +721,8 @@ typedef struct Path
 
 	List	   *pathkeys;		/* sort ordering of path's output */
 	/* pathkeys is a List of PathKey nodes; see above */
+
+	bool		parallel_aware; /* engage parallel-aware logic? */
 } Path;
 
 /* Macro for extracting a path's parameterization relids; beware double eval */
@@ -929,6 +931,17 @@ typedef struct MaterialPath
 	Path	   *subpath;
 } MaterialPath;
 
+/*
+ * GatherPath runs its parallel-aware subpath in several processes at once,
+ * and collects the results.  The output is unordered.
+ */
+typedef struct GatherPath
+{
+	Path		path;
+	Path	   *subpath;		/* path for each worker (and the leader) */
+	int			num_workers;	/* number of workers sought to help */
+} GatherPath;
+
 /*
  * UniquePath represents elimination of distinct rows from the output of
  * its subpath.
@@ -14,6 +14,7 @@
 #ifndef PLANCAT_H
 #define PLANCAT_H
 
+#include "catalog/partition.h"
 #include "nodes/relation.h"
 #include "utils/relcache.h"
 
@@ -36,6 +37,14 @@ extern int32 get_relation_data_width(Oid relid, int32 *attr_widths);
 extern bool relation_excluded_by_constraints(PlannerInfo *root,
 								 RelOptInfo *rel, RangeTblEntry *rte);
 
+extern Bitmapset *get_matching_partitions(PartitionKey key,
+						PartitionDesc pdesc, Index varno,
+						AttrNumber *keyattnos, List *quals);
+extern bool match_partition_key_clause(PartitionKey key, Index varno,
+						   AttrNumber *keyattnos, Expr *clause,
+						   int *keycol, StrategyNumber *strategy,
+						   Oid *cmpproc, Expr **expr);
+
 extern List *build_physical_tlist(PlannerInfo *root, RelOptInfo *rel);
 
 extern bool has_unique_index(RelOptInfo *rel, AttrNumber attno);
@@ -56,6 +56,14 @@
  */
 #define NUM_USER_DEFINED_LWLOCKS	4
 
+/*
+ * Number of spinlocks backing the atomic operations on platforms where they
+ * have to be emulated (see port/atomics.h).  Every emulated atomic variable
+ * hashes to one of these, so more reduces false contention between them;
+ * without TAS support each one costs a semaphore.
+ */
+#define NUM_ATOMICS_SPINLOCKS	64
+
 /*
  * Define this if you want to allow the lo_import and lo_export SQL
  * functions to be executed by ordinary users.	By default these
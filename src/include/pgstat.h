@@ -1,7 +1,7 @@
 /* ----------
  *	pgstat.h
  *
- *	Definitions for the PostgreSQL statistics collector daemon.
+ *	Definitions for the PostgreSQL cumulative statistics system.
  *
  *	Copyright (c) 2001-2013, PostgreSQL Global Development Group
  *
@@ -28,13 +28,11 @@ typedef enum TrackFunctionsLevel
 }	TrackFunctionsLevel;
 
 /* ----------
- * The types of backend -> collector messages
+ * The types of statistics messages
  * ----------
  */
 typedef enum StatMsgType
 {
-	PGSTAT_MTYPE_DUMMY,
-	PGSTAT_MTYPE_INQUIRY,
 	PGSTAT_MTYPE_TABSTAT,
 	PGSTAT_MTYPE_TABPURGE,
 	PGSTAT_MTYPE_DROPDB,
@@ -49,7 +47,8 @@ typedef enum StatMsgType
 	PGSTAT_MTYPE_FUNCPURGE,
 	PGSTAT_MTYPE_RECOVERYCONFLICT,
 	PGSTAT_MTYPE_TEMPFILE,
-	PGSTAT_MTYPE_DEADLOCK
+	PGSTAT_MTYPE_DEADLOCK,
+	PGSTAT_MTYPE_SLRU
 } StatMsgType;
 
 /* ----------
@@ -102,7 +101,8 @@ typedef struct PgStat_TableCounts
 /* Possible targets for resetting cluster-wide shared values */
 typedef enum PgStat_Shared_Reset_Target
 {
-	RESET_BGWRITER
+	RESET_BGWRITER,
+	RESET_SLRU
 } PgStat_Shared_Reset_Target;
 
 /* Possible object types for resetting single counters */
@@ -176,39 +176,15 @@ typedef struct PgStat_MsgHdr
 } PgStat_MsgHdr;
 
 /* ----------
- * Space available in a message.  This will keep the UDP packets below 1K,
- * which should fit unfragmented into the MTU of the lo interface on most
- * platforms. Does anybody care for platforms where it doesn't?
+ * Space available in a message.  Messages are no longer sent anywhere, but
+ * they're still the unit in which a backend's counts are added to the shared
+ * statistics, so this bounds how many table or function entries are
+ * processed per batch.
  * ----------
  */
 #define PGSTAT_MSG_PAYLOAD	(1000 - sizeof(PgStat_MsgHdr))
 
 
-/* ----------
- * PgStat_MsgDummy				A dummy message, ignored by the collector
- * ----------
- */
-typedef struct PgStat_MsgDummy
-{
-	PgStat_MsgHdr m_hdr;
-} PgStat_MsgDummy;
-
-
-/* ----------
- * PgStat_MsgInquiry			Sent by a backend to ask the collector
- *								to write the stats file.
- * ----------
- */
-
-typedef struct PgStat_MsgInquiry
-{
-	PgStat_MsgHdr m_hdr;
-	TimestampTz clock_time;		/* observed local clock time */
-	TimestampTz cutoff_time;	/* minimum acceptable file timestamp */
-	Oid			databaseid;		/* requested DB (InvalidOid => all DBs) */
-} PgStat_MsgInquiry;
-
-
 /* ----------
  * PgStat_TableEntry			Per-table info in a MsgTabstat
  * ----------
@@ -372,6 +348,36 @@ typedef struct PgStat_MsgBgWriter
 	PgStat_Counter m_checkpoint_sync_time;
 } PgStat_MsgBgWriter;
 
+/* ----------
+ * PgStat_SLRUCounts			Page-level activity of one SLRU cache.
+ *
+ * SLRU_NUM_ELEMENTS counts the caches pgstat.c knows by name, plus one
+ * "other" entry that any SLRU created by an extension is charged to.
+ * ----------
+ */
+#define SLRU_NUM_ELEMENTS	7
+
+typedef struct PgStat_SLRUCounts
+{
+	PgStat_Counter blocks_zeroed;
+	PgStat_Counter blocks_hit;
+	PgStat_Counter blocks_read;
+	PgStat_Counter blocks_written;
+	PgStat_Counter blocks_exists;
+	PgStat_Counter flush;
+	PgStat_Counter truncate;
+} PgStat_SLRUCounts;
+
+/* ----------
+ * PgStat_MsgSLRU				Sent by a backend to update SLRU statistics.
+ * ----------
+ */
+typedef struct PgStat_MsgSLRU
+{
+	PgStat_MsgHdr m_hdr;
+	PgStat_SLRUCounts m_counts[SLRU_NUM_ELEMENTS];
+} PgStat_MsgSLRU;
+
 /* ----------
  * PgStat_MsgRecoveryConflict	Sent by the backend upon recovery conflict
  * ----------
@@ -488,8 +494,6 @@ typedef struct PgStat_MsgDeadlock
 typedef union PgStat_Msg
 {
 	PgStat_MsgHdr msg_hdr;
-	PgStat_MsgDummy msg_dummy;
-	PgStat_MsgInquiry msg_inquiry;
 	PgStat_MsgTabstat msg_tabstat;
 	PgStat_MsgTabpurge msg_tabpurge;
 	PgStat_MsgDropdb msg_dropdb;
@@ -504,6 +508,7 @@ typedef union PgStat_Msg
 	PgStat_MsgFuncpurge msg_funcpurge;
 	PgStat_MsgRecoveryConflict msg_recoveryconflict;
 	PgStat_MsgDeadlock msg_deadlock;
+	PgStat_MsgSLRU msg_slru;
 } PgStat_Msg;
 
 
@@ -515,7 +520,7 @@ typedef union PgStat_Msg
  * ------------------------------------------------------------
  */
 
-#define PGSTAT_FILE_FORMAT_ID	0x01A5BC9B
+#define PGSTAT_FILE_FORMAT_ID	0x01A5BC9D
 
 /* ----------
  * PgStat_StatDBEntry			The collector's data per database
@@ -546,7 +551,6 @@ typedef struct PgStat_StatDBEntry
 	PgStat_Counter n_block_write_time;
 
 	TimestampTz stat_reset_timestamp;
-	TimestampTz stats_timestamp;	/* time of db stats file update */
 
 	/*
 	 * tables and functions must be last in the struct, because we don't write
@@ -613,7 +617,6 @@ typedef struct PgStat_StatFuncEntry
  */
 typedef struct PgStat_GlobalStats
 {
-	TimestampTz stats_timestamp;	/* time of stats file update */
 	PgStat_Counter timed_checkpoints;
 	PgStat_Counter requested_checkpoints;
 	PgStat_Counter checkpoint_write_time;		/* times in milliseconds */
@@ -627,6 +630,15 @@ typedef struct PgStat_GlobalStats
 	TimestampTz stat_reset_timestamp;
 } PgStat_GlobalStats;
 
+/*
+ * SLRU statistics kept in the stats collector, one per SLRU_NUM_ELEMENTS
+ */
+typedef struct PgStat_SLRUStats
+{
+	PgStat_SLRUCounts counts;
+	TimestampTz stat_reset_timestamp;
+} PgStat_SLRUStats;
+
 
 /* ----------
  * Backend states
@@ -724,15 +736,20 @@ extern bool pgstat_track_activities;
 extern bool pgstat_track_counts;
 extern int	pgstat_track_functions;
 extern PGDLLIMPORT int pgstat_track_activity_query_size;
-extern char *pgstat_stat_directory;
-extern char *pgstat_stat_tmpname;
-extern char *pgstat_stat_filename;
+extern int	pgstat_max_entries;
 
 /*
  * BgWriter statistics counters are updated directly by bgwriter and bufmgr
  */
 extern PgStat_MsgBgWriter BgWriterStats;
 
+/*
+ * SLRU statistics counters are updated directly by slru.c, via the
+ * pgstat_count_slru_* macros, in whatever process does the work
+ */
+extern PgStat_SLRUCounts SLRUStats[SLRU_NUM_ELEMENTS];
+extern bool have_slru_stats;
+
 /*
  * Updated by pgstat_count_buffer_*_time macros
  */
@@ -745,23 +762,17 @@ extern PgStat_Counter pgStatBlockWriteTime;
  */
 extern Size BackendStatusShmemSize(void);
 extern void CreateSharedBackendStatus(void);
+extern Size PgStatShmemSize(void);
+extern void CreateSharedPgStat(void);
 
-extern void pgstat_init(void);
-extern int	pgstat_start(void);
 extern void pgstat_reset_all(void);
-extern void allow_immediate_pgstat_restart(void);
-
-#ifdef EXEC_BACKEND
-extern void PgstatCollectorMain(int argc, char *argv[]) __attribute__((noreturn));
-#endif
+extern void pgstat_write_statsfile(void);
 
 
 /* ----------
  * Functions called from backends
  * ----------
  */
-extern void pgstat_ping(void);
-
 extern void pgstat_report_stat(bool force);
 extern void pgstat_vacuum_stat(void);
 extern void pgstat_drop_database(Oid databaseid);
@@ -839,6 +850,26 @@ extern void pgstat_initstats(Relation rel);
 #define pgstat_count_buffer_write_time(n)							\
 	(pgStatBlockWriteTime += (n))
 
+#define pgstat_count_slru_counter(idx, counter)						\
+	do {															\
+		SLRUStats[(idx)].counter++;									\
+		have_slru_stats = true;										\
+	} while (0)
+#define pgstat_count_slru_page_zeroed(idx)							\
+	pgstat_count_slru_counter(idx, blocks_zeroed)
+#define pgstat_count_slru_page_hit(idx)								\
+	pgstat_count_slru_counter(idx, blocks_hit)
+#define pgstat_count_slru_page_read(idx)							\
+	pgstat_count_slru_counter(idx, blocks_read)
+#define pgstat_count_slru_page_written(idx)							\
+	pgstat_count_slru_counter(idx, blocks_written)
+#define pgstat_count_slru_page_exists(idx)							\
+	pgstat_count_slru_counter(idx, blocks_exists)
+#define pgstat_count_slru_flush(idx)								\
+	pgstat_count_slru_counter(idx, flush)
+#define pgstat_count_slru_truncate(idx)								\
+	pgstat_count_slru_counter(idx, truncate)
+
 extern void pgstat_count_heap_insert(Relation rel, int n);
 extern void pgstat_count_heap_update(Relation rel, bool hot);
 extern void pgstat_count_heap_delete(Relation rel);
@@ -861,6 +892,10 @@ extern void pgstat_twophase_postabort(TransactionId xid, uint16 info,
 						  void *recdata, uint32 len);
 
 extern void pgstat_send_bgwriter(void);
+extern void pgstat_send_slru(void);
+
+extern int	pgstat_slru_index(const char *name);
+extern const char *pgstat_slru_name(int slru_idx);
 
 /* ----------
  * Support functions for the SQL-callable functions to
@@ -873,5 +908,6 @@ extern PgBackendStatus *pgstat_fetch_stat_beentry(int beid);
 extern PgStat_StatFuncEntry *pgstat_fetch_stat_funcentry(Oid funcid);
 extern int	pgstat_fetch_stat_numbackends(void);
 extern PgStat_GlobalStats *pgstat_fetch_global(void);
+extern PgStat_SLRUStats *pgstat_fetch_slru(void);
 
 #endif   /* PGSTAT_H */
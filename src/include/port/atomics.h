@@ -0,0 +1,249 @@
+/*-------------------------------------------------------------------------
+ *
+ * atomics.h
+ *	  Atomic operations.
+ *
+ * Hardware and compiler dependent functions for manipulating memory
+ * atomically, used to implement locking facilities and lockless algorithms.
+ *
+ * The operations provided here are:
+ *
+ * - pg_atomic_init_u32 and pg_atomic_write_u32 set the value of a variable.
+ *	 pg_atomic_read_u32 reads it.  None of these imply any memory barrier
+ *	 semantics; use the barriers in storage/barrier.h, which this file
+ *	 includes, where ordering against other memory accesses matters.
+ *
+ * - pg_atomic_compare_exchange_u32, pg_atomic_fetch_add_u32 and friends are
+ *	 read-modify-write operations.  They act as full memory barriers.
+ *
+ * On compilers that provide the GCC __sync builtins for 4-byte integers,
+ * and on MSVC, the operations map directly to the processor's atomic
+ * instructions.  Elsewhere they are emulated with a fixed pool of
+ * NUM_ATOMICS_SPINLOCKS spinlocks in shared memory, picked by the address
+ * of the variable (see src/backend/port/atomics.c).  That is correct but
+ * much slower; it can also be forced by defining DISABLE_ATOMICS, for
+ * testing.  Because of the pool, emulated atomic variables must live in
+ * shared memory, and the pool must be set up before any of them is used.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/port/atomics.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef ATOMICS_H
+#define ATOMICS_H
+
+#include "storage/barrier.h"
+
+#if defined(DISABLE_ATOMICS)
+/* use the spinlock-based emulation */
+#elif defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_4)
+#define PG_HAVE_ATOMIC_U32_SUPPORT
+#define PG_ATOMICS_USE_GCC_SYNC
+#elif defined(WIN32_ONLY_COMPILER)
+#define PG_HAVE_ATOMIC_U32_SUPPORT
+#define PG_ATOMICS_USE_MSVC
+#endif
+
+typedef struct pg_atomic_uint32
+{
+	volatile uint32 value;
+} pg_atomic_uint32;
+
+/* shared memory for the emulation; no-ops if it isn't needed */
+extern Size AtomicsShmemSize(void);
+extern void AtomicsShmemInit(void);
+
+#ifndef PG_HAVE_ATOMIC_U32_SUPPORT
+/* spinlock-based emulation, in src/backend/port/atomics.c */
+extern void pg_atomic_init_u32_impl(volatile pg_atomic_uint32 *ptr,
+						uint32 val);
+extern void pg_atomic_write_u32_impl(volatile pg_atomic_uint32 *ptr,
+						 uint32 val);
+extern bool pg_atomic_compare_exchange_u32_impl(volatile pg_atomic_uint32 *ptr,
+									uint32 *expected, uint32 newval);
+extern uint32 pg_atomic_fetch_add_u32_impl(volatile pg_atomic_uint32 *ptr,
+							 int32 add_);
+#endif
+
+/*
+ * We want the functions below to be inline; but if the compiler doesn't
+ * support that, fall back on providing them as regular functions.  See
+ * STATIC_IF_INLINE in c.h.
+ */
+#ifndef PG_USE_INLINE
+extern void pg_atomic_init_u32(volatile pg_atomic_uint32 *ptr, uint32 val);
+extern uint32 pg_atomic_read_u32(volatile pg_atomic_uint32 *ptr);
+extern void pg_atomic_write_u32(volatile pg_atomic_uint32 *ptr, uint32 val);
+extern bool pg_atomic_compare_exchange_u32(volatile pg_atomic_uint32 *ptr,
+							   uint32 *expected, uint32 newval);
+extern uint32 pg_atomic_fetch_add_u32(volatile pg_atomic_uint32 *ptr,
+						int32 add_);
+extern uint32 pg_atomic_fetch_sub_u32(volatile pg_atomic_uint32 *ptr,
+						int32 sub_);
+extern uint32 pg_atomic_fetch_and_u32(volatile pg_atomic_uint32 *ptr,
+						uint32 and_);
+extern uint32 pg_atomic_fetch_or_u32(volatile pg_atomic_uint32 *ptr,
+					   uint32 or_);
+extern uint32 pg_atomic_add_fetch_u32(volatile pg_atomic_uint32 *ptr,
+						int32 add_);
+extern uint32 pg_atomic_sub_fetch_u32(volatile pg_atomic_uint32 *ptr,
+						int32 sub_);
+#endif   /* !PG_USE_INLINE */
+
+#if defined(PG_USE_INLINE) || defined(ATOMICS_INCLUDE_DEFINITIONS)
+
+/*
+ * Initialize an atomic variable.  Must be done before any other operation
+ * on it, and not concurrently with any.
+ */
+STATIC_IF_INLINE void
+pg_atomic_init_u32(volatile pg_atomic_uint32 *ptr, uint32 val)
+{
+#ifdef PG_HAVE_ATOMIC_U32_SUPPORT
+	ptr->value = val;
+#else
+	pg_atomic_init_u32_impl(ptr, val);
+#endif
+}
+
+/*
+ * Read the current value.  No barrier semantics; the value may be stale by
+ * the time it's used.
+ */
+STATIC_IF_INLINE uint32
+pg_atomic_read_u32(volatile pg_atomic_uint32 *ptr)
+{
+	return ptr->value;
+}
+
+/*
+ * Set the value, without barrier semantics.  Concurrent read-modify-write
+ * operations see either the old or the new value, never a mixture.
+ */
+STATIC_IF_INLINE void
+pg_atomic_write_u32(volatile pg_atomic_uint32 *ptr, uint32 val)
+{
+#ifdef PG_HAVE_ATOMIC_U32_SUPPORT
+	ptr->value = val;
+#else
+	pg_atomic_write_u32_impl(ptr, val);
+#endif
+}
+
+/*
+ * If the variable contains *expected, replace it with newval and return
+ * true.  Otherwise return false, and store the current value in *expected,
+ * so that a retry loop doesn't have to re-read it.
+ */
+STATIC_IF_INLINE bool
+pg_atomic_compare_exchange_u32(volatile pg_atomic_uint32 *ptr,
+							   uint32 *expected, uint32 newval)
+{
+#if defined(PG_ATOMICS_USE_GCC_SYNC)
+	uint32		current;
+
+	current = __sync_val_compare_and_swap(&ptr->value, *expected, newval);
+	if (current == *expected)
+		return true;
+	*expected = current;
+	return false;
+#elif defined(PG_ATOMICS_USE_MSVC)
+	uint32		current;
+
+	current = (uint32) InterlockedCompareExchange((volatile LONG *) &ptr->value,
+												  (LONG) newval,
+												  (LONG) *expected);
+	if (current == *expected)
+		return true;
+	*expected = current;
+	return false;
+#else
+	return pg_atomic_compare_exchange_u32_impl(ptr, expected, newval);
+#endif
+}
+
+/*
+ * Atomically add add_ to the variable, returning the old value.
+ */
+STATIC_IF_INLINE uint32
+pg_atomic_fetch_add_u32(volatile pg_atomic_uint32 *ptr, int32 add_)
+{
+#if defined(PG_ATOMICS_USE_GCC_SYNC)
+	return __sync_fetch_and_add(&ptr->value, add_);
+#elif defined(PG_ATOMICS_USE_MSVC)
+	return (uint32) InterlockedExchangeAdd((volatile LONG *) &ptr->value,
+										   (LONG) add_);
+#else
+	return pg_atomic_fetch_add_u32_impl(ptr, add_);
+#endif
+}
+
+/*
+ * Atomically subtract sub_ from the variable, returning the old value.
+ */
+STATIC_IF_INLINE uint32
+pg_atomic_fetch_sub_u32(volatile pg_atomic_uint32 *ptr, int32 sub_)
+{
+	return pg_atomic_fetch_add_u32(ptr, -sub_);
+}
+
+/*
+ * Atomically AND and_ into the variable, returning the old value.
+ */
+STATIC_IF_INLINE uint32
+pg_atomic_fetch_and_u32(volatile pg_atomic_uint32 *ptr, uint32 and_)
+{
+#if defined(PG_ATOMICS_USE_GCC_SYNC)
+	return __sync_fetch_and_and(&ptr->value, and_);
+#else
+	uint32		old;
+
+	old = pg_atomic_read_u32(ptr);
+	while (!pg_atomic_compare_exchange_u32(ptr, &old, old & and_))
+		 /* skip */ ;
+	return old;
+#endif
+}
+
+/*
+ * Atomically OR or_ into the variable, returning the old value.
+ */
+STATIC_IF_INLINE uint32
+pg_atomic_fetch_or_u32(volatile pg_atomic_uint32 *ptr, uint32 or_)
+{
+#if defined(PG_ATOMICS_USE_GCC_SYNC)
+	return __sync_fetch_and_or(&ptr->value, or_);
+#else
+	uint32		old;
+
+	old = pg_atomic_read_u32(ptr);
+	while (!pg_atomic_compare_exchange_u32(ptr, &old, old | or_))
+		 /* skip */ ;
+	return old;
+#endif
+}
+
+/*
+ * Like pg_atomic_fetch_add_u32, but returns the new value.
+ */
+STATIC_IF_INLINE uint32
+pg_atomic_add_fetch_u32(volatile pg_atomic_uint32 *ptr, int32 add_)
+{
+	return pg_atomic_fetch_add_u32(ptr, add_) + add_;
+}
+
+/*
+ * Like pg_atomic_fetch_sub_u32, but returns the new value.
+ */
+STATIC_IF_INLINE uint32
+pg_atomic_sub_fetch_u32(volatile pg_atomic_uint32 *ptr, int32 sub_)
+{
+	return pg_atomic_fetch_add_u32(ptr, -sub_) - sub_;
+}
+
+#endif   /* PG_USE_INLINE || ATOMICS_INCLUDE_DEFINITIONS */
+
+#endif   /* ATOMICS_H */
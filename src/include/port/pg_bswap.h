@@ -0,0 +1,54 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_bswap.h
+ *	  Byte swapping.
+ *
+ * Macros for reversing the byte order of 32-bit and 64-bit unsigned integers.
+ * For example, 0xAABBCCDD becomes 0xDDCCBBAA.  These are just wrappers for
+ * shifts and masks; reasonably modern compilers recognize the pattern and
+ * emit a single byte-swap instruction.
+ *
+ * Also provides a macro to convert a Datum whose bytes were copied verbatim
+ * from a big-endian representation (as is done when building abbreviated
+ * sort keys) into a native integer, so that an unsigned integer comparison
+ * of two such Datums matches memcmp() of the original bytes.
+ *
+ *
+ * Copyright (c) 2013, PostgreSQL Global Development Group
+ *
+ * src/include/port/pg_bswap.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PG_BSWAP_H
+#define PG_BSWAP_H
+
+#define BSWAP32(x) ((((x) << 24) & 0xff000000) | \
+					(((x) << 8) & 0x00ff0000) | \
+					(((x) >> 8) & 0x0000ff00) | \
+					(((x) >> 24) & 0x000000ff))
+
+#define BSWAP64(x) ((((x) << 56) & UINT64CONST(0xff00000000000000)) | \
+					(((x) << 40) & UINT64CONST(0x00ff000000000000)) | \
+					(((x) << 24) & UINT64CONST(0x0000ff0000000000)) | \
+					(((x) << 8) & UINT64CONST(0x000000ff00000000)) | \
+					(((x) >> 8) & UINT64CONST(0x00000000ff000000)) | \
+					(((x) >> 24) & UINT64CONST(0x0000000000ff0000)) | \
+					(((x) >> 40) & UINT64CONST(0x000000000000ff00)) | \
+					(((x) >> 56) & UINT64CONST(0x00000000000000ff)))
+
+/*
+ * Rearrange the bytes of a Datum from big-endian order into the native byte
+ * order.  On big-endian machines, this does nothing at all.
+ */
+#ifdef WORDS_BIGENDIAN
+#define		DatumBigEndianToNative(x)	(x)
+#else							/* !WORDS_BIGENDIAN */
+#if SIZEOF_DATUM == 8
+#define		DatumBigEndianToNative(x)	BSWAP64(x)
+#else							/* SIZEOF_DATUM != 8 */
+#define		DatumBigEndianToNative(x)	BSWAP32(x)
+#endif   /* SIZEOF_DATUM == 8 */
+#endif   /* WORDS_BIGENDIAN */
+
+#endif   /* PG_BSWAP_H */
@@ -16,6 +16,7 @@
 #define BUFMGR_INTERNALS_H
 
 #include "storage/buf.h"
+#include "storage/bufmgr.h"
 #include "storage/latch.h"
 #include "storage/lwlock.h"
 #include "storage/shmem.h"
@@ -95,14 +96,55 @@ typedef struct buftag
 	(a).forkNum == (b).forkNum \
 )
 
+/*
+ * Queue of recently written buffers for which we have yet to ask the kernel
+ * to start writeback.  Requests are collected until max_pending of them
+ * have accumulated, and then issued at once, sorted and merged into ranges
+ * of consecutive blocks.  max_pending points to the GUC variable that
+ * controls this kind of writes; zero disables writeback requests.
+ */
+typedef struct PendingWriteback
+{
+	BufferTag	tag;
+} PendingWriteback;
+
+struct WritebackContext
+{
+	int		   *max_pending;
+	int			nr_pending;
+	PendingWriteback pending_writebacks[WRITEBACK_MAX_PENDING_FLUSHES];
+};
+
+/*
+ * The checkpointer sorts the buffers it has to write into this order, to
+ * write each file sequentially.  The array lives in shared memory, so that
+ * a checkpoint can't fail for lack of memory.
+ */
+typedef struct CkptSortItem
+{
+	Oid			tsId;
+	Oid			relNode;
+	ForkNumber	forkNum;
+	BlockNumber blockNum;
+	int			buf_id;
+} CkptSortItem;
+
+/*
+ * The list of free buffers is split into this many partitions, each with its
+ * own spinlock, so that backends looking for a victim buffer don't all
+ * contend for a single lock.  Buffer i belongs to freelist
+ * i % NUM_BUFFER_FREELISTS.
+ */
+#define NUM_BUFFER_FREELISTS	16
+
 /*
  * The shared buffer mapping table is partitioned to reduce contention.
  * To determine which partition lock a given tag requires, compute the tag's
  * hash code with BufTableHashCode(), then apply BufMappingPartitionLock().
- * NB: NUM_BUFFER_PARTITIONS must be a power of 2!
+ * NumBufferPartitions is always a power of 2, so we can mask.
  */
 #define BufTableHashPartition(hashcode) \
-	((hashcode) % NUM_BUFFER_PARTITIONS)
+	((hashcode) & (NumBufferPartitions - 1))
 #define BufMappingPartitionLock(hashcode) \
 	((LWLockId) (FirstBufMappingLock + BufTableHashPartition(hashcode)))
 
@@ -112,9 +154,9 @@ typedef struct buftag
  * Note: buf_hdr_lock must be held to examine or change the tag, flags,
  * usage_count, refcount, or wait_backend_pid fields.  buf_id field never
  * changes after initialization, so does not need locking.	freeNext is
- * protected by the BufFreelistLock not buf_hdr_lock.  The LWLocks can take
- * care of themselves.	The buf_hdr_lock is *not* used to control access to
- * the data in the buffer!
+ * protected by the spinlock of the buffer's freelist, not buf_hdr_lock.
+ * The LWLocks can take care of themselves.  The buf_hdr_lock is *not* used
+ * to control access to the data in the buffer!
  *
  * An exception is that if we have the buffer pinned, its tag can't change
  * underneath us, so we can examine the tag without locking the spinlock.
@@ -172,6 +214,8 @@ typedef struct sbufdesc
 
 /* in buf_init.c */
 extern PGDLLIMPORT BufferDesc *BufferDescriptors;
+extern CkptSortItem *CkptBufferIds;
+extern WritebackContext BackendWritebackContext;
 
 /* in localbuf.c */
 extern BufferDesc *LocalBufferDescriptors;
@@ -181,14 +225,21 @@ extern BufferDesc *LocalBufferDescriptors;
  * Internal routines: only called by bufmgr
  */
 
+/* bufmgr.c */
+extern void WritebackContextInit(WritebackContext *context, int *max_pending);
+extern void ScheduleBufferTagForWriteback(WritebackContext *context,
+							  BufferTag *tag);
+extern void IssuePendingWritebacks(WritebackContext *context);
+
 /* freelist.c */
-extern volatile BufferDesc *StrategyGetBuffer(BufferAccessStrategy strategy,
-				  bool *lock_held);
+extern volatile BufferDesc *StrategyGetBuffer(BufferAccessStrategy strategy);
 extern void StrategyFreeBuffer(volatile BufferDesc *buf);
+extern void StrategyPrefillBuffer(volatile BufferDesc *buf);
 extern bool StrategyRejectBuffer(BufferAccessStrategy strategy,
 					 volatile BufferDesc *buf);
 
-extern int	StrategySyncStart(uint32 *complete_passes, uint32 *num_buf_alloc);
+extern int StrategySyncStart(uint32 *complete_passes, uint32 *num_buf_alloc,
+				  uint32 *num_freelist_alloc);
 extern void StrategyNotifyBgWriter(Latch *bgwriterLatch);
 
 extern Size StrategyShmemSize(void);
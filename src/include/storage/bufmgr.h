@@ -18,10 +18,14 @@
 #include "storage/buf.h"
 #include "storage/bufpage.h"
 #include "storage/relfilenode.h"
+#include "storage/smgr.h"
 #include "utils/relcache.h"
 
 typedef void *Block;
 
+/* Queue of buffers to write back, see buf_internals.h */
+typedef struct WritebackContext WritebackContext;
+
 /* Possible arguments for GetAccessStrategy() */
 typedef enum BufferAccessStrategyType
 {
@@ -52,6 +56,33 @@ extern int	bgwriter_lru_maxpages;
 extern double bgwriter_lru_multiplier;
 extern bool track_io_timing;
 extern int	target_prefetch_pages;
+extern int	io_combine_limit;
+extern int	checkpoint_flush_after;
+extern int	bgwriter_flush_after;
+extern int	backend_flush_after;
+
+/*
+ * Upper limit on the number of blocks ReadBufferRange reads at once.  The
+ * default io_combine_limit reads 128kB at a time with the default BLCKSZ.
+ */
+#define MAX_IO_COMBINE_LIMIT		32
+#define DEFAULT_IO_COMBINE_LIMIT	Min(MAX_IO_COMBINE_LIMIT, (128 * 1024) / BLCKSZ)
+
+/*
+ * Upper limit on checkpoint_flush_after, bgwriter_flush_after and
+ * backend_flush_after, and their defaults.  Writeback can only be
+ * requested with sync_file_range(), so it's disabled by default on
+ * platforms that lack it.
+ */
+#define WRITEBACK_MAX_PENDING_FLUSHES	256
+#ifdef HAVE_SYNC_FILE_RANGE
+#define DEFAULT_CHECKPOINT_FLUSH_AFTER	((256 * 1024) / BLCKSZ)
+#define DEFAULT_BGWRITER_FLUSH_AFTER	((512 * 1024) / BLCKSZ)
+#else
+#define DEFAULT_CHECKPOINT_FLUSH_AFTER	0
+#define DEFAULT_BGWRITER_FLUSH_AFTER	0
+#endif
+#define DEFAULT_BACKEND_FLUSH_AFTER		0
 
 /* in buf_init.c */
 extern PGDLLIMPORT char *BufferBlocks;
@@ -161,12 +192,17 @@ extern PGDLLIMPORT int32 *LocalRefCount;
 /*
  * prototypes for functions in bufmgr.c
  */
+extern bool PrefetchSharedBuffer(SMgrRelation smgr_reln, ForkNumber forkNum,
+					 BlockNumber blockNum);
 extern void PrefetchBuffer(Relation reln, ForkNumber forkNum,
 			   BlockNumber blockNum);
 extern Buffer ReadBuffer(Relation reln, BlockNumber blockNum);
 extern Buffer ReadBufferExtended(Relation reln, ForkNumber forkNum,
 				   BlockNumber blockNum, ReadBufferMode mode,
 				   BufferAccessStrategy strategy);
+extern int ReadBufferRange(Relation reln, ForkNumber forkNum,
+				BlockNumber firstBlockNum, int nblocks,
+				BufferAccessStrategy strategy, Buffer *buffers);
 extern Buffer ReadBufferWithoutRelcache(RelFileNode rnode,
 						  ForkNumber forkNum, BlockNumber blockNum,
 						  ReadBufferMode mode, BufferAccessStrategy strategy);
@@ -177,6 +213,7 @@ extern void IncrBufferRefCount(Buffer buffer);
 extern Buffer ReleaseAndReadBuffer(Buffer buffer, Relation relation,
 					 BlockNumber blockNum);
 
+extern void InitializeBufferPartitions(void);
 extern void InitBufferPool(void);
 extern void InitBufferPoolAccess(void);
 extern void InitBufferPoolBackend(void);
@@ -188,9 +225,9 @@ extern BlockNumber RelationGetNumberOfBlocksInFork(Relation relation,
 								ForkNumber forkNum);
 extern void FlushRelationBuffers(Relation rel);
 extern void FlushDatabaseBuffers(Oid dbid);
-extern void DropRelFileNodeBuffers(RelFileNodeBackend rnode,
+extern void DropRelFileNodeBuffers(SMgrRelation smgr_reln,
 					   ForkNumber forkNum, BlockNumber firstDelBlock);
-extern void DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes);
+extern void DropRelFileNodesAllBuffers(SMgrRelation *smgr_reln, int nnodes);
 extern void DropDatabaseBuffers(Oid dbid);
 
 #define RelationGetNumberOfBlocks(reln) \
@@ -218,7 +255,7 @@ extern bool HoldingBufferPinThatDelaysRecovery(void);
 extern void AbortBufferIO(void);
 
 extern void BufmgrCommit(void);
-extern bool BgBufferSync(void);
+extern bool BgBufferSync(WritebackContext *wb_context);
 
 extern void AtProcExit_LocalBuffers(void);
 
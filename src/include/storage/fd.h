@@ -50,6 +50,9 @@ typedef char *FileName;
 
 typedef int File;
 
+/* Maximum number of buffers FileReadV can fill in one call */
+#define MAX_FILE_READV_BUFFERS	32
+
 
 /* GUC parameter */
 extern int	max_files_per_process;
@@ -69,7 +72,9 @@ extern File PathNameOpenFile(FileName fileName, int fileFlags, int fileMode);
 extern File OpenTemporaryFile(bool interXact);
 extern void FileClose(File file);
 extern int	FilePrefetch(File file, off_t offset, int amount);
+extern void FileWriteback(File file, off_t offset, off_t nbytes);
 extern int	FileRead(File file, char *buffer, int amount);
+extern int	FileReadV(File file, char **buffers, int nbuffers, int amount);
 extern int	FileWrite(File file, char *buffer, int amount);
 extern int	FileSync(File file);
 extern off_t FileSeek(File file, off_t offset, int whence);
@@ -489,6 +489,7 @@ typedef enum
 /*
  * function prototypes
  */
+extern void InitializeFastPathLocks(void);
 extern void InitLocks(void);
 extern LockMethod GetLocksMethodTable(const LOCK *lock);
 extern uint32 LockTagHashCode(const LOCKTAG *locktag);
@@ -15,22 +15,39 @@
 #define LWLOCK_H
 
 /*
- * It's a bit odd to declare NUM_BUFFER_PARTITIONS and NUM_LOCK_PARTITIONS
- * here, but we need them to set up enum LWLockId correctly, and having
- * this file include lock.h or bufmgr.h would be backwards.
+ * It's a bit odd to declare the buffer and lock partition counts here, but
+ * we need them to set up enum LWLockId correctly, and having this file
+ * include lock.h or bufmgr.h would be backwards.
  */
 
-/* Number of partitions of the shared buffer mapping hashtable */
-#define NUM_BUFFER_PARTITIONS  16
+/*
+ * Number of partitions of the shared buffer mapping hashtable.  This is
+ * chosen at startup from NBuffers (see InitializeBufferPartitions), so that
+ * a large buffer pool, which many-core machines tend to have, gets enough
+ * partitions that backends rarely collide on the same lock, while a small
+ * one doesn't pay for locks it can't use.  It's always a power of 2 between
+ * MIN_BUFFER_PARTITIONS and MAX_BUFFER_PARTITIONS.
+ */
+#define MIN_BUFFER_PARTITIONS  16
+#define MAX_BUFFER_PARTITIONS  1024
+
+extern PGDLLIMPORT int NumBufferPartitions;
 
 /* Number of partitions the shared lock tables are divided into */
-#define LOG2_NUM_LOCK_PARTITIONS  4
+#define LOG2_NUM_LOCK_PARTITIONS  6
 #define NUM_LOCK_PARTITIONS  (1 << LOG2_NUM_LOCK_PARTITIONS)
 
 /* Number of partitions the shared predicate lock tables are divided into */
 #define LOG2_NUM_PREDICATELOCK_PARTITIONS  4
 #define NUM_PREDICATELOCK_PARTITIONS  (1 << LOG2_NUM_PREDICATELOCK_PARTITIONS)
 
+/* Number of WAL insertion locks, see xlog.c */
+#define NUM_XLOGINSERT_LOCKS  8
+
+/* Number of partitions the shared statistics tables are divided into */
+#define LOG2_NUM_PGSTAT_PARTITIONS  4
+#define NUM_PGSTAT_PARTITIONS  (1 << LOG2_NUM_PGSTAT_PARTITIONS)
+
 /*
  * We have a number of predefined LWLocks, plus a bunch of LWLocks that are
  * dynamically assigned (e.g., for shared buffers).  The LWLock structures
@@ -46,19 +63,16 @@
  */
 typedef enum LWLockId
 {
-	BufFreelistLock,
 	ShmemIndexLock,
 	OidGenLock,
 	XidGenLock,
 	ProcArrayLock,
 	SInvalReadLock,
 	SInvalWriteLock,
-	WALInsertLock,
+	WALBufMappingLock,
 	WALWriteLock,
 	ControlFileLock,
 	CheckpointLock,
-	CLogControlLock,
-	SubtransControlLock,
 	MultiXactGenLock,
 	MultiXactOffsetControlLock,
 	MultiXactMemberControlLock,
@@ -79,17 +93,24 @@ typedef enum LWLockId
 	SerializablePredicateLockListLock,
 	OldSerXidLock,
 	SyncRepLock,
+	BackgroundWorkerLock,
+	ParallelQueryLock,
+	PgStatLock,
 	/* Individual lock IDs end here */
-	FirstBufMappingLock,
-	FirstLockMgrLock = FirstBufMappingLock + NUM_BUFFER_PARTITIONS,
+	FirstLockMgrLock,
 	FirstPredicateLockMgrLock = FirstLockMgrLock + NUM_LOCK_PARTITIONS,
+	FirstXLogInsertLock = FirstPredicateLockMgrLock + NUM_PREDICATELOCK_PARTITIONS,
+	FirstPgStatLock = FirstXLogInsertLock + NUM_XLOGINSERT_LOCKS,
 
 	/* must be last except for MaxDynamicLWLock: */
-	NumFixedLWLocks = FirstPredicateLockMgrLock + NUM_PREDICATELOCK_PARTITIONS,
+	NumFixedLWLocks = FirstPgStatLock + NUM_PGSTAT_PARTITIONS,
 
 	MaxDynamicLWLock = 1000000000
 } LWLockId;
 
+/* The NumBufferPartitions buffer mapping locks follow the fixed ones */
+#define FirstBufMappingLock ((LWLockId) NumFixedLWLocks)
+
 
 typedef enum LWLockMode
 {
@@ -113,6 +134,11 @@ extern void LWLockRelease(LWLockId lockid);
 extern void LWLockReleaseAll(void);
 extern bool LWLockHeldByMe(LWLockId lockid);
 
+extern bool LWLockAcquireWithVar(LWLockId lockid, uint64 *valptr, uint64 val);
+extern bool LWLockWaitForVar(LWLockId lockid, uint64 *valptr, uint64 oldval,
+				 uint64 *newval);
+extern void LWLockUpdateVar(LWLockId lockid, uint64 *valptr, uint64 val);
+
 extern int	NumLWLocks(void);
 extern Size LWLockShmemSize(void);
 extern void CreateLWLocks(void);
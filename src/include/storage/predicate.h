@@ -22,10 +22,7 @@
  * GUC variables
  */
 extern int	max_predicate_locks_per_xact;
-
-
-/* Number of SLRU buffers to use for predicate locking */
-#define NUM_OLDSERXID_BUFFERS	16
+extern int	serializable_buffers;
 
 
 /*
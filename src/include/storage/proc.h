@@ -47,12 +47,20 @@ struct XidCache
 #define		PROC_VACUUM_STATE_MASK (0x0E)
 
 /*
- * We allow a small number of "weak" relation locks (AccesShareLock,
- * RowShareLock, RowExclusiveLock) to be recorded in the PGPROC structure
- * rather than the main lock table.  This eases contention on the lock
- * manager LWLocks.  See storage/lmgr/README for additional details.
+ * We allow a number of "weak" relation locks (AccesShareLock, RowShareLock,
+ * RowExclusiveLock) to be recorded in per-backend fast-path arrays, reached
+ * through the PGPROC structure, rather than the main lock table.  This eases
+ * contention on the lock manager LWLocks.  The arrays are divided into
+ * groups of FP_LOCK_SLOTS_PER_GROUP slots; the number of groups is derived
+ * from max_locks_per_transaction at startup.  See storage/lmgr/README for
+ * additional details.
  */
-#define		FP_LOCK_SLOTS_PER_BACKEND 16
+extern PGDLLIMPORT int FastPathLockGroupsPerBackend;
+
+#define		FP_LOCK_GROUPS_PER_BACKEND_MAX	1024
+#define		FP_LOCK_SLOTS_PER_GROUP		16	/* don't change: must fit in uint64 */
+#define		FastPathLockSlotsPerBackend() \
+	(FP_LOCK_SLOTS_PER_GROUP * FastPathLockGroupsPerBackend)
 
 /*
  * Each backend has a PGPROC struct in shared memory.  There is also a list of
@@ -134,8 +142,9 @@ struct PGPROC
 	LWLockId	backendLock;	/* protects the fields below */
 
 	/* Lock manager data, recording fast-path locks taken by this backend. */
-	uint64		fpLockBits;		/* lock modes held for each fast-path slot */
-	Oid			fpRelId[FP_LOCK_SLOTS_PER_BACKEND];		/* slots for rel oids */
+	uint64	   *fpLockBits;		/* lock modes held for each fast-path slot,
+								 * one word per group */
+	Oid		   *fpRelId;		/* slots for rel oids */
 	bool		fpVXIDLock;		/* are we holding a fast-path VXID lock? */
 	LocalTransactionId fpLocalTransactionId;	/* lxid for fast-path VXID
 												 * lock */
@@ -0,0 +1,40 @@
+/*-------------------------------------------------------------------------
+ *
+ * readstream.h
+ *	  Look-ahead reading of a sequence of relation blocks.
+ *
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/storage/readstream.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef READSTREAM_H
+#define READSTREAM_H
+
+#include "storage/bufmgr.h"
+
+typedef struct ReadStream ReadStream;
+
+/*
+ * Callback that returns the next block number the stream should read, or
+ * InvalidBlockNumber when there are no more.  per_buffer_data points to
+ * per_buffer_data_size bytes of space that is handed back to the consumer
+ * along with the buffer for the block.
+ */
+typedef BlockNumber (*ReadStreamBlockCB) (ReadStream *stream,
+													  void *callback_private_data,
+													  void *per_buffer_data);
+
+extern ReadStream *BeginReadStream(Relation rel, ForkNumber forknum,
+				BufferAccessStrategy strategy,
+				ReadStreamBlockCB callback,
+				void *callback_private_data,
+				size_t per_buffer_data_size);
+extern Buffer ReadStreamNextBuffer(ReadStream *stream, void **per_buffer_data);
+extern void ResetReadStream(ReadStream *stream);
+extern void EndReadStream(ReadStream *stream);
+
+#endif   /* READSTREAM_H */
@@ -204,6 +204,9 @@ extern bool log_planner_stats;
 extern bool log_executor_stats;
 extern bool log_statement_stats;
 extern bool log_btree_build_stats;
+#ifdef TRACE_SORT
+extern bool trace_sort;
+#endif
 
 extern PGDLLIMPORT bool check_function_bodies;
 extern bool default_with_oids;
@@ -380,6 +383,9 @@ extern void assign_temp_tablespaces(const char *newval, void *extra);
 extern bool check_search_path(char **newval, void **extra, GucSource source);
 extern void assign_search_path(const char *newval, void *extra);
 
+/* in access/transam/slru.c */
+extern bool check_slru_buffers(int *newval, void **extra, GucSource source);
+
 /* in access/transam/xlog.c */
 extern bool check_wal_buffers(int *newval, void **extra, GucSource source);
 extern void assign_xlog_sync_method(int new_sync_method, void *extra);
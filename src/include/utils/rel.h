@@ -110,6 +110,19 @@ typedef struct RelationData
 	MemoryContext rd_rulescxt;	/* private memory cxt for rd_rules, if any */
 	TriggerDesc *trigdesc;		/* Trigger info, or NULL if rel has none */
 
+	/*
+	 * Partitioning info is loaded on demand by RelationGetPartitionKey and
+	 * RelationGetPartitionDesc (see catalog/partition.c); rd_partvalid says
+	 * whether that has been done.  Both pointers are NULL if the relation is
+	 * not partitioned.  All of it lives in rd_partcxt.  rd_partparent is
+	 * loaded at the same time.
+	 */
+	bool		rd_partvalid;	/* are rd_partkey and rd_partdesc loaded? */
+	Oid			rd_partparent;	/* parent, if rel is a partition, else 0 */
+	MemoryContext rd_partcxt;	/* private memory cxt for partitioning info */
+	struct PartitionKeyData *rd_partkey;	/* partition key, or NULL */
+	struct PartitionDescData *rd_partdesc;	/* partitions, or NULL */
+
 	/*
 	 * rd_options is set whenever rd_rel is loaded into the relcache entry.
 	 * Note that you can NOT look into rd_rel for this data.  NULL means "use
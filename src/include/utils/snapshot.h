@@ -62,6 +62,13 @@ typedef struct SnapshotData
 	CommandId	curcid;			/* in my xact, CID < curcid are visible */
 	uint32		active_count;	/* refcount on ActiveSnapshot stack */
 	uint32		regd_count;		/* refcount on RegisteredSnapshotList */
+
+	/*
+	 * The transaction completion count at the time GetSnapshotData built
+	 * this snapshot, or 0 if its contents were not built that way.  Used to
+	 * reuse the snapshot's contents if no transaction has completed since.
+	 */
+	uint64		snapXactCompletionCount;
 } SnapshotData;
 
 /*
@@ -20,8 +20,12 @@
  * multiple acceleration mechanisms to be supported, but no opclass is
  * required to provide all of them.  The BTSORTSUPPORT function should
  * simply not set any function pointers for mechanisms it doesn't support.
- * (However, all opclasses that provide BTSORTSUPPORT are required to provide
- * the comparator function.)
+ * Opclasses that provide BTSORTSUPPORT and don't provide a comparator
+ * function will have a shim set up by sort support automatically.  However,
+ * opclasses that support the optional additional abbreviated key capability
+ * must always provide an authoritative comparator used to tie-break
+ * inconclusive abbreviated comparisons and also used when aborting
+ * abbreviation.
  *
  * All sort support functions will be passed the address of the
  * SortSupportData struct when called, so they can use it to store
@@ -36,6 +40,26 @@
  * comparison.	This could sensibly be used to provide a fast comparator
  * function for such cases, but probably not any other acceleration method.
  *
+ * A BTSORTSUPPORT function may also offer "abbreviated keys".  When the
+ * caller sets ssup->abbreviate, the opclass may supply a conversion routine
+ * that packs a cheap-to-compare, order-preserving proxy for each value into
+ * a pass-by-value Datum (typically a strxfrm() blob prefix, or a few leading
+ * digits).  The sort then stores the abbreviated key in place of the
+ * original leading value, and calls the comparator on abbreviated keys.
+ * Only when that comparison reports a tie must the caller fall back on the
+ * abbrev_full_comparator, applied to the original values.  Since an
+ * abbreviated comparison can only be inconclusive, never wrong, this gives
+ * the same final order at a fraction of the cost whenever most comparisons
+ * are resolved by the abbreviated keys alone.
+ *
+ * Abbreviation can go wrong when the abbreviated keys turn out to have
+ * much lower cardinality than the originals (for instance, strings that
+ * share a long common prefix): every comparison then pays for both the
+ * abbreviated comparison and the full one.  The opclass's abbrev_abort
+ * callback is therefore consulted periodically while tuples are loaded, and
+ * may use whatever cardinality estimation it likes to tell the caller to
+ * give up on abbreviation.
+ *
  *
  * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -48,6 +72,7 @@
 #define SORTSUPPORT_H
 
 #include "access/attnum.h"
+#include "utils/relcache.h"
 
 typedef struct SortSupportData *SortSupport;
 
@@ -83,7 +108,8 @@ typedef struct SortSupportData
 	/*
 	 * Function pointers are zeroed before calling the BTSORTSUPPORT function,
 	 * and must be set by it for any acceleration methods it wants to supply.
-	 * The comparator pointer must be set, others are optional.
+	 * If the comparator pointer is left unset, callers fall back on a shim
+	 * around the opclass's BTORDER_PROC.
 	 */
 
 	/*
@@ -96,8 +122,38 @@ typedef struct SortSupportData
 	int			(*comparator) (Datum x, Datum y, SortSupport ssup);
 
 	/*
-	 * Additional sort-acceleration functions might be added here later.
+	 * "Abbreviated key" infrastructure follows.
+	 *
+	 * abbreviate is set by the caller before calling the BTSORTSUPPORT
+	 * function, to indicate that it is prepared to use abbreviated keys for
+	 * this column.  Callers only ever set it for the leading sort key.  The
+	 * opclass is free to ignore the request, by not setting abbrev_converter.
+	 */
+	bool		abbreviate;
+
+	/*
+	 * Converter to abbreviated format, from original representation.  If
+	 * this is set, the comparator above is understood to operate on
+	 * abbreviated keys, and a zero result from it is not authoritative: the
+	 * caller must then compare the original values with
+	 * abbrev_full_comparator.  NULL values are never abbreviated.
+	 */
+	Datum		(*abbrev_converter) (Datum original, SortSupport ssup);
+
+	/*
+	 * abbrev_abort callback allows the opclass to inform the caller that
+	 * abbreviation is not paying off, based on the number of tuples
+	 * processed so far (memtupcount).  If it returns true, the caller must
+	 * stop abbreviating, re-fetch any original values it replaced, and use
+	 * abbrev_full_comparator as the comparator from then on.
+	 */
+	bool		(*abbrev_abort) (int memtupcount, SortSupport ssup);
+
+	/*
+	 * Full, authoritative comparator for the original (non-abbreviated)
+	 * representation, with the same API as comparator.
 	 */
+	int			(*abbrev_full_comparator) (Datum x, Datum y, SortSupport ssup);
 } SortSupportData;
 
 
@@ -109,6 +165,9 @@ typedef struct SortSupportData
 extern int ApplySortComparator(Datum datum1, bool isNull1,
 					Datum datum2, bool isNull2,
 					SortSupport ssup);
+extern int ApplySortAbbrevFullComparator(Datum datum1, bool isNull1,
+							  Datum datum2, bool isNull2,
+							  SortSupport ssup);
 #endif   /* !PG_USE_INLINE */
 #if defined(PG_USE_INLINE) || defined(SORTSUPPORT_INCLUDE_DEFINITIONS)
 /*
@@ -147,10 +206,51 @@ ApplySortComparator(Datum datum1, bool isNull1,
 
 	return compare;
 }
+
+/*
+ * Apply the authoritative comparator to the original values of an
+ * abbreviated sort key, as a tie-breaker after an inconclusive comparison
+ * of abbreviated keys.  NULLs and reverse-sort are handled just as in
+ * ApplySortComparator.
+ */
+STATIC_IF_INLINE int
+ApplySortAbbrevFullComparator(Datum datum1, bool isNull1,
+							  Datum datum2, bool isNull2,
+							  SortSupport ssup)
+{
+	int			compare;
+
+	if (isNull1)
+	{
+		if (isNull2)
+			compare = 0;		/* NULL "=" NULL */
+		else if (ssup->ssup_nulls_first)
+			compare = -1;		/* NULL "<" NOT_NULL */
+		else
+			compare = 1;		/* NULL ">" NOT_NULL */
+	}
+	else if (isNull2)
+	{
+		if (ssup->ssup_nulls_first)
+			compare = 1;		/* NOT_NULL ">" NULL */
+		else
+			compare = -1;		/* NOT_NULL "<" NULL */
+	}
+	else
+	{
+		compare = (*ssup->abbrev_full_comparator) (datum1, datum2, ssup);
+		if (ssup->ssup_reverse)
+			compare = -compare;
+	}
+
+	return compare;
+}
 #endif   /*-- PG_USE_INLINE || SORTSUPPORT_INCLUDE_DEFINITIONS */
 
 /* Other functions in utils/sort/sortsupport.c */
 extern void PrepareSortSupportComparisonShim(Oid cmpFunc, SortSupport ssup);
 extern void PrepareSortSupportFromOrderingOp(Oid orderingOp, SortSupport ssup);
+extern void PrepareSortSupportFromIndexRel(Relation indexRel, int16 strategy,
+							   SortSupport ssup);
 
 #endif   /* SORTSUPPORT_H */
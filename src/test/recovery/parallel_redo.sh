@@ -0,0 +1,212 @@
+#!/bin/sh
+
+# src/test/recovery/parallel_redo.sh
+#
+# Test driver for parallel WAL redo.  Sets up a primary and a hot standby
+# that replays with parallel_redo_workers, and runs heap and btree changes
+# on the primary while queries on the standby keep scanning the indexes.
+# The queries must never fail, and once the standby has caught up it must
+# return the same data as the primary.
+#
+# Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+# Portions Copyright (c) 1994, Regents of the University of California
+
+set -e
+
+: ${MAKE=make}
+
+# Guard against parallel make issues (see comments in pg_regress.c)
+unset MAKEFLAGS
+unset MAKELEVEL
+
+# Set listen_addresses desirably
+testhost=`uname -s`
+
+case $testhost in
+	MINGW*)	LISTEN_ADDRESSES="localhost" ;;
+	*)		LISTEN_ADDRESSES="" ;;
+esac
+
+temp_root=$PWD/tmp_check
+
+if [ "$1" = '--install' ]; then
+	temp_install=$temp_root/install
+	bindir=$temp_install/$bindir
+	libdir=$temp_install/$libdir
+
+	"$MAKE" -s -C ../../.. install DESTDIR="$temp_install"
+
+	# platform-specific magic to find the shared libraries; see pg_regress.c
+	LD_LIBRARY_PATH=$libdir:$LD_LIBRARY_PATH
+	export LD_LIBRARY_PATH
+	DYLD_LIBRARY_PATH=$libdir:$DYLD_LIBRARY_PATH
+	export DYLD_LIBRARY_PATH
+	LIBPATH=$libdir:$LIBPATH
+	export LIBPATH
+	PATH=$libdir:$PATH
+fi
+
+PATH=$bindir:$PATH
+export PATH
+
+PRIMARY_PGDATA=$temp_root/primary
+STANDBY_PGDATA=$temp_root/standby
+rm -rf "$PRIMARY_PGDATA" "$STANDBY_PGDATA"
+
+logdir=$PWD/log
+rm -rf "$logdir"
+mkdir "$logdir"
+
+# Clear out any environment vars that might cause libpq to connect to
+# the wrong postmaster (cf pg_regress.c)
+PGDATABASE="";        unset PGDATABASE
+PGUSER="";            unset PGUSER
+PGSERVICE="";         unset PGSERVICE
+PGSSLMODE="";         unset PGSSLMODE
+PGREQUIRESSL="";      unset PGREQUIRESSL
+PGCONNECT_TIMEOUT=""; unset PGCONNECT_TIMEOUT
+PGHOST="";            unset PGHOST
+PGHOSTADDR="";        unset PGHOSTADDR
+
+# Select two non-conflicting port numbers, similarly to pg_regress.c
+newsrc=`cd ../../.. && pwd`
+PG_VERSION_NUM=`grep '#define PG_VERSION_NUM' $newsrc/src/include/pg_config.h | awk '{print $3}'`
+PRIMARY_PORT=`expr $PG_VERSION_NUM % 16384 + 49152`
+
+i=0
+while psql -X -p $PRIMARY_PORT postgres </dev/null 2>/dev/null ||
+	  psql -X -p `expr $PRIMARY_PORT + 1` postgres </dev/null 2>/dev/null
+do
+	i=`expr $i + 1`
+	if [ $i -eq 16 ]
+	then
+		echo port $PRIMARY_PORT apparently in use
+		exit 1
+	fi
+	PRIMARY_PORT=`expr $PRIMARY_PORT + 2`
+done
+STANDBY_PORT=`expr $PRIMARY_PORT + 1`
+
+primary_psql ()
+{
+	psql -X -q -A -t -p $PRIMARY_PORT -d postgres -c "$1"
+}
+
+standby_psql ()
+{
+	psql -X -q -A -t -p $STANDBY_PORT -d postgres -c "$1"
+}
+
+# Wait until the standby has replayed everything the primary has written
+wait_for_catchup ()
+{
+	lsn=`primary_psql "SELECT pg_current_xlog_location()"`
+	i=0
+	until [ "`standby_psql "SELECT pg_xlog_location_diff(pg_last_xlog_replay_location(), '$lsn') >= 0"`" = t ]
+	do
+		i=`expr $i + 1`
+		if [ $i -eq 300 ]
+		then
+			echo "standby did not catch up with $lsn"
+			exit 1
+		fi
+		sleep 1
+	done
+}
+
+stop_servers ()
+{
+	pg_ctl -D "$STANDBY_PGDATA" -m fast stop >/dev/null 2>&1 || true
+	pg_ctl -D "$PRIMARY_PGDATA" -m fast stop >/dev/null 2>&1 || true
+}
+trap stop_servers EXIT
+
+# enable echo so the user can see what is being executed
+set -x
+
+initdb -N -A trust -D "$PRIMARY_PGDATA" >"$logdir/initdb.log"
+cat >>"$PRIMARY_PGDATA/postgresql.conf" <<EOC
+port = $PRIMARY_PORT
+listen_addresses = '$LISTEN_ADDRESSES'
+wal_level = hot_standby
+max_wal_senders = 2
+wal_keep_segments = 64
+fsync = off
+EOC
+echo "local replication all trust" >>"$PRIMARY_PGDATA/pg_hba.conf"
+echo "host replication all 127.0.0.1/32 trust" >>"$PRIMARY_PGDATA/pg_hba.conf"
+pg_ctl -D "$PRIMARY_PGDATA" -l "$logdir/primary.log" -w start
+
+pg_basebackup -p $PRIMARY_PORT -D "$STANDBY_PGDATA" -X stream
+cat >>"$STANDBY_PGDATA/postgresql.conf" <<EOC
+port = $STANDBY_PORT
+hot_standby = on
+parallel_redo_workers = 4
+max_worker_processes = 8
+EOC
+cat >"$STANDBY_PGDATA/recovery.conf" <<EOC
+standby_mode = 'on'
+primary_conninfo = 'port=$PRIMARY_PORT'
+EOC
+pg_ctl -D "$STANDBY_PGDATA" -l "$logdir/standby.log" -w start
+
+primary_psql "CREATE TABLE redo_test (id int PRIMARY KEY, val int, filler text)"
+primary_psql "CREATE INDEX redo_test_val ON redo_test (val)"
+wait_for_catchup
+
+# Keep index scans running on the standby while the primary changes the table
+set +x
+rm -f "$temp_root/workload_done"
+(
+	while [ ! -f "$temp_root/workload_done" ]
+	do
+		standby_psql "SET enable_seqscan = off; SET enable_bitmapscan = off; SELECT count(filler) FROM redo_test WHERE id > 0; SELECT count(filler) FROM redo_test WHERE val >= 0" >/dev/null 2>>"$logdir/standby_queries.err" || true
+	done
+) &
+scanner=$!
+
+i=0
+while [ $i -lt 200 ]
+do
+	lo=`expr $i \* 500 + 1`
+	hi=`expr $i \* 500 + 500`
+	primary_psql "INSERT INTO redo_test SELECT g, g % 97, repeat('x', 100) FROM generate_series($lo, $hi) g"
+	primary_psql "UPDATE redo_test SET val = val + 1 WHERE id % 13 = $i % 13"
+	primary_psql "DELETE FROM redo_test WHERE id % 101 = $i % 101"
+	i=`expr $i + 1`
+done
+
+touch "$temp_root/workload_done"
+wait $scanner
+set -x
+
+wait_for_catchup
+
+primary_psql "SELECT id, val, filler FROM redo_test ORDER BY id" >"$temp_root/primary.out"
+standby_psql "SET enable_seqscan = off; SET enable_bitmapscan = off; SELECT id, val, filler FROM redo_test ORDER BY id" >"$temp_root/standby_id.out"
+standby_psql "SET enable_seqscan = off; SET enable_bitmapscan = off; SELECT id, val, filler FROM redo_test WHERE val >= 0 ORDER BY val, id" >"$temp_root/standby_val.out"
+primary_psql "SELECT id, val, filler FROM redo_test ORDER BY val, id" >"$temp_root/primary_val.out"
+
+# no need to echo commands anymore
+set +x
+echo
+
+if ! grep -q "parallel redo started" "$logdir/standby.log"; then
+	echo "standby did not use parallel redo"
+	exit 1
+fi
+
+if [ -s "$logdir/standby_queries.err" ]; then
+	echo "queries on the standby failed:"
+	cat "$logdir/standby_queries.err"
+	exit 1
+fi
+
+if diff -q "$temp_root/primary.out" "$temp_root/standby_id.out" &&
+   diff -q "$temp_root/primary_val.out" "$temp_root/standby_val.out"; then
+	echo PASSED
+	exit 0
+else
+	echo "standby data differs from primary"
+	exit 1
+fi
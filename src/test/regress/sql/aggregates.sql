@@ -441,3 +441,36 @@ select string_agg(v, NULL) from bytea_test_table;
 select string_agg(v, decode('ee', 'hex')) from bytea_test_table;
 
 drop table bytea_test_table;
+
+-- hashed aggregation that overflows work_mem and spills to disk
+begin;
+set local work_mem = '64kB';
+set local enable_sort = false;
+-- EXPLAIN ANALYZE output with the batch count reduced to whether the hash
+-- table spilled, since the exact count and memory use vary by platform
+create function hashagg_spill(query text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+    batches text;
+begin
+    for ln in execute 'explain (analyze, costs off, timing off) ' || query
+    loop
+        continue when ln like 'Total runtime:%';
+        batches := substring(ln from 'Batches: (\d+)');
+        if batches is not null then
+            ln := regexp_replace(ln, 'Batches: .*',
+                                 'Spilled: ' || (batches::int > 1));
+        end if;
+        return next ln;
+    end loop;
+end;
+$$;
+select * from hashagg_spill('select unique1 % 5000, count(*), sum(unique1) from tenk1 group by 1');
+select * from hashagg_spill('select distinct unique1 % 5000 from tenk1');
+select count(*) as ngroups, sum(c) as nrows, sum(s) as total
+  from (select unique1 % 5000 as g, count(*) as c, sum(unique1) as s
+        from tenk1 group by 1) ss;
+select count(*) from (select distinct unique1 % 5000 from tenk1) ss;
+rollback;
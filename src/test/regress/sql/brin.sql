@@ -0,0 +1,61 @@
+--
+-- BRIN
+--
+CREATE TABLE brintest (int4col int4, int8col int8, textcol text,
+	float8col float8, datecol date, timestampcol timestamp)
+	WITH (fillfactor = 10);
+
+INSERT INTO brintest
+SELECT i, i * 1000, to_char(i, 'FM0000'), i / 4.0,
+	'2000-01-01'::date + i, '2000-01-01'::timestamp + i * interval '1 hour'
+FROM generate_series(1, 1000) AS i;
+
+-- invalid range size
+CREATE INDEX brinidx ON brintest USING brin (int4col)
+	WITH (pages_per_range = 0);
+
+CREATE INDEX brinidx ON brintest USING brin (
+	int4col,
+	int8col,
+	textcol,
+	float8col,
+	datecol,
+	timestampcol
+) WITH (pages_per_range = 1);
+
+-- this goes through brininsert
+INSERT INTO brintest (int4col) VALUES (NULL);
+
+SET enable_seqscan = off;
+SET enable_bitmapscan = on;
+
+EXPLAIN (COSTS OFF)
+SELECT count(*) FROM brintest WHERE int4col < 100;
+SELECT count(*) FROM brintest WHERE int4col < 100;
+SELECT count(*) FROM brintest WHERE int4col IS NULL;
+SELECT count(*) FROM brintest WHERE int8col >= 500000;
+SELECT count(*) FROM brintest WHERE textcol = '0042';
+SELECT count(*) FROM brintest WHERE float8col > 200;
+SELECT count(*) FROM brintest WHERE datecol <= '2000-01-11';
+SELECT count(*) FROM brintest WHERE timestampcol = '2000-01-02 00:00';
+
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+
+-- ranges added after the index was built are not summarized until asked to
+INSERT INTO brintest
+SELECT i, i * 1000, to_char(i, 'FM0000'), i / 4.0,
+	'2000-01-01'::date + i, '2000-01-01'::timestamp + i * interval '1 hour'
+FROM generate_series(1001, 1200) AS i;
+
+SELECT brin_summarize_new_values('brinidx'::regclass) > 0 AS summarized;
+SELECT brin_summarize_new_values('brinidx'::regclass);
+
+SET enable_seqscan = off;
+SELECT count(*) FROM brintest WHERE int4col > 1100;
+RESET enable_seqscan;
+
+-- only BRIN indexes can be summarized
+SELECT brin_summarize_new_values('tenk1_unique1'::regclass);
+
+DROP TABLE brintest;
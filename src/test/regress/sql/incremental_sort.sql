@@ -0,0 +1,21 @@
+--
+-- INCREMENTAL SORT
+--
+-- The index on hundred provides the order of the leading sort key, so
+-- only the rows of each hundred group need to be sorted by unique1.
+EXPLAIN (COSTS OFF)
+SELECT hundred, unique1 FROM tenk1 ORDER BY hundred, unique1 LIMIT 5;
+SELECT hundred, unique1 FROM tenk1 ORDER BY hundred, unique1 LIMIT 5;
+-- crossing a group boundary
+SELECT hundred, unique1 FROM tenk1 ORDER BY hundred, unique1 DESC
+OFFSET 195 LIMIT 10;
+-- groups smaller than a batch
+SELECT thousand, unique1 FROM tenk1 ORDER BY thousand, unique1 DESC
+OFFSET 25 LIMIT 10;
+-- DISTINCT can use an incremental sort too
+SELECT DISTINCT hundred, ten FROM tenk1 ORDER BY hundred, ten LIMIT 3;
+-- without incremental sort, the whole table has to be sorted
+SET enable_incrementalsort = off;
+EXPLAIN (COSTS OFF)
+SELECT hundred, unique1 FROM tenk1 ORDER BY hundred, unique1 LIMIT 5;
+RESET enable_incrementalsort;
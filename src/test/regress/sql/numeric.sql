@@ -828,3 +828,23 @@ select 12345678901234567890 % 123;
 select 12345678901234567890 / 123;
 select div(12345678901234567890, 123);
 select div(12345678901234567890, 123) * 123 + 12345678901234567890 % 123;
+
+--
+-- Sorting numerics.  Abbreviated keys only capture the weight and leading
+-- digits, so this mixes NaN, zero, negative values, values too large or too
+-- small to be abbreviated exactly, and values differing only in low-order
+-- digits.
+--
+CREATE TEMP TABLE num_abbrev AS
+  SELECT CASE WHEN i % 101 = 0 THEN 'NaN'::numeric
+              ELSE ((i % 41) - 20) * ('1e' || ((i % 31) * 18 - 200))::numeric
+                   + (i % 7)
+         END AS v
+  FROM generate_series(1, 5000) i;
+SELECT count(*) FROM
+  (SELECT v, lag(v) OVER (ORDER BY v) AS prev FROM num_abbrev) ss
+WHERE prev > v;
+SELECT count(*) FROM
+  (SELECT v, lag(v) OVER (ORDER BY v DESC) AS prev FROM num_abbrev) ss
+WHERE prev < v;
+DROP TABLE num_abbrev;
@@ -0,0 +1,77 @@
+--
+-- PARTITION
+-- Tests for declarative partitioning
+--
+-- bad partition keys
+CREATE TABLE partitioned (a int, b text) PARTITION BY HASH (a);
+CREATE TABLE partitioned (a int, b text) PARTITION BY LIST (a, b);
+CREATE TABLE partitioned (a int, b text) PARTITION BY RANGE (c);
+CREATE TABLE partitioned (a int, b text) PARTITION BY RANGE (a, a);
+CREATE TABLE partitioned (a int, b text) PARTITION BY RANGE (ctid);
+CREATE TABLE partitioned (a int, b point) PARTITION BY RANGE (b);
+CREATE TABLE partitioned (a int, b text) PARTITION BY RANGE (b int4_ops);
+
+-- list partitioning
+CREATE TABLE list_parted (a int, b text) PARTITION BY LIST (a);
+CREATE TABLE list_p1 PARTITION OF list_parted FOR VALUES IN (1, 2);
+CREATE TABLE list_p2 PARTITION OF list_parted FOR VALUES IN (3, NULL);
+CREATE TABLE list_fail PARTITION OF list_parted FOR VALUES IN (4, 2);
+CREATE TABLE list_fail PARTITION OF list_parted FOR VALUES IN (NULL);
+CREATE TABLE list_fail PARTITION OF list_parted FOR VALUES FROM (4) TO (5);
+CREATE TABLE list_fail PARTITION OF list_parted FOR VALUES IN (true);
+
+-- only partitions may inherit from a partitioned table, and only
+-- partitioned tables may have partitions
+CREATE TABLE list_fail () INHERITS (list_parted);
+CREATE TABLE not_parted (a int);
+CREATE TABLE list_fail PARTITION OF not_parted FOR VALUES IN (1);
+ALTER TABLE list_p1 INHERIT not_parted;
+ALTER TABLE list_p1 NO INHERIT list_parted;
+DROP TABLE not_parted;
+
+-- partition key columns cannot be dropped or changed
+ALTER TABLE list_parted DROP COLUMN a;
+ALTER TABLE list_parted ALTER COLUMN a TYPE bigint;
+
+-- tuple routing
+INSERT INTO list_parted VALUES (1, 'one'), (3, 'three'), (NULL, 'null');
+INSERT INTO list_parted VALUES (2, 'two') RETURNING tableoid::regclass, *;
+INSERT INTO list_parted VALUES (5, 'five');
+INSERT INTO list_p1 VALUES (3, 'three');
+COPY list_parted FROM stdin;
+1	uno
+3	tres
+\.
+SELECT tableoid::regclass, * FROM list_parted ORDER BY a, b;
+UPDATE list_parted SET a = 3 WHERE b = 'one';
+
+-- partition pruning
+EXPLAIN (COSTS OFF) SELECT * FROM list_parted WHERE a = 1;
+EXPLAIN (COSTS OFF) SELECT * FROM list_parted WHERE a IS NULL;
+EXPLAIN (COSTS OFF) SELECT * FROM list_parted WHERE a IN (1, 3);
+EXPLAIN (COSTS OFF) SELECT * FROM list_parted WHERE a = 4;
+
+-- range partitioning, with a sub-partitioned partition
+CREATE TABLE range_parted (a int, b int) PARTITION BY RANGE (a, b);
+CREATE TABLE range_p1 PARTITION OF range_parted FOR VALUES FROM (MINVALUE, MINVALUE) TO (10, 0);
+CREATE TABLE range_p2 PARTITION OF range_parted FOR VALUES FROM (10, 0) TO (20, MAXVALUE);
+CREATE TABLE range_p3 PARTITION OF range_parted FOR VALUES FROM (30, 0) TO (40, 0) PARTITION BY LIST (b);
+CREATE TABLE range_p3_1 PARTITION OF range_p3 FOR VALUES IN (1, 2);
+CREATE TABLE range_fail PARTITION OF range_parted FOR VALUES FROM (25, 0) TO (21, 0);
+CREATE TABLE range_fail PARTITION OF range_parted FOR VALUES FROM (15, 0) TO (25, 0);
+CREATE TABLE range_fail PARTITION OF range_parted FOR VALUES FROM (MINVALUE, 1) TO (5, 0);
+CREATE TABLE range_fail PARTITION OF range_parted FOR VALUES FROM (21) TO (25, 0);
+CREATE TABLE range_fail PARTITION OF range_parted FOR VALUES FROM (21, NULL) TO (25, 0);
+CREATE TABLE range_fail PARTITION OF range_parted FOR VALUES IN (21);
+INSERT INTO range_parted VALUES (-5, 5), (10, 0), (20, 100), (35, 1);
+INSERT INTO range_parted VALUES (25, 0);
+INSERT INTO range_parted VALUES (35, 5);
+INSERT INTO range_p3 VALUES (5, 1);
+SELECT tableoid::regclass, * FROM range_parted ORDER BY a, b;
+EXPLAIN (COSTS OFF) SELECT * FROM range_parted WHERE a = 15;
+
+-- clean up
+DROP TABLE range_p3_1, range_p3, range_p2, range_p1;
+DROP TABLE range_parted;
+DROP TABLE list_p1, list_p2;
+DROP TABLE list_parted;
@@ -0,0 +1,29 @@
+--
+-- PARALLEL
+--
+
+-- make parallel plans attractive even for a small table
+set parallel_setup_cost = 0;
+set parallel_tuple_cost = 0;
+set max_parallel_degree = 2;
+
+explain (costs off)
+  select count(*) from tenk1 where unique1 % 10 = 3;
+select count(*) from tenk1 where unique1 % 10 = 3;
+select sum(unique1) from tenk1 where unique1 % 10 = 3;
+
+-- once the transaction has an XID, the leader scans the table by itself
+begin;
+create temp table parallel_xid (a int);
+select count(*) from tenk1 where unique1 % 10 = 3;
+rollback;
+
+-- temporary tables are never scanned in parallel
+create temp table parallel_temp as select unique1 from tenk1;
+explain (costs off)
+  select count(*) from parallel_temp where unique1 % 10 = 3;
+drop table parallel_temp;
+
+reset max_parallel_degree;
+reset parallel_tuple_cost;
+reset parallel_setup_cost;
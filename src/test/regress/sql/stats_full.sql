@@ -0,0 +1,44 @@
+--
+-- Test a full shared statistics table
+--
+-- Run by "make statsfullcheck", whose server has max_stats_entries = 1000.
+-- That's far fewer than the tables created here, so some of them get no
+-- statistics entry; the views must then show zeroes for those, and exact
+-- counts for the others.
+--
+
+-- sleep at the end, so that our counts are flushed, and the warning is
+-- issued, as soon as the block finishes
+DO $$
+BEGIN
+  FOR i IN 1..1500 LOOP
+    EXECUTE 'CREATE TABLE statsfull_' || i || ' (a int)';
+    EXECUTE 'INSERT INTO statsfull_' || i || ' VALUES (1)';
+  END LOOP;
+  PERFORM pg_sleep(0.6);
+END
+$$;
+
+-- some tables were counted and some weren't, but none wrongly
+SELECT DISTINCT n_tup_ins
+  FROM pg_stat_user_tables
+ WHERE relname LIKE 'statsfull\_%'
+ ORDER BY n_tup_ins;
+
+-- the I/O view agrees about which tables have statistics
+SELECT count(*) AS mismatches
+  FROM pg_stat_user_tables s JOIN pg_statio_user_tables io USING (relid)
+ WHERE s.relname LIKE 'statsfull\_%'
+   AND (s.n_tup_ins = 0) <> (io.heap_blks_read + io.heap_blks_hit = 0);
+
+-- database-level statistics are kept separately, and still work
+SELECT xact_commit > 0 AS db_counted
+  FROM pg_stat_database WHERE datname = current_database();
+
+DO $$
+BEGIN
+  FOR i IN 1..1500 LOOP
+    EXECUTE 'DROP TABLE statsfull_' || i;
+  END LOOP;
+END
+$$;
@@ -116,3 +116,36 @@ select format('>>%-s<<', 'Hello');
 select format('>>%10L<<', NULL);
 select format('>>%2$*1$L<<', NULL, 'Hello');
 select format('>>%2$*1$L<<', 0, 'Hello');
+
+--
+-- Sorting and indexing text.  Strings sharing a long common prefix defeat
+-- abbreviated keys, so every comparison must be resolved by the full
+-- comparator; the sort should give up on abbreviation, but either way the
+-- output must be correctly ordered.
+--
+CREATE TEMP TABLE text_abbrev AS
+  SELECT repeat('abbreviated key ', 2) || i::text AS v
+  FROM generate_series(1, 5000) i;
+SELECT count(*) FROM
+  (SELECT v, lag(v) OVER (ORDER BY v) AS prev FROM text_abbrev) ss
+WHERE prev > v;
+SELECT count(*) FROM
+  (SELECT v, lag(v) OVER (ORDER BY v COLLATE "C") AS prev FROM text_abbrev) ss
+WHERE prev > v COLLATE "C";
+SELECT count(*) FROM
+  (SELECT v, lag(v) OVER (ORDER BY v) AS prev
+   FROM (SELECT (i * 7919 % 10007)::text AS v
+         FROM generate_series(1, 5000) i) s) ss
+WHERE prev > v;
+-- external sort
+SET work_mem = '64kB';
+SELECT count(*) FROM
+  (SELECT v, lag(v) OVER (ORDER BY v DESC) AS prev FROM text_abbrev) ss
+WHERE prev < v;
+RESET work_mem;
+-- index builds
+CREATE UNIQUE INDEX text_abbrev_idx ON text_abbrev (v);
+DROP INDEX text_abbrev_idx;
+INSERT INTO text_abbrev VALUES (repeat('abbreviated key ', 2) || '42');
+CREATE UNIQUE INDEX text_abbrev_idx ON text_abbrev (v);
+DROP TABLE text_abbrev;
@@ -77,3 +77,15 @@ SELECT COUNT(*) FROM guid1 g1 LEFT JOIN guid2 g2 ON g1.guid_field = g2.guid_fiel
 
 -- clean up
 DROP TABLE guid1, guid2 CASCADE;
+
+-- sorting uuids whose leading bytes mostly coincide, which defeats
+-- abbreviated keys
+CREATE TEMP TABLE uuid_abbrev AS
+  SELECT (lpad(to_hex(i % 3), 8, '0') || '-2222-3333-' ||
+          lpad(to_hex(i % 977), 4, '0') || '-' ||
+          lpad(to_hex(i), 12, '0'))::uuid AS v
+  FROM generate_series(1, 12000) i;
+SELECT count(*) FROM
+  (SELECT v, lag(v) OVER (ORDER BY v) AS prev FROM uuid_abbrev) ss
+WHERE prev > v;
+DROP TABLE uuid_abbrev;
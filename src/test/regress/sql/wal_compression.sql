@@ -0,0 +1,33 @@
+--
+-- WAL_COMPRESSION
+--
+-- Only the first change to each page after a checkpoint logs a full-page
+-- image, so change one row on every page and compare the WAL written with
+-- and without compression.  The filler compresses well.
+CREATE TABLE walcomp (id int, filler text);
+INSERT INTO walcomp SELECT g, repeat('x', 100) FROM generate_series(1, 5000) g;
+CREATE FUNCTION walcomp_touch_pages(r int) RETURNS numeric LANGUAGE plpgsql AS $$
+DECLARE
+    start text;
+BEGIN
+    CHECKPOINT;
+    start := pg_current_xlog_insert_location();
+    UPDATE walcomp SET id = -id WHERE id % 50 = r;
+    RETURN pg_xlog_location_diff(pg_current_xlog_insert_location(), start);
+END
+$$;
+SET wal_compression = off;
+SELECT walcomp_touch_pages(0) AS plain_bytes \gset
+SET wal_compression = on;
+SELECT walcomp_touch_pages(1) AS compressed_bytes \gset
+SELECT :compressed_bytes < :plain_bytes / 2 AS smaller;
+SELECT count(*), sum(id) FROM walcomp;
+-- only superusers can change it
+CREATE ROLE walcomp_user;
+SET SESSION AUTHORIZATION walcomp_user;
+SET wal_compression = off;
+RESET SESSION AUTHORIZATION;
+DROP ROLE walcomp_user;
+RESET wal_compression;
+DROP FUNCTION walcomp_touch_pages(int);
+DROP TABLE walcomp;